@@ -4,338 +4,321 @@
  */
 
 #include <reshade.hpp>
+#include "trace_format.hpp"
 #include <cassert>
-#include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <string>
+#include <filesystem>
 #include <unordered_set>
 
 using namespace reshade::api;
+using namespace api_trace;
 
 namespace
 {
-	bool s_do_capture = false;
+	std::atomic<bool> s_do_capture = false;
 	std::shared_mutex s_mutex;
 	std::unordered_set<uint64_t> s_samplers;
 	std::unordered_set<uint64_t> s_resources;
 	std::unordered_set<uint64_t> s_resource_views;
 	std::unordered_set<uint64_t> s_pipelines;
 
-	inline auto to_string(shader_stage value)
+	/// <summary>
+	/// File that is written through a sliding memory-mapped view, so that appending a chunk is just a memory copy most of the time.
+	/// </summary>
+	class trace_file
 	{
-		switch (value)
+	public:
+		bool open(const std::filesystem::path &path)
 		{
-		case shader_stage::vertex:
-			return "vertex";
-		case shader_stage::hull:
-			return "hull";
-		case shader_stage::domain:
-			return "domain";
-		case shader_stage::geometry:
-			return "geometry";
-		case shader_stage::pixel:
-			return "pixel";
-		case shader_stage::compute:
-			return "compute";
-		case shader_stage::amplification:
-			return "amplification";
-		case shader_stage::mesh:
-			return "mesh";
-		case shader_stage::raygen:
-			return "raygen";
-		case shader_stage::any_hit:
-			return "any_hit";
-		case shader_stage::closest_hit:
-			return "closest_hit";
-		case shader_stage::miss:
-			return "miss";
-		case shader_stage::intersection:
-			return "intersection";
-		case shader_stage::callable:
-			return "callable";
-		case shader_stage::all:
-			return "all";
-		case shader_stage::all_graphics:
-			return "all_graphics";
-		case shader_stage::all_ray_tracing:
-			return "all_raytracing";
-		default:
-			return "unknown";
+			_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			_size = 0;
+			return _file != INVALID_HANDLE_VALUE;
 		}
-	}
-	inline auto to_string(pipeline_stage value)
-	{
-		switch (value)
+		void close()
 		{
-		case pipeline_stage::vertex_shader:
-			return "vertex_shader";
-		case pipeline_stage::hull_shader:
-			return "hull_shader";
-		case pipeline_stage::domain_shader:
-			return "domain_shader";
-		case pipeline_stage::geometry_shader:
-			return "geometry_shader";
-		case pipeline_stage::pixel_shader:
-			return "pixel_shader";
-		case pipeline_stage::compute_shader:
-			return "compute_shader";
-		case pipeline_stage::amplification_shader:
-			return "amplification_shader";
-		case pipeline_stage::mesh_shader:
-			return "mesh_shader";
-		case pipeline_stage::input_assembler:
-			return "input_assembler";
-		case pipeline_stage::stream_output:
-			return "stream_output";
-		case pipeline_stage::rasterizer:
-			return "rasterizer";
-		case pipeline_stage::depth_stencil:
-			return "depth_stencil";
-		case pipeline_stage::output_merger:
-			return "output_merger";
-		case pipeline_stage::all:
-			return "all";
-		case pipeline_stage::all_graphics:
-			return "all_graphics";
-		case pipeline_stage::all_ray_tracing:
-			return "all_ray_tracing";
-		case pipeline_stage::all_shader_stages:
-			return "all_shader_stages";
-		default:
-			return "unknown";
+			if (_file == INVALID_HANDLE_VALUE)
+				return;
+
+			unmap_view();
+
+			// Cut off the unused part of the last view again
+			LARGE_INTEGER size;
+			size.QuadPart = static_cast<LONGLONG>(_size);
+			SetFilePointerEx(_file, size, nullptr, FILE_BEGIN);
+			SetEndOfFile(_file);
+
+			CloseHandle(_file);
+			_file = INVALID_HANDLE_VALUE;
 		}
-	}
-	inline auto to_string(descriptor_type value)
-	{
-		switch (value)
+
+		bool is_open() const { return _file != INVALID_HANDLE_VALUE; }
+
+		bool append(const void *data, size_t size)
 		{
-		case descriptor_type::sampler:
-			return "sampler";
-		case descriptor_type::sampler_with_resource_view:
-			return "sampler_with_resource_view";
-		case descriptor_type::shader_resource_view:
-			return "shader_resource_view";
-		case descriptor_type::unordered_access_view:
-			return "unordered_access_view";
-		case descriptor_type::constant_buffer:
-			return "constant_buffer";
-		case descriptor_type::acceleration_structure:
-			return "acceleration_structure";
-		default:
-			return "unknown";
+			for (const uint8_t *src = static_cast<const uint8_t *>(data); size != 0;)
+			{
+				if (_view == nullptr || _size >= _view_offset + view_size)
+				{
+					if (!map_view(_size))
+						return false;
+				}
+
+				const size_t offset = static_cast<size_t>(_size - _view_offset);
+				const size_t write_size = std::min(size, view_size - offset);
+				std::memcpy(_view + offset, src, write_size);
+
+				src += write_size;
+				size -= write_size;
+				_size += write_size;
+			}
+
+			return true;
 		}
-	}
-	inline auto to_string(dynamic_state value)
-	{
-		switch (value)
+
+	private:
+		// Views have to start at a multiple of the allocation granularity, which is 64 KiB on all Windows versions
+		static constexpr uint64_t view_alignment = 64 * 1024;
+		// Keep the view small enough to always fit into the address space of 32-bit applications
+		static constexpr size_t view_size = 64 * 1024 * 1024;
+
+		bool map_view(uint64_t offset)
 		{
-		default:
-		case dynamic_state::unknown:
-			return "unknown";
-		case dynamic_state::alpha_test_enable:
-			return "alpha_test_enable";
-		case dynamic_state::alpha_reference_value:
-			return "alpha_reference_value";
-		case dynamic_state::alpha_func:
-			return "alpha_func";
-		case dynamic_state::srgb_write_enable:
-			return "srgb_write_enable";
-		case dynamic_state::primitive_topology:
-			return "primitive_topology";
-		case dynamic_state::sample_mask:
-			return "sample_mask";
-		case dynamic_state::alpha_to_coverage_enable:
-			return "alpha_to_coverage_enable";
-		case dynamic_state::blend_enable:
-			return "blend_enable";
-		case dynamic_state::logic_op_enable:
-			return "logic_op_enable";
-		case dynamic_state::color_blend_op:
-			return "color_blend_op";
-		case dynamic_state::source_color_blend_factor:
-			return "src_color_blend_factor";
-		case dynamic_state::dest_color_blend_factor:
-			return "dst_color_blend_factor";
-		case dynamic_state::alpha_blend_op:
-			return "alpha_blend_op";
-		case dynamic_state::source_alpha_blend_factor:
-			return "src_alpha_blend_factor";
-		case dynamic_state::dest_alpha_blend_factor:
-			return "dst_alpha_blend_factor";
-		case dynamic_state::logic_op:
-			return "logic_op";
-		case dynamic_state::blend_constant:
-			return "blend_constant";
-		case dynamic_state::render_target_write_mask:
-			return "render_target_write_mask";
-		case dynamic_state::fill_mode:
-			return "fill_mode";
-		case dynamic_state::cull_mode:
-			return "cull_mode";
-		case dynamic_state::front_counter_clockwise:
-			return "front_counter_clockwise";
-		case dynamic_state::depth_bias:
-			return "depth_bias";
-		case dynamic_state::depth_bias_clamp:
-			return "depth_bias_clamp";
-		case dynamic_state::depth_bias_slope_scaled:
-			return "depth_bias_slope_scaled";
-		case dynamic_state::depth_clip_enable:
-			return "depth_clip_enable";
-		case dynamic_state::scissor_enable:
-			return "scissor_enable";
-		case dynamic_state::multisample_enable:
-			return "multisample_enable";
-		case dynamic_state::antialiased_line_enable:
-			return "antialiased_line_enable";
-		case dynamic_state::depth_enable:
-			return "depth_enable";
-		case dynamic_state::depth_write_mask:
-			return "depth_write_mask";
-		case dynamic_state::depth_func:
-			return "depth_func";
-		case dynamic_state::stencil_enable:
-			return "stencil_enable";
-		case dynamic_state::front_stencil_read_mask:
-			return "front_stencil_read_mask";
-		case dynamic_state::front_stencil_write_mask:
-			return "front_stencil_write_mask";
-		case dynamic_state::front_stencil_reference_value:
-			return "front_stencil_reference_value";
-		case dynamic_state::front_stencil_func:
-			return "front_stencil_func";
-		case dynamic_state::front_stencil_pass_op:
-			return "front_stencil_pass_op";
-		case dynamic_state::front_stencil_fail_op:
-			return "front_stencil_fail_op";
-		case dynamic_state::front_stencil_depth_fail_op:
-			return "front_stencil_depth_fail_op";
-		case dynamic_state::back_stencil_read_mask:
-			return "back_stencil_read_mask";
-		case dynamic_state::back_stencil_write_mask:
-			return "back_stencil_write_mask";
-		case dynamic_state::back_stencil_reference_value:
-			return "back_stencil_reference_value";
-		case dynamic_state::back_stencil_func:
-			return "back_stencil_func";
-		case dynamic_state::back_stencil_pass_op:
-			return "back_stencil_pass_op";
-		case dynamic_state::back_stencil_fail_op:
-			return "back_stencil_fail_op";
-		case dynamic_state::back_stencil_depth_fail_op:
-			return "back_stencil_depth_fail_op";
+			unmap_view();
+
+			_view_offset = offset & ~(view_alignment - 1);
+
+			// Creating a mapping that is larger than the file grows the file to that size
+			const uint64_t mapping_size = _view_offset + view_size;
+			_mapping = CreateFileMappingW(_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(mapping_size >> 32), static_cast<DWORD>(mapping_size), nullptr);
+			if (_mapping == nullptr)
+				return false;
+
+			_view = static_cast<uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_WRITE, static_cast<DWORD>(_view_offset >> 32), static_cast<DWORD>(_view_offset), view_size));
+			return _view != nullptr;
 		}
-	}
-	inline auto to_string(resource_usage value)
+		void unmap_view()
+		{
+			if (_view != nullptr)
+				UnmapViewOfFile(_view);
+			_view = nullptr;
+			if (_mapping != nullptr)
+				CloseHandle(_mapping);
+			_mapping = nullptr;
+		}
+
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = nullptr;
+		uint8_t *_view = nullptr;
+		uint64_t _view_offset = 0;
+		uint64_t _size = 0;
+	};
+
+	/// <summary>
+	/// Events are first encoded into a buffer local to the thread they occur on, which is only written to the trace file once it is full.
+	/// </summary>
+	struct thread_buffer
 	{
-		switch (value)
+		// Only contended while a capture is started or stopped, which needs to flush the buffers of all threads
+		std::mutex mutex;
+		uint32_t thread_id = GetCurrentThreadId();
+		uint64_t base_timestamp = 0;
+		uint64_t last_timestamp = 0;
+		uint64_t last_cmd_list = 0;
+		std::vector<uint8_t> data;
+		std::vector<uint8_t> compressed_data;
+	};
+
+	std::mutex s_trace_mutex; // Protects the trace file and thread buffer list
+	trace_file s_trace_file;
+	std::filesystem::path s_trace_path;
+	std::vector<std::shared_ptr<thread_buffer>> s_thread_buffers;
+	bool s_compress = true;
+	unsigned int s_capture_frame_count = 1;
+	uint64_t s_frame_index = 0;
+
+	thread_buffer &get_thread_buffer()
+	{
+		thread_local std::shared_ptr<thread_buffer> buffer;
+
+		if (buffer == nullptr)
 		{
-		default:
-		case resource_usage::undefined:
-			return "undefined";
-		case resource_usage::index_buffer:
-			return "index_buffer";
-		case resource_usage::vertex_buffer:
-			return "vertex_buffer";
-		case resource_usage::constant_buffer:
-			return "constant_buffer";
-		case resource_usage::stream_output:
-			return "stream_output";
-		case resource_usage::indirect_argument:
-			return "indirect_argument";
-		case resource_usage::depth_stencil:
-		case resource_usage::depth_stencil_read:
-		case resource_usage::depth_stencil_write:
-			return "depth_stencil";
-		case resource_usage::render_target:
-			return "render_target";
-		case resource_usage::shader_resource:
-		case resource_usage::shader_resource_pixel:
-		case resource_usage::shader_resource_non_pixel:
-			return "shader_resource";
-		case resource_usage::unordered_access:
-			return "unordered_access";
-		case resource_usage::copy_dest:
-			return "copy_dest";
-		case resource_usage::copy_source:
-			return "copy_source";
-		case resource_usage::resolve_dest:
-			return "resolve_dest";
-		case resource_usage::resolve_source:
-			return "resolve_source";
-		case resource_usage::acceleration_structure:
-			return "acceleration_structure";
-		case resource_usage::general:
-			return "general";
-		case resource_usage::present:
-			return "present";
-		case resource_usage::cpu_access:
-			return "cpu_access";
+			buffer = std::make_shared<thread_buffer>();
+			buffer->data.reserve(trace_chunk_size + 4096);
+
+			// Keep a reference in the global list as well, so that events of threads that exited before the capture is stopped are not lost
+			const std::unique_lock<std::mutex> lock(s_trace_mutex);
+			s_thread_buffers.push_back(buffer);
 		}
+
+		return *buffer;
 	}
-	inline auto to_string(query_type value)
+
+	/// <summary>
+	/// Writes the contents of a thread buffer as a chunk to the trace file. The mutex of the buffer has to be locked by the caller.
+	/// </summary>
+	void flush_thread_buffer(thread_buffer &buffer)
 	{
-		switch (value)
+		if (buffer.data.empty())
+			return;
+
+		trace_chunk_header chunk;
+		chunk.thread_id = buffer.thread_id;
+		chunk.size = static_cast<uint32_t>(buffer.data.size());
+		chunk.uncompressed_size = chunk.size;
+		chunk.base_timestamp = buffer.base_timestamp;
+
+		const uint8_t *chunk_data = buffer.data.data();
+
+		// Compress before entering the lock, so that multiple threads can do so in parallel
+		if (s_compress)
 		{
-		case query_type::occlusion:
-			return "occlusion";
-		case query_type::binary_occlusion:
-			return "binary_occlusion";
-		case query_type::timestamp:
-			return "timestamp";
-		case query_type::pipeline_statistics:
-			return "pipeline_statistics";
-		case query_type::stream_output_statistics_0:
-			return "stream_output_statistics_0";
-		case query_type::stream_output_statistics_1:
-			return "stream_output_statistics_1";
-		case query_type::stream_output_statistics_2:
-			return "stream_output_statistics_2";
-		case query_type::stream_output_statistics_3:
-			return "stream_output_statistics_3";
-		default:
-			return "unknown";
+			buffer.compressed_data.resize(lz4_compress_bound(buffer.data.size()));
+			const size_t compressed_size = lz4_compress_block(buffer.data.data(), buffer.data.size(), buffer.compressed_data.data());
+
+			// Store chunks that did not compress well uncompressed
+			if (compressed_size < buffer.data.size())
+			{
+				chunk.size = static_cast<uint32_t>(compressed_size);
+				chunk_data = buffer.compressed_data.data();
+			}
 		}
+
+		{	const std::unique_lock<std::mutex> lock(s_trace_mutex);
+
+			// Events may still arrive shortly after a capture was stopped, simply drop those
+			if (s_trace_file.is_open())
+			{
+				s_trace_file.append(&chunk, sizeof(chunk));
+				s_trace_file.append(chunk_data, chunk.size);
+			}
+		}
+
+		buffer.data.clear();
+		// Chunks have to be decodable on their own, so emit the current command list again at the start of the next one
+		buffer.last_cmd_list = 0;
 	}
-	inline auto to_string(acceleration_structure_type value)
+
+	/// <summary>
+	/// Encodes a single event into the buffer of the current thread. The arguments have to be written in the order of the signature in <see cref="trace_event_infos"/>.
+	/// </summary>
+	class trace_event
 	{
-		switch (value)
+	public:
+		trace_event(trace_event_type type, command_list *cmd_list) :
+			_buffer(get_thread_buffer()), _lock(_buffer.mutex)
 		{
-		case acceleration_structure_type::top_level:
-			return "top_level";
-		case acceleration_structure_type::bottom_level:
-			return "bottom_level";
-		default:
-		case acceleration_structure_type::generic:
-			return "generic";
+			LARGE_INTEGER timestamp;
+			QueryPerformanceCounter(&timestamp);
+
+			if (_buffer.data.empty())
+				_buffer.base_timestamp = _buffer.last_timestamp = timestamp.QuadPart;
+
+			if (cmd_list != nullptr && cmd_list->get_native() != _buffer.last_cmd_list)
+			{
+				_buffer.last_cmd_list = cmd_list->get_native();
+
+				write_header(trace_event_type::command_list, timestamp.QuadPart);
+				write_handle(_buffer.last_cmd_list);
+			}
+
+			write_header(type, timestamp.QuadPart);
+		}
+		~trace_event()
+		{
+			if (_buffer.data.size() >= trace_chunk_size)
+				flush_thread_buffer(_buffer);
+		}
+
+		void write_uint(uint64_t value) { write_varint(_buffer.data, value); }
+		void write_int(int64_t value) { write_svarint(_buffer.data, value); }
+		void write_handle(uint64_t value) { write_varint(_buffer.data, value); }
+		void write_float(float value) { api_trace::write_float(_buffer.data, value); }
+
+	private:
+		void write_header(trace_event_type type, uint64_t timestamp)
+		{
+			_buffer.data.push_back(static_cast<uint8_t>(type));
+			write_varint(_buffer.data, timestamp - _buffer.last_timestamp);
+			_buffer.last_timestamp = timestamp;
 		}
+
+		thread_buffer &_buffer;
+		const std::unique_lock<std::mutex> _lock;
+	};
+
+	std::vector<std::shared_ptr<thread_buffer>> get_thread_buffers()
+	{
+		const std::unique_lock<std::mutex> lock(s_trace_mutex);
+		return s_thread_buffers;
 	}
-	inline auto to_string(acceleration_structure_copy_mode value)
+
+	void start_capture(device_api api)
 	{
-		switch (value)
+		// Discard anything that was recorded after the previous capture was stopped (careful to not lock the thread buffer while holding the trace mutex, since flushing does so the other way around)
+		for (const std::shared_ptr<thread_buffer> &buffer : get_thread_buffers())
 		{
-		case acceleration_structure_copy_mode::clone:
-			return "clone";
-		case acceleration_structure_copy_mode::compact:
-			return "compact";
-		case acceleration_structure_copy_mode::serialize:
-			return "serialize";
-		case acceleration_structure_copy_mode::deserialize:
-			return "deserialize";
-		default:
-			return "unknown";
+			const std::unique_lock<std::mutex> lock(buffer->mutex);
+			buffer->data.clear();
+			buffer->last_cmd_list = 0;
+		}
+
+		reshade::get_config_value(nullptr, "API_TRACE", "Compress", s_compress);
+		reshade::get_config_value(nullptr, "API_TRACE", "FrameCount", s_capture_frame_count);
+
+		char base_path[MAX_PATH] = "";
+		size_t base_path_size = sizeof(base_path);
+		reshade::get_reshade_base_path(base_path, &base_path_size);
+
+		SYSTEMTIME time;
+		GetLocalTime(&time);
+		char file_name[64];
+		sprintf_s(file_name, "api_trace_%.4d-%.2d-%.2d_%.2d-%.2d-%.2d.trace", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+
+		trace_file_header header;
+		header.device_api = static_cast<uint16_t>(api);
+		header.timestamp_frequency = frequency.QuadPart;
+
+		{	const std::unique_lock<std::mutex> lock(s_trace_mutex);
+
+			s_trace_path = std::filesystem::u8path(base_path) / file_name;
+
+			if (!s_trace_file.open(s_trace_path) || !s_trace_file.append(&header, sizeof(header)))
+			{
+				s_trace_file.close();
+				reshade::log::message(reshade::log::level::error, ("Failed to open trace file \"" + s_trace_path.u8string() + "\"!").c_str());
+				return;
+			}
 		}
+
+		s_frame_index = 0;
+		s_do_capture = true;
+
+		reshade::log::message(reshade::log::level::info, ("Started writing trace to \"" + s_trace_path.u8string() + "\".").c_str());
 	}
-	inline auto to_string(acceleration_structure_build_mode value)
+	void stop_capture()
 	{
-		switch (value)
+		s_do_capture = false;
+
+		for (const std::shared_ptr<thread_buffer> &buffer : get_thread_buffers())
 		{
-		case acceleration_structure_build_mode::build:
-			return "build";
-		case acceleration_structure_build_mode::update:
-			return "update";
-		default:
-			return "unknown";
+			const std::unique_lock<std::mutex> lock(buffer->mutex);
+			flush_thread_buffer(*buffer);
 		}
+
+		const std::unique_lock<std::mutex> lock(s_trace_mutex);
+
+		s_trace_file.close();
+
+		reshade::log::message(reshade::log::level::info, ("Finished writing trace of " + std::to_string(s_frame_index) + " frame(s) to \"" + s_trace_path.u8string() + "\".").c_str());
 	}
 }
 
@@ -423,7 +406,7 @@ static void on_destroy_pipeline(device *device, pipeline handle)
 	s_pipelines.erase(handle.handle);
 }
 
-static void on_barrier(command_list *, uint32_t num_resources, const resource *resources, const resource_usage *old_states, const resource_usage *new_states)
+static void on_barrier(command_list *cmd_list, uint32_t num_resources, const resource *resources, const resource_usage *old_states, const resource_usage *new_states)
 {
 	if (!s_do_capture)
 		return;
@@ -438,36 +421,32 @@ static void on_barrier(command_list *, uint32_t num_resources, const resource *r
 
 	for (uint32_t i = 0; i < num_resources; ++i)
 	{
-		std::stringstream s;
-		s << "barrier(" << (void *)resources[i].handle << ", " << to_string(old_states[i]) << ", " << to_string(new_states[i]) << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
+		trace_event e(trace_event_type::barrier, cmd_list);
+		e.write_handle(resources[i].handle);
+		e.write_uint(static_cast<uint32_t>(old_states[i]));
+		e.write_uint(static_cast<uint32_t>(new_states[i]));
 	}
 }
 
-static void on_begin_render_pass(command_list *, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
+static void on_begin_render_pass(command_list *cmd_list, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "begin_render_pass(" << count << ", { ";
+	trace_event e(trace_event_type::begin_render_pass, cmd_list);
+	e.write_uint(count);
 	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rts[i].view.handle << ", ";
-	s << " }, " << (ds != nullptr ? (void *)ds->view.handle : 0) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+		e.write_handle(rts[i].view.handle);
+	e.write_handle(ds != nullptr ? ds->view.handle : 0);
 }
-static void on_end_render_pass(command_list *)
+static void on_end_render_pass(command_list *cmd_list)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "end_render_pass()";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::end_render_pass, cmd_list);
 }
-static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t count, const resource_view *rtvs, resource_view dsv)
+static void on_bind_render_targets_and_depth_stencil(command_list *cmd_list, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
 	if (!s_do_capture)
 		return;
@@ -481,16 +460,14 @@ static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t co
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_render_targets_and_depth_stencil(" << count << ", { ";
+	trace_event e(trace_event_type::bind_render_targets_and_depth_stencil, cmd_list);
+	e.write_uint(count);
 	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rtvs[i].handle << ", ";
-	s << " }, " << (void *)dsv.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+		e.write_handle(rtvs[i].handle);
+	e.write_handle(dsv.handle);
 }
 
-static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipeline)
+static void on_bind_pipeline(command_list *cmd_list, pipeline_stage type, pipeline pipeline)
 {
 	if (!s_do_capture)
 		return;
@@ -502,57 +479,71 @@ static void on_bind_pipeline(command_list *, pipeline_stage type, pipeline pipel
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_pipeline(" << to_string(type) << ", " << (void *)pipeline.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::bind_pipeline, cmd_list);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_handle(pipeline.handle);
 }
-static void on_bind_pipeline_states(command_list *, uint32_t count, const dynamic_state *states, const uint32_t *values)
+static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, const dynamic_state *states, const uint32_t *values)
 {
 	if (!s_do_capture)
 		return;
 
 	for (uint32_t i = 0; i < count; ++i)
 	{
-		std::stringstream s;
-		s << "bind_pipeline_state(" << to_string(states[i]) << ", " << values[i] << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
+		trace_event e(trace_event_type::bind_pipeline_state, cmd_list);
+		e.write_uint(static_cast<uint32_t>(states[i]));
+		e.write_uint(values[i]);
 	}
 }
-static void on_bind_viewports(command_list *, uint32_t first, uint32_t count, const viewport *viewports)
+static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t count, const viewport *viewports)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_viewports(" << first << ", " << count << ", { ... })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::bind_viewports, cmd_list);
+	e.write_uint(first);
+	e.write_uint(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		e.write_float(viewports[i].x);
+		e.write_float(viewports[i].y);
+		e.write_float(viewports[i].width);
+		e.write_float(viewports[i].height);
+		e.write_float(viewports[i].min_depth);
+		e.write_float(viewports[i].max_depth);
+	}
 }
-static void on_bind_scissor_rects(command_list *, uint32_t first, uint32_t count, const rect *rects)
+static void on_bind_scissor_rects(command_list *cmd_list, uint32_t first, uint32_t count, const rect *rects)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "bind_scissor_rects(" << first << ", " << count << ", { ... })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::bind_scissor_rects, cmd_list);
+	e.write_uint(first);
+	e.write_uint(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		e.write_int(rects[i].left);
+		e.write_int(rects[i].top);
+		e.write_int(rects[i].right);
+		e.write_int(rects[i].bottom);
+	}
 }
-static void on_push_constants(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, uint32_t first, uint32_t count, const void *values)
+static void on_push_constants(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t param_index, uint32_t first, uint32_t count, const void *values)
 {
 	if (!s_do_capture)
 		return;
 
-	std::stringstream s;
-	s << "push_constants(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", " << first << ", " << count << ", { ";
+	trace_event e(trace_event_type::push_constants, cmd_list);
+	e.write_uint(static_cast<uint32_t>(stages));
+	e.write_handle(layout.handle);
+	e.write_uint(param_index);
+	e.write_uint(first);
+	e.write_uint(count);
 	for (uint32_t i = 0; i < count; ++i)
-		s << std::hex << static_cast<const uint32_t *>(values)[i] << std::dec << ", ";
-	s << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+		e.write_uint(static_cast<const uint32_t *>(values)[i]);
 }
-static void on_push_descriptors(command_list *, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update &update)
+static void on_push_descriptors(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update &update)
 {
 	if (!s_do_capture)
 		return;
@@ -586,24 +577,29 @@ static void on_push_descriptors(command_list *, shader_stage stages, pipeline_la
 	}
 #endif
 
-	std::stringstream s;
-	s << "push_descriptors(" << to_string(stages) << ", " << (void *)layout.handle << ", " << param_index << ", { " << to_string(update.type) << ", " << update.binding << ", " << update.count << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::push_descriptors, cmd_list);
+	e.write_uint(static_cast<uint32_t>(stages));
+	e.write_handle(layout.handle);
+	e.write_uint(param_index);
+	e.write_uint(static_cast<uint32_t>(update.type));
+	e.write_uint(update.binding);
+	e.write_uint(update.count);
 }
-static void on_bind_descriptor_tables(command_list *, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
+static void on_bind_descriptor_tables(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
 {
 	if (!s_do_capture)
 		return;
 
 	for (uint32_t i = 0; i < count; ++i)
 	{
-		std::stringstream s;
-		s << "bind_descriptor_table(" << to_string(stages) << ", " << (void *)layout.handle << ", " << (first + i) << ", " << (void *)tables[i].handle << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
+		trace_event e(trace_event_type::bind_descriptor_table, cmd_list);
+		e.write_uint(static_cast<uint32_t>(stages));
+		e.write_handle(layout.handle);
+		e.write_uint(first + i);
+		e.write_handle(tables[i].handle);
 	}
 }
-static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offset, uint32_t index_size)
+static void on_bind_index_buffer(command_list *cmd_list, resource buffer, uint64_t offset, uint32_t index_size)
 {
 	if (!s_do_capture)
 		return;
@@ -615,12 +611,12 @@ static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offse
 	}
 #endif
 
-	std::stringstream s;
-	s << "bind_index_buffer(" << (void *)buffer.handle << ", " << offset << ", " << index_size << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::bind_index_buffer, cmd_list);
+	e.write_handle(buffer.handle);
+	e.write_uint(offset);
+	e.write_uint(index_size);
 }
-static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
+static void on_bind_vertex_buffers(command_list *cmd_list, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
 	if (!s_do_capture)
 		return;
@@ -635,106 +631,108 @@ static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t coun
 
 	for (uint32_t i = 0; i < count; ++i)
 	{
-		std::stringstream s;
-		s << "bind_vertex_buffer(" << (first + i) << ", " << (void *)buffers[i].handle << ", " << (offsets != nullptr ? offsets[i] : 0) << ", " << (strides != nullptr ? strides[i] : 0) << ")";
-		reshade::log::message(reshade::log::level::info, s.str().c_str());
+		trace_event e(trace_event_type::bind_vertex_buffer, cmd_list);
+		e.write_uint(first + i);
+		e.write_handle(buffers[i].handle);
+		e.write_uint(offsets != nullptr ? offsets[i] : 0);
+		e.write_uint(strides != nullptr ? strides[i] : 0);
 	}
 }
 
-static bool on_draw(command_list *, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
+static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instances, uint32_t first_vertex, uint32_t first_instance)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw(" << vertices << ", " << instances << ", " << first_vertex << ", " << first_instance << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::draw, cmd_list);
+	e.write_uint(vertices);
+	e.write_uint(instances);
+	e.write_uint(first_vertex);
+	e.write_uint(first_instance);
 
 	return false;
 }
-static bool on_draw_indexed(command_list *, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+static bool on_draw_indexed(command_list *cmd_list, uint32_t indices, uint32_t instances, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "draw_indexed(" << indices << ", " << instances << ", " << first_index << ", " << vertex_offset << ", " << first_instance << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::draw_indexed, cmd_list);
+	e.write_uint(indices);
+	e.write_uint(instances);
+	e.write_uint(first_index);
+	e.write_int(vertex_offset);
+	e.write_uint(first_instance);
 
 	return false;
 }
-static bool on_dispatch(command_list *, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+static bool on_dispatch(command_list *cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch(" << group_count_x << ", " << group_count_y << ", " << group_count_z << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::dispatch, cmd_list);
+	e.write_uint(group_count_x);
+	e.write_uint(group_count_y);
+	e.write_uint(group_count_z);
 
 	return false;
 }
-static bool on_dispatch_mesh(command_list *, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+static bool on_dispatch_mesh(command_list *cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch_mesh(" << group_count_x << ", " << group_count_y << ", " << group_count_z << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::dispatch_mesh, cmd_list);
+	e.write_uint(group_count_x);
+	e.write_uint(group_count_y);
+	e.write_uint(group_count_z);
 
 	return false;
 }
-static bool on_dispatch_rays(command_list *, resource raygen, uint64_t raygen_offset, uint64_t raygen_size, resource miss, uint64_t miss_offset, uint64_t miss_size, uint64_t miss_stride, resource hit_group, uint64_t hit_group_offset, uint64_t hit_group_size, uint64_t hit_group_stride, resource callable, uint64_t callable_offset, uint64_t callable_size, uint64_t callable_stride, uint32_t width, uint32_t height, uint32_t depth)
+static bool on_dispatch_rays(command_list *cmd_list, resource raygen, uint64_t raygen_offset, uint64_t raygen_size, resource miss, uint64_t miss_offset, uint64_t miss_size, uint64_t miss_stride, resource hit_group, uint64_t hit_group_offset, uint64_t hit_group_size, uint64_t hit_group_stride, resource callable, uint64_t callable_offset, uint64_t callable_size, uint64_t callable_stride, uint32_t width, uint32_t height, uint32_t depth)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "dispatch_rays(" << (void *)raygen.handle << ", " << raygen_offset << ", " << raygen_size << ", " << (void *)miss.handle << ", " << miss_offset << ", " << miss_size << ", " << miss_stride << (void *)hit_group.handle << ", " << hit_group_offset << ", " << hit_group_size << ", " << hit_group_stride << ", " << (void *)callable.handle << ", " << callable_offset << ", " << callable_size << ", " << callable_stride << ", " << width << ", " << height << ", " << depth << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::dispatch_rays, cmd_list);
+	e.write_handle(raygen.handle);
+	e.write_uint(raygen_offset);
+	e.write_uint(raygen_size);
+	e.write_handle(miss.handle);
+	e.write_uint(miss_offset);
+	e.write_uint(miss_size);
+	e.write_uint(miss_stride);
+	e.write_handle(hit_group.handle);
+	e.write_uint(hit_group_offset);
+	e.write_uint(hit_group_size);
+	e.write_uint(hit_group_stride);
+	e.write_handle(callable.handle);
+	e.write_uint(callable_offset);
+	e.write_uint(callable_size);
+	e.write_uint(callable_stride);
+	e.write_uint(width);
+	e.write_uint(height);
+	e.write_uint(depth);
 
 	return false;
 }
-static bool on_draw_or_dispatch_indirect(command_list *, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
+static bool on_draw_or_dispatch_indirect(command_list *cmd_list, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
 {
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	switch (type)
-	{
-	case indirect_command::unknown:
-		s << "draw_or_dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::draw:
-		s << "draw_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::draw_indexed:
-		s << "draw_indexed_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::dispatch:
-		s << "dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::dispatch_mesh:
-		s << "dispatch_mesh_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	case indirect_command::dispatch_rays:
-		s << "dispatch_rays_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-		break;
-	}
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::draw_or_dispatch_indirect, cmd_list);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_handle(buffer.handle);
+	e.write_uint(offset);
+	e.write_uint(draw_count);
+	e.write_uint(stride);
 
 	return false;
 }
 
-static bool on_copy_resource(command_list *, resource src, resource dst)
+static bool on_copy_resource(command_list *cmd_list, resource src, resource dst)
 {
 	if (!s_do_capture)
 		return false;
@@ -747,14 +745,13 @@ static bool on_copy_resource(command_list *, resource src, resource dst)
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_resource(" << (void *)src.handle << ", " << (void *)dst.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_resource, cmd_list);
+	e.write_handle(src.handle);
+	e.write_handle(dst.handle);
 
 	return false;
 }
-static bool on_copy_buffer_region(command_list *, resource src, uint64_t src_offset, resource dst, uint64_t dst_offset, uint64_t size)
+static bool on_copy_buffer_region(command_list *cmd_list, resource src, uint64_t src_offset, resource dst, uint64_t dst_offset, uint64_t size)
 {
 	if (!s_do_capture)
 		return false;
@@ -767,14 +764,16 @@ static bool on_copy_buffer_region(command_list *, resource src, uint64_t src_off
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_region(" << (void *)src.handle << ", " << src_offset << ", " << (void *)dst.handle << ", " << dst_offset << ", " << size << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_buffer_region, cmd_list);
+	e.write_handle(src.handle);
+	e.write_uint(src_offset);
+	e.write_handle(dst.handle);
+	e.write_uint(dst_offset);
+	e.write_uint(size);
 
 	return false;
 }
-static bool on_copy_buffer_to_texture(command_list *, resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, resource dst, uint32_t dst_subresource, const subresource_box *)
+static bool on_copy_buffer_to_texture(command_list *cmd_list, resource src, uint64_t src_offset, uint32_t row_length, uint32_t slice_height, resource dst, uint32_t dst_subresource, const subresource_box *)
 {
 	if (!s_do_capture)
 		return false;
@@ -787,14 +786,17 @@ static bool on_copy_buffer_to_texture(command_list *, resource src, uint64_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_buffer_to_texture(" << (void *)src.handle << ", " << src_offset << ", " << row_length << ", " << slice_height << ", " << (void *)dst.handle << ", " << dst_subresource << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_buffer_to_texture, cmd_list);
+	e.write_handle(src.handle);
+	e.write_uint(src_offset);
+	e.write_uint(row_length);
+	e.write_uint(slice_height);
+	e.write_handle(dst.handle);
+	e.write_uint(dst_subresource);
 
 	return false;
 }
-static bool on_copy_texture_region(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, const subresource_box *, filter_mode filter)
+static bool on_copy_texture_region(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, const subresource_box *, filter_mode filter)
 {
 	if (!s_do_capture)
 		return false;
@@ -807,14 +809,16 @@ static bool on_copy_texture_region(command_list *, resource src, uint32_t src_su
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_region(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_subresource << ", " << (uint32_t)filter << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_texture_region, cmd_list);
+	e.write_handle(src.handle);
+	e.write_uint(src_subresource);
+	e.write_handle(dst.handle);
+	e.write_uint(dst_subresource);
+	e.write_uint(static_cast<uint32_t>(filter));
 
 	return false;
 }
-static bool on_copy_texture_to_buffer(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
+static bool on_copy_texture_to_buffer(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
 {
 	if (!s_do_capture)
 		return false;
@@ -827,14 +831,17 @@ static bool on_copy_texture_to_buffer(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_texture_to_buffer(" << (void *)src.handle << ", " << src_subresource << ", " << (void *)dst.handle << ", " << dst_offset << ", " << row_length << ", " << slice_height << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_texture_to_buffer, cmd_list);
+	e.write_handle(src.handle);
+	e.write_uint(src_subresource);
+	e.write_handle(dst.handle);
+	e.write_uint(dst_offset);
+	e.write_uint(row_length);
+	e.write_uint(slice_height);
 
 	return false;
 }
-static bool on_resolve_texture_region(command_list *, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, uint32_t dst_x, uint32_t dst_y, uint32_t dst_z, format format)
+static bool on_resolve_texture_region(command_list *cmd_list, resource src, uint32_t src_subresource, const subresource_box *, resource dst, uint32_t dst_subresource, uint32_t dst_x, uint32_t dst_y, uint32_t dst_z, format format)
 {
 	if (!s_do_capture)
 		return false;
@@ -847,15 +854,20 @@ static bool on_resolve_texture_region(command_list *, resource src, uint32_t src
 	}
 #endif
 
-	std::stringstream s;
-	s << "resolve_texture_region(" << (void *)src.handle << ", " << src_subresource << ", { ... }, " << (void *)dst.handle << ", " << dst_subresource << ", " << dst_x << ", " << dst_y << ", " << dst_z << ", " << (uint32_t)format << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::resolve_texture_region, cmd_list);
+	e.write_handle(src.handle);
+	e.write_uint(src_subresource);
+	e.write_handle(dst.handle);
+	e.write_uint(dst_subresource);
+	e.write_uint(dst_x);
+	e.write_uint(dst_y);
+	e.write_uint(dst_z);
+	e.write_uint(static_cast<uint32_t>(format));
 
 	return false;
 }
 
-static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
+static bool on_clear_depth_stencil_view(command_list *cmd_list, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -867,14 +879,14 @@ static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_depth_stencil_view(" << (void *)dsv.handle << ", " << (depth != nullptr ? *depth : 0.0f) << ", " << (stencil != nullptr ? *stencil : 0) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::clear_depth_stencil_view, cmd_list);
+	e.write_handle(dsv.handle);
+	e.write_float(depth != nullptr ? *depth : 0.0f);
+	e.write_uint(stencil != nullptr ? *stencil : 0);
 
 	return false;
 }
-static bool on_clear_render_target_view(command_list *, resource_view rtv, const float color[4], uint32_t, const rect *)
+static bool on_clear_render_target_view(command_list *cmd_list, resource_view rtv, const float color[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -886,14 +898,14 @@ static bool on_clear_render_target_view(command_list *, resource_view rtv, const
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_render_target_view(" << (void *)rtv.handle << ", { " << color[0] << ", " << color[1] << ", " << color[2] << ", " << color[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::clear_render_target_view, cmd_list);
+	e.write_handle(rtv.handle);
+	for (int i = 0; i < 4; ++i)
+		e.write_float(color[i]);
 
 	return false;
 }
-static bool on_clear_unordered_access_view_uint(command_list *, resource_view uav, const uint32_t values[4], uint32_t, const rect *)
+static bool on_clear_unordered_access_view_uint(command_list *cmd_list, resource_view uav, const uint32_t values[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -905,14 +917,14 @@ static bool on_clear_unordered_access_view_uint(command_list *, resource_view ua
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_uint(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::clear_unordered_access_view_uint, cmd_list);
+	e.write_handle(uav.handle);
+	for (int i = 0; i < 4; ++i)
+		e.write_uint(values[i]);
 
 	return false;
 }
-static bool on_clear_unordered_access_view_float(command_list *, resource_view uav, const float values[4], uint32_t, const rect *)
+static bool on_clear_unordered_access_view_float(command_list *cmd_list, resource_view uav, const float values[4], uint32_t, const rect *)
 {
 	if (!s_do_capture)
 		return false;
@@ -924,15 +936,15 @@ static bool on_clear_unordered_access_view_float(command_list *, resource_view u
 	}
 #endif
 
-	std::stringstream s;
-	s << "clear_unordered_access_view_float(" << (void *)uav.handle << ", { " << values[0] << ", " << values[1] << ", " << values[2] << ", " << values[3] << " })";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::clear_unordered_access_view_float, cmd_list);
+	e.write_handle(uav.handle);
+	for (int i = 0; i < 4; ++i)
+		e.write_float(values[i]);
 
 	return false;
 }
 
-static bool on_copy_acceleration_structure(command_list *, resource_view source, resource_view dest, acceleration_structure_copy_mode mode)
+static bool on_copy_acceleration_structure(command_list *cmd_list, resource_view source, resource_view dest, acceleration_structure_copy_mode mode)
 {
 	if (!s_do_capture)
 		return false;
@@ -944,14 +956,14 @@ static bool on_copy_acceleration_structure(command_list *, resource_view source,
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_acceleration_structure(" << (void *)source.handle << ", " << (void *)dest.handle << ", " << to_string(mode) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_acceleration_structure, cmd_list);
+	e.write_handle(source.handle);
+	e.write_handle(dest.handle);
+	e.write_uint(static_cast<uint32_t>(mode));
 
 	return false;
 }
-static bool on_build_acceleration_structure(command_list *, acceleration_structure_type type, acceleration_structure_build_flags flags, uint32_t input_count, const acceleration_structure_build_input *inputs, resource scratch, uint64_t scratch_offset, resource_view source, resource_view dest, acceleration_structure_build_mode mode)
+static bool on_build_acceleration_structure(command_list *cmd_list, acceleration_structure_type type, acceleration_structure_build_flags flags, uint32_t input_count, const acceleration_structure_build_input *inputs, resource scratch, uint64_t scratch_offset, resource_view source, resource_view dest, acceleration_structure_build_mode mode)
 {
 	if (!s_do_capture)
 		return false;
@@ -963,15 +975,20 @@ static bool on_build_acceleration_structure(command_list *, acceleration_structu
 	}
 #endif
 
-	std::stringstream s;
-	s << "build_acceleration_structure(" << to_string(type) << ", " << std::hex << static_cast<uint32_t>(flags) << std::dec << ", " << input_count << ", { ... }, " << (void *)scratch.handle << ", " << scratch_offset << ", " << (void *)source.handle << ", " << (void *)dest.handle << ", " << to_string(mode) << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::build_acceleration_structure, cmd_list);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_uint(static_cast<uint32_t>(flags));
+	e.write_uint(input_count);
+	e.write_handle(scratch.handle);
+	e.write_uint(scratch_offset);
+	e.write_handle(source.handle);
+	e.write_handle(dest.handle);
+	e.write_uint(static_cast<uint32_t>(mode));
 
 	return false;
 }
 
-static bool on_generate_mipmaps(command_list *, resource_view srv)
+static bool on_generate_mipmaps(command_list *cmd_list, resource_view srv)
 {
 	if (!s_do_capture)
 		return false;
@@ -983,10 +1000,8 @@ static bool on_generate_mipmaps(command_list *, resource_view srv)
 	}
 #endif
 
-	std::stringstream s;
-	s << "generate_mipmaps(" << (void *)srv.handle << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::generate_mipmaps, cmd_list);
+	e.write_handle(srv.handle);
 
 	return false;
 }
@@ -996,10 +1011,10 @@ static bool on_begin_query(command_list *cmd_list, query_heap heap, query_type t
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "begin_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::begin_query, cmd_list);
+	e.write_handle(heap.handle);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_uint(index);
 
 	return false;
 }
@@ -1008,10 +1023,10 @@ static bool on_end_query(command_list *cmd_list, query_heap heap, query_type typ
 	if (!s_do_capture)
 		return false;
 
-	std::stringstream s;
-	s << "end_query(" << (void *)heap.handle << ", " << to_string(type) << ", " << index << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::end_query, cmd_list);
+	e.write_handle(heap.handle);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_uint(index);
 
 	return false;
 }
@@ -1027,10 +1042,14 @@ static bool on_copy_query_heap_results(command_list *cmd_list, query_heap heap,
 	}
 #endif
 
-	std::stringstream s;
-	s << "copy_query_heap_results(" << (void *)heap.handle << ", " << to_string(type) << ", " << first << ", " << count << (void *)dest.handle << ", " << dest_offset << ", " << stride << ")";
-
-	reshade::log::message(reshade::log::level::info, s.str().c_str());
+	trace_event e(trace_event_type::copy_query_heap_results, cmd_list);
+	e.write_handle(heap.handle);
+	e.write_uint(static_cast<uint32_t>(type));
+	e.write_uint(first);
+	e.write_uint(count);
+	e.write_handle(dest.handle);
+	e.write_uint(dest_offset);
+	e.write_uint(stride);
 
 	return false;
 }
@@ -1039,23 +1058,22 @@ static void on_present(effect_runtime *runtime)
 {
 	if (s_do_capture)
 	{
-		reshade::log::message(reshade::log::level::info, "present()");
-		reshade::log::message(reshade::log::level::info, "--- End Frame ---");
-		s_do_capture = false;
+		trace_event(trace_event_type::present, nullptr).write_uint(s_frame_index++);
+
+		// Stop after the configured number of frames, or when the keyboard shortcut is pressed again
+		if ((s_capture_frame_count != 0 && s_frame_index >= s_capture_frame_count) || runtime->is_key_pressed(VK_F10))
+			stop_capture();
 	}
 	else
 	{
 		// The keyboard shortcut to trigger logging
 		if (runtime->is_key_pressed(VK_F10))
-		{
-			s_do_capture = true;
-			reshade::log::message(reshade::log::level::info, "--- Frame ---");
-		}
+			start_capture(runtime->get_device()->get_api());
 	}
 }
 
 extern "C" __declspec(dllexport) const char *NAME = "API Trace";
-extern "C" __declspec(dllexport) const char *DESCRIPTION = "Example add-on that logs the graphics API calls done by the application of the next frame after pressing a keyboard shortcut.";
+extern "C" __declspec(dllexport) const char *DESCRIPTION = "Example add-on that records the graphics API calls done by the application to a binary trace file after pressing a keyboard shortcut, which can be decoded again with the api_trace_viewer tool.";
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 {
@@ -1115,6 +1133,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::register_event<reshade::addon_event::reshade_present>(on_present);
 		break;
 	case DLL_PROCESS_DETACH:
+		if (s_do_capture)
+			stop_capture();
+
 		reshade::unregister_addon(hModule);
 		break;
 	}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Command-line tool that decodes a trace file written by the api_trace add-on
+// Usage: api_trace_viewer <trace file> [--stats]
+
+#include "trace_format.hpp"
+#include <cstdio>
+#include <cinttypes>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+using namespace api_trace;
+
+namespace
+{
+	struct trace_statistics
+	{
+		uint64_t event_counts[static_cast<size_t>(trace_event_type::max)] = {};
+		uint64_t chunk_count = 0;
+		uint64_t compressed_size = 0;
+		uint64_t uncompressed_size = 0;
+		uint64_t origin_timestamp = 0;
+		uint64_t first_timestamp = UINT64_MAX;
+		uint64_t last_timestamp = 0;
+	};
+
+	bool decode_arguments(trace_reader &reader, const char *signature_begin, const char *signature_end, std::string &out)
+	{
+		char temp[64];
+
+		for (const char *signature = signature_begin; signature < signature_end; ++signature)
+		{
+			if (signature != signature_begin)
+				out += ", ";
+
+			if (*signature == '[')
+			{
+				const char *const array_end = std::strchr(signature, ']');
+				if (array_end == nullptr)
+					return false;
+
+				uint64_t count;
+				if (!reader.read_varint(count))
+					return false;
+
+				out += "{ ";
+				for (uint64_t i = 0; i < count; ++i)
+				{
+					if (i != 0)
+						out += ", ";
+
+					// Group elements that consist of multiple values
+					const bool is_group = (array_end - signature) > 2;
+					if (is_group)
+						out += "{ ";
+					if (!decode_arguments(reader, signature + 1, array_end, out))
+						return false;
+					if (is_group)
+						out += " }";
+				}
+				out += " }";
+
+				signature = array_end;
+				continue;
+			}
+
+			switch (*signature)
+			{
+			case 'u':
+			{
+				uint64_t value;
+				if (!reader.read_varint(value))
+					return false;
+				out += std::to_string(value);
+				break;
+			}
+			case 'i':
+			{
+				int64_t value;
+				if (!reader.read_svarint(value))
+					return false;
+				out += std::to_string(value);
+				break;
+			}
+			case 'x':
+			{
+				uint64_t value;
+				if (!reader.read_varint(value))
+					return false;
+				std::snprintf(temp, sizeof(temp), "%" PRIx64, value);
+				out += temp;
+				break;
+			}
+			case 'h':
+			{
+				uint64_t value;
+				if (!reader.read_varint(value))
+					return false;
+				std::snprintf(temp, sizeof(temp), "0x%016" PRIX64, value);
+				out += temp;
+				break;
+			}
+			case 'f':
+			{
+				float value;
+				if (!reader.read_float(value))
+					return false;
+				std::snprintf(temp, sizeof(temp), "%g", value);
+				out += temp;
+				break;
+			}
+			default:
+			{
+				uint64_t value;
+				if (!reader.read_varint(value))
+					return false;
+				if (const char *const name = enum_to_string(*signature, value))
+					out += name;
+				else
+					out += std::to_string(value);
+				break;
+			}
+			}
+		}
+
+		return true;
+	}
+
+	bool decode_chunk(const trace_file_header &header, const trace_chunk_header &chunk, const std::vector<uint8_t> &data, bool print_events, trace_statistics &stats)
+	{
+		trace_reader reader(data.data(), data.size());
+		uint64_t timestamp = chunk.base_timestamp;
+
+		std::string out;
+		out.reserve(data.size() * 8);
+
+		while (!reader.at_end())
+		{
+			uint8_t type;
+			uint64_t timestamp_delta;
+			if (!reader.read_byte(type) || !reader.read_varint(timestamp_delta) || type >= static_cast<uint8_t>(trace_event_type::max))
+				return false;
+
+			timestamp += timestamp_delta;
+
+			stats.event_counts[type]++;
+			stats.first_timestamp = std::min(stats.first_timestamp, timestamp);
+			stats.last_timestamp = std::max(stats.last_timestamp, timestamp);
+
+			const auto &info = trace_event_infos[type];
+			const char *const signature_end = info.signature + std::strlen(info.signature);
+
+			if (!print_events)
+			{
+				std::string ignored;
+				if (!decode_arguments(reader, info.signature, signature_end, ignored))
+					return false;
+				continue;
+			}
+
+			char prefix[64];
+			std::snprintf(prefix, sizeof(prefix), "[%5u] %14.3f us | ", chunk.thread_id, static_cast<double>(static_cast<int64_t>(timestamp - stats.origin_timestamp)) * 1000000.0 / static_cast<double>(header.timestamp_frequency));
+			out += prefix;
+			out += info.name;
+			out += '(';
+			if (!decode_arguments(reader, info.signature, signature_end, out))
+				return false;
+			out += ")\n";
+
+			if (static_cast<trace_event_type>(type) == trace_event_type::present)
+				out += "--- End Frame ---\n";
+		}
+
+		std::fwrite(out.data(), 1, out.size(), stdout);
+
+		return true;
+	}
+
+	void print_statistics(const trace_statistics &stats, const trace_file_header &header)
+	{
+		const uint64_t frame_count = stats.event_counts[static_cast<size_t>(trace_event_type::present)];
+		const uint64_t draw_count =
+			stats.event_counts[static_cast<size_t>(trace_event_type::draw)] +
+			stats.event_counts[static_cast<size_t>(trace_event_type::draw_indexed)] +
+			stats.event_counts[static_cast<size_t>(trace_event_type::draw_or_dispatch_indirect)];
+		const double duration = stats.last_timestamp > stats.first_timestamp ? static_cast<double>(stats.last_timestamp - stats.first_timestamp) / static_cast<double>(header.timestamp_frequency) : 0.0;
+
+		std::printf("Device API: 0x%x\n", header.device_api);
+		std::printf("Duration: %.3f s\n", duration);
+		std::printf("Frames: %" PRIu64 "\n", frame_count);
+		std::printf("Chunks: %" PRIu64 " (%" PRIu64 " bytes stored, %" PRIu64 " bytes uncompressed)\n", stats.chunk_count, stats.compressed_size, stats.uncompressed_size);
+		if (frame_count != 0)
+			std::printf("Draw calls per frame: %.1f\n", static_cast<double>(draw_count) / static_cast<double>(frame_count));
+
+		std::printf("\n%-40s %12s %12s\n", "Event", "Count", frame_count != 0 ? "Per frame" : "");
+		for (size_t type = 0; type < static_cast<size_t>(trace_event_type::max); ++type)
+		{
+			if (stats.event_counts[type] == 0)
+				continue;
+
+			std::printf("%-40s %12" PRIu64, trace_event_infos[type].name, stats.event_counts[type]);
+			if (frame_count != 0)
+				std::printf(" %12.1f", static_cast<double>(stats.event_counts[type]) / static_cast<double>(frame_count));
+			std::printf("\n");
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <trace file> [--stats]\n", argv[0]);
+		return 1;
+	}
+
+	const bool print_events = !(argc > 2 && std::strcmp(argv[2], "--stats") == 0);
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		std::fprintf(stderr, "error: failed to open trace file '%s'\n", argv[1]);
+		return 1;
+	}
+
+	trace_file_header header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != trace_file_magic)
+	{
+		std::fprintf(stderr, "error: '%s' is not a trace file\n", argv[1]);
+		return 1;
+	}
+	if (header.version != trace_file_version)
+	{
+		std::fprintf(stderr, "error: unsupported trace file version %u\n", header.version);
+		return 1;
+	}
+	if (header.timestamp_frequency == 0)
+		header.timestamp_frequency = 1;
+
+	trace_statistics stats;
+	std::vector<uint8_t> stored_data;
+	std::vector<uint8_t> chunk_data;
+
+	for (trace_chunk_header chunk; file.read(reinterpret_cast<char *>(&chunk), sizeof(chunk));)
+	{
+		stored_data.resize(chunk.size);
+		if (chunk.size > chunk.uncompressed_size || !file.read(reinterpret_cast<char *>(stored_data.data()), chunk.size))
+		{
+			std::fprintf(stderr, "error: trace file is truncated\n");
+			return 1;
+		}
+
+		if (chunk.size < chunk.uncompressed_size)
+		{
+			chunk_data.resize(chunk.uncompressed_size);
+			if (!lz4_decompress_block(stored_data.data(), stored_data.size(), chunk_data.data(), chunk_data.size()))
+			{
+				std::fprintf(stderr, "error: failed to decompress chunk %" PRIu64 "\n", stats.chunk_count);
+				return 1;
+			}
+		}
+		else
+		{
+			chunk_data.swap(stored_data);
+		}
+
+		if (stats.chunk_count == 0)
+			stats.origin_timestamp = chunk.base_timestamp;
+
+		stats.chunk_count++;
+		stats.compressed_size += chunk.size;
+		stats.uncompressed_size += chunk.uncompressed_size;
+
+		if (!decode_chunk(header, chunk, chunk_data, print_events, stats))
+		{
+			std::fprintf(stderr, "error: failed to decode chunk %" PRIu64 "\n", stats.chunk_count - 1);
+			return 1;
+		}
+	}
+
+	if (!print_events)
+		print_statistics(stats, header);
+
+	return 0;
+}
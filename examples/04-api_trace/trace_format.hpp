@@ -0,0 +1,748 @@
+/*
+ * Copyright (C) 2021 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <reshade_api.hpp>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+// Binary trace format shared between the add-on, which writes it, and the viewer, which decodes it again
+//
+// A trace file starts with a 'trace_file_header', followed by any number of chunks. Each chunk starts with a 'trace_chunk_header', followed by the (optionally LZ4 block compressed) event data of a single thread.
+// Every event consists of a one byte 'trace_event_type', a varint with the timestamp delta to the previous event in the chunk and then its arguments as described by the signature in 'trace_event_infos'.
+// Chunks can be decoded independently, since the command list an event was recorded on is emitted again at the beginning of each chunk.
+
+namespace api_trace
+{
+	constexpr uint32_t trace_file_magic = 0x43525452; // 'RTRC'
+	constexpr uint16_t trace_file_version = 1;
+
+	/// <summary>
+	/// Size of the uncompressed event data after which a thread flushes its buffer to the trace file.
+	/// </summary>
+	constexpr size_t trace_chunk_size = 64 * 1024;
+
+	struct trace_file_header
+	{
+		uint32_t magic = trace_file_magic;
+		uint16_t version = trace_file_version;
+		uint16_t device_api = 0;
+		uint64_t timestamp_frequency = 0;
+	};
+	static_assert(sizeof(trace_file_header) == 16);
+
+	struct trace_chunk_header
+	{
+		uint32_t thread_id = 0;
+		/// <summary>
+		/// Size of the event data following this header in the file. This is the compressed size if it is smaller than <see cref="uncompressed_size"/>.
+		/// </summary>
+		uint32_t size = 0;
+		uint32_t uncompressed_size = 0;
+		uint32_t reserved = 0;
+		/// <summary>
+		/// Timestamp of the first event in this chunk, which the timestamp deltas of all events are relative to.
+		/// </summary>
+		uint64_t base_timestamp = 0;
+	};
+	static_assert(sizeof(trace_chunk_header) == 24);
+
+	enum class trace_event_type : uint8_t
+	{
+		command_list,
+		present,
+		barrier,
+		begin_render_pass,
+		end_render_pass,
+		bind_render_targets_and_depth_stencil,
+		bind_pipeline,
+		bind_pipeline_state,
+		bind_viewports,
+		bind_scissor_rects,
+		push_constants,
+		push_descriptors,
+		bind_descriptor_table,
+		bind_index_buffer,
+		bind_vertex_buffer,
+		draw,
+		draw_indexed,
+		dispatch,
+		dispatch_mesh,
+		dispatch_rays,
+		draw_or_dispatch_indirect,
+		copy_resource,
+		copy_buffer_region,
+		copy_buffer_to_texture,
+		copy_texture_region,
+		copy_texture_to_buffer,
+		resolve_texture_region,
+		clear_depth_stencil_view,
+		clear_render_target_view,
+		clear_unordered_access_view_uint,
+		clear_unordered_access_view_float,
+		copy_acceleration_structure,
+		build_acceleration_structure,
+		generate_mipmaps,
+		begin_query,
+		end_query,
+		copy_query_heap_results,
+
+		max
+	};
+
+	/// <summary>
+	/// Name and argument signature of each event type.
+	/// The signature uses one character per argument:
+	/// <list type="bullet">
+	/// <item><description>'u' is an unsigned integer, 'i' a signed integer and 'x' an unsigned integer that is displayed in hexadecimal (all stored as varints).</description></item>
+	/// <item><description>'h' is an object handle (stored as varint).</description></item>
+	/// <item><description>'f' is a 32-bit floating-point value (stored as raw 4 bytes).</description></item>
+	/// <item><description>'S', 'P', 'D', 'Y', 'R', 'I', 'Q', 'A', 'C' and 'B' are enumeration values (stored as varints), see <see cref="enum_to_string"/>.</description></item>
+	/// <item><description>'[' starts an array: a varint count is followed by that many repetitions of all arguments up to the closing ']'.</description></item>
+	/// </list>
+	/// </summary>
+	constexpr struct { const char *name; const char *signature; } trace_event_infos[] = {
+		{ "command_list", "h" },
+		{ "present", "u" },
+		{ "barrier", "hRR" },
+		{ "begin_render_pass", "[h]h" },
+		{ "end_render_pass", "" },
+		{ "bind_render_targets_and_depth_stencil", "[h]h" },
+		{ "bind_pipeline", "Ph" },
+		{ "bind_pipeline_state", "Yu" },
+		{ "bind_viewports", "u[ffffff]" },
+		{ "bind_scissor_rects", "u[iiii]" },
+		{ "push_constants", "Shuu[x]" },
+		{ "push_descriptors", "ShuDuu" },
+		{ "bind_descriptor_table", "Shuh" },
+		{ "bind_index_buffer", "huu" },
+		{ "bind_vertex_buffer", "uhuu" },
+		{ "draw", "uuuu" },
+		{ "draw_indexed", "uuuiu" },
+		{ "dispatch", "uuu" },
+		{ "dispatch_mesh", "uuu" },
+		{ "dispatch_rays", "huuhuuuhuuuhuuuuuu" },
+		{ "draw_or_dispatch_indirect", "Ihuuu" },
+		{ "copy_resource", "hh" },
+		{ "copy_buffer_region", "huhuu" },
+		{ "copy_buffer_to_texture", "huuuhu" },
+		{ "copy_texture_region", "huhuu" },
+		{ "copy_texture_to_buffer", "huhuuu" },
+		{ "resolve_texture_region", "huhuuuuu" },
+		{ "clear_depth_stencil_view", "hfu" },
+		{ "clear_render_target_view", "hffff" },
+		{ "clear_unordered_access_view_uint", "huuuu" },
+		{ "clear_unordered_access_view_float", "hffff" },
+		{ "copy_acceleration_structure", "hhC" },
+		{ "build_acceleration_structure", "AxuhuhhB" },
+		{ "generate_mipmaps", "h" },
+		{ "begin_query", "hQu" },
+		{ "end_query", "hQu" },
+		{ "copy_query_heap_results", "hQuuhuu" },
+	};
+	static_assert(std::size(trace_event_infos) == static_cast<size_t>(trace_event_type::max));
+
+	/// <summary>
+	/// Appends an unsigned LEB128 varint to the specified buffer.
+	/// </summary>
+	inline void write_varint(std::vector<uint8_t> &data, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back(static_cast<uint8_t>(value) | 0x80);
+			value >>= 7;
+		}
+		data.push_back(static_cast<uint8_t>(value));
+	}
+	/// <summary>
+	/// Appends a zigzag encoded signed varint to the specified buffer.
+	/// </summary>
+	inline void write_svarint(std::vector<uint8_t> &data, int64_t value)
+	{
+		write_varint(data, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+	}
+	inline void write_float(std::vector<uint8_t> &data, float value)
+	{
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(value));
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	/// <summary>
+	/// Helper class to read the values written with <see cref="write_varint"/> and friends back from a buffer, with bounds checking.
+	/// </summary>
+	class trace_reader
+	{
+	public:
+		trace_reader(const uint8_t *data, size_t size) : _ptr(data), _end(data + size) {}
+
+		bool at_end() const { return _ptr >= _end; }
+
+		bool read_byte(uint8_t &value)
+		{
+			if (_ptr >= _end)
+				return false;
+			value = *_ptr++;
+			return true;
+		}
+		bool read_varint(uint64_t &value)
+		{
+			value = 0;
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				uint8_t byte;
+				if (!read_byte(byte))
+					return false;
+				value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+		bool read_svarint(int64_t &value)
+		{
+			uint64_t zigzag;
+			if (!read_varint(zigzag))
+				return false;
+			value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+			return true;
+		}
+		bool read_float(float &value)
+		{
+			if (static_cast<size_t>(_end - _ptr) < sizeof(value))
+				return false;
+			std::memcpy(&value, _ptr, sizeof(value));
+			_ptr += sizeof(value);
+			return true;
+		}
+
+	private:
+		const uint8_t *_ptr, *_end;
+	};
+
+	/// <summary>
+	/// Returns the maximum size the output of <see cref="lz4_compress_block"/> can have for an input of the specified size.
+	/// </summary>
+	constexpr size_t lz4_compress_bound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	/// <summary>
+	/// Compresses data into a raw LZ4 block (without frame header), so that it can be decompressed with any LZ4 implementation (e.g. 'LZ4_decompress_safe').
+	/// This uses a simple single-probe hash table, which favors speed over compression ratio, since it runs on the render threads.
+	/// </summary>
+	/// <param name="dst">Output buffer, which has to be at least <see cref="lz4_compress_bound"/> bytes large.</param>
+	/// <returns>Size of the compressed block in bytes.</returns>
+	inline size_t lz4_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst)
+	{
+		constexpr size_t min_match = 4;
+		constexpr size_t last_literals = 5; // The last five bytes of a block are always literals
+		constexpr size_t match_start_limit = 12; // The last match must start at least twelve bytes before the end of a block
+		constexpr unsigned int hash_bits = 12;
+
+		uint32_t hash_table[1 << hash_bits] = {}; // Stores position plus one, so that zero means empty
+
+		const auto read32 = [src](size_t pos) { uint32_t value; std::memcpy(&value, src + pos, sizeof(value)); return value; };
+		const auto write_length = [&dst](size_t length) {
+			for (; length >= 255; length -= 255)
+				*dst++ = 255;
+			*dst++ = static_cast<uint8_t>(length);
+		};
+
+		uint8_t *const dst_begin = dst;
+		size_t pos = 0;
+		size_t anchor = 0;
+
+		const auto write_sequence = [&](size_t match_offset, size_t match_length) {
+			const size_t literal_length = pos - anchor;
+
+			uint8_t &token = *dst++;
+			token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+			if (literal_length >= 15)
+				write_length(literal_length - 15);
+			std::memcpy(dst, src + anchor, literal_length);
+			dst += literal_length;
+
+			if (match_length == 0)
+				return; // Final sequence only consists of literals
+
+			*dst++ = static_cast<uint8_t>(match_offset);
+			*dst++ = static_cast<uint8_t>(match_offset >> 8);
+
+			match_length -= min_match;
+			token |= static_cast<uint8_t>(match_length >= 15 ? 15 : match_length);
+			if (match_length >= 15)
+				write_length(match_length - 15);
+		};
+
+		if (src_size > match_start_limit)
+		{
+			const size_t match_end_limit = src_size - last_literals;
+
+			while (pos < src_size - match_start_limit)
+			{
+				const uint32_t sequence = read32(pos);
+				uint32_t &entry = hash_table[(sequence * 2654435761u) >> (32 - hash_bits)];
+				const size_t ref = entry;
+				entry = static_cast<uint32_t>(pos + 1);
+
+				if (ref == 0 || pos - (ref - 1) > 0xFFFF || read32(ref - 1) != sequence)
+				{
+					++pos;
+					continue;
+				}
+
+				size_t match_length = min_match;
+				while (pos + match_length < match_end_limit && src[ref - 1 + match_length] == src[pos + match_length])
+					++match_length;
+
+				write_sequence(pos - (ref - 1), match_length);
+
+				pos += match_length;
+				anchor = pos;
+			}
+		}
+
+		pos = src_size;
+		write_sequence(0, 0);
+
+		return static_cast<size_t>(dst - dst_begin);
+	}
+
+	/// <summary>
+	/// Decompresses a raw LZ4 block.
+	/// </summary>
+	/// <param name="dst">Output buffer, which has to be exactly the size of the uncompressed data.</param>
+	/// <returns><see langword="true"/> if the block was decompressed successfully and filled the output buffer completely, <see langword="false"/> if it is malformed.</returns>
+	inline bool lz4_decompress_block(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+	{
+		const uint8_t *const src_end = src + src_size;
+		uint8_t *const dst_begin = dst;
+		uint8_t *const dst_end = dst + dst_size;
+
+		const auto read_length = [&src, src_end](size_t &length) {
+			uint8_t byte;
+			do
+			{
+				if (src >= src_end)
+					return false;
+				byte = *src++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (src < src_end)
+		{
+			const uint8_t token = *src++;
+
+			size_t literal_length = token >> 4;
+			if (literal_length == 15 && !read_length(literal_length))
+				return false;
+			if (literal_length > static_cast<size_t>(src_end - src) || literal_length > static_cast<size_t>(dst_end - dst))
+				return false;
+			std::memcpy(dst, src, literal_length);
+			src += literal_length;
+			dst += literal_length;
+
+			if (src >= src_end)
+				break; // Last sequence has no match
+
+			if (src_end - src < 2)
+				return false;
+			const size_t match_offset = src[0] | (src[1] << 8);
+			src += 2;
+			if (match_offset == 0 || match_offset > static_cast<size_t>(dst - dst_begin))
+				return false;
+
+			size_t match_length = token & 0xF;
+			if (match_length == 15 && !read_length(match_length))
+				return false;
+			match_length += 4;
+			if (match_length > static_cast<size_t>(dst_end - dst))
+				return false;
+
+			// Copy byte by byte, since the match may overlap the output (e.g. for runs)
+			for (const uint8_t *match = dst - match_offset; match_length != 0; --match_length)
+				*dst++ = *match++;
+		}
+
+		return dst == dst_end;
+	}
+
+	using namespace reshade::api;
+
+	inline auto to_string(shader_stage value)
+	{
+		switch (value)
+		{
+		case shader_stage::vertex:
+			return "vertex";
+		case shader_stage::hull:
+			return "hull";
+		case shader_stage::domain:
+			return "domain";
+		case shader_stage::geometry:
+			return "geometry";
+		case shader_stage::pixel:
+			return "pixel";
+		case shader_stage::compute:
+			return "compute";
+		case shader_stage::amplification:
+			return "amplification";
+		case shader_stage::mesh:
+			return "mesh";
+		case shader_stage::raygen:
+			return "raygen";
+		case shader_stage::any_hit:
+			return "any_hit";
+		case shader_stage::closest_hit:
+			return "closest_hit";
+		case shader_stage::miss:
+			return "miss";
+		case shader_stage::intersection:
+			return "intersection";
+		case shader_stage::callable:
+			return "callable";
+		case shader_stage::all:
+			return "all";
+		case shader_stage::all_graphics:
+			return "all_graphics";
+		case shader_stage::all_ray_tracing:
+			return "all_raytracing";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(pipeline_stage value)
+	{
+		switch (value)
+		{
+		case pipeline_stage::vertex_shader:
+			return "vertex_shader";
+		case pipeline_stage::hull_shader:
+			return "hull_shader";
+		case pipeline_stage::domain_shader:
+			return "domain_shader";
+		case pipeline_stage::geometry_shader:
+			return "geometry_shader";
+		case pipeline_stage::pixel_shader:
+			return "pixel_shader";
+		case pipeline_stage::compute_shader:
+			return "compute_shader";
+		case pipeline_stage::amplification_shader:
+			return "amplification_shader";
+		case pipeline_stage::mesh_shader:
+			return "mesh_shader";
+		case pipeline_stage::input_assembler:
+			return "input_assembler";
+		case pipeline_stage::stream_output:
+			return "stream_output";
+		case pipeline_stage::rasterizer:
+			return "rasterizer";
+		case pipeline_stage::depth_stencil:
+			return "depth_stencil";
+		case pipeline_stage::output_merger:
+			return "output_merger";
+		case pipeline_stage::all:
+			return "all";
+		case pipeline_stage::all_graphics:
+			return "all_graphics";
+		case pipeline_stage::all_ray_tracing:
+			return "all_ray_tracing";
+		case pipeline_stage::all_shader_stages:
+			return "all_shader_stages";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(descriptor_type value)
+	{
+		switch (value)
+		{
+		case descriptor_type::sampler:
+			return "sampler";
+		case descriptor_type::sampler_with_resource_view:
+			return "sampler_with_resource_view";
+		case descriptor_type::shader_resource_view:
+			return "shader_resource_view";
+		case descriptor_type::unordered_access_view:
+			return "unordered_access_view";
+		case descriptor_type::constant_buffer:
+			return "constant_buffer";
+		case descriptor_type::acceleration_structure:
+			return "acceleration_structure";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(dynamic_state value)
+	{
+		switch (value)
+		{
+		default:
+		case dynamic_state::unknown:
+			return "unknown";
+		case dynamic_state::alpha_test_enable:
+			return "alpha_test_enable";
+		case dynamic_state::alpha_reference_value:
+			return "alpha_reference_value";
+		case dynamic_state::alpha_func:
+			return "alpha_func";
+		case dynamic_state::srgb_write_enable:
+			return "srgb_write_enable";
+		case dynamic_state::primitive_topology:
+			return "primitive_topology";
+		case dynamic_state::sample_mask:
+			return "sample_mask";
+		case dynamic_state::alpha_to_coverage_enable:
+			return "alpha_to_coverage_enable";
+		case dynamic_state::blend_enable:
+			return "blend_enable";
+		case dynamic_state::logic_op_enable:
+			return "logic_op_enable";
+		case dynamic_state::color_blend_op:
+			return "color_blend_op";
+		case dynamic_state::source_color_blend_factor:
+			return "src_color_blend_factor";
+		case dynamic_state::dest_color_blend_factor:
+			return "dst_color_blend_factor";
+		case dynamic_state::alpha_blend_op:
+			return "alpha_blend_op";
+		case dynamic_state::source_alpha_blend_factor:
+			return "src_alpha_blend_factor";
+		case dynamic_state::dest_alpha_blend_factor:
+			return "dst_alpha_blend_factor";
+		case dynamic_state::logic_op:
+			return "logic_op";
+		case dynamic_state::blend_constant:
+			return "blend_constant";
+		case dynamic_state::render_target_write_mask:
+			return "render_target_write_mask";
+		case dynamic_state::fill_mode:
+			return "fill_mode";
+		case dynamic_state::cull_mode:
+			return "cull_mode";
+		case dynamic_state::front_counter_clockwise:
+			return "front_counter_clockwise";
+		case dynamic_state::depth_bias:
+			return "depth_bias";
+		case dynamic_state::depth_bias_clamp:
+			return "depth_bias_clamp";
+		case dynamic_state::depth_bias_slope_scaled:
+			return "depth_bias_slope_scaled";
+		case dynamic_state::depth_clip_enable:
+			return "depth_clip_enable";
+		case dynamic_state::scissor_enable:
+			return "scissor_enable";
+		case dynamic_state::multisample_enable:
+			return "multisample_enable";
+		case dynamic_state::antialiased_line_enable:
+			return "antialiased_line_enable";
+		case dynamic_state::depth_enable:
+			return "depth_enable";
+		case dynamic_state::depth_write_mask:
+			return "depth_write_mask";
+		case dynamic_state::depth_func:
+			return "depth_func";
+		case dynamic_state::stencil_enable:
+			return "stencil_enable";
+		case dynamic_state::front_stencil_read_mask:
+			return "front_stencil_read_mask";
+		case dynamic_state::front_stencil_write_mask:
+			return "front_stencil_write_mask";
+		case dynamic_state::front_stencil_reference_value:
+			return "front_stencil_reference_value";
+		case dynamic_state::front_stencil_func:
+			return "front_stencil_func";
+		case dynamic_state::front_stencil_pass_op:
+			return "front_stencil_pass_op";
+		case dynamic_state::front_stencil_fail_op:
+			return "front_stencil_fail_op";
+		case dynamic_state::front_stencil_depth_fail_op:
+			return "front_stencil_depth_fail_op";
+		case dynamic_state::back_stencil_read_mask:
+			return "back_stencil_read_mask";
+		case dynamic_state::back_stencil_write_mask:
+			return "back_stencil_write_mask";
+		case dynamic_state::back_stencil_reference_value:
+			return "back_stencil_reference_value";
+		case dynamic_state::back_stencil_func:
+			return "back_stencil_func";
+		case dynamic_state::back_stencil_pass_op:
+			return "back_stencil_pass_op";
+		case dynamic_state::back_stencil_fail_op:
+			return "back_stencil_fail_op";
+		case dynamic_state::back_stencil_depth_fail_op:
+			return "back_stencil_depth_fail_op";
+		}
+	}
+	inline auto to_string(resource_usage value)
+	{
+		switch (value)
+		{
+		default:
+		case resource_usage::undefined:
+			return "undefined";
+		case resource_usage::index_buffer:
+			return "index_buffer";
+		case resource_usage::vertex_buffer:
+			return "vertex_buffer";
+		case resource_usage::constant_buffer:
+			return "constant_buffer";
+		case resource_usage::stream_output:
+			return "stream_output";
+		case resource_usage::indirect_argument:
+			return "indirect_argument";
+		case resource_usage::depth_stencil:
+		case resource_usage::depth_stencil_read:
+		case resource_usage::depth_stencil_write:
+			return "depth_stencil";
+		case resource_usage::render_target:
+			return "render_target";
+		case resource_usage::shader_resource:
+		case resource_usage::shader_resource_pixel:
+		case resource_usage::shader_resource_non_pixel:
+			return "shader_resource";
+		case resource_usage::unordered_access:
+			return "unordered_access";
+		case resource_usage::copy_dest:
+			return "copy_dest";
+		case resource_usage::copy_source:
+			return "copy_source";
+		case resource_usage::resolve_dest:
+			return "resolve_dest";
+		case resource_usage::resolve_source:
+			return "resolve_source";
+		case resource_usage::acceleration_structure:
+			return "acceleration_structure";
+		case resource_usage::general:
+			return "general";
+		case resource_usage::present:
+			return "present";
+		case resource_usage::cpu_access:
+			return "cpu_access";
+		}
+	}
+	inline auto to_string(indirect_command value)
+	{
+		switch (value)
+		{
+		case indirect_command::draw:
+			return "draw";
+		case indirect_command::draw_indexed:
+			return "draw_indexed";
+		case indirect_command::dispatch:
+			return "dispatch";
+		case indirect_command::dispatch_mesh:
+			return "dispatch_mesh";
+		case indirect_command::dispatch_rays:
+			return "dispatch_rays";
+		default:
+		case indirect_command::unknown:
+			return "unknown";
+		}
+	}
+	inline auto to_string(query_type value)
+	{
+		switch (value)
+		{
+		case query_type::occlusion:
+			return "occlusion";
+		case query_type::binary_occlusion:
+			return "binary_occlusion";
+		case query_type::timestamp:
+			return "timestamp";
+		case query_type::pipeline_statistics:
+			return "pipeline_statistics";
+		case query_type::stream_output_statistics_0:
+			return "stream_output_statistics_0";
+		case query_type::stream_output_statistics_1:
+			return "stream_output_statistics_1";
+		case query_type::stream_output_statistics_2:
+			return "stream_output_statistics_2";
+		case query_type::stream_output_statistics_3:
+			return "stream_output_statistics_3";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(acceleration_structure_type value)
+	{
+		switch (value)
+		{
+		case acceleration_structure_type::top_level:
+			return "top_level";
+		case acceleration_structure_type::bottom_level:
+			return "bottom_level";
+		default:
+		case acceleration_structure_type::generic:
+			return "generic";
+		}
+	}
+	inline auto to_string(acceleration_structure_copy_mode value)
+	{
+		switch (value)
+		{
+		case acceleration_structure_copy_mode::clone:
+			return "clone";
+		case acceleration_structure_copy_mode::compact:
+			return "compact";
+		case acceleration_structure_copy_mode::serialize:
+			return "serialize";
+		case acceleration_structure_copy_mode::deserialize:
+			return "deserialize";
+		default:
+			return "unknown";
+		}
+	}
+	inline auto to_string(acceleration_structure_build_mode value)
+	{
+		switch (value)
+		{
+		case acceleration_structure_build_mode::build:
+			return "build";
+		case acceleration_structure_build_mode::update:
+			return "update";
+		default:
+			return "unknown";
+		}
+	}
+
+	/// <summary>
+	/// Converts an enumeration argument of an event to a string, based on its signature character in <see cref="trace_event_infos"/>.
+	/// </summary>
+	inline const char *enum_to_string(char signature, uint64_t value)
+	{
+		switch (signature)
+		{
+		case 'S':
+			return to_string(static_cast<shader_stage>(value));
+		case 'P':
+			return to_string(static_cast<pipeline_stage>(value));
+		case 'D':
+			return to_string(static_cast<descriptor_type>(value));
+		case 'Y':
+			return to_string(static_cast<dynamic_state>(value));
+		case 'R':
+			return to_string(static_cast<resource_usage>(value));
+		case 'I':
+			return to_string(static_cast<indirect_command>(value));
+		case 'Q':
+			return to_string(static_cast<query_type>(value));
+		case 'A':
+			return to_string(static_cast<acceleration_structure_type>(value));
+		case 'C':
+			return to_string(static_cast<acceleration_structure_copy_mode>(value));
+		case 'B':
+			return to_string(static_cast<acceleration_structure_build_mode>(value));
+		default:
+			return nullptr;
+		}
+	}
+}
@@ -19,7 +19,7 @@ static void save_shader_code(device_api device_type, const shader_desc &desc)
 	if (desc.code_size == 0)
 		return;
 
-	uint32_t shader_hash = compute_crc32(static_cast<const uint8_t *>(desc.code), desc.code_size);
+	uint32_t shader_hash = compute_hash(static_cast<const uint8_t *>(desc.code), desc.code_size);
 
 	const wchar_t *extension = L".cso";
 	if (device_type == device_api::vulkan || (device_type == device_api::opengl && desc.code_size > sizeof(uint32_t) && *static_cast<const uint32_t *>(desc.code) == SPIRV_MAGIC))
@@ -6,6 +6,7 @@
 #include <reshade.hpp>
 #include "config.hpp"
 #include "crc32_hash.hpp"
+#include "replace_archive.hpp"
 #include <cstring>
 #include <fstream>
 #include <filesystem>
@@ -16,12 +17,28 @@ constexpr uint32_t SPIRV_MAGIC = 0x07230203;
 
 static thread_local std::vector<std::vector<uint8_t>> s_data_to_delete;
 
+static const replace_archive &get_replace_archive()
+{
+	static const replace_archive archive([]() {
+		// Prepend executable directory to archive file
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+
+		std::filesystem::path archive_path = file_prefix;
+		archive_path  = archive_path.parent_path();
+		archive_path /= RESHADE_ADDON_SHADER_LOAD_ARCHIVE;
+		return archive_path;
+	}(), RESHADE_ADDON_HASH_MODE);
+
+	return archive;
+}
+
 static bool load_shader_code(device_api device_type, shader_desc &desc, std::vector<std::vector<uint8_t>> &data_to_delete)
 {
 	if (desc.code_size == 0)
 		return false;
 
-	uint32_t shader_hash = compute_crc32(static_cast<const uint8_t *>(desc.code), desc.code_size);
+	uint32_t shader_hash = compute_hash(static_cast<const uint8_t *>(desc.code), desc.code_size);
 
 	const wchar_t *extension = L".cso";
 	if (device_type == device_api::vulkan || (device_type == device_api::opengl && desc.code_size > sizeof(uint32_t) && *static_cast<const uint32_t *>(desc.code) == SPIRV_MAGIC))
@@ -29,6 +46,20 @@ static bool load_shader_code(device_api device_type, shader_desc &desc, std::vec
 	else if (device_type == device_api::opengl)
 		extension = desc.code_size > 5 && std::strncmp(static_cast<const char *>(desc.code), "!!ARB", 5) == 0 ? L".txt" : L".glsl"; // OpenGL otherwise uses plain text ARB assembly language or GLSL
 
+	// Prefer the packed archive if there is one, which only needs a binary search instead of a file system probe per shader
+	if (const replace_archive &archive = get_replace_archive(); archive.is_open())
+	{
+		const uint8_t *shader_code = nullptr;
+		size_t shader_code_size = 0;
+		if (!archive.find(shader_hash, replace_archive_type(extension), shader_code, shader_code_size))
+			return false;
+
+		// Shader code can be used straight from the mapping, since that stays alive until the add-on is unloaded
+		desc.code = shader_code;
+		desc.code_size = shader_code_size;
+		return true;
+	}
+
 	// Prepend executable file name to image files
 	wchar_t file_prefix[MAX_PATH] = L"";
 	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
@@ -5,11 +5,193 @@
 
 #include <reshade.hpp>
 #include "config.hpp"
+#include <deque>
+#include <string>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <unordered_set>
+#include <condition_variable>
 
 using namespace reshade::api;
 
 // See implementation in 'utils\save_texture_image.cpp'
-extern bool save_texture_image(const resource_desc &desc, const subresource_data &data);
+extern uint32_t compute_texture_hash(const resource_desc &desc, const subresource_data &data);
+extern size_t compute_texture_data_size(const resource_desc &desc, const subresource_data &data);
+extern bool save_texture_image(const resource_desc &desc, const subresource_data &data, uint32_t hash);
+
+// Hashing and encoding a texture takes far longer than creating it, so the application thread only copies the texture data into a queue, which is then worked off by background threads
+class texture_dump_queue
+{
+public:
+	void start()
+	{
+		const std::unique_lock<std::mutex> lock(_mutex);
+
+		if (++_device_count != 1)
+			return;
+
+		load_existing_hashes();
+
+		unsigned int thread_count = RESHADE_ADDON_TEXTURE_SAVE_THREAD_COUNT;
+		if (thread_count == 0)
+			thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		_stopping = false;
+		for (unsigned int i = 0; i < thread_count; ++i)
+			_threads.emplace_back(&texture_dump_queue::worker_main, this);
+	}
+	void stop()
+	{
+		std::vector<std::thread> threads;
+		{
+			const std::unique_lock<std::mutex> lock(_mutex);
+
+			if (_device_count == 0 || --_device_count != 0)
+				return;
+
+			// Workers only exit once the queue is empty, so any textures that are still pending are written before returning
+			_stopping = true;
+			threads.swap(_threads);
+		}
+
+		_work_condition.notify_all();
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	void push(const resource_desc &desc, const subresource_data &data)
+	{
+		const size_t size = compute_texture_data_size(desc, data);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		if (_threads.empty())
+		{
+			// Save synchronously if there are no background threads (e.g. for textures created before the device was initialized)
+			lock.unlock();
+			save(desc, data);
+			return;
+		}
+
+		// Apply back pressure when the background threads cannot keep up, so that memory usage stays bounded (but always accept at least one texture, in case it is larger than the limit on its own)
+		_space_condition.wait(lock, [this, size]() { return _queue.empty() || _queued_bytes + size <= max_queued_bytes; });
+
+		dump_request &request = _queue.emplace_back();
+		request.desc = desc;
+		request.row_pitch = data.row_pitch;
+		request.slice_pitch = data.slice_pitch;
+		request.data.assign(static_cast<const uint8_t *>(data.data), static_cast<const uint8_t *>(data.data) + size);
+		_queued_bytes += size;
+
+		lock.unlock();
+
+		_work_condition.notify_one();
+	}
+
+private:
+	struct dump_request
+	{
+		resource_desc desc;
+		uint32_t row_pitch;
+		uint32_t slice_pitch;
+		std::vector<uint8_t> data;
+	};
+
+	static constexpr size_t max_queued_bytes = static_cast<size_t>(RESHADE_ADDON_TEXTURE_SAVE_QUEUE_SIZE) * 1024 * 1024;
+
+	void worker_main()
+	{
+		while (true)
+		{
+			dump_request request;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_work_condition.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+
+				if (_queue.empty())
+					return;
+
+				request = std::move(_queue.front());
+				_queue.pop_front();
+				_queued_bytes -= request.data.size();
+			}
+
+			_space_condition.notify_all();
+
+			subresource_data data;
+			data.data = request.data.data();
+			data.row_pitch = request.row_pitch;
+			data.slice_pitch = request.slice_pitch;
+
+			save(request.desc, data);
+		}
+	}
+
+	void save(const resource_desc &desc, const subresource_data &data)
+	{
+		const uint32_t hash = compute_texture_hash(desc, data);
+
+		// Claim the hash before encoding, so that no other thread writes the same texture concurrently
+		{
+			const std::unique_lock<std::mutex> lock(_hash_mutex);
+			if (!_written_hashes.insert(hash).second)
+				return;
+		}
+
+		if (!save_texture_image(desc, data, hash))
+		{
+			const std::unique_lock<std::mutex> lock(_hash_mutex);
+			_written_hashes.erase(hash);
+		}
+	}
+
+	void load_existing_hashes()
+	{
+		// The dump directory itself is the persistent record of which textures were already written, so that restarting the application does not encode them all again
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+
+		std::filesystem::path dump_path = file_prefix;
+		dump_path  = dump_path.parent_path();
+		dump_path /= RESHADE_ADDON_TEXTURE_SAVE_DIR;
+
+		const std::unique_lock<std::mutex> lock(_hash_mutex);
+
+		std::error_code ec;
+		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dump_path, ec))
+		{
+			if (entry.path().extension() != RESHADE_ADDON_TEXTURE_SAVE_FORMAT)
+				continue;
+
+			const std::wstring file_name = entry.path().stem().wstring();
+			wchar_t *hash_end = nullptr;
+			const unsigned long hash = std::wcstoul(file_name.c_str(), &hash_end, 16);
+			if (file_name.size() == 10 && file_name.compare(0, 2, L"0x") == 0 && hash_end == file_name.c_str() + file_name.size())
+				_written_hashes.insert(static_cast<uint32_t>(hash));
+		}
+
+		if (!_written_hashes.empty())
+			reshade::log::message(reshade::log::level::info, ("Skipping " + std::to_string(_written_hashes.size()) + " textures that were already dumped previously.").c_str());
+	}
+
+	std::mutex _mutex;
+	std::condition_variable _work_condition;
+	std::condition_variable _space_condition;
+	std::deque<dump_request> _queue;
+	size_t _queued_bytes = 0;
+	bool _stopping = false;
+	unsigned int _device_count = 0;
+	std::vector<std::thread> _threads;
+
+	std::mutex _hash_mutex;
+	std::unordered_set<uint32_t> _written_hashes;
+};
+
+static texture_dump_queue s_dump_queue;
 
 // There are multiple different ways textures can be initialized, so try and intercept them all
 // - Via initial data provided during texture creation (e.g. for immutable textures, common in D3D11 and OpenGL): See 'on_init_texture' implementation below
@@ -43,12 +225,21 @@ static inline bool filter_texture(device *device, const resource_desc &desc, con
 	return true;
 }
 
+static void on_init_device(device *)
+{
+	s_dump_queue.start();
+}
+static void on_destroy_device(device *)
+{
+	s_dump_queue.stop();
+}
+
 static void on_init_texture(device *device, const resource_desc &desc, const subresource_data *initial_data, resource_usage, resource)
 {
 	if (initial_data == nullptr || !filter_texture(device, desc, nullptr))
 		return;
 
-	save_texture_image(desc, *initial_data);
+	s_dump_queue.push(desc, *initial_data);
 }
 static bool on_update_texture(device *device, const subresource_data &data, resource dst, uint32_t dst_subresource, const subresource_box *dst_box)
 {
@@ -59,7 +250,7 @@ static bool on_update_texture(device *device, const subresource_data &data, reso
 	if (!filter_texture(device, dst_desc, dst_box))
 		return false;
 
-	save_texture_image(dst_desc, data);
+	s_dump_queue.push(dst_desc, data);
 
 	return false;
 }
@@ -90,7 +281,7 @@ static bool on_copy_buffer_to_texture(command_list *cmd_list, resource src, uint
 			mapped_data.row_pitch = (mapped_data.row_pitch + 255) & ~255;
 		mapped_data.slice_pitch = format_slice_pitch(dst_desc.texture.format, mapped_data.row_pitch, slice_height != 0 ? slice_height : dst_desc.texture.height);
 
-		save_texture_image(dst_desc, mapped_data);
+		s_dump_queue.push(dst_desc, mapped_data);
 
 		device->unmap_buffer_region(src);
 	}
@@ -125,7 +316,7 @@ static void on_unmap_texture(device *, resource resource, uint32_t subresource)
 
 	s_current_mapping.res = { 0 };
 
-	save_texture_image(s_current_mapping.desc, s_current_mapping.data);
+	s_dump_queue.push(s_current_mapping.desc, s_current_mapping.data);
 }
 
 extern "C" __declspec(dllexport) const char *NAME = "Texture Dump";
@@ -138,6 +329,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	case DLL_PROCESS_ATTACH:
 		if (!reshade::register_addon(hModule))
 			return FALSE;
+		reshade::register_event<reshade::addon_event::init_device>(on_init_device);
+		reshade::register_event<reshade::addon_event::destroy_device>(on_destroy_device);
 		reshade::register_event<reshade::addon_event::init_resource>(on_init_texture);
 		reshade::register_event<reshade::addon_event::update_texture_region>(on_update_texture);
 		reshade::register_event<reshade::addon_event::copy_buffer_to_texture>(on_copy_buffer_to_texture);
@@ -42,6 +42,10 @@ static aspect_ratio_heuristic s_aspect_ratio_heuristic = aspect_ratio_heuristic:
 // Enable or disable the format check from 'check_depth_format' in the detection heuristic
 static unsigned int s_format_filtering = 0;
 static unsigned int s_custom_resolution_filtering[2] = {};
+// Pin the first suitable depth-stencil created on the device (in D3D9 this is the auto depth-stencil created alongside the device) instead of selecting one from draw statistics
+// This also disables all per-draw state tracking, so only takes effect after a restart
+static bool s_pin_depth_buffer = false;
+static bool s_pin_depth_buffer_after_restart = false;
 
 enum class clear_op : uint8_t
 {
@@ -214,6 +218,9 @@ struct __declspec(uuid("e006e162-33ac-4b9f-b10f-0e15335c7bdb")) generic_depth_de
 	// List of depth-stencils that should be tracked throughout each frame and potentially be backed up during clear operations
 	std::vector<depth_stencil_backup> depth_stencil_backups;
 
+	// The depth-stencil that was pinned at creation time when depth buffer pinning is enabled
+	resource pinned_depth_stencil = { 0 };
+
 	depth_stencil_backup *find_depth_stencil_backup(resource resource)
 	{
 		for (depth_stencil_backup &backup : depth_stencil_backups)
@@ -303,6 +310,27 @@ struct __declspec(uuid("e006e162-33ac-4b9f-b10f-0e15335c7bdb")) generic_depth_de
 		}
 	}
 
+	void destroy_expired_backups(device *device)
+	{
+		// Destroy resources that were enqueued for delayed destruction and have reached the targeted number of passed frames
+		for (auto it = depth_stencil_backups.begin(); it != depth_stencil_backups.end();)
+		{
+			if (frame_index >= it->destroy_after_frame)
+			{
+				assert(it->references == 0);
+
+				device->destroy_resource(it->backup_texture);
+				it = depth_stencil_backups.erase(it);
+				continue;
+			}
+
+			// Reset current clear index
+			it->current_clear_index = 0;
+
+			++it;
+		}
+	}
+
 	void untrack_depth_stencil(device *device, resource resource)
 	{
 		assert(resource != 0);
@@ -639,6 +667,31 @@ static bool on_create_resource_view(device *device, resource resource, resource_
 
 	return true;
 }
+static void on_init_resource(device *device, const resource_desc &desc, const subresource_data *, resource_usage initial_state, resource resource)
+{
+	if (desc.type != resource_type::surface && desc.type != resource_type::texture_2d)
+		return;
+
+	// Use the same filter as in 'on_create_resource' above, so that the pinned depth-stencil is one that had its format replaced for shader access
+	if ((desc.texture.samples > 1 && !device->check_capability(device_caps::resolve_depth_stencil)) || (initial_state & resource_usage::depth_stencil) == 0 || (desc.usage & resource_usage::depth_stencil) == 0 || desc.texture.format == format::s8_uint || desc.texture.width <= 512)
+		return;
+
+	generic_depth_device_data *const device_data = device->get_private_data<generic_depth_device_data>();
+	if (device_data == nullptr)
+		return;
+
+	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+
+	// Only pin the first one, which in D3D9 is the auto depth-stencil that is created with the device (and again after every device reset)
+	if (device_data->pinned_depth_stencil != 0)
+		return;
+
+	device_data->pinned_depth_stencil = resource;
+
+	depth_stencil_resource &info = device_data->depth_stencil_resources[resource];
+	info.first_used_in_frame = 0;
+	info.last_used_in_frame = device_data->frame_index;
+}
 static void on_destroy_resource(device *device, resource resource)
 {
 	generic_depth_device_data *const device_data = device->get_private_data<generic_depth_device_data>();
@@ -650,6 +703,10 @@ static void on_destroy_resource(device *device, resource resource)
 
 	std::unique_lock<std::shared_mutex> lock(s_mutex);
 
+	// Allow another depth-stencil to be pinned when the pinned one is destroyed (e.g. during a device reset)
+	if (resource == device_data->pinned_depth_stencil)
+		device_data->pinned_depth_stencil = { 0 };
+
 	// Remove this destroyed resource from the list of tracked depth-stencil resources
 	if (const auto it = device_data->depth_stencil_resources.find(resource);
 		it != device_data->depth_stencil_resources.end())
@@ -900,23 +957,26 @@ static void on_present(command_queue *, swapchain *swapchain, const rect *, cons
 			info.first_used_in_frame = device_data->frame_index;
 	}
 
-	// Destroy resources that were enqueued for delayed destruction and have reached the targeted number of passed frames
-	for (auto it = device_data->depth_stencil_backups.begin(); it != device_data->depth_stencil_backups.end();)
-	{
-		if (device_data->frame_index >= it->destroy_after_frame)
-		{
-			assert(it->references == 0);
+	device_data->destroy_expired_backups(device);
+}
+static void on_present_pinned(command_queue *, swapchain *swapchain, const rect *, const rect *, uint32_t, const rect *)
+{
+	device *const device = swapchain->get_device();
+	generic_depth_device_data *const device_data = device->get_private_data<generic_depth_device_data>();
 
-			device->destroy_resource(it->backup_texture);
-			it = device_data->depth_stencil_backups.erase(it);
-			continue;
-		}
+	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
-		// Reset current clear index
-		it->current_clear_index = 0;
+	device_data->frame_index++;
 
-		++it;
+	// No draw calls are tracked, so simply assume the pinned depth-stencil was used and not yet copied this frame
+	if (const auto it = device_data->depth_stencil_resources.find(device_data->pinned_depth_stencil);
+		it != device_data->depth_stencil_resources.end())
+	{
+		it->second.last_used_in_frame = device_data->frame_index;
+		it->second.last_counters.copied_during_frame = false;
 	}
+
+	device_data->destroy_expired_backups(device);
 }
 
 static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_list, resource_view, resource_view)
@@ -941,6 +1001,18 @@ static void on_begin_render_effects(effect_runtime *runtime, command_list *cmd_l
 	// Unlock while calling into device below, since device may hold a lock itself and that then can deadlock another thread that calls into 'on_destroy_resource' from the device holding that lock
 	lock.unlock();
 
+	if (s_pin_depth_buffer)
+	{
+		// Skip the heuristic altogether, since there are no draw statistics to base it on
+		if (const auto it = current_depth_stencil_resources.find(device_data->pinned_depth_stencil);
+			it != current_depth_stencil_resources.end())
+		{
+			best_match = it->first;
+			best_match_desc = device->get_resource_desc(it->first);
+			best_snapshot = &it->second.last_counters;
+		}
+	}
+	else
 	for (auto &[resource, info] : current_depth_stencil_resources)
 	{
 		if (info.last_counters.total_stats.drawcalls == 0 || (info.last_counters.total_stats.vertices <= 3 && info.last_counters.total_stats.drawcalls_indirect == 0))
@@ -1167,6 +1239,13 @@ static void draw_settings_overlay(effect_runtime *runtime)
 {
 	bool force_reset = false;
 
+	if (ImGui::Checkbox("Pin depth buffer created with the device", &s_pin_depth_buffer_after_restart))
+		reshade::set_config_value(nullptr, "DEPTH", "PinDepthBuffer", s_pin_depth_buffer_after_restart);
+	ImGui::SetItemTooltip("Skips draw call tracking and always uses the depth buffer the game created first (the auto depth-stencil in D3D9).\nThis significantly reduces CPU overhead in draw call heavy scenes, but only takes effect after a restart.");
+
+	if (s_pin_depth_buffer)
+		ImGui::BeginDisabled();
+
 	const char *const draw_stats_heuristic_items[] = {
 		"Default",
 		"Higher vertices",
@@ -1228,6 +1307,9 @@ static void draw_settings_overlay(effect_runtime *runtime)
 	if (s_preserve_depth_buffers == 0)
 		ImGui::SetItemTooltip("Enable this when the depth buffer is empty");
 
+	if (s_pin_depth_buffer)
+		ImGui::EndDisabled();
+
 	device *const device = runtime->get_device();
 
 	const bool is_d3d12_or_vulkan = device->get_api() == device_api::d3d12 || device->get_api() == device_api::vulkan;
@@ -1327,7 +1409,7 @@ static void draw_settings_overlay(effect_runtime *runtime)
 		ImGui::PopStyleColor();
 		ImGui::EndDisabled();
 
-		if (s_preserve_depth_buffers && item.resource == data.selected_depth_stencil)
+		if (s_preserve_depth_buffers && !s_pin_depth_buffer && item.resource == data.selected_depth_stencil)
 		{
 			if (item.snapshot.clears.empty())
 			{
@@ -1410,6 +1492,10 @@ static void draw_settings_overlay(effect_runtime *runtime)
 
 void register_addon_depth()
 {
+	// Needs to be known before registering events, since draw call tracking is not registered at all when pinning the depth buffer
+	reshade::get_config_value(nullptr, "DEPTH", "PinDepthBuffer", s_pin_depth_buffer);
+	s_pin_depth_buffer_after_restart = s_pin_depth_buffer;
+
 	reshade::register_overlay(nullptr, draw_settings_overlay);
 
 	reshade::register_event<reshade::addon_event::init_device>(on_init_device);
@@ -1425,19 +1511,28 @@ void register_addon_depth()
 	reshade::register_event<reshade::addon_event::create_resource_view>(on_create_resource_view);
 	reshade::register_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
 
-	reshade::register_event<reshade::addon_event::draw>(on_draw);
-	reshade::register_event<reshade::addon_event::draw_indexed>(on_draw_indexed);
-	reshade::register_event<reshade::addon_event::draw_or_dispatch_indirect>(on_draw_indirect);
-	reshade::register_event<reshade::addon_event::bind_viewports>(on_bind_viewport);
-	reshade::register_event<reshade::addon_event::begin_render_pass>(on_begin_render_pass_with_depth_stencil);
-	reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(on_bind_depth_stencil);
-	reshade::register_event<reshade::addon_event::clear_depth_stencil_view>(on_clear_depth_stencil);
-
-	reshade::register_event<reshade::addon_event::reset_command_list>(on_reset);
-	reshade::register_event<reshade::addon_event::execute_command_list>(on_execute_primary);
-	reshade::register_event<reshade::addon_event::execute_secondary_command_list>(on_execute_secondary);
+	if (s_pin_depth_buffer)
+	{
+		reshade::register_event<reshade::addon_event::init_resource>(on_init_resource);
 
-	reshade::register_event<reshade::addon_event::present>(on_present);
+		reshade::register_event<reshade::addon_event::present>(on_present_pinned);
+	}
+	else
+	{
+		reshade::register_event<reshade::addon_event::draw>(on_draw);
+		reshade::register_event<reshade::addon_event::draw_indexed>(on_draw_indexed);
+		reshade::register_event<reshade::addon_event::draw_or_dispatch_indirect>(on_draw_indirect);
+		reshade::register_event<reshade::addon_event::bind_viewports>(on_bind_viewport);
+		reshade::register_event<reshade::addon_event::begin_render_pass>(on_begin_render_pass_with_depth_stencil);
+		reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(on_bind_depth_stencil);
+		reshade::register_event<reshade::addon_event::clear_depth_stencil_view>(on_clear_depth_stencil);
+
+		reshade::register_event<reshade::addon_event::reset_command_list>(on_reset);
+		reshade::register_event<reshade::addon_event::execute_command_list>(on_execute_primary);
+		reshade::register_event<reshade::addon_event::execute_secondary_command_list>(on_execute_secondary);
+
+		reshade::register_event<reshade::addon_event::present>(on_present);
+	}
 
 	reshade::register_event<reshade::addon_event::reshade_begin_effects>(on_begin_render_effects);
 	reshade::register_event<reshade::addon_event::reshade_finish_effects>(on_finish_render_effects);
@@ -1458,6 +1553,7 @@ void unregister_addon_depth()
 	reshade::unregister_event<reshade::addon_event::create_resource>(on_create_resource);
 	reshade::unregister_event<reshade::addon_event::create_resource_view>(on_create_resource_view);
 	reshade::unregister_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
+	reshade::unregister_event<reshade::addon_event::init_resource>(on_init_resource);
 
 	reshade::unregister_event<reshade::addon_event::draw>(on_draw);
 	reshade::unregister_event<reshade::addon_event::draw_indexed>(on_draw_indexed);
@@ -1472,6 +1568,7 @@ void unregister_addon_depth()
 	reshade::unregister_event<reshade::addon_event::execute_secondary_command_list>(on_execute_secondary);
 
 	reshade::unregister_event<reshade::addon_event::present>(on_present);
+	reshade::unregister_event<reshade::addon_event::present>(on_present_pinned);
 
 	reshade::unregister_event<reshade::addon_event::reshade_begin_effects>(on_begin_render_effects);
 	reshade::unregister_event<reshade::addon_event::reshade_finish_effects>(on_finish_render_effects);
@@ -52,19 +52,32 @@ static bool capture_impl_init(reshade::api::device *device, const reshade::api::
 
 	const reshade::api::resource_usage copy_state = data.multisampled ? reshade::api::resource_usage::resolve_dest : reshade::api::resource_usage::copy_dest;
 
-	// Using shared texture with OBS only works in Direct3D 10/11
-	if ((device->get_api() == reshade::api::device_api::d3d10 || device->get_api() == reshade::api::device_api::d3d11) && !global_hook_info->force_shmem)
+	// Using shared texture with OBS only works in Direct3D 9Ex/10/11, since OBS opens the handle with Direct3D 11 and that only accepts legacy shared handles
+	// Plain Direct3D 9 devices fail to create shared resources, in which case this falls back to copying through shared memory below
+	data.using_shtex = false;
+	if ((device->get_api() == reshade::api::device_api::d3d9 || device->get_api() == reshade::api::device_api::d3d10 || device->get_api() == reshade::api::device_api::d3d11) &&
+		device->check_capability(reshade::api::device_caps::shared_resource) && !global_hook_info->force_shmem)
 	{
-		data.using_shtex = true;
-
-		if (!device->create_resource(
+		if (device->create_resource(
 				reshade::api::resource_desc(data.cx, data.cy, 1, 1, data.format, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::shader_resource | copy_state, reshade::api::resource_flags::shared),
 				nullptr,
 				copy_state,
 				&data.shtex.texture,
 				&data.shtex.handle))
-			return false;
+		{
+			data.using_shtex = true;
+		}
+		else
+		{
+			reshade::log::message(reshade::log::level::info, "Failed to create shared texture, falling back to shared memory capture.");
 
+			data.shtex.texture = { 0 };
+			data.shtex.handle = nullptr;
+		}
+	}
+
+	if (data.using_shtex)
+	{
 		data.format = device->get_resource_desc(data.shtex.texture).texture.format;
 
 		if (!capture_init_shtex(data.shtex.shtex_info, window, data.cx, data.cy, static_cast<uint32_t>(data.format), false, (uintptr_t)data.shtex.handle))
@@ -72,8 +85,6 @@ static bool capture_impl_init(reshade::api::device *device, const reshade::api::
 	}
 	else
 	{
-		data.using_shtex = false;
-
 		for (int i = 0; i < NUM_BUFFERS; i++)
 		{
 			if (!device->create_resource(
@@ -5,25 +5,54 @@
 
 #include <reshade.hpp>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <algorithm>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
 
 extern "C" {
 #include <libavutil/hwcontext.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
 }
 
 struct __declspec(uuid("0d7525f9-c4e1-426e-bc99-15bbd5fd51f2")) video_capture
 {
 	AVCodecContext *codec_ctx = nullptr;
 	AVFormatContext *output_ctx = nullptr;
-	AVFrame *frame = nullptr;
+	// Used to convert captured frames to the pixel format the encoder expects (only if the encoder does not accept RGB input directly)
+	SwsContext *sws_ctx = nullptr;
+	AVFrame *converted_frame = nullptr;
+	AVPixelFormat capture_pix_fmt = AV_PIX_FMT_NONE;
 
 	// Create multiple host resources, to buffer copies from device to host over multiple frames
-	reshade::api::resource host_resources[3];
+	std::vector<reshade::api::resource> host_resources;
+	std::vector<int64_t> host_resource_pts;
 	uint64_t copy_finished_fence_value = 1;
 	uint64_t copy_initiated_fence_value = 1;
 	reshade::api::fence copy_finished_fence = {};
 
+	// Read back frames are handed over to a separate thread for encoding, so that the encoder never stalls presentation
+	std::thread encoder_thread;
+	std::mutex encoder_mutex;
+	std::condition_variable encoder_condition;
+	std::deque<AVFrame *> pending_frames;
+	std::vector<AVFrame *> free_frames;
+	std::vector<AVFrame *> frames;
+	bool encoder_stopping = false;
+
+	// Frames that could not be captured, because all host resources were still in use, or because the encoder was not keeping up
+	uint64_t frames_dropped_copy = 0;
+	uint64_t frames_dropped_encoder = 0;
+	std::atomic<uint64_t> frames_encoded = 0;
+
 	std::chrono::system_clock::time_point last_time;
 	std::chrono::system_clock::time_point start_time;
 
@@ -31,103 +60,202 @@ struct __declspec(uuid("0d7525f9-c4e1-426e-bc99-15bbd5fd51f2")) video_capture
 	void destroy_codec_ctx();
 	bool init_format_ctx(const char *filename);
 	void destroy_format_ctx();
-};
-
-bool video_capture::init_codec_ctx(const reshade::api::resource_desc &buffer_desc)
-{
-	const AVCodec *codec = nullptr;
-	void *i = nullptr;
-	while ((codec = av_codec_iterate(&i)) != nullptr)
-	{
-		if (codec->id != AV_CODEC_ID_H264 || !av_codec_is_encoder(codec))
-			continue;
 
-		bool supports_rgb0 = false;
-		for (const AVPixelFormat *fmt = codec->pix_fmts; *fmt != AV_PIX_FMT_NONE; ++fmt)
-			if (*fmt == AV_PIX_FMT_0BGR32 || *fmt == AV_PIX_FMT_0RGB32)
-				supports_rgb0 = true;
+	bool start_recording(reshade::api::effect_runtime *runtime, reshade::api::resource rtv_resource);
+	void stop_recording(reshade::api::effect_runtime *runtime);
 
-		 if (supports_rgb0)
-			break; // Found a codec that passes requirements
-	}
+	void read_back_finished_copies(reshade::api::device *device);
+	void encoder_main();
+};
 
-	if (codec == nullptr)
+static bool open_codec(AVCodecContext *codec_ctx, const AVCodec *codec)
+{
+	if (int err = avcodec_open2(codec_ctx, codec, nullptr); err < 0)
 	{
-		reshade::log::message(reshade::log::level::error, "Failed to find a H.264 encoder that passes requirements!");
+		char errbuf[64 + AV_ERROR_MAX_STRING_SIZE];
+		const int prefix_length = snprintf(errbuf, sizeof(errbuf), "Failed to initialize encoder \"%s\": ", codec->name);
+		av_make_error_string(errbuf + prefix_length, sizeof(errbuf) - prefix_length, err);
+		reshade::log::message(reshade::log::level::warning, errbuf);
 		return false;
 	}
 
-	codec_ctx = avcodec_alloc_context3(codec);
-
-	codec_ctx->bit_rate = 400000;
-	codec_ctx->width = buffer_desc.texture.width;
-	codec_ctx->height = buffer_desc.texture.height;
-	codec_ctx->time_base = { 1, 30 }; // Frames per second
-	codec_ctx->color_range = AVCOL_RANGE_JPEG;
-	codec_ctx->gop_size = 250;
-	codec_ctx->max_b_frames = 2;
+	return true;
+}
 
+bool video_capture::init_codec_ctx(const reshade::api::resource_desc &buffer_desc)
+{
 	switch (buffer_desc.texture.format)
 	{
 	case reshade::api::format::r8g8b8a8_unorm:
 	case reshade::api::format::r8g8b8a8_unorm_srgb:
 	case reshade::api::format::r8g8b8x8_unorm:
 	case reshade::api::format::r8g8b8x8_unorm_srgb:
-		codec_ctx->pix_fmt = AV_PIX_FMT_0BGR32;
+		capture_pix_fmt = AV_PIX_FMT_0BGR32;
 		break;
 	case reshade::api::format::b8g8r8a8_unorm:
 	case reshade::api::format::b8g8r8a8_unorm_srgb:
 	case reshade::api::format::b8g8r8x8_unorm:
 	case reshade::api::format::b8g8r8x8_unorm_srgb:
-		codec_ctx->pix_fmt = AV_PIX_FMT_0RGB32;
+		capture_pix_fmt = AV_PIX_FMT_0RGB32;
 		break;
 	default:
-		destroy_codec_ctx();
 		reshade::log::message(reshade::log::level::error, "Unsupported texture format!");
 		return false;
 	}
 
-	if (int err = avcodec_open2(codec_ctx, codec, nullptr); err < 0)
+	// Prefer hardware encoders, which are tried in order until one initializes successfully (they fail to open if the corresponding hardware is not present)
+	std::vector<const AVCodec *> candidates;
+	char encoder_name[64] = "";
+	size_t encoder_name_length = sizeof(encoder_name);
+	if (reshade::get_config_value(nullptr, "VIDEO_CAPTURE", "Encoder", encoder_name, &encoder_name_length) && encoder_name[0] != '\0')
 	{
-		destroy_codec_ctx();
+		if (const AVCodec *const codec = avcodec_find_encoder_by_name(encoder_name))
+			candidates.push_back(codec);
+		else
+			reshade::log::message(reshade::log::level::warning, "Configured encoder was not found, falling back to automatic selection.");
+	}
+	for (const char *const name : { "h264_nvenc", "h264_amf", "h264_qsv" })
+		if (const AVCodec *const codec = avcodec_find_encoder_by_name(name))
+			candidates.push_back(codec);
+	{
+		const AVCodec *codec = nullptr;
+		void *i = nullptr;
+		while ((codec = av_codec_iterate(&i)) != nullptr)
+			if (codec->id == AV_CODEC_ID_H264 && av_codec_is_encoder(codec))
+				candidates.push_back(codec);
+	}
 
-		char errbuf[32 + AV_ERROR_MAX_STRING_SIZE] = "Failed to initialize encoder: ";
-		av_make_error_string(errbuf + strlen(errbuf), sizeof(errbuf) - strlen(errbuf), err);
-		reshade::log::message(reshade::log::level::error, errbuf);
+	for (const AVCodec *const codec : candidates)
+	{
+		if (codec->pix_fmts == nullptr)
+			continue;
+
+		// Feed RGB data directly if the encoder supports that (hardware encoders then convert on the GPU), otherwise convert to NV12 or planar YUV first
+		AVPixelFormat pix_fmt = AV_PIX_FMT_NONE;
+		for (const AVPixelFormat *fmt = codec->pix_fmts; *fmt != AV_PIX_FMT_NONE; ++fmt)
+		{
+			if (*fmt == capture_pix_fmt)
+			{
+				pix_fmt = *fmt;
+				break;
+			}
+			if (*fmt == AV_PIX_FMT_NV12 || (*fmt == AV_PIX_FMT_YUV420P && pix_fmt != AV_PIX_FMT_NV12))
+				pix_fmt = *fmt;
+		}
+
+		if (pix_fmt == AV_PIX_FMT_NONE)
+			continue;
+
+		codec_ctx = avcodec_alloc_context3(codec);
+
+		codec_ctx->bit_rate = 400000;
+		codec_ctx->width = buffer_desc.texture.width;
+		codec_ctx->height = buffer_desc.texture.height;
+		codec_ctx->time_base = { 1, 30 }; // Frames per second
+		codec_ctx->color_range = AVCOL_RANGE_JPEG;
+		codec_ctx->gop_size = 250;
+		codec_ctx->max_b_frames = 2;
+		codec_ctx->pix_fmt = pix_fmt;
+
+		if (open_codec(codec_ctx, codec))
+			break;
+
+		avcodec_free_context(&codec_ctx);
+		codec_ctx = nullptr;
+	}
+
+	if (codec_ctx == nullptr)
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to find a H.264 encoder that passes requirements!");
 		return false;
 	}
 
-	frame = av_frame_alloc();
+	reshade::log::message(reshade::log::level::info, (std::string("Using encoder \"") + codec_ctx->codec->name + "\" with pixel format \"" + av_get_pix_fmt_name(codec_ctx->pix_fmt) + "\".").c_str());
 
-	if (frame == nullptr)
+	if (codec_ctx->pix_fmt != capture_pix_fmt)
 	{
-		destroy_codec_ctx();
-		return false;
+		sws_ctx = sws_getContext(
+			codec_ctx->width, codec_ctx->height, capture_pix_fmt,
+			codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt,
+			SWS_POINT, nullptr, nullptr, nullptr);
+		converted_frame = av_frame_alloc();
+
+		if (sws_ctx == nullptr || converted_frame == nullptr)
+		{
+			destroy_codec_ctx();
+			reshade::log::message(reshade::log::level::error, "Failed to initialize pixel format conversion!");
+			return false;
+		}
+
+		converted_frame->width = codec_ctx->width;
+		converted_frame->height = codec_ctx->height;
+		converted_frame->format = codec_ctx->pix_fmt;
+		converted_frame->color_range = codec_ctx->color_range;
+
+		if (int err = av_frame_get_buffer(converted_frame, 0); err < 0)
+		{
+			destroy_codec_ctx();
+
+			char errbuf[32 + AV_ERROR_MAX_STRING_SIZE] = "Failed to get frame buffer: ";
+			av_make_error_string(errbuf + strlen(errbuf), sizeof(errbuf) - strlen(errbuf), err);
+			reshade::log::message(reshade::log::level::error, errbuf);
+			return false;
+		}
 	}
 
-	frame->width = codec_ctx->width;
-	frame->height = codec_ctx->height;
-	frame->format = codec_ctx->pix_fmt;
-	frame->color_range = codec_ctx->color_range;
+	// Allocate a pool of frames that read back data is copied into while it waits to be encoded
+	uint32_t frame_queue_size = 8;
+	reshade::get_config_value(nullptr, "VIDEO_CAPTURE", "FrameQueueSize", frame_queue_size);
 
-	if (int err = av_frame_get_buffer(frame, 0); err < 0)
+	for (uint32_t i = 0; i < std::max(frame_queue_size, 1u); ++i)
 	{
-		destroy_codec_ctx();
+		AVFrame *const frame = av_frame_alloc();
+		if (frame == nullptr)
+		{
+			destroy_codec_ctx();
+			return false;
+		}
 
-		char errbuf[32 + AV_ERROR_MAX_STRING_SIZE] = "Failed to get frame buffer: ";
-		av_make_error_string(errbuf + strlen(errbuf), sizeof(errbuf) - strlen(errbuf), err);
-		reshade::log::message(reshade::log::level::error, errbuf);
-		return false;
+		frames.push_back(frame);
+
+		frame->width = codec_ctx->width;
+		frame->height = codec_ctx->height;
+		frame->format = capture_pix_fmt;
+		frame->color_range = codec_ctx->color_range;
+
+		if (int err = av_frame_get_buffer(frame, 0); err < 0)
+		{
+			destroy_codec_ctx();
+
+			char errbuf[32 + AV_ERROR_MAX_STRING_SIZE] = "Failed to get frame buffer: ";
+			av_make_error_string(errbuf + strlen(errbuf), sizeof(errbuf) - strlen(errbuf), err);
+			reshade::log::message(reshade::log::level::error, errbuf);
+			return false;
+		}
 	}
 
+	free_frames = frames;
+
 	return true;
 }
 void video_capture::destroy_codec_ctx()
 {
-	if (frame != nullptr)
-	{
+	for (AVFrame *frame : frames)
 		av_frame_free(&frame);
-		frame = nullptr;
+	frames.clear();
+	free_frames.clear();
+	pending_frames.clear();
+
+	if (converted_frame != nullptr)
+	{
+		av_frame_free(&converted_frame);
+		converted_frame = nullptr;
+	}
+
+	if (sws_ctx != nullptr)
+	{
+		sws_freeContext(sws_ctx);
+		sws_ctx = nullptr;
 	}
 
 	if (codec_ctx != nullptr)
@@ -199,169 +327,261 @@ static void encode_frame(AVCodecContext *enc, AVFormatContext *s, AVFrame *frame
 	}
 }
 
-static void on_init(reshade::api::effect_runtime *runtime)
+bool video_capture::start_recording(reshade::api::effect_runtime *runtime, reshade::api::resource rtv_resource)
 {
-	video_capture &data = *runtime->create_private_data<video_capture>();
+	reshade::api::device *const device = runtime->get_device();
 
-	// Create a fence that is used to communicate status of copies between device and host
-	if (!runtime->get_device()->create_fence(0, reshade::api::fence_flags::none, &data.copy_finished_fence))
+	reshade::api::resource_desc desc = device->get_resource_desc(rtv_resource);
+
+	if (!init_codec_ctx(desc))
+		return false;
+	if (!init_format_ctx("video.mp4"))
 	{
-		reshade::log::message(reshade::log::level::error, "Failed to create copy fence!");
+		destroy_codec_ctx();
+		return false;
+	}
+
+	desc.type = reshade::api::resource_type::texture_2d;
+	desc.heap = reshade::api::memory_heap::gpu_to_cpu;
+	desc.usage = reshade::api::resource_usage::copy_dest;
+	desc.flags = reshade::api::resource_flags::none;
+
+	uint32_t host_resource_count = 4;
+	reshade::get_config_value(nullptr, "VIDEO_CAPTURE", "StagingTextureCount", host_resource_count);
+
+	host_resources.resize(std::max(host_resource_count, 2u));
+	host_resource_pts.resize(host_resources.size());
+
+	for (size_t i = 0; i < host_resources.size(); ++i)
+	{
+		if (!device->create_resource(desc, nullptr, reshade::api::resource_usage::copy_dest, &host_resources[i]))
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to create host resource!");
+
+			for (size_t k = 0; k < i; ++k)
+				device->destroy_resource(host_resources[k]);
+			host_resources.clear();
+
+			destroy_format_ctx();
+			destroy_codec_ctx();
+			return false;
+		}
 	}
+
+	frames_dropped_copy = 0;
+	frames_dropped_encoder = 0;
+	frames_encoded = 0;
+
+	encoder_stopping = false;
+	encoder_thread = std::thread(&video_capture::encoder_main, this);
+
+	reshade::log::message(reshade::log::level::info, "Starting video recording ...");
+
+	start_time = last_time = std::chrono::system_clock::now();
+
+	return true;
 }
-static void on_destroy(reshade::api::effect_runtime *runtime)
+void video_capture::stop_recording(reshade::api::effect_runtime *runtime)
 {
-	video_capture &data = *runtime->get_private_data<video_capture>();
+	reshade::log::message(reshade::log::level::info, "Stopping video recording ...");
 
 	reshade::api::device *const device = runtime->get_device();
 
-	for (reshade::api::resource &host_resource : data.host_resources)
-		device->destroy_resource(host_resource);
+	// Wait for all copies still underway and hand them over to the encoder, before letting the encoder thread finish up
+	runtime->get_command_queue()->wait_idle();
 
-	device->destroy_fence(data.copy_finished_fence);
+	read_back_finished_copies(device);
 
-	// Flush the encoder
-	if (data.output_ctx != nullptr)
-		encode_frame(data.codec_ctx, data.output_ctx, nullptr);
+	{
+		const std::unique_lock<std::mutex> lock(encoder_mutex);
+		encoder_stopping = true;
+	}
 
-	data.destroy_format_ctx(); data.destroy_codec_ctx();
+	encoder_condition.notify_one();
+	encoder_thread.join();
 
-	runtime->destroy_private_data<video_capture>();
+	for (const reshade::api::resource host_resource : host_resources)
+		device->destroy_resource(host_resource);
+	host_resources.clear();
+	host_resource_pts.clear();
+
+	copy_finished_fence_value = copy_initiated_fence_value;
+
+	destroy_format_ctx();
+	destroy_codec_ctx();
+
+	reshade::log::message(reshade::log::level::info, (
+		"Finished video recording with " + std::to_string(frames_encoded.load()) + " frames encoded, " +
+		std::to_string(frames_dropped_copy) + " frames dropped because all staging textures were in use and " +
+		std::to_string(frames_dropped_encoder) + " frames dropped because the encoder was not keeping up.").c_str());
 }
 
-static void on_reshade_finish_effects(reshade::api::effect_runtime *runtime, reshade::api::command_list *, reshade::api::resource_view rtv, reshade::api::resource_view)
+void video_capture::read_back_finished_copies(reshade::api::device *device)
 {
-	video_capture &data = *runtime->get_private_data<video_capture>();
+	// Check which previous copies have already finished (by waiting on the corresponding fence values with a timeout of zero)
+	while (copy_finished_fence_value < copy_initiated_fence_value && device->wait(copy_finished_fence, copy_finished_fence_value, 0))
+	{
+		const size_t host_resource_index = copy_finished_fence_value % host_resources.size();
+		copy_finished_fence_value++;
 
-	reshade::api::device *const device = runtime->get_device();
-	reshade::api::command_queue *const queue = runtime->get_command_queue();
+		AVFrame *frame = nullptr;
+		{
+			const std::unique_lock<std::mutex> lock(encoder_mutex);
+			if (!free_frames.empty())
+			{
+				frame = free_frames.back();
+				free_frames.pop_back();
+			}
+		}
 
-	const reshade::api::resource rtv_resource = device->get_resource_from_view(rtv);
+		if (frame == nullptr)
+		{
+			frames_dropped_encoder++;
+			continue;
+		}
 
-	if (runtime->is_key_pressed(VK_F11))
-	{
-		if (data.output_ctx != nullptr)
+		// The encoder may still hold a reference to the frame data, in which case this allocates a new buffer
+		reshade::api::subresource_data host_data;
+		if (av_frame_make_writable(frame) < 0 ||
+			!device->map_texture_region(host_resources[host_resource_index], 0, nullptr, reshade::api::map_access::read_only, &host_data))
 		{
-			reshade::log::message(reshade::log::level::info, "Stopping video recording ...");
+			const std::unique_lock<std::mutex> lock(encoder_mutex);
+			free_frames.push_back(frame);
+			frames_dropped_encoder++;
+			continue;
+		}
 
-			queue->wait_idle();
+		const size_t row_size = std::min(static_cast<size_t>(host_data.row_pitch), static_cast<size_t>(frame->linesize[0]));
+		for (int y = 0; y < frame->height; ++y)
+			std::memcpy(frame->data[0] + y * static_cast<size_t>(frame->linesize[0]), static_cast<const uint8_t *>(host_data.data) + y * static_cast<size_t>(host_data.row_pitch), row_size);
 
-			for (reshade::api::resource &host_resource : data.host_resources)
-			{
-				device->destroy_resource(host_resource);
-				host_resource = { 0 };
-			}
+		device->unmap_texture_region(host_resources[host_resource_index], 0);
 
-			// Flush the encoder
-			encode_frame(data.codec_ctx, data.output_ctx, nullptr);
+		frame->pts = host_resource_pts[host_resource_index];
 
-			data.destroy_format_ctx();
-			data.destroy_codec_ctx();
+		{
+			const std::unique_lock<std::mutex> lock(encoder_mutex);
+			pending_frames.push_back(frame);
 		}
-		else
+
+		encoder_condition.notify_one();
+	}
+}
+
+void video_capture::encoder_main()
+{
+	while (true)
+	{
+		AVFrame *frame = nullptr;
 		{
-			reshade::api::resource_desc desc = device->get_resource_desc(rtv_resource);
+			std::unique_lock<std::mutex> lock(encoder_mutex);
+			encoder_condition.wait(lock, [this]() { return encoder_stopping || !pending_frames.empty(); });
 
-			if (!data.init_codec_ctx(desc))
-				return;
-			if (!data.init_format_ctx("video.mp4"))
-				return;
+			if (pending_frames.empty())
+				break;
 
-			desc.type = reshade::api::resource_type::texture_2d;
-			desc.heap = reshade::api::memory_heap::gpu_to_cpu;
-			desc.usage = reshade::api::resource_usage::copy_dest;
-			desc.flags = reshade::api::resource_flags::none;
+			frame = pending_frames.front();
+			pending_frames.pop_front();
+		}
 
-			for (size_t i = 0; i < std::size(data.host_resources); ++i)
+		if (sws_ctx != nullptr)
+		{
+			if (av_frame_make_writable(converted_frame) >= 0)
 			{
-				if (!device->create_resource(desc, nullptr, reshade::api::resource_usage::copy_dest, &data.host_resources[i]))
-				{
-					reshade::log::message(reshade::log::level::error, "Failed to create host resource!");
-
-					for (size_t k = 0; k < i; ++k)
-					{
-						device->destroy_resource(data.host_resources[k]);
-						data.host_resources[k] = { 0 };
-					}
-
-					data.destroy_format_ctx();
-					data.destroy_codec_ctx();
-					return;
-				}
+				sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, converted_frame->data, converted_frame->linesize);
+				converted_frame->pts = frame->pts;
+
+				encode_frame(codec_ctx, output_ctx, converted_frame);
+				frames_encoded++;
 			}
+		}
+		else
+		{
+			encode_frame(codec_ctx, output_ctx, frame);
+			frames_encoded++;
+		}
 
-			reshade::log::message(reshade::log::level::info, "Starting video recording ...");
+		const std::unique_lock<std::mutex> lock(encoder_mutex);
+		free_frames.push_back(frame);
+	}
 
-			data.start_time = data.last_time = std::chrono::system_clock::now();
-		}
+	// Flush the encoder
+	encode_frame(codec_ctx, output_ctx, nullptr);
+}
+
+static void on_init(reshade::api::effect_runtime *runtime)
+{
+	video_capture &data = *runtime->create_private_data<video_capture>();
+
+	// Create a fence that is used to communicate status of copies between device and host
+	if (!runtime->get_device()->create_fence(0, reshade::api::fence_flags::none, &data.copy_finished_fence))
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to create copy fence!");
 	}
+}
+static void on_destroy(reshade::api::effect_runtime *runtime)
+{
+	video_capture &data = *runtime->get_private_data<video_capture>();
 
-	if (data.codec_ctx == nullptr || data.output_ctx == nullptr || data.host_resources[0] == 0)
-		return;
+	if (data.output_ctx != nullptr)
+		data.stop_recording(runtime);
 
-	// Only encode a frame every few frames, depending on the set codec framerate
-	const auto time = std::chrono::system_clock::now();
-	if ((time - data.last_time) < (std::chrono::milliseconds(data.codec_ctx->time_base.num * std::milli::den) / data.codec_ctx->time_base.den))
-		return;
-	data.last_time = time;
+	runtime->get_device()->destroy_fence(data.copy_finished_fence);
 
-	// Copy frame to the host, but delay mapping and reading that copy for a few frames afterwards, so that the device has enough time to finish the copy to host memory (this is asynchronous and it can take a bit for the device to catch up)
-	reshade::api::command_list *const cmd_list = queue->get_immediate_command_list();
-	cmd_list->barrier(rtv_resource, reshade::api::resource_usage::render_target, reshade::api::resource_usage::copy_source);
-	size_t host_resource_index = data.copy_initiated_fence_value % std::size(data.host_resources);
-	cmd_list->copy_texture_region(rtv_resource, 0, nullptr, data.host_resources[host_resource_index], 0, nullptr);
-	cmd_list->barrier(rtv_resource, reshade::api::resource_usage::copy_source, reshade::api::resource_usage::render_target);
+	runtime->destroy_private_data<video_capture>();
+}
 
-	queue->flush_immediate_command_list();
-	// Signal the fence once the copy has finished
-	queue->signal(data.copy_finished_fence, data.copy_initiated_fence_value++);
+static void on_reshade_finish_effects(reshade::api::effect_runtime *runtime, reshade::api::command_list *, reshade::api::resource_view rtv, reshade::api::resource_view)
+{
+	video_capture &data = *runtime->get_private_data<video_capture>();
 
-	// Check if a previous copy has already finished (by waiting on the corresponding fence value with a timeout of zero)
-	if (!device->wait(data.copy_finished_fence, data.copy_finished_fence_value, 0))
+	reshade::api::device *const device = runtime->get_device();
+	reshade::api::command_queue *const queue = runtime->get_command_queue();
+
+	const reshade::api::resource rtv_resource = device->get_resource_from_view(rtv);
+
+	if (runtime->is_key_pressed(VK_F11))
 	{
-		// If all copies are still underway, check if all available space to buffer another frame is already used (if yes, have to wait for the oldest copy to finish, if no, can return and handle another frame)
-		if (data.copy_initiated_fence_value - data.copy_finished_fence_value >= std::size(data.host_resources))
-		{
-			device->wait(data.copy_finished_fence, data.copy_finished_fence_value, UINT64_MAX);
-		}
-		else
-		{
+		if (data.output_ctx != nullptr)
+			data.stop_recording(runtime);
+		else if (!data.start_recording(runtime, rtv_resource))
 			return;
-		}
 	}
 
-	if (av_frame_make_writable(data.frame) < 0)
+	if (data.output_ctx == nullptr)
 		return;
 
-	// Map the oldest finished copy for reading
-	host_resource_index = data.copy_finished_fence_value % std::size(data.host_resources);
-	data.copy_finished_fence_value++;
+	// Hand over all copies that finished in the meantime to the encoder thread, without ever waiting on the device
+	data.read_back_finished_copies(device);
 
-	reshade::api::subresource_data host_data;
-	if (!device->map_texture_region(data.host_resources[host_resource_index], 0, nullptr, reshade::api::map_access::read_only, &host_data))
+	// Only encode a frame every few frames, depending on the set codec framerate
+	const auto time = std::chrono::system_clock::now();
+	if ((time - data.last_time) < (std::chrono::milliseconds(data.codec_ctx->time_base.num * std::milli::den) / data.codec_ctx->time_base.den))
 		return;
+	data.last_time = time;
 
-	for (int y = 0; y < data.codec_ctx->height; ++y)
+	// Drop this frame if all host resources are still waiting on copies to finish, rather than stalling until the device catches up
+	if (data.copy_initiated_fence_value - data.copy_finished_fence_value >= data.host_resources.size())
 	{
-		for (int x = 0; x < data.codec_ctx->width; ++x)
-		{
-			const size_t host_data_index = y * host_data.row_pitch + x * 4;
-			const size_t frame_data_index = y * data.frame->linesize[0] + x * 4;
-
-			data.frame->data[0][frame_data_index + 0] = static_cast<const uint8_t *>(host_data.data)[host_data_index + 0];
-			data.frame->data[0][frame_data_index + 1] = static_cast<const uint8_t *>(host_data.data)[host_data_index + 1];
-			data.frame->data[0][frame_data_index + 2] = static_cast<const uint8_t *>(host_data.data)[host_data_index + 2];
-		}
+		data.frames_dropped_copy++;
+		return;
 	}
 
-	device->unmap_texture_region(data.host_resources[host_resource_index], 0);
+	// Copy frame to the host, but delay mapping and reading that copy for a few frames afterwards, so that the device has enough time to finish the copy to host memory (this is asynchronous and it can take a bit for the device to catch up)
+	reshade::api::command_list *const cmd_list = queue->get_immediate_command_list();
+	cmd_list->barrier(rtv_resource, reshade::api::resource_usage::render_target, reshade::api::resource_usage::copy_source);
+	const size_t host_resource_index = data.copy_initiated_fence_value % data.host_resources.size();
+	cmd_list->copy_texture_region(rtv_resource, 0, nullptr, data.host_resources[host_resource_index], 0, nullptr);
+	cmd_list->barrier(rtv_resource, reshade::api::resource_usage::copy_source, reshade::api::resource_usage::render_target);
 
-	data.frame->pts = av_rescale_q(
+	data.host_resource_pts[host_resource_index] = av_rescale_q(
 		std::chrono::duration_cast<std::chrono::milliseconds>(time - data.start_time).count(),
 		AVRational { std::milli::num, std::milli::den },
 		data.codec_ctx->time_base);
 
-	encode_frame(data.codec_ctx, data.output_ctx, data.frame);
+	queue->flush_immediate_command_list();
+	// Signal the fence once the copy has finished
+	queue->signal(data.copy_finished_fence, data.copy_initiated_fence_value++);
 }
 
 extern "C" __declspec(dllexport) const char *NAME = "Video Capture";
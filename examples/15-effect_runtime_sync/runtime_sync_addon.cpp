@@ -5,15 +5,69 @@
 
 #include <imgui.h>
 #include <reshade.hpp>
+#include <string>
 #include <vector>
+#include <unordered_map>
 #include <shared_mutex>
 #include <algorithm> // std::remove
 
 using namespace reshade::api;
 
+struct synced_variable
+{
+	effect_runtime *runtime;
+	effect_uniform_variable variable;
+};
+struct variable_mapping
+{
+	format base_type = format::unknown;
+	std::vector<synced_variable> synced_variables;
+};
+
 static std::shared_mutex s_mutex;
 static bool s_sync = false;
 static std::vector<effect_runtime *> s_runtimes;
+// Variables of other runtimes that match a variable by effect and variable name, by runtime and handle of that variable
+// This is rebuilt whenever effects are reloaded, so that changing a value does not have to look up the variable by name in every other runtime
+static std::unordered_map<effect_runtime *, std::unordered_map<uint64_t, variable_mapping>> s_variable_mappings;
+
+static void update_variable_mappings()
+{
+	s_variable_mappings.clear();
+
+	std::unordered_map<std::string, std::vector<synced_variable>> variables_by_name;
+	for (effect_runtime *const runtime : s_runtimes)
+	{
+		runtime->enumerate_uniform_variables(nullptr, [&variables_by_name](effect_runtime *runtime, effect_uniform_variable variable) {
+			// Skip special uniform variables
+			if (runtime->get_annotation_string_from_uniform_variable(variable, "source", nullptr, nullptr))
+				return;
+
+			char name[128] = "";
+			runtime->get_uniform_variable_name(variable, name);
+			char effect_name[128] = "";
+			runtime->get_uniform_variable_effect_name(variable, effect_name);
+
+			variables_by_name[std::string(effect_name) + '\n' + name].push_back({ runtime, variable });
+		});
+	}
+
+	for (const std::pair<const std::string, std::vector<synced_variable>> &variables : variables_by_name)
+	{
+		if (variables.second.size() < 2)
+			continue;
+
+		for (const synced_variable &variable : variables.second)
+		{
+			variable_mapping &mapping = s_variable_mappings[variable.runtime][variable.variable.handle];
+			variable.runtime->get_uniform_variable_type(variable.variable, &mapping.base_type);
+
+			for (const synced_variable &synced_variable : variables.second)
+				if (synced_variable.runtime != variable.runtime)
+					mapping.synced_variables.push_back(synced_variable);
+		}
+	}
+}
 
 static void on_init(effect_runtime *runtime)
 {
@@ -34,6 +88,16 @@ static void on_destroy(effect_runtime *runtime)
 	const std::unique_lock<std::shared_mutex> lock(s_mutex);
 
 	s_runtimes.erase(std::remove(s_runtimes.begin(), s_runtimes.end(), runtime), s_runtimes.end());
+
+	update_variable_mappings();
+}
+
+static void on_reshade_reloaded_effects(effect_runtime *)
+{
+	const std::unique_lock<std::shared_mutex> lock(s_mutex);
+
+	// Handles of the reloaded runtime changed, which affects the mappings from and to it in all other runtimes
+	update_variable_mappings();
 }
 
 static bool on_reshade_set_uniform_value(effect_runtime *runtime, effect_uniform_variable variable, const void *new_value, size_t new_value_size)
@@ -41,44 +105,29 @@ static bool on_reshade_set_uniform_value(effect_runtime *runtime, effect_uniform
 	if (!s_sync)
 		return false;
 
-	// Skip special uniform variables
-	if (runtime->get_annotation_string_from_uniform_variable(variable, "source", nullptr, nullptr))
-		return false;
+	const std::shared_lock<std::shared_mutex> lock(s_mutex);
 
-	format base_type = format::unknown;
-	runtime->get_uniform_variable_type(variable, &base_type);
+	const auto runtime_it = s_variable_mappings.find(runtime);
+	if (runtime_it == s_variable_mappings.end())
+		return false;
+	const auto variable_it = runtime_it->second.find(variable.handle);
+	if (variable_it == runtime_it->second.end())
+		return false;
 
-	char name[128] = "";
-	runtime->get_uniform_variable_name(variable, name);
-	char effect_name[128] = "";
-	runtime->get_uniform_variable_effect_name(variable, effect_name);
+	const variable_mapping &mapping = variable_it->second;
 
-	const std::shared_lock<std::shared_mutex> lock(s_mutex);
+	// Values are passed in with 32 bits per component, including booleans
+	effect_uniform_value_update update;
+	update.type = mapping.base_type;
+	update.array_index = 0;
+	update.count = static_cast<uint32_t>(new_value_size / sizeof(uint32_t));
+	update.values = new_value;
 
-	for (effect_runtime *const synced_runtime : s_runtimes)
+	// Setting the values in a batch does not invoke this event again for the other runtimes
+	for (const synced_variable &synced_variable : mapping.synced_variables)
 	{
-		if (synced_runtime == runtime)
-			continue;
-
-		const effect_uniform_variable synced_variable = synced_runtime->find_uniform_variable(effect_name, name);
-		if (synced_variable == 0)
-			continue;
-
-		switch (base_type)
-		{
-		case format::r32_typeless:
-			synced_runtime->set_uniform_value_bool(synced_variable, static_cast<const bool *>(new_value), new_value_size / sizeof(bool));
-			break;
-		case format::r32_float:
-			synced_runtime->set_uniform_value_float(synced_variable, static_cast<const float *>(new_value), new_value_size / sizeof(float));
-			break;
-		case format::r32_sint:
-			synced_runtime->set_uniform_value_int(synced_variable, static_cast<const int32_t *>(new_value), new_value_size / sizeof(int32_t));
-			break;
-		case format::r32_uint:
-			synced_runtime->set_uniform_value_uint(synced_variable, static_cast<const uint32_t *>(new_value), new_value_size / sizeof(uint32_t));
-			break;
-		}
+		update.variable = synced_variable.variable;
+		synced_variable.runtime->set_uniform_values(1, &update);
 	}
 
 	return false;
@@ -237,6 +286,7 @@ void register_addon_effect_runtime_sync()
 	reshade::register_event<reshade::addon_event::init_effect_runtime>(on_init);
 	reshade::register_event<reshade::addon_event::destroy_effect_runtime>(on_destroy);
 
+	reshade::register_event<reshade::addon_event::reshade_reloaded_effects>(on_reshade_reloaded_effects);
 	reshade::register_event<reshade::addon_event::reshade_set_uniform_value>(on_reshade_set_uniform_value);
 	reshade::register_event<reshade::addon_event::reshade_set_effects_state>(on_reshade_set_effects_state);
 	reshade::register_event<reshade::addon_event::reshade_set_technique_state>(on_reshade_set_technique_state);
@@ -248,6 +298,7 @@ void unregister_addon_effect_runtime_sync()
 	reshade::unregister_event<reshade::addon_event::init_effect_runtime>(on_init);
 	reshade::unregister_event<reshade::addon_event::destroy_effect_runtime>(on_destroy);
 
+	reshade::unregister_event<reshade::addon_event::reshade_reloaded_effects>(on_reshade_reloaded_effects);
 	reshade::unregister_event<reshade::addon_event::reshade_set_uniform_value>(on_reshade_set_uniform_value);
 	reshade::unregister_event<reshade::addon_event::reshade_set_effects_state>(on_reshade_set_effects_state);
 	reshade::unregister_event<reshade::addon_event::reshade_set_technique_state>(on_reshade_set_technique_state);
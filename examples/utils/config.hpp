@@ -3,11 +3,18 @@
  * SPDX-License-Identifier: BSD-3-Clause OR MIT
  */
 
+// The hash used to name shader and texture files (see crc32_hash.hpp), 1 = CRC-32, 2 = CRC-32C
+// Only change this when starting with new dumps, since files created with one mode do not match the other
+// TexMod compatible texture hashing always uses CRC-32
+#define RESHADE_ADDON_HASH_MODE 1
+
 // The subdirectory to save shader binaries to
 #define RESHADE_ADDON_SHADER_SAVE_DIR ".\\shaderdump"
 
 // The subdirectory to load shader binaries from
 #define RESHADE_ADDON_SHADER_LOAD_DIR ".\\shaderreplace"
+// Packed archive to load shader binaries from instead of the subdirectory, if it exists (see replace_pack tool)
+#define RESHADE_ADDON_SHADER_LOAD_ARCHIVE ".\\shaderreplace.pak"
 
 // The subdirectory to save textures to
 #define RESHADE_ADDON_TEXTURE_SAVE_DIR ".\\texdump"
@@ -15,8 +22,14 @@
 #define RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD 1
 // Skip any textures that were already dumped this session, to reduce lag at the cost of increased memory usage
 #define RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET 1
+// Maximum amount of texture data (in MiB) the texture_dump add-on queues up for its background threads before the application has to wait for them
+#define RESHADE_ADDON_TEXTURE_SAVE_QUEUE_SIZE 512
+// Number of background threads the texture_dump add-on hashes and encodes textures on (0 to use all but one of the available processor cores)
+#define RESHADE_ADDON_TEXTURE_SAVE_THREAD_COUNT 0
 
 // The subdirectory to load textures from
 #define RESHADE_ADDON_TEXTURE_LOAD_DIR ".\\texreplace"
 #define RESHADE_ADDON_TEXTURE_LOAD_FORMAT ".png"
 #define RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD 1
+// Packed archive to load textures from instead of the subdirectory, if it exists (see replace_pack tool)
+#define RESHADE_ADDON_TEXTURE_LOAD_ARCHIVE ".\\texreplace.pak"
@@ -5,58 +5,90 @@
 
 #include "reshade.hpp"
 #include "descriptor_tracking.hpp"
+#include <intrin.h>
 
 using namespace reshade::api;
 
+void descriptor_tracking::descriptor_slot::load(descriptor_type &out_type, descriptor_data &out_data) const
+{
+	uint32_t sequence_begin, sequence_end;
+	do
+	{
+		while ((sequence_begin = sequence.load(std::memory_order_acquire)) & 1)
+			_mm_pause();
+
+		out_type = type;
+		out_data = data;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		sequence_end = sequence.load(std::memory_order_relaxed);
+	} while (sequence_begin != sequence_end);
+}
+void descriptor_tracking::descriptor_slot::store(descriptor_type new_type, const descriptor_data &new_data)
+{
+	sequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	type = new_type;
+	data = new_data;
+
+	sequence.fetch_add(1, std::memory_order_release);
+}
+
 buffer_range descriptor_tracking::get_buffer_range(descriptor_heap heap, uint32_t offset) const
 {
-	const descriptor_heap_data &heap_data = heaps.at(heap);
+	const auto heap_it = heaps.find(heap);
+	if (heap_it == heaps.end() || offset >= heap_it->second.descriptors.size())
+		return { 0 };
 
-	if (offset < heap_data.descriptors.size())
-	{
-		const std::pair<descriptor_type, descriptor_data> &descriptor = heap_data.descriptors[offset];
+	descriptor_type type;
+	descriptor_data data;
+	heap_it->second.descriptors[offset].load(type, data);
 
-		if (descriptor.first == descriptor_type::constant_buffer || descriptor.first == descriptor_type::acceleration_structure)
-			return descriptor.second.b;
-	}
+	if (type == descriptor_type::constant_buffer || type == descriptor_type::acceleration_structure)
+		return data.b;
 
 	return { 0 };
 }
 
 sampler descriptor_tracking::get_sampler(descriptor_heap heap, uint32_t offset) const
 {
-	const descriptor_heap_data &heap_data = heaps.at(heap);
+	const auto heap_it = heaps.find(heap);
+	if (heap_it == heaps.end() || offset >= heap_it->second.descriptors.size())
+		return { 0 };
 
-	if (offset < heap_data.descriptors.size())
-	{
-		const std::pair<descriptor_type, descriptor_data> &descriptor = heap_data.descriptors[offset];
+	descriptor_type type;
+	descriptor_data data;
+	heap_it->second.descriptors[offset].load(type, data);
 
-		if (descriptor.first == descriptor_type::sampler || descriptor.first == descriptor_type::sampler_with_resource_view)
-			return descriptor.second.t.sampler;
-	}
+	if (type == descriptor_type::sampler || type == descriptor_type::sampler_with_resource_view)
+		return data.t.sampler;
 
 	return { 0 };
 }
 resource_view descriptor_tracking::get_resource_view(descriptor_heap heap, uint32_t offset) const
 {
-	const descriptor_heap_data &heap_data = heaps.at(heap);
+	const auto heap_it = heaps.find(heap);
+	if (heap_it == heaps.end() || offset >= heap_it->second.descriptors.size())
+		return { 0 };
 
-	if (offset < heap_data.descriptors.size())
-	{
-		const std::pair<descriptor_type, descriptor_data> &descriptor = heap_data.descriptors[offset];
+	descriptor_type type;
+	descriptor_data data;
+	heap_it->second.descriptors[offset].load(type, data);
 
-		if (descriptor.first == descriptor_type::sampler_with_resource_view || descriptor.first == descriptor_type::shader_resource_view || descriptor.first == descriptor_type::unordered_access_view)
-			return descriptor.second.t.view;
-	}
+	if (type == descriptor_type::sampler_with_resource_view || type == descriptor_type::shader_resource_view || type == descriptor_type::unordered_access_view)
+		return data.t.view;
 
 	return { 0 };
 }
 
 pipeline_layout_param descriptor_tracking::get_pipeline_layout_param(pipeline_layout layout, uint32_t param) const
 {
-	const pipeline_layout_data &layout_data = layouts.at(layout);
+	const auto layout_it = layouts.find(layout);
+	if (layout_it == layouts.end() || param >= layout_it->second.params.size())
+		return {};
 
-	return layout_data.params[param];
+	return layout_it->second.params[param];
 }
 
 void descriptor_tracking::register_pipeline_layout(pipeline_layout layout, uint32_t count, const pipeline_layout_param *params)
@@ -125,7 +157,12 @@ bool descriptor_tracking::on_copy_descriptor_tables(device *device, uint32_t cou
 
 		for (uint32_t k = 0; k < copy.count; ++k)
 		{
-			dst_pool_data.descriptors[dst_offset + k] = src_pool_data.descriptors[src_offset + k];
+			descriptor_type type = {};
+			descriptor_data data;
+			if (src_offset + k < src_pool_data.descriptors.size())
+				src_pool_data.descriptors[src_offset + k].load(type, data);
+
+			dst_pool_data.descriptors[dst_offset + k].store(type, data);
 		}
 	}
 
@@ -151,27 +188,27 @@ bool descriptor_tracking::on_update_descriptor_tables(device *device, uint32_t c
 
 		for (uint32_t k = 0; k < update.count; ++k)
 		{
-			std::pair<descriptor_type, descriptor_data> &descriptor = heap_data.descriptors[offset + k];
-
-			descriptor.first = update.type;
+			descriptor_data data;
 
 			switch (update.type)
 			{
 			case descriptor_type::sampler:
-				descriptor.second.t.sampler = static_cast<const sampler *>(update.descriptors)[k];
+				data.t.sampler = static_cast<const sampler *>(update.descriptors)[k];
 				break;
 			case descriptor_type::sampler_with_resource_view:
-				descriptor.second.t = static_cast<const sampler_with_resource_view *>(update.descriptors)[k];
+				data.t = static_cast<const sampler_with_resource_view *>(update.descriptors)[k];
 				break;
 			case descriptor_type::shader_resource_view:
 			case descriptor_type::unordered_access_view:
-				descriptor.second.t.view = static_cast<const resource_view *>(update.descriptors)[k];
+				data.t.view = static_cast<const resource_view *>(update.descriptors)[k];
 				break;
 			case descriptor_type::constant_buffer:
 			case descriptor_type::acceleration_structure:
-				descriptor.second.b = static_cast<const buffer_range *>(update.descriptors)[k];
+				data.b = static_cast<const buffer_range *>(update.descriptors)[k];
 				break;
 			}
+
+			heap_data.descriptors[offset + k].store(update.type, data);
 		}
 	}
 
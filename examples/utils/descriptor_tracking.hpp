@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <concurrent_vector.h>
 #include <concurrent_unordered_map.h>
@@ -63,9 +64,27 @@ private:
 			reshade::api::sampler_with_resource_view t;
 		};
 	};
+	/// <summary>
+	/// A single descriptor, guarded by a sequence lock, so that readers never block and never observe a partially written descriptor.
+	/// The sequence is odd while a write is in progress and readers retry until they observe the same even sequence before and after reading.
+	/// </summary>
+	struct descriptor_slot
+	{
+		descriptor_slot() : sequence(0), type(), data() {}
+		// Only used by 'concurrent_vector' while growing, before the slot is visible to any other thread
+		descriptor_slot(const descriptor_slot &other) : sequence(other.sequence.load(std::memory_order_relaxed)), type(other.type), data(other.data) {}
+
+		void load(reshade::api::descriptor_type &out_type, descriptor_data &out_data) const;
+		void store(reshade::api::descriptor_type new_type, const descriptor_data &new_data);
+
+		std::atomic<uint32_t> sequence;
+		reshade::api::descriptor_type type;
+		descriptor_data data;
+	};
 	struct descriptor_heap_data
 	{
-		concurrency::concurrent_vector<std::pair<reshade::api::descriptor_type, descriptor_data>> descriptors;
+		// Elements of a 'concurrent_vector' never move when it grows, so no memory has to be reclaimed while readers may still access it
+		concurrency::concurrent_vector<descriptor_slot> descriptors;
 	};
 	struct descriptor_heap_hash : std::hash<uint64_t>
 	{
@@ -8,12 +8,30 @@
 #include <reshade.hpp>
 #include "config.hpp"
 #include "crc32_hash.hpp"
+#include "replace_archive.hpp"
+#include <climits>
 #include <vector>
 #include <filesystem>
 #include <stb_image.h>
 
 using namespace reshade::api;
 
+static const replace_archive &get_replace_archive()
+{
+	static const replace_archive archive([]() {
+		// Prepend executable directory to archive file
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+
+		std::filesystem::path archive_path = file_prefix;
+		archive_path  = archive_path.parent_path();
+		archive_path /= RESHADE_ADDON_TEXTURE_LOAD_ARCHIVE;
+		return archive_path;
+	}(), RESHADE_ADDON_HASH_MODE);
+
+	return archive;
+}
+
 bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete)
 {
 #if RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD
@@ -26,31 +44,48 @@ bool load_texture_image(const resource_desc &desc, subresource_data &data, std::
 			format_row_pitch(desc.texture.format, desc.texture.width)));
 #else
 	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
+	const uint32_t hash = compute_hash(
 		static_cast<const uint8_t *>(data.data),
 		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
 #endif
 
-	// Prepend executable directory to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+	int width = 0, height = 0, channels = 0;
+	stbi_uc *rgba_pixel_data_p = nullptr;
 
-	std::filesystem::path replace_path = file_prefix;
-	replace_path  = replace_path.parent_path();
-	replace_path /= RESHADE_ADDON_TEXTURE_LOAD_DIR;
+	// Prefer the packed archive if there is one, which only needs a binary search instead of a file system probe per texture
+	if (const replace_archive &archive = get_replace_archive(); archive.is_open())
+	{
+		const uint8_t *image_data = nullptr;
+		size_t image_data_size = 0;
+		if (!archive.find(hash, replace_archive_type(RESHADE_ADDON_TEXTURE_LOAD_FORMAT), image_data, image_data_size) || image_data_size > INT_MAX)
+			return false;
 
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", hash);
+		// Decode straight from the mapping, without reading the file into memory first
+		rgba_pixel_data_p = stbi_load_from_memory(image_data, static_cast<int>(image_data_size), &width, &height, &channels, STBI_rgb_alpha);
+	}
+	else
+	{
+		// Prepend executable directory to image files
+		wchar_t file_prefix[MAX_PATH] = L"";
+		GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
 
-	replace_path /= hash_string;
-	replace_path += RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
+		std::filesystem::path replace_path = file_prefix;
+		replace_path  = replace_path.parent_path();
+		replace_path /= RESHADE_ADDON_TEXTURE_LOAD_DIR;
 
-	// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
-	if (!std::filesystem::exists(replace_path))
-		return false;
+		wchar_t hash_string[11];
+		swprintf_s(hash_string, L"0x%08X", hash);
+
+		replace_path /= hash_string;
+		replace_path += RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
+
+		// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
+		if (!std::filesystem::exists(replace_path))
+			return false;
+
+		rgba_pixel_data_p = stbi_load(replace_path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	}
 
-	int width = 0, height = 0, channels = 0;
-	stbi_uc *const rgba_pixel_data_p = stbi_load(replace_path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
 	if (rgba_pixel_data_p == nullptr)
 		return false;
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+// Packed archive of replacement files, which avoids probing the file system for every created shader or texture
+//
+// An archive starts with a 'replace_archive_header', followed by the file contents, which are each aligned to 'replace_archive_alignment' bytes, and finally the index.
+// The index is an array of 'replace_archive_entry', sorted by hash and type, so that it can be binary searched in place after memory-mapping the archive.
+// Archives are built from the loose dump directories with the replace_pack tool.
+
+constexpr uint32_t replace_archive_magic = 0x4B505352; // 'RSPK'
+constexpr uint32_t replace_archive_version = 1;
+constexpr uint64_t replace_archive_alignment = 16;
+
+struct replace_archive_header
+{
+	uint32_t magic = replace_archive_magic;
+	uint32_t version = replace_archive_version;
+	/// <summary>
+	/// Hash mode the file names were created with (see 'RESHADE_ADDON_HASH_MODE'), since hashes of different modes do not match.
+	/// </summary>
+	uint32_t hash_mode = 1;
+	uint32_t entry_count = 0;
+	uint64_t index_offset = 0;
+};
+static_assert(sizeof(replace_archive_header) == 24);
+
+struct replace_archive_entry
+{
+	uint32_t hash;
+	/// <summary>
+	/// File extension the entry was created from, see <see cref="replace_archive_type"/>.
+	/// </summary>
+	uint32_t type;
+	uint64_t offset;
+	uint64_t size;
+
+	bool operator<(const replace_archive_entry &other) const { return hash < other.hash || (hash == other.hash && type < other.type); }
+};
+static_assert(sizeof(replace_archive_entry) == 24);
+
+/// <summary>
+/// Packs up to the first four characters of a file extension (without the leading dot, e.g. "cso" or "glsl") into an entry type.
+/// </summary>
+template <typename T>
+inline uint32_t replace_archive_type(const T *extension)
+{
+	if (*extension == T('.'))
+		++extension;
+
+	uint32_t type = 0;
+	for (int i = 0; i < 4 && extension[i] != T('\0'); ++i)
+		type |= static_cast<uint32_t>(static_cast<uint8_t>(extension[i] >= T('A') && extension[i] <= T('Z') ? extension[i] - T('A') + T('a') : extension[i])) << (i * 8);
+	return type;
+}
+
+// The reader is only available to add-ons (which include 'reshade.hpp' first), not to the replace_pack tool
+#ifdef RESHADE_API_VERSION
+
+/// <summary>
+/// Read-only view of a memory-mapped replacement archive.
+/// Returned data points straight into the mapping and stays valid for as long as the archive is open.
+/// </summary>
+class replace_archive
+{
+public:
+	replace_archive() = default;
+	/// <summary>
+	/// Opens the archive at the specified path, see <see cref="open"/>. Use <see cref="is_open"/> to check whether that succeeded.
+	/// </summary>
+	replace_archive(const std::filesystem::path &path, uint32_t hash_mode)
+	{
+		open(path, hash_mode);
+	}
+	replace_archive(const replace_archive &) = delete;
+	replace_archive &operator=(const replace_archive &) = delete;
+	~replace_archive()
+	{
+		close();
+	}
+
+	/// <summary>
+	/// Opens and validates the archive at the specified path.
+	/// </summary>
+	/// <param name="hash_mode">Hash mode the caller computes hashes with, which the archive has to have been created with as well.</param>
+	bool open(const std::filesystem::path &path, uint32_t hash_mode)
+	{
+		close();
+
+		_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size = {};
+		if (!GetFileSizeEx(_file, &file_size) || static_cast<uint64_t>(file_size.QuadPart) < sizeof(replace_archive_header) || static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX)
+		{
+			close();
+			return false;
+		}
+
+		_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping == nullptr || (_data = static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0))) == nullptr)
+		{
+			reshade::log::message(reshade::log::level::error, ("Failed to map replacement archive \"" + path.u8string() + "\"!").c_str());
+			close();
+			return false;
+		}
+
+		_size = static_cast<size_t>(file_size.QuadPart);
+
+		replace_archive_header header;
+		std::memcpy(&header, _data, sizeof(header));
+
+		if (header.magic != replace_archive_magic || header.version != replace_archive_version ||
+			header.index_offset > _size || header.entry_count > (_size - header.index_offset) / sizeof(replace_archive_entry))
+		{
+			reshade::log::message(reshade::log::level::error, ("Replacement archive \"" + path.u8string() + "\" is invalid!").c_str());
+			close();
+			return false;
+		}
+		if (header.hash_mode != hash_mode)
+		{
+			reshade::log::message(reshade::log::level::error, ("Replacement archive \"" + path.u8string() + "\" was created with hash mode " + std::to_string(header.hash_mode) + ", but hash mode " + std::to_string(hash_mode) + " is in use!").c_str());
+			close();
+			return false;
+		}
+
+		_entries = reinterpret_cast<const replace_archive_entry *>(_data + header.index_offset);
+		_entry_count = header.entry_count;
+
+		reshade::log::message(reshade::log::level::info, ("Opened replacement archive \"" + path.u8string() + "\" with " + std::to_string(_entry_count) + " entries.").c_str());
+
+		return true;
+	}
+	void close()
+	{
+		if (_data != nullptr)
+			UnmapViewOfFile(_data);
+		_data = nullptr;
+		if (_mapping != nullptr)
+			CloseHandle(_mapping);
+		_mapping = nullptr;
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+
+		_size = 0;
+		_entries = nullptr;
+		_entry_count = 0;
+	}
+
+	bool is_open() const { return _data != nullptr; }
+
+	/// <summary>
+	/// Looks up the replacement data for the specified hash and type.
+	/// </summary>
+	/// <param name="data">Pointer that is set to the beginning of the data in the mapping.</param>
+	/// <param name="size">Value that is set to the size of the data in bytes.</param>
+	/// <returns><see langword="true"/> if the archive contains such an entry, <see langword="false"/> otherwise.</returns>
+	bool find(uint32_t hash, uint32_t type, const uint8_t *&data, size_t &size) const
+	{
+		const replace_archive_entry key = { hash, type };
+		const replace_archive_entry *const it = std::lower_bound(_entries, _entries + _entry_count, key);
+		if (it == _entries + _entry_count || it->hash != hash || it->type != type)
+			return false;
+
+		// Index was validated to be in bounds on open, but entries were not
+		if (it->offset > _size || it->size > _size - it->offset)
+			return false;
+
+		data = _data + it->offset;
+		size = static_cast<size_t>(it->size);
+		return true;
+	}
+
+private:
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+	const uint8_t *_data = nullptr;
+	size_t _size = 0;
+	const replace_archive_entry *_entries = nullptr;
+	size_t _entry_count = 0;
+};
+
+#endif
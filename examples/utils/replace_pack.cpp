@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+// Command-line tool that packs a directory of replacement files (e.g. "shaderreplace" or "texreplace") into an archive the shader_replace and texture_replace add-ons can load
+// Usage: replace_pack <input directory> <output archive> [--hash-mode <mode>]
+
+#include "replace_archive.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <fstream>
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "usage: %s <input directory> <output archive> [--hash-mode <mode>]\n", argv[0]);
+		return 1;
+	}
+
+	const std::filesystem::path input_path = std::filesystem::u8path(argv[1]);
+	const std::filesystem::path output_path = std::filesystem::u8path(argv[2]);
+
+	replace_archive_header header;
+	if (argc > 4 && std::strcmp(argv[3], "--hash-mode") == 0)
+		header.hash_mode = static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10));
+
+	std::error_code ec;
+	std::vector<std::pair<replace_archive_entry, std::filesystem::path>> files;
+
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(input_path, ec))
+	{
+		if (!entry.is_regular_file(ec))
+			continue;
+
+		// Only consider files that follow the "0x[hash].[extension]" naming scheme the dump add-ons use
+		const std::string file_name = entry.path().stem().u8string();
+		const std::string extension = entry.path().extension().u8string();
+		char *hash_end = nullptr;
+		const unsigned long hash = std::strtoul(file_name.c_str(), &hash_end, 16);
+		if (file_name.size() != 10 || file_name.compare(0, 2, "0x") != 0 || hash_end != file_name.c_str() + file_name.size() || extension.size() < 2)
+		{
+			std::fprintf(stderr, "warning: skipping '%s', since it is not named after a hash\n", entry.path().u8string().c_str());
+			continue;
+		}
+
+		replace_archive_entry archive_entry = {};
+		archive_entry.hash = static_cast<uint32_t>(hash);
+		archive_entry.type = replace_archive_type(extension.c_str());
+		archive_entry.size = entry.file_size(ec);
+
+		files.emplace_back(archive_entry, entry.path());
+	}
+
+	if (ec)
+	{
+		std::fprintf(stderr, "error: failed to read directory '%s': %s\n", input_path.u8string().c_str(), ec.message().c_str());
+		return 1;
+	}
+
+	std::sort(files.begin(), files.end(),
+		[](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+	for (size_t i = 1; i < files.size(); ++i)
+	{
+		if (!(files[i - 1].first < files[i].first))
+		{
+			std::fprintf(stderr, "error: '%s' and '%s' map to the same archive entry\n", files[i - 1].second.u8string().c_str(), files[i].second.u8string().c_str());
+			return 1;
+		}
+	}
+
+	std::ofstream output(output_path, std::ios::binary);
+	if (!output)
+	{
+		std::fprintf(stderr, "error: failed to open '%s' for writing\n", output_path.u8string().c_str());
+		return 1;
+	}
+
+	// Write a placeholder header first, which is overwritten with the final index location at the end
+	output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	uint64_t offset = sizeof(header);
+	std::vector<char> data;
+	std::vector<replace_archive_entry> index;
+	index.reserve(files.size());
+
+	const auto align_output = [&output, &offset](uint64_t alignment) {
+		static const char padding[replace_archive_alignment] = {};
+		const uint64_t aligned_offset = (offset + alignment - 1) & ~(alignment - 1);
+		output.write(padding, static_cast<std::streamsize>(aligned_offset - offset));
+		offset = aligned_offset;
+	};
+
+	for (auto &[archive_entry, path] : files)
+	{
+		std::ifstream file(path, std::ios::binary);
+		data.resize(static_cast<size_t>(archive_entry.size));
+		if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+		{
+			std::fprintf(stderr, "error: failed to read '%s'\n", path.u8string().c_str());
+			return 1;
+		}
+
+		align_output(replace_archive_alignment);
+
+		archive_entry.offset = offset;
+		output.write(data.data(), static_cast<std::streamsize>(data.size()));
+		offset += data.size();
+
+		index.push_back(archive_entry);
+	}
+
+	align_output(alignof(replace_archive_entry));
+
+	header.entry_count = static_cast<uint32_t>(index.size());
+	header.index_offset = offset;
+	output.write(reinterpret_cast<const char *>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(replace_archive_entry)));
+
+	output.seekp(0);
+	output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	if (!output)
+	{
+		std::fprintf(stderr, "error: failed to write '%s'\n", output_path.u8string().c_str());
+		return 1;
+	}
+
+	std::printf("Packed %u files into '%s' (hash mode %u).\n", header.entry_count, output_path.u8string().c_str(), header.hash_mode);
+
+	return 0;
+}
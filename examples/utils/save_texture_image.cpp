@@ -87,7 +87,7 @@ static void unpack_bc4_value(uint8_t alpha_0, uint8_t alpha_1, uint32_t alpha_in
 	}
 }
 
-bool save_texture_image(const resource_desc &desc, const subresource_data &data)
+uint32_t compute_texture_hash(const resource_desc &desc, const subresource_data &data)
 {
 #if RESHADE_ADDON_TEXTURE_SAVE_HASH_TEXMOD
 	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
@@ -99,10 +99,21 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 			format_row_pitch(desc.texture.format, desc.texture.width)));
 #else
 	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
+	const uint32_t hash = compute_hash(
 		static_cast<const uint8_t *>(data.data),
 		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
 #endif
+	return hash;
+}
+size_t compute_texture_data_size(const resource_desc &desc, const subresource_data &data)
+{
+	// Both hash variants above never read more than one slice of the base level
+	return format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height);
+}
+
+bool save_texture_image(const resource_desc &desc, const subresource_data &data)
+{
+	const uint32_t hash = compute_texture_hash(desc, data);
 
 #if RESHADE_ADDON_TEXTURE_SAVE_ENABLE_HASH_SET
 	static std::set<uint32_t> hash_set;
@@ -117,6 +128,10 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 	}
 #endif
 
+	return save_texture_image(desc, data, hash);
+}
+bool save_texture_image(const resource_desc &desc, const subresource_data &data, uint32_t hash)
+{
 	const uint32_t block_count_x = (desc.texture.width + 3) / 4;
 	const uint32_t block_count_y = (desc.texture.height + 3) / 4;
 
@@ -32,8 +32,33 @@ void state_block::apply(command_list *cmd_list) const
 	if (!scissor_rects.empty())
 		cmd_list->bind_scissor_rects(0, static_cast<uint32_t>(scissor_rects.size()), scissor_rects.data());
 
-	for (const auto &[stages, descriptor_state] : descriptor_tables)
-		cmd_list->bind_descriptor_tables(stages, descriptor_state.first, 0, static_cast<uint32_t>(descriptor_state.second.size()), descriptor_state.second.data());
+	for (const descriptor_table_state &descriptor_state : descriptor_tables)
+		cmd_list->bind_descriptor_tables(descriptor_state.stages, descriptor_state.layout, 0, static_cast<uint32_t>(descriptor_state.tables.size()), descriptor_state.tables.data());
+}
+
+pipeline &state_block::pipeline_for(pipeline_stage stages)
+{
+	for (auto &[pipeline_stages, pipeline] : pipelines)
+		if (pipeline_stages == stages)
+			return pipeline;
+
+	auto &entry = pipelines.push_back_reuse();
+	entry.first = stages;
+	entry.second = { 0 };
+	return entry.second;
+}
+
+state_block::descriptor_table_state &state_block::descriptor_tables_for(shader_stage stages)
+{
+	for (descriptor_table_state &descriptor_state : descriptor_tables)
+		if (descriptor_state.stages == stages)
+			return descriptor_state;
+
+	descriptor_table_state &descriptor_state = descriptor_tables.push_back_reuse();
+	descriptor_state.stages = stages;
+	descriptor_state.layout = { 0 };
+	descriptor_state.tables.clear();
+	return descriptor_state;
 }
 
 void state_block::clear()
@@ -51,6 +76,16 @@ void state_block::clear()
 	descriptor_tables.clear();
 }
 
+static uint32_t s_private_data_slot = UINT32_MAX;
+
+static state_tracking &get_state(command_list *cmd_list)
+{
+	// Accessing the slot avoids looking up the GUID on every bind event, but fall back to that in case no slot was available
+	if (s_private_data_slot != UINT32_MAX)
+		return *reinterpret_cast<state_tracking *>(static_cast<uintptr_t>(cmd_list->get_private_data_slot(s_private_data_slot)));
+	return *cmd_list->get_private_data<state_tracking>();
+}
+
 static void on_init_command_list(command_list *cmd_list)
 {
 	cmd_list->create_private_data<state_tracking>();
@@ -62,20 +97,20 @@ static void on_destroy_command_list(command_list *cmd_list)
 
 static void on_bind_render_targets_and_depth_stencil(command_list *cmd_list, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
+	auto &state = get_state(cmd_list);
 	state.render_targets.assign(rtvs, rtvs + count);
 	state.depth_stencil = dsv;
 }
 
 static void on_bind_pipeline(command_list *cmd_list, pipeline_stage stages, pipeline pipeline)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
-	state.pipelines[stages] = pipeline;
+	auto &state = get_state(cmd_list);
+	state.pipeline_for(stages) = pipeline;
 }
 
 static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, const dynamic_state *states, const uint32_t *values)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
+	auto &state = get_state(cmd_list);
 
 	for (uint32_t i = 0; i < count; ++i)
 	{
@@ -102,7 +137,7 @@ static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, cons
 
 static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t count, const viewport *viewports)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
+	auto &state = get_state(cmd_list);
 
 	const uint32_t total_count = first + count;
 	if (state.viewports.size() < total_count)
@@ -114,7 +149,7 @@ static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t c
 
 static void on_bind_scissor_rects(command_list *cmd_list, uint32_t first, uint32_t count, const rect *rects)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
+	auto &state = get_state(cmd_list);
 
 	const uint32_t total_count = first + count;
 	if (state.scissor_rects.size() < total_count)
@@ -126,28 +161,31 @@ static void on_bind_scissor_rects(command_list *cmd_list, uint32_t first, uint32
 
 static void on_bind_descriptor_tables(command_list *cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table *tables)
 {
-	auto &state = cmd_list->get_private_data<state_tracking>()->descriptor_tables[stages];
+	auto &state = get_state(cmd_list).descriptor_tables_for(stages);
 
-	if (layout != state.first)
-		state.second.clear(); // Layout changed, which resets all descriptor table bindings
-	state.first = layout;
+	if (layout != state.layout)
+		state.tables.clear(); // Layout changed, which resets all descriptor table bindings
+	state.layout = layout;
 
 	const uint32_t total_count = first + count;
-	if (state.second.size() < total_count)
-		state.second.resize(total_count);
+	if (state.tables.size() < total_count)
+		state.tables.resize(total_count);
 
 	for (uint32_t i = 0; i < count; ++i)
-		state.second[i + first] = tables[i];
+		state.tables[i + first] = tables[i];
 }
 
 static void on_reset_command_list(command_list *cmd_list)
 {
-	auto &state = *cmd_list->get_private_data<state_tracking>();
+	auto &state = get_state(cmd_list);
 	state.clear();
 }
 
 void state_tracking::register_events()
 {
+	// Register the slot before any state is created, so that all private data of this type is stored in it
+	s_private_data_slot = reshade::register_private_data_slot<state_tracking>();
+
 	reshade::register_event<reshade::addon_event::init_command_list>(on_init_command_list);
 	reshade::register_event<reshade::addon_event::destroy_command_list>(on_destroy_command_list);
 
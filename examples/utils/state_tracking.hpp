@@ -6,7 +6,81 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <algorithm>
+
+/// <summary>
+/// A vector that stores up to <typeparamref name="N"/> elements inline and only spills to the heap when it grows beyond that.
+/// Clearing it keeps any spilled storage around, so that state tracking does not allocate again after a command list is reset.
+/// </summary>
+template <typename T, size_t N>
+class inline_vector
+{
+public:
+	T *data() { return _size <= N ? _inline : _spill.data(); }
+	const T *data() const { return _size <= N ? _inline : _spill.data(); }
+
+	T *begin() { return data(); }
+	const T *begin() const { return data(); }
+	T *end() { return data() + _size; }
+	const T *end() const { return data() + _size; }
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+	T &operator[](size_t index) { return data()[index]; }
+	const T &operator[](size_t index) const { return data()[index]; }
+
+	/// <summary>
+	/// Changes the number of elements, value-initializing any new ones.
+	/// </summary>
+	void resize(size_t size)
+	{
+		const size_t old_size = grow(size);
+		std::fill(data() + old_size, data() + size, T());
+	}
+	/// <summary>
+	/// Replaces the elements with the specified range.
+	/// </summary>
+	void assign(const T *first, const T *last)
+	{
+		const size_t size = static_cast<size_t>(last - first);
+		grow(size);
+		std::copy(first, last, data());
+	}
+	/// <summary>
+	/// Appends an element and returns a reference to it, without resetting it, so that elements reuse any storage they own from before the last <see cref="clear"/>.
+	/// </summary>
+	T &push_back_reuse()
+	{
+		grow(_size + 1);
+		return data()[_size - 1];
+	}
+
+	void clear() { _size = 0; }
+
+private:
+	size_t grow(size_t size)
+	{
+		const size_t old_size = _size;
+		if (size > N)
+		{
+			if (_spill.size() < size)
+				_spill.resize(std::max(size, N * 2));
+			if (old_size <= N)
+				std::copy(_inline, _inline + std::min(old_size, size), _spill.begin());
+		}
+		else if (old_size > N)
+		{
+			std::copy(_spill.begin(), _spill.begin() + size, _inline);
+		}
+		_size = size;
+		return std::min(old_size, size);
+	}
+
+	T _inline[N] = {};
+	std::vector<T> _spill;
+	size_t _size = 0;
+};
 
 /// <summary>
 /// A state block capturing current state of a command list.
@@ -24,17 +98,33 @@ struct state_block
 	/// </summary>
 	void clear();
 
-	std::vector<reshade::api::resource_view> render_targets;
+	struct descriptor_table_state
+	{
+		reshade::api::shader_stage stages = {};
+		reshade::api::pipeline_layout layout = { 0 };
+		inline_vector<reshade::api::descriptor_table, 16> tables;
+	};
+
+	/// <summary>
+	/// Gets the pipeline bound to the specified pipeline stages, adding an entry if none exists yet.
+	/// </summary>
+	reshade::api::pipeline &pipeline_for(reshade::api::pipeline_stage stages);
+	/// <summary>
+	/// Gets the descriptor table bindings for the specified shader stages, adding an entry if none exists yet.
+	/// </summary>
+	descriptor_table_state &descriptor_tables_for(reshade::api::shader_stage stages);
+
+	inline_vector<reshade::api::resource_view, 8> render_targets;
 	reshade::api::resource_view depth_stencil = { 0 };
-	std::unordered_map<reshade::api::pipeline_stage, reshade::api::pipeline> pipelines;
+	inline_vector<std::pair<reshade::api::pipeline_stage, reshade::api::pipeline>, 8> pipelines;
 	reshade::api::primitive_topology primitive_topology = reshade::api::primitive_topology::undefined;
 	uint32_t blend_constant = 0;
 	uint32_t sample_mask = 0xFFFFFFFF;
 	uint32_t front_stencil_reference_value = 0;
 	uint32_t back_stencil_reference_value = 0;
-	std::vector<reshade::api::viewport> viewports;
-	std::vector<reshade::api::rect> scissor_rects;
-	std::unordered_map<reshade::api::shader_stage, std::pair<reshade::api::pipeline_layout, std::vector<reshade::api::descriptor_table>>> descriptor_tables;
+	inline_vector<reshade::api::viewport, 16> viewports;
+	inline_vector<reshade::api::rect, 16> scissor_rects;
+	inline_vector<descriptor_table_state, 4> descriptor_tables;
 };
 
 /// <summary>
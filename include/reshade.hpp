@@ -11,7 +11,7 @@
 #include <Windows.h>
 
 // Current version of the ReShade API
-#define RESHADE_API_VERSION 16
+#define RESHADE_API_VERSION 20
 
 // Optionally import ReShade API functions when 'RESHADE_API_LIBRARY' is defined instead of using header-only mode
 #if defined(RESHADE_API_LIBRARY) || defined(RESHADE_API_LIBRARY_EXPORT)
@@ -27,6 +27,8 @@ RESHADE_API_LIBRARY_DECL void ReShadeLogMessage(HMODULE module, int level, const
 
 RESHADE_API_LIBRARY_DECL void ReShadeGetBasePath(char *path, size_t *path_size);
 
+RESHADE_API_LIBRARY_DECL uint32_t ReShadeRegisterPrivateDataSlot(const uint8_t guid[16]);
+
 RESHADE_API_LIBRARY_DECL bool ReShadeGetConfigValue(HMODULE module, reshade::api::effect_runtime *runtime, const char *section, const char *key, char *value, size_t *value_size);
 RESHADE_API_LIBRARY_DECL void ReShadeSetConfigValue(HMODULE module, reshade::api::effect_runtime *runtime, const char *section, const char *key, const char *value);
 RESHADE_API_LIBRARY_DECL void ReShadeSetConfigArray(HMODULE module, reshade::api::effect_runtime *runtime, const char *section, const char *key, const char *value, size_t value_size);
@@ -157,6 +159,29 @@ namespace reshade
 #endif
 	}
 
+	/// <summary>
+	/// Registers a private data slot for the specified <paramref name="guid"/>, so that the private data associated with it can be accessed
+	/// via <see cref="api::api_object::get_private_data_slot"/> and <see cref="api::api_object::set_private_data_slot"/> without looking up the GUID.
+	/// Registering the same GUID again returns the same slot. Call this before private data with this GUID is stored in any object.
+	/// </summary>
+	/// <param name="guid">GUID the private data is associated with.</param>
+	/// <returns>Index of the slot, or <c>UINT32_MAX</c> if all <see cref="api::api_object::max_private_data_slots"/> slots are already in use (in which case the GUID-based functions have to be used instead).</returns>
+	inline uint32_t register_private_data_slot(const uint8_t guid[16])
+	{
+#if defined(RESHADE_API_LIBRARY)
+		return ReShadeRegisterPrivateDataSlot(guid);
+#else
+		static const auto func = reinterpret_cast<uint32_t(*)(const uint8_t *)>(
+			GetProcAddress(internal::get_reshade_module_handle(), "ReShadeRegisterPrivateDataSlot"));
+		return func(guid);
+#endif
+	}
+	template <typename T>
+	inline uint32_t register_private_data_slot()
+	{
+		return register_private_data_slot(reinterpret_cast<const uint8_t *>(&__uuidof(T)));
+	}
+
 	/// <summary>
 	/// Gets a value from one of ReShade's config files.
 	/// This can use either the global config file (ReShade.ini next to the application executable), or one local to an effect runtime (ReShade[index].ini in the base path).
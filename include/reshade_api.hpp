@@ -43,6 +43,79 @@ namespace reshade { namespace api
 		clipboard = 4,
 	};
 
+	/// <summary>
+	/// Stages of the work an effect runtime does on the CPU during every present.
+	/// </summary>
+	enum class present_stage
+	{
+		capture_state = 0,
+		resolve = 1,
+		update_effects = 2,
+		render_effects = 3,
+		screenshot = 4,
+		draw_gui = 5,
+		apply_state = 6,
+		count
+	};
+
+	/// <summary>
+	/// CPU time statistics of a present stage over the recently presented frames, in nanoseconds.
+	/// </summary>
+	struct present_stage_statistics
+	{
+		uint64_t last;
+		uint64_t min;
+		uint64_t average;
+		uint64_t p99;
+		uint32_t num_frames;
+	};
+
+	/// <summary>
+	/// State of a vehicle in the game world, see <see cref="effect_runtime::get_nfs_vehicles"/>.
+	/// </summary>
+	struct nfs_vehicle
+	{
+		/// <summary>
+		/// Position of the vehicle in world space.
+		/// </summary>
+		float position[3];
+		/// <summary>
+		/// Speed of the vehicle in world units per second, derived from the distance it moved since the previous simulation tick.
+		/// </summary>
+		float speed;
+		/// <summary>
+		/// Rotation of the vehicle, as the first three rows of the matrix of its rigid body.
+		/// </summary>
+		float orientation[3][3];
+	};
+
+	/// <summary>
+	/// Describes an update to the value of a uniform variable, see <see cref="effect_runtime::set_uniform_values"/>.
+	/// </summary>
+	struct effect_uniform_value_update
+	{
+		/// <summary>
+		/// Opaque handle to the uniform variable.
+		/// </summary>
+		effect_uniform_variable variable;
+		/// <summary>
+		/// Type of the values pointed to by <see cref="values"/>, which is either <see cref="format::r32_float"/>, <see cref="format::r32_sint"/>, <see cref="format::r32_uint"/> or <see cref="format::r32_typeless"/> for 32-bit booleans (where zero is <see langword="false"/> and anything else is <see langword="true"/>).
+		/// </summary>
+		format type;
+		/// <summary>
+		/// Array offset to start writing values to when the uniform variable is an array variable.
+		/// </summary>
+		uint32_t array_index;
+		/// <summary>
+		/// Number of values to write.
+		/// </summary>
+		uint32_t count;
+		/// <summary>
+		/// Pointer to an array of <see cref="count"/> values of the specified <see cref="type"/>.
+		/// </summary>
+		const void *values;
+	};
+
 	/// <summary>
 	/// A post-processing effect runtime, used to control effects.
 	/// <para>ReShade associates an independent post-processing effect runtime with most swap chains.</para>
@@ -812,5 +885,39 @@ namespace reshade { namespace api
 		/// </summary>
 		/// <param name="path">File path to the preset to save to.</param>
 		virtual void export_current_preset(const char *path) const = 0;
+
+		/// <summary>
+		/// Gets the CPU time statistics of the specified present stage over the recently presented frames.
+		/// </summary>
+		/// <param name="stage">Stage to get the statistics for.</param>
+		/// <param name="out_stats">Pointer to a variable that is set to the statistics.</param>
+		/// <returns><see langword="true"/> if statistics were gathered for at least one frame, <see langword="false"/> otherwise.</returns>
+		virtual bool get_present_stage_statistics(present_stage stage, present_stage_statistics *out_stats) const = 0;
+
+		/// <summary>
+		/// Sets the values of multiple uniform variables at once, which is cheaper than calling <see cref="set_uniform_value_float"/> and friends for each of them.
+		/// Updates with an invalid variable handle or value type are skipped.
+		/// </summary>
+		/// <param name="count">Number of updates to process.</param>
+		/// <param name="updates">Pointer to an array of updates to apply, in order.</param>
+		///	<remarks>
+		/// Setting the uniform values will not automatically save the current preset.
+		/// To make sure the current preset with the changed values is saved to disk, explicitly call <see cref="save_current_preset"/>.
+		/// </remarks>
+		virtual void set_uniform_values(uint32_t count, const effect_uniform_value_update *updates) = 0;
+
+		/// <summary>
+		/// Gets a counter that is incremented every time effects are destroyed or finished loading.
+		/// Handles returned by <see cref="find_uniform_variable"/>, <see cref="find_texture_variable"/> and <see cref="find_technique"/> stay valid for as long as this value does not change, so add-ons can cache them and compare the value each frame instead of looking them up again.
+		/// </summary>
+		virtual uint64_t get_effect_generation() const = 0;
+
+		/// <summary>
+		/// Gets the active vehicles in the game world, as they were published by the last simulation tick before effects were updated this frame.
+		/// </summary>
+		/// <param name="max_count">Maximum number of vehicles to write to <paramref name="out_vehicles"/>.</param>
+		/// <param name="out_vehicles">Optional pointer to an array that is filled with the vehicles.</param>
+		/// <returns>Total number of active vehicles, which may be larger than <paramref name="max_count"/>.</returns>
+		virtual uint32_t get_nfs_vehicles(uint32_t max_count, nfs_vehicle *out_vehicles) const = 0;
 	};
 } }
@@ -294,6 +294,42 @@ namespace reshade { namespace api
 			delete get_private_data<T>();
 			set_private_data(reinterpret_cast<const uint8_t *>(&__uuidof(T)), 0);
 		}
+
+		/// <summary>
+		/// Maximum number of private data slots that can be registered via <see cref="reshade::register_private_data_slot"/>.
+		/// </summary>
+		static constexpr uint32_t max_private_data_slots = 16;
+
+		/// <summary>
+		/// Gets a user-defined 64-bit value from the specified private data slot of the object, or zero if none was set.
+		/// This is equivalent to calling <see cref="get_private_data"/> with the GUID the slot was registered for, but avoids having to look up that GUID.
+		/// </summary>
+		/// <param name="slot">Index of the slot returned by <see cref="reshade::register_private_data_slot"/>.</param>
+		uint64_t get_private_data_slot(uint32_t slot) const
+		{
+			const uint32_t key[4] = { private_data_slot_key[0], private_data_slot_key[1], private_data_slot_key[2], slot };
+			uint64_t res;
+			get_private_data(reinterpret_cast<const uint8_t *>(key), &res);
+			return res;
+		}
+		/// <summary>
+		/// Stores a user-defined 64-bit value in the specified private data slot of the object.
+		/// This is equivalent to calling <see cref="set_private_data"/> with the GUID the slot was registered for, but avoids having to look up that GUID.
+		/// </summary>
+		/// <param name="slot">Index of the slot returned by <see cref="reshade::register_private_data_slot"/>.</param>
+		/// <remarks>
+		/// This function may NOT be called concurrently from multiple threads!
+		/// </remarks>
+		void set_private_data_slot(uint32_t slot, const uint64_t data)
+		{
+			const uint32_t key[4] = { private_data_slot_key[0], private_data_slot_key[1], private_data_slot_key[2], slot };
+			set_private_data(reinterpret_cast<const uint8_t *>(key), data);
+		}
+
+		/// <summary>
+		/// Reserved GUID prefix that identifies a private data slot, with the slot index stored in the remaining four bytes.
+		/// </summary>
+		static constexpr uint32_t private_data_slot_key[3] = { 0x7C1A39D2, 0x4E0B8F61, 0xA5D3E870 };
 	};
 
 	/// <summary>
@@ -1715,11 +1715,80 @@ namespace reshade
 		/// </remarks>
 		reshade_overlay_technique,
 
+		/// <summary>
+		/// Called with the draw and pipeline state commands that were recorded on a command list since the last call, at these synchronization points:
+		/// <list type="bullet">
+		/// <item><description><see cref="end_render_pass"/></description></item>
+		/// <item><description><see cref="close_command_list"/></description></item>
+		/// <item><description><see cref="execute_command_list"/></description></item>
+		/// <item><description><see cref="present"/> (for the immediate command list of the queue)</description></item>
+		/// <item><description><see cref="destroy_command_list"/></description></item>
+		/// </list>
+		/// <para>Callback function signature: <c>void (api::command_list *cmd_list, uint32_t count, const api::command_batch_record *records)</c></para>
+		/// </summary>
+		/// <remarks>
+		/// Registering a callback for this event enables recording of <see cref="draw"/>, <see cref="draw_indexed"/>, <see cref="bind_pipeline_states"/> and <see cref="push_descriptors"/> commands into a compact per-command list buffer.
+		/// This is a lot cheaper than receiving each of these events individually and therefore meant for add-ons that only analyze commands (e.g. to count draw calls).
+		/// Recorded commands cannot be skipped and do not include the descriptor contents of <see cref="push_descriptors"/>, so register the individual events for that instead.
+		/// </remarks>
+		command_batch = 96,
+
 #if RESHADE_ADDON
-		max = 96 // Last value used internally by ReShade to determine number of events in this enum
+		max = 97 // Last value used internally by ReShade to determine number of events in this enum
 #endif
 	};
 
+	namespace api
+	{
+		/// <summary>
+		/// A command that was recorded for the <see cref="addon_event::command_batch"/> event.
+		/// </summary>
+		struct command_batch_record
+		{
+			/// <summary>
+			/// Event the command was recorded for, which also determines the member of the union that is valid.
+			/// </summary>
+			addon_event type;
+
+			union
+			{
+				struct
+				{
+					uint32_t vertex_count;
+					uint32_t instance_count;
+					uint32_t first_vertex;
+					uint32_t first_instance;
+				} draw;
+				struct
+				{
+					uint32_t index_count;
+					uint32_t instance_count;
+					uint32_t first_index;
+					int32_t vertex_offset;
+					uint32_t first_instance;
+				} draw_indexed;
+				/// <summary>
+				/// A <see cref="addon_event::bind_pipeline_states"/> command is recorded as one record per state.
+				/// </summary>
+				struct
+				{
+					dynamic_state state;
+					uint32_t value;
+				} bind_pipeline_state;
+				struct
+				{
+					shader_stage stages;
+					uint32_t layout_param;
+					pipeline_layout layout;
+					uint32_t binding;
+					uint32_t array_offset;
+					uint32_t count;
+					descriptor_type type;
+				} push_descriptors;
+			};
+		};
+	}
+
 	template <addon_event ev>
 	struct addon_event_traits;
 
@@ -1859,4 +1928,6 @@ namespace reshade
 
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_uniform_variable, bool, api::effect_runtime *runtime, api::effect_uniform_variable variable);
 	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::reshade_overlay_technique, bool, api::effect_runtime *runtime, api::effect_technique technique);
+
+	RESHADE_DEFINE_ADDON_EVENT_TRAITS(addon_event::command_batch, void, api::command_list *cmd_list, uint32_t count, const api::command_batch_record *records);
 }
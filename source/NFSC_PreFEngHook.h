@@ -6,6 +6,9 @@
 #ifndef HAS_FOG_CTRL
 #define HAS_FOG_CTRL
 #endif
+#ifndef HAS_PRECIP_BUDGET
+#define HAS_PRECIP_BUDGET
+#endif
 #ifndef HAS_DAL
 #define HAS_DAL
 #endif
@@ -155,6 +158,9 @@
 #define VEHICLE_LISTABLESET_ADDR 0x00A9F1E4
 #define IRIGIDBODY_HANDLE_ADDR 0x00403750
 #define RB_GETMATRIX4_OFFSET 0x40
+// The vehicle table is a UTL::Vector, whose element pointer is followed by its capacity and size
+#define VEHICLE_LISTABLESET_CAPACITY_OFFSET 0x4
+#define VEHICLE_LISTABLESET_SIZE_OFFSET 0x8
 #define RB_SETORIENTATION_OFFSET 0x70
 
 // infinite cheats stuff
@@ -251,3 +257,6 @@
 void __stdcall FEManager_Render_Hook();
 void __stdcall FECareerRecord_AdjustHeatOnEventWin_Hook();
 bool __stdcall EasterEggCheck_Hook(int cheat);
+struct bVector3;
+void __cdecl Sim_SetStream_Hook(bVector3* location, bool blocking);
+void __fastcall GameFlowManager_LoadRegion_Hook(void* dis, void* edx);
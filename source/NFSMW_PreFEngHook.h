@@ -6,6 +6,9 @@
 #ifndef HAS_FOG_CTRL
 #define HAS_FOG_CTRL
 #endif
+#ifndef HAS_PRECIP_BUDGET
+#define HAS_PRECIP_BUDGET
+#endif
 #define FEMANAGER_RENDER_HOOKADDR1 0x006E71D0
 #define FEMANAGER_RENDER_HOOKADDR2 0x00573130
 #define FEMANAGER_RENDER_ADDRESS 0x00516F70
@@ -133,6 +136,9 @@
 #define VEHICLE_LISTABLESET_ADDR 0x0092CD7C
 #define IRIGIDBODY_HANDLE_ADDR 0x004039F0
 #define RB_GETMATRIX4_OFFSET 0x40
+// The vehicle table is a UTL::Vector, whose element pointer is followed by its capacity and size
+#define VEHICLE_LISTABLESET_CAPACITY_OFFSET 0x4
+#define VEHICLE_LISTABLESET_SIZE_OFFSET 0x8
 #define RB_SETORIENTATION_OFFSET 0x70
 
 #define INFINITENOS_ADDR 0x00937804
@@ -195,3 +201,6 @@
 
 void __stdcall FEManager_Render_Hook();
 void __stdcall FECareerRecord_AdjustHeatOnEventWin_Hook();
+struct bVector3;
+void __cdecl Sim_SetStream_Hook(bVector3* location, bool blocking);
+void __fastcall GameFlowManager_LoadRegion_Hook(void* dis, void* edx);
@@ -115,6 +115,9 @@
 #define VEHICLE_LISTABLESET_ADDR 0x00ACE144
 #define IRIGIDBODY_HANDLE_ADDR 0x00402280
 #define RB_GETMATRIX4_OFFSET 0x40
+// The vehicle table is a UTL::Vector, whose element pointer is followed by its capacity and size
+#define VEHICLE_LISTABLESET_CAPACITY_OFFSET 0x4
+#define VEHICLE_LISTABLESET_SIZE_OFFSET 0x8
 #define RB_SETORIENTATION_OFFSET 0x70
 
 // infinite NOS
@@ -203,6 +206,9 @@
 
 void ReShade_EntryPoint();
 void __stdcall MainService_Hook();
+struct bVector3;
+void __cdecl Sim_SetStream_Hook(bVector3* location, bool blocking);
+void __fastcall GameFlowManager_LoadRegion_Hook(void* dis, void* edx);
 void ToggleAIControlCave();
 void InfiniteNOSCave();
 void DrawWorldCave();
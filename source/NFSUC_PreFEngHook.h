@@ -118,6 +118,9 @@
 #define VEHICLE_LISTABLESET_ADDR 0x00DE93D4
 #define IRIGIDBODY_HANDLE_ADDR 0x00401A80
 #define RB_GETMATRIX4_OFFSET 0x40
+// The vehicle table is a UTL::Vector, whose element pointer is followed by its capacity and size
+#define VEHICLE_LISTABLESET_CAPACITY_OFFSET 0x4
+#define VEHICLE_LISTABLESET_SIZE_OFFSET 0x8
 #define RB_SETORIENTATION_OFFSET 0x6C
 
 // infinite NOS
@@ -163,6 +166,9 @@
 
 void ReShade_EntryPoint();
 void __stdcall MainService_Hook();
+struct bVector3;
+void __cdecl Sim_SetStream_Hook(bVector3* location, bool blocking);
+void __fastcall GameFlowManager_LoadRegion_Hook(void* dis, void* edx);
 void MotionBlur_EntryPoint();
 void InfiniteNOSCave();
 void ToggleAIControlCave();
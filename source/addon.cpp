@@ -10,7 +10,9 @@
 #include "runtime.hpp"
 #include "dll_log.hpp"
 #include "ini_file.hpp"
-#include <cstring> // std::strlen
+#include "reshade_api_object_impl.hpp"
+#include <mutex>
+#include <cstring> // std::memcmp, std::memcpy, std::strlen
 
 void ReShadeLogMessage([[maybe_unused]] HMODULE module, int level, const char *message)
 {
@@ -45,6 +47,32 @@ void ReShadeGetBasePath(char *path, size_t *size)
 	}
 }
 
+std::atomic<uint32_t> reshade::api::g_num_private_data_slots = 0;
+uint8_t reshade::api::g_private_data_slot_guids[reshade::api::api_object::max_private_data_slots][16] = {};
+
+uint32_t ReShadeRegisterPrivateDataSlot(const uint8_t guid[16])
+{
+	static std::mutex s_mutex;
+	const std::unique_lock<std::mutex> lock(s_mutex);
+
+	const uint32_t num_slots = reshade::api::g_num_private_data_slots.load(std::memory_order_relaxed);
+	for (uint32_t slot = 0; slot < num_slots; ++slot)
+		if (std::memcmp(reshade::api::g_private_data_slot_guids[slot], guid, 16) == 0)
+			return slot;
+
+	if (num_slots >= reshade::api::api_object::max_private_data_slots)
+	{
+		reshade::log::message(reshade::log::level::warning, "Failed to register private data slot, because all %u slots are already in use.", reshade::api::api_object::max_private_data_slots);
+		return UINT32_MAX;
+	}
+
+	// Write the GUID before publishing the new slot count, so that objects reading the registered GUIDs without a lock never see a partial one
+	std::memcpy(reshade::api::g_private_data_slot_guids[num_slots], guid, 16);
+	reshade::api::g_num_private_data_slots.store(num_slots + 1, std::memory_order_release);
+
+	return num_slots;
+}
+
 bool ReShadeGetConfigValue(HMODULE, reshade::api::effect_runtime *runtime, const char *section, const char *key, char *value, size_t *size)
 {
 	ini_file &config = (runtime != nullptr) ? ini_file::load_cache(static_cast<reshade::runtime *>(runtime)->get_config_path()) : reshade::global_config();
@@ -40,8 +40,11 @@ namespace reshade
 			uint64_t value;
 		} version = {};
 		bool external = true;
+		// Set until the optional 'AddonInitDeferred' entry point returned, with events registered meanwhile held back in 'deferred_event_callbacks'
+		bool deferred_init_pending = false;
 
 		std::vector<std::pair<uint32_t, void *>> event_callbacks;
+		std::vector<std::pair<uint32_t, void *>> deferred_event_callbacks;
 #if RESHADE_GUI
 		void(*settings_overlay_callback)(api::effect_runtime *) = nullptr;
 		std::vector<overlay_callback> overlay_callbacks;
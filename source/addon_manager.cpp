@@ -9,7 +9,11 @@
 #include "addon_manager.hpp"
 #include "dll_log.hpp"
 #include "ini_file.hpp"
-#include <algorithm> // std::find, std::find_if, std::remove, std::remove_if
+#include "thread_pool.hpp"
+#include <map>
+#include <mutex>
+#include <thread>
+#include <algorithm> // std::copy_n, std::count, std::find, std::find_if, std::remove, std::remove_copy, std::remove_if
 
 extern void register_addon_depth();
 extern void register_addon_effect_runtime_sync();
@@ -20,7 +24,7 @@ extern HMODULE g_module_handle;
 
 extern std::filesystem::path get_module_path(HMODULE module);
 
-#if RESHADE_VERBOSE_LOG
+#if RESHADE_VERBOSE_LOG || RESHADE_GUI
 static const char *addon_event_to_string(reshade::addon_event ev)
 {
 #define CASE(name) case reshade::addon_event::name: return #name
@@ -122,6 +126,7 @@ static const char *addon_event_to_string(reshade::addon_event ev)
 		CASE(reshade_open_overlay);
 		CASE(reshade_overlay_uniform_variable);
 		CASE(reshade_overlay_technique);
+		CASE(command_batch);
 	}
 #undef  CASE
 	return "unknown";
@@ -132,10 +137,79 @@ static const char *addon_event_to_string(reshade::addon_event ev)
 bool reshade::addon_enabled = true;
 #endif
 bool reshade::addon_all_loaded = true;
-std::vector<void *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)];
+std::atomic<const reshade::addon_event_callbacks *> reshade::addon_event_list[static_cast<uint32_t>(reshade::addon_event::max)] = {};
+std::atomic<uint64_t> reshade::addon_event_mask[(static_cast<uint32_t>(reshade::addon_event::max) + 63) / 64] = {};
 std::vector<reshade::addon_info> reshade::addon_loaded_info;
 static unsigned long s_reference_count = 0;
 
+// Callback lists are allocated from shared chunks, so that the lists of all events that have callbacks are close together in memory
+// A list that was replaced may still be iterated by another thread invoking that event, so replaced lists are never freed (registration is rare, so the amount of memory this retains stays small)
+static std::mutex s_event_list_mutex;
+static uint8_t *s_event_list_chunk_pos = nullptr;
+static uint8_t *s_event_list_chunk_end = nullptr;
+constexpr size_t s_event_list_chunk_size = 4096;
+
+std::atomic<bool> reshade::addon_profiling_enabled = false;
+static std::mutex s_callback_stats_mutex;
+static std::map<std::pair<reshade::addon_event, void *>, reshade::addon_callback_stats> s_callback_stats;
+// Time stamp counter and performance counter at the time profiling was enabled, to convert ticks into time without having to assume a fixed frequency
+static uint64_t s_callback_stats_start_ticks = 0;
+static LARGE_INTEGER s_callback_stats_start_time = {};
+
+static reshade::addon_event_callbacks *allocate_event_callbacks(size_t count)
+{
+	const size_t size = (offsetof(reshade::addon_event_callbacks, callbacks) + count * sizeof(void *) + alignof(reshade::addon_event_callbacks) - 1) & ~(alignof(reshade::addon_event_callbacks) - 1);
+	const size_t allocation_size = std::max(size, sizeof(reshade::addon_event_callbacks));
+
+	if (allocation_size > s_event_list_chunk_size)
+		return static_cast<reshade::addon_event_callbacks *>(_aligned_malloc(allocation_size, alignof(reshade::addon_event_callbacks)));
+
+	if (static_cast<size_t>(s_event_list_chunk_end - s_event_list_chunk_pos) < allocation_size)
+	{
+		s_event_list_chunk_pos = static_cast<uint8_t *>(_aligned_malloc(s_event_list_chunk_size, alignof(reshade::addon_event_callbacks)));
+		if (s_event_list_chunk_pos == nullptr)
+			return nullptr;
+		s_event_list_chunk_end = s_event_list_chunk_pos + s_event_list_chunk_size;
+	}
+
+	const auto list = reinterpret_cast<reshade::addon_event_callbacks *>(s_event_list_chunk_pos);
+	s_event_list_chunk_pos += allocation_size;
+	return list;
+}
+
+struct __declspec(uuid("0C6B4C1E-3B5D-4F1A-9C27-6E1A9D0F7B52")) command_batch
+{
+	std::vector<reshade::api::command_batch_record> records;
+};
+
+void reshade::record_addon_command(api::command_list *cmd_list, const api::command_batch_record &record)
+{
+	command_batch *batch = cmd_list->get_private_data<command_batch>();
+	if (batch == nullptr)
+		batch = cmd_list->create_private_data<command_batch>();
+
+	batch->records.push_back(record);
+}
+void reshade::flush_addon_commands(api::command_list *cmd_list, bool release)
+{
+	command_batch *const batch = cmd_list->get_private_data<command_batch>();
+	if (batch == nullptr)
+		return;
+
+	if (!batch->records.empty())
+	{
+		if (const addon_event_callbacks *const event_list = addon_event_list[static_cast<uint32_t>(addon_event::command_batch)].load(std::memory_order_acquire))
+			for (size_t cb = 0, count = event_list->count; cb < count; ++cb)
+				reinterpret_cast<addon_event_traits<addon_event::command_batch>::decl>(event_list->callbacks[cb])(cmd_list, static_cast<uint32_t>(batch->records.size()), batch->records.data());
+
+		// Keep the allocation around for the next batch
+		batch->records.clear();
+	}
+
+	if (release)
+		cmd_list->destroy_private_data<command_batch>();
+}
+
 void reshade::load_addons()
 {
 	// Only load add-ons the first time a reference is added
@@ -218,6 +292,8 @@ void reshade::load_addons()
 #endif
 		") in '%s' ...", addon_search_path.u8string().c_str());
 
+	std::vector<std::filesystem::path> addon_paths;
+
 	std::error_code ec;
 	for (std::filesystem::path path : std::filesystem::directory_iterator(addon_search_path, std::filesystem::directory_options::skip_permission_denied, ec))
 	{
@@ -229,6 +305,41 @@ void reshade::load_addons()
 #endif
 			continue;
 
+		addon_paths.push_back(std::move(path));
+	}
+
+	if (ec)
+		log::message(log::level::warning, "Failed to iterate all files in '%s' with error code %d!", addon_search_path.u8string().c_str(), ec.value());
+
+	// Resolve the load order up front, so that it does not depend on the order the file system enumerates files in
+	// Add-ons listed in the configuration are loaded first, in the order they are listed, followed by all others sorted by file name
+	std::vector<std::string> load_order;
+	config.get("ADDON", "LoadOrder", load_order);
+
+	std::sort(addon_paths.begin(), addon_paths.end());
+	std::stable_sort(addon_paths.begin(), addon_paths.end(),
+		[&load_order](const std::filesystem::path &lhs, const std::filesystem::path &rhs) {
+			return std::find(load_order.cbegin(), load_order.cend(), lhs.filename().u8string()) < std::find(load_order.cbegin(), load_order.cend(), rhs.filename().u8string());
+		});
+
+#if RESHADE_ADDON != 1
+	// Read the add-on files ahead of the loader, so that loading them does not wait for the disk one file at a time (the loader lock serializes 'LoadLibraryEx' calls, so they cannot be loaded in parallel)
+	std::thread prefetch_thread([&addon_paths]() {
+		std::vector<char> buffer(1024 * 1024);
+		for (const std::filesystem::path &path : addon_paths)
+		{
+			const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				continue;
+			for (DWORD size = 0; ReadFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), &size, nullptr) && size != 0;)
+				continue;
+			CloseHandle(file);
+		}
+	});
+#endif
+
+	for (const std::filesystem::path &path : addon_paths)
+	{
 #if RESHADE_ADDON == 1
 		// Indicate that add-ons exist that could not be loaded because this build of ReShade has only limited add-on functionality
 		addon_all_loaded = false;
@@ -314,9 +425,56 @@ void reshade::load_addons()
 #endif
 	}
 
-	if (ec)
-		log::message(log::level::warning, "Failed to iterate all files in '%s' with error code %d!", addon_search_path.u8string().c_str(), ec.value());
+#if RESHADE_ADDON != 1
+	prefetch_thread.join();
+#endif
+}
+void reshade::initialize_deferred_addons([[maybe_unused]] thread_pool &pool)
+{
+#if RESHADE_ADDON != 1 && defined(RESHADE_API_LIBRARY_EXPORT)
+	static std::atomic<bool> s_deferred_init_started = false;
+	if (s_deferred_init_started.exchange(true))
+		return;
+
+	for (const addon_info &info : addon_loaded_info)
+	{
+		if (!info.deferred_init_pending || info.handle == nullptr)
+			continue;
+
+		pool.submit(thread_pool::priority::low, [module = static_cast<HMODULE>(info.handle), name = info.name]() {
+			const auto init_func = reinterpret_cast<bool(*)(HMODULE addon_module, HMODULE reshade_module)>(GetProcAddress(module, "AddonInitDeferred"));
+			const bool success = init_func == nullptr || init_func(module, g_module_handle);
+
+			std::vector<std::pair<uint32_t, void *>> event_callbacks;
+			{
+				const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+				addon_info *const info = find_addon(module);
+				if (info == nullptr)
+					return;
+
+				info->deferred_init_pending = false;
+				event_callbacks = std::move(info->deferred_event_callbacks);
+				info->deferred_event_callbacks.clear();
+			}
+
+			if (!success)
+			{
+				// Keep the events of the add-on disabled, since it may not be able to handle them without having been initialized
+				addon_all_loaded = false;
+				log::message(log::level::error, "Deferred initialization of add-on \"%s\" was not successful! Its events remain disabled.", name.c_str());
+				return;
+			}
+
+			for (const std::pair<uint32_t, void *> &event_callback : event_callbacks)
+				ReShadeRegisterEventForAddon(module, static_cast<addon_event>(event_callback.first), event_callback.second);
+
+			log::message(log::level::info, "Finished deferred initialization of add-on \"%s\".", name.c_str());
+		});
+	}
+#endif
 }
+
 void reshade::unload_addons()
 {
 	// Only unload add-ons after the last reference to the manager was released
@@ -379,6 +537,63 @@ bool reshade::has_loaded_addons()
 		}) != addon_loaded_info.cend();
 }
 
+void reshade::set_addon_profiling(bool enabled)
+{
+	if (enabled)
+	{
+		const std::unique_lock<std::mutex> lock(s_callback_stats_mutex);
+
+		s_callback_stats.clear();
+		s_callback_stats_start_ticks = __rdtsc();
+		QueryPerformanceCounter(&s_callback_stats_start_time);
+	}
+
+	addon_profiling_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void reshade::record_addon_callback_duration(addon_event ev, void *callback, uint64_t ticks)
+{
+	const std::unique_lock<std::mutex> lock(s_callback_stats_mutex);
+
+	addon_callback_stats &stats = s_callback_stats[std::make_pair(ev, callback)];
+	stats.sample_count++;
+	stats.total_ticks += ticks;
+	stats.max_ticks = std::max(stats.max_ticks, ticks);
+}
+
+void reshade::get_addon_callback_stats(std::vector<addon_callback_stats> &stats, double &ticks_per_second, double &elapsed_seconds)
+{
+	stats.clear();
+	ticks_per_second = 0.0;
+	elapsed_seconds = 0.0;
+
+	LARGE_INTEGER current_time, frequency;
+	QueryPerformanceCounter(&current_time);
+	QueryPerformanceFrequency(&frequency);
+	const uint64_t current_ticks = __rdtsc();
+
+	const std::unique_lock<std::mutex> lock(s_callback_stats_mutex);
+
+	if (s_callback_stats_start_time.QuadPart == 0 || current_time.QuadPart <= s_callback_stats_start_time.QuadPart)
+		return;
+
+	elapsed_seconds = static_cast<double>(current_time.QuadPart - s_callback_stats_start_time.QuadPart) / static_cast<double>(frequency.QuadPart);
+	ticks_per_second = static_cast<double>(current_ticks - s_callback_stats_start_ticks) / elapsed_seconds;
+
+	stats.reserve(s_callback_stats.size());
+	for (const std::pair<const std::pair<addon_event, void *>, addon_callback_stats> &entry : s_callback_stats)
+	{
+		addon_callback_stats &copy = stats.emplace_back(entry.second);
+		copy.ev = entry.first.first;
+#if RESHADE_VERBOSE_LOG || RESHADE_GUI
+		copy.event_name = addon_event_to_string(entry.first.first);
+#else
+		copy.event_name = "unknown";
+#endif
+		copy.callback = entry.first.second;
+	}
+}
+
 reshade::addon_info *reshade::find_addon(void *address)
 {
 	if (address == nullptr)
@@ -493,6 +708,9 @@ bool ReShadeRegisterAddon(HMODULE module, uint32_t api_version)
 
 	reshade::log::message(reshade::log::level::info, "Registered add-on \"%s\" v%hu.%hu.%hu.%hu using ReShade API version %u.", info.name.c_str(), info.version.number.major, info.version.number.minor, info.version.number.build, info.version.number.revision, api_version);
 
+	// Hold back the events of add-ons that do their heavy initialization later, until that finished (see 'initialize_deferred_addons')
+	info.deferred_init_pending = GetProcAddress(module, "AddonInitDeferred") != nullptr;
+
 	reshade::addon_loaded_info.push_back(std::move(info));
 
 	return true;
@@ -547,15 +765,41 @@ void ReShadeRegisterEventForAddon(HMODULE module, reshade::addon_event ev, void
 
 #if RESHADE_ADDON == 1
 	// Block all application events when building without add-on loading support
-	if (info->handle != g_module_handle && (ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present))
+	if (info->handle != g_module_handle && ((ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present) || ev == reshade::addon_event::command_batch))
 	{
 		reshade::log::message(reshade::log::level::error, "Failed to register an event because only limited add-on functionality is available!");
 		return;
 	}
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.push_back(callback);
+	{
+		const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+		if (info->deferred_init_pending)
+		{
+			info->deferred_event_callbacks.emplace_back(static_cast<uint32_t>(ev), callback);
+			return;
+		}
+
+		std::atomic<const reshade::addon_event_callbacks *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
+		const reshade::addon_event_callbacks *const old_list = event_list.load(std::memory_order_relaxed);
+		const size_t old_count = old_list != nullptr ? old_list->count : 0;
+
+		reshade::addon_event_callbacks *const new_list = allocate_event_callbacks(old_count + 1);
+		if (new_list == nullptr)
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to allocate memory to register an event.");
+			return;
+		}
+
+		new_list->count = old_count + 1;
+		std::copy_n(old_list != nullptr ? old_list->callbacks : nullptr, old_count, new_list->callbacks);
+		new_list->callbacks[old_count] = callback;
+
+		event_list.store(new_list, std::memory_order_release);
+	}
+
+	reshade::addon_event_mask[static_cast<uint32_t>(ev) / 64].fetch_or(1ull << (static_cast<uint32_t>(ev) % 64), std::memory_order_relaxed);
 
 	info->event_callbacks.emplace_back(static_cast<uint32_t>(ev), callback);
 
@@ -579,12 +823,43 @@ void ReShadeUnregisterEventForAddon(HMODULE module, reshade::addon_event ev, voi
 	assert(info->handle == module || module == nullptr);
 
 #if RESHADE_ADDON == 1
-	if (info->handle != g_module_handle && (ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present))
+	if (info->handle != g_module_handle && ((ev > reshade::addon_event::destroy_effect_runtime && ev < reshade::addon_event::present) || ev == reshade::addon_event::command_batch))
 		return;
 #endif
 
-	std::vector<void *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
-	event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	{
+		const std::unique_lock<std::mutex> lock(s_event_list_mutex);
+
+		if (info->deferred_init_pending)
+		{
+			info->deferred_event_callbacks.erase(std::remove(info->deferred_event_callbacks.begin(), info->deferred_event_callbacks.end(), std::make_pair(static_cast<uint32_t>(ev), callback)), info->deferred_event_callbacks.end());
+			return;
+		}
+
+		std::atomic<const reshade::addon_event_callbacks *> &event_list = reshade::addon_event_list[static_cast<uint32_t>(ev)];
+		const reshade::addon_event_callbacks *const old_list = event_list.load(std::memory_order_relaxed);
+		if (old_list == nullptr)
+			return;
+
+		const size_t new_count = old_list->count - std::count(old_list->callbacks, old_list->callbacks + old_list->count, callback);
+		if (new_count == old_list->count)
+			return;
+
+		if (new_count == 0)
+			reshade::addon_event_mask[static_cast<uint32_t>(ev) / 64].fetch_and(~(1ull << (static_cast<uint32_t>(ev) % 64)), std::memory_order_relaxed);
+
+		reshade::addon_event_callbacks *const new_list = allocate_event_callbacks(new_count);
+		if (new_list == nullptr)
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to allocate memory to unregister an event.");
+			return;
+		}
+
+		new_list->count = new_count;
+		std::remove_copy(old_list->callbacks, old_list->callbacks + old_list->count, new_list->callbacks, callback);
+
+		event_list.store(new_list, std::memory_order_release);
+	}
 
 	info->event_callbacks.erase(std::remove(info->event_callbacks.begin(), info->event_callbacks.end(), std::make_pair(static_cast<uint32_t>(ev), callback)), info->event_callbacks.end());
 
@@ -7,11 +7,16 @@
 
 #include "addon.hpp"
 #include "reshade_events.hpp"
+#include <atomic>
+#include <tuple>
+#include <intrin.h> // __rdtsc
 
 #if RESHADE_ADDON
 
 namespace reshade
 {
+	class thread_pool;
+
 #if RESHADE_ADDON == 1
 	/// <summary>
 	/// Global switch to enable or disable all loaded add-ons.
@@ -21,9 +26,85 @@ namespace reshade
 	extern bool addon_all_loaded;
 
 	/// <summary>
-	/// List of add-on event callbacks.
+	/// Immutable list of the callbacks registered for an add-on event.
+	/// Registering or unregistering a callback publishes a new list instead of modifying the current one, so that invoking an event never has to lock.
+	/// Lists are cache-line aligned and the callback array continues past the end of the structure for lists that span more than one cache line.
+	/// </summary>
+	struct alignas(64) addon_event_callbacks
+	{
+		size_t count;
+		void *callbacks[(64 - sizeof(size_t)) / sizeof(void *)];
+	};
+
+	/// <summary>
+	/// List of add-on event callbacks, or <see langword="nullptr"/> if no callback was ever registered for an event.
+	/// </summary>
+	extern std::atomic<const addon_event_callbacks *> addon_event_list[];
+	/// <summary>
+	/// Bitmask of the add-on events that currently have at least one callback registered, so that events without subscribers can be skipped with a single test.
+	/// </summary>
+	extern std::atomic<uint64_t> addon_event_mask[];
+
+	/// <summary>
+	/// Checks the bit of the specified <typeparamref name="ev"/>ent in <see cref="addon_event_mask"/>.
 	/// </summary>
-	extern std::vector<void *> addon_event_list[];
+	template <addon_event ev>
+	__forceinline bool test_addon_event_mask()
+	{
+		return (addon_event_mask[static_cast<uint32_t>(ev) / 64].load(std::memory_order_relaxed) & (1ull << (static_cast<uint32_t>(ev) % 64))) != 0;
+	}
+
+	/// <summary>
+	/// Accumulated durations of the sampled invocations of a single add-on event callback, in time stamp counter ticks.
+	/// </summary>
+	struct addon_callback_stats
+	{
+		addon_event ev;
+		const char *event_name;
+		void *callback;
+		uint64_t sample_count;
+		uint64_t total_ticks;
+		uint64_t max_ticks;
+	};
+
+	/// <summary>
+	/// Only one in this many event invocations on a thread is timed while add-on profiling is enabled, to keep the overhead of reading the time stamp counter low.
+	/// </summary>
+	constexpr uint32_t ADDON_PROFILING_SAMPLE_INTERVAL = 64;
+
+	/// <summary>
+	/// Switch to measure how long add-on event callbacks take, see <see cref="set_addon_profiling"/>.
+	/// </summary>
+	extern std::atomic<bool> addon_profiling_enabled;
+
+	/// <summary>
+	/// Enables or disables measuring how long add-on event callbacks take.
+	/// Enabling this discards all previously gathered statistics.
+	/// </summary>
+	void set_addon_profiling(bool enabled);
+	/// <summary>
+	/// Adds a sampled duration of the specified event <paramref name="callback"/> to its statistics.
+	/// </summary>
+	void record_addon_callback_duration(addon_event ev, void *callback, uint64_t ticks);
+	/// <summary>
+	/// Gets a copy of the statistics of all callbacks that were sampled since profiling was enabled.
+	/// </summary>
+	/// <param name="stats">Receives the statistics of every sampled callback.</param>
+	/// <param name="ticks_per_second">Receives the frequency of the time stamp counter, as measured since profiling was enabled.</param>
+	/// <param name="elapsed_seconds">Receives the time since profiling was enabled.</param>
+	void get_addon_callback_stats(std::vector<addon_callback_stats> &stats, double &ticks_per_second, double &elapsed_seconds);
+
+	/// <summary>
+	/// Decides whether the callbacks of the current event invocation should be timed.
+	/// </summary>
+	__forceinline bool sample_addon_callbacks()
+	{
+		if (!addon_profiling_enabled.load(std::memory_order_relaxed))
+			return false;
+
+		thread_local uint32_t invocation_count = 0;
+		return (++invocation_count % ADDON_PROFILING_SAMPLE_INTERVAL) == 0;
+	}
 
 	/// <summary>
 	/// List of currently loaded add-ons.
@@ -40,6 +121,12 @@ namespace reshade
 	/// </summary>
 	void unload_addons();
 
+	/// <summary>
+	/// Calls the optional 'AddonInitDeferred' entry point of every loaded add-on that exports one on the specified worker <paramref name="pool"/>.
+	/// Events such an add-on registers are only enabled after its entry point returned successfully. Only the first call has an effect.
+	/// </summary>
+	void initialize_deferred_addons(thread_pool &pool);
+
 	/// <summary>
 	/// Checks whether any add-ons were loaded.
 	/// </summary>
@@ -50,13 +137,103 @@ namespace reshade
 	/// </summary>
 	addon_info *find_addon(void *address);
 
+	/// <summary>
+	/// Appends a command to the batch of the specified command list that is delivered to <see cref="addon_event::command_batch"/> callbacks.
+	/// </summary>
+	void record_addon_command(api::command_list *cmd_list, const api::command_batch_record &record);
+	/// <summary>
+	/// Delivers all commands recorded on the specified command list to <see cref="addon_event::command_batch"/> callbacks.
+	/// </summary>
+	/// <param name="release">Set to <see langword="true"/> to also free the batch, e.g. when the command list is destroyed.</param>
+	void flush_addon_commands(api::command_list *cmd_list, bool release = false);
+
+	/// <summary>
+	/// Records the specified <typeparamref name="ev"/>ent for or flushes the command batch at synchronization points, when there are <see cref="addon_event::command_batch"/> callbacks.
+	/// </summary>
+	template <addon_event ev, typename... Args>
+	__forceinline void update_addon_command_batch(const Args &... args)
+	{
+		if constexpr (ev == addon_event::destroy_command_list)
+		{
+			// Always free the batch, even if there no longer are any callbacks
+			flush_addon_commands(std::get<0>(std::forward_as_tuple(args...)), true);
+		}
+		else if constexpr (
+			ev == addon_event::draw ||
+			ev == addon_event::draw_indexed ||
+			ev == addon_event::bind_pipeline_states ||
+			ev == addon_event::push_descriptors ||
+			ev == addon_event::end_render_pass ||
+			ev == addon_event::close_command_list ||
+			ev == addon_event::execute_command_list ||
+			ev == addon_event::present)
+		{
+			if (!test_addon_event_mask<addon_event::command_batch>())
+				return;
+#if RESHADE_ADDON == 1
+			if (!addon_enabled)
+				return;
+#endif
+
+			api::command_batch_record record;
+			record.type = ev;
+
+			if constexpr (ev == addon_event::draw)
+			{
+				const auto &[cmd_list, vertex_count, instance_count, first_vertex, first_instance] = std::forward_as_tuple(args...);
+
+				record.draw = { static_cast<uint32_t>(vertex_count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(first_vertex), static_cast<uint32_t>(first_instance) };
+				record_addon_command(cmd_list, record);
+			}
+			else if constexpr (ev == addon_event::draw_indexed)
+			{
+				const auto &[cmd_list, index_count, instance_count, first_index, vertex_offset, first_instance] = std::forward_as_tuple(args...);
+
+				record.draw_indexed = { static_cast<uint32_t>(index_count), static_cast<uint32_t>(instance_count), static_cast<uint32_t>(first_index), static_cast<int32_t>(vertex_offset), static_cast<uint32_t>(first_instance) };
+				record_addon_command(cmd_list, record);
+			}
+			else if constexpr (ev == addon_event::bind_pipeline_states)
+			{
+				const auto &[cmd_list, count, states, values] = std::forward_as_tuple(args...);
+
+				for (uint32_t i = 0; i < static_cast<uint32_t>(count); ++i)
+				{
+					record.bind_pipeline_state = { states[i], values[i] };
+					record_addon_command(cmd_list, record);
+				}
+			}
+			else if constexpr (ev == addon_event::push_descriptors)
+			{
+				const auto &[cmd_list, stages, layout, layout_param, update] = std::forward_as_tuple(args...);
+
+				record.push_descriptors = { stages, static_cast<uint32_t>(layout_param), layout, update.binding, update.array_offset, update.count, update.type };
+				record_addon_command(cmd_list, record);
+			}
+			else if constexpr (ev == addon_event::execute_command_list)
+			{
+				flush_addon_commands(std::get<1>(std::forward_as_tuple(args...)));
+			}
+			else if constexpr (ev == addon_event::present)
+			{
+				// Immediate command lists are never closed, so make sure their commands are delivered at least once per frame
+				api::command_queue *const queue = std::get<0>(std::forward_as_tuple(args...));
+				if (api::command_list *const immediate_cmd_list = queue->get_immediate_command_list())
+					flush_addon_commands(immediate_cmd_list);
+			}
+			else
+			{
+				flush_addon_commands(std::get<0>(std::forward_as_tuple(args...)));
+			}
+		}
+	}
+
 	/// <summary>
 	/// Checks whether any callbacks were registered for the specified <paramref name="ev"/>ent.
 	/// </summary>
 	template <addon_event ev>
 	__forceinline bool has_addon_event()
 	{
-		return !addon_event_list[static_cast<uint32_t>(ev)].empty();
+		return test_addon_event_mask<ev>();
 	}
 
 	/// <summary>
@@ -65,6 +242,12 @@ namespace reshade
 	template <addon_event ev, typename... Args>
 	__forceinline std::enable_if_t<std::is_same_v<typename addon_event_traits<ev>::type, void>, void> invoke_addon_event(Args &&... args)
 	{
+		update_addon_command_batch<ev>(args...);
+
+		// Early out with a single test when there are no callbacks registered for this event, before touching the callback list
+		if (!test_addon_event_mask<ev>())
+			return;
+
 #if RESHADE_ADDON == 1
 		// Ensure certain events are not compiled when only limited add-on support is enabled
 		static_assert(
@@ -110,9 +293,21 @@ namespace reshade
 		if (!addon_enabled)
 			return;
 #endif
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
-			reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...);
+		const addon_event_callbacks *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_acquire);
+		if (event_list == nullptr)
+			return;
+		if (sample_addon_callbacks())
+		{
+			for (size_t cb = 0, count = event_list->count; cb < count; ++cb)
+			{
+				const uint64_t start = __rdtsc();
+				reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...);
+				record_addon_callback_duration(ev, event_list->callbacks[cb], __rdtsc() - start);
+			}
+			return;
+		}
+		for (size_t cb = 0, count = event_list->count; cb < count; ++cb) // Generates better code than ranged-based for loop
+			reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...);
 	}
 	/// <summary>
 	/// Invokes registered callbacks for the specified <typeparamref name="ev"/>ent until a callback reports back as having handled this event by returning <see langword="true"/>.
@@ -120,6 +315,11 @@ namespace reshade
 	template <addon_event ev, typename... Args>
 	__forceinline std::enable_if_t<std::is_same_v<typename addon_event_traits<ev>::type, bool>, bool> invoke_addon_event(Args &&... args)
 	{
+		update_addon_command_batch<ev>(args...);
+
+		if (!test_addon_event_mask<ev>())
+			return false;
+
 #if RESHADE_ADDON == 1
 		static_assert(
 			ev != addon_event::update_buffer_region &&
@@ -146,9 +346,23 @@ namespace reshade
 		if (!addon_enabled)
 			return false;
 #endif
-		std::vector<void *> &event_list = addon_event_list[static_cast<uint32_t>(ev)];
-		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb)
-			if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...))
+		const addon_event_callbacks *const event_list = addon_event_list[static_cast<uint32_t>(ev)].load(std::memory_order_acquire);
+		if (event_list == nullptr)
+			return false;
+		if (sample_addon_callbacks())
+		{
+			for (size_t cb = 0, count = event_list->count; cb < count; ++cb)
+			{
+				const uint64_t start = __rdtsc();
+				const bool handled = reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...);
+				record_addon_callback_duration(ev, event_list->callbacks[cb], __rdtsc() - start);
+				if (handled)
+					return true;
+			}
+			return false;
+		}
+		for (size_t cb = 0, count = event_list->count; cb < count; ++cb)
+			if (reinterpret_cast<typename addon_event_traits<ev>::decl>(event_list->callbacks[cb])(std::forward<Args>(args)...))
 				return true;
 		return false;
 	}
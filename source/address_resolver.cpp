@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "address_resolver.hpp"
+#include "dll_log.hpp"
+#include "ini_file.hpp"
+#include <thread>
+#include <cstring> // std::memchr
+#include <Windows.h>
+
+void reshade::address_resolver::add(const std::string &name, const std::string &pattern, ptrdiff_t offset, uintptr_t *address)
+{
+	entry &e = _entries.emplace_back();
+	e.name = name;
+	e.offset = offset;
+	e.address = address;
+
+	for (size_t i = 0; i < pattern.size(); ++i)
+	{
+		if (pattern[i] == ' ')
+			continue;
+
+		if (pattern[i] == '?')
+		{
+			e.bytes.push_back(0);
+			e.mask.push_back(0);
+
+			// Accept both "?" and "??" as wildcard
+			if (i + 1 < pattern.size() && pattern[i + 1] == '?')
+				++i;
+		}
+		else if (i + 1 < pattern.size())
+		{
+			e.bytes.push_back(static_cast<uint8_t>(std::strtoul(pattern.substr(i, 2).c_str(), nullptr, 16)));
+			e.mask.push_back(0xFF);
+			++i;
+		}
+	}
+}
+
+static bool matches_at(const uint8_t *data, const std::vector<uint8_t> &bytes, const std::vector<uint8_t> &mask)
+{
+	for (size_t i = 0; i < bytes.size(); ++i)
+		if ((data[i] & mask[i]) != bytes[i])
+			return false;
+	return true;
+}
+
+bool reshade::address_resolver::resolve(const std::filesystem::path &cache_path)
+{
+	if (_entries.empty())
+		return true;
+
+	const auto image_base = reinterpret_cast<const uint8_t *>(GetModuleHandleW(nullptr));
+	const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(image_base + reinterpret_cast<const IMAGE_DOS_HEADER *>(image_base)->e_lfanew);
+
+	// Identify the executable by a hash of its headers, which include the link timestamp, image size and the section table, so that any patch or regional build gets its own cache entries
+	uint32_t checksum = 2166136261;
+	for (DWORD i = 0; i < nt_headers->OptionalHeader.SizeOfHeaders; ++i)
+		checksum = (checksum ^ image_base[i]) * 16777619;
+
+	char cache_section[16];
+	sprintf_s(cache_section, "%08X", checksum);
+
+	ini_file cache(cache_path);
+
+	std::vector<entry *> pending;
+	for (entry &e : _entries)
+	{
+		unsigned int rva = 0;
+		if (cache.get(cache_section, e.name, rva) && rva + e.bytes.size() <= nt_headers->OptionalHeader.SizeOfImage &&
+			// Verify that the cached location still matches, in case the file was mistakenly reused
+			matches_at(image_base + rva, e.bytes, e.mask))
+			e.match = reinterpret_cast<uintptr_t>(image_base) + rva;
+		else
+			pending.push_back(&e);
+	}
+
+	if (!pending.empty())
+	{
+		size_t max_pattern_size = 0;
+		for (const entry *e : pending)
+			max_pattern_size = e->bytes.size() > max_pattern_size ? e->bytes.size() : max_pattern_size;
+
+		std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+		const IMAGE_SECTION_HEADER *section = IMAGE_FIRST_SECTION(nt_headers);
+		for (WORD i = 0; i < nt_headers->FileHeader.NumberOfSections; ++i, ++section)
+		{
+			if ((section->Characteristics & IMAGE_SCN_MEM_EXECUTE) == 0)
+				continue;
+
+			const uintptr_t section_begin = reinterpret_cast<uintptr_t>(image_base) + section->VirtualAddress;
+			const uintptr_t section_end = section_begin + std::max<DWORD>(section->Misc.VirtualSize, section->SizeOfRawData);
+
+			// Split each code section into one chunk per thread, overlapping by the longest pattern so that matches across chunk boundaries are found too
+			const unsigned int num_chunks = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+			const uintptr_t chunk_size = (section_end - section_begin + num_chunks - 1) / num_chunks;
+			for (uintptr_t chunk_begin = section_begin; chunk_begin < section_end; chunk_begin += chunk_size)
+			{
+				const uintptr_t chunk_end = chunk_begin + chunk_size + max_pattern_size;
+				ranges.emplace_back(chunk_begin, chunk_end < section_end ? chunk_end : section_end);
+			}
+		}
+
+		// Each thread writes the first match it finds for every pattern to its own list, so no synchronization is needed
+		std::vector<std::vector<uintptr_t>> matches(ranges.size(), std::vector<uintptr_t>(pending.size(), 0));
+		std::vector<std::thread> threads;
+		threads.reserve(ranges.size());
+		for (size_t i = 0; i < ranges.size(); ++i)
+			threads.emplace_back(&address_resolver::scan, ranges[i].first, ranges[i].second, std::cref(pending), std::ref(matches[i]));
+		for (std::thread &thread : threads)
+			thread.join();
+
+		// Ranges are sorted by address, so the first range with a match has the lowest one
+		for (size_t k = 0; k < pending.size(); ++k)
+			for (size_t i = 0; i < ranges.size() && pending[k]->match == 0; ++i)
+				pending[k]->match = matches[i][k];
+	}
+
+	bool all_resolved = true;
+
+	for (entry &e : _entries)
+	{
+		if (e.match == 0)
+		{
+			log::message(log::level::warning, "Failed to find pattern for address '%s' in the target executable.", e.name.c_str());
+			all_resolved = false;
+			continue;
+		}
+
+		cache.set(cache_section, e.name, static_cast<unsigned int>(e.match - reinterpret_cast<uintptr_t>(image_base)));
+
+		*e.address = e.match + e.offset;
+	}
+
+	cache.save();
+
+	return all_resolved;
+}
+
+void reshade::address_resolver::scan(uintptr_t begin, uintptr_t end, const std::vector<entry *> &entries, std::vector<uintptr_t> &matches)
+{
+	for (size_t k = 0; k < entries.size(); ++k)
+	{
+		const entry &e = *entries[k];
+		if (e.bytes.empty() || end - begin < e.bytes.size())
+			continue;
+
+		const auto last = reinterpret_cast<const uint8_t *>(end - e.bytes.size());
+		auto data = reinterpret_cast<const uint8_t *>(begin);
+
+		if (e.mask[0] == 0xFF)
+		{
+			// Skip quickly to candidates that start with the first byte of the pattern
+			while (data <= last && (data = static_cast<const uint8_t *>(std::memchr(data, e.bytes[0], last - data + 1))) != nullptr)
+			{
+				if (matches_at(data, e.bytes, e.mask))
+				{
+					matches[k] = reinterpret_cast<uintptr_t>(data);
+					break;
+				}
+				++data;
+			}
+		}
+		else
+		{
+			for (; data <= last; ++data)
+			{
+				if (matches_at(data, e.bytes, e.mask))
+				{
+					matches[k] = reinterpret_cast<uintptr_t>(data);
+					break;
+				}
+			}
+		}
+	}
+}
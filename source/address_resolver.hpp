@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Resolves addresses in the code of the main module of the current process by searching for byte patterns.
+	/// Patterns are searched for in parallel on multiple threads and the results are cached on disk, keyed by a checksum of the module, so that later launches of the same executable do not have to scan again.
+	/// </summary>
+	class address_resolver
+	{
+	public:
+		/// <summary>
+		/// Registers a pattern to search for.
+		/// </summary>
+		/// <param name="name">Unique name of the address, used as key in the cache.</param>
+		/// <param name="pattern">Pattern in the same format as <c>hook::pattern</c>, i.e. hexadecimal bytes separated by spaces, with '?' as wildcard (e.g. "8B 0D ? ? ? ? E8").</param>
+		/// <param name="offset">Offset added to the start of the match to get the address.</param>
+		/// <param name="address">Pointer to a variable receiving the resolved address. It is left unchanged if the pattern is not found.</param>
+		void add(const std::string &name, const std::string &pattern, ptrdiff_t offset, uintptr_t *address);
+
+		/// <summary>
+		/// Resolves all registered patterns, using the cache file at the specified <paramref name="cache_path"/> where possible.
+		/// </summary>
+		/// <param name="cache_path">Path to the INI file containing the results of previous scans.</param>
+		/// <returns><see langword="true"/> if all registered patterns were resolved, <see langword="false"/> otherwise.</returns>
+		bool resolve(const std::filesystem::path &cache_path);
+
+	private:
+		struct entry
+		{
+			std::string name;
+			std::vector<uint8_t> bytes;
+			std::vector<uint8_t> mask;
+			ptrdiff_t offset;
+			uintptr_t *address;
+			uintptr_t match = 0;
+		};
+
+		static void scan(uintptr_t begin, uintptr_t end, const std::vector<entry *> &entries, std::vector<uintptr_t> &matches);
+
+		std::vector<entry> _entries;
+	};
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "block_compression.hpp"
+#include <cmath> // std::sqrt
+#include <cstdlib> // std::abs
+#include <utility> // std::swap
+#include <algorithm> // std::clamp, std::max, std::min
+
+static inline void store_u16(uint8_t *out, uint16_t value)
+{
+	out[0] = static_cast<uint8_t>(value & 0xFF);
+	out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static uint16_t pack_rgb565(const float color[3])
+{
+	const uint32_t r = static_cast<uint32_t>(std::clamp(color[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(std::clamp(color[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(std::clamp(color[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+static void unpack_rgb565(uint16_t value, int color[3])
+{
+	const int r = (value >> 11) & 0x1F;
+	const int g = (value >> 5) & 0x3F;
+	const int b = value & 0x1F;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/// <summary>
+/// Encodes a 4x4 block of RGB texels in BC1 format, using the endpoints along the principal axis of the colors in the block.
+/// </summary>
+static void compress_color_block(const uint8_t texels[16][4], uint8_t out[8])
+{
+	float mean[3] = {};
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 3; ++c)
+			mean[c] += texels[i][c];
+	for (int c = 0; c < 3; ++c)
+		mean[c] /= 16.0f;
+
+	float covariance[6] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		const float r = texels[i][0] - mean[0];
+		const float g = texels[i][1] - mean[1];
+		const float b = texels[i][2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// A few power iterations are enough to find a good approximation of the principal axis
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 4; ++iteration)
+	{
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+		const float length = std::sqrt(x * x + y * y + z * z);
+		if (length < 1e-6f)
+			break; // All texels have the same color, so any axis works
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	float min_t = 0.0f, max_t = 0.0f;
+	for (int i = 0; i < 16; ++i)
+	{
+		const float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+		min_t = std::min(min_t, t);
+		max_t = std::max(max_t, t);
+	}
+
+	const float endpoint0[3] = { mean[0] + axis[0] * max_t, mean[1] + axis[1] * max_t, mean[2] + axis[2] * max_t };
+	const float endpoint1[3] = { mean[0] + axis[0] * min_t, mean[1] + axis[1] * min_t, mean[2] + axis[2] * min_t };
+
+	uint16_t color0 = pack_rgb565(endpoint0);
+	uint16_t color1 = pack_rgb565(endpoint1);
+	// The first endpoint has to be the larger one to select the four color mode (the only mode in BC2 and BC3)
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	int palette[4][3];
+	unpack_rgb565(color0, palette[0]);
+	unpack_rgb565(color1, palette[1]);
+	for (int c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t best_index = 0;
+			int best_distance = 0x7FFFFFFF;
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				const int r = texels[i][0] - palette[k][0];
+				const int g = texels[i][1] - palette[k][1];
+				const int b = texels[i][2] - palette[k][2];
+				const int distance = r * r + g * g + b * b;
+				if (distance < best_distance)
+				{
+					best_index = k;
+					best_distance = distance;
+				}
+			}
+
+			indices |= best_index << (i * 2);
+		}
+	}
+
+	store_u16(out + 0, color0);
+	store_u16(out + 2, color1);
+	store_u16(out + 4, static_cast<uint16_t>(indices & 0xFFFF));
+	store_u16(out + 6, static_cast<uint16_t>(indices >> 16));
+}
+
+/// <summary>
+/// Encodes a 4x4 block of single channel texels in BC4 format (which is also the alpha block of BC3), using the minimum and maximum value as endpoints.
+/// </summary>
+static void compress_channel_block(const uint8_t texels[16][4], unsigned int channel, uint8_t out[8])
+{
+	int min_value = 255, max_value = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		min_value = std::min(min_value, static_cast<int>(texels[i][channel]));
+		max_value = std::max(max_value, static_cast<int>(texels[i][channel]));
+	}
+
+	// The first endpoint being larger selects the mode with eight interpolated values
+	out[0] = static_cast<uint8_t>(max_value);
+	out[1] = static_cast<uint8_t>(min_value);
+
+	uint64_t indices = 0;
+	if (max_value != min_value)
+	{
+		int palette[8];
+		palette[0] = max_value;
+		palette[1] = min_value;
+		for (int k = 2; k < 8; ++k)
+			palette[k] = ((8 - k) * max_value + (k - 1) * min_value) / 7;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			uint64_t best_index = 0;
+			int best_distance = 0x7FFFFFFF;
+			for (uint64_t k = 0; k < 8; ++k)
+			{
+				const int distance = std::abs(texels[i][channel] - palette[k]);
+				if (distance < best_distance)
+				{
+					best_index = k;
+					best_distance = distance;
+				}
+			}
+
+			indices |= best_index << (i * 3);
+		}
+	}
+
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = static_cast<uint8_t>((indices >> (i * 8)) & 0xFF);
+}
+
+void reshade::utils::compress_blocks(const uint8_t *pixels, uint32_t width, uint32_t height, unsigned int channels, uint8_t *blocks)
+{
+	uint8_t texels[16][4] = {};
+
+	for (uint32_t block_y = 0; block_y < height; block_y += 4)
+	{
+		for (uint32_t block_x = 0; block_x < width; block_x += 4)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint8_t *const src = pixels + (static_cast<size_t>(std::min(block_y + y, height - 1)) * width + std::min(block_x + x, width - 1)) * channels;
+					for (unsigned int c = 0; c < channels; ++c)
+						texels[y * 4 + x][c] = src[c];
+				}
+			}
+
+			switch (channels)
+			{
+			case 1:
+				compress_channel_block(texels, 0, blocks);
+				blocks += 8;
+				break;
+			case 2:
+				compress_channel_block(texels, 0, blocks);
+				compress_channel_block(texels, 1, blocks + 8);
+				blocks += 16;
+				break;
+			case 4:
+				compress_channel_block(texels, 3, blocks);
+				compress_color_block(texels, blocks + 8);
+				blocks += 16;
+				break;
+			}
+		}
+	}
+}
+
+void reshade::utils::downsample_box(const uint8_t *pixels, uint32_t width, uint32_t height, unsigned int channels, uint8_t *result)
+{
+	const uint32_t result_width = std::max(1u, width / 2);
+	const uint32_t result_height = std::max(1u, height / 2);
+
+	for (uint32_t y = 0; y < result_height; ++y)
+	{
+		const uint8_t *const row0 = pixels + static_cast<size_t>(std::min(y * 2 + 0, height - 1)) * width * channels;
+		const uint8_t *const row1 = pixels + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * channels;
+
+		for (uint32_t x = 0; x < result_width; ++x)
+		{
+			const size_t x0 = static_cast<size_t>(std::min(x * 2 + 0, width - 1)) * channels;
+			const size_t x1 = static_cast<size_t>(std::min(x * 2 + 1, width - 1)) * channels;
+
+			for (unsigned int c = 0; c < channels; ++c)
+				*result++ = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
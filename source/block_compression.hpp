@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade::utils
+{
+	/// <summary>
+	/// Encodes tightly packed 8-bit pixels into blocks of 4x4 texels.
+	/// One channel is encoded as BC4, two channels as BC5 and four channels as BC3 (with the color in BC1 and alpha in BC4 format).
+	/// </summary>
+	/// <param name="pixels">Pixel data with <paramref name="channels"/> bytes per pixel.</param>
+	/// <param name="width">Width of the image in pixels. Does not have to be a multiple of four, partial blocks repeat the edge texels.</param>
+	/// <param name="height">Height of the image in pixels.</param>
+	/// <param name="channels">Number of channels per pixel, which has to be 1, 2 or 4.</param>
+	/// <param name="blocks">Destination for the encoded blocks, which are written row by row without any padding in between.</param>
+	void compress_blocks(const uint8_t *pixels, uint32_t width, uint32_t height, unsigned int channels, uint8_t *blocks);
+
+	/// <summary>
+	/// Halves the dimensions of an image of tightly packed 8-bit pixels by averaging each 2x2 region, which produces the next level of a mipmap chain.
+	/// </summary>
+	/// <param name="pixels">Pixel data with <paramref name="channels"/> bytes per pixel.</param>
+	/// <param name="width">Width of the source image in pixels.</param>
+	/// <param name="height">Height of the source image in pixels.</param>
+	/// <param name="channels">Number of channels per pixel.</param>
+	/// <param name="result">Destination for the downsampled image, which is max(1, width / 2) x max(1, height / 2) pixels in size.</param>
+	void downsample_box(const uint8_t *pixels, uint32_t width, uint32_t height, unsigned int channels, uint8_t *result);
+}
@@ -8,20 +8,56 @@
 #include "d3d11_command_list.hpp"
 #include "d3d11_impl_type_convert.hpp"
 #include "dll_log.hpp"
+#include "ini_file.hpp"
 #include "addon_manager.hpp"
+#include <cstring> // std::memcpy
 
 using reshade::d3d11::to_handle;
+using reshade::d3d11::state_block;
+
+template <typename T>
+static void shadow_shader(T *&shadow_shader, UINT &shadow_num_class_instances, ID3D11ClassInstance *(&shadow_class_instances)[256], T *shader, ID3D11ClassInstance *const *class_instances, UINT num_class_instances)
+{
+	shadow_shader = shader;
+	shadow_num_class_instances = (class_instances != nullptr && num_class_instances <= ARRAYSIZE(shadow_class_instances)) ? num_class_instances : 0;
+	if (shadow_num_class_instances != 0)
+		std::memcpy(shadow_class_instances, class_instances, shadow_num_class_instances * sizeof(*class_instances));
+}
+template <typename T, UINT N>
+static bool shadow_slots(T (&shadow_slots)[N], UINT first, UINT count, const T *values)
+{
+	// Leave invalid calls to the runtime to deal with
+	if (first > N || count > N - first || (count != 0 && values == nullptr))
+		return false;
+
+	if (count != 0)
+		std::memcpy(shadow_slots + first, values, count * sizeof(T));
+	return true;
+}
 
 D3D11DeviceContext::D3D11DeviceContext(D3D11Device *device, ID3D11DeviceContext  *original) :
 	device_context_impl(device, original),
 	_interface_version(0),
-	_device(device)
+	_device(device),
+	_context_type(original->GetType())
 {
 	assert(_orig != nullptr && _device != nullptr);
 
+	// Optionally shadow the state the application binds, so that state blocks can capture it without querying the device context
+	bool track_modified_states = false;
+	reshade::global_config().get("APP", "D3D11TrackModifiedStates", track_modified_states);
+
+	// Only the immediate context is used to render effects, so do not bother shadowing the state of deferred contexts
+	if (track_modified_states && _context_type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+	{
+		_state_shadow = std::make_unique<reshade::d3d11::state_shadow>();
+		// The proxy is created right alongside the device context, so its state is still the default one
+		_state_shadow->reset();
+	}
+
 #if RESHADE_ADDON
 	reshade::invoke_addon_event<reshade::addon_event::init_command_list>(this);
-	if (_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+	if (_context_type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
 		reshade::invoke_addon_event<reshade::addon_event::init_command_queue>(this);
 #endif
 }
@@ -43,7 +79,7 @@ D3D11DeviceContext::D3D11DeviceContext(D3D11Device *device, ID3D11DeviceContext3
 D3D11DeviceContext::~D3D11DeviceContext()
 {
 #if RESHADE_ADDON
-	if (_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+	if (_context_type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
 		reshade::invoke_addon_event<reshade::addon_event::destroy_command_queue>(this);
 	reshade::invoke_addon_event<reshade::addon_event::destroy_command_list>(this);
 #endif
@@ -111,7 +147,7 @@ HRESULT STDMETHODCALLTYPE D3D11DeviceContext::QueryInterface(REFIID riid, void *
 ULONG   STDMETHODCALLTYPE D3D11DeviceContext::AddRef()
 {
 	// The immediate device context is tightly coupled with its device, so simply use the device reference count
-	if (_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+	if (_context_type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
 		return _device->AddRef() - 1;
 
 	_orig->AddRef();
@@ -119,7 +155,7 @@ ULONG   STDMETHODCALLTYPE D3D11DeviceContext::AddRef()
 }
 ULONG   STDMETHODCALLTYPE D3D11DeviceContext::Release()
 {
-	if (_orig->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE)
+	if (_context_type == D3D11_DEVICE_CONTEXT_IMMEDIATE)
 		return _device->Release() - 1;
 
 	const ULONG ref = InterlockedDecrement(&_ref);
@@ -180,6 +216,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetShaderResources(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetShader(ID3D11PixelShader *pPixelShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->PSSetShader(pPixelShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->ps, _state_shadow->ps_num_class_instances, _state_shadow->ps_class_instances, pPixelShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::ps;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::pixel_shader, to_handle(pPixelShader));
 #endif
@@ -187,6 +228,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetShader(ID3D11PixelShader *pPi
 void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
 	_orig->PSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (_state_shadow != nullptr && !shadow_slots(_state_shadow->ps_sampler_states, StartSlot, NumSamplers, ppSamplers))
+		_state_shadow->valid_mask &= ~state_block::ps_samplers;
 #if RESHADE_ADDON >= 2
 	invoke_bind_samplers_event(reshade::api::shader_stage::pixel, StartSlot, NumSamplers, ppSamplers);
 #endif
@@ -194,6 +237,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetSamplers(UINT StartSlot, UINT
 void    STDMETHODCALLTYPE D3D11DeviceContext::VSSetShader(ID3D11VertexShader *pVertexShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->vs, _state_shadow->vs_num_class_instances, _state_shadow->vs_class_instances, pVertexShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::vs;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::vertex_shader, to_handle(pVertexShader));
 #endif
@@ -291,6 +339,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::PSSetConstantBuffers(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::IASetInputLayout(ID3D11InputLayout *pInputLayout)
 {
 	_orig->IASetInputLayout(pInputLayout);
+	if (_state_shadow != nullptr)
+	{
+		_state_shadow->ia_input_layout = pInputLayout;
+		_state_shadow->valid_mask |= state_block::ia_input_layout;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::input_assembler, to_handle(pInputLayout));
 #endif
@@ -353,6 +406,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::GSSetConstantBuffers(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::GSSetShader(ID3D11GeometryShader *pShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->GSSetShader(pShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->gs, _state_shadow->gs_num_class_instances, _state_shadow->gs_class_instances, pShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::gs;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::geometry_shader | reshade::api::pipeline_stage::stream_output, to_handle(pShader));
 #endif
@@ -360,6 +418,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::GSSetShader(ID3D11GeometryShader *
 void    STDMETHODCALLTYPE D3D11DeviceContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology)
 {
 	_orig->IASetPrimitiveTopology(Topology);
+	if (_state_shadow != nullptr)
+	{
+		_state_shadow->ia_primitive_topology = Topology;
+		_state_shadow->valid_mask |= state_block::ia_primitive_topology;
+	}
 
 #if RESHADE_ADDON >= 2
 	const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::primitive_topology };
@@ -378,6 +441,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::VSSetShaderResources(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::VSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
 	_orig->VSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (_state_shadow != nullptr && !shadow_slots(_state_shadow->vs_sampler_states, StartSlot, NumSamplers, ppSamplers))
+		_state_shadow->valid_mask &= ~state_block::vs_samplers;
 #if RESHADE_ADDON >= 2
 	invoke_bind_samplers_event(reshade::api::shader_stage::vertex, StartSlot, NumSamplers, ppSamplers);
 #endif
@@ -465,6 +530,14 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargetsAndUnorderedAcce
 void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetBlendState(ID3D11BlendState *pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
 {
 	_orig->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
+	if (_state_shadow != nullptr)
+	{
+		_state_shadow->om_blend_state = pBlendState;
+		for (int i = 0; i < 4; ++i)
+			_state_shadow->om_blend_factor[i] = BlendFactor != nullptr ? BlendFactor[i] : 1.0f; // Passing no blend factor is equivalent to passing { 1, 1, 1, 1 }
+		_state_shadow->om_sample_mask = SampleMask;
+		_state_shadow->valid_mask |= state_block::om_blend_state;
+	}
 
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::output_merger, to_handle(pBlendState));
@@ -483,6 +556,12 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetBlendState(ID3D11BlendState *
 void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetDepthStencilState(ID3D11DepthStencilState *pDepthStencilState, UINT StencilRef)
 {
 	_orig->OMSetDepthStencilState(pDepthStencilState, StencilRef);
+	if (_state_shadow != nullptr)
+	{
+		_state_shadow->om_depth_stencil_state = pDepthStencilState;
+		_state_shadow->om_stencil_ref = StencilRef;
+		_state_shadow->valid_mask |= state_block::om_depth_stencil_state;
+	}
 
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::depth_stencil, to_handle(pDepthStencilState));
@@ -561,6 +640,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::DispatchIndirect(ID3D11Buffer *pBu
 void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetState(ID3D11RasterizerState *pRasterizerState)
 {
 	_orig->RSSetState(pRasterizerState);
+	if (_state_shadow != nullptr)
+	{
+		_state_shadow->rs_state = pRasterizerState;
+		_state_shadow->valid_mask |= state_block::rs_state;
+	}
 
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::rasterizer, to_handle(pRasterizerState));
@@ -569,6 +653,19 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetState(ID3D11RasterizerState *
 void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT *pViewports)
 {
 	_orig->RSSetViewports(NumViewports, pViewports);
+	if (_state_shadow != nullptr)
+	{
+		// Setting viewports unbinds all that come after them
+		if (shadow_slots(_state_shadow->rs_viewports, 0, NumViewports, pViewports))
+		{
+			_state_shadow->rs_num_viewports = NumViewports;
+			_state_shadow->valid_mask |= state_block::rs_viewports;
+		}
+		else
+		{
+			_state_shadow->valid_mask &= ~state_block::rs_viewports;
+		}
+	}
 
 #if RESHADE_ADDON
 	reshade::invoke_addon_event<reshade::addon_event::bind_viewports>(this, 0, NumViewports, reinterpret_cast<const reshade::api::viewport *>(pViewports));
@@ -577,6 +674,18 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetViewports(UINT NumViewports,
 void    STDMETHODCALLTYPE D3D11DeviceContext::RSSetScissorRects(UINT NumRects, const D3D11_RECT *pRects)
 {
 	_orig->RSSetScissorRects(NumRects, pRects);
+	if (_state_shadow != nullptr)
+	{
+		if (shadow_slots(_state_shadow->rs_scissor_rects, 0, NumRects, pRects))
+		{
+			_state_shadow->rs_num_scissor_rects = NumRects;
+			_state_shadow->valid_mask |= state_block::rs_scissor_rects;
+		}
+		else
+		{
+			_state_shadow->valid_mask &= ~state_block::rs_scissor_rects;
+		}
+	}
 
 #if RESHADE_ADDON
 	reshade::invoke_addon_event<reshade::addon_event::bind_scissor_rects>(this, 0, NumRects, reinterpret_cast<const reshade::api::rect *>(pRects));
@@ -816,6 +925,10 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::ExecuteCommandList(ID3D11CommandLi
 
 	// Get original command list pointer from proxy object and execute with it
 	_orig->ExecuteCommandList(command_list_proxy->_orig, RestoreContextState);
+
+	// Without restoring the context state, it is cleared after executing the command list
+	if (_state_shadow != nullptr && !RestoreContextState)
+		_state_shadow->reset();
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::HSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
@@ -827,6 +940,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::HSSetShaderResources(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::HSSetShader(ID3D11HullShader *pHullShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->HSSetShader(pHullShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->hs, _state_shadow->hs_num_class_instances, _state_shadow->hs_class_instances, pHullShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::hs;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::hull_shader, to_handle(pHullShader));
 #endif
@@ -855,6 +973,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::DSSetShaderResources(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::DSSetShader(ID3D11DomainShader *pDomainShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->DSSetShader(pDomainShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->ds, _state_shadow->ds_num_class_instances, _state_shadow->ds_class_instances, pDomainShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::ds;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::domain_shader, to_handle(pDomainShader));
 #endif
@@ -890,6 +1013,11 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CSSetUnorderedAccessViews(UINT Sta
 void    STDMETHODCALLTYPE D3D11DeviceContext::CSSetShader(ID3D11ComputeShader *pComputeShader, ID3D11ClassInstance *const *ppClassInstances, UINT NumClassInstances)
 {
 	_orig->CSSetShader(pComputeShader, ppClassInstances, NumClassInstances);
+	if (_state_shadow != nullptr)
+	{
+		shadow_shader(_state_shadow->cs, _state_shadow->cs_num_class_instances, _state_shadow->cs_class_instances, pComputeShader, ppClassInstances, NumClassInstances);
+		_state_shadow->valid_mask |= state_block::cs;
+	}
 #if RESHADE_ADDON >= 2
 	reshade::invoke_addon_event<reshade::addon_event::bind_pipeline>(this, reshade::api::pipeline_stage::compute_shader, to_handle(pComputeShader));
 #endif
@@ -897,6 +1025,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CSSetShader(ID3D11ComputeShader *p
 void    STDMETHODCALLTYPE D3D11DeviceContext::CSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState *const *ppSamplers)
 {
 	_orig->CSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	if (_state_shadow != nullptr && !shadow_slots(_state_shadow->cs_sampler_states, StartSlot, NumSamplers, ppSamplers))
+		_state_shadow->valid_mask &= ~state_block::cs_samplers;
 #if RESHADE_ADDON >= 2
 	invoke_bind_samplers_event(reshade::api::shader_stage::compute, StartSlot, NumSamplers, ppSamplers);
 #endif
@@ -1063,6 +1193,8 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CSGetConstantBuffers(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::ClearState()
 {
 	_orig->ClearState();
+	if (_state_shadow != nullptr)
+		_state_shadow->reset();
 
 #if RESHADE_ADDON >= 2
 	// Call events with cleared state
@@ -1130,7 +1262,7 @@ HRESULT STDMETHODCALLTYPE D3D11DeviceContext::FinishCommandList(BOOL RestoreDefe
 }
 D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE D3D11DeviceContext::GetType()
 {
-	return _orig->GetType();
+	return _context_type;
 }
 
 void    STDMETHODCALLTYPE D3D11DeviceContext::CopySubresourceRegion1(ID3D11Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource *pSrcResource, UINT SrcSubresource, const D3D11_BOX *pSrcBox, UINT CopyFlags)
@@ -1361,6 +1493,10 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::SwapDeviceContextState(ID3DDeviceC
 {
 	assert(_interface_version >= 1);
 	static_cast<ID3D11DeviceContext1 *>(_orig)->SwapDeviceContextState(pState, ppPreviousState);
+
+	// Nothing is known about the state that was swapped in
+	if (_state_shadow != nullptr)
+		_state_shadow->valid_mask = 0;
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::ClearView(ID3D11View *pView, const FLOAT Color[4], const D3D11_RECT *pRect, UINT NumRects)
 {
@@ -194,4 +194,6 @@ struct DECLSPEC_UUID("27B0246B-2152-4D42-AD11-32489472238F") D3D11DeviceContext
 	unsigned short _interface_version;
 
 	D3D11Device *const _device;
+	// The type never changes over the lifetime of a context, so cache it instead of calling into the runtime on every reference count change
+	const D3D11_DEVICE_CONTEXT_TYPE _context_type;
 };
@@ -11,6 +11,51 @@
 #include <algorithm> // std::find
 #include <utf8/unchecked.h>
 
+static uint32_t convert_pipeline_stages_to_state_mask(reshade::api::pipeline_stage stages)
+{
+	using reshade::api::pipeline_stage;
+	using reshade::d3d11::state_block;
+
+	uint32_t mask = 0;
+	if ((stages & pipeline_stage::vertex_shader) != 0)
+		mask |= state_block::vs;
+	if ((stages & pipeline_stage::hull_shader) != 0)
+		mask |= state_block::hs;
+	if ((stages & pipeline_stage::domain_shader) != 0)
+		mask |= state_block::ds;
+	if ((stages & pipeline_stage::geometry_shader) != 0)
+		mask |= state_block::gs;
+	if ((stages & pipeline_stage::pixel_shader) != 0)
+		mask |= state_block::ps;
+	if ((stages & pipeline_stage::compute_shader) != 0)
+		mask |= state_block::cs;
+	if ((stages & pipeline_stage::input_assembler) != 0)
+		mask |= state_block::ia_input_layout | state_block::ia_primitive_topology;
+	if ((stages & pipeline_stage::rasterizer) != 0)
+		mask |= state_block::rs_state;
+	if ((stages & pipeline_stage::depth_stencil) != 0)
+		mask |= state_block::om_depth_stencil_state;
+	if ((stages & pipeline_stage::output_merger) != 0)
+		mask |= state_block::om_blend_state;
+	return mask;
+}
+static uint32_t convert_shader_stages_to_state_mask(reshade::api::shader_stage stages, uint32_t vs_mask, uint32_t gs_mask, uint32_t ps_mask, uint32_t cs_mask)
+{
+	using reshade::api::shader_stage;
+
+	// Bindings of the hull and domain shader stages are not covered by the state block
+	uint32_t mask = 0;
+	if ((stages & shader_stage::vertex) == shader_stage::vertex)
+		mask |= vs_mask;
+	if ((stages & shader_stage::geometry) == shader_stage::geometry)
+		mask |= gs_mask;
+	if ((stages & shader_stage::pixel) == shader_stage::pixel)
+		mask |= ps_mask;
+	if ((stages & shader_stage::compute) == shader_stage::compute)
+		mask |= cs_mask;
+	return mask;
+}
+
 void reshade::d3d11::pipeline_impl::apply(ID3D11DeviceContext *ctx, api::pipeline_stage stages) const
 {
 	if ((stages & api::pipeline_stage::vertex_shader) != 0)
@@ -71,6 +116,8 @@ void reshade::d3d11::device_context_impl::barrier(uint32_t count, const api::res
 
 	if (transitions_away_from_shader_resource_usage != 0)
 	{
+		on_modify_state(state_block::vs_shader_resources | state_block::gs_shader_resources | state_block::ps_shader_resources | state_block::cs_shader_resources);
+
 #if 1
 #define UNBIND_SHADER_RESOURCE_VIEWS(stage) \
 		bool update_##stage = false; \
@@ -111,6 +158,8 @@ void reshade::d3d11::device_context_impl::barrier(uint32_t count, const api::res
 	}
 	if (transitions_away_from_unordered_access_usage != 0)
 	{
+		on_modify_state(state_block::cs_unordered_access_views);
+
 		const D3D_FEATURE_LEVEL feature_level = _device_impl->_orig->GetFeatureLevel();
 		const UINT max_uav_bindings =
 			feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
@@ -175,6 +224,8 @@ void reshade::d3d11::device_context_impl::begin_render_pass(uint32_t count, cons
 }
 void reshade::d3d11::device_context_impl::end_render_pass()
 {
+	on_modify_state(state_block::om_render_targets);
+
 	// Reset render targets
 	_orig->OMSetRenderTargets(0, nullptr, nullptr);
 }
@@ -191,6 +242,8 @@ void reshade::d3d11::device_context_impl::bind_render_targets_and_depth_stencil(
 	const auto rtv_ptrs = reinterpret_cast<ID3D11RenderTargetView *const *>(rtvs);
 #endif
 
+	on_modify_state(state_block::om_render_targets);
+
 	_orig->OMSetRenderTargets(count, rtv_ptrs, reinterpret_cast<ID3D11DepthStencilView *>(dsv.handle));
 }
 
@@ -200,10 +253,13 @@ void reshade::d3d11::device_context_impl::bind_pipeline(api::pipeline_stage stag
 	{
 		// This is a pipeline handle created with 'device_impl::create_pipeline', which can only contain graphics stages
 		assert((stages & api::pipeline_stage::all_graphics) != 0);
+		on_modify_state(convert_pipeline_stages_to_state_mask(stages));
 		reinterpret_cast<pipeline_impl *>(pipeline.handle ^ 1)->apply(_orig, stages);
 		return;
 	}
 
+	on_modify_state(stages == api::pipeline_stage::all ? static_cast<uint32_t>(state_block::all) : convert_pipeline_stages_to_state_mask(stages));
+
 	switch (stages)
 	{
 	case api::pipeline_stage::vertex_shader:
@@ -256,9 +312,11 @@ void reshade::d3d11::device_context_impl::bind_pipeline_states(uint32_t count, c
 		switch (states[i])
 		{
 		case api::dynamic_state::primitive_topology:
+			on_modify_state(state_block::ia_primitive_topology);
 			_orig->IASetPrimitiveTopology(convert_primitive_topology(static_cast<api::primitive_topology>(values[i])));
 			break;
 		case api::dynamic_state::blend_constant:
+			on_modify_state(state_block::om_blend_state);
 			if (const float blend_constant[4] = { ((values[i]) & 0xFF) / 255.0f, ((values[i] >> 4) & 0xFF) / 255.0f, ((values[i] >> 8) & 0xFF) / 255.0f, ((values[i] >> 12) & 0xFF) / 255.0f };
 				i + 1 < count &&
 				states[i + 1] == api::dynamic_state::sample_mask)
@@ -278,6 +336,7 @@ void reshade::d3d11::device_context_impl::bind_pipeline_states(uint32_t count, c
 			break;
 		case api::dynamic_state::sample_mask:
 			{
+				on_modify_state(state_block::om_blend_state);
 				com_ptr<ID3D11BlendState> state;
 				float blend_constant[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 				_orig->OMGetBlendState(&state, blend_constant, nullptr);
@@ -286,6 +345,7 @@ void reshade::d3d11::device_context_impl::bind_pipeline_states(uint32_t count, c
 			break;
 		case api::dynamic_state::front_stencil_reference_value:
 			{
+				on_modify_state(state_block::om_depth_stencil_state);
 				com_ptr<ID3D11DepthStencilState> state;
 				_orig->OMGetDepthStencilState(&state, nullptr);
 				_orig->OMSetDepthStencilState(state.get(), values[i]);
@@ -308,6 +368,8 @@ void reshade::d3d11::device_context_impl::bind_viewports(uint32_t first, uint32_
 		return;
 	}
 
+	on_modify_state(state_block::rs_viewports);
+
 	_orig->RSSetViewports(count, reinterpret_cast<const D3D11_VIEWPORT *>(viewports));
 }
 void reshade::d3d11::device_context_impl::bind_scissor_rects(uint32_t first, uint32_t count, const api::rect *rects)
@@ -318,6 +380,8 @@ void reshade::d3d11::device_context_impl::bind_scissor_rects(uint32_t first, uin
 		return;
 	}
 
+	on_modify_state(state_block::rs_scissor_rects);
+
 	_orig->RSSetScissorRects(count, reinterpret_cast<const D3D11_RECT *>(rects));
 }
 
@@ -334,6 +398,8 @@ void reshade::d3d11::device_context_impl::bind_samplers(api::shader_stage stages
 	const auto sampler_ptrs = reinterpret_cast<ID3D11SamplerState *const *>(samplers);
 #endif
 
+	on_modify_state(convert_shader_stages_to_state_mask(stages, state_block::vs_samplers, 0, state_block::ps_samplers, state_block::cs_samplers));
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 		_orig->VSSetSamplers(first, count, sampler_ptrs);
 	if ((stages & api::shader_stage::hull) == api::shader_stage::hull)
@@ -360,6 +426,8 @@ void reshade::d3d11::device_context_impl::bind_shader_resource_views(api::shader
 	const auto view_ptrs = reinterpret_cast<ID3D11ShaderResourceView *const *>(views);
 #endif
 
+	on_modify_state(convert_shader_stages_to_state_mask(stages, state_block::vs_shader_resources, state_block::gs_shader_resources, state_block::ps_shader_resources, state_block::cs_shader_resources));
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 		_orig->VSSetShaderResources(first, count, view_ptrs);
 	if ((stages & api::shader_stage::hull) == api::shader_stage::hull)
@@ -386,6 +454,9 @@ void reshade::d3d11::device_context_impl::bind_unordered_access_views(api::shade
 	const auto view_ptrs = reinterpret_cast<ID3D11UnorderedAccessView *const *>(views);
 #endif
 
+	// Pixel shader UAVs are not covered by the state block, but binding them unbinds overlapping render targets
+	on_modify_state(convert_shader_stages_to_state_mask(stages, 0, 0, state_block::om_render_targets, state_block::cs_unordered_access_views));
+
 	if ((stages & api::shader_stage::pixel) == api::shader_stage::pixel)
 		_orig->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, first, count, view_ptrs, nullptr);
 	if ((stages & api::shader_stage::compute) == api::shader_stage::compute)
@@ -427,6 +498,8 @@ void reshade::d3d11::device_context_impl::bind_constant_buffers(api::shader_stag
 		}
 	}
 
+	on_modify_state(convert_shader_stages_to_state_mask(stages, state_block::vs_constant_buffers, 0, state_block::ps_constant_buffers, state_block::cs_constant_buffers));
+
 	com_ptr<ID3D11DeviceContext1> context1;
 	if (whole_range ||
 		FAILED(_orig->QueryInterface(&context1)))
@@ -517,6 +590,8 @@ void reshade::d3d11::device_context_impl::push_constants(api::shader_stage stage
 		_orig->Unmap(push_constants, 0);
 	}
 
+	on_modify_state(convert_shader_stages_to_state_mask(stages, state_block::vs_constant_buffers, 0, state_block::ps_constant_buffers, state_block::cs_constant_buffers));
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 		_orig->VSSetConstantBuffers(push_constants_slot, 1, &push_constants);
 	if ((stages & api::shader_stage::hull) == api::shader_stage::hull)
@@ -585,6 +660,8 @@ void reshade::d3d11::device_context_impl::bind_index_buffer(api::resource buffer
 	assert(offset <= std::numeric_limits<UINT>::max());
 	assert(buffer == 0 || index_size == 2 || index_size == 4);
 
+	on_modify_state(state_block::ia_index_buffer);
+
 	_orig->IASetIndexBuffer(reinterpret_cast<ID3D11Buffer *>(buffer.handle), index_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, static_cast<UINT>(offset));
 }
 void reshade::d3d11::device_context_impl::bind_vertex_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint32_t *strides)
@@ -604,6 +681,8 @@ void reshade::d3d11::device_context_impl::bind_vertex_buffers(uint32_t first, ui
 	for (uint32_t i = 0; i < count; ++i)
 		offsets_32[i] = static_cast<UINT>(offsets[i]);
 
+	on_modify_state(state_block::ia_vertex_buffers);
+
 	_orig->IASetVertexBuffers(first, count, buffer_ptrs, strides, offsets_32.p);
 }
 void reshade::d3d11::device_context_impl::bind_stream_output_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint64_t *, const api::resource *, const uint64_t *)
@@ -623,6 +702,9 @@ void reshade::d3d11::device_context_impl::bind_stream_output_buffers(uint32_t fi
 	for (uint32_t i = 0; i < count; ++i)
 		offsets_32[i] = static_cast<UINT>(offsets[i]);
 
+	// Stream output targets are not covered by the state block, but binding them unbinds the buffers from other bindings
+	on_modify_state(state_block::outputs);
+
 	_orig->SOSetTargets(count, buffer_ptrs, offsets_32.p);
 }
 
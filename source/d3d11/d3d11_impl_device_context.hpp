@@ -5,6 +5,9 @@
 
 #pragma once
 
+#include "d3d11_impl_state_block.hpp"
+#include <memory>
+
 namespace reshade::d3d11
 {
 	class device_impl;
@@ -74,6 +77,8 @@ namespace reshade::d3d11
 
 	class device_context_impl : public api::api_object_impl<ID3D11DeviceContext *, api::command_queue, api::command_list>
 	{
+		friend class state_block;
+
 	public:
 		device_context_impl(device_impl *device, ID3D11DeviceContext *context);
 
@@ -149,6 +154,24 @@ namespace reshade::d3d11
 
 		uint64_t get_timestamp_frequency() const final;
 
+	protected:
+		/// <summary>
+		/// Called before ReShade modifies any of the specified states (see <see cref="state_block::state_mask"/>) on this device context.
+		/// </summary>
+		void on_modify_state(uint32_t mask)
+		{
+			if (_tracking_state_block != nullptr)
+				_tracking_state_block->on_modify(mask);
+			// Without a state block restoring them afterwards, the application objects may be unbound for good, after which they can be released, so stop trusting the shadow
+			else if (_state_shadow != nullptr)
+				_state_shadow->valid_mask &= ~mask;
+		}
+
+		// State block that is currently capturing, which has to be notified before any state is modified
+		state_block *_tracking_state_block = nullptr;
+		// Shadow of the state the application bound, which is only maintained by the device context proxy
+		std::unique_ptr<state_shadow> _state_shadow;
+
 	private:
 		device_impl *const _device_impl;
 		com_ptr<ID3DUserDefinedAnnotation> _annotations;
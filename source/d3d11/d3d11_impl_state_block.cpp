@@ -3,10 +3,14 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include "d3d11_impl_device.hpp"
+#include "d3d11_impl_device_context.hpp"
 #include "d3d11_impl_state_block.hpp"
+#include <cstring> // std::memcpy, std::memset
 
-reshade::d3d11::state_block::state_block(com_ptr<ID3D11Device> device) :
-	_device_feature_level(device->GetFeatureLevel())
+reshade::d3d11::state_block::state_block(com_ptr<ID3D11Device> device, bool track_modified_states) :
+	_device_feature_level(device->GetFeatureLevel()),
+	_track_modified_states(track_modified_states)
 {
 #if RESHADE_D3D11_STATE_BLOCK_TYPE
 	// Unfortunately this breaks RTSS, because calling 'ID3D11Device::CreateDeviceContextState' will expose the 'ID3D10Device' interface on the D3D11 device, making RTSS use its D3D10 renderer while the interface is locked out
@@ -20,13 +24,15 @@ reshade::d3d11::state_block::state_block(com_ptr<ID3D11Device> device) :
 }
 reshade::d3d11::state_block::~state_block()
 {
+	if (_tracking_device_context != nullptr && _tracking_device_context->_tracking_state_block == this)
+		_tracking_device_context->_tracking_state_block = _parent_tracking_state_block;
 }
 
-void reshade::d3d11::state_block::capture(ID3D11DeviceContext *device_context)
+void reshade::d3d11::state_block::capture(device_context_impl *device_context)
 {
 	assert(_device_context == nullptr);
 
-	_device_context = device_context;
+	_device_context = reinterpret_cast<ID3D11DeviceContext *>(device_context->get_native());
 
 #if RESHADE_D3D11_STATE_BLOCK_TYPE
 	com_ptr<ID3D11DeviceContext1> device_context1;
@@ -37,138 +43,329 @@ void reshade::d3d11::state_block::capture(ID3D11DeviceContext *device_context)
 	}
 #endif
 
-	_device_context->IAGetPrimitiveTopology(&_ia_primitive_topology);
-	_device_context->IAGetInputLayout(&_ia_input_layout);
+	// Register even when capturing everything, so that the device context knows its state is going to be restored and the shadow stays valid
+	_tracking_device_context = device_context;
+	_parent_tracking_state_block = device_context->_tracking_state_block;
+	device_context->_tracking_state_block = this;
 
-	if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
-		_device_context->IAGetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer **>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
-	else
-		_device_context->IAGetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer **>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+	if (_track_modified_states)
+	{
+		// States are captured individually in 'on_modify' as they are encountered
+		_captured_mask = 0;
+		return;
+	}
+
+	capture(state_mask::all);
+	_captured_mask = state_mask::all;
+}
+void reshade::d3d11::state_block::apply_and_release()
+{
+#if RESHADE_D3D11_STATE_BLOCK_TYPE
+	com_ptr<ID3D11DeviceContext1> device_context1;
+	if (_state != nullptr && _device_context->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE && SUCCEEDED(_device_context->QueryInterface(&device_context1)))
+	{
+		device_context1->SwapDeviceContextState(_captured_state.get(), nullptr);
 
-	_device_context->IAGetIndexBuffer(&_ia_index_buffer, &_ia_index_format, &_ia_index_offset);
+		_captured_state.reset();
+		_device_context.reset();
+		return;
+	}
+#endif
+
+	if (_tracking_device_context != nullptr)
+		_tracking_device_context->_tracking_state_block = _parent_tracking_state_block;
+	_tracking_device_context = nullptr;
+
+	apply(_captured_mask);
+
+	com_ptr<ID3D11Device> device;
+	_device_context->GetDevice(&device);
+
+	// Release all captured objects again
+	*this = state_block(std::move(device), _track_modified_states);
+}
+
+void reshade::d3d11::state_block::on_modify(uint32_t mask)
+{
+	// Binding a resource as an output unbinds it from all other bindings, so capture everything that may be changed as a side effect as well
+	if ((mask & state_mask::outputs) != 0)
+		mask |= state_mask::inputs | state_mask::outputs;
+
+	const uint32_t missing_mask = mask & ~_captured_mask;
+	if (missing_mask == 0)
+		return;
+
+	capture(missing_mask);
+	_captured_mask |= missing_mask;
+}
+
+void reshade::d3d11::state_block::capture(uint32_t mask)
+{
+	// Take states the application bound through the device context proxy from its shadow, instead of querying them (which also adds a reference to every returned object)
+	const state_shadow *const shadow = _tracking_device_context != nullptr ? _tracking_device_context->_state_shadow.get() : nullptr;
+	const uint32_t shadowed_mask = shadow != nullptr ? (mask & shadow->valid_mask) : 0;
+
+	if (mask & state_mask::ia_primitive_topology)
+	{
+		if (shadowed_mask & state_mask::ia_primitive_topology)
+			_ia_primitive_topology = shadow->ia_primitive_topology;
+		else
+			_device_context->IAGetPrimitiveTopology(&_ia_primitive_topology);
+	}
+	if (mask & state_mask::ia_input_layout)
+	{
+		if (shadowed_mask & state_mask::ia_input_layout)
+			_ia_input_layout = shadow->ia_input_layout;
+		else
+			_device_context->IAGetInputLayout(&_ia_input_layout);
+	}
+
+	if (mask & state_mask::ia_vertex_buffers)
+	{
+		if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
+			_device_context->IAGetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer **>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+		else
+			_device_context->IAGetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer **>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+	}
+
+	if (mask & state_mask::ia_index_buffer)
+		_device_context->IAGetIndexBuffer(&_ia_index_buffer, &_ia_index_format, &_ia_index_offset);
+
+	if (mask & state_mask::rs_state)
+	{
+		if (shadowed_mask & state_mask::rs_state)
+			_rs_state = shadow->rs_state;
+		else
+			_device_context->RSGetState(&_rs_state);
+	}
+	if (mask & state_mask::rs_viewports)
+	{
+		if (shadowed_mask & state_mask::rs_viewports)
+		{
+			_rs_num_viewports = shadow->rs_num_viewports;
+			std::memcpy(_rs_viewports, shadow->rs_viewports, _rs_num_viewports * sizeof(D3D11_VIEWPORT));
+		}
+		else
+		{
+			_device_context->RSGetViewports(&_rs_num_viewports, nullptr);
+			_device_context->RSGetViewports(&_rs_num_viewports, _rs_viewports);
+		}
+	}
+	if (mask & state_mask::rs_scissor_rects)
+	{
+		if (shadowed_mask & state_mask::rs_scissor_rects)
+		{
+			_rs_num_scissor_rects = shadow->rs_num_scissor_rects;
+			std::memcpy(_rs_scissor_rects, shadow->rs_scissor_rects, _rs_num_scissor_rects * sizeof(D3D11_RECT));
+		}
+		else
+		{
+			_device_context->RSGetScissorRects(&_rs_num_scissor_rects, nullptr);
+			_device_context->RSGetScissorRects(&_rs_num_scissor_rects, _rs_scissor_rects);
+		}
+	}
 
-	_device_context->RSGetState(&_rs_state);
-	_device_context->RSGetViewports(&_rs_num_viewports, nullptr);
-	_device_context->RSGetViewports(&_rs_num_viewports, _rs_viewports);
-	_device_context->RSGetScissorRects(&_rs_num_scissor_rects, nullptr);
-	_device_context->RSGetScissorRects(&_rs_num_scissor_rects, _rs_scissor_rects);
+#define CAPTURE_SHADER(stage, type) \
+	if (mask & state_mask::stage) \
+	{ \
+		if (shadowed_mask & state_mask::stage) \
+		{ \
+			_##stage = shadow->stage; \
+			_##stage##_num_class_instances = shadow->stage##_num_class_instances; \
+			for (UINT i = 0; i < _##stage##_num_class_instances; ++i) \
+				_##stage##_class_instances[i] = shadow->stage##_class_instances[i]; \
+		} \
+		else \
+		{ \
+			_##stage##_num_class_instances = ARRAYSIZE(_##stage##_class_instances); \
+			_device_context->type##GetShader(&_##stage, reinterpret_cast<ID3D11ClassInstance **>(_##stage##_class_instances), &_##stage##_num_class_instances); \
+		} \
+	}
+#define CAPTURE_SAMPLERS(stage, type) \
+	if (mask & state_mask::stage##_samplers) \
+	{ \
+		if (shadowed_mask & state_mask::stage##_samplers) \
+		{ \
+			for (UINT i = 0; i < ARRAYSIZE(_##stage##_sampler_states); ++i) \
+				_##stage##_sampler_states[i] = shadow->stage##_sampler_states[i]; \
+		} \
+		else \
+		{ \
+			_device_context->type##GetSamplers(0, ARRAYSIZE(_##stage##_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_##stage##_sampler_states)); \
+		} \
+	}
 
-	_vs_num_class_instances = ARRAYSIZE(_vs_class_instances);
-	_device_context->VSGetShader(&_vs, reinterpret_cast<ID3D11ClassInstance **>(_vs_class_instances), &_vs_num_class_instances);
-	_device_context->VSGetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_vs_constant_buffers));
-	_device_context->VSGetSamplers(0, ARRAYSIZE(_vs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_vs_sampler_states));
-	_device_context->VSGetShaderResources(0, ARRAYSIZE(_vs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_vs_shader_resources));
+	CAPTURE_SHADER(vs, VS);
+	if (mask & state_mask::vs_constant_buffers)
+		_device_context->VSGetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_vs_constant_buffers));
+	CAPTURE_SAMPLERS(vs, VS);
+	if (mask & state_mask::vs_shader_resources)
+		_device_context->VSGetShaderResources(0, ARRAYSIZE(_vs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_vs_shader_resources));
 
 	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 	{
 		if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
 		{
-			_hs_num_class_instances = ARRAYSIZE(_hs_class_instances);
-			_device_context->HSGetShader(&_hs, reinterpret_cast<ID3D11ClassInstance **>(_hs_class_instances), &_hs_num_class_instances);
-
-			_ds_num_class_instances = ARRAYSIZE(_ds_class_instances);
-			_device_context->DSGetShader(&_ds, reinterpret_cast<ID3D11ClassInstance **>(_ds_class_instances), &_ds_num_class_instances);
+			CAPTURE_SHADER(hs, HS);
+			CAPTURE_SHADER(ds, DS);
 		}
 
-		_gs_num_class_instances = ARRAYSIZE(_gs_class_instances);
-		_device_context->GSGetShader(&_gs, reinterpret_cast<ID3D11ClassInstance **>(_gs_class_instances), &_gs_num_class_instances);
-		_device_context->GSGetShaderResources(0, ARRAYSIZE(_gs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_gs_shader_resources));
+		CAPTURE_SHADER(gs, GS);
+		if (mask & state_mask::gs_shader_resources)
+			_device_context->GSGetShaderResources(0, ARRAYSIZE(_gs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_gs_shader_resources));
 	}
 
-	_ps_num_class_instances = ARRAYSIZE(_ps_class_instances);
-	_device_context->PSGetShader(&_ps, reinterpret_cast<ID3D11ClassInstance **>(_ps_class_instances), &_ps_num_class_instances);
-	_device_context->PSGetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_ps_constant_buffers));
-	_device_context->PSGetSamplers(0, ARRAYSIZE(_ps_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_ps_sampler_states));
-	_device_context->PSGetShaderResources(0, ARRAYSIZE(_ps_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_ps_shader_resources));
+	CAPTURE_SHADER(ps, PS);
+	if (mask & state_mask::ps_constant_buffers)
+		_device_context->PSGetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_ps_constant_buffers));
+	CAPTURE_SAMPLERS(ps, PS);
+	if (mask & state_mask::ps_shader_resources)
+		_device_context->PSGetShaderResources(0, ARRAYSIZE(_ps_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_ps_shader_resources));
 
-	_device_context->OMGetBlendState(&_om_blend_state, _om_blend_factor, &_om_sample_mask);
-	_device_context->OMGetDepthStencilState(&_om_depth_stencil_state, &_om_stencil_ref);
-	_device_context->OMGetRenderTargets(ARRAYSIZE(_om_render_targets), reinterpret_cast<ID3D11RenderTargetView **>(_om_render_targets), &_om_depth_stencil);
-
-	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+	if (mask & state_mask::om_blend_state)
 	{
-		_cs_num_class_instances = ARRAYSIZE(_cs_class_instances);
-		_device_context->CSGetShader(&_cs, reinterpret_cast<ID3D11ClassInstance **>(_cs_class_instances), &_cs_num_class_instances);
-		_device_context->CSGetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_cs_constant_buffers));
-		_device_context->CSGetSamplers(0, ARRAYSIZE(_cs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_cs_sampler_states));
-		_device_context->CSGetShaderResources(0, ARRAYSIZE(_cs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_cs_shader_resources));
-		_device_context->CSGetUnorderedAccessViews(0,
-			_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
-			_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, reinterpret_cast<ID3D11UnorderedAccessView **>(_cs_unordered_access_views));
+		if (shadowed_mask & state_mask::om_blend_state)
+		{
+			_om_blend_state = shadow->om_blend_state;
+			std::memcpy(_om_blend_factor, shadow->om_blend_factor, sizeof(_om_blend_factor));
+			_om_sample_mask = shadow->om_sample_mask;
+		}
+		else
+		{
+			_device_context->OMGetBlendState(&_om_blend_state, _om_blend_factor, &_om_sample_mask);
+		}
 	}
-}
-void reshade::d3d11::state_block::apply_and_release()
-{
-#if RESHADE_D3D11_STATE_BLOCK_TYPE
-	com_ptr<ID3D11DeviceContext1> device_context1;
-	if (_state != nullptr && _device_context->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE && SUCCEEDED(_device_context->QueryInterface(&device_context1)))
+	if (mask & state_mask::om_depth_stencil_state)
 	{
-		device_context1->SwapDeviceContextState(_captured_state.get(), nullptr);
+		if (shadowed_mask & state_mask::om_depth_stencil_state)
+		{
+			_om_depth_stencil_state = shadow->om_depth_stencil_state;
+			_om_stencil_ref = shadow->om_stencil_ref;
+		}
+		else
+		{
+			_device_context->OMGetDepthStencilState(&_om_depth_stencil_state, &_om_stencil_ref);
+		}
+	}
+	if (mask & state_mask::om_render_targets)
+		_device_context->OMGetRenderTargets(ARRAYSIZE(_om_render_targets), reinterpret_cast<ID3D11RenderTargetView **>(_om_render_targets), &_om_depth_stencil);
 
-		_captured_state.reset();
-		_device_context.reset();
-		return;
+	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
+	{
+		CAPTURE_SHADER(cs, CS);
+		if (mask & state_mask::cs_constant_buffers)
+			_device_context->CSGetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), reinterpret_cast<ID3D11Buffer **>(_cs_constant_buffers));
+		CAPTURE_SAMPLERS(cs, CS);
+		if (mask & state_mask::cs_shader_resources)
+			_device_context->CSGetShaderResources(0, ARRAYSIZE(_cs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView **>(_cs_shader_resources));
+		if (mask & state_mask::cs_unordered_access_views)
+			_device_context->CSGetUnorderedAccessViews(0,
+				_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
+				_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, reinterpret_cast<ID3D11UnorderedAccessView **>(_cs_unordered_access_views));
 	}
-#endif
 
-	_device_context->IASetPrimitiveTopology(_ia_primitive_topology);
-	_device_context->IASetInputLayout(_ia_input_layout.get());
+#undef CAPTURE_SAMPLERS
+#undef CAPTURE_SHADER
+}
+void reshade::d3d11::state_block::apply(uint32_t mask)
+{
+	if (mask & state_mask::ia_primitive_topology)
+		_device_context->IASetPrimitiveTopology(_ia_primitive_topology);
+	if (mask & state_mask::ia_input_layout)
+		_device_context->IASetInputLayout(_ia_input_layout.get());
 
 	// With D3D_FEATURE_LEVEL_10_0 or less, the maximum number of IA Vertex Input Slots is 16
 	// Starting with D3D_FEATURE_LEVEL_10_1 it is 32
 	// See https://docs.microsoft.com/windows/win32/direct3d11/overviews-direct3d-11-devices-downlevel-intro
-	if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
-		_device_context->IASetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer *const *>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
-	else
-		_device_context->IASetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer *const *>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+	if (mask & state_mask::ia_vertex_buffers)
+	{
+		if (_device_feature_level > D3D_FEATURE_LEVEL_10_0)
+			_device_context->IASetVertexBuffers(0, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer *const *>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+		else
+			_device_context->IASetVertexBuffers(0, D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, reinterpret_cast<ID3D11Buffer *const *>(_ia_vertex_buffers), _ia_vertex_strides, _ia_vertex_offsets);
+	}
 
-	_device_context->IASetIndexBuffer(_ia_index_buffer.get(), _ia_index_format, _ia_index_offset);
+	if (mask & state_mask::ia_index_buffer)
+		_device_context->IASetIndexBuffer(_ia_index_buffer.get(), _ia_index_format, _ia_index_offset);
 
-	_device_context->RSSetState(_rs_state.get());
-	_device_context->RSSetViewports(_rs_num_viewports, _rs_viewports);
-	_device_context->RSSetScissorRects(_rs_num_scissor_rects, _rs_scissor_rects);
+	if (mask & state_mask::rs_state)
+		_device_context->RSSetState(_rs_state.get());
+	if (mask & state_mask::rs_viewports)
+		_device_context->RSSetViewports(_rs_num_viewports, _rs_viewports);
+	if (mask & state_mask::rs_scissor_rects)
+		_device_context->RSSetScissorRects(_rs_num_scissor_rects, _rs_scissor_rects);
 
-	_device_context->VSSetShader(_vs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_vs_class_instances), _vs_num_class_instances);
-	_device_context->VSSetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_vs_constant_buffers));
-	_device_context->VSSetSamplers(0, ARRAYSIZE(_vs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_vs_sampler_states));
-	_device_context->VSSetShaderResources(0, ARRAYSIZE(_vs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_vs_shader_resources));
+	if (mask & state_mask::vs)
+		_device_context->VSSetShader(_vs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_vs_class_instances), _vs_num_class_instances);
+	if (mask & state_mask::vs_constant_buffers)
+		_device_context->VSSetConstantBuffers(0, ARRAYSIZE(_vs_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_vs_constant_buffers));
+	if (mask & state_mask::vs_samplers)
+		_device_context->VSSetSamplers(0, ARRAYSIZE(_vs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_vs_sampler_states));
+	if (mask & state_mask::vs_shader_resources)
+		_device_context->VSSetShaderResources(0, ARRAYSIZE(_vs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_vs_shader_resources));
 
 	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 	{
 		if (_device_feature_level >= D3D_FEATURE_LEVEL_11_0)
 		{
-			_device_context->HSSetShader(_hs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_hs_class_instances), _hs_num_class_instances);
-			_device_context->DSSetShader(_ds.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_ds_class_instances), _ds_num_class_instances);
+			if (mask & state_mask::hs)
+				_device_context->HSSetShader(_hs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_hs_class_instances), _hs_num_class_instances);
+			if (mask & state_mask::ds)
+				_device_context->DSSetShader(_ds.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_ds_class_instances), _ds_num_class_instances);
 		}
 
-		_device_context->GSSetShader(_gs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_gs_class_instances), _gs_num_class_instances);
-		_device_context->GSSetShaderResources(0, ARRAYSIZE(_gs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_gs_shader_resources));
+		if (mask & state_mask::gs)
+			_device_context->GSSetShader(_gs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_gs_class_instances), _gs_num_class_instances);
+		if (mask & state_mask::gs_shader_resources)
+			_device_context->GSSetShaderResources(0, ARRAYSIZE(_gs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_gs_shader_resources));
 	}
 
-	_device_context->PSSetShader(_ps.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_ps_class_instances), _ps_num_class_instances);
-	_device_context->PSSetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_ps_constant_buffers));
-	_device_context->PSSetSamplers(0, ARRAYSIZE(_ps_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_ps_sampler_states));
-	_device_context->PSSetShaderResources(0, ARRAYSIZE(_ps_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_ps_shader_resources));
+	if (mask & state_mask::ps)
+		_device_context->PSSetShader(_ps.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_ps_class_instances), _ps_num_class_instances);
+	if (mask & state_mask::ps_constant_buffers)
+		_device_context->PSSetConstantBuffers(0, ARRAYSIZE(_ps_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_ps_constant_buffers));
+	if (mask & state_mask::ps_samplers)
+		_device_context->PSSetSamplers(0, ARRAYSIZE(_ps_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_ps_sampler_states));
+	if (mask & state_mask::ps_shader_resources)
+		_device_context->PSSetShaderResources(0, ARRAYSIZE(_ps_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_ps_shader_resources));
 
-	_device_context->OMSetBlendState(_om_blend_state.get(), _om_blend_factor, _om_sample_mask);
-	_device_context->OMSetDepthStencilState(_om_depth_stencil_state.get(), _om_stencil_ref);
-	_device_context->OMSetRenderTargets(ARRAYSIZE(_om_render_targets), reinterpret_cast<ID3D11RenderTargetView *const *>(_om_render_targets), _om_depth_stencil.get());
+	if (mask & state_mask::om_blend_state)
+		_device_context->OMSetBlendState(_om_blend_state.get(), _om_blend_factor, _om_sample_mask);
+	if (mask & state_mask::om_depth_stencil_state)
+		_device_context->OMSetDepthStencilState(_om_depth_stencil_state.get(), _om_stencil_ref);
+	if (mask & state_mask::om_render_targets)
+		_device_context->OMSetRenderTargets(ARRAYSIZE(_om_render_targets), reinterpret_cast<ID3D11RenderTargetView *const *>(_om_render_targets), _om_depth_stencil.get());
 
 	if (_device_feature_level >= D3D_FEATURE_LEVEL_10_0)
 	{
-		_device_context->CSSetShader(_cs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_cs_class_instances), _cs_num_class_instances);
-		_device_context->CSSetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_cs_constant_buffers));
-		_device_context->CSSetSamplers(0, ARRAYSIZE(_cs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_cs_sampler_states));
-		_device_context->CSSetShaderResources(0, ARRAYSIZE(_cs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_cs_shader_resources));
-		UINT uav_initial_counts[D3D11_1_UAV_SLOT_COUNT];
-		FillMemory(uav_initial_counts, sizeof(uav_initial_counts), -1); // Keep the current offset
-		_device_context->CSSetUnorderedAccessViews(0,
-			_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
-			_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, reinterpret_cast<ID3D11UnorderedAccessView *const *>(_cs_unordered_access_views), uav_initial_counts);
+		if (mask & state_mask::cs)
+			_device_context->CSSetShader(_cs.get(), reinterpret_cast<ID3D11ClassInstance *const *>(_cs_class_instances), _cs_num_class_instances);
+		if (mask & state_mask::cs_constant_buffers)
+			_device_context->CSSetConstantBuffers(0, ARRAYSIZE(_cs_constant_buffers), reinterpret_cast<ID3D11Buffer *const *>(_cs_constant_buffers));
+		if (mask & state_mask::cs_samplers)
+			_device_context->CSSetSamplers(0, ARRAYSIZE(_cs_sampler_states), reinterpret_cast<ID3D11SamplerState **>(_cs_sampler_states));
+		if (mask & state_mask::cs_shader_resources)
+			_device_context->CSSetShaderResources(0, ARRAYSIZE(_cs_shader_resources), reinterpret_cast<ID3D11ShaderResourceView *const *>(_cs_shader_resources));
+		if (mask & state_mask::cs_unordered_access_views)
+		{
+			UINT uav_initial_counts[D3D11_1_UAV_SLOT_COUNT];
+			FillMemory(uav_initial_counts, sizeof(uav_initial_counts), -1); // Keep the current offset
+			_device_context->CSSetUnorderedAccessViews(0,
+				_device_feature_level >= D3D_FEATURE_LEVEL_11_1 ? D3D11_1_UAV_SLOT_COUNT :
+				_device_feature_level == D3D_FEATURE_LEVEL_11_0 ? D3D11_PS_CS_UAV_REGISTER_COUNT : D3D11_CS_4_X_UAV_REGISTER_COUNT, reinterpret_cast<ID3D11UnorderedAccessView *const *>(_cs_unordered_access_views), uav_initial_counts);
+		}
 	}
+}
 
-	com_ptr<ID3D11Device> device;
-	_device_context->GetDevice(&device);
-
-	*this = state_block(std::move(device));
+void reshade::d3d11::state_shadow::reset()
+{
+	std::memset(this, 0, sizeof(*this));
+	ia_primitive_topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	om_blend_factor[0] = D3D11_DEFAULT_BLEND_FACTOR_RED;
+	om_blend_factor[1] = D3D11_DEFAULT_BLEND_FACTOR_GREEN;
+	om_blend_factor[2] = D3D11_DEFAULT_BLEND_FACTOR_BLUE;
+	om_blend_factor[3] = D3D11_DEFAULT_BLEND_FACTOR_ALPHA;
+	om_sample_mask = D3D11_DEFAULT_SAMPLE_MASK;
+	om_stencil_ref = D3D11_DEFAULT_STENCIL_REFERENCE;
+	valid_mask = state_block::state_mask::shadowed;
 }
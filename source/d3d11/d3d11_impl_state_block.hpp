@@ -12,18 +12,80 @@
 
 namespace reshade::d3d11
 {
+	class device_context_impl;
+
 	class state_block
 	{
 	public:
-		explicit state_block(com_ptr<ID3D11Device> device);
+		/// <summary>
+		/// Groups of device context state, used to track which states were modified during a capture.
+		/// </summary>
+		enum state_mask : uint32_t
+		{
+			ia_input_layout = 1 << 0,
+			ia_primitive_topology = 1 << 1,
+			ia_vertex_buffers = 1 << 2,
+			ia_index_buffer = 1 << 3,
+			vs = 1 << 4, // Shader and class instances
+			vs_constant_buffers = 1 << 5,
+			vs_samplers = 1 << 6,
+			vs_shader_resources = 1 << 7,
+			hs = 1 << 8,
+			ds = 1 << 9,
+			gs = 1 << 10,
+			gs_shader_resources = 1 << 11,
+			rs_state = 1 << 12,
+			rs_viewports = 1 << 13,
+			rs_scissor_rects = 1 << 14,
+			ps = 1 << 15,
+			ps_constant_buffers = 1 << 16,
+			ps_samplers = 1 << 17,
+			ps_shader_resources = 1 << 18,
+			om_blend_state = 1 << 19, // Blend state, blend factor and sample mask
+			om_depth_stencil_state = 1 << 20, // Depth-stencil state and stencil reference value
+			om_render_targets = 1 << 21,
+			cs = 1 << 22,
+			cs_constant_buffers = 1 << 23,
+			cs_samplers = 1 << 24,
+			cs_shader_resources = 1 << 25,
+			cs_unordered_access_views = 1 << 26,
+
+			all = (1 << 27) - 1,
+
+			// States that the runtime never unbinds implicitly, so that they can be shadowed (see 'state_shadow')
+			shadowed = ia_input_layout | ia_primitive_topology | vs | vs_samplers | hs | ds | gs | rs_state | rs_viewports | rs_scissor_rects | ps | ps_samplers | om_blend_state | om_depth_stencil_state | cs | cs_samplers,
+			// Resource bindings, which the runtime unbinds from inputs when the resource is bound as an output
+			inputs = ia_vertex_buffers | ia_index_buffer | vs_constant_buffers | vs_shader_resources | gs_shader_resources | ps_constant_buffers | ps_shader_resources | cs_constant_buffers | cs_shader_resources,
+			outputs = om_render_targets | cs_unordered_access_views,
+		};
+
+		/// <param name="device">Native device to capture state for.</param>
+		/// <param name="track_modified_states">Set to <see langword="true"/> to only capture and restore the states that are modified between <see cref="capture"/> and <see cref="apply_and_release"/>, instead of the entire device context state.</param>
+		explicit state_block(com_ptr<ID3D11Device> device, bool track_modified_states = false);
 		~state_block();
 
-		void capture(ID3D11DeviceContext *device_context);
+		void capture(device_context_impl *device_context);
 		void apply_and_release();
 
+		/// <summary>
+		/// Called by the device context before it modifies any of the specified states, so that states that were not captured yet can be captured before they are overwritten.
+		/// </summary>
+		void on_modify(uint32_t mask);
+
 	private:
+		void capture(uint32_t mask);
+		void apply(uint32_t mask);
+
 		D3D_FEATURE_LEVEL _device_feature_level;
 		com_ptr<ID3D11DeviceContext> _device_context;
+
+		// State used when only tracking modified states instead of capturing the entire device context state
+		bool _track_modified_states;
+		device_context_impl *_tracking_device_context = nullptr;
+		// State block that was tracking on the same device context before this one started, which is notified again once this one is applied
+		state_block *_parent_tracking_state_block = nullptr;
+		// States captured so far, which are the only ones restored by 'apply_and_release'
+		uint32_t _captured_mask = 0;
 #if RESHADE_D3D11_STATE_BLOCK_TYPE
 		com_ptr<ID3DDeviceContextState> _state;
 		com_ptr<ID3DDeviceContextState> _captured_state;
@@ -78,4 +140,54 @@ namespace reshade::d3d11
 		com_ptr<ID3D11UnorderedAccessView> _cs_unordered_access_views[D3D11_1_UAV_SLOT_COUNT];
 		com_ptr<ID3D11ComputeShader> _cs;
 	};
+
+	/// <summary>
+	/// Copy of the state the application bound through the device context proxy, so that it can be captured without having to query the device context.
+	/// This only covers the <see cref="state_block::shadowed"/> states, since those stay bound until the application changes them. The pointers are not owning, but the device context keeps the objects alive for as long as they are bound.
+	/// Resource bindings are not shadowed, because the runtime silently unbinds resources from inputs when they are bound as an output, after which the application may release them.
+	/// </summary>
+	struct state_shadow
+	{
+		/// <summary>
+		/// Resets the shadow to the state of a device context after 'ID3D11DeviceContext::ClearState'.
+		/// </summary>
+		void reset();
+
+		// Bit mask of 'state_block::state_mask' values whose shadow is known to match what is bound on the device context
+		uint32_t valid_mask = 0;
+
+		ID3D11InputLayout *ia_input_layout;
+		D3D11_PRIMITIVE_TOPOLOGY ia_primitive_topology;
+		ID3D11VertexShader *vs;
+		UINT vs_num_class_instances;
+		ID3D11ClassInstance *vs_class_instances[256];
+		ID3D11SamplerState *vs_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+		ID3D11HullShader *hs;
+		UINT hs_num_class_instances;
+		ID3D11ClassInstance *hs_class_instances[256];
+		ID3D11DomainShader *ds;
+		UINT ds_num_class_instances;
+		ID3D11ClassInstance *ds_class_instances[256];
+		ID3D11GeometryShader *gs;
+		UINT gs_num_class_instances;
+		ID3D11ClassInstance *gs_class_instances[256];
+		ID3D11RasterizerState *rs_state;
+		UINT rs_num_viewports;
+		D3D11_VIEWPORT rs_viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+		UINT rs_num_scissor_rects;
+		D3D11_RECT rs_scissor_rects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+		ID3D11PixelShader *ps;
+		UINT ps_num_class_instances;
+		ID3D11ClassInstance *ps_class_instances[256];
+		ID3D11SamplerState *ps_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+		ID3D11BlendState *om_blend_state;
+		FLOAT om_blend_factor[4];
+		UINT om_sample_mask;
+		ID3D11DepthStencilState *om_depth_stencil_state;
+		UINT om_stencil_ref;
+		ID3D11ComputeShader *cs;
+		UINT cs_num_class_instances;
+		ID3D11ClassInstance *cs_class_instances[256];
+		ID3D11SamplerState *cs_sampler_states[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	};
 }
@@ -48,6 +48,14 @@ void reshade::d3d12::command_list_impl::on_init()
 	}
 }
 
+bool reshade::d3d12::command_list_impl::allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu)
+{
+	// It is not known when commands recorded into application command lists finish executing, so share the ring buffer between them
+	return type != D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ?
+		_device_impl->_gpu_view_heap.allocate_transient(count, base_handle, base_handle_gpu) :
+		_device_impl->_gpu_sampler_heap.allocate_transient(count, base_handle, base_handle_gpu);
+}
+
 reshade::api::device *reshade::d3d12::command_list_impl::get_device()
 {
 	return _device_impl;
@@ -416,9 +424,7 @@ void reshade::d3d12::command_list_impl::push_descriptors(api::shader_stage stage
 
 	D3D12_CPU_DESCRIPTOR_HANDLE base_handle;
 	D3D12_GPU_DESCRIPTOR_HANDLE base_handle_gpu;
-	if (update.type != api::descriptor_type::sampler ?
-		!_device_impl->_gpu_view_heap.allocate_transient(update.binding + update.count, base_handle, base_handle_gpu) :
-		!_device_impl->_gpu_sampler_heap.allocate_transient(update.binding + update.count, base_handle, base_handle_gpu))
+	if (!allocate_transient_descriptors(heap_type, update.binding + update.count, base_handle, base_handle_gpu))
 	{
 		log::message(log::level::error, "Failed to allocate %u transient descriptor handle(s) of type %u!", update.count, static_cast<uint32_t>(update.type));
 		return;
@@ -952,7 +958,7 @@ void reshade::d3d12::command_list_impl::clear_unordered_access_view_uint(api::re
 
 	D3D12_CPU_DESCRIPTOR_HANDLE table_base;
 	D3D12_GPU_DESCRIPTOR_HANDLE table_base_gpu;
-	if (!_device_impl->_gpu_view_heap.allocate_transient(1, table_base, table_base_gpu))
+	if (!allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, table_base, table_base_gpu))
 	{
 		log::message(log::level::error, "Failed to allocate %u transient descriptor handle(s) of type %u!", 1u, static_cast<uint32_t>(api::descriptor_type::unordered_access_view));
 		return;
@@ -980,7 +986,7 @@ void reshade::d3d12::command_list_impl::clear_unordered_access_view_float(api::r
 
 	D3D12_CPU_DESCRIPTOR_HANDLE table_base;
 	D3D12_GPU_DESCRIPTOR_HANDLE table_base_gpu;
-	if (!_device_impl->_gpu_view_heap.allocate_transient(1, table_base, table_base_gpu))
+	if (!allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, table_base, table_base_gpu))
 	{
 		log::message(log::level::error, "Failed to allocate %u transient descriptor handle(s) of type %u!", 1u, static_cast<uint32_t>(api::descriptor_type::unordered_access_view));
 		return;
@@ -1022,7 +1028,7 @@ void reshade::d3d12::command_list_impl::generate_mipmaps(api::resource_view srv)
 
 	D3D12_CPU_DESCRIPTOR_HANDLE base_handle;
 	D3D12_GPU_DESCRIPTOR_HANDLE base_handle_gpu;
-	if (!_device_impl->_gpu_view_heap.allocate_transient(level_count_multiple_of_6, base_handle, base_handle_gpu))
+	if (!allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, level_count_multiple_of_6, base_handle, base_handle_gpu))
 	{
 		log::message(log::level::error, "Failed to allocate %u transient descriptor handle(s) of type %u!", level_count_multiple_of_6, static_cast<uint32_t>(api::descriptor_type::unordered_access_view));
 		return;
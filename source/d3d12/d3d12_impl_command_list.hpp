@@ -74,6 +74,11 @@ namespace reshade::d3d12
 	protected:
 		void on_init();
 
+		/// <summary>
+		/// Allocates transient descriptors that only need to stay valid until the commands recorded in this command list finished executing.
+		/// </summary>
+		virtual bool allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu);
+
 		device_impl *const _device_impl;
 		bool _has_commands = false;
 		bool _supports_ray_tracing = false;
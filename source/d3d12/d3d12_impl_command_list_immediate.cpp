@@ -12,7 +12,9 @@ thread_local reshade::d3d12::command_list_immediate_impl *reshade::d3d12::comman
 
 reshade::d3d12::command_list_immediate_impl::command_list_immediate_impl(device_impl *device, ID3D12CommandQueue *queue) :
 	command_list_impl(device, nullptr),
-	_parent_queue(queue)
+	_parent_queue(queue),
+	_transient_view_allocator(device->_gpu_view_heap),
+	_transient_sampler_allocator(device->_gpu_sampler_heap)
 {
 	// Create multiple command allocators to buffer for multiple frames
 	for (uint32_t i = 0; i < NUM_COMMAND_FRAMES; ++i)
@@ -105,6 +107,14 @@ void reshade::d3d12::command_list_immediate_impl::query_acceleration_structures(
 	}
 }
 
+bool reshade::d3d12::command_list_immediate_impl::allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu)
+{
+	// Only ever used by a single thread at a time, so can bump allocate without synchronization
+	return type != D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ?
+		_transient_view_allocator.allocate(count, base_handle, base_handle_gpu) :
+		_transient_sampler_allocator.allocate(count, base_handle, base_handle_gpu);
+}
+
 bool reshade::d3d12::command_list_immediate_impl::flush()
 {
 	s_last_immediate_command_list = this;
@@ -126,6 +136,12 @@ bool reshade::d3d12::command_list_immediate_impl::flush()
 
 		_current_query_fences.clear();
 
+		// Commands referencing these upload buffers and descriptors will never execute, so they can be released and reused right away
+		_upload_buffers[_cmd_index].clear();
+		_upload_buffer_size[_cmd_index] = 0;
+		_transient_view_allocator.retire(nullptr, 0);
+		_transient_sampler_allocator.retire(nullptr, 0);
+
 		// A command list that failed to close can never be reset, so destroy it and create a new one
 		_orig->Release(); _orig = nullptr;
 		if (SUCCEEDED(_device_impl->_orig->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _cmd_alloc[_cmd_index].get(), nullptr, IID_PPV_ARGS(&_orig))))
@@ -143,6 +159,10 @@ bool reshade::d3d12::command_list_immediate_impl::flush()
 		SUCCEEDED(_parent_queue->Signal(_fence[_cmd_index].get(), sync_value)))
 		_fence_value[_cmd_index] = sync_value;
 
+	// Transient descriptors used by this command list can be reused after the fence signaled above was reached
+	_transient_view_allocator.retire(_fence[_cmd_index].get(), _fence_value[_cmd_index]);
+	_transient_sampler_allocator.retire(_fence[_cmd_index].get(), _fence_value[_cmd_index]);
+
 	// Signal all the fences associated with queries that ran with this command list
 	for (const std::pair<ID3D12Fence *, UINT64> &fence : _current_query_fences)
 		_parent_queue->Signal(fence.first, fence.second);
@@ -158,6 +178,10 @@ bool reshade::d3d12::command_list_immediate_impl::flush()
 			WaitForSingleObject(_fence_event, INFINITE); // Event is automatically reset after this wait is released
 	}
 
+	// Upload buffers used by the previous commands of this command allocator are no longer referenced now
+	_upload_buffers[_cmd_index].clear();
+	_upload_buffer_size[_cmd_index] = 0;
+
 	// Reset command allocator before using it this frame again
 	_cmd_alloc[_cmd_index]->Reset();
 
@@ -177,5 +201,20 @@ bool reshade::d3d12::command_list_immediate_impl::flush_and_wait()
 
 	if (FAILED(_fence[cmd_index_to_wait_on]->SetEventOnCompletion(_fence_value[cmd_index_to_wait_on], _fence_event)))
 		return false;
-	return WaitForSingleObject(_fence_event, INFINITE) == WAIT_OBJECT_0;
+	if (WaitForSingleObject(_fence_event, INFINITE) != WAIT_OBJECT_0)
+		return false;
+
+	_upload_buffers[cmd_index_to_wait_on].clear();
+	_upload_buffer_size[cmd_index_to_wait_on] = 0;
+	return true;
+}
+
+void reshade::d3d12::command_list_immediate_impl::destroy_after_execution(com_ptr<ID3D12Resource> &&buffer, UINT64 size)
+{
+	_upload_buffers[_cmd_index].push_back(std::move(buffer));
+	_upload_buffer_size[_cmd_index] += size;
+
+	// Submit early when a lot of upload memory accumulated (e.g. while loading many textures during an effect reload), so that it can be released without waiting for the next present
+	if (_upload_buffer_size[_cmd_index] > 64 * 1024 * 1024)
+		flush();
 }
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "d3d12_impl_device.hpp"
 #include "d3d12_impl_command_list.hpp"
 
 namespace reshade::d3d12
@@ -25,7 +26,14 @@ namespace reshade::d3d12
 		bool flush();
 		bool flush_and_wait();
 
+		/// <summary>
+		/// Keeps the specified upload buffer alive until the commands currently being recorded finished executing and releases it afterwards, so that uploads do not need to wait for the GPU.
+		/// </summary>
+		void destroy_after_execution(com_ptr<ID3D12Resource> &&buffer, UINT64 size);
+
 	private:
+		bool allocate_transient_descriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu) final;
+
 		ID3D12CommandQueue *const _parent_queue;
 		UINT32 _cmd_index = 0;
 		HANDLE _fence_event = nullptr;
@@ -33,7 +41,15 @@ namespace reshade::d3d12
 		com_ptr<ID3D12Fence> _fence[NUM_COMMAND_FRAMES];
 		com_ptr<ID3D12CommandAllocator> _cmd_alloc[NUM_COMMAND_FRAMES];
 
+		// Upload buffers referenced by the commands of each command allocator, which are released once it finished executing
+		std::vector<com_ptr<ID3D12Resource>> _upload_buffers[NUM_COMMAND_FRAMES];
+		UINT64 _upload_buffer_size[NUM_COMMAND_FRAMES] = {};
+
 		// List of query fences scheduled for signaling during next flush
 		std::vector<std::pair<ID3D12Fence *, UINT64>> _current_query_fences;
+
+		// Transient descriptors are allocated from chunks that are owned by this command list until the fence signaled during flush is reached
+		descriptor_heap_gpu_transient_allocator<decltype(device_impl::_gpu_view_heap)> _transient_view_allocator;
+		descriptor_heap_gpu_transient_allocator<decltype(device_impl::_gpu_sampler_heap)> _transient_sampler_allocator;
 	};
 }
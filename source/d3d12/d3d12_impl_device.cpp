@@ -10,13 +10,56 @@
 #include "d3d12_resource_call_vtable.inl"
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
-#include <cwchar> // std::wcslen
+#include "ini_file.hpp"
+#include <cstdio> // std::fclose, std::fread, std::fwrite, std::snprintf
+#include <cwchar> // std::swprintf, std::wcslen
 #include <cstring> // std::memcmp, std::memcpy, std::strlen
-#include <algorithm> // std::copy_n, std::find, std::find_if, std::max, std::min
+#include <algorithm> // std::copy_n, std::count_if, std::find, std::find_if, std::lower_bound, std::max, std::min
 #include <utf8/unchecked.h>
 #include <dxgi1_4.h>
 
 extern bool is_windows7();
+extern std::filesystem::path g_reshade_base_path;
+extern bool resolve_path(std::filesystem::path &path, std::error_code &ec);
+
+#if RESHADE_ADDON >= 2
+extern thread_local bool g_in_d3d12_pipeline_creation;
+#endif
+
+namespace
+{
+	// FNV-1a hash, same as used for effect cache keys
+	struct pipeline_hash
+	{
+		void add(const void *data, size_t size)
+		{
+			for (size_t i = 0; i < size; ++i)
+				value = (value ^ static_cast<const uint8_t *>(data)[i]) * 1099511628211ull;
+		}
+		template <typename T>
+		void add(const T &data)
+		{
+			add(&data, sizeof(data));
+		}
+		void add(const D3D12_SHADER_BYTECODE &shader)
+		{
+			add(shader.BytecodeLength);
+			add(shader.pShaderBytecode, shader.BytecodeLength);
+		}
+		bool add(ID3D12RootSignature *signature)
+		{
+			reshade::d3d12::pipeline_layout_extra_data extra_data = {};
+			UINT extra_data_size = sizeof(extra_data);
+			// Only root signatures created through 'device_impl::create_pipeline_layout' have a hash attached
+			if (signature == nullptr || FAILED(signature->GetPrivateData(reshade::d3d12::extra_data_guid, &extra_data_size, &extra_data)) || extra_data.hash == 0)
+				return false;
+			add(extra_data.hash);
+			return true;
+		}
+
+		uint64_t value = 14695981039346656037ull;
+	};
+}
 
 #ifndef _WIN64
 // Make a bit more space for the heap index in descriptor handles, at the cost of less space for the descriptor index, due to overall limit of only 32-bit being available
@@ -105,11 +148,16 @@ reshade::d3d12::device_impl::device_impl(ID3D12Device *device) :
 			}
 		}
 	}
+
+	load_pipeline_library();
 }
 reshade::d3d12::device_impl::~device_impl()
 {
 	assert(_queues.empty()); // All queues should have been unregistered and destroyed by the application at this point
 
+	save_pipeline_library();
+	_pipeline_library.reset();
+
 #if RESHADE_ADDON >= 2
 	const auto gpu_view_heap = _descriptor_heaps[0];
 	unregister_descriptor_heap(gpu_view_heap);
@@ -122,6 +170,196 @@ reshade::d3d12::device_impl::~device_impl()
 #endif
 }
 
+void reshade::d3d12::device_impl::load_pipeline_library()
+{
+	com_ptr<ID3D12Device1> device1;
+	if (FAILED(_orig->QueryInterface(&device1)))
+		return;
+
+	// Share the directory with the effect cache (see 'runtime::load_config')
+	bool no_effect_cache = false;
+	global_config().get("GENERAL", "NoEffectCache", no_effect_cache);
+
+	if (!no_effect_cache)
+	{
+		std::error_code ec;
+		std::filesystem::path cache_path;
+		global_config().get("GENERAL", "IntermediateCachePath", cache_path);
+		if (cache_path.empty() || !resolve_path(cache_path, ec))
+			cache_path = std::filesystem::temp_directory_path(ec) / L"ReShade";
+
+		DXGI_ADAPTER_DESC adapter_desc = {};
+		adapter_from_device(_orig, &adapter_desc);
+
+		char file_name[64];
+		std::snprintf(file_name, std::size(file_name), "reshade-d3d12-pipelines-%04x-%04x.bin", adapter_desc.VendorId, adapter_desc.DeviceId);
+		_pipeline_library_path = g_reshade_base_path / cache_path / file_name;
+
+		if (FILE *const file = _wfsopen(_pipeline_library_path.c_str(), L"rb", SH_DENYWR))
+		{
+			const uintmax_t file_size = std::filesystem::file_size(_pipeline_library_path, ec);
+			if (!ec)
+			{
+				_pipeline_library_data.resize(static_cast<size_t>(file_size));
+				_pipeline_library_data.resize(std::fread(_pipeline_library_data.data(), 1, _pipeline_library_data.size(), file));
+			}
+			std::fclose(file);
+		}
+	}
+
+	HRESULT hr = E_FAIL;
+	if (!_pipeline_library_data.empty())
+	{
+		hr = device1->CreatePipelineLibrary(_pipeline_library_data.data(), _pipeline_library_data.size(), IID_PPV_ARGS(&_pipeline_library));
+		if (SUCCEEDED(hr))
+		{
+			log::message(log::level::info, "Loaded pipeline library \"%s\" (%zu bytes).", _pipeline_library_path.u8string().c_str(), _pipeline_library_data.size());
+		}
+		else
+		{
+			// The runtime rejects libraries that were serialized with a different driver or adapter, so start over with an empty one in that case
+			log::message(log::level::info, "Discarding outdated pipeline library \"%s\" (%s).", _pipeline_library_path.u8string().c_str(), log::hr_to_string(hr).c_str());
+			_pipeline_library_data.clear();
+		}
+	}
+
+	if (FAILED(hr) && FAILED(hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&_pipeline_library))))
+	{
+		// Pipeline libraries are optional and not supported by all drivers (in which case this fails with 'DXGI_ERROR_UNSUPPORTED')
+		log::message(log::level::warning, "Failed to create pipeline library with %s!", log::hr_to_string(hr).c_str());
+		_pipeline_library.reset();
+	}
+}
+void reshade::d3d12::device_impl::save_pipeline_library()
+{
+	if (_pipeline_library == nullptr || !_pipeline_library_modified || _pipeline_library_path.empty())
+		return;
+
+	const SIZE_T library_size = _pipeline_library->GetSerializedSize();
+	std::vector<uint8_t> library_data(library_size);
+	if (library_size == 0 || FAILED(_pipeline_library->Serialize(library_data.data(), library_size)))
+		return;
+
+	// Write to a temporary file first and then replace the target with it, so that a crash during shutdown cannot leave a partially written library behind
+	std::filesystem::path temp_path = _pipeline_library_path;
+	temp_path += L".tmp";
+
+	FILE *const file = _wfsopen(temp_path.c_str(), L"wb", SH_DENYWR);
+	if (file == nullptr)
+		return;
+	const size_t library_size_written = std::fwrite(library_data.data(), 1, library_size, file);
+	std::fclose(file);
+
+	if (library_size_written != library_size ||
+		!MoveFileExW(temp_path.c_str(), _pipeline_library_path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		log::message(log::level::warning, "Failed to save pipeline library \"%s\"!", _pipeline_library_path.u8string().c_str());
+		DeleteFileW(temp_path.c_str());
+	}
+}
+
+std::wstring reshade::d3d12::device_impl::get_pipeline_library_name(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+	pipeline_hash hash;
+	// Stream output declarations contain pointers to semantic names, which are not worth supporting here
+	if (!hash.add(desc.pRootSignature) || desc.StreamOutput.NumEntries != 0)
+		return std::wstring();
+
+	hash.add(desc.VS);
+	hash.add(desc.PS);
+	hash.add(desc.DS);
+	hash.add(desc.HS);
+	hash.add(desc.GS);
+	hash.add(desc.BlendState);
+	hash.add(desc.SampleMask);
+	hash.add(desc.RasterizerState);
+	hash.add(desc.DepthStencilState);
+	for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC &element = desc.InputLayout.pInputElementDescs[i];
+		hash.add(element.SemanticName, std::strlen(element.SemanticName));
+		hash.add(element.SemanticIndex);
+		hash.add(element.Format);
+		hash.add(element.InputSlot);
+		hash.add(element.AlignedByteOffset);
+		hash.add(element.InputSlotClass);
+		hash.add(element.InstanceDataStepRate);
+	}
+	hash.add(desc.IBStripCutValue);
+	hash.add(desc.PrimitiveTopologyType);
+	hash.add(desc.NumRenderTargets);
+	hash.add(desc.RTVFormats);
+	hash.add(desc.DSVFormat);
+	hash.add(desc.SampleDesc);
+	hash.add(desc.NodeMask);
+	hash.add(desc.Flags);
+
+	wchar_t name[20];
+	return std::wstring(name, std::swprintf(name, std::size(name), L"G%016llX", hash.value));
+}
+std::wstring reshade::d3d12::device_impl::get_pipeline_library_name(const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc)
+{
+	pipeline_hash hash;
+	if (!hash.add(desc.pRootSignature))
+		return std::wstring();
+
+	hash.add(desc.CS);
+	hash.add(desc.NodeMask);
+	hash.add(desc.Flags);
+
+	wchar_t name[20];
+	return std::wstring(name, std::swprintf(name, std::size(name), L"C%016llX", hash.value));
+}
+bool reshade::d3d12::device_impl::load_pipeline_from_library(const std::wstring &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, com_ptr<ID3D12PipelineState> &pipeline)
+{
+	if (_pipeline_library == nullptr || name.empty())
+		return false;
+
+	const std::unique_lock<std::mutex> lock(_pipeline_library_mutex);
+
+#if RESHADE_ADDON >= 2
+	// Skip the hooks installed on application pipeline libraries (which share the virtual function table), so that no add-on events are invoked for internal pipelines
+	const bool was_in_d3d12_pipeline_creation = g_in_d3d12_pipeline_creation;
+	g_in_d3d12_pipeline_creation = true;
+#endif
+	// Fails with 'E_INVALIDARG' if the pipeline is not in the library yet
+	const HRESULT hr = _pipeline_library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipeline));
+#if RESHADE_ADDON >= 2
+	g_in_d3d12_pipeline_creation = was_in_d3d12_pipeline_creation;
+#endif
+
+	return SUCCEEDED(hr);
+}
+bool reshade::d3d12::device_impl::load_pipeline_from_library(const std::wstring &name, const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc, com_ptr<ID3D12PipelineState> &pipeline)
+{
+	if (_pipeline_library == nullptr || name.empty())
+		return false;
+
+	const std::unique_lock<std::mutex> lock(_pipeline_library_mutex);
+
+#if RESHADE_ADDON >= 2
+	const bool was_in_d3d12_pipeline_creation = g_in_d3d12_pipeline_creation;
+	g_in_d3d12_pipeline_creation = true;
+#endif
+	const HRESULT hr = _pipeline_library->LoadComputePipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipeline));
+#if RESHADE_ADDON >= 2
+	g_in_d3d12_pipeline_creation = was_in_d3d12_pipeline_creation;
+#endif
+
+	return SUCCEEDED(hr);
+}
+void reshade::d3d12::device_impl::store_pipeline_in_library(const std::wstring &name, ID3D12PipelineState *pipeline)
+{
+	if (_pipeline_library == nullptr || name.empty())
+		return;
+
+	const std::unique_lock<std::mutex> lock(_pipeline_library_mutex);
+
+	// Fails with 'E_INVALIDARG' if a pipeline with the same name was stored already, in which case this pipeline is simply not cached
+	if (SUCCEEDED(_pipeline_library->StorePipeline(name.c_str(), pipeline)))
+		_pipeline_library_modified = true;
+}
+
 bool reshade::d3d12::device_impl::get_property(api::device_properties property, void *data) const
 {
 	switch (property)
@@ -370,13 +608,62 @@ bool reshade::d3d12::device_impl::create_resource(const api::resource_desc &desc
 	else
 		use_default_clear_value = false;
 
-	if (SUCCEEDED(desc.heap == api::memory_heap::unknown ?
+	// Textures in GPU memory are sub-allocated from larger heaps, so that a reload does not have to make a separate heap allocation (with 64 KiB alignment) for every single effect texture
+	// Render targets and depth-stencil textures placed in memory that was used before have to be discarded before their first use, which needs the immediate command list
+	const bool is_render_target_or_depth_stencil = (internal_desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+	command_list_immediate_impl *const immediate_command_list = get_immediate_command_list();
+
+	ID3D12Heap *placed_heap = nullptr;
+	UINT64 placed_offset = 0;
+	UINT64 placed_size = 0;
+	if (desc.heap == api::memory_heap::gpu_only && heap_props.Type == D3D12_HEAP_TYPE_DEFAULT && heap_flags == D3D12_HEAP_FLAG_NONE && !is_shared &&
+		internal_desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && internal_desc.SampleDesc.Count == 1 &&
+		(!is_render_target_or_depth_stencil || immediate_command_list != nullptr))
+	{
+		D3D12_RESOURCE_ALLOCATION_INFO allocation_info = {};
+		if (!is_render_target_or_depth_stencil)
+		{
+			// Small textures can use a smaller alignment, in which case the allocation info reports exactly that alignment
+			internal_desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+			allocation_info = _orig->GetResourceAllocationInfo(0, 1, &internal_desc);
+		}
+		if (allocation_info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT || allocation_info.SizeInBytes == UINT64_MAX)
+		{
+			internal_desc.Alignment = 0;
+			allocation_info = _orig->GetResourceAllocationInfo(0, 1, &internal_desc);
+		}
+
+		if (allocation_info.SizeInBytes != UINT64_MAX && allocation_info.SizeInBytes <= PLACED_RESOURCE_MAX_SIZE &&
+			allocate_placed_memory(is_render_target_or_depth_stencil, allocation_info.SizeInBytes, allocation_info.Alignment, placed_heap, placed_offset))
+		{
+			placed_size = allocation_info.SizeInBytes;
+
+			if (FAILED(_orig->CreatePlacedResource(placed_heap, placed_offset, &internal_desc, convert_usage_to_resource_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, IID_PPV_ARGS(&object))))
+			{
+				free_placed_memory(placed_heap, placed_offset, placed_size);
+				placed_heap = nullptr;
+			}
+		}
+
+		// Fall back to a committed resource, which does not support the small alignment
+		if (placed_heap == nullptr)
+			internal_desc.Alignment = 0;
+	}
+
+	if (placed_heap != nullptr || SUCCEEDED(desc.heap == api::memory_heap::unknown ?
 			_orig->CreateReservedResource(&internal_desc, convert_usage_to_resource_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, IID_PPV_ARGS(&object)) :
 			_orig->CreateCommittedResource(&heap_props, heap_flags, &internal_desc, convert_usage_to_resource_states(initial_state), use_default_clear_value ? &default_clear_value : nullptr, IID_PPV_ARGS(&object))))
 	{
 		if (is_shared && FAILED(_orig->CreateSharedHandle(object.get(), nullptr, GENERIC_ALL, nullptr, shared_handle)))
 			return false;
 
+		if (placed_heap != nullptr)
+		{
+			const std::unique_lock<std::mutex> lock(_placed_heap_mutex);
+
+			_placed_resources.emplace(object.get(), std::make_tuple(placed_heap, placed_offset, placed_size));
+		}
+
 		if (footprint.Format != DXGI_FORMAT_UNKNOWN)
 			object->SetPrivateData(extra_data_guid, sizeof(footprint), &footprint);
 
@@ -384,6 +671,16 @@ bool reshade::d3d12::device_impl::create_resource(const api::resource_desc &desc
 
 		*out_resource = to_handle(object.release());
 
+		if (placed_heap != nullptr && is_render_target_or_depth_stencil)
+		{
+			const api::resource_usage discard_state = (desc.usage & api::resource_usage::depth_stencil) != 0 ? api::resource_usage::depth_stencil_write : api::resource_usage::render_target;
+			const api::resource_usage states_discard[2] = { initial_state, discard_state };
+			immediate_command_list->barrier(1, out_resource, &states_discard[0], &states_discard[1]);
+			immediate_command_list->_orig->DiscardResource(reinterpret_cast<ID3D12Resource *>(out_resource->handle), nullptr);
+			immediate_command_list->barrier(1, out_resource, &states_discard[1], &states_discard[0]);
+			immediate_command_list->flush();
+		}
+
 		if (initial_data != nullptr)
 		{
 			assert(initial_state != api::resource_usage::undefined);
@@ -423,7 +720,22 @@ void reshade::d3d12::device_impl::destroy_resource(api::resource resource)
 
 	unregister_resource(reinterpret_cast<ID3D12Resource *>(resource.handle));
 
+	std::tuple<ID3D12Heap *, UINT64, UINT64> placed_memory = {};
+	{
+		const std::unique_lock<std::mutex> lock(_placed_heap_mutex);
+
+		if (const auto it = _placed_resources.find(reinterpret_cast<ID3D12Resource *>(resource.handle));
+			it != _placed_resources.end())
+		{
+			placed_memory = it->second;
+			_placed_resources.erase(it);
+		}
+	}
+
 	reinterpret_cast<IUnknown *>(resource.handle)->Release();
+
+	if (std::get<ID3D12Heap *>(placed_memory) != nullptr)
+		free_placed_memory(std::get<ID3D12Heap *>(placed_memory), std::get<1>(placed_memory), std::get<2>(placed_memory));
 }
 
 reshade::api::resource_desc reshade::d3d12::device_impl::get_resource_desc(api::resource resource) const
@@ -731,8 +1043,8 @@ void reshade::d3d12::device_impl::update_buffer_region(const void *data, api::re
 	// Copy data from upload buffer into target texture using the first available immediate command list
 	immediate_command_list->copy_buffer_region(api::resource { reinterpret_cast<uintptr_t>(intermediate.get()) }, 0, resource, offset, size);
 
-	// Wait for command to finish executing before destroying the upload buffer
-	immediate_command_list->flush_and_wait();
+	// Submit the copy with the next flush and release the upload buffer only after it finished executing, instead of waiting for it here
+	immediate_command_list->destroy_after_execution(std::move(intermediate), intermediate_desc.Width);
 }
 void reshade::d3d12::device_impl::update_texture_region(const api::subresource_data &data, api::resource resource, uint32_t subresource, const api::subresource_box *box)
 {
@@ -819,8 +1131,8 @@ void reshade::d3d12::device_impl::update_texture_region(const api::subresource_d
 	// Copy data from upload buffer into target texture using the first available immediate command list
 	immediate_command_list->copy_buffer_to_texture(api::resource { reinterpret_cast<uintptr_t>(intermediate.get()) }, 0, 0, 0, resource, subresource, box);
 
-	// Wait for command to finish executing before destroying the upload buffer
-	immediate_command_list->flush_and_wait();
+	// Submit the copy with the next flush and release the upload buffer only after it finished executing, instead of waiting for it here
+	immediate_command_list->destroy_after_execution(std::move(intermediate), intermediate_desc.Width);
 }
 
 bool reshade::d3d12::device_impl::create_pipeline(api::pipeline_layout layout, uint32_t subobject_count, const api::pipeline_subobject *subobjects, api::pipeline *out_pipeline)
@@ -1198,8 +1510,13 @@ bool reshade::d3d12::device_impl::create_pipeline(api::pipeline_layout layout, u
 		internal_desc.pRootSignature = reinterpret_cast<ID3D12RootSignature *>(layout.handle);
 		convert_shader_desc(cs_desc, internal_desc.CS);
 
-		if (com_ptr<ID3D12PipelineState> pipeline;
+		com_ptr<ID3D12PipelineState> pipeline;
+		const std::wstring library_name = get_pipeline_library_name(internal_desc);
+		if (!load_pipeline_from_library(library_name, internal_desc, pipeline) &&
 			SUCCEEDED(_orig->CreateComputePipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))))
+			store_pipeline_in_library(library_name, pipeline.get());
+
+		if (pipeline != nullptr)
 		{
 			*out_pipeline = to_handle(pipeline.release());
 			return true;
@@ -1298,8 +1615,13 @@ bool reshade::d3d12::device_impl::create_pipeline(api::pipeline_layout layout, u
 
 		internal_desc.SampleDesc.Count = sample_count;
 
-		if (com_ptr<ID3D12PipelineState> pipeline;
+		com_ptr<ID3D12PipelineState> pipeline;
+		const std::wstring library_name = get_pipeline_library_name(internal_desc);
+		if (!load_pipeline_from_library(library_name, internal_desc, pipeline) &&
 			SUCCEEDED(_orig->CreateGraphicsPipelineState(&internal_desc, IID_PPV_ARGS(&pipeline))))
+			store_pipeline_in_library(library_name, pipeline.get());
+
+		if (pipeline != nullptr)
 		{
 			pipeline_extra_data extra_data;
 			extra_data.topology = convert_primitive_topology(topology);
@@ -1512,6 +1834,7 @@ bool reshade::d3d12::device_impl::create_pipeline_layout(uint32_t param_count, c
 	{
 		pipeline_layout_extra_data extra_data;
 		extra_data.ranges = nullptr;
+		extra_data.hash = 0;
 		UINT extra_data_size = sizeof(extra_data);
 
 		// D3D12 runtime returns the same root signature object for identical input blobs, just with the reference count increased
@@ -1521,6 +1844,10 @@ bool reshade::d3d12::device_impl::create_pipeline_layout(uint32_t param_count, c
 			extra_data.ranges = new std::pair<D3D12_DESCRIPTOR_HEAP_TYPE, UINT>[param_count];
 			std::copy_n(set_ranges.begin(), param_count, const_cast<std::pair<D3D12_DESCRIPTOR_HEAP_TYPE, UINT> *>(extra_data.ranges));
 
+			pipeline_hash hash;
+			hash.add(signature_blob->GetBufferPointer(), signature_blob->GetBufferSize());
+			extra_data.hash = hash.value;
+
 			signature->SetPrivateData(extra_data_guid, sizeof(extra_data), &extra_data);
 		}
 		else
@@ -2130,6 +2457,97 @@ void reshade::d3d12::device_impl::unregister_resource(ID3D12Resource *resource)
 #endif
 }
 
+bool reshade::d3d12::device_impl::allocate_placed_memory(bool render_target_or_depth_stencil, UINT64 size, UINT64 alignment, ID3D12Heap *&heap, UINT64 &offset)
+{
+	assert(size <= PLACED_HEAP_SIZE && alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	const std::unique_lock<std::mutex> lock(_placed_heap_mutex);
+
+	std::vector<placed_heap> &heaps = _placed_heaps[render_target_or_depth_stencil ? 1 : 0];
+
+	// First fit in the existing heaps
+	for (placed_heap &candidate : heaps)
+	{
+		for (auto it = candidate.free_ranges.begin(); it != candidate.free_ranges.end(); ++it)
+		{
+			const UINT64 aligned_offset = (it->first + alignment - 1) & ~(alignment - 1);
+			if (aligned_offset + size > it->first + it->second)
+				continue;
+
+			const std::pair<UINT64, UINT64> range = *it;
+			it = candidate.free_ranges.erase(it);
+
+			// Return the space before and after the allocation to the free list
+			if (aligned_offset + size < range.first + range.second)
+				it = candidate.free_ranges.insert(it, { aligned_offset + size, range.first + range.second - (aligned_offset + size) });
+			if (aligned_offset > range.first)
+				candidate.free_ranges.insert(it, { range.first, aligned_offset - range.first });
+
+			heap = candidate.heap.get();
+			offset = aligned_offset;
+			return true;
+		}
+	}
+
+	D3D12_HEAP_DESC heap_desc = {};
+	heap_desc.SizeInBytes = PLACED_HEAP_SIZE;
+	heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heap_desc.Flags = render_target_or_depth_stencil ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+	placed_heap &new_heap = heaps.emplace_back();
+	if (FAILED(_orig->CreateHeap(&heap_desc, IID_PPV_ARGS(&new_heap.heap))))
+	{
+		heaps.pop_back();
+		return false;
+	}
+
+	if (size < PLACED_HEAP_SIZE)
+		new_heap.free_ranges.push_back({ size, PLACED_HEAP_SIZE - size });
+
+	heap = new_heap.heap.get();
+	offset = 0;
+	return true;
+}
+void reshade::d3d12::device_impl::free_placed_memory(ID3D12Heap *heap, UINT64 offset, UINT64 size)
+{
+	const std::unique_lock<std::mutex> lock(_placed_heap_mutex);
+
+	for (std::vector<placed_heap> &heaps : _placed_heaps)
+	{
+		const auto heap_it = std::find_if(heaps.begin(), heaps.end(), [heap](const placed_heap &candidate) { return candidate.heap == heap; });
+		if (heap_it == heaps.end())
+			continue;
+
+		std::vector<std::pair<UINT64, UINT64>> &free_ranges = heap_it->free_ranges;
+
+		// Insert sorted by offset and merge with the neighboring ranges
+		auto it = std::lower_bound(free_ranges.begin(), free_ranges.end(), std::make_pair(offset, UINT64(0)));
+		it = free_ranges.insert(it, { offset, size });
+		if (const auto next = it + 1; next != free_ranges.end() && it->first + it->second == next->first)
+		{
+			it->second += next->second;
+			it = free_ranges.erase(next) - 1;
+		}
+		if (it != free_ranges.begin())
+		{
+			if (const auto prev = it - 1; prev->first + prev->second == it->first)
+			{
+				prev->second += it->second;
+				free_ranges.erase(it);
+			}
+		}
+
+		// Keep one empty heap around for the next reload, but release any additional ones
+		if (free_ranges.size() == 1 && free_ranges.front().first == 0 && free_ranges.front().second == PLACED_HEAP_SIZE &&
+			std::count_if(heaps.begin(), heaps.end(), [](const placed_heap &candidate) { return candidate.free_ranges.size() == 1 && candidate.free_ranges.front().second == PLACED_HEAP_SIZE; }) > 1)
+			heaps.erase(heap_it);
+		return;
+	}
+
+	assert(false);
+}
+
 void reshade::d3d12::device_impl::register_resource_view(D3D12_CPU_DESCRIPTOR_HANDLE handle, ID3D12Resource *resource, api::resource_view_desc desc)
 {
 	// Get default view description when none was provided
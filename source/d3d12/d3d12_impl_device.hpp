@@ -8,6 +8,8 @@
 #include "descriptor_heap.hpp"
 #include "reshade_api_object_impl.hpp"
 #include <map>
+#include <mutex>
+#include <filesystem>
 #include <unordered_map>
 #include <concurrent_vector.h>
 
@@ -136,19 +138,40 @@ namespace reshade::d3d12
 		void register_resource_view(D3D12_CPU_DESCRIPTOR_HANDLE handle, ID3D12Resource *resource, api::resource_view_desc desc);
 		void register_resource_view(D3D12_CPU_DESCRIPTOR_HANDLE handle, D3D12_CPU_DESCRIPTOR_HANDLE source_handle);
 
+		/// <summary>
+		/// Sub-allocates a range of memory for a placed texture from one of the heaps owned by this device, creating a new heap if none has enough space left.
+		/// </summary>
+		bool allocate_placed_memory(bool render_target_or_depth_stencil, UINT64 size, UINT64 alignment, ID3D12Heap *&heap, UINT64 &offset);
+		void free_placed_memory(ID3D12Heap *heap, UINT64 offset, UINT64 size);
+
 #if RESHADE_ADDON >= 2
 		void register_descriptor_heap(D3D12DescriptorHeap *heap);
 		void unregister_descriptor_heap(D3D12DescriptorHeap *heap);
 #endif
 
 	private:
+		/// <summary>
+		/// Creates the pipeline library that pipelines are loaded from and stored in, populated from the file serialized by a previous run.
+		/// </summary>
+		void load_pipeline_library();
+		void save_pipeline_library();
+
+		/// <summary>
+		/// Builds the name a pipeline is stored under in the pipeline library from the hashes of its root signature, shaders and state, or returns an empty string if it cannot be stored.
+		/// </summary>
+		static std::wstring get_pipeline_library_name(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+		static std::wstring get_pipeline_library_name(const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc);
+		bool load_pipeline_from_library(const std::wstring &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, com_ptr<ID3D12PipelineState> &pipeline);
+		bool load_pipeline_from_library(const std::wstring &name, const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc, com_ptr<ID3D12PipelineState> &pipeline);
+		void store_pipeline_in_library(const std::wstring &name, ID3D12PipelineState *pipeline);
+
 		std::vector<command_queue_impl *> _queues;
 
 		UINT _descriptor_handle_size[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
 		descriptor_heap_cpu _view_heaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
-		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 128, 128> _gpu_sampler_heap;
-		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 50000, 2048> _gpu_view_heap;
+		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 128, 128, 16, 32> _gpu_sampler_heap;
+		descriptor_heap_gpu<D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 50000, 2048, 64, 256> _gpu_view_heap;
 
 		mutable std::shared_mutex _resource_mutex;
 #if RESHADE_ADDON >= 2
@@ -157,7 +180,31 @@ namespace reshade::d3d12
 #endif
 		std::unordered_map<SIZE_T, std::pair<ID3D12Resource *, api::resource_view_desc>> _views;
 
+		// Size of the heaps textures are sub-allocated from, and the largest texture that is sub-allocated instead of getting its own committed resource
+		static constexpr UINT64 PLACED_HEAP_SIZE = 64 * 1024 * 1024;
+		static constexpr UINT64 PLACED_RESOURCE_MAX_SIZE = PLACED_HEAP_SIZE / 4;
+
+		struct placed_heap
+		{
+			com_ptr<ID3D12Heap> heap;
+			// Kept sorted by offset with adjacent ranges merged, so that memory freed by a reload can be reused for large textures again
+			std::vector<std::pair<UINT64, UINT64>> free_ranges;
+		};
+
+		std::mutex _placed_heap_mutex;
+		// Render target and depth-stencil textures are kept in separate heaps from other textures, since resource heap tier 1 does not allow mixing them
+		std::vector<placed_heap> _placed_heaps[2];
+		std::unordered_map<ID3D12Resource *, std::tuple<ID3D12Heap *, UINT64, UINT64>> _placed_resources;
+
 		com_ptr<ID3D12PipelineState> _mipmap_pipeline;
 		com_ptr<ID3D12RootSignature> _mipmap_signature;
+
+		// Serialized library data has to stay alive for as long as the pipeline library created from it
+		std::vector<uint8_t> _pipeline_library_data;
+		com_ptr<ID3D12PipelineLibrary> _pipeline_library;
+		// Loading the same pipeline from multiple threads at once is not allowed, so serialize all access
+		std::mutex _pipeline_library_mutex;
+		std::filesystem::path _pipeline_library_path;
+		bool _pipeline_library_modified = false;
 	};
 }
@@ -26,6 +26,8 @@ namespace reshade::d3d12
 	struct pipeline_layout_extra_data
 	{
 		const std::pair<D3D12_DESCRIPTOR_HEAP_TYPE, UINT> *ranges;
+		// Hash of the serialized root signature, which identifies it across sessions (see 'device_impl::get_pipeline_library_name')
+		uint64_t hash;
 	};
 
 	struct query_heap_extra_data
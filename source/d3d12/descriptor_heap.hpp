@@ -109,17 +109,20 @@ namespace reshade::d3d12
 		std::shared_mutex _mutex;
 	};
 
-	template <D3D12_DESCRIPTOR_HEAP_TYPE type, UINT static_size, UINT transient_size>
+	template <D3D12_DESCRIPTOR_HEAP_TYPE type, UINT static_size, UINT transient_size, UINT transient_chunk_count = 0, UINT transient_chunk_size = 0>
 	class descriptor_heap_gpu
 	{
 	public:
+		static constexpr UINT chunk_size = transient_chunk_size;
+
 		explicit descriptor_heap_gpu(ID3D12Device *device, UINT node_mask = 0)
 		{
 			// Manage all descriptors in a single heap, to avoid costly descriptor heap switches during rendering
 			// The lower portion of the heap is reserved for static bindings, the upper portion for transient bindings (which change frequently and are managed like a ring buffer)
+			// Behind that follow chunks of transient bindings that are handed out to command lists which know when their commands finished executing (see 'descriptor_heap_gpu_transient_allocator')
 			D3D12_DESCRIPTOR_HEAP_DESC desc;
 			desc.Type = type;
-			desc.NumDescriptors = static_size + transient_size;
+			desc.NumDescriptors = static_size + transient_size + transient_chunk_count * transient_chunk_size;
 			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 			desc.NodeMask = node_mask;
 
@@ -131,6 +134,12 @@ namespace reshade::d3d12
 			_static_heap_base_gpu = _heap->GetGPUDescriptorHandleForHeapStart().ptr;
 			_transient_heap_base = _static_heap_base + static_size * _increment_size;
 			_transient_heap_base_gpu = _static_heap_base_gpu + static_size * _increment_size;
+			_chunk_heap_base = _transient_heap_base + transient_size * _increment_size;
+			_chunk_heap_base_gpu = _transient_heap_base_gpu + transient_size * _increment_size;
+
+			_free_chunks.reserve(transient_chunk_count);
+			for (UINT i = 0; i < transient_chunk_count; ++i)
+				_free_chunks.push_back(transient_chunk_count - 1 - i);
 		}
 		~descriptor_heap_gpu()
 		{
@@ -199,6 +208,70 @@ namespace reshade::d3d12
 			return true;
 		}
 
+		/// <summary>
+		/// Acquires a chunk of <see cref="chunk_size"/> contiguous transient descriptors, which is owned by the caller until it is retired again via <see cref="retire_transient_chunks"/>.
+		/// </summary>
+		bool acquire_transient_chunk(UINT &chunk_index)
+		{
+			if (_heap == nullptr)
+				return false;
+
+			const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+			if (_free_chunks.empty())
+			{
+				// Return chunks to the free list whose commands have finished executing on the GPU
+				for (auto it = _retired_chunks.begin(); it != _retired_chunks.end();)
+				{
+					if (it->fence->GetCompletedValue() >= it->fence_value)
+					{
+						_free_chunks.push_back(it->chunk_index);
+						it = _retired_chunks.erase(it);
+					}
+					else
+					{
+						++it;
+					}
+				}
+
+				if (_free_chunks.empty())
+					return false;
+			}
+
+			chunk_index = _free_chunks.back();
+			_free_chunks.pop_back();
+
+			return true;
+		}
+		/// <summary>
+		/// Retires chunks previously acquired via <see cref="acquire_transient_chunk"/>, so that they can be reused once the specified fence reached the specified value.
+		/// </summary>
+		/// <param name="fence">Fence that is signaled after all commands referencing the chunks finished executing, or <see langword="nullptr"/> to make them available again immediately.</param>
+		void retire_transient_chunks(const UINT *chunk_indices, size_t count, ID3D12Fence *fence, UINT64 fence_value)
+		{
+			if (count == 0)
+				return;
+
+			const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (fence != nullptr)
+					_retired_chunks.push_back({ chunk_indices[i], com_ptr<ID3D12Fence>(fence), fence_value });
+				else
+					_free_chunks.push_back(chunk_indices[i]);
+			}
+		}
+
+		void get_transient_chunk_handles(UINT chunk_index, UINT offset, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu) const
+		{
+			assert(chunk_index < transient_chunk_count && offset < transient_chunk_size);
+
+			const SIZE_T chunk_offset = (static_cast<SIZE_T>(chunk_index) * transient_chunk_size + offset) * _increment_size;
+			base_handle.ptr = _chunk_heap_base + chunk_offset;
+			base_handle_gpu.ptr = _chunk_heap_base_gpu + chunk_offset;
+		}
+
 		void free(D3D12_GPU_DESCRIPTOR_HANDLE base_handle_gpu)
 		{
 			// Ensure this handle falls into the static range of this heap
@@ -289,10 +362,75 @@ namespace reshade::d3d12
 		UINT64 _static_heap_base_gpu;
 		SIZE_T _transient_heap_base;
 		UINT64 _transient_heap_base_gpu;
+		SIZE_T _chunk_heap_base;
+		UINT64 _chunk_heap_base_gpu;
 		SIZE_T _current_static_index = 0;
 		UINT64 _current_transient_tail = 0;
 		std::vector<std::pair<UINT64, UINT64>> _free_list;
 		std::vector<std::pair<UINT64, UINT32>> _count_list;
+		struct retired_chunk
+		{
+			UINT chunk_index;
+			com_ptr<ID3D12Fence> fence;
+			UINT64 fence_value;
+		};
+		std::vector<UINT> _free_chunks;
+		std::vector<retired_chunk> _retired_chunks;
 		std::shared_mutex _mutex;
 	};
+
+	/// <summary>
+	/// Linear allocator for transient descriptors of a single command list.
+	/// Descriptors are bumped out of chunks acquired from a <see cref="descriptor_heap_gpu"/>, so that allocating them does not need to synchronize with other command lists.
+	/// The chunks are handed back to the heap when the command list is submitted, together with the fence that signals when they can be reused.
+	/// </summary>
+	template <typename heap_type>
+	class descriptor_heap_gpu_transient_allocator
+	{
+	public:
+		explicit descriptor_heap_gpu_transient_allocator(heap_type &heap) : _heap(heap) {}
+		descriptor_heap_gpu_transient_allocator(const descriptor_heap_gpu_transient_allocator &) = delete;
+		descriptor_heap_gpu_transient_allocator &operator=(const descriptor_heap_gpu_transient_allocator &) = delete;
+		~descriptor_heap_gpu_transient_allocator()
+		{
+			retire(nullptr, 0);
+		}
+
+		bool allocate(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE &base_handle, D3D12_GPU_DESCRIPTOR_HANDLE &base_handle_gpu)
+		{
+			// Fall back to the shared ring buffer for allocations that do not fit into a chunk, or if all chunks are still in use by the GPU
+			if (heap_type::chunk_size == 0 || count > heap_type::chunk_size)
+				return _heap.allocate_transient(count, base_handle, base_handle_gpu);
+
+			if (_used_chunks.empty() || _current_offset + count > heap_type::chunk_size)
+			{
+				UINT chunk_index;
+				if (!_heap.acquire_transient_chunk(chunk_index))
+					return _heap.allocate_transient(count, base_handle, base_handle_gpu);
+
+				_used_chunks.push_back(chunk_index);
+				_current_offset = 0;
+			}
+
+			_heap.get_transient_chunk_handles(_used_chunks.back(), _current_offset, base_handle, base_handle_gpu);
+			_current_offset += count;
+
+			return true;
+		}
+
+		/// <summary>
+		/// Hands all chunks used since the last call back to the heap, to be reused once the specified fence reached the specified value.
+		/// </summary>
+		void retire(ID3D12Fence *fence, UINT64 fence_value)
+		{
+			_heap.retire_transient_chunks(_used_chunks.data(), _used_chunks.size(), fence, fence_value);
+			_used_chunks.clear();
+			_current_offset = heap_type::chunk_size;
+		}
+
+	private:
+		heap_type &_heap;
+		UINT _current_offset = heap_type::chunk_size;
+		std::vector<UINT> _used_chunks;
+	};
 }
@@ -7,8 +7,10 @@
 #include "d3d9_swapchain.hpp"
 #include "d3d9_impl_type_convert.hpp"
 #include "dll_log.hpp" // Include late to get 'hr_to_string' helper function
+#include "ini_file.hpp"
 #include "hook_manager.hpp"
 #include "addon_manager.hpp"
+#include "startup_trace.hpp"
 
 // These are defined in d3d9.h, but are used as function names below
 #undef IDirect3D9_CreateDevice
@@ -210,10 +212,65 @@ void dump_and_modify_present_parameters(D3DPRESENT_PARAMETERS &pp, D3DDISPLAYMOD
 	}
 }
 
+void modify_present_parameters_for_proxy_back_buffer(D3DPRESENT_PARAMETERS &pp, D3DPRESENT_PARAMETERS &proxy_pp)
+{
+	proxy_pp = {};
+
+	// Optionally create the actual back buffer without multisampling and hand the application a multisampled render target instead, which is resolved once during present
+	// This way effects can work on the actual back buffer directly, instead of having to resolve it to and copy it back from an intermediate texture every frame
+	bool use_proxy_back_buffer = false;
+	reshade::global_config().get("APP", "D3D9ProxyBackBuffer", use_proxy_back_buffer);
+
+	if (!use_proxy_back_buffer || pp.MultiSampleType == D3DMULTISAMPLE_NONE || pp.SwapEffect != D3DSWAPEFFECT_DISCARD)
+		return;
+
+	reshade::log::message(reshade::log::level::info, "> Replacing multisampled back buffer with a proxy render target.");
+
+	proxy_pp = pp;
+
+	pp.MultiSampleType = D3DMULTISAMPLE_NONE;
+	pp.MultiSampleQuality = 0;
+	// The auto depth-stencil has to match the multisampling of the proxy render target, so it is replaced as well (see 'Direct3DDevice9::init_proxy_back_buffer')
+	pp.EnableAutoDepthStencil = FALSE;
+	pp.Flags &= ~D3DPRESENTFLAG_DISCARD_DEPTHSTENCIL;
+}
+
+bool modify_present_parameters_for_flip_model(D3DPRESENT_PARAMETERS &pp)
+{
+	// Optionally replace the blit model swap effect with the flip model one only available on extended devices, which avoids the extra copy by the desktop window manager in windowed and borderless mode
+	bool use_flip_model = false;
+	reshade::global_config().get("APP", "D3D9FlipEx", use_flip_model);
+
+	// Flip model swap chains do not support multisampling and lockable back buffers, and there is no benefit from them in exclusive fullscreen mode
+	if (!use_flip_model || !pp.Windowed || pp.MultiSampleType != D3DMULTISAMPLE_NONE || (pp.Flags & D3DPRESENTFLAG_LOCKABLE_BACKBUFFER) != 0)
+		return false;
+	if (pp.SwapEffect == D3DSWAPEFFECT_FLIPEX)
+		return true;
+
+	reshade::log::message(reshade::log::level::info, "> Replacing swap effect with 'D3DSWAPEFFECT_FLIPEX'.");
+
+	pp.SwapEffect = D3DSWAPEFFECT_FLIPEX;
+	// Flip model needs at least one buffer that is not currently being scanned out
+	if (pp.BackBufferCount < 2)
+		pp.BackBufferCount = 2;
+	pp.Flags &= ~D3DPRESENTFLAG_DEVICECLIP;
+
+	return true;
+}
+
+static void set_maximum_frame_latency_for_flip_model(IDirect3DDevice9Ex *device)
+{
+	unsigned int max_frame_latency = 1;
+	reshade::global_config().get("APP", "D3D9MaximumFrameLatency", max_frame_latency);
+
+	if (max_frame_latency != 0)
+		device->SetMaximumFrameLatency(max_frame_latency);
+}
+
 extern void init_device_proxy_for_d3d9on12(Direct3DDevice9 *device_proxy);
 
 template <typename T>
-static void init_device_proxy(T *&device, D3DDEVTYPE device_type, bool use_software_rendering)
+static void init_device_proxy(T *&device, D3DDEVTYPE device_type, bool use_software_rendering, const D3DPRESENT_PARAMETERS &proxy_pp)
 {
 	// Enable software vertex processing if the application requested a software device
 	if (use_software_rendering)
@@ -229,7 +286,7 @@ static void init_device_proxy(T *&device, D3DDEVTYPE device_type, bool use_softw
 	device->GetSwapChain(0, &swapchain);
 	assert(swapchain != nullptr); // There should always be an implicit swap chain
 
-	const auto device_proxy = new Direct3DDevice9(device, use_software_rendering);
+	const auto device_proxy = new Direct3DDevice9(device, use_software_rendering, proxy_pp);
 	device_proxy->_implicit_swapchain = new Direct3DSwapChain9(device_proxy, swapchain);
 
 	// Overwrite returned device with proxy device
@@ -266,6 +323,8 @@ HRESULT STDMETHODCALLTYPE IDirect3D9_CreateDevice(IDirect3D9 *pD3D, UINT Adapter
 	if (g_in_d3d9_runtime)
 		return trampoline(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, ppReturnedDeviceInterface);
 
+	const reshade::startup_trace::scoped_span trace_span("IDirect3D9::CreateDevice");
+
 	reshade::log::message(
 		reshade::log::level::info,
 		"Redirecting IDirect3D9::CreateDevice(this = %p, Adapter = %u, DeviceType = %d, hFocusWindow = %p, BehaviorFlags = %#x, pPresentationParameters = %p, ppReturnedDeviceInterface = %p) ...",
@@ -287,6 +346,19 @@ HRESULT STDMETHODCALLTYPE IDirect3D9_CreateDevice(IDirect3D9 *pD3D, UINT Adapter
 
 	D3DPRESENT_PARAMETERS pp = *pPresentationParameters;
 	dump_and_modify_present_parameters(pp, pD3D, Adapter, hFocusWindow);
+	D3DPRESENT_PARAMETERS proxy_pp;
+	modify_present_parameters_for_proxy_back_buffer(pp, proxy_pp);
+
+	// Flip model requires an extended device, so silently upgrade the device the application asked for when that is enabled
+	const D3DPRESENT_PARAMETERS blit_pp = pp;
+	com_ptr<IDirect3D9Ex> d3dex;
+	if (DeviceType != D3DDEVTYPE_NULLREF && modify_present_parameters_for_flip_model(pp) &&
+		FAILED(pD3D->QueryInterface(IID_PPV_ARGS(&d3dex))) &&
+		FAILED(reshade::hooks::call(Direct3DCreate9Ex)(D3D_SDK_VERSION, &d3dex)))
+	{
+		reshade::log::message(reshade::log::level::warning, "Failed to create an extended Direct3D 9 object, falling back to the original swap effect.");
+		pp = blit_pp;
+	}
 
 	const bool use_software_rendering = (BehaviorFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING) != 0;
 	if (use_software_rendering)
@@ -298,7 +370,19 @@ HRESULT STDMETHODCALLTYPE IDirect3D9_CreateDevice(IDirect3D9 *pD3D, UINT Adapter
 
 	assert(!g_in_dxgi_runtime);
 	g_in_d3d9_runtime = g_in_dxgi_runtime = true;
-	const HRESULT hr = trampoline(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, &pp, ppReturnedDeviceInterface);
+	HRESULT hr = E_FAIL;
+	if (d3dex != nullptr)
+	{
+		hr = d3dex->CreateDeviceEx(Adapter, DeviceType, hFocusWindow, BehaviorFlags, &pp, nullptr, reinterpret_cast<IDirect3DDevice9Ex **>(ppReturnedDeviceInterface));
+		if (FAILED(hr))
+		{
+			reshade::log::message(reshade::log::level::warning, "IDirect3D9Ex::CreateDeviceEx failed with error code %s, falling back to the original swap effect.", reshade::log::hr_to_string(hr).c_str());
+			pp = blit_pp;
+			d3dex.reset();
+		}
+	}
+	if (d3dex == nullptr)
+		hr = trampoline(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, &pp, ppReturnedDeviceInterface);
 	g_in_d3d9_runtime = g_in_dxgi_runtime = false;
 
 	// Update output values (see https://docs.microsoft.com/windows/win32/api/d3d9/nf-d3d9-idirect3d9-createdevice)
@@ -309,7 +393,14 @@ HRESULT STDMETHODCALLTYPE IDirect3D9_CreateDevice(IDirect3D9 *pD3D, UINT Adapter
 
 	if (SUCCEEDED(hr))
 	{
-		init_device_proxy(*ppReturnedDeviceInterface, DeviceType, use_software_rendering);
+		if (d3dex != nullptr)
+			set_maximum_frame_latency_for_flip_model(static_cast<IDirect3DDevice9Ex *>(*ppReturnedDeviceInterface));
+
+		init_device_proxy(*ppReturnedDeviceInterface, DeviceType, use_software_rendering, proxy_pp);
+
+		// The application expects a device that supports the managed pool, which extended devices do not
+		if (d3dex != nullptr)
+			static_cast<Direct3DDevice9 *>(*ppReturnedDeviceInterface)->_emulate_managed_pool = true;
 	}
 	else
 	{
@@ -331,6 +422,8 @@ HRESULT STDMETHODCALLTYPE IDirect3D9Ex_CreateDeviceEx(IDirect3D9Ex *pD3D, UINT A
 	if (g_in_d3d9_runtime)
 		return trampoline(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, pFullscreenDisplayMode, ppReturnedDeviceInterface);
 
+	const reshade::startup_trace::scoped_span trace_span("IDirect3D9Ex::CreateDeviceEx");
+
 	reshade::log::message(
 		reshade::log::level::info,
 		"Redirecting IDirect3D9Ex::CreateDeviceEx(this = %p, Adapter = %u, DeviceType = %d, hFocusWindow = %p, BehaviorFlags = %#x, pPresentationParameters = %p, pFullscreenDisplayMode = %p, ppReturnedDeviceInterface = %p) ...",
@@ -355,6 +448,9 @@ HRESULT STDMETHODCALLTYPE IDirect3D9Ex_CreateDeviceEx(IDirect3D9Ex *pD3D, UINT A
 		fullscreen_mode = *pFullscreenDisplayMode;
 	D3DPRESENT_PARAMETERS pp = *pPresentationParameters;
 	dump_and_modify_present_parameters(pp, fullscreen_mode, pD3D, Adapter, hFocusWindow);
+	D3DPRESENT_PARAMETERS proxy_pp;
+	modify_present_parameters_for_proxy_back_buffer(pp, proxy_pp);
+	const bool use_flip_model = DeviceType != D3DDEVTYPE_NULLREF && modify_present_parameters_for_flip_model(pp);
 
 	const bool use_software_rendering = (BehaviorFlags & D3DCREATE_SOFTWARE_VERTEXPROCESSING) != 0;
 	if (use_software_rendering)
@@ -377,7 +473,10 @@ HRESULT STDMETHODCALLTYPE IDirect3D9Ex_CreateDeviceEx(IDirect3D9Ex *pD3D, UINT A
 
 	if (SUCCEEDED(hr))
 	{
-		init_device_proxy(*ppReturnedDeviceInterface, DeviceType, use_software_rendering);
+		if (use_flip_model)
+			set_maximum_frame_latency_for_flip_model(*ppReturnedDeviceInterface);
+
+		init_device_proxy(*ppReturnedDeviceInterface, DeviceType, use_software_rendering, proxy_pp);
 	}
 	else
 	{
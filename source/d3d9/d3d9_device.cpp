@@ -41,6 +41,18 @@ extern thread_local bool g_in_dxgi_runtime;
 
 extern void dump_and_modify_present_parameters(D3DPRESENT_PARAMETERS &pp, IDirect3D9 *d3d, UINT adapter_index, [[maybe_unused]] HWND focus_window);
 extern void dump_and_modify_present_parameters(D3DPRESENT_PARAMETERS &pp, D3DDISPLAYMODEEX &fullscreen_desc, IDirect3D9 *d3d, UINT adapter_index, [[maybe_unused]] HWND focus_window);
+extern void modify_present_parameters_for_proxy_back_buffer(D3DPRESENT_PARAMETERS &pp, D3DPRESENT_PARAMETERS &proxy_pp);
+extern bool modify_present_parameters_for_flip_model(D3DPRESENT_PARAMETERS &pp);
+
+static void replace_managed_pool(D3DPOOL &pool, DWORD &usage)
+{
+	// Dynamic resources in the default pool can be locked like managed ones, but are never lost on extended devices
+	if (pool == D3DPOOL_MANAGED)
+	{
+		pool = D3DPOOL_DEFAULT;
+		usage |= D3DUSAGE_DYNAMIC;
+	}
+}
 
 const reshade::api::subresource_box *convert_rect_to_box(const RECT *rect, reshade::api::subresource_box &box)
 {
@@ -75,10 +87,11 @@ const reshade::api::subresource_box *convert_rect_to_box(const POINT *point, LON
 	return &box;
 }
 
-Direct3DDevice9::Direct3DDevice9(IDirect3DDevice9 *original, bool use_software_rendering) :
+Direct3DDevice9::Direct3DDevice9(IDirect3DDevice9 *original, bool use_software_rendering, const D3DPRESENT_PARAMETERS &proxy_present_params) :
 	device_impl(original),
 	_extended_interface(false),
-	_use_software_rendering(use_software_rendering)
+	_use_software_rendering(use_software_rendering),
+	_proxy_present_params(proxy_present_params)
 {
 	g_pd3dDevice = this;
 	assert(_orig != nullptr);
@@ -87,10 +100,13 @@ Direct3DDevice9::Direct3DDevice9(IDirect3DDevice9 *original, bool use_software_r
 	reshade::load_addons();
 #endif
 
+	// Set up proxy back buffer before initialization, so that its depth-stencil is picked up as the auto depth-stencil
+	init_proxy_back_buffer();
+
 	on_init();
 }
-Direct3DDevice9::Direct3DDevice9(IDirect3DDevice9Ex *original, bool use_software_rendering) :
-	Direct3DDevice9(static_cast<IDirect3DDevice9 *>(original), use_software_rendering)
+Direct3DDevice9::Direct3DDevice9(IDirect3DDevice9Ex *original, bool use_software_rendering, const D3DPRESENT_PARAMETERS &proxy_present_params) :
+	Direct3DDevice9(static_cast<IDirect3DDevice9 *>(original), use_software_rendering, proxy_present_params)
 {
 	g_pd3dDevice = this;
 	_extended_interface = true;
@@ -99,6 +115,8 @@ Direct3DDevice9::~Direct3DDevice9()
 {
 	on_reset();
 
+	reset_proxy_back_buffer();
+
 #if RESHADE_ADDON
 	reshade::unload_addons();
 #endif
@@ -324,10 +342,15 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresent
 
 	D3DPRESENT_PARAMETERS pp = *pPresentationParameters;
 	dump_and_modify_present_parameters(pp, _d3d.get(), _cp.AdapterOrdinal, _cp.hFocusWindow);
+	modify_present_parameters_for_proxy_back_buffer(pp, _proxy_present_params);
+	// Flip model is only available on extended devices
+	if (_extended_interface)
+		modify_present_parameters_for_flip_model(pp);
 
 	// Release all resources before performing reset
 	_implicit_swapchain->on_reset(true);
 	on_reset();
+	reset_proxy_back_buffer();
 
 	assert(!g_in_d3d9_runtime && !g_in_dxgi_runtime);
 	g_in_d3d9_runtime = g_in_dxgi_runtime = true;
@@ -342,6 +365,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresent
 
 	if (SUCCEEDED(hr))
 	{
+		init_proxy_back_buffer();
 		on_init();
 		_implicit_swapchain->on_init(true);
 	}
@@ -377,6 +401,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::Present(
 	if (_implicit_swapchain != nullptr)
 	{
 		_implicit_swapchain->handle_device_loss(hr);
+		_implicit_swapchain->limit_frame_latency(hr);
 	}
 
 	return hr;
@@ -428,6 +453,9 @@ void    STDMETHODCALLTYPE Direct3DDevice9::GetGammaRamp(UINT iSwapChain, D3DGAMM
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9 **ppTexture, HANDLE *pSharedHandle)
 {
+	if (_emulate_managed_pool)
+		replace_managed_pool(Pool, Usage);
+
 #if RESHADE_ADDON
 	D3DSURFACE_DESC internal_desc = { Format, D3DRTYPE_TEXTURE, Usage, Pool, D3DMULTISAMPLE_NONE, 0, Width, Height };
 	auto desc = reshade::d3d9::convert_resource_desc(internal_desc, Levels, FALSE, _caps, pSharedHandle != nullptr);
@@ -533,6 +561,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateTexture(UINT Width, UINT Height
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9 **ppVolumeTexture, HANDLE *pSharedHandle)
 {
+	if (_emulate_managed_pool)
+		replace_managed_pool(Pool, Usage);
+
 #if RESHADE_ADDON
 	D3DVOLUME_DESC internal_desc { Format, D3DRTYPE_VOLUMETEXTURE, Usage, Pool, Width, Height, Depth };
 	auto desc = reshade::d3d9::convert_resource_desc(internal_desc, Levels, pSharedHandle != nullptr);
@@ -613,6 +644,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateVolumeTexture(UINT Width, UINT
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9 **ppCubeTexture, HANDLE *pSharedHandle)
 {
+	if (_emulate_managed_pool)
+		replace_managed_pool(Pool, Usage);
+
 #if RESHADE_ADDON
 	D3DSURFACE_DESC internal_desc { Format, D3DRTYPE_CUBETEXTURE, Usage, Pool, D3DMULTISAMPLE_NONE, 0, EdgeLength, EdgeLength };
 	auto desc = reshade::d3d9::convert_resource_desc(internal_desc, Levels, FALSE, _caps, pSharedHandle != nullptr);
@@ -728,6 +762,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateVertexBuffer(UINT Length, DWORD
 	if (_use_software_rendering)
 		Usage |= D3DUSAGE_SOFTWAREPROCESSING;
 
+	if (_emulate_managed_pool)
+		replace_managed_pool(Pool, Usage);
+
 #if RESHADE_ADDON
 	D3DVERTEXBUFFER_DESC internal_desc = { D3DFMT_VERTEXDATA, D3DRTYPE_VERTEXBUFFER, Usage, Pool, Length, FVF };
 	auto desc = reshade::d3d9::convert_resource_desc(internal_desc, pSharedHandle != nullptr);
@@ -779,6 +816,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::CreateIndexBuffer(UINT Length, DWORD
 	if (_use_software_rendering)
 		Usage |= D3DUSAGE_SOFTWAREPROCESSING;
 
+	if (_emulate_managed_pool)
+		replace_managed_pool(Pool, Usage);
+
 #if RESHADE_ADDON
 	D3DINDEXBUFFER_DESC internal_desc = { Format, D3DRTYPE_INDEXBUFFER, Usage, Pool, Length };
 	auto desc = reshade::d3d9::convert_resource_desc(internal_desc, pSharedHandle != nullptr);
@@ -1689,23 +1729,11 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE Prim
 
 		resize_primitive_up_buffers(vertex_buffer_size, 0, 0);
 
-		if (void *mapped_vertex_data = nullptr;
-			_primitive_up_vertex_buffer != 0 &&
-			device_impl::map_buffer_region(_primitive_up_vertex_buffer, 0, vertex_buffer_size, reshade::api::map_access::write_discard, &mapped_vertex_data))
-		{
-			reshade::invoke_addon_event<reshade::addon_event::map_buffer_region>(
-				this,
-				_primitive_up_vertex_buffer,
-				0,
-				vertex_buffer_size,
-				reshade::api::map_access::write_discard,
-				const_cast<void **>(&pVertexStreamZeroData));
-			std::memcpy(mapped_vertex_data, pVertexStreamZeroData, vertex_buffer_size);
-			reshade::invoke_addon_event<reshade::addon_event::unmap_buffer_region>(this, _primitive_up_vertex_buffer);
-			device_impl::unmap_buffer_region(_primitive_up_vertex_buffer);
-		}
+		UINT vertex_offset = 0;
+		if (_primitive_up_vertex_buffer != 0)
+			append_primitive_up_data(_primitive_up_vertex_buffer, _primitive_up_vertex_buffer_size, _primitive_up_vertex_buffer_offset, VertexStreamZeroStride, pVertexStreamZeroData, vertex_buffer_size, vertex_offset);
 
-		const uint64_t offset_64 = 0;
+		const uint64_t offset_64 = vertex_offset;
 
 		reshade::invoke_addon_event<reshade::addon_event::bind_vertex_buffers>(this, 0, 1, &_primitive_up_vertex_buffer, &offset_64, &VertexStreamZeroStride);
 	}
@@ -1746,6 +1774,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETY
 {
 #if RESHADE_ADDON
 	const uint32_t index_count = reshade::d3d9::calc_vertex_from_prim_count(PrimitiveType, PrimitiveCount);
+	uint32_t first_index = 0;
 #endif
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>() ||
@@ -1757,38 +1786,16 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETY
 
 		resize_primitive_up_buffers(vertex_buffer_size, index_buffer_size, index_size);
 
-		if (void *mapped_vertex_data = nullptr;
-			_primitive_up_vertex_buffer != 0 &&
-			device_impl::map_buffer_region(_primitive_up_vertex_buffer, 0, vertex_buffer_size, reshade::api::map_access::write_discard, &mapped_vertex_data))
-		{
-			reshade::invoke_addon_event<reshade::addon_event::map_buffer_region>(
-				this,
-				_primitive_up_vertex_buffer,
-				0,
-				vertex_buffer_size,
-				reshade::api::map_access::write_discard,
-				const_cast<void **>(&pVertexStreamZeroData));
-			std::memcpy(mapped_vertex_data, pVertexStreamZeroData, vertex_buffer_size);
-			reshade::invoke_addon_event<reshade::addon_event::unmap_buffer_region>(this, _primitive_up_vertex_buffer);
-			device_impl::unmap_buffer_region(_primitive_up_vertex_buffer);
-		}
-		if (void *mapped_index_data = nullptr;
-			_primitive_up_index_buffer != 0 &&
-			device_impl::map_buffer_region(_primitive_up_index_buffer, 0, index_buffer_size, reshade::api::map_access::write_discard, &mapped_index_data))
-		{
-			reshade::invoke_addon_event<reshade::addon_event::map_buffer_region>(
-				this,
-				_primitive_up_index_buffer,
-				0,
-				index_buffer_size,
-				reshade::api::map_access::write_discard,
-				const_cast<void **>(&pIndexData));
-			std::memcpy(mapped_index_data, pIndexData, index_buffer_size);
-			reshade::invoke_addon_event<reshade::addon_event::unmap_buffer_region>(this, _primitive_up_index_buffer);
-			device_impl::unmap_buffer_region(_primitive_up_index_buffer);
-		}
+		UINT vertex_offset = 0;
+		if (_primitive_up_vertex_buffer != 0)
+			append_primitive_up_data(_primitive_up_vertex_buffer, _primitive_up_vertex_buffer_size, _primitive_up_vertex_buffer_offset, VertexStreamZeroStride, pVertexStreamZeroData, vertex_buffer_size, vertex_offset);
+		// Index buffers cannot be bound with an offset in D3D9, so pass the location in the ring buffer as the first index of the draw call instead
+		UINT index_offset = 0;
+		if (_primitive_up_index_buffer != 0 &&
+			append_primitive_up_data(_primitive_up_index_buffer, _primitive_up_index_buffer_size, _primitive_up_index_buffer_offset, index_size, pIndexData, index_buffer_size, index_offset))
+			first_index = index_offset / index_size;
 
-		const uint64_t offset_64 = 0;
+		const uint64_t offset_64 = vertex_offset;
 
 		reshade::invoke_addon_event<reshade::addon_event::bind_vertex_buffers>(this, 0, 1, &_primitive_up_vertex_buffer, &offset_64, &VertexStreamZeroStride);
 		reshade::invoke_addon_event<reshade::addon_event::bind_index_buffer>(this, _primitive_up_index_buffer, 0, index_size);
@@ -1808,7 +1815,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETY
 #if RESHADE_ADDON
 	}
 
-	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, index_count, 1, 0, 0, 0))
+	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(this, index_count, 1, first_index, 0, 0))
 		return D3D_OK;
 #endif
 
@@ -2297,6 +2304,9 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::PresentEx(const RECT *pSourceRect, co
 
 	_implicit_swapchain->handle_device_loss(hr);
 
+	if ((dwFlags & D3DPRESENT_DONOTFLIP) == 0)
+		_implicit_swapchain->limit_frame_latency(hr);
+
 	return hr;
 }
 HRESULT STDMETHODCALLTYPE Direct3DDevice9::GetGPUThreadPriority(INT *pPriority)
@@ -2574,10 +2584,13 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::ResetEx(D3DPRESENT_PARAMETERS *pPrese
 		fullscreen_mode = *pFullscreenDisplayMode;
 	D3DPRESENT_PARAMETERS pp = *pPresentationParameters;
 	dump_and_modify_present_parameters(pp, fullscreen_mode, _d3d.get(), _cp.AdapterOrdinal, _cp.hFocusWindow);
+	modify_present_parameters_for_proxy_back_buffer(pp, _proxy_present_params);
+	modify_present_parameters_for_flip_model(pp);
 
 	// Release all resources before performing reset
 	_implicit_swapchain->on_reset(true);
 	on_reset();
+	reset_proxy_back_buffer();
 
 	assert(!g_in_d3d9_runtime && !g_in_dxgi_runtime);
 	g_in_d3d9_runtime = g_in_dxgi_runtime = true;
@@ -2592,6 +2605,7 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::ResetEx(D3DPRESENT_PARAMETERS *pPrese
 
 	if (SUCCEEDED(hr))
 	{
+		init_proxy_back_buffer();
 		on_init();
 		_implicit_swapchain->on_init(true);
 	}
@@ -2618,6 +2632,74 @@ HRESULT STDMETHODCALLTYPE Direct3DDevice9::GetDisplayModeEx(UINT iSwapChain, D3D
 	return static_cast<IDirect3DSwapChain9Ex *>(_implicit_swapchain)->GetDisplayModeEx(pMode, pRotation);
 }
 
+void Direct3DDevice9::init_proxy_back_buffer()
+{
+	assert(_proxy_back_buffer == nullptr && _proxy_depth_stencil == nullptr);
+
+	if (_proxy_present_params.MultiSampleType == D3DMULTISAMPLE_NONE)
+		return;
+
+	com_ptr<IDirect3DSurface9> back_buffer;
+	if (FAILED(_orig->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &back_buffer)))
+		return;
+
+	D3DSURFACE_DESC desc;
+	back_buffer->GetDesc(&desc);
+
+	if (const HRESULT hr = _orig->CreateRenderTarget(desc.Width, desc.Height, desc.Format, _proxy_present_params.MultiSampleType, _proxy_present_params.MultiSampleQuality, FALSE, &_proxy_back_buffer, nullptr);
+		SUCCEEDED(hr))
+	{
+		desc.MultiSampleType = _proxy_present_params.MultiSampleType;
+		desc.MultiSampleQuality = _proxy_present_params.MultiSampleQuality;
+
+		_orig->SetRenderTarget(0, _proxy_back_buffer.get());
+	}
+	else
+	{
+		// Fall back to the actual back buffer without multisampling, but still create the auto depth-stencil below, since the application relies on it
+		reshade::log::message(reshade::log::level::error, "Failed to create proxy back buffer with error code %s!", reshade::log::hr_to_string(hr).c_str());
+	}
+
+	if (_proxy_present_params.EnableAutoDepthStencil)
+	{
+		if (const HRESULT hr = _orig->CreateDepthStencilSurface(desc.Width, desc.Height, _proxy_present_params.AutoDepthStencilFormat, desc.MultiSampleType, desc.MultiSampleQuality, (_proxy_present_params.Flags & D3DPRESENTFLAG_DISCARD_DEPTHSTENCIL) != 0, &_proxy_depth_stencil, nullptr);
+			SUCCEEDED(hr))
+			_orig->SetDepthStencilSurface(_proxy_depth_stencil.get());
+		else
+			reshade::log::message(reshade::log::level::error, "Failed to create proxy auto depth-stencil with error code %s!", reshade::log::hr_to_string(hr).c_str());
+	}
+}
+void Direct3DDevice9::reset_proxy_back_buffer()
+{
+	// Unbind proxy resources, since 'IDirect3DDevice9::Reset' fails while any references to default pool resources are left
+	if (com_ptr<IDirect3DSurface9> back_buffer;
+		_proxy_back_buffer != nullptr && SUCCEEDED(_orig->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &back_buffer)))
+		_orig->SetRenderTarget(0, back_buffer.get());
+	if (_proxy_depth_stencil != nullptr)
+		_orig->SetDepthStencilSurface(nullptr);
+
+	_proxy_back_buffer.reset();
+	_proxy_depth_stencil.reset();
+}
+void Direct3DDevice9::resolve_proxy_back_buffer()
+{
+	if (_proxy_back_buffer == nullptr)
+		return;
+
+	com_ptr<IDirect3DSurface9> back_buffer;
+	if (SUCCEEDED(_orig->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &back_buffer)))
+		_orig->StretchRect(_proxy_back_buffer.get(), nullptr, back_buffer.get(), nullptr, D3DTEXF_NONE);
+}
+void Direct3DDevice9::restore_proxy_back_buffer()
+{
+	if (_proxy_back_buffer == nullptr)
+		return;
+
+	com_ptr<IDirect3DSurface9> back_buffer;
+	if (SUCCEEDED(_orig->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &back_buffer)))
+		_orig->StretchRect(back_buffer.get(), nullptr, _proxy_back_buffer.get(), nullptr, D3DTEXF_NONE);
+}
+
 #if RESHADE_ADDON
 void Direct3DDevice9::on_init()
 {
@@ -2761,24 +2843,31 @@ void Direct3DDevice9::resize_primitive_up_buffers(UINT vertex_buffer_size, UINT
 {
 	const bool reset = (vertex_buffer_size == 0);
 
-	reshade::api::resource_desc vertex_buffer_desc(0, reshade::api::memory_heap::cpu_to_gpu, reshade::api::resource_usage::vertex_buffer, reshade::api::resource_flags::dynamic);
-	if (_primitive_up_vertex_buffer != 0)
-		vertex_buffer_desc = device_impl::get_resource_desc(_primitive_up_vertex_buffer);
+	// Budget enough space for many draw calls (e.g. a full frame of user interface), so that the ring buffers rarely wrap around
+	constexpr UINT min_vertex_buffer_size = 4 * 1024 * 1024;
+	constexpr UINT min_index_buffer_size = 1 * 1024 * 1024;
 
 	// Initialize fake buffers for 'IDirect3DDevice9::DrawPrimitiveUP' and 'IDirect3DDevice9::DrawIndexedPrimitiveUP'
-	if (reset || vertex_buffer_size > vertex_buffer_desc.buffer.size)
+	if (reset || vertex_buffer_size > _primitive_up_vertex_buffer_size)
 	{
 		if (_primitive_up_vertex_buffer != 0)
 		{
 			reshade::invoke_addon_event<reshade::addon_event::destroy_resource>(this, _primitive_up_vertex_buffer);
 			device_impl::destroy_resource(_primitive_up_vertex_buffer);
+			_primitive_up_vertex_buffer = {};
 		}
 
-		vertex_buffer_desc.buffer.size = vertex_buffer_size;
+		_primitive_up_vertex_buffer_size = 0;
+		_primitive_up_vertex_buffer_offset = 0;
+
+		reshade::api::resource_desc vertex_buffer_desc(0, reshade::api::memory_heap::cpu_to_gpu, reshade::api::resource_usage::vertex_buffer, reshade::api::resource_flags::dynamic);
+		vertex_buffer_desc.buffer.size = (vertex_buffer_size * 2 > min_vertex_buffer_size) ? vertex_buffer_size * 2 : min_vertex_buffer_size;
 
 		if (vertex_buffer_size != 0 &&
 			device_impl::create_resource(vertex_buffer_desc, nullptr, reshade::api::resource_usage::vertex_buffer, &_primitive_up_vertex_buffer))
 		{
+			_primitive_up_vertex_buffer_size = static_cast<UINT>(vertex_buffer_desc.buffer.size);
+
 			reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 				this,
 				vertex_buffer_desc,
@@ -2788,24 +2877,28 @@ void Direct3DDevice9::resize_primitive_up_buffers(UINT vertex_buffer_size, UINT
 		}
 	}
 
-	reshade::api::resource_desc index_buffer_desc(0, reshade::api::memory_heap::cpu_to_gpu, reshade::api::resource_usage::index_buffer, reshade::api::resource_flags::dynamic);
-	if (_primitive_up_index_buffer != 0)
-		index_buffer_desc = device_impl::get_resource_desc(_primitive_up_index_buffer);
-
-	if (reset || index_buffer_size > index_buffer_desc.buffer.size || index_size != index_buffer_desc.buffer.stride)
+	if (reset || index_buffer_size > _primitive_up_index_buffer_size || (index_size != 0 && index_size != _primitive_up_index_size))
 	{
 		if (_primitive_up_index_buffer != 0)
 		{
 			reshade::invoke_addon_event<reshade::addon_event::destroy_resource>(this, _primitive_up_index_buffer);
 			device_impl::destroy_resource(_primitive_up_index_buffer);
+			_primitive_up_index_buffer = {};
 		}
 
-		index_buffer_desc.buffer.size = index_buffer_size;
+		_primitive_up_index_size = index_size;
+		_primitive_up_index_buffer_size = 0;
+		_primitive_up_index_buffer_offset = 0;
+
+		reshade::api::resource_desc index_buffer_desc(0, reshade::api::memory_heap::cpu_to_gpu, reshade::api::resource_usage::index_buffer, reshade::api::resource_flags::dynamic);
+		index_buffer_desc.buffer.size = (index_buffer_size * 2 > min_index_buffer_size) ? index_buffer_size * 2 : min_index_buffer_size;
 		index_buffer_desc.buffer.stride = index_size;
 
 		if (index_buffer_size != 0 &&
-			device_impl::create_resource(index_buffer_desc, nullptr, reshade::api::resource_usage::index_buffer, &_primitive_up_vertex_buffer))
+			device_impl::create_resource(index_buffer_desc, nullptr, reshade::api::resource_usage::index_buffer, &_primitive_up_index_buffer))
 		{
+			_primitive_up_index_buffer_size = static_cast<UINT>(index_buffer_desc.buffer.size);
+
 			reshade::invoke_addon_event<reshade::addon_event::init_resource>(
 				this,
 				index_buffer_desc,
@@ -2815,6 +2908,44 @@ void Direct3DDevice9::resize_primitive_up_buffers(UINT vertex_buffer_size, UINT
 		}
 	}
 }
+bool Direct3DDevice9::append_primitive_up_data(reshade::api::resource buffer, UINT buffer_size, UINT &ring_offset, UINT alignment, const void *&data, UINT size, UINT &out_offset)
+{
+	// Keep offsets a multiple of the element size, so that add-ons can address them by element index
+	UINT offset = alignment != 0 ? (ring_offset + alignment - 1) / alignment * alignment : ring_offset;
+
+	// Append without synchronization while there is space left, since earlier draws only ever read regions before the current offset
+	DWORD lock_flags = D3DLOCK_NOOVERWRITE;
+	reshade::api::map_access access = reshade::api::map_access::write_only;
+	if (offset + size > buffer_size || offset + size < offset)
+	{
+		offset = 0;
+		lock_flags = D3DLOCK_DISCARD;
+		access = reshade::api::map_access::write_discard;
+	}
+
+	// 'IDirect3DVertexBuffer9_Lock' and 'IDirect3DIndexBuffer9_Lock' are located at the same virtual function table index and have the same interface
+	const auto object = reinterpret_cast<IDirect3DVertexBuffer9 *>(buffer.handle);
+
+	void *mapped_data = nullptr;
+	if (FAILED(IDirect3DVertexBuffer9_Lock(object, offset, size, &mapped_data, lock_flags)))
+		return false;
+
+	reshade::invoke_addon_event<reshade::addon_event::map_buffer_region>(
+		this,
+		buffer,
+		offset,
+		size,
+		access,
+		const_cast<void **>(&data));
+	std::memcpy(mapped_data, data, size);
+	reshade::invoke_addon_event<reshade::addon_event::unmap_buffer_region>(this, buffer);
+
+	IDirect3DVertexBuffer9_Unlock(object);
+
+	ring_offset = offset + size;
+	out_offset = offset;
+	return true;
+}
 #endif
 
 #if defined(GAME_UC) || defined(GAME_PS)
@@ -2822,8 +2953,25 @@ void Direct3DDevice9::resize_primitive_up_buffers(UINT vertex_buffer_size, UINT
 bool bGlobalMotionBlur = false;
 int NFSUC_MOTIONBLUR_ExitPointTrue = NFSUC_MOTIONBLUR_EXIT_TRUE;
 int NFSUC_MOTIONBLUR_ExitPointFalse = NFSUC_MOTIONBLUR_EXIT_FALSE;
+void __stdcall MotionBlur_RenderStage_Hook()
+{
+	Direct3DDevice9 *const device = *(Direct3DDevice9 **)NFS_D3D9_DEVICE_ADDRESS;
+	if (device == nullptr || device->_implicit_swapchain == nullptr)
+		return;
+
+	// Render techniques assigned to this stage while the scene and its depth are still bound, before motion blur and the HUD are drawn over it
+	device->_implicit_swapchain->on_nfs_render_stage(reshade::nfs_render_stage::motion_blur);
+}
 void __declspec(naked) MotionBlur_EntryPoint()
 {
+	_asm
+	{
+		pushad
+		pushfd
+		call MotionBlur_RenderStage_Hook
+		popfd
+		popad
+	}
 	if (!bGlobalMotionBlur)
 		_asm jmp NFSUC_MOTIONBLUR_ExitPointFalse
 	_asm
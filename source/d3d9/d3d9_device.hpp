@@ -13,8 +13,8 @@ struct Direct3DDepthStencilSurface9;
 
 struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 final : IDirect3DDevice9Ex, public reshade::d3d9::device_impl
 {
-	Direct3DDevice9(IDirect3DDevice9   *original, bool use_software_rendering);
-	Direct3DDevice9(IDirect3DDevice9Ex *original, bool use_software_rendering);
+	Direct3DDevice9(IDirect3DDevice9   *original, bool use_software_rendering, const D3DPRESENT_PARAMETERS &proxy_present_params);
+	Direct3DDevice9(IDirect3DDevice9Ex *original, bool use_software_rendering, const D3DPRESENT_PARAMETERS &proxy_present_params);
 	~Direct3DDevice9();
 
 	#pragma region IUnknown
@@ -158,6 +158,11 @@ struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 fin
 	HRESULT STDMETHODCALLTYPE GetDisplayModeEx(UINT iSwapChain, D3DDISPLAYMODEEX *pMode, D3DDISPLAYROTATION *pRotation) override;
 	#pragma endregion
 
+	void init_proxy_back_buffer();
+	void reset_proxy_back_buffer();
+	void resolve_proxy_back_buffer();
+	void restore_proxy_back_buffer();
+
 #if RESHADE_ADDON
 	void on_init();
 	void on_reset();
@@ -167,6 +172,7 @@ struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 fin
 #endif
 #if RESHADE_ADDON >= 2
 	void resize_primitive_up_buffers(UINT vertex_buffer_size, UINT index_buffer_size, UINT index_size);
+	bool append_primitive_up_data(reshade::api::resource buffer, UINT buffer_size, UINT &ring_offset, UINT alignment, const void *&data, UINT size, UINT &out_offset);
 #endif
 
 	bool check_and_upgrade_interface(REFIID riid);
@@ -175,10 +181,17 @@ struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 fin
 	LONG _resource_ref = 0;
 	bool _extended_interface;
 	const bool _use_software_rendering;
+	// Set when the application created a regular device that was upgraded to an extended one for the flip model swap effect, in which case managed resources have to be emulated
+	bool _emulate_managed_pool = false;
 	Direct3DSwapChain9 *_implicit_swapchain = nullptr;
 	std::vector<Direct3DSwapChain9 *> _additional_swapchains;
 	Direct3DDevice9On12 *_d3d9on12_device = nullptr;
 
+	// Presentation parameters the application requested for the implicit swap chain if its multisampled back buffer is replaced with a proxy render target, otherwise 'MultiSampleType' is 'D3DMULTISAMPLE_NONE'
+	D3DPRESENT_PARAMETERS _proxy_present_params = {};
+	com_ptr<IDirect3DSurface9> _proxy_back_buffer;
+	com_ptr<IDirect3DSurface9> _proxy_depth_stencil;
+
 	// com_ptr<IDirect3DSurface9> _auto_depthstencil;
 	// reshade::d3d9::buffer_detection _buffer_detection;
 
@@ -191,5 +204,11 @@ struct DECLSPEC_UUID("F1006E9A-1C51-4AF4-ACEF-3605D2D4C8EE") Direct3DDevice9 fin
 #if RESHADE_ADDON >= 2
 	reshade::api::resource _primitive_up_vertex_buffer = {};
 	reshade::api::resource _primitive_up_index_buffer = {};
+	// The buffers are used as ring buffers, so that they only have to be discarded when wrapping around instead of on every draw call
+	UINT _primitive_up_vertex_buffer_size = 0;
+	UINT _primitive_up_vertex_buffer_offset = 0;
+	UINT _primitive_up_index_size = 0;
+	UINT _primitive_up_index_buffer_size = 0;
+	UINT _primitive_up_index_buffer_offset = 0;
 #endif
 };
@@ -101,7 +101,7 @@ void reshade::d3d9::device_impl::bind_render_targets_and_depth_stencil(uint32_t
 
 		for (DWORD i = 0; i < count; ++i)
 		{
-			_orig->SetRenderTarget(i, reinterpret_cast<IDirect3DSurface9 *>(rtvs[i].handle & ~1ull));
+			set_render_target(i, reinterpret_cast<IDirect3DSurface9 *>(rtvs[i].handle & ~1ull));
 
 			if (rtvs[i].handle & 1ull)
 				srgb_write_enable = true;
@@ -109,12 +109,39 @@ void reshade::d3d9::device_impl::bind_render_targets_and_depth_stencil(uint32_t
 
 		// Unset remaining render targets
 		for (DWORD i = count; i < _caps.NumSimultaneousRTs; ++i)
-			_orig->SetRenderTarget(i, nullptr);
+			set_render_target(i, nullptr);
 
 		_orig->SetRenderState(D3DRS_SRGBWRITEENABLE, srgb_write_enable);
 	}
 
-	_orig->SetDepthStencilSurface(reinterpret_cast<IDirect3DSurface9 *>(dsv.handle));
+	const auto depth_stencil = reinterpret_cast<IDirect3DSurface9 *>(dsv.handle);
+
+	if (_state_shadowing_depth != 0 && (_render_target_shadow_mask & (1u << D3D_MAX_SIMULTANEOUS_RENDERTARGETS)) != 0 && _render_target_shadows[D3D_MAX_SIMULTANEOUS_RENDERTARGETS] == depth_stencil)
+		return;
+
+	if (SUCCEEDED(_orig->SetDepthStencilSurface(depth_stencil)) && _state_shadowing_depth != 0)
+	{
+		_render_target_shadows[D3D_MAX_SIMULTANEOUS_RENDERTARGETS] = depth_stencil;
+		_render_target_shadow_mask |= 1u << D3D_MAX_SIMULTANEOUS_RENDERTARGETS;
+	}
+}
+void reshade::d3d9::device_impl::set_render_target(DWORD index, IDirect3DSurface9 *surface)
+{
+	assert(index < D3D_MAX_SIMULTANEOUS_RENDERTARGETS);
+
+	// Consecutive effect passes often render to the same targets, so skip rebinding those (binding a render target resets the viewport, but that is always set after beginning a render pass in the runtime)
+	if (_state_shadowing_depth != 0 && (_render_target_shadow_mask & (1u << index)) != 0 && _render_target_shadows[index] == surface)
+		return;
+
+	if (SUCCEEDED(_orig->SetRenderTarget(index, surface)) && _state_shadowing_depth != 0)
+	{
+		_render_target_shadows[index] = surface;
+		_render_target_shadow_mask |= 1u << index;
+	}
+	else
+	{
+		_render_target_shadow_mask &= ~(1u << index);
+	}
 }
 
 void reshade::d3d9::device_impl::bind_pipeline(api::pipeline_stage stages, api::pipeline pipeline)
@@ -125,6 +152,27 @@ void reshade::d3d9::device_impl::bind_pipeline(api::pipeline_stage stages, api::
 
 		// This is a pipeline handle created with 'device_impl::create_pipeline', which does not support partial binding of its state
 		assert(stages == api::pipeline_stage::all_graphics);
+
+		if (_tracking_state_block != nullptr)
+		{
+			// This has to match the states that are recorded in 'device_impl::create_pipeline'
+			static const state_block::state_mask pipeline_mask = []() {
+				state_block::state_mask mask;
+				mask.flags = state_block::state_mask::vertex_shader | state_block::state_mask::pixel_shader | state_block::state_mask::vertex_declaration;
+				mask.streams = 1;
+				for (const D3DRENDERSTATETYPE state : {
+						D3DRS_ZENABLE, D3DRS_FILLMODE, D3DRS_ZWRITEENABLE, D3DRS_ALPHATESTENABLE, D3DRS_LASTPIXEL, D3DRS_SRCBLEND, D3DRS_DESTBLEND, D3DRS_CULLMODE, D3DRS_ZFUNC, D3DRS_DITHERENABLE, D3DRS_ALPHABLENDENABLE, D3DRS_FOGENABLE,
+						D3DRS_STENCILENABLE, D3DRS_STENCILZFAIL, D3DRS_STENCILFAIL, D3DRS_STENCILPASS, D3DRS_STENCILFUNC, D3DRS_STENCILREF, D3DRS_STENCILMASK, D3DRS_STENCILWRITEMASK, D3DRS_CLIPPING, D3DRS_LIGHTING, D3DRS_VERTEXBLEND, D3DRS_CLIPPLANEENABLE,
+						D3DRS_MULTISAMPLEANTIALIAS, D3DRS_MULTISAMPLEMASK, D3DRS_COLORWRITEENABLE, D3DRS_BLENDOP, D3DRS_SCISSORTESTENABLE, D3DRS_SLOPESCALEDEPTHBIAS, D3DRS_ANTIALIASEDLINEENABLE, D3DRS_ENABLEADAPTIVETESSELLATION, D3DRS_TWOSIDEDSTENCILMODE,
+						D3DRS_CCW_STENCILZFAIL, D3DRS_CCW_STENCILFAIL, D3DRS_CCW_STENCILPASS, D3DRS_CCW_STENCILFUNC, D3DRS_COLORWRITEENABLE1, D3DRS_COLORWRITEENABLE2, D3DRS_COLORWRITEENABLE3, D3DRS_BLENDFACTOR, D3DRS_DEPTHBIAS,
+						D3DRS_SEPARATEALPHABLENDENABLE, D3DRS_SRCBLENDALPHA, D3DRS_DESTBLENDALPHA, D3DRS_BLENDOPALPHA })
+					mask.add_render_state(state);
+				return mask;
+			}();
+
+			_tracking_state_block->on_modify(pipeline_mask);
+		}
+
 		pipeline_object->state_block->Apply();
 
 		if ((stages & api::pipeline_stage::input_assembler) != 0 && pipeline_object->prim_type != 0)
@@ -132,6 +180,13 @@ void reshade::d3d9::device_impl::bind_pipeline(api::pipeline_stage stages, api::
 		return;
 	}
 
+	if (_tracking_state_block != nullptr)
+	{
+		state_block::state_mask mask;
+		mask.flags = stages == api::pipeline_stage::vertex_shader ? state_block::state_mask::vertex_shader : stages == api::pipeline_stage::pixel_shader ? state_block::state_mask::pixel_shader : state_block::state_mask::vertex_declaration;
+		_tracking_state_block->on_modify(mask);
+	}
+
 	switch (stages)
 	{
 	case api::pipeline_stage::vertex_shader:
@@ -152,6 +207,22 @@ void reshade::d3d9::device_impl::bind_pipeline_states(uint32_t count, const api:
 {
 	for (uint32_t i = 0; i < count; ++i)
 	{
+		if (_tracking_state_block != nullptr && states[i] != api::dynamic_state::primitive_topology)
+		{
+			state_block::state_mask mask;
+			if (states[i] == api::dynamic_state::alpha_to_coverage_enable)
+			{
+				mask.add_render_state(D3DRS_POINTSIZE);
+				mask.add_render_state(D3DRS_ADAPTIVETESS_Y);
+				mask.add_render_state(D3DRS_ALPHATESTENABLE);
+			}
+			else if (const D3DRENDERSTATETYPE state = convert_dynamic_state(states[i]); state < ARRAYSIZE(mask.render_states) * 32)
+			{
+				mask.add_render_state(state);
+			}
+			_tracking_state_block->on_modify(mask);
+		}
+
 		switch (states[i])
 		{
 		case api::dynamic_state::primitive_topology:
@@ -246,11 +317,49 @@ void reshade::d3d9::device_impl::bind_scissor_rects(uint32_t first, uint32_t cou
 
 	assert(count == 1 && rects != nullptr);
 
+	if (_tracking_state_block != nullptr)
+	{
+		state_block::state_mask mask;
+		mask.flags = state_block::state_mask::scissor_rect;
+		_tracking_state_block->on_modify(mask);
+	}
+
 	_orig->SetScissorRect(reinterpret_cast<const RECT *>(rects));
 }
 
 void reshade::d3d9::device_impl::push_constants(api::shader_stage stages, api::pipeline_layout layout, uint32_t layout_param, uint32_t first, uint32_t count, const void *values)
 {
+	if (_tracking_state_block != nullptr)
+	{
+		state_block::state_mask mask;
+		if (layout == 0 || reinterpret_cast<pipeline_layout_impl *>(layout.handle)->ranges[layout_param].binding == UINT32_MAX)
+		{
+			switch (layout_param)
+			{
+			case 3:
+				mask.flags = state_block::state_mask::vertex_shader_constant_i;
+				break;
+			case 4:
+				mask.flags = state_block::state_mask::vertex_shader_constant_b;
+				break;
+			case 6:
+				mask.flags = state_block::state_mask::pixel_shader_constant_i;
+				break;
+			case 7:
+				mask.flags = state_block::state_mask::pixel_shader_constant_b;
+				break;
+			}
+		}
+		if (mask.flags == 0)
+		{
+			if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
+				mask.vertex_shader_constant_f_count = (first + count) / 4;
+			if ((stages & api::shader_stage::pixel) == api::shader_stage::pixel)
+				mask.pixel_shader_constant_f_count = (first + count) / 4;
+		}
+		_tracking_state_block->on_modify(mask);
+	}
+
 	if (layout == 0 || reinterpret_cast<pipeline_layout_impl *>(layout.handle)->ranges[layout_param].binding == UINT32_MAX)
 	{
 		switch (layout_param)
@@ -285,6 +394,23 @@ void reshade::d3d9::device_impl::push_constants(api::shader_stage stages, api::p
 	first /= 4;
 	count /= 4;
 
+	if (_state_shadowing_depth != 0 && (first + count) <= constant_batch::MAX_REGISTERS)
+	{
+		// Only record the values here and upload them all at once right before the next draw call, since effects push the same constants for every pass
+		for (constant_batch *const batch : {
+				(stages & api::shader_stage::vertex) == api::shader_stage::vertex ? &_vs_constants : nullptr,
+				(stages & api::shader_stage::pixel) == api::shader_stage::pixel ? &_ps_constants : nullptr })
+		{
+			if (batch == nullptr)
+				continue;
+
+			std::memcpy(batch->pending + first * 4, values, count * 4 * sizeof(float));
+			batch->pending_first = std::min(batch->pending_first, first);
+			batch->pending_last = std::max(batch->pending_last, first + count);
+		}
+		return;
+	}
+
 	if ((stages & api::shader_stage::vertex) == api::shader_stage::vertex)
 	{
 		// https://learn.microsoft.com/windows/win32/direct3dhlsl/dx9-graphics-reference-asm-vs-registers-vs-3-0#input-registers
@@ -330,6 +456,14 @@ void reshade::d3d9::device_impl::push_descriptors(api::shader_stage stages, api:
 				count = (D3DVERTEXTEXTURESAMPLER3 + 1) - first;
 		}
 
+		if (_tracking_state_block != nullptr)
+		{
+			state_block::state_mask mask;
+			for (uint32_t i = 0; i < count; ++i)
+				mask.add_sampler(first + i);
+			_tracking_state_block->on_modify(mask);
+		}
+
 		switch (update.type)
 		{
 		case api::descriptor_type::sampler:
@@ -339,9 +473,7 @@ void reshade::d3d9::device_impl::push_descriptors(api::shader_stage stages, api:
 				if (descriptor == 0)
 					continue;
 
-				const sampler_impl *const sampler_instance = reinterpret_cast<const sampler_impl *>(descriptor.handle);
-				for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_MAXANISOTROPY; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
-					_orig->SetSamplerState(first + i, state, sampler_instance->state[state]);
+				bind_sampler(first + i, reinterpret_cast<const sampler_impl *>(descriptor.handle));
 			}
 			break;
 		case api::descriptor_type::sampler_with_resource_view:
@@ -349,14 +481,12 @@ void reshade::d3d9::device_impl::push_descriptors(api::shader_stage stages, api:
 			{
 				const auto &descriptor = static_cast<const api::sampler_with_resource_view *>(update.descriptors)[i];
 				_orig->SetTexture(first + i, reinterpret_cast<IDirect3DBaseTexture9 *>(descriptor.view.handle & ~1ull));
-				_orig->SetSamplerState(first + i, D3DSAMP_SRGBTEXTURE, descriptor.view.handle & 1);
+				set_sampler_state(first + i, D3DSAMP_SRGBTEXTURE, descriptor.view.handle & 1);
 
 				if (descriptor.sampler == 0)
 					continue;
 
-				const sampler_impl *const sampler_instance = reinterpret_cast<const sampler_impl *>(descriptor.sampler.handle);
-				for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_MAXANISOTROPY; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
-					_orig->SetSamplerState(first + i, state, sampler_instance->state[state]);
+				bind_sampler(first + i, reinterpret_cast<const sampler_impl *>(descriptor.sampler.handle));
 			}
 			break;
 		case api::descriptor_type::shader_resource_view:
@@ -364,7 +494,7 @@ void reshade::d3d9::device_impl::push_descriptors(api::shader_stage stages, api:
 			{
 				const auto &descriptor = static_cast<const api::resource_view *>(update.descriptors)[i];
 				_orig->SetTexture(first + i, reinterpret_cast<IDirect3DBaseTexture9 *>(descriptor.handle & ~1ull));
-				_orig->SetSamplerState(first + i, D3DSAMP_SRGBTEXTURE, descriptor.handle & 1);
+				set_sampler_state(first + i, D3DSAMP_SRGBTEXTURE, descriptor.handle & 1);
 			}
 			break;
 		default:
@@ -402,10 +532,24 @@ void reshade::d3d9::device_impl::bind_index_buffer(api::resource buffer, [[maybe
 	}
 #endif
 
+	if (_tracking_state_block != nullptr)
+	{
+		state_block::state_mask mask;
+		mask.flags = state_block::state_mask::indices;
+		_tracking_state_block->on_modify(mask);
+	}
+
 	_orig->SetIndices(reinterpret_cast<IDirect3DIndexBuffer9 *>(buffer.handle));
 }
 void reshade::d3d9::device_impl::bind_vertex_buffers(uint32_t first, uint32_t count, const api::resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
+	if (_tracking_state_block != nullptr)
+	{
+		state_block::state_mask mask;
+		mask.streams = ((1u << count) - 1) << first;
+		_tracking_state_block->on_modify(mask);
+	}
+
 	for (uint32_t i = 0; i < count; ++i)
 	{
 		assert(offsets == nullptr || offsets[i] <= std::numeric_limits<UINT>::max());
@@ -427,6 +571,9 @@ void reshade::d3d9::device_impl::draw(uint32_t vertex_count, uint32_t instance_c
 	assert(instance_count == 1 && first_instance == 0);
 	assert(_current_prim_type != 0); // Need to bind a primitive topology before performing draw call
 
+	if (_state_shadowing_depth != 0)
+		flush_constants();
+
 	if (_current_stream_output != nullptr)
 	{
 		com_ptr<IDirect3DVertexDeclaration9> decl;
@@ -443,6 +590,9 @@ void reshade::d3d9::device_impl::draw_indexed(uint32_t index_count, uint32_t ins
 	assert(instance_count == 1 && first_instance == 0);
 	assert(_current_prim_type != 0);
 
+	if (_state_shadowing_depth != 0)
+		flush_constants();
+
 	// Estimate maximum vertex count based on the size of the current vertex buffer
 	// This is needed for D3D9On12, which uses the vertex count to update deferred input buffers
 	UINT vertex_count = 0;
@@ -507,6 +657,148 @@ void reshade::d3d9::device_impl::copy_buffer_to_texture(api::resource, uint64_t,
 {
 	assert(false);
 }
+bool reshade::d3d9::device_impl::draw_texture_copy(IDirect3DBaseTexture9 *src_texture, uint32_t src_subresource, const api::subresource_box *src_box, IDirect3DSurface9 *target_surface, const api::subresource_box *dst_box, D3DTEXTUREFILTERTYPE filter_type)
+{
+	if (_copy_state == nullptr)
+		return false;
+
+	const bool src_is_regular_texture = IDirect3DBaseTexture9_GetType(src_texture) == D3DRTYPE_TEXTURE;
+	const DWORD src_level_count = IDirect3DBaseTexture9_GetLevelCount(src_texture);
+	const DWORD src_level = src_subresource % src_level_count;
+
+	D3DSURFACE_DESC src_desc;
+	if (FAILED(src_is_regular_texture ?
+			IDirect3DTexture9_GetLevelDesc(static_cast<IDirect3DTexture9 *>(src_texture), src_level, &src_desc) :
+			IDirect3DCubeTexture9_GetLevelDesc(static_cast<IDirect3DCubeTexture9 *>(src_texture), src_level, &src_desc)))
+		return false;
+
+	D3DSURFACE_DESC target_desc;
+	IDirect3DSurface9_GetDesc(target_surface, &target_desc);
+
+	assert((target_desc.Usage & D3DUSAGE_RENDERTARGET) != 0);
+
+	// Capture and restore state, render targets, depth-stencil surface and viewport (which all may change next)
+	_backup_state.capture();
+
+	// Perform copy using rasterization pipeline
+	_copy_state->Apply();
+
+	_orig->SetTexture(0, src_texture);
+	_orig->SetSamplerState(0, D3DSAMP_MINFILTER, filter_type);
+	_orig->SetSamplerState(0, D3DSAMP_MAGFILTER, filter_type);
+	_orig->SetSamplerState(0, D3DSAMP_MAXMIPLEVEL, src_level);
+
+	_orig->SetRenderTarget(0, target_surface);
+	for (DWORD i = 1; i < _caps.NumSimultaneousRTs; ++i)
+		_orig->SetRenderTarget(i, nullptr);
+	_orig->SetDepthStencilSurface(nullptr);
+
+	if (dst_box != nullptr)
+	{
+		RECT dst_rect;
+		convert_box_to_rect(dst_box, dst_rect);
+
+		D3DVIEWPORT9 viewport;
+		viewport.X = dst_rect.left;
+		viewport.Y = dst_rect.top;
+		viewport.Width = dst_rect.right - dst_rect.left;
+		viewport.Height = dst_rect.bottom - dst_rect.top;
+		viewport.MinZ = 0.0f;
+		viewport.MaxZ = 1.0f;
+
+		_orig->SetViewport(&viewport);
+
+		target_desc.Width = viewport.Width;
+		target_desc.Height = viewport.Height;
+	}
+
+	// Bake half-pixel offset into vertices
+	const float half_pixel_offset[2] = {
+		-1.0f / target_desc.Width, 1.0f / target_desc.Height
+	};
+
+	// Normalized source coordinates, relative to the dimensions of the source level (not the target, which may differ when stretching)
+	float src_coords[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	if (src_box != nullptr)
+	{
+		src_coords[0] = static_cast<float>(src_box->left  ) / src_desc.Width;
+		src_coords[1] = static_cast<float>(src_box->top   ) / src_desc.Height;
+		src_coords[2] = static_cast<float>(src_box->right ) / src_desc.Width;
+		src_coords[3] = static_cast<float>(src_box->bottom) / src_desc.Height;
+	}
+
+	if (src_is_regular_texture)
+	{
+		_orig->SetFVF(D3DFVF_XYZ | D3DFVF_TEX1);
+
+		// The full-screen triangle extends twice as far as the viewport, so extrapolate texture coordinates accordingly
+		float vertices[3][5] = {
+			// x      y      z      tu                                     tv
+			{ -1.0f,  1.0f,  0.0f,  src_coords[0],                         src_coords[1] },
+			{  3.0f,  1.0f,  0.0f,  2.0f * src_coords[2] - src_coords[0],  src_coords[1] },
+			{ -1.0f, -3.0f,  0.0f,  src_coords[0],                         2.0f * src_coords[3] - src_coords[1] },
+		};
+
+		for (int v = 0; v < 3; ++v)
+		{
+			vertices[v][0] += half_pixel_offset[0];
+			vertices[v][1] += half_pixel_offset[1];
+		}
+
+		_orig->DrawPrimitiveUP(D3DPT_TRIANGLELIST, 1, vertices, sizeof(vertices[0]));
+	}
+	else
+	{
+		// See also https://docs.microsoft.com/windows/win32/direct3d9/cubic-environment-mapping
+		_orig->SetFVF(D3DFVF_XYZ | D3DFVF_TEX1 | D3DFVF_TEXCOORDSIZE3(0));
+
+		float vertices[4][6] = {
+			// x      y      z      tx             ty             tz
+			{ -1.0f,  1.0f,  0.0f,  src_coords[0], src_coords[3], 0.0f },
+			{  1.0f,  1.0f,  0.0f,  src_coords[2], src_coords[3], 0.0f },
+			{ -1.0f, -1.0f,  0.0f,  src_coords[0], src_coords[1], 0.0f },
+			{  1.0f, -1.0f,  0.0f,  src_coords[2], src_coords[1], 0.0f },
+		};
+
+		for (int v = 0; v < 4; ++v)
+		{
+			vertices[v][0] += half_pixel_offset[0];
+			vertices[v][1] += half_pixel_offset[1];
+		}
+
+		const auto face = static_cast<D3DCUBEMAP_FACES>(src_subresource / src_level_count);
+		for (int i = 0; i < 4; ++i)
+			convert_cube_uv_to_vec(face, vertices[i][3], vertices[i][4], vertices[i][3], vertices[i][4], vertices[i][5]);
+
+		_orig->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(vertices[0]));
+	}
+
+	_backup_state.apply_and_release();
+
+	return true;
+}
+com_ptr<IDirect3DSurface9> reshade::d3d9::device_impl::get_copy_staging_surface(D3DSURFACE_DESC &desc)
+{
+	desc.Pool = D3DPOOL_DEFAULT;
+	desc.Usage = D3DUSAGE_RENDERTARGET;
+
+	// Reuse the render target from the last copy to system memory, since these are usually repeated every frame with the same dimensions
+	if (_copy_staging_surface != nullptr)
+	{
+		D3DSURFACE_DESC staging_desc;
+		IDirect3DSurface9_GetDesc(_copy_staging_surface.get(), &staging_desc);
+
+		if (staging_desc.Width == desc.Width && staging_desc.Height == desc.Height && staging_desc.Format == desc.Format && staging_desc.MultiSampleType == desc.MultiSampleType)
+			return _copy_staging_surface;
+
+		_copy_staging_surface.reset();
+	}
+
+	if (FAILED(create_surface_replacement(desc, &_copy_staging_surface)))
+		return nullptr;
+
+	return _copy_staging_surface;
+}
 void reshade::d3d9::device_impl::copy_texture_region(api::resource src, uint32_t src_subresource, const api::subresource_box *src_box, api::resource dst, uint32_t dst_subresource, const api::subresource_box *dst_box, api::filter_mode filter)
 {
 	assert(src != 0 && dst != 0);
@@ -665,11 +957,8 @@ void reshade::d3d9::device_impl::copy_texture_region(api::resource src, uint32_t
 				}
 				else
 				{
-					dst_desc.Pool = D3DPOOL_DEFAULT;
-					dst_desc.Usage = D3DUSAGE_RENDERTARGET;
-					target_surface.reset();
-
-					if (FAILED(create_surface_replacement(dst_desc, &target_surface)))
+					target_surface = get_copy_staging_surface(dst_desc);
+					if (target_surface == nullptr)
 						break;
 				}
 			}
@@ -683,119 +972,9 @@ void reshade::d3d9::device_impl::copy_texture_region(api::resource src, uint32_t
 
 			assert((src_desc.Pool == D3DPOOL_DEFAULT || src_desc.Pool == D3DPOOL_MANAGED) && dst_desc.Pool == D3DPOOL_DEFAULT);
 
-			if (_copy_state == nullptr)
+			if (!draw_texture_copy(static_cast<IDirect3DBaseTexture9 *>(src_object), src_subresource, src_box, target_surface.get(), dst_box, stretch_filter_type))
 				return;
 
-			// Capture and restore state, render targets, depth-stencil surface and viewport (which all may change next)
-			_backup_state.capture();
-
-			// Perform copy using rasterization pipeline
-			_copy_state->Apply();
-
-			_orig->SetTexture(0, static_cast<IDirect3DBaseTexture9 *>(src_object));
-			_orig->SetSamplerState(0, D3DSAMP_MINFILTER, stretch_filter_type);
-			_orig->SetSamplerState(0, D3DSAMP_MAGFILTER, stretch_filter_type);
-			_orig->SetSamplerState(0, D3DSAMP_MAXMIPLEVEL, src_level);
-
-			assert((dst_desc.Usage & D3DUSAGE_RENDERTARGET) != 0);
-
-			_orig->SetRenderTarget(0, target_surface.get());
-			for (DWORD i = 1; i < _caps.NumSimultaneousRTs; ++i)
-				_orig->SetRenderTarget(i, nullptr);
-			_orig->SetDepthStencilSurface(nullptr);
-
-			if (dst_box != nullptr)
-			{
-				convert_box_to_rect(dst_box, dst_rect);
-
-				D3DVIEWPORT9 viewport;
-				viewport.X = dst_rect.left;
-				viewport.Y = dst_rect.top;
-				viewport.Width = dst_rect.right - dst_rect.left;
-				viewport.Height = dst_rect.bottom - dst_rect.top;
-				viewport.MinZ = 0.0f;
-				viewport.MaxZ = 1.0f;
-
-				_orig->SetViewport(&viewport);
-
-				dst_desc.Width = viewport.Width;
-				dst_desc.Height = viewport.Height;
-			}
-
-			// Bake half-pixel offset into vertices
-			const float half_pixel_offset[2] = {
-				-1.0f / dst_desc.Width, 1.0f / dst_desc.Height
-			};
-
-			if (src_is_regular_texture)
-			{
-				_orig->SetFVF(D3DFVF_XYZ | D3DFVF_TEX1);
-
-				float vertices[3][5] = {
-					// x      y      z      tu     tv
-					{ -1.0f,  1.0f,  0.0f,  0.0f,  0.0f },
-					{  3.0f,  1.0f,  0.0f,  2.0f,  0.0f },
-					{ -1.0f, -3.0f,  0.0f,  0.0f,  2.0f },
-				};
-
-				for (int v = 0; v < 3; ++v)
-				{
-					vertices[v][0] += half_pixel_offset[0];
-					vertices[v][1] += half_pixel_offset[1];
-				}
-
-				if (src_box != nullptr)
-				{
-					vertices[0][3] = static_cast<float>(src_box->left  ) * 2.0f / dst_desc.Width;
-					vertices[0][4] = static_cast<float>(src_box->top   ) * 2.0f / dst_desc.Height;
-					vertices[1][3] = static_cast<float>(src_box->right ) * 2.0f / dst_desc.Width;
-					vertices[1][4] = static_cast<float>(src_box->top   ) * 2.0f / dst_desc.Height;
-					vertices[2][3] = static_cast<float>(src_box->left  ) * 2.0f / dst_desc.Width;
-					vertices[2][4] = static_cast<float>(src_box->bottom) * 2.0f / dst_desc.Height;
-				}
-
-				_orig->DrawPrimitiveUP(D3DPT_TRIANGLELIST, 1, vertices, sizeof(vertices[0]));
-			}
-			else
-			{
-				// See also https://docs.microsoft.com/windows/win32/direct3d9/cubic-environment-mapping
-				_orig->SetFVF(D3DFVF_XYZ | D3DFVF_TEX1 | D3DFVF_TEXCOORDSIZE3(0));
-
-				float vertices[4][6] = {
-					// x      y      z      tx     ty     tz
-					{ -1.0f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f },
-					{  1.0f,  1.0f,  0.0f,  1.0f,  1.0f,  0.0f },
-					{ -1.0f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f },
-					{  1.0f, -1.0f,  0.0f,  1.0f,  0.0f,  0.0f },
-				};
-
-				for (int v = 0; v < 4; ++v)
-				{
-					vertices[v][0] += half_pixel_offset[0];
-					vertices[v][1] += half_pixel_offset[1];
-				}
-
-				if (src_box != nullptr)
-				{
-					vertices[0][3] = static_cast<float>(src_box->left  ) / dst_desc.Width;
-					vertices[0][4] = static_cast<float>(src_box->bottom) / dst_desc.Height;
-					vertices[1][3] = static_cast<float>(src_box->right ) / dst_desc.Width;
-					vertices[1][4] = static_cast<float>(src_box->bottom) / dst_desc.Height;
-					vertices[2][3] = static_cast<float>(src_box->left  ) / dst_desc.Width;
-					vertices[2][4] = static_cast<float>(src_box->top   ) / dst_desc.Height;
-					vertices[3][3] = static_cast<float>(src_box->right ) / dst_desc.Width;
-					vertices[3][4] = static_cast<float>(src_box->top   ) / dst_desc.Height;
-				}
-
-				const auto face = static_cast<D3DCUBEMAP_FACES>(src_subresource / src_level_count);
-				for (int i = 0; i < 4; ++i)
-					convert_cube_uv_to_vec(face, vertices[i][3], vertices[i][4], vertices[i][3], vertices[i][4], vertices[i][5]);
-
-				_orig->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(vertices[0]));
-			}
-
-			_backup_state.apply_and_release();
-
 			if (target_surface != dst_surface)
 			{
 				assert(dst_box == nullptr);
@@ -839,11 +1018,8 @@ void reshade::d3d9::device_impl::copy_texture_region(api::resource src, uint32_t
 				}
 				else
 				{
-					dst_desc.Pool = D3DPOOL_DEFAULT;
-					dst_desc.Usage = D3DUSAGE_RENDERTARGET;
-					target_surface.reset();
-
-					if (FAILED(create_surface_replacement(dst_desc, &target_surface)))
+					target_surface = get_copy_staging_surface(dst_desc);
+					if (target_surface == nullptr)
 						break;
 				}
 			}
@@ -855,11 +1031,20 @@ void reshade::d3d9::device_impl::copy_texture_region(api::resource src, uint32_t
 				return;
 			}
 
-			assert(src_desc.Pool == D3DPOOL_DEFAULT && dst_desc.Pool == D3DPOOL_DEFAULT);
+			assert((src_desc.Pool == D3DPOOL_DEFAULT || src_desc.Pool == D3DPOOL_MANAGED) && dst_desc.Pool == D3DPOOL_DEFAULT);
 
-			_orig->StretchRect(
-				src_surface.get(), convert_box_to_rect(src_box, src_rect),
-				target_surface.get(), convert_box_to_rect(dst_box, dst_rect), stretch_filter_type);
+			// 'StretchRect' cannot read from textures that are not render targets, or convert between arbitrary formats, so draw the source texture instead if the target can be rendered to
+			if ((dst_desc.Usage & D3DUSAGE_RENDERTARGET) != 0 && (src_desc.Pool != D3DPOOL_DEFAULT || (src_desc.Usage & D3DUSAGE_RENDERTARGET) == 0 || src_desc.Format != dst_desc.Format))
+			{
+				if (!draw_texture_copy(static_cast<IDirect3DBaseTexture9 *>(src_object), src_subresource, src_box, target_surface.get(), dst_box, stretch_filter_type))
+					return;
+			}
+			else
+			{
+				_orig->StretchRect(
+					src_surface.get(), convert_box_to_rect(src_box, src_rect),
+					target_surface.get(), convert_box_to_rect(dst_box, dst_rect), stretch_filter_type);
+			}
 
 			if (target_surface != dst_surface)
 			{
@@ -1014,3 +1199,111 @@ void reshade::d3d9::device_impl::insert_debug_marker(const char *label, const fl
 
 	D3DPERF_SetMarker(color != nullptr ? D3DCOLOR_COLORVALUE(color[0], color[1], color[2], color[3]) : 0, label_wide.c_str());
 }
+
+void reshade::d3d9::device_impl::begin_state_shadowing()
+{
+	if (_state_shadowing_depth++ != 0)
+		return;
+
+	// The application may have changed any state since shadowing last ended, so nothing is known about the current device values
+	for (constant_batch *const batch : { &_vs_constants, &_ps_constants })
+	{
+		batch->pending_first = constant_batch::MAX_REGISTERS;
+		batch->pending_last = 0;
+		std::memset(batch->uploaded_mask, 0, sizeof(batch->uploaded_mask));
+	}
+
+	for (sampler_shadow &shadow : _sampler_shadows)
+		shadow.key = 0, shadow.valid_mask = 0;
+
+	_render_target_shadow_mask = 0;
+}
+void reshade::d3d9::device_impl::end_state_shadowing()
+{
+	if (_state_shadowing_depth == 0)
+		return; // State was applied without a matching capture
+
+	// Applying a state block restores constants and sampler states as well, so forget about the shadowed values whenever one is applied
+	for (constant_batch *const batch : { &_vs_constants, &_ps_constants })
+		std::memset(batch->uploaded_mask, 0, sizeof(batch->uploaded_mask));
+
+	for (sampler_shadow &shadow : _sampler_shadows)
+		shadow.key = 0, shadow.valid_mask = 0;
+
+	_render_target_shadow_mask = 0;
+
+	if (--_state_shadowing_depth != 0)
+		return;
+
+	for (constant_batch *const batch : { &_vs_constants, &_ps_constants })
+	{
+		batch->pending_first = constant_batch::MAX_REGISTERS;
+		batch->pending_last = 0;
+	}
+}
+
+void reshade::d3d9::device_impl::flush_constants()
+{
+	for (constant_batch *const batch : { &_vs_constants, &_ps_constants })
+	{
+		UINT first = batch->pending_first;
+		UINT last = batch->pending_last;
+		if (first >= last)
+			continue;
+
+		batch->pending_first = constant_batch::MAX_REGISTERS;
+		batch->pending_last = 0;
+
+		const auto is_uploaded = [batch](UINT i) {
+			return (batch->uploaded_mask[i / 32] & (1u << (i % 32))) != 0 && std::memcmp(batch->pending + i * 4, batch->uploaded + i * 4, 4 * sizeof(float)) == 0;
+		};
+
+		// Skip registers at either end of the range that already hold the same values on the device
+		while (first < last && is_uploaded(first))
+			++first;
+		while (last > first && is_uploaded(last - 1))
+			--last;
+		if (first == last)
+			continue;
+
+		if (batch == &_vs_constants)
+			_orig->SetVertexShaderConstantF(first, batch->pending + first * 4, last - first);
+		else
+			_orig->SetPixelShaderConstantF(first, batch->pending + first * 4, last - first);
+
+		std::memcpy(batch->uploaded + first * 4, batch->pending + first * 4, (last - first) * 4 * sizeof(float));
+		for (UINT i = first; i < last; ++i)
+			batch->uploaded_mask[i / 32] |= 1u << (i % 32);
+	}
+}
+
+void reshade::d3d9::device_impl::bind_sampler(DWORD sampler, const sampler_impl *sampler_instance)
+{
+	sampler_shadow *const shadow = _state_shadowing_depth != 0 ? &_sampler_shadows[sampler >= D3DVERTEXTEXTURESAMPLER0 ? 16 + (sampler - D3DVERTEXTEXTURESAMPLER0) : sampler] : nullptr;
+
+	// Skip all states if the same sampler configuration is still bound
+	constexpr uint32_t sampler_state_mask = ((1u << (D3DSAMP_MAXANISOTROPY + 1)) - 1) & ~1u;
+	if (shadow != nullptr && sampler_instance->key != 0 && shadow->key == sampler_instance->key &&
+		(shadow->valid_mask & sampler_state_mask) == sampler_state_mask && shadow->state[D3DSAMP_BORDERCOLOR] == sampler_instance->state[D3DSAMP_BORDERCOLOR])
+		return;
+
+	for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_MAXANISOTROPY; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
+		set_sampler_state(sampler, state, sampler_instance->state[state]);
+
+	if (shadow != nullptr)
+		shadow->key = sampler_instance->key;
+}
+void reshade::d3d9::device_impl::set_sampler_state(DWORD sampler, D3DSAMPLERSTATETYPE state, DWORD value)
+{
+	if (_state_shadowing_depth != 0)
+	{
+		sampler_shadow &shadow = _sampler_shadows[sampler >= D3DVERTEXTEXTURESAMPLER0 ? 16 + (sampler - D3DVERTEXTEXTURESAMPLER0) : sampler];
+		if ((shadow.valid_mask & (1u << state)) != 0 && shadow.state[state] == value)
+			return;
+
+		shadow.state[state] = value;
+		shadow.valid_mask |= 1u << state;
+	}
+
+	_orig->SetSamplerState(sampler, state, value);
+}
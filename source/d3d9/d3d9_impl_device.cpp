@@ -8,7 +8,7 @@
 #include "d3d9_resource_call_vtable.inl"
 #include "dll_log.hpp"
 #include <cstring> // std::memcpy
-#include <algorithm> // std::copy_n, std::min
+#include <algorithm> // std::copy_n, std::max, std::min
 
 const RECT *convert_box_to_rect(const reshade::api::subresource_box *box, RECT &rect)
 {
@@ -133,8 +133,10 @@ void reshade::d3d9::device_impl::on_init()
 void reshade::d3d9::device_impl::on_reset()
 {
 	_copy_state.reset();
+	_copy_staging_surface.reset();
 	_default_input_stream.reset();
 	_default_input_layout.reset();
+	_shader_cache.clear();
 }
 
 bool reshade::d3d9::device_impl::get_property(api::device_properties property, void *data) const
@@ -254,6 +256,22 @@ bool reshade::d3d9::device_impl::create_sampler(const api::sampler_desc &desc, a
 	const auto impl = new sampler_impl();
 	convert_sampler_desc(desc, impl->state);
 
+	impl->key = 0;
+	if (impl->state[D3DSAMP_MAXANISOTROPY] < (1 << 5) && impl->state[D3DSAMP_MAXMIPLEVEL] < (1 << 8))
+	{
+		impl->key =
+			(1ull << 63) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MIPMAPLODBIAS]) << 31) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MAXMIPLEVEL]) << 23) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MAXANISOTROPY]) << 18) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MIPFILTER] & 0x7) << 15) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MINFILTER] & 0x7) << 12) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_MAGFILTER] & 0x7) << 9) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_ADDRESSW] & 0x7) << 6) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_ADDRESSV] & 0x7) << 3) |
+			(static_cast<uint64_t>(impl->state[D3DSAMP_ADDRESSU] & 0x7));
+	}
+
 	*out_sampler = { reinterpret_cast<uintptr_t>(impl) };
 	return true;
 }
@@ -1375,9 +1393,17 @@ bool reshade::d3d9::device_impl::create_vertex_shader(const api::shader_desc &de
 
 	assert(desc.spec_constants == 0);
 
+	if (IUnknown *const cached_object = find_cached_shader(desc))
+	{
+		*out_pipeline = to_handle(static_cast<IDirect3DVertexShader9 *>(cached_object));
+		return true;
+	}
+
 	if (com_ptr<IDirect3DVertexShader9> object;
 		SUCCEEDED(_orig->CreateVertexShader(static_cast<const DWORD *>(desc.code), &object)))
 	{
+		add_cached_shader(desc, object.get());
+
 		*out_pipeline = to_handle(object.release());
 		return true;
 	}
@@ -1393,9 +1419,17 @@ bool reshade::d3d9::device_impl::create_pixel_shader(const api::shader_desc &des
 
 	assert(desc.spec_constants == 0);
 
+	if (IUnknown *const cached_object = find_cached_shader(desc))
+	{
+		*out_pipeline = to_handle(static_cast<IDirect3DPixelShader9 *>(cached_object));
+		return true;
+	}
+
 	if (com_ptr<IDirect3DPixelShader9> object;
 		SUCCEEDED(_orig->CreatePixelShader(static_cast<const DWORD *>(desc.code), &object)))
 	{
+		add_cached_shader(desc, object.get());
+
 		*out_pipeline = to_handle(object.release());
 		return true;
 	}
@@ -1406,6 +1440,42 @@ bool reshade::d3d9::device_impl::create_pixel_shader(const api::shader_desc &des
 	}
 }
 
+IUnknown *reshade::d3d9::device_impl::find_cached_shader(const api::shader_desc &desc)
+{
+	// Bytecode without a size cannot be compared
+	if (desc.code_size == 0)
+		return nullptr;
+
+	const auto it = _shader_cache.find(std::string(static_cast<const char *>(desc.code), desc.code_size));
+	if (it == _shader_cache.end())
+		return nullptr;
+
+	it->second->AddRef();
+	return it->second.get();
+}
+void reshade::d3d9::device_impl::add_cached_shader(const api::shader_desc &desc, IUnknown *shader)
+{
+	if (desc.code_size == 0)
+		return;
+
+	// Drop shaders that are only still referenced by the cache once it grew by a good amount, so that those of destroyed effects do not accumulate
+	if (_shader_cache.size() >= _shader_cache_prune_size)
+	{
+		for (auto it = _shader_cache.begin(); it != _shader_cache.end();)
+		{
+			it->second->AddRef();
+			if (it->second->Release() == 1)
+				it = _shader_cache.erase(it);
+			else
+				++it;
+		}
+
+		_shader_cache_prune_size = std::max(_shader_cache.size() * 2, static_cast<size_t>(64));
+	}
+
+	_shader_cache.emplace(std::string(static_cast<const char *>(desc.code), desc.code_size), shader);
+}
+
 bool reshade::d3d9::device_impl::create_pipeline(api::pipeline_layout, uint32_t subobject_count, const api::pipeline_subobject *subobjects, api::pipeline *out_pipeline)
 {
 	com_ptr<IDirect3DVertexShader9> vertex_shader;
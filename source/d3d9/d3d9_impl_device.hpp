@@ -7,11 +7,17 @@
 
 #include "d3d9_impl_state_block.hpp"
 #include "reshade_api_object_impl.hpp"
+#include <string>
+#include <unordered_map>
 
 namespace reshade::d3d9
 {
+	struct sampler_impl;
+
 	class device_impl : public api::api_object_impl<IDirect3DDevice9 *, api::device, api::command_queue, api::command_list>
 	{
+		friend class state_block;
+
 	public:
 		explicit device_impl(IDirect3DDevice9 *device);
 		~device_impl();
@@ -151,6 +157,16 @@ namespace reshade::d3d9
 		void end_debug_event() final;
 		void insert_debug_marker(const char *label, const float color[4]) final;
 
+		/// <summary>
+		/// Starts shadowing state set through this command list, to batch floating-point shader constant uploads until the next draw call and skip redundant sampler state and render target changes.
+		/// This is only safe while the application cannot modify device state (e.g. between capturing and applying state around effect rendering).
+		/// </summary>
+		void begin_state_shadowing();
+		/// <summary>
+		/// Stops shadowing state again. Pending constant uploads are discarded, since the device state is restored afterwards.
+		/// </summary>
+		void end_state_shadowing();
+
 	protected:
 		void on_init();
 		void on_reset();
@@ -166,9 +182,70 @@ namespace reshade::d3d9
 		IDirect3DVertexBuffer9 *_current_stream_output = nullptr;
 
 	private:
+		struct constant_batch
+		{
+			static constexpr UINT MAX_REGISTERS = 256;
+
+			// Values that were pushed, but not uploaded to the device yet
+			float pending[MAX_REGISTERS * 4];
+			UINT pending_first = MAX_REGISTERS;
+			UINT pending_last = 0;
+			// Values that were last uploaded to the device, only for registers that have their bit set in 'uploaded_mask'
+			float uploaded[MAX_REGISTERS * 4];
+			uint32_t uploaded_mask[MAX_REGISTERS / 32] = {};
+		};
+
+		struct sampler_shadow
+		{
+			// Packed key of the sampler object that was last bound, or zero if unknown
+			uint64_t key = 0;
+			DWORD state[D3DSAMP_DMAPOFFSET + 1];
+			// Bit mask of sampler states in 'state' that are known to match the device
+			uint32_t valid_mask = 0;
+		};
+
+		/// <summary>
+		/// Copies a texture subresource to the specified render target surface by drawing it, which works for any combination of formats and with stretching.
+		/// </summary>
+		bool draw_texture_copy(IDirect3DBaseTexture9 *src_texture, uint32_t src_subresource, const api::subresource_box *src_box, IDirect3DSurface9 *target_surface, const api::subresource_box *dst_box, D3DTEXTUREFILTERTYPE filter_type);
+		/// <summary>
+		/// Gets a render target surface matching the specified system memory surface description, to draw to before reading back the result.
+		/// </summary>
+		com_ptr<IDirect3DSurface9> get_copy_staging_surface(D3DSURFACE_DESC &desc);
+
+		/// <summary>
+		/// Gets a shader object that was created from identical bytecode before, with an additional reference added, or <see langword="nullptr"/> if there is none.
+		/// </summary>
+		IUnknown *find_cached_shader(const api::shader_desc &desc);
+		/// <summary>
+		/// Remembers a shader object created from the specified bytecode, so that later requests for the same bytecode can share it.
+		/// </summary>
+		void add_cached_shader(const api::shader_desc &desc, IUnknown *shader);
+
+		void flush_constants();
+		void bind_sampler(DWORD sampler, const sampler_impl *sampler_instance);
+		void set_sampler_state(DWORD sampler, D3DSAMPLERSTATETYPE state, DWORD value);
+		void set_render_target(DWORD index, IDirect3DSurface9 *surface);
+
+		uint32_t _state_shadowing_depth = 0;
+		constant_batch _vs_constants;
+		constant_batch _ps_constants;
+		// Pixel shader samplers 0-15, followed by the four vertex shader samplers
+		sampler_shadow _sampler_shadows[16 + 4];
+		// Render targets, followed by the depth-stencil surface, that were last bound while shadowing, each only valid if its bit is set in 'render_target_shadow_mask'
+		IDirect3DSurface9 *_render_target_shadows[D3D_MAX_SIMULTANEOUS_RENDERTARGETS + 1] = {};
+		uint32_t _render_target_shadow_mask = 0;
+
 		state_block _backup_state;
+		// State block that is currently capturing, which has to be notified before any state is modified
+		state_block *_tracking_state_block = nullptr;
 		com_ptr<IDirect3DStateBlock9> _copy_state;
+		com_ptr<IDirect3DSurface9> _copy_staging_surface;
 		com_ptr<IDirect3DVertexBuffer9> _default_input_stream;
 		com_ptr<IDirect3DVertexDeclaration9> _default_input_layout;
+		// Vertex and pixel shader objects by their bytecode (which cannot collide between the two, since it starts with the shader type and version)
+		// Effects often share functions like the default fullscreen triangle vertex shader, which then only exist once on the device
+		std::unordered_map<std::string, com_ptr<IUnknown>> _shader_cache;
+		size_t _shader_cache_prune_size = 64;
 	};
 }
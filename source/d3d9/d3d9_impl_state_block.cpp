@@ -3,10 +3,42 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include "d3d9_impl_device.hpp"
 #include "d3d9_impl_state_block.hpp"
 
-reshade::d3d9::state_block::state_block(IDirect3DDevice9 *device) :
-	_device(device)
+bool reshade::d3d9::state_block::state_mask::subtract(const state_mask &other)
+{
+	uint32_t any = 0;
+
+	for (size_t i = 0; i < ARRAYSIZE(render_states); ++i)
+		any |= render_states[i] &= ~other.render_states[i];
+	any |= samplers &= ~other.samplers;
+	any |= streams &= ~other.streams;
+	any |= flags &= ~other.flags;
+
+	if (vertex_shader_constant_f_count <= other.vertex_shader_constant_f_count)
+		vertex_shader_constant_f_count = 0;
+	if (pixel_shader_constant_f_count <= other.pixel_shader_constant_f_count)
+		pixel_shader_constant_f_count = 0;
+
+	return any != 0 || vertex_shader_constant_f_count != 0 || pixel_shader_constant_f_count != 0;
+}
+void reshade::d3d9::state_block::state_mask::merge(const state_mask &other)
+{
+	for (size_t i = 0; i < ARRAYSIZE(render_states); ++i)
+		render_states[i] |= other.render_states[i];
+	samplers |= other.samplers;
+	streams |= other.streams;
+	flags |= other.flags;
+
+	if (other.vertex_shader_constant_f_count > vertex_shader_constant_f_count)
+		vertex_shader_constant_f_count = other.vertex_shader_constant_f_count;
+	if (other.pixel_shader_constant_f_count > pixel_shader_constant_f_count)
+		pixel_shader_constant_f_count = other.pixel_shader_constant_f_count;
+}
+
+reshade::d3d9::state_block::state_block(IDirect3DDevice9 *device, device_impl *device_impl) :
+	_device(device), _device_impl(device_impl)
 {
 #ifdef RESHADE_TEST_APPLICATION
 	// Avoid errors from the D3D9 debug runtime because the other slots return D3DERR_NOTFOUND with the test application
@@ -25,16 +57,31 @@ reshade::d3d9::state_block::state_block(IDirect3DDevice9 *device) :
 }
 reshade::d3d9::state_block::~state_block()
 {
+	if (_device_impl != nullptr && _device_impl->_tracking_state_block == this)
+		_device_impl->_tracking_state_block = nullptr;
 }
 
 void reshade::d3d9::state_block::capture()
 {
-	assert(_state_block == nullptr);
+	if (_device_impl != nullptr)
+	{
+		assert(_state_block == nullptr && _additional_state_blocks.empty());
 
-	if (SUCCEEDED(_device->CreateStateBlock(D3DSBT_ALL, &_state_block)))
-		_state_block->Capture();
+		// Only capture the states that were modified during previous captures, states that are modified for the first time are captured individually in 'on_modify'
+		if (record(_captured_mask, _state_block))
+			_state_block->Capture();
+
+		_device_impl->_tracking_state_block = this;
+	}
 	else
-		assert(false);
+	{
+		assert(_state_block == nullptr);
+
+		if (SUCCEEDED(_device->CreateStateBlock(D3DSBT_ALL, &_state_block)))
+			_state_block->Capture();
+		else
+			assert(false);
+	}
 
 	_device->GetViewport(&_viewport);
 
@@ -53,6 +100,19 @@ void reshade::d3d9::state_block::capture()
 }
 void reshade::d3d9::state_block::apply_and_release()
 {
+	if (_device_impl != nullptr)
+	{
+		_device_impl->_tracking_state_block = nullptr;
+
+		for (const com_ptr<IDirect3DStateBlock9> &state_block : _additional_state_blocks)
+			state_block->Apply();
+		_additional_state_blocks.clear();
+
+		// Include the states that were modified for the first time in the next capture, so that they are captured in one go from then on
+		_captured_mask.merge(_additional_mask);
+		_additional_mask = {};
+	}
+
 	if (_state_block != nullptr)
 		_state_block->Apply();
 
@@ -81,3 +141,90 @@ void reshade::d3d9::state_block::apply_and_release()
 		render_target.reset();
 	_depth_stencil.reset();
 }
+
+void reshade::d3d9::state_block::on_modify(const state_mask &mask)
+{
+	state_mask missing_mask = mask;
+	if (!missing_mask.subtract(_captured_mask) || !missing_mask.subtract(_additional_mask))
+		return;
+
+	// Capture the application state before it is overwritten
+	if (com_ptr<IDirect3DStateBlock9> state_block;
+		record(missing_mask, state_block))
+	{
+		state_block->Capture();
+		_additional_state_blocks.push_back(std::move(state_block));
+	}
+
+	_additional_mask.merge(missing_mask);
+}
+
+bool reshade::d3d9::state_block::record(const state_mask &mask, com_ptr<IDirect3DStateBlock9> &out_state_block)
+{
+	// States set while recording a state block are not applied to the device, so the values set here do not matter, since they are overwritten by 'IDirect3DStateBlock9::Capture' anyway
+	if (FAILED(_device->BeginStateBlock()))
+		return false;
+
+	for (DWORD state = 0; state < ARRAYSIZE(mask.render_states) * 32; ++state)
+	{
+		if (mask.render_states[state / 32] & (1u << (state % 32)))
+			_device->SetRenderState(static_cast<D3DRENDERSTATETYPE>(state), 0);
+	}
+
+	for (DWORD i = 0; i < 20; ++i)
+	{
+		if ((mask.samplers & (1u << i)) == 0)
+			continue;
+
+		const DWORD sampler = i < 16 ? i : D3DVERTEXTEXTURESAMPLER0 + (i - 16);
+
+		_device->SetTexture(sampler, nullptr);
+		for (D3DSAMPLERSTATETYPE state = D3DSAMP_ADDRESSU; state <= D3DSAMP_DMAPOFFSET; state = static_cast<D3DSAMPLERSTATETYPE>(state + 1))
+			_device->SetSamplerState(sampler, state, 0);
+	}
+
+	for (UINT i = 0; i < 16; ++i)
+	{
+		if (mask.streams & (1u << i))
+		{
+			_device->SetStreamSource(i, nullptr, 0, 0);
+			_device->SetStreamSourceFreq(i, 1);
+		}
+	}
+
+	if (mask.flags & state_mask::vertex_shader)
+		_device->SetVertexShader(nullptr);
+	if (mask.flags & state_mask::pixel_shader)
+		_device->SetPixelShader(nullptr);
+	if (mask.flags & state_mask::vertex_declaration)
+		_device->SetVertexDeclaration(nullptr);
+	if (mask.flags & state_mask::indices)
+		_device->SetIndices(nullptr);
+	if (mask.flags & state_mask::scissor_rect)
+	{
+		const RECT rect = {};
+		_device->SetScissorRect(&rect);
+	}
+
+	const int zero_int[16 * 4] = {};
+	const BOOL zero_bool[16] = {};
+	if (mask.flags & state_mask::vertex_shader_constant_i)
+		_device->SetVertexShaderConstantI(0, zero_int, 16);
+	if (mask.flags & state_mask::vertex_shader_constant_b)
+		_device->SetVertexShaderConstantB(0, zero_bool, 16);
+	if (mask.flags & state_mask::pixel_shader_constant_i)
+		_device->SetPixelShaderConstantI(0, zero_int, 16);
+	if (mask.flags & state_mask::pixel_shader_constant_b)
+		_device->SetPixelShaderConstantB(0, zero_bool, 16);
+
+	if (mask.vertex_shader_constant_f_count != 0 || mask.pixel_shader_constant_f_count != 0)
+	{
+		const std::vector<float> zero_float((mask.vertex_shader_constant_f_count > mask.pixel_shader_constant_f_count ? mask.vertex_shader_constant_f_count : mask.pixel_shader_constant_f_count) * 4);
+		if (mask.vertex_shader_constant_f_count != 0)
+			_device->SetVertexShaderConstantF(0, zero_float.data(), mask.vertex_shader_constant_f_count);
+		if (mask.pixel_shader_constant_f_count != 0)
+			_device->SetPixelShaderConstantF(0, zero_float.data(), mask.pixel_shader_constant_f_count);
+	}
+
+	return SUCCEEDED(_device->EndStateBlock(&out_state_block));
+}
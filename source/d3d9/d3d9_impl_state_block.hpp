@@ -6,20 +6,68 @@
 #pragma once
 
 #include <d3d9.h>
+#include <vector>
 #include "com_ptr.hpp"
 
 namespace reshade::d3d9
 {
+	class device_impl;
+
 	class state_block
 	{
 	public:
-		explicit state_block(IDirect3DDevice9 *device);
+		/// <summary>
+		/// Set of device states, used to track which states were modified during a capture.
+		/// </summary>
+		struct state_mask
+		{
+			enum : uint32_t
+			{
+				vertex_shader = 1 << 0,
+				pixel_shader = 1 << 1,
+				vertex_declaration = 1 << 2,
+				indices = 1 << 3,
+				scissor_rect = 1 << 4,
+				vertex_shader_constant_i = 1 << 5,
+				vertex_shader_constant_b = 1 << 6,
+				pixel_shader_constant_i = 1 << 7,
+				pixel_shader_constant_b = 1 << 8,
+			};
+
+			uint32_t render_states[8] = {}; // Bit mask of 'D3DRENDERSTATETYPE' values
+			uint32_t samplers = 0; // Bits 0-15 are the pixel shader samplers, bits 16-19 the vertex shader samplers
+			uint32_t streams = 0;
+			uint32_t flags = 0;
+			UINT vertex_shader_constant_f_count = 0;
+			UINT pixel_shader_constant_f_count = 0;
+
+			void add_render_state(D3DRENDERSTATETYPE state) { render_states[state / 32] |= 1u << (state % 32); }
+			void add_sampler(DWORD sampler) { samplers |= 1u << (sampler >= D3DVERTEXTEXTURESAMPLER0 ? 16 + (sampler - D3DVERTEXTEXTURESAMPLER0) : sampler); }
+
+			/// <summary>
+			/// Removes all states from this mask that are also part of the <paramref name="other"/> mask.
+			/// </summary>
+			/// <returns><see langword="true"/> if any states are left, <see langword="false"/> otherwise.</returns>
+			bool subtract(const state_mask &other);
+			void merge(const state_mask &other);
+		};
+
+		/// <param name="device">Native device to capture state from.</param>
+		/// <param name="device_impl">Device that reports which states ReShade modifies between <see cref="capture"/> and <see cref="apply_and_release"/>, or <see langword="nullptr"/> to capture the entire device state.</param>
+		explicit state_block(IDirect3DDevice9 *device, device_impl *device_impl = nullptr);
 		~state_block();
 
 		void capture();
 		void apply_and_release();
 
+		/// <summary>
+		/// Called by the device before it modifies any of the specified states, so that states that were not captured yet can be captured before they are overwritten.
+		/// </summary>
+		void on_modify(const state_mask &mask);
+
 	private:
+		bool record(const state_mask &mask, com_ptr<IDirect3DStateBlock9> &out_state_block);
+
 		com_ptr<IDirect3DDevice9> _device;
 		com_ptr<IDirect3DStateBlock9> _state_block;
 		UINT _num_simultaneous_rts;
@@ -29,5 +77,13 @@ namespace reshade::d3d9
 		DWORD _srgb_write = FALSE;
 		DWORD _srgb_texture = FALSE;
 		DWORD _vertex_processing = 0;
+
+		// State used when only tracking modified states instead of capturing the entire device state
+		device_impl *const _device_impl;
+		// States captured by '_state_block', which grows to include all states that were modified during previous captures
+		state_mask _captured_mask;
+		// States modified since the last capture that were not part of '_captured_mask', which are captured individually as they are encountered
+		state_mask _additional_mask;
+		std::vector<com_ptr<IDirect3DStateBlock9>> _additional_state_blocks;
 	};
 }
@@ -19,6 +19,8 @@ namespace reshade::d3d9
 	struct sampler_impl
 	{
 		DWORD state[11];
+		// All states except for the border color packed into a single value, to quickly compare samplers, or zero if they do not fit
+		uint64_t key;
 	};
 
 	struct pipeline_impl
@@ -6,8 +6,10 @@
 #include "d3d9_device.hpp"
 #include "d3d9_swapchain.hpp"
 #include "dll_log.hpp" // Include late to get 'hr_to_string' helper function
+#include "ini_file.hpp"
 #include "addon_manager.hpp"
 #include "runtime_manager.hpp"
+#include <chrono>
 #include <algorithm> // std::find
 
 bool Direct3DSwapChain9::is_presenting_entire_surface(const RECT *source_rect, HWND hwnd)
@@ -134,6 +136,9 @@ HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::Present(const RECT *pSourceRect, c
 
 	handle_device_loss(hr);
 
+	if ((dwFlags & D3DPRESENT_DONOTFLIP) == 0)
+		limit_frame_latency(hr);
+
 	return hr;
 }
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetFrontBufferData(IDirect3DSurface9 *pDestSurface)
@@ -142,6 +147,14 @@ HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetFrontBufferData(IDirect3DSurfac
 }
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetBackBuffer(UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9 **ppBackBuffer)
 {
+	// Hand out the proxy render target instead of the actual back buffer, which is only written to when the proxy is resolved during present
+	if (iBackBuffer == 0 && ppBackBuffer != nullptr && this == _device->_implicit_swapchain && _device->_proxy_back_buffer != nullptr)
+	{
+		_device->_proxy_back_buffer->AddRef();
+		*ppBackBuffer = _device->_proxy_back_buffer.get();
+		return D3D_OK;
+	}
+
 	return _orig->GetBackBuffer(iBackBuffer, Type, ppBackBuffer);
 }
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetRasterStatus(D3DRASTER_STATUS *pRasterStatus)
@@ -164,7 +177,18 @@ HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetDevice(IDirect3DDevice9 **ppDev
 }
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetPresentParameters(D3DPRESENT_PARAMETERS *pPresentationParameters)
 {
-	return _orig->GetPresentParameters(pPresentationParameters);
+	const HRESULT hr = _orig->GetPresentParameters(pPresentationParameters);
+	if (SUCCEEDED(hr) && this == _device->_implicit_swapchain && _device->_proxy_present_params.MultiSampleType != D3DMULTISAMPLE_NONE)
+	{
+		// Report the multisampling and auto depth-stencil settings the application requested, rather than the ones of the actual back buffer behind the proxy
+		pPresentationParameters->MultiSampleType = _device->_proxy_present_params.MultiSampleType;
+		pPresentationParameters->MultiSampleQuality = _device->_proxy_present_params.MultiSampleQuality;
+		pPresentationParameters->EnableAutoDepthStencil = _device->_proxy_present_params.EnableAutoDepthStencil;
+		pPresentationParameters->AutoDepthStencilFormat = _device->_proxy_present_params.AutoDepthStencilFormat;
+		pPresentationParameters->Flags = _device->_proxy_present_params.Flags;
+	}
+
+	return hr;
 }
 
 HRESULT STDMETHODCALLTYPE Direct3DSwapChain9::GetLastPresentCount(UINT *pLastPresentCount)
@@ -199,6 +223,12 @@ void Direct3DSwapChain9::on_init(bool resize)
 
 	reshade::init_effect_runtime(this);
 
+	_max_queued_frames = 0;
+	reshade::global_config().get("APP", "D3D9MaxQueuedFrames", _max_queued_frames);
+	if (_max_queued_frames > MAX_QUEUED_FRAMES_LIMIT)
+		_max_queued_frames = MAX_QUEUED_FRAMES_LIMIT;
+	_frame_latency_index = 0;
+
 	_is_initialized = true;
 }
 void Direct3DSwapChain9::on_reset(bool resize)
@@ -217,6 +247,10 @@ void Direct3DSwapChain9::on_reset(bool resize)
 
 	_back_buffer.reset();
 
+	// Queries have to be recreated after a device reset
+	for (com_ptr<IDirect3DQuery9> &query : _frame_latency_queries)
+		query.reset();
+
 	_is_initialized = false;
 }
 
@@ -227,22 +261,64 @@ void Direct3DSwapChain9::on_nfs_present(
 	HWND hDestWindowOverride,
 	const RGNDATA *pDirtyRegion)
 {
-	// Custom logic for rendering ReShade effects before FE
-	// reshade::log::message(reshade::log::level::debug, "Rendering ReShade effects before FE.");
+	UNREFERENCED_PARAMETER(pSourceRect);
+	UNREFERENCED_PARAMETER(pDestRect);
+	UNREFERENCED_PARAMETER(hDestWindowOverride);
+	UNREFERENCED_PARAMETER(pDirtyRegion);
+
+	// Render effects before the game draws its frontend on top, and leave only the overlay to the actual present
+	com_ptr<IDirect3DSurface9> back_buffer;
+	if (FAILED(_orig->GetBackBuffer(0, D3DBACKBUFFER_TYPE_MONO, &back_buffer)))
+		return;
 
-	// Optionally, toggle motion blur or other settings
-#ifdef GAME_UC
-	// bMotionBlur = true; // Example: Enable motion blur
-#endif
+	// A proxy back buffer is multisampled, so effects cannot render into it directly and have to go through the actual back buffer instead
+	const bool uses_proxy_back_buffer = this == _device->_implicit_swapchain && _device->_proxy_back_buffer != nullptr;
+	if (uses_proxy_back_buffer)
+		_device->resolve_proxy_back_buffer();
+
+	if (SUCCEEDED(_device->_orig->BeginScene()))
+	{
+		// Render target views of surfaces are the surfaces themselves, with the first bit set for sRGB (see 'device_impl::create_resource_view')
+		const reshade::api::resource_view rtv = { reinterpret_cast<uintptr_t>(back_buffer.get()) };
+		const reshade::api::resource_view rtv_srgb = { rtv.handle | 1 };
+
+		reshade::render_effect_runtime_mid_frame(this, rtv, rtv_srgb);
+
+		_device->_orig->EndScene();
+	}
+
+	// The game continues to render its frontend to the proxy back buffer after this, so copy the result of the effects back to it, since it is resolved again during the actual present
+	if (uses_proxy_back_buffer)
+		_device->restore_proxy_back_buffer();
+}
+void Direct3DSwapChain9::on_nfs_render_stage(reshade::nfs_render_stage stage)
+{
+	// Render into whatever the game is rendering to at this point, with its depth-stencil still bound, so that neither has to be copied
+	com_ptr<IDirect3DSurface9> render_target;
+	if (FAILED(_device->_orig->GetRenderTarget(0, &render_target)))
+		return;
+
+	// The game is usually inside a scene already at this point, in which case this fails and the scene is left alone
+	const bool began_scene = SUCCEEDED(_device->_orig->BeginScene());
+
+	// Render target views of surfaces are the surfaces themselves, with the first bit set for sRGB (see 'device_impl::create_resource_view')
+	const reshade::api::resource_view rtv = { reinterpret_cast<uintptr_t>(render_target.get()) };
+	const reshade::api::resource_view rtv_srgb = { rtv.handle | 1 };
 
-	// Call the regular on_present for ReShade effects
-	this->on_present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+	reshade::render_effect_runtime_stage(this, stage, rtv, rtv_srgb);
+
+	if (began_scene)
+		_device->_orig->EndScene();
 }
 
 void Direct3DSwapChain9::on_present(const RECT *source_rect, [[maybe_unused]] const RECT *dest_rect, HWND window_override, [[maybe_unused]] const RGNDATA *dirty_region)
 {
 	assert(_is_initialized);
 
+	// Effects work on the actual back buffer, so resolve the proxy back buffer the application rendered to into it first
+	if (this == _device->_implicit_swapchain)
+		_device->resolve_proxy_back_buffer();
+
 	if (SUCCEEDED(_device->_orig->BeginScene()))
 	{
 		_hwnd = window_override;
@@ -285,3 +361,41 @@ void Direct3DSwapChain9::handle_device_loss(HRESULT hr)
 		// Do not clean up resources, since application has to call 'IDirect3DDevice9::Reset' anyway, which will take care of that
 	}
 }
+void Direct3DSwapChain9::limit_frame_latency(HRESULT hr)
+{
+	// Frames that were not actually presented do not add to the queue
+	if (_max_queued_frames == 0 || !_is_initialized || FAILED(hr))
+		return;
+
+	com_ptr<IDirect3DQuery9> &query = _frame_latency_queries[_frame_latency_index % _max_queued_frames];
+	if (query == nullptr)
+	{
+		if (const HRESULT hr_query = _device->_orig->CreateQuery(D3DQUERYTYPE_EVENT, &query); FAILED(hr_query))
+		{
+			reshade::log::message(reshade::log::level::warning, "Failed to create event query for frame latency limiter with %s! Disabling limiter.", reshade::log::hr_to_string(hr_query).c_str());
+			_max_queued_frames = 0;
+			return;
+		}
+	}
+
+	query->Issue(D3DISSUE_END);
+	_frame_latency_index++;
+
+	// Measure how many frames the GPU has not finished yet (including the one that was just presented), before waiting
+	uint32_t queued_frames = 0;
+	for (uint32_t i = 0; i < _max_queued_frames; ++i)
+		if (_frame_latency_queries[i] != nullptr && _frame_latency_queries[i]->GetData(nullptr, 0, 0) == S_FALSE)
+			queued_frames++;
+
+	const auto wait_start = std::chrono::high_resolution_clock::now();
+
+	// The next slot in the ring holds the query of the frame that was presented '_max_queued_frames' frames ago, which has to be finished before the next frame can start
+	// This stops on any result other than S_FALSE, so that a lost device does not cause it to spin forever
+	if (const com_ptr<IDirect3DQuery9> &oldest_query = _frame_latency_queries[_frame_latency_index % _max_queued_frames]; oldest_query != nullptr)
+		while (oldest_query->GetData(nullptr, 0, D3DGETDATA_FLUSH) == S_FALSE)
+			SwitchToThread();
+
+	const auto wait_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - wait_start);
+
+	reshade::report_effect_runtime_frame_latency(this, queued_frames, _max_queued_frames, wait_time.count());
+}
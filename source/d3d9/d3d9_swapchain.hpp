@@ -6,6 +6,7 @@
 #pragma once
 
 #include "d3d9_impl_swapchain.hpp"
+#include "runtime_manager.hpp"
 
 struct Direct3DDevice9;
 
@@ -44,8 +45,13 @@ struct DECLSPEC_UUID("BC52FCE4-1EAC-40C8-84CF-863600BBAA01") Direct3DSwapChain9
 	void on_reset(bool resize);
 	void on_nfs_present(const RECT* pSourceRect, const RECT* pDestRect, HWND hDestWindowOverride,
 	                    const RGNDATA* pDirtyRegion);
+	void on_nfs_render_stage(reshade::nfs_render_stage stage);
 	void on_present(const RECT *source_rect, [[maybe_unused]] const RECT *dest_rect, HWND window_override, [[maybe_unused]] const RGNDATA *dirty_region);
 	void handle_device_loss(HRESULT hr);
+	/// <summary>
+	/// Marks the end of a presented frame with an event query and waits until the GPU has caught up to at most the configured number of queued frames.
+	/// </summary>
+	void limit_frame_latency(HRESULT hr);
 
 	bool check_and_upgrade_interface(REFIID riid);
 
@@ -54,6 +60,14 @@ struct DECLSPEC_UUID("BC52FCE4-1EAC-40C8-84CF-863600BBAA01") Direct3DSwapChain9
 	Direct3DDevice9 *const _device;
 	bool _is_initialized = false;
 	bool _was_still_drawing_last_frame = false;
+
+	static constexpr uint32_t MAX_QUEUED_FRAMES_LIMIT = 16;
+
+	// Maximum number of frames the CPU may be ahead of the GPU, or zero to leave that to the driver
+	uint32_t _max_queued_frames = 0;
+	uint32_t _frame_latency_index = 0;
+	// Ring of event queries marking the end of each of the last '_max_queued_frames' frames
+	com_ptr<IDirect3DQuery9> _frame_latency_queries[MAX_QUEUED_FRAMES_LIMIT];
 #ifdef GAME_UC
 	bool bMotionBlur;
 #endif
@@ -4,6 +4,9 @@
  */
 
 #include "dll_log.hpp"
+#include "lockfree_queue.hpp"
+#include <mutex> // std::call_once, std::once_flag
+#include <cstring> // std::memcpy
 #include <Windows.h>
 
 struct scoped_file_handle
@@ -27,8 +30,69 @@ private:
 
 static scoped_file_handle s_file_handle;
 
+struct log_record
+{
+	uint32_t length;
+	char data[508];
+};
+
+// Lines are queued by any thread and written to the log file in bulk by a background writer thread, so that threads logging a lot (e.g. the render thread with verbose add-on logging) do not block on disk I/O
+static lockfree_mpsc_queue<log_record, 1024> s_records;
+// Only one thread may dequeue records at a time, which is usually the writer thread
+static std::atomic_flag s_records_consumer_busy = ATOMIC_FLAG_INIT;
+static std::once_flag s_writer_thread_started;
+static std::atomic<bool> s_writer_thread_running = false;
+static std::atomic<bool> s_writer_thread_stop = false;
+static HANDLE s_writer_thread_event = nullptr;
+
+static void write_to_file(const char *data, size_t size)
+{
+	if (s_file_handle == INVALID_HANDLE_VALUE || size == 0)
+		return;
+
+	DWORD written = 0;
+	WriteFile(s_file_handle, data, static_cast<DWORD>(size), &written, nullptr);
+	assert(written == size);
+}
+static void write_queued_records()
+{
+	if (s_records_consumer_busy.test_and_set(std::memory_order_acquire))
+		return;
+
+	// Collect as many lines as possible and write them with a single call
+	static char buffer[64 * 1024];
+	size_t size = 0;
+
+	for (log_record record; s_records.pop(record);)
+	{
+		if (size + record.length > sizeof(buffer))
+		{
+			write_to_file(buffer, size);
+			size = 0;
+		}
+
+		std::memcpy(buffer + size, record.data, record.length);
+		size += record.length;
+	}
+
+	write_to_file(buffer, size);
+
+	s_records_consumer_busy.clear(std::memory_order_release);
+}
+
+static DWORD WINAPI writer_thread_main(LPVOID)
+{
+	while (!s_writer_thread_stop.load() && WaitForSingleObject(s_writer_thread_event, INFINITE) == WAIT_OBJECT_0)
+		write_queued_records();
+
+	return 0;
+}
+
 bool reshade::log::open_log_file(const std::filesystem::path &path, std::error_code &ec)
 {
+	// Write any lines that are still queued for the previous file
+	write_queued_records();
+
 	// Close the previous file first
 	// Do this here, instead of in 'scoped_file_handle::operator=', so that the old handle is closed before the new handle is created
 	if (s_file_handle != INVALID_HANDLE_VALUE)
@@ -62,11 +126,11 @@ void reshade::log::message(level level, const char *format, ...)
 	SYSTEMTIME time;
 	GetLocalTime(&time);
 
-	std::string line_string;
-	line_string.resize(256);
+	// Try to format the line into a fixed-size record first, which can then be queued for the writer thread without any allocations
+	log_record record;
 
 	// Start a new line
-	const auto meta_length = std::snprintf(line_string.data(), line_string.size(),
+	const auto meta_length = std::snprintf(record.data, std::size(record.data),
 #if RESHADE_VERBOSE_LOG
 		"%04hd-%02hd-%02hdT"
 #endif
@@ -78,16 +142,87 @@ void reshade::log::message(level level, const char *format, ...)
 
 	va_list args;
 	va_start(args, format);
-	const auto content_length = std::vsnprintf(line_string.data() + meta_length, line_string.size() + 1 - meta_length, format, args);
+	const auto content_length = std::vsnprintf(record.data + meta_length, std::size(record.data) - meta_length, format, args);
+	va_end(args);
+
+	const size_t line_length = static_cast<size_t>(meta_length) + static_cast<size_t>(content_length);
+
+	size_t line_feeds = 0;
+	if (line_length < std::size(record.data))
+		for (size_t i = meta_length; i < line_length; ++i)
+			line_feeds += record.data[i] == '\n';
+
+	// Errors are always written synchronously, so that they are not lost in case the application crashes right after
+	if (level != level::error && line_length + line_feeds + 2 < std::size(record.data))
+	{
+		record.length = static_cast<uint32_t>(line_length + line_feeds + 2);
+
+		// Terminate line with line feed and replace all LF with CRLF, working backwards so that this can be done in place
+		size_t dst = record.length;
+		record.data[dst] = '\0';
+		record.data[--dst] = '\n';
+		record.data[--dst] = '\r';
+		for (size_t src = line_length; src-- > 0;)
+		{
+			record.data[--dst] = record.data[src];
+			if (record.data[src] == '\n')
+				record.data[--dst] = '\r';
+		}
+
+#ifndef NDEBUG
+		// Write line to the debug output
+		OutputDebugStringA(record.data);
+#endif
+
+		if (s_file_handle == INVALID_HANDLE_VALUE)
+			return;
+
+		std::call_once(s_writer_thread_started, []() {
+			s_writer_thread_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			if (s_writer_thread_event == nullptr)
+				return;
+			if (const HANDLE thread = CreateThread(nullptr, 0, &writer_thread_main, nullptr, 0, nullptr))
+			{
+				CloseHandle(thread);
+				s_writer_thread_running.store(true, std::memory_order_release);
+			}
+		});
+
+		if (s_writer_thread_running.load(std::memory_order_acquire) && s_records.push(record))
+		{
+			SetEvent(s_writer_thread_event);
+			return;
+		}
+
+		// Fall back to writing synchronously when the writer thread is unavailable or cannot keep up
+		write_to_file(record.data, record.length);
+		return;
+	}
+
+	std::string line_string;
+	line_string.resize(256);
+
+	const auto long_meta_length = std::snprintf(line_string.data(), line_string.size(),
+#if RESHADE_VERBOSE_LOG
+		"%04hd-%02hd-%02hdT"
+#endif
+		"%02hd:%02hd:%02hd:%03hd [%5lu] | %.5s | ",
+#if RESHADE_VERBOSE_LOG
+		time.wYear, time.wMonth, time.wDay,
+#endif
+		time.wHour, time.wMinute, time.wSecond, time.wMilliseconds, GetCurrentThreadId(), level_names[static_cast<size_t>(level) - 1]);
+
+	va_start(args, format);
+	const auto long_content_length = std::vsnprintf(line_string.data() + long_meta_length, line_string.size() + 1 - long_meta_length, format, args);
 	va_end(args);
 
-	const auto remaining_content = static_cast<size_t>(meta_length) + static_cast<size_t>(content_length) > line_string.size();
-	line_string.resize(static_cast<size_t>(meta_length) + static_cast<size_t>(content_length));
+	const auto remaining_content = static_cast<size_t>(long_meta_length) + static_cast<size_t>(long_content_length) > line_string.size();
+	line_string.resize(static_cast<size_t>(long_meta_length) + static_cast<size_t>(long_content_length));
 
 	if (remaining_content)
 	{
 		va_start(args, format);
-		std::vsnprintf(line_string.data() + meta_length, line_string.size() + 1 - meta_length, format, args);
+		std::vsnprintf(line_string.data() + long_meta_length, line_string.size() + 1 - long_meta_length, format, args);
 		va_end(args);
 	}
 
@@ -97,16 +232,31 @@ void reshade::log::message(level level, const char *format, ...)
 	for (size_t offset = 0; (offset = line_string.find('\n', offset)) != std::string::npos; offset += 2)
 		line_string.replace(offset, 1, "\r\n", 2);
 
+	// Write queued lines first, to keep the order in the log file where possible
+	write_queued_records();
+
 	// Write line to the log file
-	if (s_file_handle != INVALID_HANDLE_VALUE)
-	{
-		DWORD written = 0;
-		WriteFile(s_file_handle, line_string.data(), static_cast<DWORD>(line_string.size()), &written, nullptr);
-		assert(written == line_string.size());
-	}
+	write_to_file(line_string.data(), line_string.size());
 
 #ifndef NDEBUG
 	// Write line to the debug output
 	OutputDebugStringA(line_string.c_str());
 #endif
 }
+
+void reshade::log::stop_writer_thread()
+{
+	if (!s_writer_thread_running.exchange(false))
+		return;
+
+	// New messages are written synchronously from now on, so only have to wait for the writer thread to finish the ones that are still queued
+	s_writer_thread_stop.store(true);
+	SetEvent(s_writer_thread_event);
+
+	// The writer thread may have been terminated while writing (e.g. during process exit), so do not wait indefinitely
+	for (int i = 0; i < 100 && s_records_consumer_busy.test_and_set(std::memory_order_acquire); ++i)
+		Sleep(1);
+	s_records_consumer_busy.clear(std::memory_order_release);
+
+	write_queued_records();
+}
@@ -44,9 +44,15 @@ namespace reshade::log
 
 	/// <summary>
 	/// Constructs a single log message including current time and level and writes it to the open log file.
+	/// Messages other than errors are usually queued and written by a background thread.
 	/// </summary>
 	void message(level level, const char *format, ...);
 
+	/// <summary>
+	/// Writes all queued messages to the log file and stops the background writer thread, so that all following messages are written synchronously.
+	/// </summary>
+	void stop_writer_thread();
+
 #if defined(_HRESULT_DEFINED)
 	inline std::string hr_to_string(HRESULT hr)
 	{
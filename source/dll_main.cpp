@@ -8,8 +8,12 @@
 #include "ini_file.hpp"
 #include "hook_manager.hpp"
 #include "addon_manager.hpp"
+#include "address_resolver.hpp"
+#include "memory_patch.hpp"
+#include "startup_trace.hpp"
 #include <Windows.h>
 #include <Psapi.h>
+#include <algorithm> // std::find_if
 #ifndef NDEBUG
 #include <DbgHelp.h>
 
@@ -46,6 +50,8 @@ std::filesystem::path g_reshade_dll_path;
 std::filesystem::path g_reshade_base_path;
 std::filesystem::path g_target_executable_path;
 
+static reshade::memory_patch_set s_game_patches;
+
 /// <summary>
 /// Checks whether the current application is an UWP app.
 /// </summary>
@@ -143,6 +149,29 @@ std::filesystem::path get_module_path(HMODULE module)
 	return GetModuleFileNameW(module, buf, ARRAYSIZE(buf)) ? buf : std::filesystem::path();
 }
 
+/// <summary>
+/// Checks whether the specified <paramref name="address"/> points into an executable section of the main module of the current process.
+/// </summary>
+static bool is_executable_code_address(uintptr_t address)
+{
+	const auto image_base = reinterpret_cast<const BYTE *>(GetModuleHandleW(nullptr));
+	const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(image_base + reinterpret_cast<const IMAGE_DOS_HEADER *>(image_base)->e_lfanew);
+
+	const IMAGE_SECTION_HEADER *section = IMAGE_FIRST_SECTION(nt_headers);
+	for (WORD i = 0; i < nt_headers->FileHeader.NumberOfSections; ++i, ++section)
+	{
+		if ((section->Characteristics & IMAGE_SCN_MEM_EXECUTE) == 0)
+			continue;
+
+		const uintptr_t section_begin = reinterpret_cast<uintptr_t>(image_base) + section->VirtualAddress;
+		const uintptr_t section_end = section_begin + std::max<DWORD>(section->Misc.VirtualSize, section->SizeOfRawData);
+		if (address >= section_begin && address < section_end)
+			return true;
+	}
+
+	return false;
+}
+
 #ifndef RESHADE_TEST_APPLICATION
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
@@ -151,6 +180,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	{
 		case DLL_PROCESS_ATTACH:
 		{
+			const int64_t attach_timestamp = reshade::startup_trace::timestamp();
+
 			// Do NOT call 'DisableThreadLibraryCalls', since we are linking against the static CRT, which requires the thread notifications to work properly
 			// It does not do anything when static TLS is used anyway, which is the case (see https://docs.microsoft.com/windows/win32/api/libloaderapi/nf-libloaderapi-disablethreadlibrarycalls)
 			g_module_handle = hModule;
@@ -294,12 +325,82 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 			}
 #endif
 
+			// Record where the time goes from here up to the first frame in which all effects were loaded, to be written next to the log file
+			if (config.get("INSTALL", "StartupTrace"))
+			{
+				std::filesystem::path trace_path = config.path();
+				trace_path.replace_extension(L".startup.json");
+
+				reshade::startup_trace::start(trace_path, attach_timestamp);
+			}
+
 			if (config.get("INSTALL", "PreventUnloading"))
 			{
 				GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_PIN | GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(hModule), &hModule);
 			}
 
+			// The hook sites are hardcoded for a specific game executable, so make sure the running one matches before patching its code (patching a different game or version would corrupt it)
+			bool is_target_game = true;
+			{
+				const auto image_base = reinterpret_cast<const BYTE *>(GetModuleHandleW(nullptr));
+				const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(image_base + reinterpret_cast<const IMAGE_DOS_HEADER *>(image_base)->e_lfanew);
+
+				reshade::log::message(reshade::log::level::info, "Target executable has PE timestamp 0x%08X and image size 0x%08X.", nt_headers->FileHeader.TimeDateStamp, nt_headers->OptionalHeader.SizeOfImage);
+
+				for (const uintptr_t hook_address : std::initializer_list<uintptr_t> {
+#ifdef NFS_MULTITHREAD
+						FEMANAGER_RENDER_HOOKADDR1,
+						MAINSERVICE_HOOK_ADDR,
+#else
+#ifdef GAME_MW
+						GAMEFLOW_UNLOADTRACK_FIX,
+#endif
+#ifdef GAME_CARBON
+						INFINITENOS_HOOK,
+#endif
+#ifdef GAME_UG2
+						SETRAIN_HOOK_ADDR,
+#endif
+#ifdef HAS_COPS
+#ifndef GAME_UC
+						HEATONEVENTWIN_HOOK_ADDR,
+#endif
+#endif
+#endif
+					})
+				{
+					if (!is_executable_code_address(hook_address))
+					{
+						reshade::log::message(reshade::log::level::error, "Hook address 0x%08X is not part of the code of the target executable! This build does not match the running game, so it is not patched.", static_cast<unsigned int>(hook_address));
+						is_target_game = false;
+						break;
+					}
+				}
+			}
+
+			// The games this build targets only ever render through Direct3D 9, so when running the matching executable skip registering hooks for all the other graphics APIs
+			// A different list of APIs to hook can be set in the configuration, with an empty list hooking all of them
+			std::vector<std::string> hook_apis;
+			if (!config.get("INSTALL", "HookAPIs", hook_apis) && is_target_game)
+				hook_apis = { "d3d9" };
+			if (!hook_apis.empty())
+			{
+				std::string hook_apis_string;
+				for (const std::string &api : hook_apis)
+					hook_apis_string += (hook_apis_string.empty() ? "" : ", ") + api;
+				reshade::log::message(reshade::log::level::info, "Only registering graphics hooks for %s.", hook_apis_string.c_str());
+			}
+
+			const auto should_hook_api = [&hook_apis, module_name = module_name.u8string()](const char *api) {
+				// Always hook the module ReShade was loaded as, since that is whose exports the application calls
+				return hook_apis.empty() || _stricmp(module_name.c_str(), api) == 0 ||
+					std::find_if(hook_apis.cbegin(), hook_apis.cend(), [api](const std::string &name) { return _stricmp(name.c_str(), api) == 0; }) != hook_apis.cend();
+			};
+
 			// Register modules to hook
+			// Batch all hook installations, so that they are enabled together instead of suspending all threads once per module
+			const int64_t register_hooks_timestamp = reshade::startup_trace::timestamp();
+			reshade::hooks::begin_batch();
 			{
 				if (!GetEnvironmentVariableW(L"RESHADE_DISABLE_INPUT_HOOK", nullptr, 0))
 				{
@@ -335,75 +436,121 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 						if (_wcsicmp(module_name.c_str(), L"ddraw") == 0)
 							reshade::hooks::register_module(get_system_path() / L"ddraw.dll");
 
-						reshade::hooks::register_module(get_system_path() / L"d2d1.dll");
-						reshade::hooks::register_module(get_system_path() / L"d3d9.dll");
-						reshade::hooks::register_module(get_system_path() / L"d3d10.dll");
-						reshade::hooks::register_module(get_system_path() / L"d3d10_1.dll");
-						reshade::hooks::register_module(get_system_path() / L"d3d11.dll");
-
-						// On Windows 7 the d3d12on7 module is not in the system path, so register to hook any d3d12.dll loaded instead
-						if (is_windows7() && _wcsicmp(module_name.c_str(), L"d3d12") != 0)
-							reshade::hooks::register_module(L"d3d12.dll");
-						else
-							reshade::hooks::register_module(get_system_path() / L"d3d12.dll");
-
-						reshade::hooks::register_module(get_system_path() / L"dxgi.dll");
+						if (should_hook_api("d2d1"))
+							reshade::hooks::register_module(get_system_path() / L"d2d1.dll");
+						if (should_hook_api("d3d9"))
+							reshade::hooks::register_module(get_system_path() / L"d3d9.dll");
+						if (should_hook_api("d3d10"))
+							reshade::hooks::register_module(get_system_path() / L"d3d10.dll");
+						if (should_hook_api("d3d10_1"))
+							reshade::hooks::register_module(get_system_path() / L"d3d10_1.dll");
+						if (should_hook_api("d3d11"))
+							reshade::hooks::register_module(get_system_path() / L"d3d11.dll");
+
+						if (should_hook_api("d3d12"))
+						{
+							// On Windows 7 the d3d12on7 module is not in the system path, so register to hook any d3d12.dll loaded instead
+							if (is_windows7() && _wcsicmp(module_name.c_str(), L"d3d12") != 0)
+								reshade::hooks::register_module(L"d3d12.dll");
+							else
+								reshade::hooks::register_module(get_system_path() / L"d3d12.dll");
+						}
+
+						if (should_hook_api("dxgi"))
+							reshade::hooks::register_module(get_system_path() / L"dxgi.dll");
 					}
 
 					// Only register OpenGL hooks when module is not called any D3D module name
-					if (!is_d3d && !is_dxgi)
+					if (!is_d3d && !is_dxgi && should_hook_api("opengl32"))
 						reshade::hooks::register_module(get_system_path() / L"opengl32.dll");
 
 					// Do not register Vulkan hooks, since Vulkan layering mechanism is used instead
 
+					if (should_hook_api("openvr"))
+					{
 #ifndef _WIN64
-					reshade::hooks::register_module(L"vrclient.dll");
+						reshade::hooks::register_module(L"vrclient.dll");
 #else
-					reshade::hooks::register_module(L"vrclient_x64.dll");
+						reshade::hooks::register_module(L"vrclient_x64.dll");
 #endif
+					}
 				}
 			}
+			reshade::hooks::end_batch();
+			reshade::startup_trace::add_span("Register hooks", register_hooks_timestamp, reshade::startup_trace::timestamp());
 
 				// NFS INJECTION
 
+			if (!is_target_game)
+			{
+				reshade::startup_trace::add_span("DllMain", attach_timestamp, reshade::startup_trace::timestamp());
+				reshade::log::message(reshade::log::level::info, "Initialized.");
+				return TRUE;
+			}
+
+#ifdef NFS_ADDRESS_PATTERNS
+			// Game headers can list "NFS_ADDRESS_PATTERN(variable, pattern, offset)" entries in "NFS_ADDRESS_PATTERNS" for addresses that should be found by pattern instead of being hardcoded
+			// The variable keeps its hardcoded default if the pattern is not found, and results are cached per executable so only the first launch has to scan
+			{
+				const reshade::startup_trace::scoped_span trace_span("Resolve addresses");
+
+				reshade::address_resolver resolver;
+#define NFS_ADDRESS_PATTERN(variable, pattern, offset) resolver.add(#variable, pattern, offset, &variable);
+				NFS_ADDRESS_PATTERNS
+#undef NFS_ADDRESS_PATTERN
+				resolver.resolve(g_reshade_base_path / L"ReShadeAddressCache.ini");
+			}
+#endif
+
 #ifdef NFS_MULTITHREAD
-				injector::MakeJMP(FEMANAGER_RENDER_HOOKADDR1, ReShade_EntryPoint, true);
-				injector::MakeCALL(MAINSERVICE_HOOK_ADDR, MainService_Hook, true);
+				s_game_patches.make_jmp(FEMANAGER_RENDER_HOOKADDR1, ReShade_EntryPoint);
+				s_game_patches.make_call(MAINSERVICE_HOOK_ADDR, MainService_Hook);
 #else
 #ifdef NFS_MULTITHREAD
-				injector::MakeCALL(FEMANAGER_RENDER_HOOKADDR1, FEManager_Render_Hook, true);
-				injector::MakeCALL(FEMANAGER_RENDER_HOOKADDR2, FEManager_Render_Hook, true);
+				s_game_patches.make_call(FEMANAGER_RENDER_HOOKADDR1, FEManager_Render_Hook);
+				s_game_patches.make_call(FEMANAGER_RENDER_HOOKADDR2, FEManager_Render_Hook);
 #endif
 #ifdef GAME_MW
-				injector::MakeNOP(GAMEFLOW_UNLOADTRACK_FIX, 5, true);
+				s_game_patches.make_nop(GAMEFLOW_UNLOADTRACK_FIX, 5);
 #endif
 #ifdef GAME_CARBON
-				injector::MakeCALL(INFINITENOS_HOOK, EasterEggCheck_Hook, true);
-				//injector::MakeCALL(INFINITERB_HOOK, EasterEggCheck_Hook, true); // unnecessary, but left here
+				s_game_patches.make_call(INFINITENOS_HOOK, EasterEggCheck_Hook);
+				//s_game_patches.make_call(INFINITERB_HOOK, EasterEggCheck_Hook); // unnecessary, but left here
 #endif
 #ifdef GAME_PS
-				injector::MakeJMP(AICONTROL_CAVE_ADDR, ToggleAIControlCave, true);
-				injector::MakeJMP(INFINITENOS_CAVE_ADDR, InfiniteNOSCave, true);
-				injector::MakeJMP(GAMESPEED_CAVE_ADDR, GameSpeedCave, true);
-				injector::MakeJMP(DRAWWORLD_CAVE_ADDR, DrawWorldCave, true);
-				injector::WriteMemory<char>(SKIPFE_PLAYERCAR_DEHARDCODE_PATCH_ADDR, 0xA1, true);
-				injector::WriteMemory<int>(SKIPFE_PLAYERCAR_DEHARDCODE_PATCH_ADDR + 1, SKIPFE_PLAYERCAR_ADDR, true);
+				s_game_patches.make_jmp(AICONTROL_CAVE_ADDR, ToggleAIControlCave);
+				s_game_patches.make_jmp(INFINITENOS_CAVE_ADDR, InfiniteNOSCave);
+				s_game_patches.make_jmp(GAMESPEED_CAVE_ADDR, GameSpeedCave);
+				s_game_patches.make_jmp(DRAWWORLD_CAVE_ADDR, DrawWorldCave);
+				s_game_patches.write<char>(SKIPFE_PLAYERCAR_DEHARDCODE_PATCH_ADDR, 0xA1);
+				s_game_patches.write<int>(SKIPFE_PLAYERCAR_DEHARDCODE_PATCH_ADDR + 1, SKIPFE_PLAYERCAR_ADDR);
 #endif
 #ifdef GAME_UC
-				injector::MakeJMP(NFSUC_MOTIONBLUR_HOOK_ADDR, MotionBlur_EntryPoint, true);
-				injector::MakeJMP(INFINITENOS_CAVE_ADDR, InfiniteNOSCave, true);
-				injector::MakeJMP(AICONTROL_CAVE_ADDR, ToggleAIControlCave, true);
+				s_game_patches.make_jmp(NFSUC_MOTIONBLUR_HOOK_ADDR, MotionBlur_EntryPoint);
+				s_game_patches.make_jmp(INFINITENOS_CAVE_ADDR, InfiniteNOSCave);
+				s_game_patches.make_jmp(AICONTROL_CAVE_ADDR, ToggleAIControlCave);
 #endif
 #ifdef GAME_UG2
-				injector::MakeCALL(SETRAIN_HOOK_ADDR, SetRainBase_Custom, true);
+				s_game_patches.make_call(SETRAIN_HOOK_ADDR, SetRainBase_Custom);
 #endif
 #ifdef HAS_COPS
 #ifndef GAME_UC
-				injector::MakeCALL(HEATONEVENTWIN_HOOK_ADDR, FECareerRecord_AdjustHeatOnEventWin_Hook, true);
+				s_game_patches.make_call(HEATONEVENTWIN_HOOK_ADDR, FECareerRecord_AdjustHeatOnEventWin_Hook);
 #endif
 #endif
 #endif
 
+			// Apply all patches together, so that the memory protection of every page is only changed once
+			if (!s_game_patches.apply())
+				reshade::log::message(reshade::log::level::error, "Failed to patch the game executable!");
+
+#ifdef SIM_SETSTREAM_ADDR
+			// Hook the world streaming functions at their entry to measure how long the game stalls in them
+			reshade::hooks::install("Sim_SetStream", reinterpret_cast<reshade::hook::address>(SIM_SETSTREAM_ADDR), reinterpret_cast<reshade::hook::address>(&Sim_SetStream_Hook));
+			reshade::hooks::install("GameFlowManager::LoadRegion", reinterpret_cast<reshade::hook::address>(GAMEFLOWMGR_LOADREGION_ADDR), reinterpret_cast<reshade::hook::address>(&GameFlowManager_LoadRegion_Hook));
+#endif
+
+			reshade::startup_trace::add_span("DllMain", attach_timestamp, reshade::startup_trace::timestamp());
 			reshade::log::message(reshade::log::level::info, "Initialized.");
 			break;
 		}
@@ -418,6 +565,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 
 			reshade::hooks::uninstall();
 
+			// Writer thread must not be running in this module anymore after it was unloaded
+			reshade::log::stop_writer_thread();
+
 			// Module is now invalid, so break out of any message loops that may still have it in the call stack (see 'HookGetMessage' implementation in input.cpp)
 			// This is necessary since a different thread may have called into the 'GetMessage' hook from ReShade, but may not receive a message until after the ReShade module was unloaded
 			// At that point it would return to code that was already unloaded and crash
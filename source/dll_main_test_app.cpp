@@ -17,6 +17,8 @@
 #include <D3D12Downlevel.h>
 #include <GL/gl3w.h>
 #include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdio>
 
 extern HMODULE g_module_handle;
 extern std::filesystem::path g_reshade_dll_path;
@@ -26,6 +28,10 @@ extern std::filesystem::path g_target_executable_path;
 extern std::filesystem::path get_base_path(bool default_to_target_executable_path = false);
 extern std::filesystem::path get_module_path(HMODULE module);
 
+#if RESHADE_ADDON
+extern "C" __declspec(dllexport) void ReShadeRegisterEvent(reshade::addon_event ev, void *callback);
+#endif
+
 #define HR_CHECK(exp) { const HRESULT res = (exp); assert(SUCCEEDED(res)); }
 #define VK_CHECK(exp) { const VkResult res = (exp); assert(res == VK_SUCCESS); }
 
@@ -33,12 +39,34 @@ extern std::filesystem::path get_module_path(HMODULE module);
 #define VK_CALL_DEVICE(name, device, ...) reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name))(device, __VA_ARGS__)
 #define VK_CALL_INSTANCE(name, instance, ...) reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name))(__VA_ARGS__)
 
+// Set to false to measure the graphics API without any of the ReShade hooks installed, as a baseline for benchmark mode
+static bool s_install_api_hooks = true;
+
+// Options of the regression harness in the runtime, which plays the captured frames in the specified directory through the preset and compares the output against golden images
+std::filesystem::path g_regression_path;
+std::filesystem::path g_regression_preset_path;
+bool g_regression_update_golden = false;
+double g_regression_min_psnr = 50.0;
+unsigned int g_regression_presents_per_frame = 8;
+
+/// <summary>
+/// Gets the value following an option on the command line, which may be enclosed in quotes to contain spaces.
+/// </summary>
+static std::string get_command_line_value(LPSTR value)
+{
+	if (value[0] == '"')
+		return std::string(value + 1, std::find(value + 1, value + std::strlen(value), '"'));
+	else
+		return std::string(value, std::find(value, value + std::strlen(value), ' '));
+}
+
 struct scoped_module_handle
 {
 	scoped_module_handle(LPCWSTR name) : module(LoadLibraryW(name))
 	{
 		assert(module != nullptr);
-		reshade::hooks::register_module(name);
+		if (s_install_api_hooks)
+			reshade::hooks::register_module(name);
 	}
 	~scoped_module_handle()
 	{
@@ -63,6 +91,92 @@ static LONG APIENTRY HookD3DKMTQueryAdapterInfo(const void *pData)
 	return reshade::hooks::call(HookD3DKMTQueryAdapterInfo)(pData);
 }
 
+/// <summary>
+/// Synthetic frame workload and timing for benchmark mode, which renders a fixed number of frames with the specified number of draw calls and state changes and then quits.
+/// </summary>
+struct benchmark
+{
+	bool enabled = false;
+	unsigned int frames = 1000;
+	// Frames at the start that are not included in the results, to skip effect compilation and other one-time work
+	unsigned int warmup_frames = 100;
+	unsigned int draw_calls = 1000;
+	unsigned int state_changes = 100;
+	std::string label;
+
+	unsigned int frame = 0;
+	uint64_t state_change_time = 0;
+	uint64_t draw_call_time = 0;
+	uint64_t present_time = 0;
+
+	template <typename F>
+	void measure(uint64_t &total_time, F &&function)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		if (frame >= warmup_frames)
+			total_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// Advances to the next frame and writes the results once all frames were rendered.
+	/// </summary>
+	/// <returns><see langword="true"/> if the benchmark finished and the application should quit, <see langword="false"/> otherwise.</returns>
+	bool next_frame(const char *api_name, bool has_workload)
+	{
+		if (!enabled || ++frame < warmup_frames + frames)
+			return false;
+
+		const double state_change_ns = has_workload && state_changes != 0 ? static_cast<double>(state_change_time) / (static_cast<double>(frames) * state_changes) : 0.0;
+		const double draw_call_ns = has_workload && draw_calls != 0 ? static_cast<double>(draw_call_time) / (static_cast<double>(frames) * draw_calls) : 0.0;
+		const double present_us = static_cast<double>(present_time) / frames / 1000.0;
+
+		reshade::log::message(reshade::log::level::info, "Benchmark '%s' on %s finished after %u frames: %.1f ns per state change, %.1f ns per draw call, %.2f us per present.", label.c_str(), api_name, frames, state_change_ns, draw_call_ns, present_us);
+
+		// Append to a single file, so that the results of different configurations and graphics APIs end up next to each other
+		const std::filesystem::path csv_path = g_reshade_base_path / L"ReShade Benchmark.csv";
+
+		std::error_code ec;
+		const bool write_header = !std::filesystem::exists(csv_path, ec);
+
+		if (FILE *const csv_file = _wfsopen(csv_path.c_str(), L"a", SH_DENYWR))
+		{
+			if (write_header)
+				std::fputs("label,api,frames,draw_calls,state_changes,state_change_ns,draw_call_ns,present_us\n", csv_file);
+			std::fprintf(csv_file, "%s,%s,%u,%u,%u,%.2f,%.2f,%.3f\n", label.c_str(), api_name, frames, has_workload ? draw_calls : 0, has_workload ? state_changes : 0, state_change_ns, draw_call_ns, present_us);
+			std::fclose(csv_file);
+		}
+		else
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to write benchmark results to '%s'!", csv_path.u8string().c_str());
+		}
+
+		return true;
+	}
+};
+
+#if RESHADE_ADDON
+// Callbacks that do nothing, to measure the cost of dispatching events to add-ons in benchmark mode
+static bool on_benchmark_draw(reshade::api::command_list *, uint32_t, uint32_t, uint32_t, uint32_t)
+{
+	return false;
+}
+static void on_benchmark_bind_viewports(reshade::api::command_list *, uint32_t, uint32_t, const reshade::api::viewport *)
+{
+}
+static void on_benchmark_bind_pipeline_states(reshade::api::command_list *, uint32_t, const reshade::api::dynamic_state *, const uint32_t *)
+{
+}
+
+static void register_benchmark_addon_events()
+{
+	// Add-ons are loaded during device creation, so this has to be called afterwards for the callbacks to be associated with the built-in add-ons
+	ReShadeRegisterEvent(reshade::addon_event::draw, reinterpret_cast<void *>(&on_benchmark_draw));
+	ReShadeRegisterEvent(reshade::addon_event::bind_viewports, reinterpret_cast<void *>(&on_benchmark_bind_viewports));
+	ReShadeRegisterEvent(reshade::addon_event::bind_pipeline_states, reinterpret_cast<void *>(&on_benchmark_bind_pipeline_states));
+}
+#endif
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
 	g_module_handle = hInstance;
@@ -148,6 +262,40 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 
 	const bool multisample = strstr(lpCmdLine, "-multisample") != nullptr;
 
+	benchmark bench;
+	bench.enabled = strstr(lpCmdLine, "-benchmark") != nullptr;
+	if (LPSTR frames_arg = std::strstr(lpCmdLine, "-benchmark-frames "))
+		bench.frames = std::max(std::strtoul(frames_arg + 18, nullptr, 10), 1ul);
+	if (LPSTR warmup_arg = std::strstr(lpCmdLine, "-benchmark-warmup "))
+		bench.warmup_frames = std::strtoul(warmup_arg + 18, nullptr, 10);
+	if (LPSTR draws_arg = std::strstr(lpCmdLine, "-benchmark-draws "))
+		bench.draw_calls = std::strtoul(draws_arg + 17, nullptr, 10);
+	if (LPSTR state_changes_arg = std::strstr(lpCmdLine, "-benchmark-state-changes "))
+		bench.state_changes = std::strtoul(state_changes_arg + 25, nullptr, 10);
+
+	// Configurations are distinguished by whether the ReShade hooks are installed at all and whether add-on event callbacks are registered, the rest (effects, add-ons that are loaded) comes from the configuration file as usual
+	s_install_api_hooks = !bench.enabled || strstr(lpCmdLine, "-benchmark-no-hooks") == nullptr;
+	const bool benchmark_addon_events = bench.enabled && strstr(lpCmdLine, "-benchmark-addon-events") != nullptr;
+
+	if (LPSTR label_arg = std::strstr(lpCmdLine, "-benchmark-label "))
+		bench.label.assign(label_arg + 17, std::find(label_arg + 17, label_arg + std::strlen(label_arg), ' '));
+	else
+		bench.label = !s_install_api_hooks ? "no_hooks" : benchmark_addon_events ? "addon_events" : "hooks";
+
+	// Regression runs quit on their own once all input frames were compared, with an exit code that tells whether they all passed
+	if (LPSTR regression_arg = std::strstr(lpCmdLine, "-regression "))
+		g_regression_path = std::filesystem::u8path(get_command_line_value(regression_arg + 12));
+	if (LPSTR preset_arg = std::strstr(lpCmdLine, "-regression-preset "))
+		g_regression_preset_path = std::filesystem::u8path(get_command_line_value(preset_arg + 19));
+	if (LPSTR min_psnr_arg = std::strstr(lpCmdLine, "-regression-min-psnr "))
+		g_regression_min_psnr = std::strtod(min_psnr_arg + 21, nullptr);
+	if (LPSTR presents_arg = std::strstr(lpCmdLine, "-regression-presents "))
+		g_regression_presents_per_frame = std::max(std::strtoul(presents_arg + 21, nullptr, 10), 1ul);
+	g_regression_update_golden = strstr(lpCmdLine, "-regression-update-golden") != nullptr;
+
+	// Present without waiting for vertical sync, so that the present time only includes the work done on the CPU
+	const UINT sync_interval = bench.enabled ? 0 : 1;
+
 	switch (api)
 	{
 	#pragma region D3D9 Implementation
@@ -160,13 +308,22 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 		pp.hDeviceWindow = window_handle;
 		pp.Windowed = true;
 		pp.MultiSampleType = multisample ? D3DMULTISAMPLE_4_SAMPLES : D3DMULTISAMPLE_NONE;
-		pp.PresentationInterval = D3DPRESENT_INTERVAL_ONE;
+		pp.PresentationInterval = bench.enabled ? D3DPRESENT_INTERVAL_IMMEDIATE : D3DPRESENT_INTERVAL_ONE;
 
 		// Initialize Direct3D 9
 		com_ptr<IDirect3D9> d3d = Direct3DCreate9(D3D_SDK_VERSION);
 		com_ptr<IDirect3DDevice9> device;
 		HR_CHECK(d3d->CreateDevice(D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, window_handle, D3DCREATE_HARDWARE_VERTEXPROCESSING, &pp, &device));
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
+		// Degenerate triangle with pre-transformed vertices, so that the benchmark draw calls do not need any shaders or buffers and cost next to nothing on the GPU
+		const float benchmark_vertices[3][4] = {};
+		HR_CHECK(device->SetFVF(D3DFVF_XYZRHW));
+
 		while (true)
 		{
 			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE) && msg.message != WM_QUIT)
@@ -185,7 +342,29 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			}
 
 			HR_CHECK(device->Clear(0, nullptr, D3DCLEAR_TARGET, 0xFF7F7F7F, 0, 0));
-			HR_CHECK(device->Present(nullptr, nullptr, nullptr, nullptr));
+
+			if (bench.enabled)
+			{
+				HR_CHECK(device->BeginScene());
+
+				bench.measure(bench.state_change_time, [&]() {
+					for (unsigned int i = 0; i < bench.state_changes; ++i)
+						device->SetRenderState(D3DRS_CULLMODE, (i % 2) ? D3DCULL_CW : D3DCULL_CCW);
+				});
+				bench.measure(bench.draw_call_time, [&]() {
+					for (unsigned int i = 0; i < bench.draw_calls; ++i)
+						device->DrawPrimitiveUP(D3DPT_TRIANGLELIST, 1, benchmark_vertices, sizeof(benchmark_vertices[0]));
+				});
+
+				HR_CHECK(device->EndScene());
+			}
+
+			bench.measure(bench.present_time, [&]() {
+				HR_CHECK(device->Present(nullptr, nullptr, nullptr, nullptr));
+			});
+
+			if (bench.next_frame("d3d9", true))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 	}
 	#pragma endregion
@@ -217,6 +396,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			HR_CHECK(D3D10CreateDeviceAndSwapChain(nullptr, D3D10_DRIVER_TYPE_HARDWARE, nullptr, flags, D3D10_SDK_VERSION, &desc, &swapchain, &device));
 		}
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
+		// Draw calls without any shaders bound are valid and do not produce any output, which keeps the GPU cost of the benchmark workload to a minimum
+		device->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		const D3D10_VIEWPORT benchmark_viewports[2] = { { 0, 0, 1, 1, 0.0f, 1.0f }, { 0, 0, 2, 2, 0.0f, 1.0f } };
+
 		com_ptr<ID3D10Texture2D> backbuffer;
 		HR_CHECK(swapchain->GetBuffer(0, IID_PPV_ARGS(&backbuffer)));
 		com_ptr<ID3D10RenderTargetView> target;
@@ -245,7 +433,24 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			const float color[4] = { 0.5f, 0.5f, 0.5f, 1.0f };
 			device->ClearRenderTargetView(target.get(), color);
 
-			HR_CHECK(swapchain->Present(1, 0));
+			if (bench.enabled)
+			{
+				bench.measure(bench.state_change_time, [&]() {
+					for (unsigned int i = 0; i < bench.state_changes; ++i)
+						device->RSSetViewports(1, &benchmark_viewports[i % 2]);
+				});
+				bench.measure(bench.draw_call_time, [&]() {
+					for (unsigned int i = 0; i < bench.draw_calls; ++i)
+						device->Draw(3, 0);
+				});
+			}
+
+			bench.measure(bench.present_time, [&]() {
+				HR_CHECK(swapchain->Present(sync_interval, 0));
+			});
+
+			if (bench.next_frame("d3d10", true))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 	}
 	#pragma endregion
@@ -278,6 +483,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			HR_CHECK(D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags, nullptr, 0, D3D11_SDK_VERSION, &desc, &swapchain, &device, nullptr, &immediate_context));
 		}
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
+		// Draw calls without any shaders bound are valid and do not produce any output, which keeps the GPU cost of the benchmark workload to a minimum
+		immediate_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		const D3D11_VIEWPORT benchmark_viewports[2] = { { 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 2.0f, 2.0f, 0.0f, 1.0f } };
+
 		com_ptr<ID3D11Texture2D> backbuffer;
 		HR_CHECK(swapchain->GetBuffer(0, IID_PPV_ARGS(&backbuffer)));
 		com_ptr<ID3D11RenderTargetView> target;
@@ -306,7 +520,24 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			const float color[4] = { 0.5f, 0.5f, 0.5f, 1.0f };
 			immediate_context->ClearRenderTargetView(target.get(), color);
 
-			HR_CHECK(swapchain->Present(1, 0));
+			if (bench.enabled)
+			{
+				bench.measure(bench.state_change_time, [&]() {
+					for (unsigned int i = 0; i < bench.state_changes; ++i)
+						immediate_context->RSSetViewports(1, &benchmark_viewports[i % 2]);
+				});
+				bench.measure(bench.draw_call_time, [&]() {
+					for (unsigned int i = 0; i < bench.draw_calls; ++i)
+						immediate_context->Draw(3, 0);
+				});
+			}
+
+			bench.measure(bench.present_time, [&]() {
+				HR_CHECK(swapchain->Present(sync_interval, 0));
+			});
+
+			if (bench.next_frame("d3d11", true))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 	}
 	#pragma endregion
@@ -432,6 +663,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			HR_CHECK(cmd_lists[i]->Close());
 		}
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
 		while (true)
 		{
 			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE) && msg.message != WM_QUIT)
@@ -475,8 +711,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			else
 			{
 				// Synchronization is handled in 'swapchain_impl::on_present'
-				HR_CHECK(swapchain->Present(1, 0));
+				bench.measure(bench.present_time, [&]() {
+					HR_CHECK(swapchain->Present(sync_interval, 0));
+				});
 			}
+
+			// Command lists are recorded once up front, so there is no per-frame workload to measure
+			if (bench.next_frame("d3d12", false))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 	}
 	#pragma endregion
@@ -547,6 +789,22 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 
 		wglMakeCurrent(hdc2, hglrc2);
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
+		GLuint benchmark_vao = 0;
+		if (bench.enabled)
+		{
+			if (const auto wglSwapIntervalEXT = reinterpret_cast<BOOL(WINAPI *)(int)>(wglGetProcAddress("wglSwapIntervalEXT")))
+				wglSwapIntervalEXT(0);
+
+			// Core profile requires a vertex array object to be bound for draw calls, but without a program bound they do not produce any output
+			glGenVertexArrays(1, &benchmark_vao);
+			glBindVertexArray(benchmark_vao);
+		}
+
 		while (true)
 		{
 			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE) && msg.message != WM_QUIT)
@@ -564,13 +822,33 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT);
 
+			if (bench.enabled)
+			{
+				bench.measure(bench.state_change_time, [&]() {
+					for (unsigned int i = 0; i < bench.state_changes; ++i)
+						(i % 2) ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+				});
+				bench.measure(bench.draw_call_time, [&]() {
+					for (unsigned int i = 0; i < bench.draw_calls; ++i)
+						glDrawArrays(GL_TRIANGLES, 0, 3);
+				});
+			}
+
+			bench.measure(bench.present_time, [&]() {
 #if 1
-			wglSwapLayerBuffers(hdc2, WGL_SWAP_MAIN_PLANE); // Call directly for RenderDoc compatibility
+				wglSwapLayerBuffers(hdc2, WGL_SWAP_MAIN_PLANE); // Call directly for RenderDoc compatibility
 #else
-			SwapBuffers(hdc2);
+				SwapBuffers(hdc2);
 #endif
+			});
+
+			if (bench.next_frame("opengl", true))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 
+		if (benchmark_vao != 0)
+			glDeleteVertexArrays(1, &benchmark_vao);
+
 		wglMakeCurrent(nullptr, nullptr);
 		wglDeleteContext(hglrc2);
 	}
@@ -704,6 +982,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			create_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
 			create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 			create_info.presentMode = present_modes[0];
+			// Present without waiting for vertical sync in benchmark mode if possible
+			if (bench.enabled && std::find(present_modes.begin(), present_modes.end(), VK_PRESENT_MODE_IMMEDIATE_KHR) != present_modes.end())
+				create_info.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
 			create_info.clipped = VK_TRUE;
 			create_info.oldSwapchain = old_swapchain;
 
@@ -763,6 +1044,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 
 		resize_swapchain();
 
+#if RESHADE_ADDON
+		if (benchmark_addon_events)
+			register_benchmark_addon_events();
+#endif
+
 		VkSemaphore sem_acquire = VK_NULL_HANDLE;
 		VkSemaphore sem_present = VK_NULL_HANDLE;
 		{   VkSemaphoreCreateInfo create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
@@ -808,12 +1094,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 				present_info.pSwapchains = &swapchain;
 				present_info.pImageIndices = &swapchain_image_index;
 
-				present_res = VK_CALL_CMD(vkQueuePresentKHR, device, queue, &present_info);
+				bench.measure(bench.present_time, [&]() {
+					present_res = VK_CALL_CMD(vkQueuePresentKHR, device, queue, &present_info);
+				});
 			}
 
 			// Ignore out of date errors during presentation, since swap chain will be recreated on next minimize/maximize event anyway
 			if (present_res != VK_SUBOPTIMAL_KHR && present_res != VK_ERROR_OUT_OF_DATE_KHR)
 				VK_CHECK(present_res);
+
+			// Command buffers are recorded once up front, so there is no per-frame workload to measure
+			if (bench.next_frame("vulkan", false))
+				PostQuitMessage(EXIT_SUCCESS);
 		}
 
 		// Wait for all GPU work to finish before destroying objects
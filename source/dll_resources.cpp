@@ -4,8 +4,10 @@
  */
 
 #include "dll_resources.hpp"
+#include <mutex>
+#include <memory>
 #include <cassert>
-#include <algorithm> // std::find
+#include <algorithm> // std::find, std::find_if
 #include <utf8/unchecked.h>
 #include <Windows.h>
 
@@ -38,6 +40,101 @@ std::string reshade::resources::load_string(unsigned short id)
 }
 
 #if RESHADE_LOCALIZATION
+struct string_table
+{
+	std::string language;
+	// All strings of the table, each followed by a null-terminator
+	std::string data;
+	// Pointers into 'data' indexed by string identifier, or null for identifiers without a string
+	std::unique_ptr<const char *[]> strings;
+};
+
+static std::mutex s_string_tables_mutex;
+// Tables are never destroyed, so that pointers to their strings stay valid
+static std::vector<std::unique_ptr<string_table>> s_string_tables;
+static thread_local const string_table *s_current_string_table = nullptr;
+
+static void enum_string_table_blocks(std::vector<unsigned short> &blocks)
+{
+	// String tables are stored in blocks of 16 strings each, with the block identifier being the string identifier divided by 16 plus one
+	EnumResourceNamesW(g_module_handle, RT_STRING,
+		[](HMODULE, LPCWSTR, LPWSTR lpName, LONG_PTR lParam) -> BOOL {
+			if (IS_INTRESOURCE(lpName))
+				reinterpret_cast<std::vector<unsigned short> *>(lParam)->push_back(static_cast<unsigned short>(reinterpret_cast<uintptr_t>(lpName)));
+			return TRUE;
+		}, reinterpret_cast<LONG_PTR>(&blocks));
+}
+
+static std::string get_thread_language()
+{
+	ULONG num = 0, size = 0;
+	if (!GetThreadPreferredUILanguages(MUI_LANGUAGE_NAME | MUI_THREAD_LANGUAGES, &num, nullptr, &size))
+		return std::string();
+	std::vector<WCHAR> languages(size);
+	if (!GetThreadPreferredUILanguages(MUI_LANGUAGE_NAME | MUI_THREAD_LANGUAGES, &num, languages.data(), &size) || num == 0)
+		return std::string();
+
+	std::string language;
+	// Extract first language from the double null-terminated multi-string buffer
+	utf8::unchecked::utf16to8(languages.begin(), std::find(languages.begin(), languages.end(), L'\0'), std::back_inserter(language));
+	return language;
+}
+
+/// <summary>
+/// Finds the string table for the specified language, or loads it using the current language of the calling thread (which has to match) if it does not exist yet.
+/// </summary>
+static const string_table *get_string_table(const std::string &language)
+{
+	const std::unique_lock<std::mutex> lock(s_string_tables_mutex);
+
+	if (const auto it = std::find_if(s_string_tables.cbegin(), s_string_tables.cend(),
+			[&language](const std::unique_ptr<string_table> &table) { return table->language == language; });
+		it != s_string_tables.cend())
+		return it->get();
+
+	std::vector<unsigned short> blocks;
+	enum_string_table_blocks(blocks);
+
+	auto table = std::make_unique<string_table>();
+	table->language = language;
+	table->strings = std::make_unique<const char *[]>(0x10000);
+
+	// Only convert all strings first, since appending to the data may reallocate it and invalidate any pointers into it
+	std::vector<std::pair<unsigned short, size_t>> offsets;
+	for (const unsigned short block : blocks)
+	{
+		for (unsigned short i = 0; i < 16; ++i)
+		{
+			const unsigned short id = static_cast<unsigned short>((block - 1) * 16 + i);
+
+			LPCWSTR s = nullptr;
+			const int length = LoadStringW(g_module_handle, id, reinterpret_cast<LPWSTR>(&s), 0);
+			if (length <= 0)
+				continue; // Not every slot in a block has to be used
+
+			offsets.emplace_back(id, table->data.size());
+			utf8::unchecked::utf16to8(s, s + length, std::back_inserter(table->data));
+			table->data.push_back('\0');
+		}
+	}
+
+	for (const std::pair<unsigned short, size_t> &offset : offsets)
+		table->strings[offset.first] = table->data.c_str() + offset.second;
+
+	s_string_tables.push_back(std::move(table));
+	return s_string_tables.back().get();
+}
+
+const char *reshade::resources::get_string(unsigned short id)
+{
+	if (s_current_string_table == nullptr)
+		s_current_string_table = get_string_table(get_thread_language());
+
+	const char *const s = s_current_string_table->strings[id];
+	assert(s != nullptr);
+	return s != nullptr ? s : "";
+}
+
 std::string reshade::resources::get_current_language()
 {
 	ULONG num = 0, size = 0;
@@ -83,6 +180,8 @@ std::string reshade::resources::set_current_language(const std::string &language
 
 	SetThreadPreferredUILanguages(MUI_LANGUAGE_NAME, languages.data(), &num);
 
+	s_current_string_table = get_string_table(language);
+
 	return prev_language;
 }
 
@@ -123,4 +222,27 @@ std::vector<std::string> reshade::resources::get_languages()
 
 	return languages;
 }
+
+std::string reshade::resources::load_all_strings()
+{
+	std::vector<unsigned short> blocks;
+	enum_string_table_blocks(blocks);
+
+	std::string result;
+
+	for (const unsigned short block : blocks)
+	{
+		for (unsigned short i = 0; i < 16; ++i)
+		{
+			LPCWSTR s = nullptr;
+			const int length = LoadStringW(g_module_handle, static_cast<UINT>((block - 1) * 16 + i), reinterpret_cast<LPWSTR>(&s), 0);
+			if (length <= 0)
+				continue; // Not every slot in a block has to be used
+
+			utf8::unchecked::utf16to8(s, s + length, std::back_inserter(result));
+		}
+	}
+
+	return result;
+}
 #endif
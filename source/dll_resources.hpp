@@ -28,10 +28,18 @@ namespace reshade::resources
 	/// </summary>
 	/// <param name="id">Resource identifier of the string resource.</param>
 	std::string load_string(unsigned short id);
-	template <unsigned short id>
-	inline std::string load_string() { return load_string(id); }
 
 #if RESHADE_LOCALIZATION
+	/// <summary>
+	/// Gets the localized string associated with the specified <paramref name="id"/> in the current language of the calling thread.
+	/// All strings of a language are loaded into a table once, the first time it is used, so this is only a lookup afterwards.
+	/// </summary>
+	/// <param name="id">Resource identifier of the string resource.</param>
+	/// <returns>Pointer to the null-terminated UTF-8 string, which stays valid for the lifetime of the module.</returns>
+	const char *get_string(unsigned short id);
+	template <unsigned short id>
+	inline const char *get_string() { return get_string(id); }
+
 	/// <summary>
 	/// Gets the preferred UI language used to look up resources for the current thread.
 	/// </summary>
@@ -47,5 +55,10 @@ namespace reshade::resources
 	/// Returns a list of languages for which a string table is embeded in the DLL resources.
 	/// </summary>
 	std::vector<std::string> get_languages();
+
+	/// <summary>
+	/// Loads all strings of the embedded string table in the current language and concatenates them, e.g. to find out which glyphs the UI needs.
+	/// </summary>
+	std::string load_all_strings();
 #endif
 }
@@ -9,6 +9,7 @@
 #include "d3d12/d3d12_command_queue.hpp"
 #include "dll_log.hpp" // Include late to get 'hr_to_string' helper function
 #include "com_utils.hpp"
+#include "ini_file.hpp"
 #include "hook_manager.hpp"
 #include "addon_manager.hpp"
 
@@ -261,6 +262,25 @@ static void dump_and_modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC1 &desc, [[maybe_
 #endif
 }
 
+static bool add_frame_latency_waitable_flag(DXGI_SWAP_EFFECT swap_effect, UINT &flags)
+{
+	bool use_waitable_object = false;
+	reshade::global_config().get("APP", "DXGIWaitableSwapChain", use_waitable_object);
+
+	// Leave swap chains alone on which the application already waits itself
+	if (!use_waitable_object || (flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT) != 0)
+		return false;
+	// The waitable object is only supported with the flip presentation model
+	if (swap_effect != DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL && swap_effect != DXGI_SWAP_EFFECT_FLIP_DISCARD)
+	{
+		reshade::log::message(reshade::log::level::warning, "Skipping frame latency waitable object because the swap chain does not use the flip presentation model.");
+		return false;
+	}
+
+	flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	return true;
+}
+
 UINT query_device(IUnknown *&device, com_ptr<IUnknown> &device_proxy)
 {
 	if (com_ptr<D3D10Device> device_d3d10;
@@ -314,7 +334,7 @@ UINT query_device(IUnknown *&device, com_ptr<IUnknown> &device_proxy)
 }
 
 template <typename T>
-static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com_ptr<IUnknown> &device_proxy, DXGI_USAGE usage, UINT sync_interval)
+static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com_ptr<IUnknown> &device_proxy, DXGI_USAGE usage, UINT sync_interval, bool added_waitable_flag)
 {
 	DXGISwapChain *swapchain_proxy = nullptr;
 
@@ -361,6 +381,9 @@ static void init_swapchain_proxy(T *&swapchain, UINT direct3d_version, const com
 		swapchain = swapchain_proxy;
 
 		swapchain_proxy->_sync_interval = sync_interval;
+
+		if (added_waitable_flag)
+			swapchain_proxy->enable_frame_latency_waitable_object();
 	}
 }
 
@@ -382,6 +405,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory_CreateSwapChain(IDXGIFactory *pFactory, I
 	DXGI_SWAP_CHAIN_DESC desc = *pDesc;
 	UINT sync_interval = UINT_MAX;
 	dump_and_modify_swapchain_desc(desc, sync_interval);
+	const bool added_waitable_flag = add_frame_latency_waitable_flag(desc.SwapEffect, desc.Flags);
 
 	com_ptr<IUnknown> device_proxy;
 	const UINT direct3d_version = query_device(pDevice, device_proxy);
@@ -395,7 +419,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory_CreateSwapChain(IDXGIFactory *pFactory, I
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval, added_waitable_flag);
 
 	return hr;
 }
@@ -423,6 +447,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForHwnd(IDXGIFactory2 *pF
 	else
 		fullscreen_desc.Windowed = TRUE;
 	dump_and_modify_swapchain_desc(desc, sync_interval, &fullscreen_desc, hWnd);
+	const bool added_waitable_flag = add_frame_latency_waitable_flag(desc.SwapEffect, desc.Flags);
 
 	com_ptr<IUnknown> device_proxy;
 	const UINT direct3d_version = query_device(pDevice, device_proxy);
@@ -436,7 +461,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForHwnd(IDXGIFactory2 *pF
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval, added_waitable_flag);
 
 	return hr;
 }
@@ -459,6 +484,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForCoreWindow(IDXGIFactor
 	UINT sync_interval = UINT_MAX;
 	// UWP applications cannot be set into fullscreen mode
 	dump_and_modify_swapchain_desc(desc, sync_interval);
+	const bool added_waitable_flag = add_frame_latency_waitable_flag(desc.SwapEffect, desc.Flags);
 
 	com_ptr<IUnknown> device_proxy;
 	const UINT direct3d_version = query_device(pDevice, device_proxy);
@@ -472,7 +498,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForCoreWindow(IDXGIFactor
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval, added_waitable_flag);
 
 	return hr;
 }
@@ -495,6 +521,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForComposition(IDXGIFacto
 	UINT sync_interval = UINT_MAX;
 	// Composition swap chains cannot be set into fullscreen mode
 	dump_and_modify_swapchain_desc(desc, sync_interval);
+	const bool added_waitable_flag = add_frame_latency_waitable_flag(desc.SwapEffect, desc.Flags);
 
 	com_ptr<IUnknown> device_proxy;
 	const UINT direct3d_version = query_device(pDevice, device_proxy);
@@ -508,7 +535,7 @@ HRESULT STDMETHODCALLTYPE IDXGIFactory2_CreateSwapChainForComposition(IDXGIFacto
 		return hr;
 	}
 
-	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval);
+	init_swapchain_proxy(*ppSwapChain, direct3d_version, device_proxy, desc.BufferUsage, sync_interval, added_waitable_flag);
 
 	return hr;
 }
@@ -13,8 +13,10 @@
 #include "d3d12/d3d12_command_queue.hpp"
 #include "d3d12/d3d12_impl_swapchain.hpp"
 #include "dll_log.hpp" // Include late to get 'hr_to_string' helper function
+#include "ini_file.hpp"
 #include "addon_manager.hpp"
 #include "runtime_manager.hpp"
+#include <chrono>
 
 #if RESHADE_ADDON
 extern bool modify_swapchain_desc(DXGI_SWAP_CHAIN_DESC &desc, UINT &sync_interval);
@@ -107,6 +109,9 @@ DXGISwapChain::~DXGISwapChain()
 	on_reset(false);
 	reshade::destroy_effect_runtime(_impl);
 
+	if (_frame_latency_waitable_object != nullptr)
+		CloseHandle(_frame_latency_waitable_object);
+
 	// Destroy effect runtime first to release all internal references to device objects
 	switch (_direct3d_version)
 	{
@@ -255,6 +260,8 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
 
 	handle_device_loss(hr);
 
+	wait_for_frame_latency(Flags, hr);
+
 	return hr;
 }
 HRESULT STDMETHODCALLTYPE DXGISwapChain::GetBuffer(UINT Buffer, REFIID riid, void **ppSurface)
@@ -350,6 +357,10 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeBuffers(UINT BufferCount, UINT Wi
 	}
 #endif
 
+	// The waitable object flag cannot be changed after creation, so keep it if it was added on creation without the application knowing
+	if (_frame_latency_waitable_object != nullptr)
+		SwapChainFlags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
 	const bool was_in_dxgi_runtime = g_in_dxgi_runtime;
 	g_in_dxgi_runtime = true;
 	const HRESULT hr = _orig->ResizeBuffers(BufferCount, Width, Height, NewFormat, SwapChainFlags);
@@ -430,6 +441,8 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present1(UINT SyncInterval, UINT Presen
 
 	handle_device_loss(hr);
 
+	wait_for_frame_latency(PresentFlags, hr);
+
 	return hr;
 }
 BOOL    STDMETHODCALLTYPE DXGISwapChain::IsTemporaryMonoSupported()
@@ -621,6 +634,9 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeBuffers1(UINT BufferCount, UINT W
 		query_device(present_queues[i], command_queue_proxy);
 	}
 
+	if (_frame_latency_waitable_object != nullptr)
+		SwapChainFlags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
 	assert(_interface_version >= 3);
 	const bool was_in_dxgi_runtime = g_in_dxgi_runtime;
 	g_in_dxgi_runtime = true;
@@ -840,3 +856,52 @@ void DXGISwapChain::handle_device_loss(HRESULT hr)
 		}
 	}
 }
+
+void DXGISwapChain::enable_frame_latency_waitable_object()
+{
+	com_ptr<IDXGISwapChain2> swapchain2;
+	if (FAILED(_orig->QueryInterface(&swapchain2)))
+		return;
+
+	UINT max_frame_latency = 1;
+	reshade::global_config().get("APP", "DXGIMaximumFrameLatency", max_frame_latency);
+	// Valid range of 'IDXGISwapChain2::SetMaximumFrameLatency' is 1 to 16
+	if (max_frame_latency < 1)
+		max_frame_latency = 1;
+	if (max_frame_latency > 16)
+		max_frame_latency = 16;
+
+	if (const HRESULT hr = swapchain2->SetMaximumFrameLatency(max_frame_latency); FAILED(hr))
+	{
+		reshade::log::message(reshade::log::level::warning, "Failed to set maximum frame latency of swap chain to %u with %s!", max_frame_latency, reshade::log::hr_to_string(hr).c_str());
+		return;
+	}
+
+	// The returned handle is owned by the caller and is closed again in the destructor
+	_frame_latency_waitable_object = swapchain2->GetFrameLatencyWaitableObject();
+	_max_frame_latency = max_frame_latency;
+
+	reshade::log::message(reshade::log::level::info, "Waiting on frame latency waitable object of swap chain with a maximum frame latency of %u.", max_frame_latency);
+}
+void DXGISwapChain::wait_for_frame_latency(UINT flags, HRESULT hr)
+{
+	// Only frames that were actually queued for presentation count towards the latency
+	if (_frame_latency_waitable_object == nullptr || (flags & DXGI_PRESENT_TEST) != 0 || FAILED(hr))
+		return;
+
+	// Number of presents that were queued, but not yet displayed
+	UINT queued_frames = 0;
+	UINT last_present_count = 0;
+	DXGI_FRAME_STATISTICS stats = {};
+	if (SUCCEEDED(_orig->GetLastPresentCount(&last_present_count)) && SUCCEEDED(_orig->GetFrameStatistics(&stats)) && last_present_count >= stats.PresentCount)
+		queued_frames = last_present_count - stats.PresentCount;
+
+	const auto wait_start = std::chrono::high_resolution_clock::now();
+
+	// Use a timeout, so that a stalled GPU or a lost device does not freeze the application
+	WaitForSingleObjectEx(_frame_latency_waitable_object, 1000, TRUE);
+
+	const auto wait_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - wait_start);
+
+	reshade::report_effect_runtime_frame_latency(_impl, queued_frames, _max_frame_latency, wait_time.count());
+}
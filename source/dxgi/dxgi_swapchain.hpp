@@ -88,6 +88,15 @@ struct DECLSPEC_UUID("1F445F9F-9887-4C4C-9055-4E3BADAFCCA8") DXGISwapChain final
 	void on_present(UINT flags, [[maybe_unused]] const DXGI_PRESENT_PARAMETERS *params = nullptr);
 	void handle_device_loss(HRESULT hr);
 
+	/// <summary>
+	/// Sets up waiting on the frame latency waitable object after a 'DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT' flag was added to the swap chain on creation.
+	/// </summary>
+	void enable_frame_latency_waitable_object();
+	/// <summary>
+	/// Measures the present queue and waits on the frame latency waitable object, so that the next frame does not start before the GPU has caught up.
+	/// </summary>
+	void wait_for_frame_latency(UINT flags, HRESULT hr);
+
 	bool check_and_upgrade_interface(REFIID riid);
 
 	IDXGISwapChain *_orig;
@@ -109,4 +118,8 @@ struct DECLSPEC_UUID("1F445F9F-9887-4C4C-9055-4E3BADAFCCA8") DXGISwapChain final
 	bool _was_still_drawing_last_frame = false;
 	UINT _sync_interval = UINT_MAX;
 	BOOL _current_fullscreen_state = -1;
+
+	// Frame latency waitable object of a swap chain that ReShade (rather than the application) added the 'DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT' flag to
+	HANDLE _frame_latency_waitable_object = nullptr;
+	UINT _max_frame_latency = 0;
 };
@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_cache.hpp"
+#include "dll_log.hpp"
+#include <vector>
+#include <algorithm> // std::sort
+#include <Windows.h>
+
+namespace
+{
+	constexpr uint32_t CACHE_MAGIC = 0x43465852; // 'RXFC'
+	constexpr uint32_t CACHE_VERSION = 1;
+
+	struct cache_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		// Offset to the table of contents, or zero if the archive was not closed properly and its contents are unreliable
+		uint64_t toc_offset;
+		uint32_t num_blobs;
+		uint32_t num_keys;
+		uint32_t use_counter;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(cache_header) == 32);
+
+	struct cache_blob_entry
+	{
+		uint64_t content_hash;
+		uint64_t offset;
+		uint32_t size;
+		uint32_t last_use;
+	};
+	static_assert(sizeof(cache_blob_entry) == 24);
+
+	struct cache_key_entry
+	{
+		uint64_t key_hash;
+		uint64_t content_hash;
+	};
+	static_assert(sizeof(cache_key_entry) == 16);
+
+	uint64_t compute_hash(const void *data, size_t size)
+	{
+		// 64-bit FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ static_cast<const uint8_t *>(data)[i]) * 1099511628211ull;
+		return hash;
+	}
+}
+
+bool reshade::effect_cache::open(const std::filesystem::path &path, uint64_t max_size)
+{
+	close();
+
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_file = nullptr;
+		log::message(log::level::warning, "Failed to open effect cache archive '%s' with error code %lu!", path.u8string().c_str(), GetLastError());
+		return false;
+	}
+
+	_path = path;
+	_max_size = max_size;
+
+	LARGE_INTEGER file_size = {};
+	GetFileSizeEx(_file, &file_size);
+
+	bool valid = false;
+
+	if (static_cast<uint64_t>(file_size.QuadPart) >= sizeof(cache_header) && map_view(file_size.QuadPart))
+	{
+		const cache_header &header = *reinterpret_cast<const cache_header *>(_view);
+
+		if (header.magic == CACHE_MAGIC && header.version == CACHE_VERSION && header.toc_offset >= sizeof(cache_header) &&
+			header.toc_offset + static_cast<uint64_t>(header.num_blobs) * sizeof(cache_blob_entry) + static_cast<uint64_t>(header.num_keys) * sizeof(cache_key_entry) <= _view_size)
+		{
+			valid = true;
+
+			const auto blob_entries = reinterpret_cast<const cache_blob_entry *>(_view + header.toc_offset);
+			for (uint32_t i = 0; i < header.num_blobs; ++i)
+			{
+				const cache_blob_entry &entry = blob_entries[i];
+				if (entry.offset < sizeof(cache_header) || entry.offset + entry.size > header.toc_offset)
+				{
+					valid = false;
+					break;
+				}
+
+				_blobs[entry.content_hash] = { entry.offset, entry.size, entry.last_use, 0 };
+			}
+
+			const auto key_entries = reinterpret_cast<const cache_key_entry *>(blob_entries + header.num_blobs);
+			for (uint32_t i = 0; i < header.num_keys && valid; ++i)
+			{
+				const cache_key_entry &entry = key_entries[i];
+				if (const auto it = _blobs.find(entry.content_hash); it != _blobs.end())
+				{
+					it->second.ref_count++;
+					_keys[entry.key_hash] = entry.content_hash;
+				}
+			}
+
+			_data_end = header.toc_offset;
+			_use_counter = header.use_counter;
+		}
+	}
+
+	if (!valid)
+	{
+		if (file_size.QuadPart != 0)
+			log::message(log::level::warning, "Effect cache archive '%s' is invalid or was not closed properly, discarding its contents.", path.u8string().c_str());
+
+		_keys.clear();
+		_blobs.clear();
+		_use_counter = 0;
+
+		unmap_view();
+
+		_data_end = sizeof(cache_header);
+
+		const cache_header header = { CACHE_MAGIC, CACHE_VERSION, 0 };
+		if (!write_at(0, &header, sizeof(header)) || !SetEndOfFile(_file))
+		{
+			log::message(log::level::warning, "Failed to initialize effect cache archive '%s' with error code %lu!", path.u8string().c_str(), GetLastError());
+			close_handles();
+			return false;
+		}
+
+		// Header was written with a zero offset to the table of contents already
+		_modified = true;
+	}
+
+	// Blobs that are no longer referenced by any key are dropped and their space reclaimed during the next compaction
+	_live_size = 0;
+	for (auto it = _blobs.begin(); it != _blobs.end();)
+	{
+		if (it->second.ref_count == 0)
+		{
+			it = _blobs.erase(it);
+			continue;
+		}
+
+		_live_size += it->second.size;
+		++it;
+	}
+
+	return true;
+}
+
+void reshade::effect_cache::close()
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_file == nullptr)
+		return;
+
+	evict_and_compact();
+	write_toc();
+
+	close_handles();
+}
+
+void reshade::effect_cache::flush()
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_file == nullptr || !_modified)
+		return;
+
+	write_toc();
+}
+
+bool reshade::effect_cache::write_toc()
+{
+	// Views of the file prevent it from being truncated, so release them before writing the table of contents
+	unmap_view();
+
+	std::vector<cache_blob_entry> blob_entries;
+	blob_entries.reserve(_blobs.size());
+	for (const auto &[content_hash, entry] : _blobs)
+		blob_entries.push_back({ content_hash, entry.offset, entry.size, entry.last_use });
+
+	std::vector<cache_key_entry> key_entries;
+	key_entries.reserve(_keys.size());
+	for (const auto &[key_hash, content_hash] : _keys)
+		key_entries.push_back({ key_hash, content_hash });
+
+	// Invalidate the header before overwriting anything, in case there is a table of contents at the end of the data section already
+	if ((_modified || invalidate_header()) &&
+		write_at(_data_end, blob_entries.data(), blob_entries.size() * sizeof(cache_blob_entry)) &&
+		write_at(_data_end + blob_entries.size() * sizeof(cache_blob_entry), key_entries.data(), key_entries.size() * sizeof(cache_key_entry)) &&
+		SetEndOfFile(_file))
+	{
+		// Only make the table of contents visible once it was written completely
+		const cache_header header = { CACHE_MAGIC, CACHE_VERSION, _data_end, static_cast<uint32_t>(blob_entries.size()), static_cast<uint32_t>(key_entries.size()), _use_counter };
+		if (write_at(0, &header, sizeof(header)))
+		{
+			_modified = false;
+			return true;
+		}
+	}
+
+	log::message(log::level::warning, "Failed to write table of contents to effect cache archive '%s' with error code %lu!", _path.u8string().c_str(), GetLastError());
+	return false;
+}
+
+bool reshade::effect_cache::load(const std::string &key, std::string &data)
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_file == nullptr)
+		return false;
+
+	const auto key_it = _keys.find(compute_hash(key.data(), key.size()));
+	if (key_it == _keys.end())
+		return false;
+
+	blob &entry = _blobs.at(key_it->second);
+
+	// Blob may have been appended after the current view was created
+	if (!map_view(entry.offset + entry.size))
+		return false;
+
+	data.assign(reinterpret_cast<const char *>(_view + entry.offset), entry.size);
+
+	entry.last_use = ++_use_counter;
+
+	return true;
+}
+
+bool reshade::effect_cache::save(const std::string &key, const std::string &data)
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_file == nullptr || data.size() > UINT32_MAX)
+		return false;
+
+	const uint64_t key_hash = compute_hash(key.data(), key.size());
+	const uint64_t content_hash = compute_hash(data.data(), data.size()) ^ data.size();
+
+	if (const auto key_it = _keys.find(key_hash); key_it != _keys.end())
+	{
+		if (key_it->second == content_hash)
+		{
+			_blobs.at(content_hash).last_use = ++_use_counter;
+			return true;
+		}
+
+		// Release the blob previously referenced by this key
+		if (const auto blob_it = _blobs.find(key_it->second); --blob_it->second.ref_count == 0)
+		{
+			_live_size -= blob_it->second.size;
+			_blobs.erase(blob_it);
+		}
+
+		_keys.erase(key_it);
+	}
+
+	if (const auto blob_it = _blobs.find(content_hash); blob_it != _blobs.end())
+	{
+		// Identical data is stored already, so simply add another reference to it
+		blob_it->second.ref_count++;
+		blob_it->second.last_use = ++_use_counter;
+	}
+	else
+	{
+		// Appending data overwrites the table of contents on disk, so invalidate it first
+		if (!_modified && !invalidate_header())
+			return false;
+
+		if (!write_at(_data_end, data.data(), data.size()))
+			return false;
+
+		_blobs[content_hash] = { _data_end, static_cast<uint32_t>(data.size()), ++_use_counter, 1 };
+		_data_end += data.size();
+		_live_size += data.size();
+	}
+
+	_keys[key_hash] = content_hash;
+
+	return true;
+}
+
+bool reshade::effect_cache::clear()
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_file == nullptr)
+		return false;
+
+	unmap_view();
+
+	_keys.clear();
+	_blobs.clear();
+	_data_end = sizeof(cache_header);
+	_live_size = 0;
+
+	const cache_header header = { CACHE_MAGIC, CACHE_VERSION, 0 };
+	if (!write_at(0, &header, sizeof(header)) || !SetEndOfFile(_file))
+	{
+		log::message(log::level::error, "Failed to clear effect cache archive '%s' with error code %lu!", _path.u8string().c_str(), GetLastError());
+		return false;
+	}
+
+	_modified = true;
+
+	return true;
+}
+
+bool reshade::effect_cache::map_view(uint64_t required_size)
+{
+	if (_view != nullptr && _view_size >= required_size)
+		return true;
+
+	unmap_view();
+
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(_file, &file_size) || static_cast<uint64_t>(file_size.QuadPart) < required_size || file_size.QuadPart == 0)
+		return false;
+
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+		return false;
+
+	_view = static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_view == nullptr)
+	{
+		log::message(log::level::warning, "Failed to map effect cache archive '%s' with error code %lu!", _path.u8string().c_str(), GetLastError());
+		unmap_view();
+		return false;
+	}
+
+	_view_size = file_size.QuadPart;
+
+	return true;
+}
+
+void reshade::effect_cache::unmap_view()
+{
+	if (_view != nullptr)
+		UnmapViewOfFile(_view);
+	_view = nullptr;
+	_view_size = 0;
+
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	_mapping = nullptr;
+}
+
+bool reshade::effect_cache::write_at(uint64_t offset, const void *data, size_t size)
+{
+	LARGE_INTEGER position;
+	position.QuadPart = offset;
+	if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN))
+		return false;
+
+	while (size != 0)
+	{
+		const DWORD chunk_size = static_cast<DWORD>(size < 0x10000000 ? size : 0x10000000);
+
+		DWORD size_written = 0;
+		if (!WriteFile(_file, data, chunk_size, &size_written, nullptr) || size_written != chunk_size)
+			return false;
+
+		data = static_cast<const uint8_t *>(data) + chunk_size;
+		size -= chunk_size;
+	}
+
+	return true;
+}
+
+bool reshade::effect_cache::invalidate_header()
+{
+	const cache_header header = { CACHE_MAGIC, CACHE_VERSION, 0 };
+	if (!write_at(0, &header, sizeof(header)))
+		return false;
+
+	_modified = true;
+	return true;
+}
+
+void reshade::effect_cache::evict_and_compact()
+{
+	// Evict least recently used blobs until the archive is well below its size limit again, so that this does not have to happen on every close
+	if (_max_size != 0 && _live_size > _max_size)
+	{
+		std::vector<std::pair<uint32_t, uint64_t>> lru_order;
+		lru_order.reserve(_blobs.size());
+		for (const auto &[content_hash, entry] : _blobs)
+			lru_order.emplace_back(entry.last_use, content_hash);
+		std::sort(lru_order.begin(), lru_order.end());
+
+		for (size_t i = 0; i < lru_order.size() && _live_size > (_max_size / 4) * 3; ++i)
+		{
+			const auto blob_it = _blobs.find(lru_order[i].second);
+			_live_size -= blob_it->second.size;
+			_blobs.erase(blob_it);
+		}
+
+		for (auto it = _keys.begin(); it != _keys.end();)
+		{
+			if (_blobs.find(it->second) == _blobs.end())
+				it = _keys.erase(it);
+			else
+				++it;
+		}
+	}
+
+	// Only compact when a significant portion of the data section is unreferenced
+	const uint64_t data_size = _data_end - sizeof(cache_header);
+	if (data_size - _live_size <= data_size / 4)
+		return;
+
+	if (!_modified && !invalidate_header())
+		return;
+
+	if (!_blobs.empty() && !map_view(_data_end))
+		return;
+
+	std::vector<blob *> blobs_by_offset;
+	blobs_by_offset.reserve(_blobs.size());
+	for (auto &[content_hash, entry] : _blobs)
+		blobs_by_offset.push_back(&entry);
+	std::sort(blobs_by_offset.begin(), blobs_by_offset.end(), [](const blob *lhs, const blob *rhs) { return lhs->offset < rhs->offset; });
+
+	// Move all blobs towards the start of the data section, which never overwrites a blob that was not moved yet
+	std::string buffer;
+	uint64_t offset = sizeof(cache_header);
+	for (blob *const entry : blobs_by_offset)
+	{
+		if (entry->offset != offset)
+		{
+			buffer.assign(reinterpret_cast<const char *>(_view + entry->offset), entry->size);
+			if (!write_at(offset, buffer.data(), buffer.size()))
+			{
+				// Archive is in an inconsistent state now, so drop everything
+				_keys.clear();
+				_blobs.clear();
+				_live_size = 0;
+				_data_end = sizeof(cache_header);
+				return;
+			}
+
+			entry->offset = offset;
+		}
+
+		offset += entry->size;
+	}
+
+	_data_end = offset;
+}
+
+void reshade::effect_cache::close_handles()
+{
+	unmap_view();
+
+	CloseHandle(_file);
+	_file = nullptr;
+
+	_path.clear();
+	_keys.clear();
+	_blobs.clear();
+	_data_end = 0;
+	_live_size = 0;
+	_use_counter = 0;
+	_modified = false;
+}
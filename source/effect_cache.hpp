@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// A single-file archive of cached effect data (preprocessed source and compiled shader blobs).
+	/// Entries are addressed by the hash of their contents, so identical data referenced by multiple keys is only stored once.
+	/// The archive is memory-mapped for reading, new entries are appended and the table of contents is written back on <see cref="close"/>.
+	/// </summary>
+	class effect_cache
+	{
+	public:
+		effect_cache() = default;
+		~effect_cache() { close(); }
+
+		effect_cache(const effect_cache &) = delete;
+		effect_cache &operator=(const effect_cache &) = delete;
+
+		/// <summary>
+		/// Opens or creates the cache archive at the specified <paramref name="path"/>.
+		/// </summary>
+		/// <param name="path">File path to the archive.</param>
+		/// <param name="max_size">Size in bytes at which least recently used entries are evicted, or zero for no limit.</param>
+		/// <returns><see langword="true"/> if the archive was opened successfully, <see langword="false"/> otherwise.</returns>
+		bool open(const std::filesystem::path &path, uint64_t max_size);
+		/// <summary>
+		/// Writes the table of contents, evicts least recently used entries if the archive exceeds its size limit and closes it.
+		/// </summary>
+		void close();
+		/// <summary>
+		/// Writes the table of contents, so that entries saved so far survive the application terminating without calling <see cref="close"/>.
+		/// </summary>
+		void flush();
+
+		/// <summary>
+		/// Gets the current path of the archive, or an empty path if it is not open.
+		/// </summary>
+		std::filesystem::path path() const { const std::unique_lock<std::mutex> lock(_mutex); return _path; }
+
+		/// <summary>
+		/// Looks up the data stored for the specified <paramref name="key"/>.
+		/// </summary>
+		/// <param name="key">Unique identifier of the entry.</param>
+		/// <param name="data">Receives a copy of the stored data.</param>
+		/// <returns><see langword="true"/> if an entry was found, <see langword="false"/> otherwise.</returns>
+		bool load(const std::string &key, std::string &data);
+		/// <summary>
+		/// Stores <paramref name="data"/> under the specified <paramref name="key"/>, replacing any previous entry.
+		/// </summary>
+		/// <param name="key">Unique identifier of the entry.</param>
+		/// <param name="data">Data to store.</param>
+		/// <returns><see langword="true"/> if the data was stored successfully, <see langword="false"/> otherwise.</returns>
+		bool save(const std::string &key, const std::string &data);
+
+		/// <summary>
+		/// Removes all entries and truncates the archive.
+		/// </summary>
+		/// <returns><see langword="true"/> if the archive was cleared successfully, <see langword="false"/> otherwise.</returns>
+		bool clear();
+
+	private:
+		struct blob
+		{
+			uint64_t offset;
+			uint32_t size;
+			uint32_t last_use;
+			uint32_t ref_count;
+		};
+
+		bool map_view(uint64_t required_size);
+		void unmap_view();
+		bool write_at(uint64_t offset, const void *data, size_t size);
+		bool invalidate_header();
+		bool write_toc();
+		void evict_and_compact();
+		void close_handles();
+
+		mutable std::mutex _mutex;
+		std::filesystem::path _path;
+		uint64_t _max_size = 0;
+
+		void *_file = nullptr;
+		void *_mapping = nullptr;
+		const uint8_t *_view = nullptr;
+		uint64_t _view_size = 0;
+
+		// End of the data section, new blobs are appended here
+		uint64_t _data_end = 0;
+		// Sum of the sizes of all blobs that are still referenced
+		uint64_t _live_size = 0;
+		uint32_t _use_counter = 0;
+		// Set once the table of contents on disk no longer matches the in-memory state
+		bool _modified = false;
+
+		std::unordered_map<uint64_t, uint64_t> _keys; // Key hash -> content hash
+		std::unordered_map<uint64_t, blob> _blobs; // Content hash -> blob
+	};
+}
@@ -8,6 +8,7 @@
 #include "effect_module.hpp"
 #include <memory> // std::unique_ptr
 #include <algorithm> // std::find_if
+#include <memory_resource>
 
 namespace reshadefx
 {
@@ -28,6 +29,10 @@ namespace reshadefx
 		/// Gets the module describing the generated code.
 		/// </summary>
 		const effect_module &module() const { return _module; }
+		/// <summary>
+		/// Gets the number of functions that were defined in the generated code.
+		/// </summary>
+		size_t function_count() const { return _functions.size(); }
 
 		/// <summary>
 		/// Finalizes and returns the generated code for the entire module (all entry points).
@@ -373,6 +378,9 @@ namespace reshadefx
 
 		id make_id() { return _next_id++; }
 
+		// Arena for bookkeeping data that only lives as long as the code generator (per-block code, names, ...), which is released in one go when it is destroyed
+		std::pmr::monotonic_buffer_resource _arena { 64 * 1024 };
+
 		effect_module _module;
 		std::vector<struct_type> _structs;
 		std::vector<std::unique_ptr<function>> _functions;
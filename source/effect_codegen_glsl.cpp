@@ -60,8 +60,8 @@ private:
 	bool _enable_16bit_types = false;
 	bool _flip_vert_y = false;
 
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::pmr::unordered_map<id, std::string> _names { &_arena };
+	std::pmr::unordered_map<id, std::string> _blocks { &_arena };
 	std::string _ubo_block;
 	std::string _compute_block;
 	std::string _current_function_declaration;
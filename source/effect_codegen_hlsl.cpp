@@ -54,10 +54,10 @@ private:
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::pmr::unordered_map<id, std::string> _names { &_arena };
+	std::pmr::unordered_map<id, std::string> _blocks { &_arena };
 	std::string _cbuffer_block;
-	std::string _current_location;
+	interned_string _current_location;
 	std::string _current_function_declaration;
 
 	std::string _remapped_semantics[15];
@@ -607,11 +607,11 @@ private:
 		// Avoid writing the file name every time to reduce output text size
 		if constexpr (force_source)
 		{
-			s += " \"" + loc.source + '\"';
+			s += " \"" + loc.source.str() + '\"';
 		}
 		else if (loc.source != _current_location)
 		{
-			s += " \"" + loc.source + '\"';
+			s += " \"" + loc.source.str() + '\"';
 
 			_current_location = loc.source;
 		}
@@ -981,16 +981,23 @@ private:
 				info.size = align_up(info.size, 16, info.type.array_length);
 
 			if (_shader_model < 40)
-				_module.total_uniform_size /= 4;
-
-			// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
-			// This is already guaranteed, since all types are at least 4-byte in size
-			info.offset = _module.total_uniform_size;
-			// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
-			const uint32_t remaining = 16 - (info.offset & 15);
-			if (remaining != 16 && info.size > remaining)
-				info.offset += remaining;
-			_module.total_uniform_size = info.offset + info.size;
+			{
+				// Constant registers cannot be shared between variables in shader model 3, so every uniform starts at the next free register and occupies only as many registers as it needs
+				// That is one for scalars and vectors, one per row for matrices and one per element for arrays, which is the same layout the size was calculated with above
+				info.offset = (_module.total_uniform_size + 15) & ~15u;
+				_module.total_uniform_size = info.offset + ((info.size + 15) & ~15u);
+			}
+			else
+			{
+				// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
+				// This is already guaranteed, since all types are at least 4-byte in size
+				info.offset = _module.total_uniform_size;
+				// Additionally, HLSL packs data so that it does not cross a 16-byte boundary
+				const uint32_t remaining = 16 - (info.offset & 15);
+				if (remaining != 16 && info.size > remaining)
+					info.offset += remaining;
+				_module.total_uniform_size = info.offset + info.size;
+			}
 
 			write_location<true>(_cbuffer_block, loc);
 
@@ -1005,10 +1012,6 @@ private:
 				// The HLSL compiler tries to evaluate boolean values with temporary registers, which breaks branches, so force it to use constant float registers
 				if (type.is_boolean())
 					type.base = type::t_float;
-
-				// Simply put each uniform into a separate constant register in shader model 3 for now
-				info.offset *= 4;
-				_module.total_uniform_size *= 4;
 			}
 
 			write_type(_cbuffer_block, type);
@@ -221,7 +221,7 @@ private:
 
 		spv::Id file;
 
-		if (const auto it = _string_lookup.find(loc.source);
+		if (const auto it = _string_lookup.find(loc.source.str());
 			it != _string_lookup.end())
 		{
 			file = it->second;
@@ -231,7 +231,7 @@ private:
 			file =
 				add_instruction(spv::OpString, 0, _debug_a)
 					.add_string(loc.source.c_str());
-			_string_lookup.emplace(loc.source, file);
+			_string_lookup.emplace(loc.source.str(), file);
 		}
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpLine
@@ -388,8 +388,35 @@ private:
 			return {};
 
 		// Build list of IDs to remove
-		std::vector<spv::Id> variables_to_remove;
-		std::vector<spv::Id> functions_to_remove;
+		std::unordered_set<spv::Id> ids_to_remove;
+
+		// Remove all functions that cannot be reached from this entry point, together with everything they define (parameters, local variables, ...)
+		for (const function_blocks &function : _functions_blocks)
+		{
+			const spv::Id definition = function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0].result;
+
+			if (definition == entry_point->id ||
+				std::find(entry_point->referenced_functions.begin(), entry_point->referenced_functions.end(), definition) != entry_point->referenced_functions.end())
+				continue;
+
+			for (const spirv_instruction &inst : function.declaration.instructions)
+				if (inst.result != 0)
+					ids_to_remove.insert(inst.result);
+			for (const spirv_instruction &inst : function.variables.instructions)
+				if (inst.result != 0)
+					ids_to_remove.insert(inst.result);
+			for (const spirv_instruction &inst : function.definition.instructions)
+				if (inst.result != 0)
+					ids_to_remove.insert(inst.result);
+		}
+
+		// Remove all sampler and storage bindings that are not referenced by this entry point, so that they do not take up descriptor slots
+		for (const sampler &info : _module.samplers)
+			if (std::find(entry_point->referenced_samplers.begin(), entry_point->referenced_samplers.end(), info.id) == entry_point->referenced_samplers.end())
+				ids_to_remove.insert(info.id);
+		for (const storage &info : _module.storages)
+			if (std::find(entry_point->referenced_storages.begin(), entry_point->referenced_storages.end(), info.id) == entry_point->referenced_storages.end())
+				ids_to_remove.insert(info.id);
 
 		std::basic_string<char> spirv;
 		finalize_header_section(spirv);
@@ -406,11 +433,11 @@ private:
 			}
 			else
 			{
-				functions_to_remove.push_back(inst.operands[1]);
+				ids_to_remove.insert(inst.operands[1]);
 
 				// Add interface variables to list of variables to remove
 				for (uint32_t k = 2 + static_cast<uint32_t>((std::strlen(reinterpret_cast<const char *>(&inst.operands[2])) + 4) / 4); k < inst.operands.size(); ++k)
-					variables_to_remove.push_back(inst.operands[k]);
+					ids_to_remove.insert(inst.operands[k]);
 			}
 		}
 
@@ -429,9 +456,8 @@ private:
 
 		for (const spirv_instruction &inst : _debug_b.instructions)
 		{
-			// Remove all names of interface variables and functions for non-matching entry points
-			if (std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.operands[0]) != variables_to_remove.end() ||
-				std::find(functions_to_remove.begin(), functions_to_remove.end(), inst.operands[0]) != functions_to_remove.end())
+			// Remove all names of removed variables and functions
+			if (ids_to_remove.find(inst.operands[0]) != ids_to_remove.end())
 				continue;
 
 			inst.write(spirv);
@@ -442,8 +468,8 @@ private:
 		{
 			if (inst.op == spv::OpDecorate)
 			{
-				// Remove all decorations targeting any of the interface variables for non-matching entry points
-				if (std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.operands[0]) != variables_to_remove.end())
+				// Remove all decorations targeting any of the removed variables
+				if (ids_to_remove.find(inst.operands[0]) != ids_to_remove.end())
 					continue;
 
 				// Replace bindings
@@ -466,8 +492,8 @@ private:
 
 		for (const spirv_instruction &inst : _variables.instructions)
 		{
-			// Remove all declarations of the interface variables for non-matching entry points
-			if (inst.op == spv::OpVariable && std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.result) != variables_to_remove.end())
+			// Remove all declarations of removed variables
+			if (inst.op == spv::OpVariable && ids_to_remove.find(inst.result) != ids_to_remove.end())
 				continue;
 
 			inst.write(spirv);
@@ -482,7 +508,7 @@ private:
 			assert(function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0].op == spv::OpFunction);
 			const spv::Id definition = function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0].result;
 
-			if (std::find(functions_to_remove.begin(), functions_to_remove.end(), definition) != functions_to_remove.end())
+			if (ids_to_remove.find(definition) != ids_to_remove.end())
 				continue;
 
 			for (const spirv_instruction &inst : function.declaration.instructions)
@@ -1010,17 +1036,16 @@ private:
 
 			add_name(res, info.name.c_str());
 
-			const auto add_spec_constant = [this](const spirv_instruction &inst, const uniform &info, const constant &initializer_value, size_t initializer_offset) {
+			// Each scalar keeps the type of the uniform it was split from, with the offset being the index of its component in the flattened value, so that the runtime can combine them again
+			const auto add_spec_constant = [this](const spirv_instruction &inst, const uniform &info, const constant &initializer_value, size_t array_index, size_t initializer_offset) {
 				assert(inst.op == spv::OpSpecConstant || inst.op == spv::OpSpecConstantTrue || inst.op == spv::OpSpecConstantFalse);
 
 				const uint32_t spec_id = static_cast<uint32_t>(_module.spec_constants.size());
 				add_decoration(inst, spv::DecorationSpecId, { spec_id });
 
 				uniform scalar_info = info;
-				scalar_info.type.rows = 1;
-				scalar_info.type.cols = 1;
 				scalar_info.size = 4;
-				scalar_info.offset = static_cast<uint32_t>(initializer_offset);
+				scalar_info.offset = static_cast<uint32_t>(array_index * info.type.components() + initializer_offset);
 				scalar_info.initializer_value = {};
 				scalar_info.initializer_value.as_uint[0] = initializer_value.as_uint[initializer_offset];
 
@@ -1033,7 +1058,7 @@ private:
 			// External specialization constants need to be scalars
 			if (info.type.is_scalar())
 			{
-				add_spec_constant(base_inst, info, info.initializer_value, 0);
+				add_spec_constant(base_inst, info, info.initializer_value, 0, 0);
 			}
 			else
 			{
@@ -1061,7 +1086,7 @@ private:
 
 						if (row_inst.op != spv::OpSpecConstantComposite)
 						{
-							add_spec_constant(row_inst, info, initializer_value, row);
+							add_spec_constant(row_inst, info, initializer_value, i, row);
 							continue;
 						}
 
@@ -1070,7 +1095,7 @@ private:
 							const spirv_instruction &col_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
 								[operand_id = row_inst.operands[col]](const spirv_instruction &inst) { return inst == operand_id; });
 
-							add_spec_constant(col_inst, info, initializer_value, row * info.type.cols + col);
+							add_spec_constant(col_inst, info, initializer_value, i, row * info.type.cols + col);
 						}
 					}
 				}
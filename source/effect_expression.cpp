@@ -407,13 +407,45 @@ void reshadefx::expression::add_swizzle_access(const signed char swizzle[4], uns
 			constant.as_uint[i] = data[swizzle[i]];
 		std::memset(&constant.as_uint[length], 0, sizeof(uint32_t) * (16 - length)); // Clear the rest of the constant
 	}
-	else if (length == 1 && prev_type.is_vector()) // Use indexing when possible since the code generation logic is simpler in SPIR-V
-	{
-		chain.push_back({ operation::op_constant_index, prev_type, type, static_cast<uint32_t>(swizzle[0]) });
-	}
 	else
 	{
-		chain.push_back({ operation::op_swizzle, prev_type, type, 0, { swizzle[0], swizzle[1], swizzle[2], swizzle[3] } });
+		struct type source_type = prev_type;
+		signed char combined_swizzle[4] = { -1, -1, -1, -1 };
+		for (unsigned int i = 0; i < length; ++i)
+			combined_swizzle[i] = swizzle[i];
+
+		// Merge with a previous swizzle or vector element access, so that multiple swizzles in a row (e.g. 'v.zyx.xy') become a single one (e.g. 'v.zy')
+		if (!chain.empty() && chain.back().op == operation::op_swizzle)
+		{
+			source_type = chain.back().from;
+			for (unsigned int i = 0; i < length; ++i)
+				combined_swizzle[i] = chain.back().swizzle[swizzle[i]];
+			chain.pop_back();
+		}
+		else if (!chain.empty() && chain.back().op == operation::op_constant_index && chain.back().from.is_vector() && prev_type.is_scalar())
+		{
+			source_type = chain.back().from;
+			for (unsigned int i = 0; i < length; ++i)
+				combined_swizzle[i] = static_cast<signed char>(chain.back().index);
+			chain.pop_back();
+		}
+
+		bool is_identity = source_type.is_vector() && source_type.rows == length;
+		for (unsigned int i = 0; i < length && is_identity; ++i)
+			is_identity = combined_swizzle[i] == static_cast<signed char>(i);
+
+		if (is_identity) // Swizzle selecting all components of a vector in order does not do anything (e.g. 'v.xyz' for a three-component vector)
+		{
+			assert(source_type.rows == type.rows && source_type.cols == type.cols);
+		}
+		else if (length == 1 && source_type.is_vector()) // Use indexing when possible since the code generation logic is simpler in SPIR-V
+		{
+			chain.push_back({ operation::op_constant_index, source_type, type, static_cast<uint32_t>(combined_swizzle[0]) });
+		}
+		else
+		{
+			chain.push_back({ operation::op_swizzle, source_type, type, 0, { combined_swizzle[0], combined_swizzle[1], combined_swizzle[2], combined_swizzle[3] } });
+		}
 	}
 }
 
@@ -624,3 +656,50 @@ bool reshadefx::expression::evaluate_constant_expression(reshadefx::tokenid op,
 
 	return true;
 }
+
+bool reshadefx::expression::is_identity_element(reshadefx::tokenid op, bool is_rhs) const
+{
+	if (!is_constant || !type.is_numeric() || type.is_boolean() || type.is_array())
+		return false;
+
+	int identity;
+	switch (op)
+	{
+	case tokenid::plus:
+	case tokenid::pipe:
+	case tokenid::caret:
+		identity = 0;
+		break;
+	case tokenid::less_less:
+	case tokenid::greater_greater:
+		if (!type.is_integral())
+			return false;
+		[[fallthrough]];
+	case tokenid::minus:
+		if (!is_rhs)
+			return false;
+		identity = 0;
+		break;
+	case tokenid::star:
+		identity = 1;
+		break;
+	case tokenid::slash:
+		if (!is_rhs)
+			return false;
+		identity = 1;
+		break;
+	case tokenid::ampersand:
+		identity = -1;
+		break;
+	default:
+		return false;
+	}
+
+	for (unsigned int i = 0; i < type.components(); ++i)
+	{
+		if (type.is_floating_point() ? constant.as_float[i] != static_cast<float>(identity) : constant.as_int[i] != identity)
+			return false;
+	}
+
+	return true;
+}
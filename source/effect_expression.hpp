@@ -247,5 +247,12 @@ namespace reshadefx
 		/// <param name="op">Binary operator to apply.</param>
 		/// <param name="rhs">Constant value to use as right-hand side of the binary operation.</param>
 		bool evaluate_constant_expression(reshadefx::tokenid op, const reshadefx::constant &rhs);
+
+		/// <summary>
+		/// Checks whether this constant expression is the identity element of a binary operation, so that the operation would just return the other operand (e.g. 'x * 1' or 'x + 0').
+		/// </summary>
+		/// <param name="op">Binary operator to check.</param>
+		/// <param name="is_rhs">Set to <see langword="true"/> if this expression is the right-hand side of the binary operation, <see langword="false"/> if it is the left-hand side.</param>
+		bool is_identity_element(reshadefx::tokenid op, bool is_rhs) const;
 	};
 }
@@ -4,9 +4,17 @@
  */
 
 #include "effect_lexer.hpp"
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
 #include <cassert>
 #include <string_view>
 #include <unordered_map> // Used for static lookup tables
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <emmintrin.h>
+#define RESHADEFX_LEXER_SSE2 1
+#endif
 
 using namespace reshadefx;
 
@@ -502,6 +510,162 @@ static long long octal_to_decimal(long long n)
 	return n;
 }
 
+// Long runs of whitespace, comment text and identifier characters are scanned 16 bytes at a time (SSE2 is always available on the x86 platforms)
+// Each block is only loaded if it lies completely within the input, the remaining characters are then handled by the scalar loops as before
+#if RESHADEFX_LEXER_SSE2
+static inline __m128i is_in_range(__m128i v, char lo, char hi)
+{
+	// Unsigned range check via a signed comparison after moving the range to the start of the signed value range
+	return _mm_cmplt_epi8(
+		_mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - lo))),
+		_mm_set1_epi8(static_cast<char>(0x80 + (hi - lo) + 1)));
+}
+static inline unsigned int find_first_set(int mask)
+{
+	// Set bit 16 as well, so that this returns 16 if no character in the block was flagged in the movemask result
+	unsigned long index;
+	_BitScanForward(&index, static_cast<unsigned long>(mask) | 0x10000);
+	return static_cast<unsigned int>(index);
+}
+
+static inline __m128i is_space(__m128i v)
+{
+	// Matches the characters of type SPACE in the lookup table, which are ' ', '\t', '\v', '\f' and '\r' (but not '\n')
+	return _mm_or_si128(
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+		_mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), is_in_range(v, '\t', '\r')));
+}
+static inline __m128i is_identifier(__m128i v)
+{
+	// Matches the characters of type IDENT or DIGIT in the lookup table
+	return _mm_or_si128(
+		_mm_or_si128(is_in_range(v, '0', '9'), is_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z')),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+#endif
+
+static const char *skip_space_characters(const char *cur, const char *end)
+{
+#if RESHADEFX_LEXER_SSE2
+	for (unsigned int n; end - cur >= 16; cur += n)
+		if ((n = find_first_set(_mm_movemask_epi8(is_space(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cur)))) ^ 0xFFFF)) != 16)
+			return cur + n;
+#endif
+	while (cur < end && s_type_lookup[uint8_t(*cur)] == SPACE)
+		cur++;
+	return cur;
+}
+static const char *skip_identifier_characters(const char *cur, const char *end)
+{
+#if RESHADEFX_LEXER_SSE2
+	for (unsigned int n; end - cur >= 16; cur += n)
+		if ((n = find_first_set(_mm_movemask_epi8(is_identifier(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cur)))) ^ 0xFFFF)) != 16)
+			return cur + n;
+#else
+	(void)end;
+#endif
+	// The input is null-terminated, which stops this loop at the end
+	while (s_type_lookup[uint8_t(*cur)] == IDENT || s_type_lookup[uint8_t(*cur)] == DIGIT)
+		cur++;
+	return cur;
+}
+static const char *find_any_of(const char *cur, const char *end, char c0, char c1)
+{
+#if RESHADEFX_LEXER_SSE2
+	for (unsigned int n; end - cur >= 16; cur += n)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur));
+		if ((n = find_first_set(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(c0)), _mm_cmpeq_epi8(v, _mm_set1_epi8(c1)))))) != 16)
+			return cur + n;
+	}
+#endif
+	while (cur < end && *cur != c0 && *cur != c1)
+		cur++;
+	return cur;
+}
+
+namespace
+{
+	/// <summary>
+	/// Table backing <see cref="reshadefx::interned_string"/>.
+	/// Strings are stored in fixed-size blocks that are never moved or freed, so that resolving a handle does not need to take the lock.
+	/// </summary>
+	struct string_table
+	{
+		static constexpr uint32_t block_size = 4096;
+		static constexpr uint32_t max_blocks = 4096;
+
+		string_table()
+		{
+			// Index zero is reserved for the empty string
+			blocks[0].reset(new std::string[block_size]);
+			size = 1;
+		}
+
+		std::shared_mutex mutex;
+		uint32_t size;
+		std::unordered_map<std::string_view, uint32_t> lookup;
+		std::unique_ptr<std::string[]> blocks[max_blocks];
+	};
+
+	string_table &get_string_table()
+	{
+		static string_table table;
+		return table;
+	}
+}
+
+reshadefx::interned_string::interned_string(std::string_view str) : _index(0)
+{
+	if (str.empty())
+		return;
+
+	string_table &table = get_string_table();
+
+	// Most strings were seen before (identifiers repeat a lot), so try a shared lookup first to avoid contention between threads compiling effects in parallel
+	{
+		const std::shared_lock<std::shared_mutex> lock(table.mutex);
+
+		if (const auto it = table.lookup.find(str);
+			it != table.lookup.end())
+		{
+			_index = it->second;
+			return;
+		}
+	}
+
+	const std::unique_lock<std::shared_mutex> lock(table.mutex);
+
+	if (const auto it = table.lookup.find(str);
+		it != table.lookup.end())
+	{
+		_index = it->second;
+		return;
+	}
+
+	const uint32_t block = table.size / string_table::block_size;
+	if (block >= string_table::max_blocks)
+	{
+		assert(false);
+		return;
+	}
+
+	if (table.blocks[block] == nullptr)
+		table.blocks[block].reset(new std::string[string_table::block_size]);
+
+	std::string &data = table.blocks[block][table.size % string_table::block_size];
+	data.assign(str.data(), str.size());
+
+	_index = table.size++;
+	table.lookup.emplace(data, _index);
+}
+
+const std::string &reshadefx::interned_string::str() const
+{
+	const string_table &table = get_string_table();
+	return table.blocks[_index / string_table::block_size][_index % string_table::block_size];
+}
+
 std::string reshadefx::token::id_to_name(tokenid id)
 {
 	const auto it = s_token_lookup.find(id);
@@ -521,7 +685,7 @@ next_token:
 	tok.offset = input_offset();
 	tok.length = 1;
 	tok.literal_as_double = 0;
-	tok.literal_as_string.clear();
+	tok.literal_as_string = {};
 
 	assert(_cur <= _end);
 
@@ -657,6 +821,11 @@ next_token:
 		{
 			while (_cur < _end)
 			{
+				// Skip all characters that can neither end the comment nor start a new line at once
+				skip(find_any_of(_cur, _end, '\n', '*') - _cur);
+				if (_cur >= _end)
+					break;
+
 				if (*_cur == '\n')
 				{
 					_cur_location.line++;
@@ -805,8 +974,8 @@ void reshadefx::lexer::skip_space()
 			continue;
 		}
 
-		if (s_type_lookup[uint8_t(*_cur)] == SPACE)
-			skip(1);
+		if (const char *const next = skip_space_characters(_cur, _end); next != _cur)
+			skip(next - _cur);
 		else
 			break;
 	}
@@ -814,6 +983,7 @@ void reshadefx::lexer::skip_space()
 void reshadefx::lexer::skip_to_next_line()
 {
 	// Skip each character until a new line feed is found
+	skip(find_any_of(_cur, _end, '\n', '\n') - _cur);
 	while (*_cur != '\n' && _cur < _end)
 	{
 #if 0
@@ -838,21 +1008,20 @@ void reshadefx::lexer::reset_to_offset(size_t offset)
 
 void reshadefx::lexer::parse_identifier(token &tok) const
 {
-	auto *const begin = _cur, *end = begin;
+	auto *const begin = _cur;
 
 	// Skip to the end of the identifier sequence
-	while (s_type_lookup[uint8_t(*end)] == IDENT || s_type_lookup[uint8_t(*end)] == DIGIT)
-		end++;
+	auto *const end = skip_identifier_characters(begin, _end);
 
 	tok.id = tokenid::identifier;
 	tok.offset = input_offset();
 	tok.length = end - begin;
-	tok.literal_as_string.assign(begin, end);
+	tok.literal_as_string = interned_string(std::string_view(begin, end - begin));
 
 	if (_ignore_keywords)
 		return;
 
-	if (const auto it = s_keyword_lookup.find(tok.literal_as_string);
+	if (const auto it = s_keyword_lookup.find(tok.literal_as_string.str());
 		it != s_keyword_lookup.end())
 		tok.id = it->second;
 }
@@ -862,7 +1031,7 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 	skip_space(); // Skip any space between the '#' and directive
 	parse_identifier(tok);
 
-	if (const auto it = s_pp_directive_lookup.find(tok.literal_as_string);
+	if (const auto it = s_pp_directive_lookup.find(tok.literal_as_string.str());
 		it != s_pp_directive_lookup.end())
 	{
 		tok.id = it->second;
@@ -904,6 +1073,9 @@ void reshadefx::lexer::parse_string_literal(token &tok, bool escape)
 {
 	auto *const begin = _cur, *end = begin + 1; // Skip first quote character right away
 
+	// Collect the characters in a buffer that is reused between tokens, the final string is then interned
+	_string_literal_buffer.clear();
+
 	for (auto c = *end; c != '"'; c = *++end)
 	{
 		if (c == '\n' || end >= _end)
@@ -994,14 +1166,12 @@ void reshadefx::lexer::parse_string_literal(token &tok, bool escape)
 			}
 		}
 
-		tok.literal_as_string += c;
+		_string_literal_buffer += c;
 	}
 
 	tok.id = tokenid::string_literal;
 	tok.length = end - begin + 1;
-
-	// Free up unused memory
-	tok.literal_as_string.shrink_to_fit();
+	tok.literal_as_string = interned_string(std::string_view(_string_literal_buffer));
 }
 void reshadefx::lexer::parse_numeric_literal(token &tok) const
 {
@@ -101,6 +101,7 @@ namespace reshadefx
 		std::string _input;
 		location _cur_location;
 		const std::string::value_type *_cur, *_end;
+		std::string _string_literal_buffer;
 
 		bool _ignore_comments;
 		bool _ignore_whitespace;
@@ -272,6 +272,12 @@ namespace reshadefx
 		std::vector<uint32_t> referenced_samplers;
 		std::vector<uint32_t> referenced_storages;
 		std::vector<uint32_t> referenced_functions;
+
+		// Boolean uniform variable that makes this function return right away when it has the value in 'gate_uniform_value', as detected from an if statement at the start of its body
+		std::string gate_uniform_name;
+		bool gate_uniform_value = false;
+		// Sampler whose value this function returns unmodified in that case (using its texture coordinate input), or zero if it discards the pixel instead
+		uint32_t gate_passthrough_sampler = 0;
 	};
 
 	/// <summary>
@@ -380,6 +386,10 @@ namespace reshadefx
 		uint32_t viewport_height = 0;
 		uint32_t viewport_dispatch_z = 1;
 
+		// Boolean uniform variable and its value for which this pass leaves all its render targets unchanged, in which case it does not need to be rendered
+		std::string skip_uniform_name;
+		bool skip_uniform_value = false;
+
 		// Bindings specific for the code generation target (in case of combined texture and sampler, 'texture_bindings' and 'sampler_bindings' will be the same size and point to the same bindings, otherwise they are independent)
 		std::vector<texture_binding> texture_bindings;
 		std::vector<sampler_binding> sampler_bindings;
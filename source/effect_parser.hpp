@@ -7,6 +7,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <memory> // std::unique_ptr
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -74,6 +75,12 @@ namespace reshadefx
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
 
+		/// <summary>
+		/// Checks whether the upcoming condition and body of an if statement match "(!uniform) discard;" or "(!uniform) return tex2D(sampler, texcoord);" (or the same without the negation) and records that gate in the function.
+		/// This only looks ahead and restores the token stream afterwards, so that the statement is then parsed as usual.
+		/// </summary>
+		void detect_uniform_gate(function &info);
+
 		std::string _errors;
 
 		std::unique_ptr<class lexer> _lexer;
@@ -85,5 +92,10 @@ namespace reshadefx
 
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
+
+		// Set while parsing the first statement in the body of a function, which is the only one considered by 'detect_uniform_gate'
+		bool _is_first_function_statement = false;
+		// Names of all boolean scalar uniform variables, indexed by their SSA ID
+		std::unordered_map<uint32_t, std::string> _bool_uniform_names;
 	};
 }
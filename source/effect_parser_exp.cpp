@@ -99,14 +99,14 @@ bool reshadefx::parser::accept_symbol(std::string &identifier, scoped_symbol &sy
 		return false;
 	}
 
-	identifier = std::move(_token.literal_as_string);
+	identifier = _token.literal_as_string;
 
 	// Can concatenate multiple '::' to force symbol search for a specific namespace level
 	while (accept(tokenid::colon_colon))
 	{
 		if (!expect(tokenid::identifier))
 			return false;
-		identifier += "::" + std::move(_token.literal_as_string);
+		identifier += "::" + _token.literal_as_string.str();
 	}
 
 	// Figure out which scope to start searching in
@@ -817,7 +817,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 	}
 	else if (accept(tokenid::string_literal))
 	{
-		std::string value = std::move(_token.literal_as_string);
+		std::string value = _token.literal_as_string;
 
 		// Multiple string literals in sequence are concatenated into a single string literal
 		while (accept(tokenid::string_literal))
@@ -1216,7 +1216,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 				return false;
 
 			location = std::move(_token.location);
-			const std::string subscript = std::move(_token.literal_as_string);
+			const std::string subscript = _token.literal_as_string;
 
 			if (accept('(')) // Methods (function calls on types) are not supported right now
 			{
@@ -1571,6 +1571,19 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs_exp, unsigned i
 			if (rhs_exp.is_constant && lhs_exp.evaluate_constant_expression(op, rhs_exp.constant))
 				continue;
 
+			// Operations with an identity element as one of the operands just return the other operand (e.g. 'x * 1.0' or '0 + x')
+			if (const bool lhs_is_identity = lhs_exp.is_identity_element(op, false);
+				!is_bool_result && (rhs_exp.is_identity_element(op, true) || lhs_is_identity))
+			{
+				if (lhs_is_identity && !rhs_exp.is_identity_element(op, true))
+					lhs_exp = std::move(rhs_exp);
+
+				// The result of a binary operation is never assignable
+				if (lhs_exp.is_lvalue)
+					lhs_exp.reset_to_rvalue(lhs_exp.location, _codegen->emit_load(lhs_exp), type);
+				continue;
+			}
+
 			const codegen::id lhs_value = _codegen->emit_load(lhs_exp);
 
 #if RESHADEFX_SHORT_CIRCUIT
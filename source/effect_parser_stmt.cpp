@@ -9,7 +9,7 @@
 #include <cctype> // std::toupper
 #include <cassert>
 #include <iterator> // std::back_inserter
-#include <algorithm> // std::max, std::replace, std::transform
+#include <algorithm> // std::any_of, std::find_if, std::max, std::replace, std::transform
 #include <string_view>
 
 template <typename ENTER_TYPE, typename LEAVE_TYPE>
@@ -58,7 +58,7 @@ bool reshadefx::parser::parse_top(bool &parse_success)
 		if (!expect(tokenid::identifier))
 			return false;
 
-		const std::string name = std::move(_token.literal_as_string);
+		const std::string name = _token.literal_as_string;
 
 		if (!expect('{'))
 			return false;
@@ -102,7 +102,7 @@ bool reshadefx::parser::parse_top(bool &parse_success)
 			if (!expect(tokenid::identifier))
 				return false;
 
-			const std::string attribute = std::move(_token.literal_as_string);
+			const std::string attribute = _token.literal_as_string;
 
 			if (attribute == "shader")
 			{
@@ -168,7 +168,7 @@ bool reshadefx::parser::parse_top(bool &parse_success)
 
 			if (peek('('))
 			{
-				const std::string name = std::move(_token.literal_as_string);
+				const std::string name = _token.literal_as_string;
 
 				// This is definitely a function declaration, so parse it
 				if (!parse_function(type, name, stype, num_threads))
@@ -197,7 +197,7 @@ bool reshadefx::parser::parse_top(bool &parse_success)
 						return false;
 					}
 
-					const std::string name = std::move(_token.literal_as_string);
+					const std::string name = _token.literal_as_string;
 
 					if (!parse_variable(type, name, true))
 					{
@@ -258,7 +258,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			switch_call = (0x8 << 4)
 		};
 
-		const std::string attribute = std::move(_token_next.literal_as_string);
+		const std::string attribute = _token_next.literal_as_string;
 
 		if (!expect(tokenid::identifier) || !expect(']'))
 			return false;
@@ -293,6 +293,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 	// Shift by two so that the possible values are 0x01 for 'flatten' and 0x02 for 'dont_flatten', equivalent to 'unroll' and 'dont_unroll'
 	selection_control >>= 4;
 
+	const bool is_first_function_statement = _is_first_function_statement;
+	_is_first_function_statement = false;
+
 	if (peek('{')) // Parse statement block
 		return parse_statement_block(scoped);
 
@@ -306,6 +309,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 
 		if (accept(tokenid::if_))
 		{
+			if (is_first_function_statement)
+				detect_uniform_gate(*_codegen->_current_function);
+
 			codegen::id true_block = _codegen->create_block(); // Block which contains the statements executed when the condition is true
 			codegen::id false_block = _codegen->create_block(); // Block which contains the statements executed when the condition is false
 			const codegen::id merge_block = _codegen->create_block(); // Block that is executed after the branch re-merged with the current control flow
@@ -513,7 +519,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 					if (count++ > 0 && !expect(','))
 						return false;
 
-					if (!expect(tokenid::identifier) || !parse_variable(type, std::move(_token.literal_as_string)))
+					if (!expect(tokenid::identifier) || !parse_variable(type, _token.literal_as_string))
 						return false;
 				}
 				while (!peek(';'));
@@ -868,7 +874,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 				return false;
 			}
 
-			if (!expect(tokenid::identifier) || !parse_variable(type, std::move(_token.literal_as_string)))
+			if (!expect(tokenid::identifier) || !parse_variable(type, _token.literal_as_string))
 			{
 				consume_until(';');
 				return false;
@@ -935,6 +941,58 @@ bool reshadefx::parser::parse_statement_block(bool scoped)
 	return expect('}');
 }
 
+void reshadefx::parser::detect_uniform_gate(function &info)
+{
+	backup();
+
+	std::string identifier;
+	scoped_symbol symbol;
+
+	if (accept('('))
+	{
+		const bool negated = accept('!');
+
+		if ((peek(tokenid::identifier) || peek(tokenid::colon_colon)) && accept_symbol(identifier, symbol) && accept(')') &&
+			symbol.op == symbol_type::variable)
+		{
+			if (const auto uniform_it = _bool_uniform_names.find(symbol.id);
+				uniform_it != _bool_uniform_names.end())
+			{
+				const std::string &uniform_name = uniform_it->second;
+
+				if (accept(tokenid::discard_))
+				{
+					if (accept(';'))
+					{
+						info.gate_uniform_name = uniform_name;
+						info.gate_uniform_value = !negated;
+						info.gate_passthrough_sampler = 0;
+					}
+				}
+				else if (accept(tokenid::return_) && accept(tokenid::identifier) && _token.literal_as_string == "tex2D" && accept('('))
+				{
+					if ((peek(tokenid::identifier) || peek(tokenid::colon_colon)) && accept_symbol(identifier, symbol) && symbol.op == symbol_type::variable && symbol.type.is_sampler())
+					{
+						const uint32_t sampler_id = symbol.id;
+
+						// The texture coordinate has to be passed through as is from the input parameter
+						if (accept(',') && peek(tokenid::identifier) && accept_symbol(identifier, symbol) && accept(')') && accept(';') &&
+							std::any_of(info.parameter_list.begin(), info.parameter_list.end(),
+								[&symbol](const member_type &param) { return param.id == symbol.id && param.semantic == "TEXCOORD0" && param.type.rows == 2 && !param.type.has(type::q_out); }))
+						{
+							info.gate_uniform_name = uniform_name;
+							info.gate_uniform_value = !negated;
+							info.gate_passthrough_sampler = sampler_id;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	restore();
+}
+
 bool reshadefx::parser::parse_type(type &type)
 {
 	type.qualifiers = 0;
@@ -1017,7 +1075,7 @@ bool reshadefx::parser::parse_annotations(std::vector<annotation> &annotations)
 			return false;
 		}
 
-		std::string name = std::move(_token.literal_as_string);
+		std::string name = _token.literal_as_string;
 
 		expression annotation_exp;
 		if (!expect('=') || !parse_expression_multary(annotation_exp) || !expect(';'))
@@ -1047,7 +1105,7 @@ bool reshadefx::parser::parse_struct()
 	struct_type info;
 	// The structure name is optional
 	if (accept(tokenid::identifier))
-		info.name = std::move(_token.literal_as_string);
+		info.name = _token.literal_as_string;
 	else
 		info.name = "_anonymous_struct_" + std::to_string(struct_location.line) + '_' + std::to_string(struct_location.column);
 
@@ -1081,7 +1139,7 @@ bool reshadefx::parser::parse_struct()
 				return false;
 			}
 
-			member.name = std::move(_token.literal_as_string);
+			member.name = _token.literal_as_string;
 			member.location = std::move(_token.location);
 
 			if (member.type.is_void())
@@ -1150,7 +1208,7 @@ bool reshadefx::parser::parse_struct()
 					return false;
 				}
 
-				member.semantic = std::move(_token.literal_as_string);
+				member.semantic = _token.literal_as_string;
 				// Make semantic upper case to simplify comparison later on
 				std::transform(member.semantic.begin(), member.semantic.end(), member.semantic.begin(),
 					[](std::string::value_type c) {
@@ -1277,7 +1335,7 @@ bool reshadefx::parser::parse_function(type type, std::string name, shader_type
 			break;
 		}
 
-		param.name = std::move(_token.literal_as_string);
+		param.name = _token.literal_as_string;
 		param.location = std::move(_token.location);
 
 		if (param.type.is_void())
@@ -1344,7 +1402,7 @@ bool reshadefx::parser::parse_function(type type, std::string name, shader_type
 				break;
 			}
 
-			param.semantic = std::move(_token.literal_as_string);
+			param.semantic = _token.literal_as_string;
 			// Make semantic upper case to simplify comparison later on
 			std::transform(param.semantic.begin(), param.semantic.end(), param.semantic.begin(),
 				[](std::string::value_type c) {
@@ -1421,7 +1479,7 @@ bool reshadefx::parser::parse_function(type type, std::string name, shader_type
 			return false;
 		}
 
-		info.return_semantic = std::move(_token.literal_as_string);
+		info.return_semantic = _token.literal_as_string;
 		// Make semantic upper case to simplify comparison later on
 		std::transform(info.return_semantic.begin(), info.return_semantic.end(), info.return_semantic.begin(),
 			[](std::string::value_type c) {
@@ -1465,9 +1523,13 @@ bool reshadefx::parser::parse_function(type type, std::string name, shader_type
 	// A function has to start with a new block
 	_codegen->enter_block(_codegen->create_block());
 
+	_is_first_function_statement = true;
+
 	if (!parse_statement_block(false))
 		parse_success = false;
 
+	_is_first_function_statement = false;
+
 	// Add implicit return statement to the end of functions
 	if (_codegen->is_in_block())
 		_codegen->leave_block_and_return();
@@ -1579,7 +1641,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 		}
 
 		std::string &semantic = texture_info.semantic;
-		semantic = std::move(_token.literal_as_string);
+		semantic = _token.literal_as_string;
 
 		// Make semantic upper case to simplify comparison later on
 		std::transform(semantic.begin(), semantic.end(), semantic.begin(),
@@ -1671,7 +1733,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 				}
 
 				location property_location = std::move(_token.location);
-				const std::string property_name = std::move(_token.literal_as_string);
+				const std::string property_name = _token.literal_as_string;
 
 				if (!expect('='))
 				{
@@ -1686,7 +1748,8 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 				if (accept(tokenid::identifier)) // Handle special enumeration names for property values
 				{
 					// Transform identifier to uppercase to do case-insensitive comparison
-					std::transform(_token.literal_as_string.begin(), _token.literal_as_string.end(), _token.literal_as_string.begin(),
+					std::string identifier = _token.literal_as_string;
+					std::transform(identifier.begin(), identifier.end(), identifier.begin(),
 						[](std::string::value_type c) {
 							return static_cast<std::string::value_type>(std::toupper(c));
 						});
@@ -1719,7 +1782,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 					};
 
 					// Look up identifier in list of possible enumeration names
-					if (const auto it = s_enum_values.find(_token.literal_as_string);
+					if (const auto it = s_enum_values.find(identifier);
 						it != s_enum_values.end())
 						property_exp.reset_to_rvalue_constant(_token.location, it->second);
 					else // No match found, so rewind to parser state before the identifier was consumed and try parsing it as a normal expression
@@ -2020,6 +2083,9 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 
 		const codegen::id id = _codegen->define_uniform(variable_location, uniform_info);
 		symbol = { symbol_type::variable, id, type };
+
+		if (type.is_boolean() && type.is_scalar())
+			_bool_uniform_names[id] = name;
 	}
 	// All other variables are separate entities
 	else
@@ -2050,7 +2116,7 @@ bool reshadefx::parser::parse_technique()
 		return false;
 
 	technique info;
-	info.name = std::move(_token.literal_as_string);
+	info.name = _token.literal_as_string;
 
 	bool parse_success = parse_annotations(info.annotations);
 
@@ -2088,7 +2154,7 @@ bool reshadefx::parser::parse_technique_pass(pass &info)
 
 	// Passes can have an optional name
 	if (accept(tokenid::identifier))
-		info.name = std::move(_token.literal_as_string);
+		info.name = _token.literal_as_string;
 
 	bool parse_success = true;
 	bool targets_support_srgb = true;
@@ -2107,7 +2173,7 @@ bool reshadefx::parser::parse_technique_pass(pass &info)
 		}
 
 		location state_location = std::move(_token.location);
-		const std::string state_name = std::move(_token.literal_as_string);
+		const std::string state_name = _token.literal_as_string;
 
 		if (!expect('='))
 		{
@@ -2327,7 +2393,8 @@ bool reshadefx::parser::parse_technique_pass(pass &info)
 			if (accept(tokenid::identifier)) // Handle special enumeration names for pass states
 			{
 				// Transform identifier to uppercase to do case-insensitive comparison
-				std::transform(_token.literal_as_string.begin(), _token.literal_as_string.end(), _token.literal_as_string.begin(),
+				std::string identifier = _token.literal_as_string;
+				std::transform(identifier.begin(), identifier.end(), identifier.begin(),
 					[](std::string::value_type c) {
 						return static_cast<std::string::value_type>(std::toupper(c));
 					});
@@ -2373,7 +2440,7 @@ bool reshadefx::parser::parse_technique_pass(pass &info)
 				};
 
 				// Look up identifier in list of possible enumeration names
-				if (const auto it = s_enum_values.find(_token.literal_as_string);
+				if (const auto it = s_enum_values.find(identifier);
 					it != s_enum_values.end())
 					state_exp.reset_to_rvalue_constant(_token.location, it->second);
 				else // No match found, so rewind to parser state before the identifier was consumed and try parsing it as a normal expression
@@ -2575,6 +2642,33 @@ bool reshadefx::parser::parse_technique_pass(pass &info)
 				error(pass_location, 3667, "storage writes are only valid in compute shaders");
 			}
 
+			// A pixel shader gated by a boolean uniform leaves all render targets unchanged if it discards every pixel, or if it returns the back buffer as is while writing to it at the same texture coordinates without blending
+			if (!ps_info.gate_uniform_name.empty() && !info.clear_render_targets)
+			{
+				bool leaves_render_targets_unchanged = ps_info.gate_passthrough_sampler == 0;
+
+				if (ps_info.gate_passthrough_sampler != 0 &&
+					vs_info.name == "PostProcessVS" &&
+					info.render_target_names[0].empty() &&
+					info.viewport_width == 0 && info.viewport_height == 0 &&
+					!info.blend_enable[0] &&
+					!info.stencil_enable)
+				{
+					const sampler &sampler = _codegen->get_sampler(ps_info.gate_passthrough_sampler);
+
+					if (const auto texture_it = std::find_if(_codegen->_module.textures.begin(), _codegen->_module.textures.end(),
+							[&sampler](const texture &texture) { return texture.unique_name == sampler.texture_name; });
+						texture_it != _codegen->_module.textures.end() && texture_it->semantic == "COLOR" && sampler.srgb == info.srgb_write_enable)
+						leaves_render_targets_unchanged = true;
+				}
+
+				if (leaves_render_targets_unchanged)
+				{
+					info.skip_uniform_name = ps_info.gate_uniform_name;
+					info.skip_uniform_value = ps_info.gate_uniform_value;
+				}
+			}
+
 			// Verify render target format supports sRGB writes if enabled
 			if (info.srgb_write_enable && !targets_support_srgb)
 			{
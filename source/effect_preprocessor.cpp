@@ -5,6 +5,7 @@
 
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
+#include <mutex>
 #include <cstdio> // fclose, fopen, fread, fseek
 #include <cassert>
 #include <algorithm> // std::find_if
@@ -98,6 +99,440 @@ static bool read_file(const std::filesystem::path &path, std::string &file_data)
 	return true;
 }
 
+/// <summary>
+/// Contents of an included file, lexed once and then shared read-only between all preprocessor instances.
+/// </summary>
+struct reshadefx::preprocessor::include_file
+{
+	interned_string path;
+	std::string data;
+	std::vector<token> tokens;
+	// Name of the macro of an include guard that wraps the entire file, so that the file can be skipped without processing it while that macro is defined
+	std::string include_guard;
+	std::filesystem::file_time_type last_write_time;
+};
+
+static std::string find_include_guard(const std::vector<reshadefx::token> &tokens)
+{
+	using reshadefx::tokenid;
+
+	size_t i = 0;
+	const auto skip_whitespace = [&tokens, &i]() {
+		while (i < tokens.size() && (tokens[i] == tokenid::space || tokens[i] == tokenid::end_of_line))
+			++i;
+	};
+
+	skip_whitespace();
+	if (i >= tokens.size() || tokens[i] != tokenid::hash_ifndef)
+		return std::string();
+	++i;
+	skip_whitespace();
+	if (i >= tokens.size() || tokens[i] != tokenid::identifier)
+		return std::string();
+
+	const std::string name = tokens[i].literal_as_string;
+
+	// Find the matching '#endif' and make sure there is nothing but whitespace after it
+	for (unsigned int depth = 1; ++i < tokens.size();)
+	{
+		switch (tokens[i])
+		{
+		case tokenid::hash_if:
+		case tokenid::hash_ifdef:
+		case tokenid::hash_ifndef:
+			++depth;
+			break;
+		case tokenid::hash_else:
+		case tokenid::hash_elif:
+			if (depth == 1)
+				return std::string(); // Parts of the file are used even when the macro is defined
+			break;
+		case tokenid::hash_endif:
+			if (--depth == 0)
+			{
+				++i;
+				skip_whitespace();
+				return i < tokens.size() && tokens[i] == tokenid::end_of_file ? name : std::string();
+			}
+			break;
+		}
+	}
+
+	return std::string();
+}
+
+auto reshadefx::preprocessor::load_include_file(const std::filesystem::path &path, const std::string &path_string) -> std::shared_ptr<const include_file>
+{
+	// Cache is shared between all preprocessor instances, so that effects compiled in parallel on different threads only need to lex common headers once
+	static std::mutex s_include_cache_mutex;
+	static std::unordered_map<std::string, std::shared_ptr<const include_file>> s_include_cache;
+
+	std::error_code ec;
+	const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path, ec);
+
+	{
+		const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+
+		if (const auto it = s_include_cache.find(path_string);
+			it != s_include_cache.end() && !ec && it->second->last_write_time == last_write_time)
+			return it->second;
+	}
+
+	const auto file = std::make_shared<include_file>();
+	file->path = interned_string(path_string);
+	file->last_write_time = last_write_time;
+
+	if (!read_file(path, file->data))
+		return nullptr;
+
+	// Lex the entire file up front, with the same settings the preprocessor uses for its input
+	lexer lexer(
+		file->data,
+		true  /* ignore_comments */,
+		false /* ignore_whitespace */,
+		false /* ignore_pp_directives */,
+		false /* ignore_line_directives */,
+		true  /* ignore_keywords */,
+		false /* escape_string_literals */,
+		location(file->path, 1));
+
+	do
+		file->tokens.push_back(lexer.lex());
+	while (file->tokens.back() != tokenid::end_of_file);
+
+	file->include_guard = find_include_guard(file->tokens);
+
+	// Do not cache files whose modification time could not be determined, since it would not be possible to detect changes to them
+	if (!ec)
+	{
+		const std::lock_guard<std::mutex> lock(s_include_cache_mutex);
+		s_include_cache[path_string] = file;
+	}
+
+	return file;
+}
+
+/// <summary>
+/// Immutable set of macro definitions, shared between all preprocessor instances that start out with the same definitions.
+/// </summary>
+struct reshadefx::preprocessor::macro_table
+{
+	std::unordered_map<std::string, macro> macros;
+	// Replacement lists of macros that do not reference any parameters, lexed once up front so that expanding them only has to replay the tokens
+	std::unordered_map<std::string, std::shared_ptr<const include_file>> replacement_tokens;
+};
+
+/// <summary>
+/// State of the preprocessor after processing an include at the start of a file, so that other files starting with the same include can resume from it instead of processing it again.
+/// </summary>
+struct reshadefx::preprocessor::snapshot
+{
+	// Output produced by the include, which is appended to the existing output when resuming
+	std::string output;
+	location output_location;
+	std::unordered_set<std::string> used_macros;
+	std::shared_ptr<const macro_table> macros;
+	std::unordered_map<std::string, std::shared_ptr<const include_file>> file_cache;
+	std::unordered_set<std::string> pragma_once_files;
+	std::vector<std::pair<std::string, std::string>> used_pragmas;
+};
+
+/// <summary>
+/// Macro tables and snapshots shared between all preprocessor instances, keyed by the state they were created from.
+/// </summary>
+struct reshadefx::preprocessor::shared_cache
+{
+	// Every combination of preprocessor definitions creates new entries, so limit how many are kept around
+	static constexpr size_t MAX_ENTRIES = 64;
+
+	std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<const macro_table>> macro_tables;
+	std::unordered_map<std::string, std::shared_ptr<const snapshot>> snapshots;
+
+	static shared_cache &instance()
+	{
+		static shared_cache s_instance;
+		return s_instance;
+	}
+};
+
+static bool is_constant_replacement_list(const std::string &replacement_list)
+{
+	// Lists without any special replacement sequences expand to the same text every time
+	return !replacement_list.empty() && replacement_list.find(macro_replacement_start) == std::string::npos;
+}
+
+auto reshadefx::preprocessor::lex_replacement_list(const macro &macro) -> std::shared_ptr<const include_file>
+{
+	const auto replacement_tokens = std::make_shared<include_file>();
+	replacement_tokens->data = macro.replacement_list;
+
+	// Lex as if the list did not start at the beginning of a line, which is the case for every expansion the tokens are used for (see 'expand_macro')
+	lexer lexer(
+		replacement_tokens->data,
+		true  /* ignore_comments */,
+		false /* ignore_whitespace */,
+		false /* ignore_pp_directives */,
+		false /* ignore_line_directives */,
+		true  /* ignore_keywords */,
+		false /* escape_string_literals */,
+		location(1, 2));
+
+	do
+		replacement_tokens->tokens.push_back(lexer.lex());
+	while (replacement_tokens->tokens.back() != tokenid::end_of_file);
+
+	return replacement_tokens;
+}
+
+auto reshadefx::preprocessor::find_macro(const std::string &name) const -> const std::pair<const std::string, macro> *
+{
+	if (const auto it = _macros.find(name); it != _macros.end())
+		return &*it;
+
+	if (_frozen_macros != nullptr && _undefined_macros.find(name) == _undefined_macros.end())
+		if (const auto it = _frozen_macros->macros.find(name); it != _frozen_macros->macros.end())
+			return &*it;
+
+	return nullptr;
+}
+auto reshadefx::preprocessor::find_replacement_tokens(const std::string &name, const macro &macro) -> std::shared_ptr<const include_file>
+{
+	if (_macros.find(name) != _macros.end())
+	{
+		if (!is_constant_replacement_list(macro.replacement_list))
+			return nullptr;
+
+		// Macros defined by this instance are lexed on their first expansion
+		std::shared_ptr<const include_file> &replacement_tokens = _macro_tokens[name];
+		if (replacement_tokens == nullptr)
+			replacement_tokens = lex_replacement_list(macro);
+		return replacement_tokens;
+	}
+
+	if (_frozen_macros != nullptr)
+		if (const auto it = _frozen_macros->replacement_tokens.find(name); it != _frozen_macros->replacement_tokens.end())
+			return it->second;
+
+	return nullptr;
+}
+
+void reshadefx::preprocessor::append_macro_definitions(std::string &key) const
+{
+	std::vector<const std::pair<const std::string, macro> *> macros;
+	macros.reserve(_macros.size() + (_frozen_macros != nullptr ? _frozen_macros->macros.size() : 0));
+	if (_frozen_macros != nullptr)
+		for (const auto &macro : _frozen_macros->macros)
+			if (_macros.find(macro.first) == _macros.end() && _undefined_macros.find(macro.first) == _undefined_macros.end())
+				macros.push_back(&macro);
+	for (const auto &macro : _macros)
+		macros.push_back(&macro);
+
+	// Hash map iteration order is not deterministic, so sort everything by name to get the same key for the same definitions
+	std::sort(macros.begin(), macros.end(),
+		[](const auto lhs, const auto rhs) { return lhs->first < rhs->first; });
+
+	for (const auto macro : macros)
+	{
+		key += macro->first;
+		key += static_cast<char>('0' + (macro->second.is_predefined ? 1 : 0) + (macro->second.is_variadic ? 2 : 0) + (macro->second.is_function_like ? 4 : 0));
+		for (const std::string &parameter : macro->second.parameters)
+			key += parameter, key += ',';
+		key += '\n';
+		key += macro->second.replacement_list;
+		key += '\n';
+	}
+	key += '\0';
+}
+
+void reshadefx::preprocessor::freeze_macros()
+{
+	if (_macros.empty() && _undefined_macros.empty())
+		return;
+
+	std::string key;
+	append_macro_definitions(key);
+
+	shared_cache &cache = shared_cache::instance();
+
+	std::shared_ptr<const macro_table> table;
+	{
+		const std::lock_guard<std::mutex> lock(cache.mutex);
+
+		if (const auto it = cache.macro_tables.find(key); it != cache.macro_tables.end())
+			table = it->second;
+	}
+
+	if (table == nullptr)
+	{
+		const auto new_table = std::make_shared<macro_table>();
+
+		if (_frozen_macros != nullptr)
+		{
+			for (const auto &macro : _frozen_macros->macros)
+				if (_undefined_macros.find(macro.first) == _undefined_macros.end())
+					new_table->macros.insert(macro);
+			for (const auto &replacement_tokens : _frozen_macros->replacement_tokens)
+				if (_undefined_macros.find(replacement_tokens.first) == _undefined_macros.end())
+					new_table->replacement_tokens.insert(replacement_tokens);
+		}
+
+		for (const auto &macro : _macros)
+		{
+			new_table->macros.insert(macro);
+
+			if (!is_constant_replacement_list(macro.second.replacement_list))
+				continue;
+
+			if (const auto it = _macro_tokens.find(macro.first); it != _macro_tokens.end())
+				new_table->replacement_tokens.insert(*it);
+			else
+				new_table->replacement_tokens.emplace(macro.first, lex_replacement_list(macro.second));
+		}
+
+		const std::lock_guard<std::mutex> lock(cache.mutex);
+
+		if (cache.macro_tables.size() >= shared_cache::MAX_ENTRIES)
+			cache.macro_tables.clear();
+
+		cache.macro_tables.emplace(std::move(key), new_table);
+
+		table = new_table;
+	}
+
+	_frozen_macros = std::move(table);
+	_macros.clear();
+	_undefined_macros.clear();
+	_macro_tokens.clear();
+}
+
+std::string reshadefx::preprocessor::build_snapshot_key(const std::string &file_path_string) const
+{
+	std::string key;
+
+	const auto append_sorted = [&key](std::vector<std::string> names) {
+		std::sort(names.begin(), names.end());
+		for (const std::string &name : names)
+			key += name, key += '\n';
+		key += '\0';
+	};
+
+	key += file_path_string;
+	key += '\0';
+
+	for (const std::filesystem::path &include_path : _include_paths)
+		key += include_path.u8string(), key += '\n';
+	key += '\0';
+
+	append_macro_definitions(key);
+
+	append_sorted(std::vector<std::string>(_used_macros.begin(), _used_macros.end()));
+	append_sorted(std::vector<std::string>(_pragma_once_files.begin(), _pragma_once_files.end()));
+
+	std::vector<std::string> included_files;
+	included_files.reserve(_file_cache.size());
+	for (const auto &cache_entry : _file_cache)
+		included_files.push_back(cache_entry.first);
+	append_sorted(std::move(included_files));
+
+	for (const std::pair<std::string, std::string> &pragma : _used_pragmas)
+		key += pragma.first, key += ' ', key += pragma.second, key += '\n';
+
+	return key;
+}
+
+bool reshadefx::preprocessor::restore_snapshot(const std::string &key)
+{
+	std::shared_ptr<const snapshot> snapshot;
+	{
+		shared_cache &cache = shared_cache::instance();
+		const std::lock_guard<std::mutex> lock(cache.mutex);
+
+		if (const auto it = cache.snapshots.find(key); it != cache.snapshots.end())
+			snapshot = it->second;
+	}
+
+	if (snapshot == nullptr)
+		return false;
+
+	// The recursive include check depends on the file that contains the include, so cannot use a snapshot that includes that file
+	if (snapshot->file_cache.find(_input_stack.front().name.str()) != snapshot->file_cache.end())
+		return false;
+
+	// Make sure none of the files the snapshot was created from were modified since
+	for (const auto &cache_entry : snapshot->file_cache)
+		if (load_include_file(std::filesystem::u8path(cache_entry.first), cache_entry.first) != cache_entry.second)
+			return false;
+
+	_output += snapshot->output;
+	_output_location = snapshot->output_location;
+	_used_macros = snapshot->used_macros;
+	_macros.clear();
+	_undefined_macros.clear();
+	_frozen_macros = snapshot->macros;
+	_macro_tokens.clear();
+	_file_cache = snapshot->file_cache;
+	_pragma_once_files = snapshot->pragma_once_files;
+	_used_pragmas = snapshot->used_pragmas;
+
+	return true;
+}
+
+void reshadefx::preprocessor::save_snapshot(bool complete_line)
+{
+	std::string key = std::move(_snapshot_key);
+	_snapshot_key.clear();
+
+	// Output and errors of an include are only reproducible if it did not report anything and did not leave an unfinished line behind that continues in the including file
+	if (!complete_line || _errors.size() != _snapshot_errors_offset)
+		return;
+
+	// Freeze the macro table, so that it can be shared with everything resuming from this snapshot
+	freeze_macros();
+
+	const auto entry = std::make_shared<snapshot>();
+	entry->output = _output.substr(_snapshot_output_offset);
+	entry->output_location = _output_location;
+	entry->used_macros = _used_macros;
+	entry->macros = _frozen_macros;
+	entry->file_cache = _file_cache;
+	entry->pragma_once_files = _pragma_once_files;
+	entry->used_pragmas = _used_pragmas;
+
+	shared_cache &cache = shared_cache::instance();
+	const std::lock_guard<std::mutex> lock(cache.mutex);
+
+	if (cache.snapshots.size() >= shared_cache::MAX_ENTRIES)
+		cache.snapshots.clear();
+
+	cache.snapshots[std::move(key)] = std::move(entry);
+}
+
+reshadefx::token reshadefx::preprocessor::input_level::lex()
+{
+	if (file == nullptr)
+		return lexer->lex();
+
+	// Keep returning the end of file token once the end of the token stream was reached, like the lexer does
+	token tok = file->tokens[next_file_token];
+	if (next_file_token + 1 < file->tokens.size())
+		next_file_token++;
+
+	// Tokens of macro replacement lists were lexed starting at the second column of the first line, so move them to where the macro is expanded
+	if (file->path.empty())
+	{
+		tok.location.source = start_location.source;
+		tok.location.line += start_location.line - 1;
+		tok.location.column += start_location.column - 2;
+	}
+
+	return tok;
+}
+const std::string &reshadefx::preprocessor::input_level::input_string() const
+{
+	return file != nullptr ? file->data : lexer->input_string();
+}
+
 template <char ESCAPE_CHAR = '\\'>
 static std::string escape_string(std::string s)
 {
@@ -121,7 +556,11 @@ void reshadefx::preprocessor::add_include_path(const std::filesystem::path &path
 bool reshadefx::preprocessor::add_macro_definition(const std::string &name, const macro &macro)
 {
 	assert(!name.empty());
-	return _macros.emplace(name, macro).second;
+	if (find_macro(name) != nullptr)
+		return false;
+
+	_macros.emplace(name, macro);
+	return true;
 }
 
 bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
@@ -140,6 +579,12 @@ bool reshadefx::preprocessor::append_string(std::string source_code, const std::
 	// Only consider new errors added below for the success of this call
 	const size_t errors_offset = _errors.length();
 
+	// Share all definitions made so far with other instances that start out with the same ones
+	freeze_macros();
+
+	// Includes at the start of this string can be resumed from a snapshot
+	_include_prefix = true;
+
 	// Give this push a name, so that lexer location starts at a new line
 	// This is necessary in case this string starts with a preprocessor directive, since the lexer only reports those as such if they appear at the beginning of a new line
 	// But without a name, the lexer location is set to the last token location, which most likely will not be at the start of the line
@@ -153,7 +598,7 @@ std::vector<std::filesystem::path> reshadefx::preprocessor::included_files() con
 {
 	std::vector<std::filesystem::path> files;
 	files.reserve(_file_cache.size());
-	for (const std::pair<std::string, std::string> &cache_entry : _file_cache)
+	for (const auto &cache_entry : _file_cache)
 		files.push_back(std::filesystem::u8path(cache_entry.first));
 	return files;
 }
@@ -162,10 +607,10 @@ std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_m
 	std::vector<std::pair<std::string, std::string>> defines;
 	defines.reserve(_used_macros.size());
 	for (const std::string &name : _used_macros)
-		if (const auto it = _macros.find(name);
+		if (const auto macro = find_macro(name);
 			// Do not include function-like macros, since they are more likely to contain a complex replacement list
-			it != _macros.end() && !it->second.is_function_like)
-			defines.emplace_back(name, it->second.replacement_list);
+			macro != nullptr && !macro->second.is_function_like)
+			defines.emplace_back(name, macro->second.replacement_list);
 	return defines;
 }
 
@@ -190,11 +635,11 @@ void reshadefx::preprocessor::push(std::string input, const std::string &name)
 {
 	location start_location = !name.empty() ?
 		// Start at the beginning of the file when pushing a new file
-		location(name, 1) :
+		location(interned_string(name), 1) :
 		// Start with last known token location when pushing an unnamed string
 		_token.location;
 
-	input_level level = { name };
+	input_level level = { start_location.source };
 	level.lexer.reset(new lexer(
 		std::move(input),
 		true  /* ignore_comments */,
@@ -207,6 +652,29 @@ void reshadefx::preprocessor::push(std::string input, const std::string &name)
 	level.next_token.id = tokenid::unknown;
 	level.next_token.location = start_location; // This is used in 'consume' to initialize the output location
 
+	push(std::move(level));
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const include_file> file)
+{
+	input_level level = { file->path };
+	level.file = std::move(file);
+	level.next_token.id = tokenid::unknown;
+	level.next_token.location = location(level.name, 1);
+
+	push(std::move(level));
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const include_file> replacement_tokens, const location &start_location)
+{
+	input_level level = { start_location.source };
+	level.file = std::move(replacement_tokens);
+	level.start_location = start_location;
+	level.next_token.id = tokenid::unknown;
+	level.next_token.location = start_location;
+
+	push(std::move(level));
+}
+void reshadefx::preprocessor::push(input_level &&level)
+{
 	// Inherit hidden macros from parent
 	if (!_input_stack.empty())
 		level.hidden_macros = _input_stack.back().hidden_macros;
@@ -244,7 +712,7 @@ void reshadefx::preprocessor::consume()
 	input_level &input = _input_stack[_current_input_index];
 	if (!input.name.empty() && input.name != _output_location.source)
 	{
-		_output += "#line " + std::to_string(input.next_token.location.line) + " \"" + input.name + "\"\n";
+		_output += "#line " + std::to_string(input.next_token.location.line) + " \"" + input.name.str() + "\"\n";
 		// Line number is increased before checking against next token in 'tokenid::end_of_line' handling in 'parse' function below, so compensate for that here
 		_output_location.line = input.next_token.location.line - 1;
 		_output_location.source = input.name;
@@ -252,10 +720,11 @@ void reshadefx::preprocessor::consume()
 
 	// Set current token
 	_token = std::move(input.next_token);
-	_current_token_raw_data = input.lexer->input_string().substr(_token.offset, _token.length);
+	// Assign in place to reuse the existing buffer instead of allocating a new string for every token
+	_current_token_raw_data.assign(input.input_string(), _token.offset, _token.length);
 
 	// Get the next token
-	input.next_token = input.lexer->lex();
+	input.next_token = input.lex();
 
 	// Verify string literals (since the lexer cannot throw errors itself)
 	if (_token == tokenid::string_literal && _current_token_raw_data.back() != '\"')
@@ -321,7 +790,7 @@ bool reshadefx::preprocessor::expect(tokenid tokid)
 			error(actual_token.location, "syntax error: unexpected new line");
 		else
 			error(actual_token.location, "syntax error: unexpected token '" +
-				_input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length) + '\'');
+				_input_stack[_next_input_index].input_string().substr(actual_token.offset, actual_token.length) + '\'');
 
 		return false;
 	}
@@ -336,10 +805,17 @@ void reshadefx::preprocessor::parse()
 	// Consume all tokens in the input
 	while (!peek(tokenid::end_of_file))
 	{
+		// Save snapshot once the include it was started for was processed completely and parsing is about to continue in the top level input
+		if (!_snapshot_key.empty() && _next_input_index == 0)
+			save_snapshot(line.empty());
+
 		consume();
 
 		_recursion_count = 0;
 
+		if (_current_input_index == 0 && _token != tokenid::space && _token != tokenid::end_of_line && _token != tokenid::hash_include)
+			_include_prefix = false;
+
 		const bool skip = !_if_stack.empty() && _if_stack.back().skipping;
 
 		switch (_token)
@@ -411,12 +887,15 @@ void reshadefx::preprocessor::parse()
 				consume_until(tokenid::end_of_line);
 			continue;
 		case tokenid::hash_include:
+			// Output of an include is only independent of the surrounding text if it starts on a new line
+			if (!line.empty())
+				_include_prefix = false;
 			parse_include();
 			continue;
 		case tokenid::hash_unknown:
 			// Standalone "#" is valid and should be ignored
 			if (_token.length != 0)
-				error(_token.location, "unrecognized preprocessing directive '" + _token.literal_as_string + '\'');
+				error(_token.location, "unrecognized preprocessing directive '" + _token.literal_as_string.str() + '\'');
 			if (!expect(tokenid::end_of_line))
 				consume_until(tokenid::end_of_line);
 			continue;
@@ -443,6 +922,9 @@ void reshadefx::preprocessor::parse()
 		}
 	}
 
+	if (!_snapshot_key.empty())
+		save_snapshot(line.empty());
+
 	// Append the last line after the EOF token was reached to the output
 	_output += line;
 	_output += '\n';
@@ -457,7 +939,7 @@ void reshadefx::preprocessor::parse_def()
 
 	macro m;
 	const location location = std::move(_token.location);
-	const std::string macro_name = std::move(_token.literal_as_string);
+	const std::string macro_name = _token.literal_as_string;
 
 	// Only create function-like macro if the parenthesis follows the macro name without any whitespace between
 	if (accept(tokenid::parenthesis_open, false))
@@ -491,7 +973,10 @@ void reshadefx::preprocessor::parse_undef()
 	if (_token.literal_as_string == "defined")
 		return warning(_token.location, "macro name 'defined' is reserved");
 
-	_macros.erase(_token.literal_as_string);
+	if (_macros.erase(_token.literal_as_string) != 0)
+		_macro_tokens.erase(_token.literal_as_string);
+	else if (_frozen_macros != nullptr && _frozen_macros->macros.find(_token.literal_as_string) != _frozen_macros->macros.end())
+		_undefined_macros.insert(_token.literal_as_string);
 }
 
 void reshadefx::preprocessor::parse_if()
@@ -536,7 +1021,7 @@ void reshadefx::preprocessor::parse_ifdef()
 		level.skipping = !level.value;
 
 		// Only add to used macro list if this #ifdef is active and the macro was not defined before
-		if (const auto it = _macros.find(_token.literal_as_string); it == _macros.end() || it->second.is_predefined)
+		if (const auto macro = find_macro(_token.literal_as_string); macro == nullptr || macro->second.is_predefined)
 			_used_macros.emplace(_token.literal_as_string);
 	}
 
@@ -563,7 +1048,7 @@ void reshadefx::preprocessor::parse_ifndef()
 		level.skipping = !level.value;
 
 		// Only add to used macro list if this #ifndef is active and the macro was not defined before
-		if (const auto it = _macros.find(_token.literal_as_string); it == _macros.end() || it->second.is_predefined)
+		if (const auto macro = find_macro(_token.literal_as_string); macro == nullptr || macro->second.is_predefined)
 			_used_macros.emplace(_token.literal_as_string);
 	}
 
@@ -657,7 +1142,7 @@ void reshadefx::preprocessor::parse_pragma()
 	if (!expect(tokenid::identifier))
 		return;
 
-	std::string pragma = std::move(_token.literal_as_string);
+	std::string pragma = _token.literal_as_string;
 	std::string pragma_args;
 
 	// Ignore whitespace preceding the argument list
@@ -679,9 +1164,8 @@ void reshadefx::preprocessor::parse_pragma()
 
 	if (pragma == "once")
 	{
-		// Clear file contents, so that future include statements simply push an empty string instead of these file contents again
-		if (const auto it = _file_cache.find(_output_location.source); it != _file_cache.end())
-			it->second.clear();
+		// Remember this file, so that future include statements simply push an empty string instead of these file contents again
+		_pragma_once_files.insert(_output_location.source.str());
 		return;
 	}
 
@@ -714,8 +1198,8 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
-	std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
+	std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string.str());
+	std::filesystem::path file_path = std::filesystem::u8path(_output_location.source.str());
 	file_path.replace_filename(file_name);
 
 	std::error_code ec;
@@ -728,20 +1212,35 @@ void reshadefx::preprocessor::parse_include()
 
 	// Detect recursive include and abort to avoid infinite loop
 	if (std::find_if(_input_stack.begin(), _input_stack.end(),
-			[&file_path_string](const input_level &level) { return level.name == file_path_string; }) != _input_stack.end())
+			[&file_path_string](const input_level &level) { return level.name.str() == file_path_string; }) != _input_stack.end())
 		return error(_token.location, "recursive #include");
 
-	std::string input;
+	std::shared_ptr<const include_file> file;
 	if (const auto it = _file_cache.find(file_path_string); it != _file_cache.end())
 	{
-		input = it->second;
+		file = it->second;
 	}
 	else
 	{
-		if (!read_file(file_path, input))
+		file = load_include_file(file_path, file_path_string);
+		if (file == nullptr)
 			return error(keyword_location, "could not open included file '" + file_name.u8string() + '\'');
 
-		_file_cache.emplace(file_path_string, input);
+		_file_cache.emplace(file_path_string, file);
+	}
+
+	// Files with '#pragma once' or a defined include guard have no effect, so push an empty string instead of these file contents again
+	bool skip = _pragma_once_files.find(file_path_string) != _pragma_once_files.end();
+	if (!skip && !file->include_guard.empty())
+	{
+		if (const auto macro = find_macro(file->include_guard); macro != nullptr)
+		{
+			skip = true;
+
+			// Still track the macro as used, like the '#ifndef' of the include guard would have
+			if (macro->second.is_predefined)
+				_used_macros.emplace(file->include_guard);
+		}
 	}
 
 	// Skip end of line character following the include statement before pushing, so that the line number is already pointing to the next line when popping out of it again
@@ -752,7 +1251,25 @@ void reshadefx::preprocessor::parse_include()
 	while (_input_stack.size() > (_next_input_index + 1))
 		_input_stack.pop_back();
 
-	push(std::move(input), file_path_string);
+	if (skip)
+	{
+		push(std::string(), file_path_string);
+		return;
+	}
+
+	// Includes at the start of the top level input are the same for many files, so resume from a snapshot of a previous include with the same state if possible
+	if (_include_prefix && _next_input_index == 0 && _if_stack.empty())
+	{
+		std::string key = build_snapshot_key(file_path_string);
+		if (restore_snapshot(key))
+			return;
+
+		_snapshot_key = std::move(key);
+		_snapshot_output_offset = _output.size();
+		_snapshot_errors_offset = _errors.size();
+	}
+
+	push(std::move(file));
 }
 
 bool reshadefx::preprocessor::evaluate_expression()
@@ -893,6 +1410,9 @@ bool reshadefx::preprocessor::evaluate_expression()
 
 			if (_token.literal_as_string == "exists")
 			{
+				// Result depends on files that are not tracked by the snapshot, so cannot save one
+				_snapshot_key.clear();
+
 				const bool has_parentheses = accept(tokenid::parenthesis_open);
 
 				while (accept(tokenid::identifier))
@@ -907,8 +1427,8 @@ bool reshadefx::preprocessor::evaluate_expression()
 				if (!expect(tokenid::string_literal))
 					return false;
 
-				std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
-				std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
+				std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string.str());
+				std::filesystem::path file_path = std::filesystem::u8path(_output_location.source.str());
 				file_path.replace_filename(file_name);
 
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
@@ -930,7 +1450,7 @@ bool reshadefx::preprocessor::evaluate_expression()
 				if (!expect(tokenid::identifier))
 					return false;
 
-				const std::string macro_name = std::move(_token.literal_as_string);
+				const std::string macro_name = _token.literal_as_string;
 
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
 					return false;
@@ -1098,31 +1618,31 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	}
 	if (_token.literal_as_string == "__FILE_STEM__")
 	{
-		const std::filesystem::path file_stem = std::filesystem::u8path(_token.location.source).stem();
+		const std::filesystem::path file_stem = std::filesystem::u8path(_token.location.source.str()).stem();
 		push(escape_string(file_stem.u8string()));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_STEM_HASH__")
 	{
-		const std::filesystem::path file_stem = std::filesystem::u8path(_token.location.source).stem();
+		const std::filesystem::path file_stem = std::filesystem::u8path(_token.location.source.str()).stem();
 		push(std::to_string(std::hash<std::string>()(file_stem.u8string()) & 0xFFFFFFFF));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_NAME__")
 	{
-		const std::filesystem::path file_name = std::filesystem::u8path(_token.location.source).filename();
+		const std::filesystem::path file_name = std::filesystem::u8path(_token.location.source.str()).filename();
 		push(escape_string(file_name.u8string()));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_NAME_HASH__")
 	{
-		const std::filesystem::path file_name = std::filesystem::u8path(_token.location.source).filename();
+		const std::filesystem::path file_name = std::filesystem::u8path(_token.location.source.str()).filename();
 		push(std::to_string(std::hash<std::string>()(file_name.u8string()) & 0xFFFFFFFF));
 		return true;
 	}
 
-	const auto it = _macros.find(_token.literal_as_string);
-	if (it == _macros.end())
+	const auto macro = find_macro(_token.literal_as_string);
+	if (macro == nullptr)
 		return false;
 
 	if (!_input_stack.empty())
@@ -1137,7 +1657,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 		return error(macro_location, "macro recursion too high"), false;
 
 	std::vector<std::string> arguments;
-	if (it->second.is_function_like)
+	if (macro->second.is_function_like)
 	{
 		if (!accept(tokenid::parenthesis_open))
 			return false; // Function like macro used without arguments, handle that like a normal identifier instead
@@ -1161,7 +1681,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 				// Consume all tokens of the argument
 				consume();
 
-				if (_token == tokenid::comma && parentheses_level == 0 && !(it->second.is_variadic && arguments.size() == it->second.parameters.size()))
+				if (_token == tokenid::comma && parentheses_level == 0 && !(macro->second.is_variadic && arguments.size() == macro->second.parameters.size()))
 					break; // Comma marks end of an argument (unless this is the last argument in a variadic macro invocation)
 				if (_token == tokenid::parenthesis_open)
 					parentheses_level++;
@@ -1186,14 +1706,14 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 		}
 	}
 
-	expand_macro(it->first, it->second, arguments);
+	expand_macro(macro->first, macro->second, arguments);
 
 	return true;
 }
 
 bool reshadefx::preprocessor::is_defined(const std::string &name) const
 {
-	return _macros.find(name) != _macros.end() ||
+	return find_macro(name) != nullptr ||
 		// Check built-in macros as well
 		name == "__LINE__" ||
 		name == "__FILE__" ||
@@ -1212,6 +1732,19 @@ void reshadefx::preprocessor::expand_macro(const std::string &name, const macro
 	if (arguments.size() > macro.parameters.size() && !macro.is_variadic)
 		return warning(_token.location, "too many arguments for function-like macro invocation '" + name + "'");
 
+	// Macros that do not reference any parameters expand to the same tokens every time, so replay the ones lexed before instead of lexing the replacement list again
+	// This is not done in the first column, since the lexer treats the start of a line differently (see 'lex_replacement_list')
+	if (_token.location.column > 1)
+	{
+		if (std::shared_ptr<const include_file> replacement_tokens = find_replacement_tokens(name, macro))
+		{
+			push(std::move(replacement_tokens), _token.location);
+
+			_input_stack[_current_input_index].hidden_macros.insert(name);
+			return;
+		}
+	}
+
 	std::string input;
 	input.reserve(macro.replacement_list.size());
 
@@ -1315,7 +1848,7 @@ void reshadefx::preprocessor::create_macro_replacement_list(macro &macro)
 				if (!expect(tokenid::identifier))
 					return;
 
-				const auto it = std::find(macro.parameters.begin(), macro.parameters.end(), _token.literal_as_string);
+				const auto it = std::find(macro.parameters.begin(), macro.parameters.end(), _token.literal_as_string.str());
 				if (it == macro.parameters.end() && !(macro.is_variadic && _token.literal_as_string == "__VA_ARGS__"))
 					return error(_token.location, "# must be followed by parameter name");
 
@@ -1337,7 +1870,7 @@ void reshadefx::preprocessor::create_macro_replacement_list(macro &macro)
 				macro.replacement_list += ' ';
 			break;
 		case tokenid::identifier:
-			if (const auto it = std::find(macro.parameters.begin(), macro.parameters.end(), _token.literal_as_string);
+			if (const auto it = std::find(macro.parameters.begin(), macro.parameters.end(), _token.literal_as_string.str());
 				it != macro.parameters.end() || (macro.is_variadic && _token.literal_as_string == "__VA_ARGS__"))
 			{
 				macro.replacement_list += macro_replacement_start;
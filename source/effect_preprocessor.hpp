@@ -102,18 +102,46 @@ namespace reshadefx
 			token pp_token;
 			size_t input_index;
 		};
+		struct include_file;
+		struct macro_table;
+		struct snapshot;
+		struct shared_cache;
 		struct input_level
 		{
-			std::string name;
+			interned_string name;
 			std::unique_ptr<class lexer> lexer;
+			// Included files are not lexed again, but replay the token stream shared by all preprocessor instances from the include cache instead
+			std::shared_ptr<const include_file> file;
+			size_t next_file_token = 0;
+			// Location the replayed tokens are moved to if this is the replacement list of a macro
+			location start_location;
 			token next_token;
 			std::unordered_set<std::string> hidden_macros;
+
+			token lex();
+			const std::string &input_string() const;
 		};
 
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
+		static std::shared_ptr<const include_file> load_include_file(const std::filesystem::path &path, const std::string &path_string);
+
+		static std::shared_ptr<const include_file> lex_replacement_list(const macro &macro);
+
+		const std::pair<const std::string, macro> *find_macro(const std::string &name) const;
+		std::shared_ptr<const include_file> find_replacement_tokens(const std::string &name, const macro &macro);
+		void append_macro_definitions(std::string &key) const;
+		void freeze_macros();
+
+		std::string build_snapshot_key(const std::string &file_path_string) const;
+		bool restore_snapshot(const std::string &key);
+		void save_snapshot(bool complete_line);
+
 		void push(std::string input, const std::string &name = std::string());
+		void push(std::shared_ptr<const include_file> file);
+		void push(std::shared_ptr<const include_file> replacement_tokens, const location &start_location);
+		void push(input_level &&level);
 
 		bool peek(tokenid tokid) const;
 		void consume();
@@ -155,11 +183,25 @@ namespace reshadefx
 
 		unsigned short _recursion_count = 0;
 		std::unordered_set<std::string> _used_macros;
+		// Macros defined since the macro table was last frozen, which take precedence over the frozen ones
 		std::unordered_map<std::string, macro> _macros;
+		// Frozen macros that were removed again with #undef
+		std::unordered_set<std::string> _undefined_macros;
+		std::shared_ptr<const macro_table> _frozen_macros;
+		// Replacement lists of macros in '_macros' that were lexed on their first expansion
+		std::unordered_map<std::string, std::shared_ptr<const include_file>> _macro_tokens;
 
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _file_cache;
+		std::unordered_map<std::string, std::shared_ptr<const include_file>> _file_cache;
+		std::unordered_set<std::string> _pragma_once_files;
 
 		std::vector<std::pair<std::string, std::string>> _used_pragmas;
+
+		// Set while only include directives were encountered at the top level of the current input, so that the includes can be resumed from a snapshot
+		bool _include_prefix = false;
+		// Key of the snapshot to save once the include that is currently being processed was finished
+		std::string _snapshot_key;
+		size_t _snapshot_output_offset = 0;
+		size_t _snapshot_errors_offset = 0;
 	};
 }
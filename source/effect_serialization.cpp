@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_serialization.hpp"
+
+using namespace reshadefx;
+
+static void write_type(binary_writer &writer, const type &type)
+{
+	writer.write(static_cast<uint32_t>(type.base));
+	writer.write(static_cast<uint32_t>(type.rows | (type.cols << 4) | (type.qualifiers << 8)));
+	writer.write(type.array_length);
+	writer.write(type.struct_definition);
+}
+static bool read_type(binary_reader &reader, type &type)
+{
+	uint32_t base = 0, packed = 0;
+	if (!reader.read(base) || !reader.read(packed) || !reader.read(type.array_length) || !reader.read(type.struct_definition))
+		return false;
+	type.base = static_cast<type::datatype>(base);
+	type.rows = packed & 0xF;
+	type.cols = (packed >> 4) & 0xF;
+	type.qualifiers = (packed >> 8) & 0xFFFF;
+	return true;
+}
+
+static void write_constant(binary_writer &writer, const constant &value)
+{
+	for (const uint32_t element : value.as_uint)
+		writer.write(element);
+	writer.write_string(value.string_data);
+	writer.write(static_cast<uint32_t>(value.array_data.size()));
+	for (const constant &element : value.array_data)
+		write_constant(writer, element);
+}
+static bool read_constant(binary_reader &reader, constant &value)
+{
+	for (uint32_t &element : value.as_uint)
+		if (!reader.read(element))
+			return false;
+	uint32_t count = 0;
+	if (!reader.read_string(value.string_data) || !reader.read_count(count))
+		return false;
+	value.array_data.resize(count);
+	for (constant &element : value.array_data)
+		if (!read_constant(reader, element))
+			return false;
+	return true;
+}
+
+static void write_annotations(binary_writer &writer, const std::vector<annotation> &annotations)
+{
+	writer.write(static_cast<uint32_t>(annotations.size()));
+	for (const annotation &annotation : annotations)
+	{
+		write_type(writer, annotation.type);
+		writer.write_string(annotation.name);
+		write_constant(writer, annotation.value);
+	}
+}
+static bool read_annotations(binary_reader &reader, std::vector<annotation> &annotations)
+{
+	uint32_t count = 0;
+	if (!reader.read_count(count))
+		return false;
+	annotations.resize(count);
+	for (annotation &annotation : annotations)
+		if (!read_type(reader, annotation.type) || !reader.read_string(annotation.name) || !read_constant(reader, annotation.value))
+			return false;
+	return true;
+}
+
+static void write_uniforms(binary_writer &writer, const std::vector<uniform> &uniforms)
+{
+	writer.write(static_cast<uint32_t>(uniforms.size()));
+	for (const uniform &uniform : uniforms)
+	{
+		write_type(writer, uniform.type);
+		writer.write_string(uniform.name);
+		writer.write(uniform.size);
+		writer.write(uniform.offset);
+		write_annotations(writer, uniform.annotations);
+		writer.write(uniform.has_initializer_value);
+		write_constant(writer, uniform.initializer_value);
+	}
+}
+static bool read_uniforms(binary_reader &reader, std::vector<uniform> &uniforms)
+{
+	uint32_t count = 0;
+	if (!reader.read_count(count))
+		return false;
+	uniforms.resize(count);
+	for (uniform &uniform : uniforms)
+	{
+		if (!read_type(reader, uniform.type) ||
+			!reader.read_string(uniform.name) ||
+			!reader.read(uniform.size) ||
+			!reader.read(uniform.offset) ||
+			!read_annotations(reader, uniform.annotations) ||
+			!reader.read(uniform.has_initializer_value) ||
+			!read_constant(reader, uniform.initializer_value))
+			return false;
+	}
+	return true;
+}
+
+static void write_pass(binary_writer &writer, const pass &pass)
+{
+	writer.write_string(pass.name);
+	for (const std::string &render_target_name : pass.render_target_names)
+		writer.write_string(render_target_name);
+	writer.write_string(pass.vs_entry_point);
+	writer.write_string(pass.ps_entry_point);
+	writer.write_string(pass.cs_entry_point);
+	writer.write(pass.generate_mipmaps);
+	writer.write(pass.clear_render_targets);
+	for (int i = 0; i < 8; ++i)
+	{
+		writer.write(pass.blend_enable[i]);
+		writer.write(pass.source_color_blend_factor[i]);
+		writer.write(pass.dest_color_blend_factor[i]);
+		writer.write(pass.color_blend_op[i]);
+		writer.write(pass.source_alpha_blend_factor[i]);
+		writer.write(pass.dest_alpha_blend_factor[i]);
+		writer.write(pass.alpha_blend_op[i]);
+		writer.write(pass.render_target_write_mask[i]);
+	}
+	writer.write(pass.srgb_write_enable);
+	writer.write(pass.stencil_enable);
+	writer.write(pass.stencil_read_mask);
+	writer.write(pass.stencil_write_mask);
+	writer.write(pass.stencil_reference_value);
+	writer.write(pass.stencil_comparison_func);
+	writer.write(pass.stencil_pass_op);
+	writer.write(pass.stencil_fail_op);
+	writer.write(pass.stencil_depth_fail_op);
+	writer.write(pass.topology);
+	writer.write(pass.num_vertices);
+	writer.write(pass.viewport_width);
+	writer.write(pass.viewport_height);
+	writer.write(pass.viewport_dispatch_z);
+	writer.write_string(pass.skip_uniform_name);
+	writer.write(pass.skip_uniform_value);
+
+	writer.write(static_cast<uint32_t>(pass.texture_bindings.size()));
+	for (const texture_binding &binding : pass.texture_bindings)
+	{
+		writer.write(static_cast<uint64_t>(binding.index));
+		writer.write(binding.entry_point_binding);
+		writer.write(binding.srgb);
+	}
+	writer.write(static_cast<uint32_t>(pass.sampler_bindings.size()));
+	for (const sampler_binding &binding : pass.sampler_bindings)
+	{
+		writer.write(static_cast<uint64_t>(binding.index));
+		writer.write(binding.entry_point_binding);
+	}
+	writer.write(static_cast<uint32_t>(pass.storage_bindings.size()));
+	for (const storage_binding &binding : pass.storage_bindings)
+	{
+		writer.write(static_cast<uint64_t>(binding.index));
+		writer.write(binding.entry_point_binding);
+	}
+}
+static bool read_pass(binary_reader &reader, pass &pass)
+{
+	if (!reader.read_string(pass.name))
+		return false;
+	for (std::string &render_target_name : pass.render_target_names)
+		if (!reader.read_string(render_target_name))
+			return false;
+	if (!reader.read_string(pass.vs_entry_point) ||
+		!reader.read_string(pass.ps_entry_point) ||
+		!reader.read_string(pass.cs_entry_point) ||
+		!reader.read(pass.generate_mipmaps) ||
+		!reader.read(pass.clear_render_targets))
+		return false;
+	for (int i = 0; i < 8; ++i)
+	{
+		if (!reader.read(pass.blend_enable[i]) ||
+			!reader.read(pass.source_color_blend_factor[i]) ||
+			!reader.read(pass.dest_color_blend_factor[i]) ||
+			!reader.read(pass.color_blend_op[i]) ||
+			!reader.read(pass.source_alpha_blend_factor[i]) ||
+			!reader.read(pass.dest_alpha_blend_factor[i]) ||
+			!reader.read(pass.alpha_blend_op[i]) ||
+			!reader.read(pass.render_target_write_mask[i]))
+			return false;
+	}
+	if (!reader.read(pass.srgb_write_enable) ||
+		!reader.read(pass.stencil_enable) ||
+		!reader.read(pass.stencil_read_mask) ||
+		!reader.read(pass.stencil_write_mask) ||
+		!reader.read(pass.stencil_reference_value) ||
+		!reader.read(pass.stencil_comparison_func) ||
+		!reader.read(pass.stencil_pass_op) ||
+		!reader.read(pass.stencil_fail_op) ||
+		!reader.read(pass.stencil_depth_fail_op) ||
+		!reader.read(pass.topology) ||
+		!reader.read(pass.num_vertices) ||
+		!reader.read(pass.viewport_width) ||
+		!reader.read(pass.viewport_height) ||
+		!reader.read(pass.viewport_dispatch_z) ||
+		!reader.read_string(pass.skip_uniform_name) ||
+		!reader.read(pass.skip_uniform_value))
+		return false;
+
+	uint32_t count = 0;
+	uint64_t index = 0;
+	if (!reader.read_count(count))
+		return false;
+	pass.texture_bindings.resize(count);
+	for (texture_binding &binding : pass.texture_bindings)
+	{
+		if (!reader.read(index) || !reader.read(binding.entry_point_binding) || !reader.read(binding.srgb))
+			return false;
+		binding.index = static_cast<size_t>(index);
+	}
+	if (!reader.read_count(count))
+		return false;
+	pass.sampler_bindings.resize(count);
+	for (sampler_binding &binding : pass.sampler_bindings)
+	{
+		if (!reader.read(index) || !reader.read(binding.entry_point_binding))
+			return false;
+		binding.index = static_cast<size_t>(index);
+	}
+	if (!reader.read_count(count))
+		return false;
+	pass.storage_bindings.resize(count);
+	for (storage_binding &binding : pass.storage_bindings)
+	{
+		if (!reader.read(index) || !reader.read(binding.entry_point_binding))
+			return false;
+		binding.index = static_cast<size_t>(index);
+	}
+	return true;
+}
+
+void reshadefx::write_module(binary_writer &writer, const effect_module &module)
+{
+	writer.write(serialization_version);
+
+	writer.write(static_cast<uint32_t>(module.textures.size()));
+	for (const texture &texture : module.textures)
+	{
+		writer.write(texture.width);
+		writer.write(texture.height);
+		writer.write(texture.depth);
+		writer.write(texture.levels);
+		writer.write(texture.type);
+		writer.write(texture.format);
+		writer.write(texture.id);
+		writer.write_string(texture.name);
+		writer.write_string(texture.unique_name);
+		writer.write_string(texture.semantic);
+		write_annotations(writer, texture.annotations);
+		writer.write(texture.render_target);
+		writer.write(texture.storage_access);
+	}
+
+	writer.write(static_cast<uint32_t>(module.samplers.size()));
+	for (const sampler &sampler : module.samplers)
+	{
+		writer.write(sampler.filter);
+		writer.write(sampler.address_u);
+		writer.write(sampler.address_v);
+		writer.write(sampler.address_w);
+		writer.write(sampler.min_lod);
+		writer.write(sampler.max_lod);
+		writer.write(sampler.lod_bias);
+		write_type(writer, sampler.type);
+		writer.write(sampler.id);
+		writer.write_string(sampler.name);
+		writer.write_string(sampler.unique_name);
+		writer.write_string(sampler.texture_name);
+		write_annotations(writer, sampler.annotations);
+		writer.write(sampler.srgb);
+	}
+
+	writer.write(static_cast<uint32_t>(module.storages.size()));
+	for (const storage &storage : module.storages)
+	{
+		writer.write(storage.level);
+		write_type(writer, storage.type);
+		writer.write(storage.id);
+		writer.write_string(storage.name);
+		writer.write_string(storage.unique_name);
+		writer.write_string(storage.texture_name);
+	}
+
+	write_uniforms(writer, module.uniforms);
+	write_uniforms(writer, module.spec_constants);
+	writer.write(module.total_uniform_size);
+
+	writer.write(static_cast<uint32_t>(module.techniques.size()));
+	for (const technique &technique : module.techniques)
+	{
+		writer.write_string(technique.name);
+		writer.write(static_cast<uint32_t>(technique.passes.size()));
+		for (const pass &pass : technique.passes)
+			write_pass(writer, pass);
+		write_annotations(writer, technique.annotations);
+	}
+
+	writer.write(static_cast<uint32_t>(module.entry_points.size()));
+	for (const std::pair<std::string, shader_type> &entry_point : module.entry_points)
+	{
+		writer.write_string(entry_point.first);
+		writer.write(static_cast<uint32_t>(entry_point.second));
+	}
+}
+
+bool reshadefx::read_module(binary_reader &reader, effect_module &module)
+{
+	if (uint32_t version = 0; !reader.read(version) || version != serialization_version)
+		return false;
+
+	uint32_t count = 0;
+
+	if (!reader.read_count(count))
+		return false;
+	module.textures.resize(count);
+	for (texture &texture : module.textures)
+	{
+		if (!reader.read(texture.width) ||
+			!reader.read(texture.height) ||
+			!reader.read(texture.depth) ||
+			!reader.read(texture.levels) ||
+			!reader.read(texture.type) ||
+			!reader.read(texture.format) ||
+			!reader.read(texture.id) ||
+			!reader.read_string(texture.name) ||
+			!reader.read_string(texture.unique_name) ||
+			!reader.read_string(texture.semantic) ||
+			!read_annotations(reader, texture.annotations) ||
+			!reader.read(texture.render_target) ||
+			!reader.read(texture.storage_access))
+			return false;
+	}
+
+	if (!reader.read_count(count))
+		return false;
+	module.samplers.resize(count);
+	for (sampler &sampler : module.samplers)
+	{
+		if (!reader.read(sampler.filter) ||
+			!reader.read(sampler.address_u) ||
+			!reader.read(sampler.address_v) ||
+			!reader.read(sampler.address_w) ||
+			!reader.read(sampler.min_lod) ||
+			!reader.read(sampler.max_lod) ||
+			!reader.read(sampler.lod_bias) ||
+			!read_type(reader, sampler.type) ||
+			!reader.read(sampler.id) ||
+			!reader.read_string(sampler.name) ||
+			!reader.read_string(sampler.unique_name) ||
+			!reader.read_string(sampler.texture_name) ||
+			!read_annotations(reader, sampler.annotations) ||
+			!reader.read(sampler.srgb))
+			return false;
+	}
+
+	if (!reader.read_count(count))
+		return false;
+	module.storages.resize(count);
+	for (storage &storage : module.storages)
+	{
+		if (!reader.read(storage.level) ||
+			!read_type(reader, storage.type) ||
+			!reader.read(storage.id) ||
+			!reader.read_string(storage.name) ||
+			!reader.read_string(storage.unique_name) ||
+			!reader.read_string(storage.texture_name))
+			return false;
+	}
+
+	if (!read_uniforms(reader, module.uniforms) ||
+		!read_uniforms(reader, module.spec_constants) ||
+		!reader.read(module.total_uniform_size))
+		return false;
+
+	if (!reader.read_count(count))
+		return false;
+	module.techniques.resize(count);
+	for (technique &technique : module.techniques)
+	{
+		if (!reader.read_string(technique.name) || !reader.read_count(count))
+			return false;
+		technique.passes.resize(count);
+		for (pass &pass : technique.passes)
+			if (!read_pass(reader, pass))
+				return false;
+		if (!read_annotations(reader, technique.annotations))
+			return false;
+	}
+
+	if (!reader.read_count(count))
+		return false;
+	module.entry_points.resize(count);
+	for (std::pair<std::string, shader_type> &entry_point : module.entry_points)
+	{
+		uint32_t type = 0;
+		if (!reader.read_string(entry_point.first) || !reader.read(type))
+			return false;
+		entry_point.second = static_cast<shader_type>(type);
+	}
+
+	return true;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <cstring> // std::memcpy
+#include <string_view>
+#include <type_traits>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// Version of the binary format written by <see cref="write_module"/>. Has to be increased whenever any of the serialized structures or the way the code generators fill them change.
+	/// </summary>
+	constexpr uint32_t serialization_version = 3;
+
+	/// <summary>
+	/// Appends values in a compact binary representation to a string.
+	/// </summary>
+	class binary_writer
+	{
+	public:
+		explicit binary_writer(std::string &data) : _data(data) {}
+
+		template <typename T>
+		void write(T value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			_data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+		}
+		void write_string(std::string_view value)
+		{
+			write(static_cast<uint32_t>(value.size()));
+			_data.append(value.data(), value.size());
+		}
+
+	private:
+		std::string &_data;
+	};
+
+	/// <summary>
+	/// Reads values written by a <see cref="binary_writer"/> back from a string.
+	/// All functions return <see langword="false"/> once the end of the data was reached, so that truncated or corrupted data is detected.
+	/// </summary>
+	class binary_reader
+	{
+	public:
+		explicit binary_reader(std::string_view data) : _data(data) {}
+
+		template <typename T>
+		bool read(T &value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			if (_data.size() - _offset < sizeof(value))
+				return false;
+			std::memcpy(&value, _data.data() + _offset, sizeof(value));
+			_offset += sizeof(value);
+			return true;
+		}
+		bool read_string(std::string &value)
+		{
+			uint32_t size = 0;
+			if (!read(size) || _data.size() - _offset < size)
+				return false;
+			value.assign(_data.data() + _offset, size);
+			_offset += size;
+			return true;
+		}
+		/// <summary>
+		/// Reads the number of elements of a container and checks that it is plausible for the remaining data, to avoid huge allocations for corrupted data.
+		/// </summary>
+		bool read_count(uint32_t &count)
+		{
+			return read(count) && count <= _data.size() - _offset;
+		}
+
+		bool at_end() const { return _offset == _data.size(); }
+
+	private:
+		std::string_view _data;
+		size_t _offset = 0;
+	};
+
+	/// <summary>
+	/// Writes the binary representation of the specified effect <paramref name="module"/>, so that it can be restored later without having to parse the effect again.
+	/// </summary>
+	void write_module(binary_writer &writer, const effect_module &module);
+	/// <summary>
+	/// Reads an effect module that was written by <see cref="write_module"/>.
+	/// </summary>
+	/// <returns><see langword="true"/> if the module was read successfully, <see langword="false"/> if the data was truncated or written with a different <see cref="serialization_version"/>.</returns>
+	bool read_module(binary_reader &reader, effect_module &module);
+}
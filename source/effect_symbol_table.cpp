@@ -6,7 +6,8 @@
 #include "effect_symbol_table.hpp"
 #include <cassert>
 #include <malloc.h> // alloca
-#include <algorithm> // std::upper_bound, std::sort
+#include <string_view>
+#include <algorithm> // std::equal_range, std::stable_sort, std::upper_bound, std::sort
 #include <functional> // std::greater
 
 enum class intrinsic_id
@@ -123,6 +124,22 @@ static const intrinsic s_intrinsics[] =
 	#include "effect_symbol_table_intrinsics.inl"
 };
 
+// Intrinsics sorted by name, so that overloads of an intrinsic can be found with a binary search instead of comparing against every intrinsic
+// The sort is stable, so overloads are still visited in the order they are defined in, which matters for picking between equally viable ones
+static const std::vector<std::pair<std::string_view, const intrinsic *>> &intrinsics_by_name()
+{
+	static const std::vector<std::pair<std::string_view, const intrinsic *>> index = []() {
+		std::vector<std::pair<std::string_view, const intrinsic *>> result;
+		result.reserve(std::size(s_intrinsics));
+		for (const intrinsic &intrinsic : s_intrinsics)
+			result.emplace_back(intrinsic.name, &intrinsic);
+		std::stable_sort(result.begin(), result.end(),
+			[](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+		return result;
+	}();
+	return index;
+}
+
 #undef void
 #undef bool
 #undef bool2
@@ -202,9 +219,10 @@ void reshadefx::symbol_table::leave_scope()
 {
 	assert(_current_scope.level > 0);
 
-	for (auto &symbol : _symbol_stack)
+	// Levels of the recorded lists never decrease, since symbols are only ever added to the current scope, so all lists of this scope are at the end
+	while (!_local_symbol_lists.empty() && _local_symbol_lists.back().first >= _current_scope.level)
 	{
-		std::vector<scoped_symbol> &scope_list = symbol.second;
+		auto &scope_list = *_local_symbol_lists.back().second;
 
 		for (auto scope_it = scope_list.begin(); scope_it != scope_list.end();)
 		{
@@ -218,6 +236,8 @@ void reshadefx::symbol_table::leave_scope()
 				++scope_it;
 			}
 		}
+
+		_local_symbol_lists.pop_back();
 	}
 
 	_current_scope.level--;
@@ -244,7 +264,7 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	const auto insert_sorted = [](auto &vec, const auto &item) {
 		return vec.insert(
 			std::upper_bound(vec.begin(), vec.end(), item,
-				[](auto lhs, auto rhs) {
+				[](const auto &lhs, const auto &rhs) {
 					return lhs.scope.namespace_level < rhs.scope.namespace_level;
 				}), item);
 	};
@@ -271,7 +291,13 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	else
 	{
 		// This is a local symbol so it's sufficient to update the symbol stack with just the current scope
-		insert_sorted(_symbol_stack[name], scoped_symbol { symbol, _current_scope });
+		auto &scope_list = _symbol_stack[name];
+		insert_sorted(scope_list, scoped_symbol { symbol, _current_scope });
+
+		// Only symbols outside of namespace scope are removed again when leaving the scope, so only need to remember those
+		// Elements of an unordered map are not moved when it grows, so the pointer stays valid
+		if (_current_scope.level > _current_scope.namespace_level)
+			_local_symbol_lists.emplace_back(_current_scope.level, &scope_list);
 	}
 
 	return true;
@@ -426,9 +452,15 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	// Try matching against intrinsic functions if no matching user-defined function was found up to this point
 	if (num_overloads == 0)
 	{
-		for (const intrinsic &intrinsic : s_intrinsics)
+		const auto &index = intrinsics_by_name();
+		const auto range = std::equal_range(index.begin(), index.end(), std::pair<std::string_view, const struct intrinsic *>(name, nullptr),
+			[](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+		for (auto it = range.first; it != range.second; ++it)
 		{
-			if (intrinsic.name != name || intrinsic.parameter_list.size() != arguments.size())
+			const struct intrinsic &intrinsic = *it->second;
+
+			if (intrinsic.parameter_list.size() != arguments.size())
 				continue;
 
 			// A new possibly-matching intrinsic function was found, compare it against the current result
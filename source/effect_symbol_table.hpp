@@ -7,6 +7,7 @@
 
 #include "effect_module.hpp"
 #include <unordered_map> // Used for symbol lookup table
+#include <memory_resource>
 
 namespace reshadefx
 {
@@ -97,7 +98,11 @@ namespace reshadefx
 
 	private:
 		scope _current_scope;
+		// Arena for the lookup table below, which is released in one go when the symbol table is destroyed at the end of parsing
+		std::pmr::monotonic_buffer_resource _arena { 32 * 1024 };
 		// Lookup table from name to matching symbols
-		std::unordered_map<std::string, std::vector<scoped_symbol>> _symbol_stack;
+		std::pmr::unordered_map<std::string, std::pmr::vector<scoped_symbol>> _symbol_stack { &_arena };
+		// Symbol lists local symbols were added to, together with the scope level they were added at, so that leaving a scope only has to visit those instead of every name in the table
+		std::pmr::vector<std::pair<uint32_t, std::pmr::vector<scoped_symbol> *>> _local_symbol_lists { &_arena };
 	};
 }
@@ -6,11 +6,41 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
 namespace reshadefx
 {
+	/// <summary>
+	/// A 32-bit handle to a string in a process-wide table of unique strings.
+	/// Copying and comparing handles is trivial and the string data is never freed, so references returned by <see cref="str"/> stay valid.
+	/// </summary>
+	class interned_string
+	{
+	public:
+		interned_string() : _index(0) {}
+		/// <summary>
+		/// Looks up the specified string in the table, adding it if it does not exist yet.
+		/// </summary>
+		explicit interned_string(std::string_view str);
+
+		operator const std::string &() const { return str(); }
+
+		const std::string &str() const;
+		const char *c_str() const { return str().c_str(); }
+
+		bool empty() const { return _index == 0; }
+
+		bool operator==(const interned_string &other) const { return _index == other._index; }
+		bool operator!=(const interned_string &other) const { return _index != other._index; }
+		bool operator==(std::string_view other) const { return str() == other; }
+		bool operator!=(std::string_view other) const { return str() != other; }
+
+	private:
+		uint32_t _index;
+	};
+
 	/// <summary>
 	/// Structure which keeps track of a code location.
 	/// </summary>
@@ -18,9 +48,9 @@ namespace reshadefx
 	{
 		location() : line(1), column(1) {}
 		explicit location(uint32_t line, uint32_t column = 1) : line(line), column(column) {}
-		explicit location(std::string source, uint32_t line, uint32_t column = 1) : source(std::move(source)), line(line), column(column) {}
+		explicit location(interned_string source, uint32_t line, uint32_t column = 1) : source(source), line(line), column(column) {}
 
-		std::string source;
+		interned_string source;
 		uint32_t line, column;
 	};
 
@@ -244,7 +274,7 @@ namespace reshadefx
 			float literal_as_float;
 			double literal_as_double;
 		};
-		std::string literal_as_string;
+		interned_string literal_as_string;
 
 		operator tokenid() const { return id; }
 
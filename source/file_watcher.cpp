@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "file_watcher.hpp"
+#include "dll_log.hpp"
+#include <memory>
+#include <algorithm> // std::sort, std::unique
+#include <Windows.h>
+
+reshade::file_watcher::file_watcher(std::vector<std::pair<std::filesystem::path, bool>> directories) :
+	_directories(std::move(directories))
+{
+	// Only a limited number of handles can be waited on at once, one of which is the exit event
+	if (_directories.size() > MAXIMUM_WAIT_OBJECTS - 1)
+	{
+		log::message(log::level::warning, "Only watching the first %u of %zu directories for file modifications.", MAXIMUM_WAIT_OBJECTS - 1, _directories.size());
+		_directories.resize(MAXIMUM_WAIT_OBJECTS - 1);
+	}
+
+	_exit_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (_exit_event == nullptr)
+		return;
+
+	_thread = std::thread(&file_watcher::thread_main, this);
+}
+reshade::file_watcher::~file_watcher()
+{
+	if (_exit_event == nullptr)
+		return;
+
+	SetEvent(static_cast<HANDLE>(_exit_event));
+	if (_thread.joinable())
+		_thread.join();
+
+	CloseHandle(static_cast<HANDLE>(_exit_event));
+}
+
+bool reshade::file_watcher::poll(std::vector<std::filesystem::path> &modified_files, std::chrono::milliseconds debounce_interval)
+{
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (_modified_files.empty() || std::chrono::steady_clock::now() - _last_change_time < debounce_interval)
+		return false;
+
+	std::sort(_modified_files.begin(), _modified_files.end());
+	_modified_files.erase(std::unique(_modified_files.begin(), _modified_files.end()), _modified_files.end());
+
+	modified_files = std::move(_modified_files);
+	_modified_files.clear();
+	return true;
+}
+
+void reshade::file_watcher::thread_main()
+{
+	struct watched_directory
+	{
+		const std::filesystem::path *path = nullptr;
+		bool recursive = false;
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		OVERLAPPED overlapped = {};
+		// Change records have to be DWORD aligned
+		alignas(DWORD) BYTE buffer[32 * 1024];
+	};
+
+	const DWORD notify_filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	std::vector<std::unique_ptr<watched_directory>> watched_directories;
+	std::vector<HANDLE> wait_handles;
+	wait_handles.push_back(static_cast<HANDLE>(_exit_event));
+
+	for (const std::pair<std::filesystem::path, bool> &directory : _directories)
+	{
+		auto watched = std::make_unique<watched_directory>();
+		watched->path = &directory.first;
+		watched->recursive = directory.second;
+		watched->handle = CreateFileW(directory.first.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (watched->handle == INVALID_HANDLE_VALUE)
+		{
+			log::message(log::level::warning, "Failed to watch directory '%s' for file modifications with error code %lu.", directory.first.u8string().c_str(), GetLastError());
+			continue;
+		}
+
+		watched->overlapped.hEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		if (watched->overlapped.hEvent == nullptr ||
+			!ReadDirectoryChangesW(watched->handle, watched->buffer, sizeof(watched->buffer), directory.second, notify_filter, nullptr, &watched->overlapped, nullptr))
+		{
+			log::message(log::level::warning, "Failed to watch directory '%s' for file modifications with error code %lu.", directory.first.u8string().c_str(), GetLastError());
+			if (watched->overlapped.hEvent != nullptr)
+				CloseHandle(watched->overlapped.hEvent);
+			CloseHandle(watched->handle);
+			continue;
+		}
+
+		wait_handles.push_back(watched->overlapped.hEvent);
+		watched_directories.push_back(std::move(watched));
+	}
+
+	while (true)
+	{
+		const DWORD wait_result = WaitForMultipleObjects(static_cast<DWORD>(wait_handles.size()), wait_handles.data(), FALSE, INFINITE);
+		if (wait_result == WAIT_OBJECT_0 || wait_result >= WAIT_OBJECT_0 + wait_handles.size())
+			break; // Exit was requested or waiting failed
+
+		const size_t index = wait_result - WAIT_OBJECT_0 - 1;
+		watched_directory &watched = *watched_directories[index];
+
+		DWORD size = 0;
+		if (GetOverlappedResult(watched.handle, &watched.overlapped, &size, FALSE) && size != 0)
+		{
+			const std::unique_lock<std::mutex> lock(_mutex);
+
+			for (const BYTE *record = watched.buffer;;)
+			{
+				const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(record);
+
+				if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+					_modified_files.push_back(*watched.path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+				if (info->NextEntryOffset == 0)
+					break;
+				record += info->NextEntryOffset;
+			}
+
+			_last_change_time = std::chrono::steady_clock::now();
+		}
+		// A size of zero means the buffer overflowed and the changes were lost, which only happens for large batches of changes that are then picked up by the next manual reload
+
+		// Queue up the next read, which coalesces any changes that happened since the last one
+		if (!ReadDirectoryChangesW(watched.handle, watched.buffer, sizeof(watched.buffer), watched.recursive, notify_filter, nullptr, &watched.overlapped, nullptr))
+		{
+			// This happens when the directory was deleted, so stop watching it
+			log::message(log::level::warning, "Stopped watching directory '%s' for file modifications with error code %lu.", watched.path->u8string().c_str(), GetLastError());
+
+			CloseHandle(watched.overlapped.hEvent);
+			CloseHandle(watched.handle);
+			watched_directories.erase(watched_directories.begin() + index);
+			wait_handles.erase(wait_handles.begin() + 1 + index);
+		}
+	}
+
+	for (const std::unique_ptr<watched_directory> &watched : watched_directories)
+	{
+		CancelIoEx(watched->handle, &watched->overlapped);
+		DWORD size = 0;
+		GetOverlappedResult(watched->handle, &watched->overlapped, &size, TRUE);
+
+		CloseHandle(watched->overlapped.hEvent);
+		CloseHandle(watched->handle);
+	}
+}
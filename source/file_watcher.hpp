@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Watches directories for modified files on a background thread.
+	/// Modifications are only reported once no further change came in for a while, since editors commonly write a file several times when saving it.
+	/// </summary>
+	class file_watcher
+	{
+	public:
+		/// <summary>
+		/// Starts watching the specified directories.
+		/// </summary>
+		/// <param name="directories">Absolute paths of the directories to watch, each with whether its subdirectories are watched as well.</param>
+		explicit file_watcher(std::vector<std::pair<std::filesystem::path, bool>> directories);
+		/// <summary>
+		/// Stops watching and joins the background thread.
+		/// </summary>
+		~file_watcher();
+
+		file_watcher(const file_watcher &) = delete;
+		file_watcher &operator=(const file_watcher &) = delete;
+
+		/// <summary>
+		/// Gets the files that were modified since the last call, once there were no further changes for the specified <paramref name="debounce_interval"/>.
+		/// </summary>
+		/// <param name="modified_files">Receives the absolute paths of the modified files, without duplicates.</param>
+		/// <param name="debounce_interval">Time to wait after the last change before reporting any of them.</param>
+		/// <returns><see langword="true"/> if any modified files were returned, <see langword="false"/> otherwise.</returns>
+		bool poll(std::vector<std::filesystem::path> &modified_files, std::chrono::milliseconds debounce_interval);
+
+	private:
+		void thread_main();
+
+		std::vector<std::pair<std::filesystem::path, bool>> _directories;
+		void *_exit_event = nullptr;
+		std::thread _thread;
+
+		std::mutex _mutex;
+		std::vector<std::filesystem::path> _modified_files;
+		std::chrono::steady_clock::time_point _last_change_time;
+	};
+}
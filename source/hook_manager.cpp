@@ -6,9 +6,12 @@
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
 #include <vector>
+#include <mutex>
 #include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
 #include <cstring> // std::strcmp
-#include <algorithm> // std::find_if, std::remove, std::remove_if
+#include <algorithm> // std::find_if, std::remove, std::remove_if, std::sort
 #include <Windows.h>
 
 enum class hook_method
@@ -41,6 +44,15 @@ static std::vector<named_hook> s_hooks;
 static std::shared_mutex s_delayed_hook_paths_mutex;
 static std::vector<std::filesystem::path> s_delayed_hook_paths;
 static PVOID s_dll_notification_cookie = nullptr;
+// Thread that currently has a batch open (see 'reshade::hooks::begin_batch'), and the virtual function table entries it still has to patch
+static DWORD s_batch_thread_id = 0;
+static unsigned int s_batch_depth = 0;
+static std::vector<std::pair<reshade::hook::address *, reshade::hook::address>> s_batch_vtable_writes;
+
+static bool is_batching()
+{
+	return s_batch_depth != 0 && s_batch_thread_id == GetCurrentThreadId();
+}
 
 static std::vector<module_export> enumerate_module_exports(HMODULE handle)
 {
@@ -75,6 +87,25 @@ static std::vector<module_export> enumerate_module_exports(HMODULE handle)
 
 	return exports;
 }
+static const std::unordered_map<std::string_view, reshade::hook::address> &index_module_exports(HMODULE handle)
+{
+	// The replacement module is the same for every target module, so only enumerate its (large) export table once and keep an index by name for matching
+	// The names point into the image of the module, which stays valid as long as it is loaded
+	static std::mutex s_export_index_mutex;
+	static std::unordered_map<HMODULE, std::unordered_map<std::string_view, reshade::hook::address>> s_export_indices;
+
+	const std::unique_lock<std::mutex> lock(s_export_index_mutex);
+
+	if (const auto it = s_export_indices.find(handle); it != s_export_indices.end())
+		return it->second;
+
+	std::unordered_map<std::string_view, reshade::hook::address> &index = s_export_indices[handle];
+	for (const module_export &symbol : enumerate_module_exports(handle))
+		if (symbol.name != nullptr)
+			index.emplace(symbol.name, symbol.address);
+
+	return index;
+}
 
 static bool install_internal(const char *name, reshade::hook &hook, hook_method method)
 {
@@ -97,8 +128,15 @@ static bool install_internal(const char *name, reshade::hook &hook, hook_method
 		status = hook.install();
 		break;
 	case hook_method::vtable_hook:
+		// Defer patching the virtual function table until the batch is finished, so that entries on the same page share the memory protection changes
+		// The original function stays valid to call in the meantime, since the entry was not modified yet
+		if (is_batching())
+		{
+			s_batch_vtable_writes.emplace_back(static_cast<reshade::hook::address *>(hook.target), hook.replacement);
+			status = reshade::hook::status::success;
+		}
 		// Make virtual function table memory writable before modifying it
-		if (DWORD protection = PAGE_READWRITE;
+		else if (DWORD protection = PAGE_READWRITE;
 			VirtualProtect(hook.target, sizeof(reshade::hook::address), protection, &protection))
 		{
 			// Replace entry in virtual function table with the replacement function
@@ -138,7 +176,7 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 
 	// Load export tables from both modules
 	const std::vector<module_export> target_exports = enumerate_module_exports(target_module);
-	const std::vector<module_export> replacement_exports = enumerate_module_exports(replacement_module);
+	const std::unordered_map<std::string_view, reshade::hook::address> &replacement_exports = index_module_exports(replacement_module);
 
 	if (target_exports.empty())
 	{
@@ -164,10 +202,7 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 			continue;
 
 		// Find appropriate replacement
-		const auto it = std::find_if(replacement_exports.cbegin(), replacement_exports.cend(),
-			[&symbol](const module_export &module_export) {
-				return std::strcmp(module_export.name, symbol.name) == 0;
-			});
+		const auto it = replacement_exports.find(symbol.name);
 
 		// Filter out uninteresting functions
 		if (it != replacement_exports.cend() &&
@@ -189,7 +224,7 @@ static bool install_internal(HMODULE target_module, HMODULE replacement_module,
 #if RESHADE_VERBOSE_LOG
 			reshade::log::message(reshade::log::level::debug, "  | %-016p | %-7hu | %-50s |", reinterpret_cast<uintptr_t>(symbol.address), symbol.ordinal, symbol.name);
 #endif
-			matches.push_back(std::make_tuple(symbol.name, symbol.address, it->address));
+			matches.push_back(std::make_tuple(symbol.name, symbol.address, it->second));
 		}
 	}
 
@@ -275,6 +310,60 @@ static bool uninstall_internal(const char *name, reshade::hook &hook, hook_metho
 	return true;
 }
 
+static bool apply_batch_vtable_writes()
+{
+	if (s_batch_vtable_writes.empty())
+		return true;
+
+	SYSTEM_INFO system_info = {};
+	GetSystemInfo(&system_info);
+	const uintptr_t page_mask = ~static_cast<uintptr_t>(system_info.dwPageSize - 1);
+
+	std::sort(s_batch_vtable_writes.begin(), s_batch_vtable_writes.end());
+
+	bool result = true;
+
+	for (auto it = s_batch_vtable_writes.begin(); it != s_batch_vtable_writes.end();)
+	{
+		// Find all entries on the same page and change the memory protection of the range covering them only once
+		const uintptr_t page = reinterpret_cast<uintptr_t>(it->first) & page_mask;
+		const auto page_end = std::find_if(it, s_batch_vtable_writes.end(),
+			[page, page_mask](const std::pair<reshade::hook::address *, reshade::hook::address> &write) {
+				return (reinterpret_cast<uintptr_t>(write.first) & page_mask) != page;
+			});
+
+		const auto range_begin = reinterpret_cast<BYTE *>(it->first);
+		const auto range_size = static_cast<SIZE_T>(reinterpret_cast<BYTE *>((page_end - 1)->first + 1) - range_begin);
+
+		if (DWORD protection = PAGE_READWRITE;
+			VirtualProtect(range_begin, range_size, protection, &protection))
+		{
+			for (; it != page_end; ++it)
+				*it->first = it->second;
+
+			VirtualProtect(range_begin, range_size, protection, &protection);
+		}
+		else
+		{
+			reshade::log::message(reshade::log::level::error, "Failed to install %zu virtual function table hook(s) at %p with status code %d!", static_cast<size_t>(page_end - it), range_begin, static_cast<int>(reshade::hook::status::memory_protection_failure));
+			it = page_end;
+			result = false;
+		}
+	}
+
+	s_batch_vtable_writes.clear();
+
+	return result;
+}
+static bool flush_queued_actions()
+{
+	// Leave queued actions to the end of the batch, so that all of them are applied under a single suspension of all threads
+	if (is_batching())
+		return true;
+
+	return reshade::hook::apply_queued_actions();
+}
+
 static reshade::hook find_internal(reshade::hook::address target, reshade::hook::address replacement)
 {
 	assert(target != nullptr || replacement != nullptr);
@@ -326,9 +415,13 @@ static void install_delayed_hooks(const std::filesystem::path &loaded_path)
 
 				reshade::log::message(reshade::log::level::info, "Installing delayed hooks for '%s' (Just loaded via LoadLibrary('%s')) ...", path.u8string().c_str(), loaded_path.u8string().c_str());
 
-				return install_internal(delayed_handle, g_module_handle, hook_method::function_hook) && reshade::hook::apply_queued_actions();
+				return install_internal(delayed_handle, g_module_handle, hook_method::function_hook);
 			});
 
+		// Enable the hooks of all modules that were just installed at once
+		if (remove != s_delayed_hook_paths.end())
+			flush_queued_actions();
+
 		s_delayed_hook_paths.erase(remove, s_delayed_hook_paths.end());
 	}
 	else
@@ -418,7 +511,7 @@ bool reshade::hooks::install(const char *name, hook::address target, hook::addre
 	hook.replacement = replacement;
 
 	return install_internal(name, hook, hook_method::function_hook) &&
-		(queue_enable || hook::apply_queued_actions()); // Can optionally only queue up the hooks instead of installing them right away
+		(queue_enable || flush_queued_actions()); // Can optionally only queue up the hooks instead of installing them right away
 }
 bool reshade::hooks::install(const char *name, hook::address vtable[], size_t vtable_index, hook::address replacement)
 {
@@ -501,8 +594,8 @@ void reshade::hooks::register_module(const std::filesystem::path &target_path)
 			install("LoadLibraryW", reinterpret_cast<hook::address>(&LoadLibraryW), reinterpret_cast<hook::address>(&HookLoadLibraryW), true);
 			install("LoadLibraryExW", reinterpret_cast<hook::address>(&LoadLibraryExW), reinterpret_cast<hook::address>(&HookLoadLibraryExW), true);
 
-			// Install all 'LoadLibrary' hooks in one go immediately
-			if (hook::apply_queued_actions())
+			// Install all 'LoadLibrary' hooks in one go immediately (or together with the rest of the current batch)
+			if (flush_queued_actions())
 				s_dll_notification_cookie = reinterpret_cast<PVOID>(-1); // Set cookie to something so that these hooks are only installed once
 			else
 				log::message(log::level::error, "Failed to install LoadLibrary hooks!");
@@ -541,8 +634,35 @@ void reshade::hooks::register_module(const std::filesystem::path &target_path)
 
 		install_internal(handle, g_module_handle, hook_method::function_hook);
 
-		hook::apply_queued_actions();
+		flush_queued_actions();
+	}
+}
+
+void reshade::hooks::begin_batch()
+{
+	assert(s_batch_depth == 0 || s_batch_thread_id == GetCurrentThreadId());
+
+	if (s_batch_depth++ == 0)
+		s_batch_thread_id = GetCurrentThreadId();
+}
+bool reshade::hooks::end_batch()
+{
+	assert(s_batch_depth != 0 && s_batch_thread_id == GetCurrentThreadId());
+
+	if (--s_batch_depth != 0)
+		return true;
+
+	s_batch_thread_id = 0;
+
+	const bool vtable_result = apply_batch_vtable_writes();
+
+	if (!hook::apply_queued_actions())
+	{
+		log::message(log::level::error, "Failed to enable queued hooks!");
+		return false;
 	}
+
+	return vtable_result;
 }
 
 void reshade::hooks::ensure_export_module_loaded()
@@ -44,6 +44,17 @@ namespace reshade::hooks
 	/// <param name="path">File path to the target module.</param>
 	void register_module(const std::filesystem::path &path);
 
+	/// <summary>
+	/// Starts a batch of hook installations on the calling thread. Until the matching call to <see cref="end_batch"/>, enabling function hooks and patching virtual function table entries is deferred, so that all of them are applied with a single suspension of all threads and one memory protection change per page.
+	/// Batches may be nested. Hooks installed from other threads in the meantime are applied immediately as usual.
+	/// </summary>
+	void begin_batch();
+	/// <summary>
+	/// Finishes a batch of hook installations started with <see cref="begin_batch"/> and applies all hooks that were queued since.
+	/// </summary>
+	/// <returns><see langword="true"/> if all queued hooks were applied successfully, <see langword="false"/> otherwise.</returns>
+	bool end_batch();
+
 	/// <summary>
 	/// Loads the module for export hooks if it has not been loaded yet.
 	/// </summary>
@@ -1791,12 +1791,37 @@ void reshade::imgui::code_editor::colorize()
 		_colorize_line_end = 0;
 	}
 
+	// Remember whether the line after this range started inside a multi-line comment, to detect when the change needs to be carried further
+	const bool continued_before = to < _lines.size() && starts_in_multiline_comment(to);
+
 	// Copy lines into string for consumption by the lexer (needs to use the same offsets as the indices in '_lines', so strip any unicode characters which are multi-byte)
 	std::string input_string;
 	for (size_t l = from; l < to && l < _lines.size(); ++l, input_string.push_back('\n'))
 		for (size_t k = 0; k < _lines[l].size(); ++k)
 			input_string += _lines[l][k].c < 0x80 ? static_cast<char>(_lines[l][k].c) : '?';
 
+	// Continue a multi-line comment that was opened before this range, instead of lexing its remainder as code
+	if (from < _lines.size() && starts_in_multiline_comment(from))
+	{
+		size_t comment_end = input_string.find("*/");
+		comment_end = (comment_end != std::string::npos) ? comment_end + 2 : input_string.size();
+
+		size_t line = from, column = 0;
+		for (size_t k = 0; k < comment_end; ++k)
+		{
+			if (input_string[k] == '\n')
+			{
+				line++;
+				column = 0;
+				continue;
+			}
+
+			_lines[line][column++].col = color_multiline_comment;
+			// Replace comment characters with spaces so that the lexer skips them, while keeping all offsets intact
+			input_string[k] = ' ';
+		}
+	}
+
 	reshadefx::lexer lexer(
 		std::move(input_string),
 		false /* ignore_comments */,
@@ -2031,4 +2056,30 @@ void reshade::imgui::code_editor::colorize()
 			_lines[line][column++].col = col;
 		}
 	}
+
+	// Opening or closing a multi-line comment changes the coloring of all following lines, so extend the range until the state matches again
+	if (to < _lines.size() && starts_in_multiline_comment(to) != continued_before)
+	{
+		_colorize_line_beg = std::min(_colorize_line_beg, to);
+		_colorize_line_end = std::max(_colorize_line_end, std::min(to + 1000, _lines.size()));
+	}
+}
+
+bool reshade::imgui::code_editor::starts_in_multiline_comment(size_t line) const
+{
+	// Derive the state from the coloring of the previous non-blank character, so that no separate lexer state needs to be kept in sync with every edit
+	while (line-- > 0)
+	{
+		const std::vector<glyph> &prev_line = _lines[line];
+
+		size_t k = prev_line.size();
+		while (k > 0 && (prev_line[k - 1].c == ' ' || prev_line[k - 1].c == '\t'))
+			k--;
+		if (k == 0)
+			continue;
+
+		return prev_line[k - 1].col == color_multiline_comment && !(k >= 2 && prev_line[k - 2].c == '*' && prev_line[k - 1].c == '/');
+	}
+
+	return false;
 }
@@ -239,6 +239,7 @@ namespace reshade::imgui
 		void move_lines_down();
 
 		void colorize();
+		bool starts_in_multiline_comment(size_t line) const;
 
 		// Holds the entire text split up into individual character glyphs
 		std::vector<std::vector<glyph>> _lines;
@@ -4,15 +4,101 @@
  */
 
 #include "ini_file.hpp"
+#include <mutex>
+#include <thread>
 #include <shared_mutex>
 #include <cctype> // std::toupper
 #include <cassert>
-#include <algorithm> // std::min, std::sort, std::transform
+#include <algorithm> // std::sort, std::transform
 #include <utf8/core.h>
+#include <Windows.h>
 
 static std::shared_mutex s_ini_cache_mutex;
 static std::unordered_map<std::wstring, std::unique_ptr<ini_file>> s_ini_cache;
 
+// Serializes all writes to disk, so that an older write-behind save can never overwrite a newer one
+static std::mutex s_write_mutex;
+static std::mutex s_pending_writes_mutex;
+static std::unordered_map<std::wstring, std::string> s_pending_writes;
+static bool s_write_thread_running = false;
+
+static bool write_file(const std::filesystem::path &path, const std::string &data)
+{
+	// Write to a temporary file first and then replace the target with it, so that the file is never left partially written
+	std::filesystem::path temp_path = path;
+	temp_path += L".tmp";
+
+	FILE *const file = _wfsopen(temp_path.c_str(), L"w", SH_DENYWR);
+	if (file == nullptr)
+		return false;
+	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+
+	if (file_size_written != data.size() ||
+		!MoveFileExW(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileW(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+static void write_pending_file(const std::wstring &path)
+{
+	const std::unique_lock<std::mutex> write_lock(s_write_mutex);
+
+	std::string data;
+	{
+		const std::unique_lock<std::mutex> lock(s_pending_writes_mutex);
+		const auto it = s_pending_writes.find(path);
+		if (it == s_pending_writes.end())
+			return;
+		data = std::move(it->second);
+		s_pending_writes.erase(it);
+	}
+
+	write_file(path, data);
+}
+static void write_pending_files()
+{
+	while (true)
+	{
+		// Hold the write lock while taking an entry from the queue, so that a synchronous save of the same file cannot be overtaken by this one
+		const std::unique_lock<std::mutex> write_lock(s_write_mutex);
+
+		std::wstring path;
+		std::string data;
+		{
+			const std::unique_lock<std::mutex> lock(s_pending_writes_mutex);
+			if (s_pending_writes.empty())
+			{
+				s_write_thread_running = false;
+				return;
+			}
+
+			const auto it = s_pending_writes.begin();
+			path = it->first;
+			data = std::move(it->second);
+			s_pending_writes.erase(it);
+		}
+
+		write_file(path, data);
+	}
+}
+static void queue_write(const std::filesystem::path &path, std::string &&data)
+{
+	const std::unique_lock<std::mutex> lock(s_pending_writes_mutex);
+
+	// Replace any write of the same file that is still pending, so that repeated saves are coalesced into one
+	s_pending_writes[path.native()] = std::move(data);
+
+	if (!s_write_thread_running)
+	{
+		s_write_thread_running = true;
+		std::thread(&write_pending_files).detach();
+	}
+}
+
 ini_file &reshade::global_config()
 {
 	return ini_file::load_cache(g_reshade_base_path / L"ReShade.ini");
@@ -33,30 +119,51 @@ bool ini_file::load()
 	// Clear when file does not exist too
 	_sections.clear();
 
-	FILE *const file = _wfsopen(_path.c_str(), L"r", SH_DENYWR);
-	if (file == nullptr)
+	const HANDLE file = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
 		return false;
 
 	_modified = false;
 	_modified_at = modified_at;
 
+	// Parse a memory-mapped view of the file, rather than copying it line by line through a stream
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return file_size.QuadPart == 0; // Empty files cannot be mapped, but are valid
+	}
+
+	const HANDLE file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (file_mapping == nullptr)
+		return false;
+	const LPVOID file_view = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(file_mapping);
+	if (file_view == nullptr)
+		return false;
+
+	parse(std::string_view(static_cast<const char *>(file_view), static_cast<size_t>(file_size.QuadPart)));
+
+	UnmapViewOfFile(file_view);
+
+	return true;
+}
+void ini_file::parse(std::string_view data)
+{
 	// Remove BOM (0xefbbbf means 0xfeff)
-	if (fgetc(file) != utf8::bom[0] || fgetc(file) != utf8::bom[1] || fgetc(file) != utf8::bom[2])
-		fseek(file, 0, SEEK_SET);
+	if (data.size() >= 3 && data[0] == utf8::bom[0] && data[1] == utf8::bom[1] && data[2] == utf8::bom[2])
+		data.remove_prefix(3);
 
-	std::string line_data, section;
-	line_data.resize(BUFSIZ);
-	while (fgets(line_data.data(), static_cast<int>(line_data.size() + 1), file))
-	{
-		size_t line_length;
-		while ((line_length = std::strlen(line_data.data())) == line_data.size() && line_data.back() != '\n')
-		{
-			line_data.resize(line_data.size() + BUFSIZ);
-			if (!fgets(line_data.data() + line_length, static_cast<int>(line_data.size() - line_length + 1), file))
-				break;
-		}
+	std::string section;
+	// Keep track of the section keys are currently added to, to avoid looking it up again for every key
+	section_type *current_section = nullptr;
 
-		const std::string_view line = trim(std::string_view(line_data.data(), line_length), " \t\r\n");
+	while (!data.empty())
+	{
+		const size_t line_length = data.find('\n');
+		const std::string_view line = trim(data.substr(0, line_length), " \t\r\n");
+		data.remove_prefix(line_length != std::string_view::npos ? line_length + 1 : data.size());
 
 		if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
 			continue;
@@ -65,9 +172,13 @@ bool ini_file::load()
 		if (line[0] == '[')
 		{
 			section = trim(line.substr(0, line.find(']')), " \t[]");
+			current_section = nullptr;
 			continue;
 		}
 
+		if (current_section == nullptr)
+			current_section = &_sections[section];
+
 		// Read section content
 		const size_t assign_index = line.find('=');
 		if (assign_index != std::string::npos)
@@ -77,16 +188,18 @@ bool ini_file::load()
 
 			if (value.empty())
 			{
-				_sections[section].insert({ std::string(key), {} });
+				current_section->insert({ std::string(key), {} });
 				continue;
 			}
 
 			// Append to key if it already exists
-			ini_file::value_type &elements = _sections[section][std::string(key)];
+			ini_file::value_type &elements = (*current_section)[std::string(key)];
 			for (size_t offset = 0, base = 0, len = value.size(); offset <= len;)
 			{
 				// Treat ",," as an escaped comma and only split on single ","
-				const size_t found = std::min(value.find(',', offset), len);
+				size_t found = value.find(',', offset);
+				if (found > len)
+					found = len;
 				if (found + 1 < len && value[found + 1] == ',')
 				{
 					offset = found + 2;
@@ -111,15 +224,11 @@ bool ini_file::load()
 		}
 		else
 		{
-			_sections[section].insert({ std::string(line), {} });
+			current_section->insert({ std::string(line), {} });
 		}
 	}
-
-	fclose(file);
-
-	return true;
 }
-bool ini_file::save()
+bool ini_file::save(bool write_behind)
 {
 	if (!_modified)
 		return true;
@@ -203,13 +312,27 @@ bool ini_file::save()
 		}
 	}
 
-	FILE *const file = _wfsopen(_path.c_str(), L"w", SH_DENYWR);
-	if (file == nullptr)
-		return false;
-	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
-	fclose(file);
-	if (file_size_written != data.size())
-		return false;
+	if (write_behind)
+	{
+		queue_write(_path, std::move(data));
+
+		// The file is written shortly after, so treat it as modified now to avoid the check above failing the next time this is saved
+		_modified_at = std::filesystem::file_time_type::clock::now();
+		return true;
+	}
+
+	{
+		const std::unique_lock<std::mutex> write_lock(s_write_mutex);
+
+		// Any pending write of this file is superseded by this one
+		{
+			const std::unique_lock<std::mutex> lock(s_pending_writes_mutex);
+			s_pending_writes.erase(_path.native());
+		}
+
+		if (!write_file(_path, data))
+			return false;
+	}
 
 	// Flush stream to disk before updating last write time
 	_modified_at = std::filesystem::last_write_time(_path, ec);
@@ -229,7 +352,7 @@ bool ini_file::flush_cache()
 	for (auto &file : s_ini_cache)
 		// Check modified status before requesting file time, since the latter is costly and therefore should be avoided when not necessary
 		if (file.second->_modified && (std::filesystem::file_time_type::clock::now() - file.second->_modified_at) > std::chrono::seconds(1))
-			success &= file.second->save();
+			success &= file.second->save(true);
 
 	return success;
 }
@@ -240,7 +363,13 @@ bool ini_file::flush_cache(const std::filesystem::path &path)
 	const std::shared_lock<std::shared_mutex> lock(s_ini_cache_mutex);
 
 	const auto it = s_ini_cache.find(path);
-	return it != s_ini_cache.end() && it->second->save();
+	if (it == s_ini_cache.end())
+		return false;
+
+	// Callers expect the file to be complete on disk after this returns (e.g. to copy it next to a screenshot), so finish any write-behind save first
+	write_pending_file(path.native());
+
+	return it->second->save();
 }
 
 void ini_file::clear_cache()
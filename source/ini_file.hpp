@@ -253,10 +253,12 @@ public:
 	/// <summary>
 	/// Saves all changes to this INI file to disk.
 	/// </summary>
-	bool save();
+	/// <param name="write_behind">Set to <see langword="true"/> to write the file on a background thread instead of waiting for it, which coalesces repeated saves of the same file into one.</param>
+	bool save(bool write_behind = false);
 
 	/// <summary>
 	/// Saves all changes to INI files that were loaded through <see cref="load_cache"/> to disk.
+	/// Without a <paramref name="path"/> the files are written in the background, otherwise this waits until the specified file was written.
 	/// </summary>
 	static bool flush_cache();
 	static bool flush_cache(const std::filesystem::path &path);
@@ -282,6 +284,8 @@ public:
 	static ini_file &load_cache(const std::filesystem::path &path);
 
 private:
+	void parse(std::string_view data);
+
 	template <typename T>
 	static const T convert(const std::vector<std::string> &values, size_t i) = delete;
 	template <>
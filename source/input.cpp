@@ -6,6 +6,7 @@
 #include "input.hpp"
 #include "dll_log.hpp"
 #include "hook_manager.hpp"
+#include "input_gamepad.hpp"
 #include <atomic>
 #include <shared_mutex>
 #include <unordered_map>
@@ -24,6 +25,21 @@ static POINT s_last_cursor_position = {};
 static std::atomic<bool> s_block_mouse = false;
 static std::atomic<bool> s_block_keyboard = false;
 static std::atomic<bool> s_block_cursor_warping = false;
+// Increased whenever a window is registered, so that cached window lookups can be invalidated without locking
+static std::atomic<unsigned int> s_windows_generation = 0;
+
+/// <summary>
+/// Result of the last lookup of the input object a window message is routed to.
+/// Messages are pumped on the thread that created the window and high polling rate mice send thousands of them per second to the same window, so this avoids walking the window hierarchy for every single one.
+/// </summary>
+struct window_lookup_cache
+{
+	HWND hwnd = nullptr;
+	unsigned int generation = 0;
+	unsigned int raw_input_flags = 0;
+	std::weak_ptr<reshade::input> input;
+};
+static thread_local window_lookup_cache s_window_lookup_cache;
 
 extern "C" BOOL WINAPI HookClipCursor(const RECT *lpRect);
 extern "C" auto WINAPI HookGetKeyState(int vKey) -> SHORT;
@@ -47,6 +63,8 @@ void reshade::input::register_window_with_raw_input(window_handle window, bool n
 	const auto insert = s_raw_input_windows.emplace(static_cast<HWND>(window), flags);
 
 	if (!insert.second) insert.first->second |= flags;
+
+	s_windows_generation.fetch_add(1, std::memory_order_relaxed);
 }
 std::shared_ptr<reshade::input> reshade::input::register_window(window_handle window)
 {
@@ -62,6 +80,13 @@ std::shared_ptr<reshade::input> reshade::input::register_window(window_handle wi
 
 	const std::unique_lock<std::shared_mutex> lock(s_windows_mutex);
 
+	// Remove any expired entry from the list (this is done here rather than during message handling, so that the latter only ever has to take a shared lock)
+	for (auto it = s_windows.begin(); it != s_windows.end();)
+		if (it->second.expired())
+			it = s_windows.erase(it);
+		else
+			++it;
+
 	const auto insert = s_windows.emplace(static_cast<HWND>(window), std::weak_ptr<input>());
 
 	if (insert.second || insert.first->second.expired())
@@ -73,6 +98,8 @@ std::shared_ptr<reshade::input> reshade::input::register_window(window_handle wi
 		const auto instance = std::make_shared<input>(window);
 		insert.first->second = instance;
 
+		s_windows_generation.fetch_add(1, std::memory_order_relaxed);
+
 		return instance;
 	}
 	else
@@ -94,104 +121,132 @@ bool reshade::input::handle_window_message(const void *message_data)
 	if (details.message != WM_INPUT && !is_mouse_message && !is_keyboard_message)
 		return false;
 
-	// Guard access to windows list against race conditions
-	std::unique_lock<std::shared_mutex> lock(s_windows_mutex);
-
-	// Remove any expired entry from the list
-	for (auto it = s_windows.begin(); it != s_windows.end();)
-		if (it->second.expired())
-			it = s_windows.erase(it);
-		else
-			++it;
-
-	// Look up the window in the list of known input windows
-	auto input_window = s_windows.find(details.hwnd);
-	const auto raw_input_window = s_raw_input_windows.find(details.hwnd);
-
-	if (input_window == s_windows.end())
+	RAWINPUT raw_data;
+	if (details.message == WM_INPUT)
 	{
-		// Walk through the window chain and until an known window is found
-		EnumChildWindows(details.hwnd, [](HWND hwnd, LPARAM lparam) -> BOOL {
-			auto &input_window = *reinterpret_cast<decltype(s_windows)::iterator *>(lparam);
-			// Return true to continue enumeration
-			return (input_window = s_windows.find(hwnd)) == s_windows.end();
-		}, reinterpret_cast<LPARAM>(&input_window));
+		// Read the raw input data before doing anything else, so that messages that are ignored anyway do not cost a window lookup
+		if (UINT raw_data_size = sizeof(raw_data);
+			GET_RAWINPUT_CODE_WPARAM(details.wParam) != RIM_INPUT || // Ignore all input sink messages (when window is not focused)
+			GetRawInputData(reinterpret_cast<HRAWINPUT>(details.lParam), RID_INPUT, &raw_data, &raw_data_size, sizeof(raw_data.header)) == UINT(-1))
+			return false;
+		if (raw_data.header.dwType != RIM_TYPEMOUSE && raw_data.header.dwType != RIM_TYPEKEYBOARD)
+			return false;
 	}
-	if (input_window == s_windows.end())
+
+	std::shared_ptr<input> input;
+	unsigned int raw_input_flags = 0;
+
+	const unsigned int generation = s_windows_generation.load(std::memory_order_relaxed);
+	if (window_lookup_cache &cache = s_window_lookup_cache;
+		cache.hwnd == details.hwnd && cache.generation == generation)
 	{
-		// Some applications handle input in a child window to the main render window
-		if (const HWND parent = GetParent(details.hwnd); parent != NULL)
-			input_window = s_windows.find(parent);
+		input = cache.input.lock();
+		raw_input_flags = cache.raw_input_flags;
 	}
 
-	if (input_window == s_windows.end() && raw_input_window != s_raw_input_windows.end())
+	if (input == nullptr)
 	{
-		// Reroute this raw input message to the window with the most rendering
-		input_window = std::max_element(s_windows.begin(), s_windows.end(),
-			[](auto lhs, auto rhs) { return lhs.second.lock()->_frame_count < rhs.second.lock()->_frame_count; });
-	}
+		// Guard access to windows list against race conditions
+		const std::shared_lock<std::shared_mutex> lock(s_windows_mutex);
 
-	if (input_window == s_windows.end())
-		return false;
+		// Look up the window in the list of known input windows
+		auto input_window = s_windows.find(details.hwnd);
+		const auto raw_input_window = s_raw_input_windows.find(details.hwnd);
 
-	const std::shared_ptr<input> input = input_window->second.lock();
-	// It may happen that the input was destroyed between the removal of expired entries above and here, so need to abort in this case
-	if (input == nullptr)
-		return false;
+		if (input_window == s_windows.end())
+		{
+			// Walk through the window chain and until an known window is found
+			EnumChildWindows(details.hwnd, [](HWND hwnd, LPARAM lparam) -> BOOL {
+				auto &input_window = *reinterpret_cast<decltype(s_windows)::iterator *>(lparam);
+				// Return true to continue enumeration
+				return (input_window = s_windows.find(hwnd)) == s_windows.end();
+			}, reinterpret_cast<LPARAM>(&input_window));
+		}
+		if (input_window == s_windows.end())
+		{
+			// Some applications handle input in a child window to the main render window
+			if (const HWND parent = GetParent(details.hwnd); parent != NULL)
+				input_window = s_windows.find(parent);
+		}
 
-	// At this point we have a shared pointer to the input object and no longer reference any memory from the windows list, so can release the lock
-	lock.unlock();
+		bool rerouted = false;
+		if (input_window == s_windows.end() && raw_input_window != s_raw_input_windows.end())
+		{
+			// Reroute this raw input message to the window with the most rendering (expired entries are only removed when a window is registered, so may still be in the list)
+			input_window = std::max_element(s_windows.begin(), s_windows.end(),
+				[](const auto &lhs, const auto &rhs) {
+					const auto lhs_input = lhs.second.lock(), rhs_input = rhs.second.lock();
+					return (lhs_input != nullptr ? lhs_input->_frame_count : 0) < (rhs_input != nullptr ? rhs_input->_frame_count : 0);
+				});
+			rerouted = true;
+		}
+
+		if (input_window == s_windows.end())
+			return false;
+
+		input = input_window->second.lock();
+		// It may happen that the input was destroyed already, so need to abort in this case
+		if (input == nullptr)
+			return false;
+
+		raw_input_flags = raw_input_window != s_raw_input_windows.end() ? raw_input_window->second : 0;
+
+		// Do not cache rerouted lookups, since which window renders the most can change without any window being registered
+		if (!rerouted)
+		{
+			window_lookup_cache &cache = s_window_lookup_cache;
+			cache.hwnd = details.hwnd;
+			cache.generation = generation;
+			cache.raw_input_flags = raw_input_flags;
+			cache.input = input;
+		}
+	}
 
 	// Calculate window client mouse position
 	ScreenToClient(static_cast<HWND>(input->_window), &details.pt);
 
-	// Prevent input threads from modifying input while it is accessed elsewhere
-	const std::unique_lock<std::recursive_mutex> input_lock(input->_mutex);
+	// Only guards the pending state against the copy in 'next_frame', so this never waits on the rendering that reads the captured state
+	const std::unique_lock<std::mutex> input_lock(input->_mutex);
 
-	input->_mouse_position[0] = details.pt.x;
-	input->_mouse_position[1] = details.pt.y;
+	input->_pending_mouse_position[0] = details.pt.x;
+	input->_pending_mouse_position[1] = details.pt.y;
 
 	switch (details.message)
 	{
 	case WM_INPUT:
-		RAWINPUT raw_data;
-		if (UINT raw_data_size = sizeof(raw_data);
-			GET_RAWINPUT_CODE_WPARAM(details.wParam) != RIM_INPUT || // Ignore all input sink messages (when window is not focused)
-			GetRawInputData(reinterpret_cast<HRAWINPUT>(details.lParam), RID_INPUT, &raw_data, &raw_data_size, sizeof(raw_data.header)) == UINT(-1))
-			break;
 		switch (raw_data.header.dwType)
 		{
 		case RIM_TYPEMOUSE:
 			is_mouse_message = true;
 
-			if (raw_input_window == s_raw_input_windows.end() || (raw_input_window->second & 0x2) == 0)
+			if ((raw_input_flags & 0x2) == 0)
 				break; // Input is already handled (since legacy mouse messages are enabled), so nothing to do here
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN)
-				input->_keys[VK_LBUTTON] = 0x88;
+				input->_pending_keys[VK_LBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP)
-				input->_keys[VK_LBUTTON] = 0x08;
+				input->_pending_keys[VK_LBUTTON] = 0x08;
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN)
-				input->_keys[VK_RBUTTON] = 0x88;
+				input->_pending_keys[VK_RBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)
-				input->_keys[VK_RBUTTON] = 0x08;
+				input->_pending_keys[VK_RBUTTON] = 0x08;
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN)
-				input->_keys[VK_MBUTTON] = 0x88;
+				input->_pending_keys[VK_MBUTTON] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP)
-				input->_keys[VK_MBUTTON] = 0x08;
+				input->_pending_keys[VK_MBUTTON] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN)
-				input->_keys[VK_XBUTTON1] = 0x88;
+				input->_pending_keys[VK_XBUTTON1] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_UP)
-				input->_keys[VK_XBUTTON1] = 0x08;
+				input->_pending_keys[VK_XBUTTON1] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN)
-				input->_keys[VK_XBUTTON2] = 0x88;
+				input->_pending_keys[VK_XBUTTON2] = 0x88;
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_UP)
-				input->_keys[VK_XBUTTON2] = 0x08;
+				input->_pending_keys[VK_XBUTTON2] = 0x08;
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_WHEEL)
-				input->_mouse_wheel_delta += static_cast<short>(raw_data.data.mouse.usButtonData) / WHEEL_DELTA;
+				input->_pending_mouse_wheel_delta += static_cast<short>(raw_data.data.mouse.usButtonData) / WHEEL_DELTA;
 			break;
 		case RIM_TYPEKEYBOARD:
 			if (raw_data.data.keyboard.VKey == 0)
@@ -199,76 +254,82 @@ bool reshade::input::handle_window_message(const void *message_data)
 
 			is_keyboard_message = true;
 			// Do not block key up messages if the key down one was not blocked previously
-			if (input->is_blocking_keyboard_input() && (raw_data.data.keyboard.Flags & RI_KEY_BREAK) != 0 && raw_data.data.keyboard.VKey < 0xFF && (input->_keys[raw_data.data.keyboard.VKey] & 0x04) == 0)
+			if (input->is_blocking_keyboard_input() && (raw_data.data.keyboard.Flags & RI_KEY_BREAK) != 0 && raw_data.data.keyboard.VKey < 0xFF && (input->_pending_keys[raw_data.data.keyboard.VKey] & 0x04) == 0)
 				is_keyboard_message = false;
 
-			if (raw_input_window == s_raw_input_windows.end() || (raw_input_window->second & 0x1) == 0)
+			if ((raw_input_flags & 0x1) == 0)
 				break; // Input is already handled by 'WM_KEYDOWN' and friends (since legacy keyboard messages are enabled), so nothing to do here
 
 			// Filter out prefix messages without a key code
 			if (raw_data.data.keyboard.VKey < 0xFF)
-				input->_keys[raw_data.data.keyboard.VKey] = (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 ? 0x88 : 0x08,
-				input->_keys_time[raw_data.data.keyboard.VKey] = details.time;
+				input->_pending_keys[raw_data.data.keyboard.VKey] = (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 ? 0x88 : 0x08,
+				input->_pending_keys_time[raw_data.data.keyboard.VKey] = details.time,
+				input->_pending_key_press_count += (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0;
 
 			// No 'WM_CHAR' messages are sent if legacy keyboard messages are disabled, so need to generate text input manually here
 			// Cannot use the ToUnicode function always as it seems to reset dead key state and thus calling it can break subsequent application input, should be fine here though since the application is already explicitly using raw input
 			// Since Windows 10 version 1607 this supports the 0x2 flag, which prevents the keyboard state from being changed, so it is not a problem there anymore either way
-			if (WCHAR ch[3] = {}; (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 && ToUnicode(raw_data.data.keyboard.VKey, raw_data.data.keyboard.MakeCode, input->_keys, ch, 2, 0x2))
-				input->_text_input += ch;
+			if (WCHAR ch[3] = {}; (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 && ToUnicode(raw_data.data.keyboard.VKey, raw_data.data.keyboard.MakeCode, input->_pending_keys, ch, 2, 0x2))
+				input->_pending_text_input += ch;
 			break;
 		}
 		break;
 	case WM_CHAR:
-		input->_text_input += static_cast<wchar_t>(details.wParam);
+		input->_pending_text_input += static_cast<wchar_t>(details.wParam);
 		break;
 	case WM_KEYDOWN:
 	case WM_SYSKEYDOWN:
-		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_keys));
-		input->_keys[details.wParam] = 0x88;
-		input->_keys_time[details.wParam] = details.time;
+		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_pending_keys));
+		input->_pending_keys[details.wParam] = 0x88;
+		input->_pending_keys_time[details.wParam] = details.time;
+		input->_pending_key_press_count++;
 		if (input->is_blocking_keyboard_input())
-			input->_keys[details.wParam] |= 0x04;
+			input->_pending_keys[details.wParam] |= 0x04;
 		break;
 	case WM_KEYUP:
 	case WM_SYSKEYUP:
-		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_keys));
+		assert(details.wParam > 0 && details.wParam < ARRAYSIZE(input->_pending_keys));
 		// Do not block key up messages if the key down one was not blocked previously (so key does not get stuck for the application)
-		if (input->is_blocking_keyboard_input() && (input->_keys[details.wParam] & 0x04) == 0)
+		if (input->is_blocking_keyboard_input() && (input->_pending_keys[details.wParam] & 0x04) == 0)
 			is_keyboard_message = false;
-		input->_keys[details.wParam] = 0x08;
-		input->_keys_time[details.wParam] = details.time;
+		input->_pending_keys[details.wParam] = 0x08;
+		input->_pending_keys_time[details.wParam] = details.time;
 		break;
 	case WM_LBUTTONDOWN:
 	case WM_LBUTTONDBLCLK: // Double clicking generates this sequence: WM_LBUTTONDOWN -> WM_LBUTTONUP -> WM_LBUTTONDBLCLK -> WM_LBUTTONUP, so handle it like a normal down
-		input->_keys[VK_LBUTTON] = 0x88;
+		input->_pending_keys[VK_LBUTTON] = 0x88;
 		break;
 	case WM_LBUTTONUP:
-		input->_keys[VK_LBUTTON] = 0x08;
+		input->_pending_keys[VK_LBUTTON] = 0x08;
 		break;
 	case WM_RBUTTONDOWN:
 	case WM_RBUTTONDBLCLK:
-		input->_keys[VK_RBUTTON] = 0x88;
+		input->_pending_keys[VK_RBUTTON] = 0x88;
 		break;
 	case WM_RBUTTONUP:
-		input->_keys[VK_RBUTTON] = 0x08;
+		input->_pending_keys[VK_RBUTTON] = 0x08;
 		break;
 	case WM_MBUTTONDOWN:
 	case WM_MBUTTONDBLCLK:
-		input->_keys[VK_MBUTTON] = 0x88;
+		input->_pending_keys[VK_MBUTTON] = 0x88;
 		break;
 	case WM_MBUTTONUP:
-		input->_keys[VK_MBUTTON] = 0x08;
+		input->_pending_keys[VK_MBUTTON] = 0x08;
 		break;
 	case WM_MOUSEWHEEL:
-		input->_mouse_wheel_delta += GET_WHEEL_DELTA_WPARAM(details.wParam) / WHEEL_DELTA;
+		input->_pending_mouse_wheel_delta += GET_WHEEL_DELTA_WPARAM(details.wParam) / WHEEL_DELTA;
 		break;
 	case WM_XBUTTONDOWN:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x88;
+		input->_pending_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x88;
 		break;
 	case WM_XBUTTONUP:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x08;
+		input->_pending_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x08;
+		break;
+	case WM_DEVICECHANGE:
+		// A gamepad may have been connected, so have it picked up right away instead of waiting for the polling backoff to expire
+		input_gamepad::notify_device_change();
 		break;
 	}
 
@@ -394,39 +455,53 @@ void reshade::input::next_frame()
 
 	// Backup key states from the last processed frame so that state transitions can be identified
 	std::copy_n(_keys, 256, _last_keys);
-
-	for (uint8_t &state : _keys)
-		state &= ~0x08;
-
-	// Reset any pressed down key states (apart from mouse buttons) that have not been updated for more than 5 seconds
-	// Do not check mouse buttons here, since 'GetAsyncKeyState' always returns the state of the physical mouse buttons, not the logical ones in case they were remapped
-	// See https://docs.microsoft.com/windows/win32/api/winuser/nf-winuser-getasynckeystate
-	// And time is not tracked for mouse buttons anyway
-	const DWORD time = GetTickCount();
-	for (unsigned int i = 8; i < 256; ++i)
-		if ((_keys[i] & 0x80) != 0 &&
-			(time - _keys_time[i]) > 5000 &&
-			(GetAsyncKeyState_trampoline(i) & 0x8000) == 0)
-			(_keys[i] = 0x08);
-
-	_text_input.clear();
-	_mouse_wheel_delta = 0;
 	_last_mouse_position[0] = _mouse_position[0];
 	_last_mouse_position[1] = _mouse_position[1];
 
-	// Update caps lock state
-	_keys[VK_CAPITAL] |= GetKeyState_trampoline(VK_CAPITAL) & 0x1;
-
-	// Update modifier key state
-	if ((_keys[VK_MENU] & 0x88) != 0 &&
-		(GetKeyState_trampoline(VK_MENU) & 0x8000) == 0)
-		(_keys[VK_MENU] = 0x08);
-
-	// Update print screen state (there is no key down message, but the key up one is received via the message queue)
-	if ((_keys[VK_SNAPSHOT] & 0x80) == 0 &&
-		(GetAsyncKeyState_trampoline(VK_SNAPSHOT) & 0x8000) != 0)
-		(_keys[VK_SNAPSHOT] = 0x88),
-		(_keys_time[VK_SNAPSHOT] = time);
+	{
+		const std::unique_lock<std::mutex> input_lock(_mutex);
+
+		// Reset any pressed down key states (apart from mouse buttons) that have not been updated for more than 5 seconds
+		// Do not check mouse buttons here, since 'GetAsyncKeyState' always returns the state of the physical mouse buttons, not the logical ones in case they were remapped
+		// See https://docs.microsoft.com/windows/win32/api/winuser/nf-winuser-getasynckeystate
+		// And time is not tracked for mouse buttons anyway
+		const DWORD time = GetTickCount();
+		for (unsigned int i = 8; i < 256; ++i)
+			if ((_pending_keys[i] & 0x80) != 0 &&
+				(time - _pending_keys_time[i]) > 5000 &&
+				(GetAsyncKeyState_trampoline(i) & 0x8000) == 0)
+				(_pending_keys[i] = 0x08);
+
+		// Update caps lock state
+		_pending_keys[VK_CAPITAL] |= GetKeyState_trampoline(VK_CAPITAL) & 0x1;
+
+		// Update modifier key state
+		if ((_pending_keys[VK_MENU] & 0x88) != 0 &&
+			(GetKeyState_trampoline(VK_MENU) & 0x8000) == 0)
+			(_pending_keys[VK_MENU] = 0x08);
+
+		// Update print screen state (there is no key down message, but the key up one is received via the message queue)
+		if ((_pending_keys[VK_SNAPSHOT] & 0x80) == 0 &&
+			(GetAsyncKeyState_trampoline(VK_SNAPSHOT) & 0x8000) != 0)
+			(_pending_keys[VK_SNAPSHOT] = 0x88),
+			(_pending_keys_time[VK_SNAPSHOT] = time),
+			(_pending_key_press_count++);
+
+		// Capture the state received since the last frame, which is then read without any locking until the next frame
+		std::copy_n(_pending_keys, 256, _keys);
+		_key_press_count = _pending_key_press_count;
+		_mouse_wheel_delta = _pending_mouse_wheel_delta;
+		_mouse_position[0] = _pending_mouse_position[0];
+		_mouse_position[1] = _pending_mouse_position[1];
+		// Swap instead of copy, so that the string buffers are reused between frames
+		_text_input.swap(_pending_text_input);
+
+		for (uint8_t &state : _pending_keys)
+			state &= ~0x08;
+		_pending_key_press_count = 0;
+		_pending_mouse_wheel_delta = 0;
+		_pending_text_input.clear();
+	}
 
 	// Run through all forms of input blocking for all windows and establish whether any of them are blocking input
 	const std::shared_lock<std::shared_mutex> lock(s_windows_mutex);
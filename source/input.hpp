@@ -44,7 +44,7 @@ namespace reshade
 		/// <returns>Pointer to the input manager registered for this <paramref name="window"/>.</returns>
 		static std::shared_ptr<input> register_window(window_handle window);
 
-		// Before accessing input data with any of the member functions below, first call "lock()" and keep the returned object alive while accessing it.
+		// The member functions below return the input state as captured by the last call to "next_frame()", so they do not need any locking, but may only be called from the thread that calls "next_frame()".
 
 		bool is_key_down(unsigned int keycode) const;
 		bool is_key_pressed(unsigned int keycode) const;
@@ -57,6 +57,10 @@ namespace reshade
 		bool is_any_key_released() const;
 		unsigned int last_key_pressed() const;
 		unsigned int last_key_released() const;
+		/// <summary>
+		/// Gets the number of keyboard key down messages received since the last frame, so that checking key shortcuts can be skipped when it is zero.
+		/// </summary>
+		unsigned int key_press_count() const { return _key_press_count; }
 		bool is_mouse_button_down(unsigned int button) const;
 		bool is_mouse_button_pressed(unsigned int button) const;
 		bool is_mouse_button_released(unsigned int button) const;
@@ -94,15 +98,9 @@ namespace reshade
 		bool is_blocking_mouse_cursor_warping() const { return _block_cursor_warping; }
 		static bool is_blocking_any_mouse_cursor_warping();
 
-		/// <summary>
-		/// Locks access to the input data so it cannot be modified in another thread.
-		/// </summary>
-		/// <returns>RAII object holding the lock, which releases it after going out of scope.</returns>
-		auto lock() { return std::unique_lock<std::recursive_mutex>(_mutex); }
-
 		/// <summary>
 		/// Notifies the input manager to advance a frame.
-		/// This updates input state to e.g. track whether a key was pressed this frame or before.
+		/// This captures the input state received from window messages since the last call for the member functions above to read and updates it to e.g. track whether a key was pressed this frame or before.
 		/// </summary>
 		void next_frame();
 
@@ -125,18 +123,28 @@ namespace reshade
 		static bool handle_window_message(const void *message_data);
 
 	private:
-		std::recursive_mutex _mutex;
 		window_handle _window;
 		bool _block_mouse = false;
 		bool _block_keyboard = false;
 		bool _block_cursor_warping = false;
+		uint64_t _frame_count = 0; // Keep track of frame count to identify windows with a lot of rendering
+
+		// State written by the window message hook, which is only locked for short amounts of time, so that the window procedure never has to wait on rendering
+		std::mutex _mutex;
+		uint8_t _pending_keys[256] = {};
+		unsigned int _pending_keys_time[256] = {};
+		unsigned int _pending_key_press_count = 0;
+		short _pending_mouse_wheel_delta = 0;
+		unsigned int _pending_mouse_position[2] = {};
+		std::wstring _pending_text_input;
+
+		// State captured in 'next_frame', which is read by the member functions above
 		uint8_t _keys[256] = {};
 		uint8_t _last_keys[256] = {};
-		unsigned int _keys_time[256] = {};
+		unsigned int _key_press_count = 0;
 		short _mouse_wheel_delta = 0;
 		unsigned int _mouse_position[2] = {};
 		unsigned int _last_mouse_position[2] = {};
-		uint64_t _frame_count = 0; // Keep track of frame count to identify windows with a lot of rendering
 		std::wstring _text_input;
 	};
 }
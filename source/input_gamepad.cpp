@@ -5,7 +5,10 @@
 
 #include "input_gamepad.hpp"
 #include <cassert>
+#include <chrono>
+#include <algorithm>
 #include <shared_mutex>
+#include <intrin.h>
 #include <Windows.h>
 #include <Xinput.h>
 
@@ -16,9 +19,19 @@ reshade::input_gamepad::input_gamepad(void *module) : _xinput_module(module)
 {
 	_xinput_get_state = reinterpret_cast<void *>(GetProcAddress(static_cast<HMODULE>(_xinput_module), "XInputGetState"));
 	assert(_xinput_get_state != nullptr);
+
+	// 'XInputGetState' can take a millisecond or more when no gamepad is connected, so keep it off the render thread
+	_poll_thread = std::thread(&input_gamepad::poll_thread_main, this);
 }
 reshade::input_gamepad::~input_gamepad()
 {
+	{
+		const std::unique_lock<std::mutex> lock(_poll_mutex);
+		_poll_thread_exit = true;
+	}
+	_poll_condition.notify_one();
+	_poll_thread.join();
+
 	FreeLibrary(static_cast<HMODULE>(_xinput_module));
 }
 
@@ -39,6 +52,25 @@ std::shared_ptr<reshade::input_gamepad> reshade::input_gamepad::load()
 	return instance;
 }
 
+void reshade::input_gamepad::notify_device_change()
+{
+	const std::shared_lock<std::shared_mutex> lock(s_xinput_mutex);
+
+	if (const std::shared_ptr<input_gamepad> instance = s_xinput_instance.lock())
+	{
+		{
+			const std::unique_lock<std::mutex> poll_lock(instance->_poll_mutex);
+			instance->_poll_device_changed = true;
+		}
+		instance->_poll_condition.notify_one();
+	}
+}
+
+void reshade::input_gamepad::set_poll_rate(unsigned int rate)
+{
+	_poll_interval_ms = 1000 / std::clamp(rate, 1u, 1000u);
+}
+
 bool reshade::input_gamepad::is_button_down(unsigned int button) const
 {
 	static_assert(
@@ -86,8 +118,20 @@ bool reshade::input_gamepad::is_button_released(unsigned int button) const
 
 void reshade::input_gamepad::next_frame()
 {
-	XINPUT_STATE xstate;
-	if (static_cast<decltype(&XInputGetState)>(_xinput_get_state)(0, &xstate) != ERROR_SUCCESS)
+	state current;
+	uint32_t sequence_begin, sequence_end;
+	do
+	{
+		while ((sequence_begin = _state_sequence.load(std::memory_order_acquire)) & 1)
+			_mm_pause();
+
+		current = _state;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		sequence_end = _state_sequence.load(std::memory_order_relaxed);
+	} while (sequence_begin != sequence_end);
+
+	if (current.packet_num == 0)
 	{
 		_buttons = 0;
 		_last_buttons = 0;
@@ -103,26 +147,75 @@ void reshade::input_gamepad::next_frame()
 
 	_last_buttons = _buttons;
 
-	if (xstate.dwPacketNumber == _last_packet_num)
+	if (current.packet_num == _last_packet_num)
 		return; // Nothing changed, so can skip the update
 
-	_buttons = xstate.Gamepad.wButtons;
-
-	_left_trigger = (xstate.Gamepad.bLeftTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ? xstate.Gamepad.bLeftTrigger / 255.0f : 0.0f;
-	_right_trigger = (xstate.Gamepad.bRightTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ? xstate.Gamepad.bRightTrigger / 255.0f : 0.0f;
-
-	_left_thumb_axis_x =
-		(xstate.Gamepad.sThumbLX < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLX / 32768.0f :
-		(xstate.Gamepad.sThumbLX > +XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLX / 32767.0f : 0.0f;
-	_left_thumb_axis_y =
-		(xstate.Gamepad.sThumbLY < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLY / 32768.0f :
-		(xstate.Gamepad.sThumbLY > +XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLY / 32767.0f : 0.0f;
-	_right_thumb_axis_x =
-		(xstate.Gamepad.sThumbRX < -XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRX / 32768.0f :
-		(xstate.Gamepad.sThumbRX > +XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRX / 32767.0f : 0.0f;
-	_right_thumb_axis_y =
-		(xstate.Gamepad.sThumbRY < -XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRY / 32768.0f :
-		(xstate.Gamepad.sThumbRY > +XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRY / 32767.0f : 0.0f;
-
-	_last_packet_num = xstate.dwPacketNumber;
+	_buttons = current.buttons;
+	_left_trigger = current.left_trigger;
+	_right_trigger = current.right_trigger;
+	_left_thumb_axis_x = current.left_thumb_axis_x;
+	_left_thumb_axis_y = current.left_thumb_axis_y;
+	_right_thumb_axis_x = current.right_thumb_axis_x;
+	_right_thumb_axis_y = current.right_thumb_axis_y;
+
+	_last_packet_num = current.packet_num;
+}
+
+void reshade::input_gamepad::poll_thread_main()
+{
+	// Back off exponentially while no gamepad is connected, up to this interval (a device change notification cuts the wait short)
+	constexpr unsigned int max_disconnected_interval_ms = 2000;
+	unsigned int disconnected_interval_ms = 0;
+
+	while (true)
+	{
+		state current = {};
+
+		XINPUT_STATE xstate;
+		if (static_cast<decltype(&XInputGetState)>(_xinput_get_state)(0, &xstate) == ERROR_SUCCESS)
+		{
+			disconnected_interval_ms = 0;
+
+			current.buttons = xstate.Gamepad.wButtons;
+
+			current.left_trigger = (xstate.Gamepad.bLeftTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ? xstate.Gamepad.bLeftTrigger / 255.0f : 0.0f;
+			current.right_trigger = (xstate.Gamepad.bRightTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ? xstate.Gamepad.bRightTrigger / 255.0f : 0.0f;
+
+			current.left_thumb_axis_x =
+				(xstate.Gamepad.sThumbLX < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLX / 32768.0f :
+				(xstate.Gamepad.sThumbLX > +XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLX / 32767.0f : 0.0f;
+			current.left_thumb_axis_y =
+				(xstate.Gamepad.sThumbLY < -XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLY / 32768.0f :
+				(xstate.Gamepad.sThumbLY > +XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbLY / 32767.0f : 0.0f;
+			current.right_thumb_axis_x =
+				(xstate.Gamepad.sThumbRX < -XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRX / 32768.0f :
+				(xstate.Gamepad.sThumbRX > +XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRX / 32767.0f : 0.0f;
+			current.right_thumb_axis_y =
+				(xstate.Gamepad.sThumbRY < -XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRY / 32768.0f :
+				(xstate.Gamepad.sThumbRY > +XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE) ? xstate.Gamepad.sThumbRY / 32767.0f : 0.0f;
+
+			// Zero is used to indicate a disconnected gamepad, so make sure a connected one never reports it
+			current.packet_num = std::max(xstate.dwPacketNumber, static_cast<DWORD>(1));
+		}
+		else
+		{
+			disconnected_interval_ms = std::min(std::max(disconnected_interval_ms * 2, _poll_interval_ms.load(std::memory_order_relaxed) * 2), max_disconnected_interval_ms);
+		}
+
+		_state_sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		_state = current;
+
+		_state_sequence.fetch_add(1, std::memory_order_release);
+
+		std::unique_lock<std::mutex> lock(_poll_mutex);
+		_poll_condition.wait_for(lock, std::chrono::milliseconds(disconnected_interval_ms != 0 ? disconnected_interval_ms : _poll_interval_ms.load(std::memory_order_relaxed)),
+			[this]() { return _poll_thread_exit || _poll_device_changed; });
+		if (_poll_thread_exit)
+			break;
+		if (_poll_device_changed)
+			disconnected_interval_ms = 0;
+		_poll_device_changed = false;
+	}
 }
@@ -5,7 +5,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace reshade
 {
@@ -39,6 +43,17 @@ namespace reshade
 		/// <returns>Pointer to the input manager.</returns>
 		static std::shared_ptr<input_gamepad> load();
 
+		/// <summary>
+		/// Wakes up the polling thread of the gamepad input manager singleton, so that a newly connected gamepad is picked up immediately.
+		/// </summary>
+		static void notify_device_change();
+
+		/// <summary>
+		/// Sets how often the polling thread reads the gamepad state while one is connected.
+		/// </summary>
+		/// <param name="rate">Number of times per second to poll.</param>
+		void set_poll_rate(unsigned int rate);
+
 		/// <summary>
 		/// Gets the connection status of the gamepad.
 		/// </summary>
@@ -58,13 +73,41 @@ namespace reshade
 
 		/// <summary>
 		/// Notifies the gamepad input manager to advance a frame.
+		/// This picks up the latest state published by the polling thread, without calling into XInput.
 		/// </summary>
 		void next_frame();
 
 	private:
+		/// <summary>
+		/// Gamepad state as published by the polling thread, guarded by a sequence lock, so that reading it never blocks the render thread.
+		/// </summary>
+		struct state
+		{
+			uint16_t buttons;
+			float left_trigger;
+			float right_trigger;
+			float left_thumb_axis_x;
+			float left_thumb_axis_y;
+			float right_thumb_axis_x;
+			float right_thumb_axis_y;
+			uint32_t packet_num;
+		};
+
+		void poll_thread_main();
+
 		void *_xinput_module = nullptr;
 		void *_xinput_get_state = nullptr;
 
+		std::thread _poll_thread;
+		std::mutex _poll_mutex;
+		std::condition_variable _poll_condition;
+		bool _poll_thread_exit = false;
+		bool _poll_device_changed = false;
+		std::atomic<unsigned int> _poll_interval_ms = 4;
+
+		std::atomic<uint32_t> _state_sequence = 0;
+		state _state = {};
+
 		uint16_t _buttons = 0;
 		uint16_t _last_buttons = 0;
 		float _left_trigger = 0.0f;
@@ -21,7 +21,7 @@ constexpr uint16_t compute_crc16(const char *data, size_t size)
 	return crc;
 }
 
-#define _(message) reshade::resources::load_string<compute_crc16(message, sizeof(message) - 1)>().c_str()
+#define _(message) reshade::resources::get_string<compute_crc16(message, sizeof(message) - 1)>()
 
 #else
 
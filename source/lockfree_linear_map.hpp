@@ -7,11 +7,12 @@
 
 #include <atomic>
 #include <utility>
+#include <functional>
 #include <cassert>
 
 /// <summary>
-/// A simple lock-free linear search table.
-/// The key values "one" and "zero" hold a special meaning (see <see cref="no_value"/> and <see cref="update_value"/>), so do not use them.
+/// A simple lock-free hash table using open addressing with linear probing.
+/// The key values "zero", "one" and "minus one" hold a special meaning (see <see cref="no_value"/>, <see cref="erased_value"/> and <see cref="update_value"/>), so do not use them.
 /// </summary>
 template <typename TKey, typename TValue, uint32_t MAX_ENTRIES>
 class lockfree_linear_map : lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>
@@ -24,6 +25,7 @@ public:
 
 	using lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>::no_value;
 	using lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>::update_value;
+	using lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>::erased_value;
 
 	/// <summary>
 	/// Gets the value associated with the specified <paramref name="key"/>.
@@ -106,7 +108,7 @@ public:
 
 			// Clear this entry so it can be used again
 			if (TKey current_key = lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>::_data[i].first.exchange(no_value);
-				current_key != no_value && current_key != update_value) // If this in update mode, we can assume the thread updating will reset the key to its intended value
+				current_key != no_value && current_key != erased_value && current_key != update_value) // If this in update mode, we can assume the thread updating will reset the key to its intended value
 			{
 				// Delete any value attached to the entry, but only if there was one to begin with
 				delete old_value;
@@ -128,6 +130,8 @@ private:
 template <typename TKey, typename TValue, uint32_t MAX_ENTRIES>
 class lockfree_linear_map<TKey, TValue *, MAX_ENTRIES>
 {
+	static_assert((MAX_ENTRIES & (MAX_ENTRIES - 1)) == 0, "table size has to be a power of two");
+
 	using TValuePtr = TValue *;
 
 public:
@@ -144,6 +148,10 @@ public:
 	/// Special key indicating that the entry is currently being updated.
 	/// </summary>
 	static constexpr TKey update_value = (TKey)-1;
+	/// <summary>
+	/// Special key indicating that the entry was erased, but may still be part of the probe sequence of other keys.
+	/// </summary>
+	static constexpr TKey erased_value = (TKey)1;
 
 	/// <summary>
 	/// Gets the pointer associated with the specified <paramref name="key"/>.
@@ -153,20 +161,20 @@ public:
 	/// <returns>Pointer associated with the key, or <see langword="nullptr"/> if it was not found.</returns>
 	TValuePtr at(TKey key) const
 	{
-		assert(key != no_value && key != update_value);
+		assert(key != no_value && key != update_value && key != erased_value);
 
-		// If the table is really big, reduce search time by using hash as start index
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (size_t i = 0, index = hash_index(key); i < MAX_ENTRIES; ++i, index = (index + 1) & (MAX_ENTRIES - 1))
 		{
-			if (_data[i].first.load(std::memory_order_acquire) == key)
+			const TKey test_key = _data[index].first.load(std::memory_order_acquire);
+			if (test_key == key)
 			{
 				// The pointer is guaranteed to be value at this point, or else key would have been in update mode
-				return _data[i].second;
+				return _data[index].second;
 			}
+
+			// An entry that was never used ends the probe sequence, since the key would otherwise have been placed there
+			if (test_key == no_value)
+				break;
 		}
 
 		return nullptr;
@@ -180,21 +188,18 @@ public:
 	/// <returns><see langword="true"/> if the key-pointer pair was added successfully, or <see langword="false"/> if the table is full.</returns>
 	bool emplace(TKey key, TValuePtr value)
 	{
-		assert(key != no_value && key != update_value);
-
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+		assert(key != no_value && key != update_value && key != erased_value);
 
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (size_t i = 0, index = hash_index(key); i < MAX_ENTRIES; ++i, index = (index + 1) & (MAX_ENTRIES - 1))
 		{
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == no_value &&
-				_data[i].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
+			// Reuse both empty and erased entries
+			if (TKey test_key = _data[index].first.load(std::memory_order_relaxed);
+				(test_key == no_value || test_key == erased_value) &&
+				_data[index].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
 			{
-				_data[i].second = value;
+				_data[index].second = value;
 
-				_data[i].first.store(key, std::memory_order_release);
+				_data[index].first.store(key, std::memory_order_release);
 
 				return true;
 			}
@@ -210,27 +215,28 @@ public:
 	/// <returns>Removed pointer if the key existed, <see langword="nullptr"/> otherwise.</returns>
 	TValuePtr erase(TKey key)
 	{
-		if (key == no_value || key == update_value) // Cannot remove special keys
+		if (key == no_value || key == update_value || key == erased_value) // Cannot remove special keys
 			return nullptr;
 
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (size_t i = 0, index = hash_index(key); i < MAX_ENTRIES; ++i, index = (index + 1) & (MAX_ENTRIES - 1))
 		{
 			// Load and check before doing an expensive CAS
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
+			if (TKey test_key = _data[index].first.load(std::memory_order_relaxed);
 				test_key == key)
 			{
 				// Get the value before freeing the entry up for other threads to fill again
-				const TValuePtr old_value = _data[i].second;
+				const TValuePtr old_value = _data[index].second;
 
-				if (_data[i].first.compare_exchange_strong(test_key, no_value, std::memory_order_relaxed))
+				// Leave a tombstone instead of an empty entry, so that look ups of keys that were placed after this one in the probe sequence still find them
+				if (_data[index].first.compare_exchange_strong(test_key, erased_value, std::memory_order_relaxed))
 				{
 					return old_value;
 				}
 			}
+			else if (test_key == no_value)
+			{
+				break;
+			}
 		}
 
 		return nullptr;
@@ -248,5 +254,10 @@ public:
 	}
 
 protected:
+	static inline size_t hash_index(TKey key)
+	{
+		return std::hash<TKey>()(key) & (MAX_ENTRIES - 1);
+	}
+
 	std::pair<std::atomic<TKey>, TValuePtr> _data[MAX_ENTRIES];
 };
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+/// <summary>
+/// A simple bounded lock-free queue with multiple producers and a single consumer.
+/// Elements are dequeued in the same order the producers claimed their slots in.
+/// </summary>
+template <typename T, uint32_t MAX_ENTRIES>
+class lockfree_mpsc_queue
+{
+	static_assert(MAX_ENTRIES >= 2 && (MAX_ENTRIES & (MAX_ENTRIES - 1)) == 0, "MAX_ENTRIES has to be a power of two");
+
+public:
+	lockfree_mpsc_queue()
+	{
+		for (uint32_t i = 0; i < MAX_ENTRIES; ++i)
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Checks whether there is an element ready to be dequeued.
+	/// This may only be called from the consumer thread.
+	/// </summary>
+	bool empty() const
+	{
+		return _cells[_head & (MAX_ENTRIES - 1)].sequence.load(std::memory_order_acquire) != _head + 1;
+	}
+
+	/// <summary>
+	/// Adds a copy of the specified <paramref name="value"/> to the end of the queue.
+	/// This may be called from any thread.
+	/// </summary>
+	/// <param name="value">Value to add.</param>
+	/// <returns><see langword="true"/> if the value was added successfully, or <see langword="false"/> if the queue is full.</returns>
+	bool push(const T &value)
+	{
+		uint32_t pos = _tail.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			cell &c = _cells[pos & (MAX_ENTRIES - 1)];
+
+			const int32_t diff = static_cast<int32_t>(c.sequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0)
+			{
+				// Slot is free, try to claim it (on failure "pos" is updated with the current tail and the loop retries)
+				if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					c.value = value;
+
+					// Publish the value to the consumer
+					c.sequence.store(pos + 1, std::memory_order_release);
+
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false; // Queue is full, the consumer has not released this slot yet
+			}
+			else
+			{
+				pos = _tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Removes the element at the front of the queue.
+	/// This may only be called from the consumer thread.
+	/// </summary>
+	/// <param name="value">Value that was removed.</param>
+	/// <returns><see langword="true"/> if an element was removed, or <see langword="false"/> if the queue is empty.</returns>
+	bool pop(T &value)
+	{
+		cell &c = _cells[_head & (MAX_ENTRIES - 1)];
+
+		if (c.sequence.load(std::memory_order_acquire) != _head + 1)
+			return false;
+
+		value = std::move(c.value);
+
+		// Release the slot for producers again, one lap ahead
+		c.sequence.store(_head + MAX_ENTRIES, std::memory_order_release);
+		++_head;
+
+		return true;
+	}
+
+private:
+	struct cell
+	{
+		std::atomic<uint32_t> sequence;
+		T value;
+	};
+
+	alignas(64) std::atomic<uint32_t> _tail = 0;
+	alignas(64) uint32_t _head = 0;
+	cell _cells[MAX_ENTRIES];
+};
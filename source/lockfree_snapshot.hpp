@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/// <summary>
+/// A double-buffered value that a single producer publishes and any number of consumers read consistent copies of without locking.
+/// The producer always writes to the buffer that was not published last, so readers only have to retry in the rare case that a complete publish happened while they were copying.
+/// </summary>
+template <typename T>
+class lockfree_snapshot
+{
+	static_assert(std::is_trivially_copyable_v<T>, "T has to be trivially copyable");
+
+public:
+	/// <summary>
+	/// Replaces the published value with a copy of the specified <paramref name="value"/>.
+	/// This may only be called from a single thread at a time.
+	/// </summary>
+	void publish(const T &value)
+	{
+		const uint32_t sequence = _sequence.load(std::memory_order_relaxed) + 1;
+
+		_buffers[sequence & 1] = value;
+
+		// Swap which buffer readers copy from
+		_sequence.store(sequence, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// Returns a copy of the value that was last published.
+	/// This may be called from any thread.
+	/// </summary>
+	T read() const
+	{
+		for (;;)
+		{
+			const uint32_t sequence = _sequence.load(std::memory_order_acquire);
+
+			const T value = _buffers[sequence & 1];
+
+			// The producer only writes to this buffer again after it published the other one, so the copy is consistent if the sequence did not advance meanwhile
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (_sequence.load(std::memory_order_relaxed) == sequence)
+				return value;
+		}
+	}
+
+private:
+	alignas(64) std::atomic<uint32_t> _sequence = 0;
+	T _buffers[2] = {};
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "memory_patch.hpp"
+#include "dll_log.hpp"
+#include <cassert>
+#include <cstring> // std::memcpy
+#include <algorithm> // std::max, std::min, std::sort, std::unique
+#include <Windows.h>
+
+void reshade::memory_patch_set::write(uintptr_t address, const void *data, size_t size)
+{
+	assert(!_applied && size != 0);
+
+	patch &p = _patches.emplace_back();
+	p.address = address;
+	p.bytes.assign(static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+}
+
+void reshade::memory_patch_set::make_nop(uintptr_t address, size_t count)
+{
+	const std::vector<uint8_t> nops(count, 0x90);
+	write(address, nops.data(), nops.size());
+}
+void reshade::memory_patch_set::make_branch(uint8_t opcode, uintptr_t address, uintptr_t dest)
+{
+	const intptr_t displacement = static_cast<intptr_t>(dest) - static_cast<intptr_t>(address + 5);
+	// Relative branches only have a 32-bit displacement, which always reaches in 32-bit processes the game patches target
+	assert(displacement == static_cast<int32_t>(displacement));
+
+	uint8_t instruction[5] = { opcode };
+	const int32_t displacement32 = static_cast<int32_t>(displacement);
+	std::memcpy(instruction + 1, &displacement32, sizeof(displacement32));
+
+	write(address, instruction, sizeof(instruction));
+}
+
+bool reshade::memory_patch_set::apply()
+{
+	if (_applied)
+		return true;
+
+	if (!modify(true))
+		return false;
+
+	_applied = true;
+	return true;
+}
+bool reshade::memory_patch_set::revert()
+{
+	if (!_applied)
+		return true;
+
+	if (!modify(false))
+		return false;
+
+	_applied = false;
+	return true;
+}
+
+bool reshade::memory_patch_set::modify(bool apply)
+{
+	if (_patches.empty())
+		return true;
+
+	SYSTEM_INFO system_info = {};
+	GetSystemInfo(&system_info);
+	const uintptr_t page_size = system_info.dwPageSize;
+
+	// Collect all pages touched by any of the writes, so that the protection of each is only changed once
+	std::vector<uintptr_t> pages;
+	uintptr_t range_begin = UINTPTR_MAX, range_end = 0;
+	for (const patch &p : _patches)
+	{
+		for (uintptr_t page = p.address & ~(page_size - 1); page < p.address + p.bytes.size(); page += page_size)
+			pages.push_back(page);
+
+		range_begin = std::min(range_begin, p.address);
+		range_end = std::max(range_end, p.address + p.bytes.size());
+	}
+
+	std::sort(pages.begin(), pages.end());
+	pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+	std::vector<DWORD> page_protection(pages.size());
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		if (!VirtualProtect(reinterpret_cast<LPVOID>(pages[i]), page_size, PAGE_EXECUTE_READWRITE, &page_protection[i]))
+		{
+			log::message(log::level::error, "Failed to change memory protection of page at %p with error code %lu!", reinterpret_cast<void *>(pages[i]), GetLastError());
+
+			// Restore the pages that were already made writable and leave the memory untouched, so that the set is never only partially applied
+			while (i-- != 0)
+				VirtualProtect(reinterpret_cast<LPVOID>(pages[i]), page_size, page_protection[i], &page_protection[i]);
+			return false;
+		}
+	}
+
+	if (apply)
+	{
+		for (patch &p : _patches)
+		{
+			p.original_bytes.assign(reinterpret_cast<const uint8_t *>(p.address), reinterpret_cast<const uint8_t *>(p.address) + p.bytes.size());
+			std::memcpy(reinterpret_cast<void *>(p.address), p.bytes.data(), p.bytes.size());
+		}
+	}
+	else
+	{
+		for (auto it = _patches.rbegin(); it != _patches.rend(); ++it)
+			std::memcpy(reinterpret_cast<void *>(it->address), it->original_bytes.data(), it->original_bytes.size());
+	}
+
+	for (size_t i = 0; i < pages.size(); ++i)
+		VirtualProtect(reinterpret_cast<LPVOID>(pages[i]), page_size, page_protection[i], &page_protection[i]);
+
+	FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<LPCVOID>(range_begin), range_end - range_begin);
+
+	return true;
+}
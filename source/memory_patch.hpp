@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace reshade
+{
+	/// <summary>
+	/// Collection of writes to code or data of the current process that are applied and reverted together.
+	/// The memory protection of every affected page is only changed once per operation and the instruction cache is flushed once afterwards, instead of for every single write.
+	/// </summary>
+	class memory_patch_set
+	{
+	public:
+		/// <summary>
+		/// Adds a write of the specified bytes to the set. Nothing is modified until <see cref="apply"/> is called.
+		/// </summary>
+		/// <param name="address">Address to write to.</param>
+		/// <param name="data">Pointer to the bytes to write.</param>
+		/// <param name="size">Number of bytes to write.</param>
+		void write(uintptr_t address, const void *data, size_t size);
+		template <typename T>
+		void write(uintptr_t address, T value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			write(address, &value, sizeof(value));
+		}
+
+		/// <summary>
+		/// Adds a relative jump instruction at <paramref name="address"/> to the specified destination to the set.
+		/// </summary>
+		void make_jmp(uintptr_t address, uintptr_t dest) { make_branch(0xE9, address, dest); }
+		template <typename F, std::enable_if_t<std::is_function_v<F>, int> = 0>
+		void make_jmp(uintptr_t address, F *dest) { make_jmp(address, reinterpret_cast<uintptr_t>(dest)); }
+		/// <summary>
+		/// Adds a relative call instruction at <paramref name="address"/> to the specified destination to the set.
+		/// </summary>
+		void make_call(uintptr_t address, uintptr_t dest) { make_branch(0xE8, address, dest); }
+		template <typename F, std::enable_if_t<std::is_function_v<F>, int> = 0>
+		void make_call(uintptr_t address, F *dest) { make_call(address, reinterpret_cast<uintptr_t>(dest)); }
+		/// <summary>
+		/// Adds a write of <paramref name="count"/> no-operation instructions at <paramref name="address"/> to the set.
+		/// </summary>
+		void make_nop(uintptr_t address, size_t count);
+
+		/// <summary>
+		/// Applies all writes in the order they were added, after saving the bytes they replace.
+		/// If the memory protection of any page cannot be changed, nothing is modified.
+		/// </summary>
+		/// <returns><see langword="true"/> if the set was applied (or already was before), <see langword="false"/> otherwise.</returns>
+		bool apply();
+		/// <summary>
+		/// Restores the bytes that were replaced when the set was applied, in reverse order so that overlapping writes are undone correctly.
+		/// </summary>
+		/// <returns><see langword="true"/> if the set was reverted (or was not applied before), <see langword="false"/> otherwise.</returns>
+		bool revert();
+
+		bool is_applied() const { return _applied; }
+
+	private:
+		struct patch
+		{
+			uintptr_t address;
+			std::vector<uint8_t> bytes;
+			std::vector<uint8_t> original_bytes;
+		};
+
+		void make_branch(uint8_t opcode, uintptr_t address, uintptr_t dest);
+		bool modify(bool apply);
+
+		std::vector<patch> _patches;
+		bool _applied = false;
+	};
+}
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <algorithm> // std::copy, std::nth_element
+
 template <typename T, size_t SAMPLES>
 class moving_average
 {
@@ -30,6 +32,17 @@ public:
 		_average = _tick_sum / SAMPLES;
 	}
 
+	T last() const { return _tick_list[(_index + SAMPLES - 1) % SAMPLES]; }
+	// Value below which the specified percentage of the samples in the window fall
+	T percentile(unsigned int percent) const
+	{
+		T sorted[SAMPLES];
+		std::copy(_tick_list, _tick_list + SAMPLES, sorted);
+		const size_t index = std::min((SAMPLES * percent) / 100, SAMPLES - 1);
+		std::nth_element(sorted, sorted + index, sorted + SAMPLES);
+		return sorted[index];
+	}
+
 private:
 	size_t _index;
 	T _average, _tick_sum, _tick_list[SAMPLES];
@@ -12,6 +12,18 @@
 
 extern thread_local reshade::opengl::device_context_impl *g_opengl_context;
 
+/// <summary>
+/// Keeps track of the number of vertices specified inside a 'glBegin'/'glEnd' pair, which is reported with the draw event in 'glEnd'.
+/// This is called for every single vertex, so skip it entirely unless an add-on is actually listening for draws.
+/// </summary>
+static __forceinline void count_immediate_mode_vertex()
+{
+#if RESHADE_ADDON
+	if ((reshade::has_addon_event<reshade::addon_event::draw>() || reshade::has_addon_event<reshade::addon_event::command_batch>()) && g_opengl_context != nullptr)
+		g_opengl_context->_current_vertex_count++;
+#endif
+}
+
 // Fixed function pipeline hooks
 
 extern "C" void APIENTRY glAccum(GLenum op, GLfloat value)
@@ -328,7 +340,9 @@ extern "C" void APIENTRY glEnd()
 	if (g_opengl_context)
 	{
 #if RESHADE_ADDON
-		reshade::invoke_addon_event<reshade::addon_event::draw>(g_opengl_context, g_opengl_context->_current_vertex_count, 1, 0, 0); // Cannot be skipped
+		// Emit a single draw event for all the vertices specified since 'glBegin'
+		if (g_opengl_context->_current_vertex_count != 0)
+			reshade::invoke_addon_event<reshade::addon_event::draw>(g_opengl_context, g_opengl_context->_current_vertex_count, 1, 0, 0); // Cannot be skipped
 #endif
 		g_opengl_context->_current_vertex_count = 0;
 	}
@@ -1517,192 +1531,168 @@ extern "C" void APIENTRY glTranslatef(GLfloat x, GLfloat y, GLfloat z)
 
 extern "C" void APIENTRY glVertex2d(GLdouble x, GLdouble y)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2d);
 	trampoline(x, y);
 }
 extern "C" void APIENTRY glVertex2dv(const GLdouble *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2dv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex2f(GLfloat x, GLfloat y)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2f);
 	trampoline(x, y);
 }
 extern "C" void APIENTRY glVertex2fv(const GLfloat *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2fv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex2i(GLint x, GLint y)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2i);
 	trampoline(x, y);
 }
 extern "C" void APIENTRY glVertex2iv(const GLint *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2iv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex2s(GLshort x, GLshort y)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2s);
 	trampoline(x, y);
 }
 extern "C" void APIENTRY glVertex2sv(const GLshort *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 2;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex2sv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex3d(GLdouble x, GLdouble y, GLdouble z)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3d);
 	trampoline(x, y, z);
 }
 extern "C" void APIENTRY glVertex3dv(const GLdouble *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3dv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex3f(GLfloat x, GLfloat y, GLfloat z)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3f);
 	trampoline(x, y, z);
 }
 extern "C" void APIENTRY glVertex3fv(const GLfloat *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3fv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex3i(GLint x, GLint y, GLint z)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3i);
 	trampoline(x, y, z);
 }
 extern "C" void APIENTRY glVertex3iv(const GLint *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3iv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex3s(GLshort x, GLshort y, GLshort z)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3s);
 	trampoline(x, y, z);
 }
 extern "C" void APIENTRY glVertex3sv(const GLshort *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 3;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex3sv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex4d(GLdouble x, GLdouble y, GLdouble z, GLdouble w)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4d);
 	trampoline(x, y, z, w);
 }
 extern "C" void APIENTRY glVertex4dv(const GLdouble *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4dv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex4f(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4f);
 	trampoline(x, y, z, w);
 }
 extern "C" void APIENTRY glVertex4fv(const GLfloat *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4fv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex4i(GLint x, GLint y, GLint z, GLint w)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4i);
 	trampoline(x, y, z, w);
 }
 extern "C" void APIENTRY glVertex4iv(const GLint *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4iv);
 	trampoline(v);
 }
 extern "C" void APIENTRY glVertex4s(GLshort x, GLshort y, GLshort z, GLshort w)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4s);
 	trampoline(x, y, z, w);
 }
 extern "C" void APIENTRY glVertex4sv(const GLshort *v)
 {
-	if (g_opengl_context)
-		g_opengl_context->_current_vertex_count += 4;
+	count_immediate_mode_vertex();
 
 	static const auto trampoline = reshade::hooks::call(glVertex4sv);
 	trampoline(v);
@@ -1055,6 +1055,18 @@ void reshade::opengl::device_context_impl::push_constants(api::shader_stage, api
 	assert(first == 0);
 
 	const GLuint binding = reinterpret_cast<pipeline_layout_impl *>(layout.handle)->ranges[layout_param].binding;
+
+	// Sub-allocate from the persistently mapped ring buffer where possible, which avoids the implicit synchronization buffer updates can cause in the driver
+	// Uniform blocks are padded to a multiple of 16 bytes, so ensure the bound range covers that padding too
+	const GLuint push_constants_range_size = (((first + count) * sizeof(uint32_t)) + 15) & ~15u;
+	if (GLintptr offset = 0; allocate_push_constants(push_constants_range_size, offset))
+	{
+		std::memcpy(_push_constants_ring_data + offset, values, count * sizeof(uint32_t));
+
+		gl.BindBufferRange(GL_UNIFORM_BUFFER, binding, _push_constants_ring, offset, push_constants_range_size);
+		return;
+	}
+
 	if (binding >= _push_constants.size())
 	{
 		_push_constants.resize(binding + 1);
@@ -1090,6 +1102,74 @@ void reshade::opengl::device_context_impl::push_constants(api::shader_stage, api
 		gl.UnmapBuffer(GL_UNIFORM_BUFFER);
 	}
 }
+bool reshade::opengl::device_context_impl::allocate_push_constants(GLuint size, GLintptr &offset)
+{
+	constexpr GLuint segment_size = PUSH_CONSTANTS_RING_SIZE / PUSH_CONSTANTS_RING_SEGMENTS;
+
+	if (size > segment_size)
+		return false;
+
+	if (_push_constants_ring == 0)
+	{
+		// Persistent mapping requires 'glBufferStorage', so fall back to updating individual buffers if that is not available
+		if (_push_constants_ring_unsupported || !gl3wIsSupported(4, 4))
+		{
+			_push_constants_ring_unsupported = true;
+			return false;
+		}
+
+		GLint alignment = 0;
+		gl.GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment > 0)
+			_push_constants_ring_alignment = static_cast<GLuint>(alignment);
+
+		constexpr GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		gl.GenBuffers(1, &_push_constants_ring);
+		gl.BindBuffer(GL_UNIFORM_BUFFER, _push_constants_ring);
+		gl.BufferStorage(GL_UNIFORM_BUFFER, PUSH_CONSTANTS_RING_SIZE, nullptr, map_flags);
+
+		_push_constants_ring_data = static_cast<uint8_t *>(gl.MapBufferRange(GL_UNIFORM_BUFFER, 0, PUSH_CONSTANTS_RING_SIZE, map_flags));
+		if (_push_constants_ring_data == nullptr)
+		{
+			gl.DeleteBuffers(1, &_push_constants_ring);
+			_push_constants_ring = 0;
+			_push_constants_ring_unsupported = true;
+			return false;
+		}
+
+		_device_impl->set_resource_name(make_resource_handle(GL_BUFFER, _push_constants_ring), "Push constants ring");
+	}
+
+	GLuint aligned_offset = (_push_constants_ring_offset + _push_constants_ring_alignment - 1) / _push_constants_ring_alignment * _push_constants_ring_alignment;
+
+	// Continue with the next segment when the current one is full
+	if (aligned_offset + size > (_push_constants_ring_segment + 1) * segment_size)
+	{
+		// All commands referencing the current segment have been issued at this point, so protect it with a fence
+		_push_constants_ring_fences[_push_constants_ring_segment] = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		_push_constants_ring_segment = (_push_constants_ring_segment + 1) % PUSH_CONSTANTS_RING_SEGMENTS;
+
+		// Make sure the GPU has finished reading from the next segment before overwriting it
+		if (const GLsync sync_object = _push_constants_ring_fences[_push_constants_ring_segment]; sync_object != 0)
+		{
+			while (gl.ClientWaitSync(sync_object, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+				continue;
+
+			gl.DeleteSync(sync_object);
+			_push_constants_ring_fences[_push_constants_ring_segment] = 0;
+		}
+
+		aligned_offset = _push_constants_ring_segment * segment_size;
+	}
+
+	offset = aligned_offset;
+	_push_constants_ring_offset = aligned_offset + size;
+
+	return true;
+}
+
 void reshade::opengl::device_context_impl::push_descriptors(api::shader_stage, api::pipeline_layout layout, uint32_t layout_param, const api::descriptor_table_update &update)
 {
 	assert(update.table == 0 && update.array_offset == 0);
@@ -1670,6 +1750,17 @@ void reshade::opengl::device_context_impl::copy_texture_region(api::resource src
 		if (prev_framebuffer_srgb)
 			gl.Enable(GL_FRAMEBUFFER_SRGB);
 	}
+
+	// Transfer the data of textures that are read back on the CPU into their pixel buffer object right away, so that mapping them later does not stall the pipeline
+	if (const auto it = _device_impl->_readback_buffers.find(dst.handle);
+		it != _device_impl->_readback_buffers.end() && dst_subresource == 0 && dst_box == nullptr)
+	{
+		copy_texture_to_buffer(dst, 0, nullptr, make_resource_handle(GL_BUFFER, it->second.buffer), 0, 0, 0);
+
+		if (it->second.sync != 0)
+			gl.DeleteSync(it->second.sync);
+		it->second.sync = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
 }
 void reshade::opengl::device_context_impl::copy_texture_to_buffer(api::resource src, uint32_t src_subresource, const api::subresource_box *src_box, api::resource dst, uint64_t dst_offset, uint32_t row_length, uint32_t slice_height)
 {
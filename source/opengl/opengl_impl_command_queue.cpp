@@ -28,6 +28,12 @@ reshade::opengl::device_context_impl::~device_context_impl()
 
 	// Destroy push constants buffers
 	gl.DeleteBuffers(static_cast<GLsizei>(_push_constants.size()), _push_constants.data());
+
+	// Destroy push constants ring buffer (which implicitly unmaps it)
+	for (const GLsync sync_object : _push_constants_ring_fences)
+		if (sync_object != 0)
+			gl.DeleteSync(sync_object);
+	gl.DeleteBuffers(1, &_push_constants_ring);
 }
 
 reshade::api::device *reshade::opengl::device_context_impl::get_device()
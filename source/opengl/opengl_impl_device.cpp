@@ -8,12 +8,15 @@
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
 #include "ini_file.hpp"
-#include <cstdio> // std::sscanf
+#include <cstdio> // std::snprintf, std::sscanf
 #include <cstring> // std::memcpy, std::strcmp, std::strncmp, std::strncpy
 #include <algorithm> // std::copy_n, std::fill_n, std::max
 
 #define gl gl3wProcs.gl
 
+extern std::filesystem::path g_reshade_base_path;
+extern bool resolve_path(std::filesystem::path &path, std::error_code &ec);
+
 reshade::opengl::device_impl::device_impl(HDC initial_hdc, HGLRC shared_hglrc, bool compatibility_context) :
 	api_object_impl(shared_hglrc),
 	_compatibility_context(compatibility_context)
@@ -129,6 +132,41 @@ reshade::opengl::device_impl::device_impl(HDC initial_hdc, HGLRC shared_hglrc, b
 		gl.LinkProgram(_mipmap_program);
 		gl.DeleteShader(mipmap_cs);
 	}
+
+	// Open archive of linked program binaries (core since OpenGL 4.1), if the driver supports any binary format
+	GLint num_program_binary_formats = 0;
+	if (gl3wIsSupported(4, 1))
+		gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_program_binary_formats);
+
+	bool no_effect_cache = false;
+	global_config().get("GENERAL", "NoEffectCache", no_effect_cache);
+
+	if (num_program_binary_formats > 0 && !no_effect_cache)
+	{
+		// Share the directory with the effect cache (see 'runtime::load_config'), but key the file by vendor, renderer and driver version, since program binaries are only valid for the exact driver they were created with
+		std::error_code ec;
+		std::filesystem::path cache_path;
+		global_config().get("GENERAL", "IntermediateCachePath", cache_path);
+		if (cache_path.empty() || !resolve_path(cache_path, ec))
+			cache_path = std::filesystem::temp_directory_path(ec) / L"ReShade";
+		cache_path = g_reshade_base_path / cache_path;
+		std::filesystem::create_directory(cache_path, ec);
+
+		unsigned int cache_size = 128;
+		global_config().get("GENERAL", "IntermediateCacheSize", cache_size);
+
+		std::string driver_identity;
+		for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			if (const GLubyte *const value = gl.GetString(name))
+				driver_identity += reinterpret_cast<const char *>(value);
+			driver_identity += '\n';
+		}
+
+		char file_name[64];
+		std::snprintf(file_name, std::size(file_name), "reshade-gl-programs-%08x.bin", static_cast<unsigned int>(std::hash<std::string>()(driver_identity) & 0xFFFFFFFF));
+		_program_cache.open(cache_path / file_name, static_cast<uint64_t>(cache_size) * 1024 * 1024);
+	}
 }
 reshade::opengl::device_impl::~device_impl()
 {
@@ -137,6 +175,15 @@ reshade::opengl::device_impl::~device_impl()
 	// Destroy mipmap generation program
 	gl.DeleteProgram(_mipmap_program);
 
+	// Destroy staging buffers
+	for (const auto &readback_data : _readback_buffers)
+	{
+		gl.DeleteBuffers(1, &readback_data.second.buffer);
+		if (readback_data.second.sync != 0)
+			gl.DeleteSync(readback_data.second.sync);
+	}
+	gl.DeleteBuffers(1, &_upload_buffer);
+
 	// Free range of reserved resource names
 	gl.DeleteBuffers(static_cast<GLsizei>(_reserved_buffer_names.size()), _reserved_buffer_names.data());
 	gl.DeleteTextures(static_cast<GLsizei>(_reserved_texture_names.size()), _reserved_texture_names.data());
@@ -673,6 +720,29 @@ bool reshade::opengl::device_impl::create_resource(const api::resource_desc &des
 	}
 
 	*out_resource = make_resource_handle(target, object);
+
+	// Textures that are read back on the CPU are additionally transferred into a pixel buffer object after every copy to them (see 'device_context_impl::copy_texture_region'), so that mapping them later does not have to wait for the transfer
+	if (desc.heap == api::memory_heap::gpu_to_cpu && target == GL_TEXTURE_2D && desc.texture.depth_or_layers == 1 && desc.texture.levels == 1)
+	{
+		const auto row_pitch = api::format_row_pitch(desc.texture.format, desc.texture.width);
+		const auto slice_pitch = api::format_slice_pitch(desc.texture.format, row_pitch, desc.texture.height);
+
+		GLuint prev_pack_binding = 0;
+		gl.GetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, reinterpret_cast<GLint *>(&prev_pack_binding));
+
+		GLuint readback_buffer = 0;
+		gl.GenBuffers(1, &readback_buffer);
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback_buffer);
+		gl.BufferData(GL_PIXEL_PACK_BUFFER, slice_pitch, nullptr, GL_STREAM_READ);
+
+		if (gl.GetError() == GL_NO_ERROR)
+			_readback_buffers.emplace(out_resource->handle, readback_info { readback_buffer, 0 });
+		else
+			gl.DeleteBuffers(1, &readback_buffer);
+
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, prev_pack_binding);
+	}
+
 	return true;
 }
 void reshade::opengl::device_impl::destroy_resource(api::resource resource)
@@ -695,6 +765,14 @@ void reshade::opengl::device_impl::destroy_resource(api::resource resource)
 	case GL_TEXTURE_CUBE_MAP_ARRAY:
 	case GL_TEXTURE_RECTANGLE:
 		gl.DeleteTextures(1, &object);
+		if (const auto it = _readback_buffers.find(resource.handle);
+			it != _readback_buffers.end())
+		{
+			gl.DeleteBuffers(1, &it->second.buffer);
+			if (it->second.sync != 0)
+				gl.DeleteSync(it->second.sync);
+			_readback_buffers.erase(it);
+		}
 		break;
 	case GL_RENDERBUFFER:
 		gl.DeleteRenderbuffers(1, &object);
@@ -1490,6 +1568,31 @@ bool reshade::opengl::device_impl::map_texture_region(api::resource resource, ui
 	if (access == api::map_access::write_only || access == api::map_access::write_discard)
 		return true;
 
+	// Use the data that was already transferred into the pixel buffer object of this texture after the last copy to it, instead of downloading it synchronously
+	if (const auto it = _readback_buffers.find(resource.handle);
+		it != _readback_buffers.end() && it->second.sync != 0 && subresource == 0 && box == nullptr)
+	{
+		while (gl.ClientWaitSync(it->second.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+			continue;
+
+		GLuint prev_pack_binding = 0;
+		gl.GetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, reinterpret_cast<GLint *>(&prev_pack_binding));
+
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, it->second.buffer);
+
+		const void *const mapped_data = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(total_image_size), GL_MAP_READ_BIT);
+		if (mapped_data != nullptr)
+		{
+			std::memcpy(pixels, mapped_data, total_image_size);
+			gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		gl.BindBuffer(GL_PIXEL_PACK_BUFFER, prev_pack_binding);
+
+		if (mapped_data != nullptr)
+			return true;
+	}
+
 	const GLenum target = resource.handle >> 40;
 	const GLuint object = resource.handle & 0xFFFFFFFF;
 
@@ -1745,6 +1848,25 @@ void reshade::opengl::device_impl::update_texture_region(const api::subresource_
 		pixels = temp_pixels.data();
 	}
 
+	// Stage pixel data through a pixel buffer object, so that the driver can schedule the transfer asynchronously instead of having to consume the client memory during the call
+	if (_upload_buffer == 0)
+		gl.GenBuffers(1, &_upload_buffer);
+
+	gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _upload_buffer);
+	gl.BufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(total_image_size), nullptr, GL_STREAM_DRAW); // Orphan previous data store, which may still be in use by previous uploads
+
+	if (void *const mapped_data = gl.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(total_image_size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT))
+	{
+		std::memcpy(mapped_data, pixels, total_image_size);
+		gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		pixels = nullptr; // Pointer is interpreted as an offset into the bound unpack buffer now
+	}
+	else
+	{
+		gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
 	switch (level_target)
 	{
 	case GL_TEXTURE_1D:
@@ -1786,8 +1908,7 @@ void reshade::opengl::device_impl::update_texture_region(const api::subresource_
 	if (object != prev_binding)
 		gl.BindTexture(target, prev_binding);
 
-	if (prev_unpack_binding != 0)
-		gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, prev_unpack_binding);
+	gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, prev_unpack_binding);
 
 	gl.PixelStorei(GL_UNPACK_LSB_FIRST, prev_unpack_lsb);
 	gl.PixelStorei(GL_UNPACK_SWAP_BYTES, prev_unpack_swap);
@@ -1799,6 +1920,24 @@ void reshade::opengl::device_impl::update_texture_region(const api::subresource_
 	gl.PixelStorei(GL_UNPACK_SKIP_IMAGES, prev_unpack_skip_images);
 }
 
+static void append_program_cache_key(std::string &key, GLenum type, const reshade::api::shader_desc &desc)
+{
+	char buffer[64];
+	std::snprintf(buffer, std::size(buffer), "%04x-%zx-%016llx-", type, desc.code_size, static_cast<unsigned long long>(std::hash<std::string_view>()(std::string_view(static_cast<const char *>(desc.code), desc.code_size))));
+	key += buffer;
+
+	if (desc.entry_point != nullptr)
+		key += desc.entry_point;
+
+	for (uint32_t i = 0; i < desc.spec_constants; ++i)
+	{
+		std::snprintf(buffer, std::size(buffer), "-%x=%x", desc.spec_constant_ids[i], desc.spec_constant_values[i]);
+		key += buffer;
+	}
+
+	key += ';';
+}
+
 static bool create_shader_module(GLenum type, const reshade::api::shader_desc &desc, GLuint &shader_object)
 {
 	if (desc.code_size > 5 && std::strncmp(static_cast<const char *>(desc.code), "!!ARB", 5) == 0)
@@ -1859,6 +1998,53 @@ bool reshade::opengl::device_impl::create_pipeline(api::pipeline_layout, uint32_
 	api::primitive_topology topology = api::primitive_topology::undefined;
 	uint32_t sample_mask = UINT32_MAX;
 
+	// Look for a program binary linked from the same shaders during a previous run first, in which case compiling and linking them can be skipped entirely
+	std::string program_cache_key;
+	GLuint cached_program = 0;
+
+	if (!_program_cache.path().empty())
+	{
+		static constexpr std::pair<api::pipeline_subobject_type, GLenum> shader_stages[] = {
+			{ api::pipeline_subobject_type::vertex_shader, GL_VERTEX_SHADER },
+			{ api::pipeline_subobject_type::hull_shader, GL_TESS_CONTROL_SHADER },
+			{ api::pipeline_subobject_type::domain_shader, GL_TESS_EVALUATION_SHADER },
+			{ api::pipeline_subobject_type::geometry_shader, GL_GEOMETRY_SHADER },
+			{ api::pipeline_subobject_type::pixel_shader, GL_FRAGMENT_SHADER },
+			{ api::pipeline_subobject_type::compute_shader, GL_COMPUTE_SHADER },
+		};
+
+		for (uint32_t i = 0; i < subobject_count; ++i)
+		{
+			if (subobjects[i].count == 0)
+				continue;
+
+			for (const auto &stage : shader_stages)
+				if (subobjects[i].type == stage.first && static_cast<const api::shader_desc *>(subobjects[i].data)->code_size != 0)
+					append_program_cache_key(program_cache_key, stage.second, *static_cast<const api::shader_desc *>(subobjects[i].data));
+		}
+
+		// The first bytes of the stored data contain the binary format the driver returned along with the binary
+		std::string program_binary;
+		if (!program_cache_key.empty() && _program_cache.load(program_cache_key, program_binary) && program_binary.size() > sizeof(GLenum))
+		{
+			GLenum program_binary_format = GL_NONE;
+			std::memcpy(&program_binary_format, program_binary.data(), sizeof(program_binary_format));
+
+			cached_program = gl.CreateProgram();
+			gl.ProgramBinary(cached_program, program_binary_format, program_binary.data() + sizeof(program_binary_format), static_cast<GLsizei>(program_binary.size() - sizeof(program_binary_format)));
+
+			// Drivers may reject binaries at any time (e.g. after a driver update), in which case fall back to compiling the shaders below
+			GLint status = GL_FALSE;
+			gl.GetProgramiv(cached_program, GL_LINK_STATUS, &status);
+
+			if (GL_FALSE == status)
+			{
+				gl.DeleteProgram(cached_program);
+				cached_program = 0;
+			}
+		}
+	}
+
 	for (uint32_t i = 0; i < subobject_count; ++i)
 	{
 		if (subobjects[i].count == 0)
@@ -1868,42 +2054,42 @@ bool reshade::opengl::device_impl::create_pipeline(api::pipeline_layout, uint32_
 		{
 		case api::pipeline_subobject_type::vertex_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_VERTEX_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
 			break;
 		case api::pipeline_subobject_type::hull_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_TESS_CONTROL_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
 			break;
 		case api::pipeline_subobject_type::domain_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_TESS_EVALUATION_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
 			break;
 		case api::pipeline_subobject_type::geometry_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_GEOMETRY_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
 			break;
 		case api::pipeline_subobject_type::pixel_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_FRAGMENT_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
 			break;
 		case api::pipeline_subobject_type::compute_shader:
 			assert(subobjects[i].count == 1);
-			if (static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
+			if (cached_program != 0 || static_cast<const api::shader_desc *>(subobjects[i].data)->code_size == 0)
 				break;
 			if (!create_shader_module(GL_COMPUTE_SHADER, *static_cast<const api::shader_desc *>(subobjects[i].data), shaders.emplace_back()))
 				goto exit_failure;
@@ -1954,10 +2140,17 @@ bool reshade::opengl::device_impl::create_pipeline(api::pipeline_layout, uint32_
 
 	pipeline_impl *const impl = new pipeline_impl();
 
-	if (!shaders.empty())
+	if (cached_program != 0)
+	{
+		impl->program = cached_program;
+	}
+	else if (!shaders.empty())
 	{
 		impl->program = gl.CreateProgram();
 
+		if (!program_cache_key.empty())
+			gl.ProgramParameteri(impl->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 		for (const GLuint shader : shaders)
 		{
 			gl.AttachShader(impl->program, shader);
@@ -1992,6 +2185,24 @@ bool reshade::opengl::device_impl::create_pipeline(api::pipeline_layout, uint32_
 			gl.DeleteProgram(impl->program);
 			goto exit_failure;
 		}
+
+		if (!program_cache_key.empty())
+		{
+			GLint program_binary_size = 0;
+			gl.GetProgramiv(impl->program, GL_PROGRAM_BINARY_LENGTH, &program_binary_size);
+
+			if (0 < program_binary_size)
+			{
+				GLenum program_binary_format = GL_NONE;
+				std::string program_binary(sizeof(program_binary_format) + program_binary_size, '\0');
+				gl.GetProgramBinary(impl->program, program_binary_size, &program_binary_size, &program_binary_format, program_binary.data() + sizeof(program_binary_format));
+				std::memcpy(program_binary.data(), &program_binary_format, sizeof(program_binary_format));
+				program_binary.resize(sizeof(program_binary_format) + program_binary_size);
+
+				if (0 < program_binary_size)
+					_program_cache.save(program_cache_key, program_binary);
+			}
+		}
 	}
 	else
 	{
@@ -2059,6 +2270,8 @@ bool reshade::opengl::device_impl::create_pipeline(api::pipeline_layout, uint32_
 exit_failure:
 	for (const GLuint shader : shaders)
 		gl.DeleteShader(shader);
+	if (cached_program != 0)
+		gl.DeleteProgram(cached_program);
 
 	*out_pipeline = { 0 };
 	return false;
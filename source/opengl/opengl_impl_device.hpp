@@ -7,6 +7,7 @@
 
 #include <GL/gl3w.h>
 #include "reshade_api_object_impl.hpp"
+#include "effect_cache.hpp"
 #include <atomic>
 #include <unordered_map>
 
@@ -105,6 +106,9 @@ namespace reshade::opengl
 
 		GLuint _mipmap_program = 0;
 
+		// Archive of linked program binaries, so that programs do not have to be compiled and linked again on the next start
+		effect_cache _program_cache;
+
 		struct map_info
 		{
 			api::subresource_data data;
@@ -113,6 +117,17 @@ namespace reshade::opengl
 		};
 		std::unordered_map<size_t, map_info> _map_lookup;
 
+		// Pixel buffer objects that textures which are read back on the CPU are transferred into right after every copy to them, together with a fence signaled when that transfer finished
+		struct readback_info
+		{
+			GLuint buffer;
+			GLsync sync;
+		};
+		std::unordered_map<uint64_t, readback_info> _readback_buffers;
+
+		// Pixel buffer object that texture uploads are staged through, which is orphaned on every upload so that the driver can keep transfers in flight
+		GLuint _upload_buffer = 0;
+
 		std::atomic<uint64_t> _fbo_lookup_version = 0;
 		std::atomic<uint64_t> _vao_lookup_version = 0;
 	};
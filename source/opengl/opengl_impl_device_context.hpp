@@ -106,11 +106,24 @@ namespace reshade::opengl
 		unsigned int _default_fbo_height = 0;
 
 	private:
+		bool allocate_push_constants(GLuint size, GLintptr &offset);
+
 		device_impl *const _device_impl;
 
 		std::vector<GLuint> _push_constants;
 		std::vector<GLuint> _push_constants_size;
 
+		// Persistently mapped ring buffer that push constants are sub-allocated from, which is split into segments that are each protected by a fence before being reused
+		static constexpr GLuint PUSH_CONSTANTS_RING_SIZE = 4 * 1024 * 1024;
+		static constexpr GLuint PUSH_CONSTANTS_RING_SEGMENTS = 4;
+		GLuint _push_constants_ring = 0;
+		uint8_t *_push_constants_ring_data = nullptr;
+		GLuint _push_constants_ring_offset = 0;
+		GLuint _push_constants_ring_segment = 0;
+		GLuint _push_constants_ring_alignment = 256;
+		GLsync _push_constants_ring_fences[PUSH_CONSTANTS_RING_SEGMENTS] = {};
+		bool _push_constants_ring_unsupported = false;
+
 		// Framebuffer and vertex array objects cannot be shared between render contexts, so have to create them for each one
 		uint64_t _last_fbo_lookup_version = 0;
 		std::unordered_map<size_t, GLuint> _fbo_lookup;
@@ -10,9 +10,11 @@
 #include "d3d12/d3d12_device.hpp"
 #include "d3d12/d3d12_command_queue.hpp"
 #include "opengl/opengl_impl_device_context.hpp"
+#include "opengl/opengl_impl_type_convert.hpp"
 #include "dll_log.hpp"
 #include "addon_manager.hpp"
 #include "runtime_manager.hpp"
+#include "ini_file.hpp"
 #include <cmath> // std::abs, std::ceil, std::floor
 #include <algorithm> // std::max, std::min
 
@@ -46,6 +48,9 @@ reshade::openvr::swapchain_impl::swapchain_impl(api::device *device, api::comman
 {
 	_is_opengl = device->get_api() == api::device_api::opengl;
 
+	// Optionally apply effects directly to the texture the application submitted when it contains both eyes side-by-side, instead of copying them to a separate one first
+	global_config().get("APP", "OpenVRProcessInPlace", _allow_in_place);
+
 	create_effect_runtime(this, graphics_queue, true);
 }
 
@@ -139,8 +144,11 @@ void reshade::openvr::swapchain_impl::on_reset()
 	invoke_addon_event<addon_event::destroy_swapchain>(this, false);
 #endif
 
-	_device->destroy_resource(_side_by_side_texture);
+	// Do not destroy the application texture when effects were applied to it directly
+	if (!_in_place)
+		_device->destroy_resource(_side_by_side_texture);
 	_side_by_side_texture = {};
+	_in_place = false;
 }
 
 bool reshade::openvr::swapchain_impl::on_vr_submit(api::command_queue *queue, vr::EVREye eye, api::resource eye_texture, vr::EColorSpace color_space, const vr::VRTextureBounds_t *bounds, uint32_t layer)
@@ -181,6 +189,78 @@ bool reshade::openvr::swapchain_impl::on_vr_submit(api::command_queue *queue, vr
 
 	set_color_space(color_space);
 
+	const bool is_d3d12 = _device->get_api() == api::device_api::d3d12;
+
+	// Can only apply effects directly to the submitted texture if it is a single render target that contains the left eye in its left half and the right eye in its right half
+	const bool in_place_compatible = _allow_in_place &&
+		source_desc.texture.samples <= 1 && source_desc.texture.depth_or_layers <= 1 && (source_desc.usage & api::resource_usage::render_target) != 0 &&
+		(!_is_opengl || eye_texture == opengl::make_resource_handle(GL_TEXTURE_2D, eye_texture.handle & 0xFFFFFFFF)) &&
+		source_box.top == 0 && source_box.bottom == source_desc.texture.height &&
+		(eye != vr::Eye_Right ?
+			source_box.left == 0 && std::abs(static_cast<int32_t>(source_box.right) - static_cast<int32_t>(source_desc.texture.width / 2)) <= 1 :
+			source_box.right == source_desc.texture.width && std::abs(static_cast<int32_t>(source_box.left) - static_cast<int32_t>(source_desc.texture.width / 2)) <= 1);
+
+	// Switch to processing in place once the application submitted the same texture for both eyes two frames in a row (which excludes applications that cycle through multiple textures, since those would require reinitializing every frame)
+	if (!_in_place && eye != vr::Eye_Right && in_place_compatible && eye_texture == _in_place_candidate)
+	{
+		reshade::log::message(reshade::log::level::info, "Switching runtime %p in VR to apply effects directly to the submitted eye texture.", this);
+
+		on_reset();
+
+		_side_by_side_texture = eye_texture;
+		_in_place = true;
+
+		if (!on_init())
+			return false;
+	}
+
+	if (_in_place)
+	{
+		if (eye_texture == _side_by_side_texture && in_place_compatible)
+		{
+			// Skip the left eye and instead apply effects to both eyes in one step after the application submitted the right eye too
+			if (eye != vr::Eye_Right)
+				return true;
+
+			api::command_list *const cmd_list = queue->get_immediate_command_list();
+
+			// Transition to the same state the side-by-side texture is in when copying (see below)
+			const api::resource_usage eye_texture_usage = is_d3d12 ? api::resource_usage::shader_resource_pixel : api::resource_usage::copy_source;
+			cmd_list->barrier(eye_texture, eye_texture_usage, api::resource_usage::general);
+
+#if RESHADE_ADDON
+			const reshade::api::rect left_eye_rect = get_eye_rect(vr::Eye_Left);
+			invoke_addon_event<reshade::addon_event::present>(queue, this, &left_eye_rect, &left_eye_rect, 0, nullptr);
+			const reshade::api::rect right_eye_rect = get_eye_rect(vr::Eye_Right);
+			invoke_addon_event<reshade::addon_event::present>(queue, this, &right_eye_rect, &right_eye_rect, 0, nullptr);
+#endif
+
+			reshade::present_effect_runtime(this, queue);
+
+			cmd_list->barrier(eye_texture, api::resource_usage::general, eye_texture_usage);
+
+			return true;
+		}
+
+		reshade::log::message(reshade::log::level::info, "Application changed the submitted eye texture of runtime %p in VR, switching back to copying it.", this);
+
+		// Do not try again, since this would otherwise keep switching back and forth
+		_allow_in_place = false;
+		_in_place_candidate = {};
+
+		on_reset();
+
+		// The left eye was not copied when processing in place, so cannot complete this frame
+		if (eye == vr::Eye_Right)
+			return false;
+	}
+
+	// Remember whether both eyes of this frame could have been processed in place
+	if (eye != vr::Eye_Right)
+		_in_place_candidate_left = in_place_compatible ? eye_texture : api::resource {};
+	else
+		_in_place_candidate = in_place_compatible && eye_texture == _in_place_candidate_left ? eye_texture : api::resource {};
+
 	const api::resource_desc target_desc = _side_by_side_texture != 0 ? _device->get_resource_desc(_side_by_side_texture) : api::resource_desc();
 
 	// Due to rounding errors with the bounds we have to use a tolerance of 1 pixel per eye (2 pixels in total)
@@ -219,8 +299,6 @@ bool reshade::openvr::swapchain_impl::on_vr_submit(api::command_queue *queue, vr
 	if (source_desc.texture.depth_or_layers <= 1)
 		layer = 0;
 
-	const bool is_d3d12 = _device->get_api() == api::device_api::d3d12;
-
 	if (source_desc.texture.samples <= 1)
 	{
 		// In all but D3D12 the eye texture resource is already in copy source state at this point
@@ -50,6 +50,13 @@ namespace reshade::openvr
 		api::resource _side_by_side_texture = {};
 		void *_direct3d_device = nullptr;
 		bool _is_opengl = false;
+		bool _allow_in_place = false;
+		/// <summary>
+		/// Set when <see cref="_side_by_side_texture"/> is the texture the application submitted for both eyes, rather than a copy owned by this swap chain.
+		/// </summary>
+		bool _in_place = false;
+		api::resource _in_place_candidate = {};
+		api::resource _in_place_candidate_left = {};
 		api::color_space _back_buffer_color_space = api::color_space::unknown;
 	};
 }
@@ -7,7 +7,7 @@
 #include "dll_log.hpp"
 #include "addon_manager.hpp"
 #include "runtime_manager.hpp"
-#include <algorithm> // std::max
+#include <algorithm> // std::find, std::max
 
 reshade::openxr::swapchain_impl::swapchain_impl(api::device *device, api::command_queue *graphics_queue, XrSession session) :
 	api_object_impl(session),
@@ -129,15 +129,35 @@ void reshade::openxr::swapchain_impl::on_present(uint32_t view_count, const api:
 
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 
+	// Views of array swap chains all reference layers of the same image, so only transition each distinct image once and do so together with the side-by-side texture in a single batch
+	uint32_t barrier_count = 1;
+	temp_mem<api::resource, 2 + 1> barrier_resources(view_count + 1);
+	temp_mem<api::resource_usage, 2 + 1> barrier_old_states(view_count + 1);
+	temp_mem<api::resource_usage, 2 + 1> barrier_new_states(view_count + 1);
+
+	barrier_resources[0] = _side_by_side_texture;
+	for (uint32_t i = 0; i < view_count; ++i)
+		if (std::find(barrier_resources.p + 1, barrier_resources.p + barrier_count, view_textures[i]) == barrier_resources.p + barrier_count)
+			barrier_resources[barrier_count++] = view_textures[i];
+
+	const auto transition = [&](api::resource_usage side_by_side_old_state, api::resource_usage side_by_side_new_state, api::resource_usage view_old_state, api::resource_usage view_new_state) {
+		barrier_old_states[0] = side_by_side_old_state;
+		barrier_new_states[0] = side_by_side_new_state;
+		for (uint32_t k = 1; k < barrier_count; ++k)
+		{
+			barrier_old_states[k] = view_old_state;
+			barrier_new_states[k] = view_new_state;
+		}
+		cmd_list->barrier(barrier_count, barrier_resources.p, barrier_old_states.p, barrier_new_states.p);
+	};
+
 	// Copy source textures into side-by-side texture
 	const auto before_state = _device->get_api() == api::device_api::d3d12 ? api::resource_usage::shader_resource_pixel : api::resource_usage::copy_source;
 
-	cmd_list->barrier(_side_by_side_texture, api::resource_usage::general, api::resource_usage::copy_dest);
+	transition(api::resource_usage::general, api::resource_usage::copy_dest, before_state, api::resource_usage::copy_source);
 
 	for (uint32_t i = 0; i < view_count; ++i)
 	{
-		cmd_list->barrier(view_textures[i], before_state, api::resource_usage::copy_source);
-
 		const api::subresource_box dest_box = get_view_subresource_box(i, view_count);
 		cmd_list->copy_texture_region(view_textures[i], view_layers[i], &view_boxes[i], _side_by_side_texture, 0, &dest_box, api::filter_mode::min_mag_mip_point);
 	}
@@ -150,19 +170,15 @@ void reshade::openxr::swapchain_impl::on_present(uint32_t view_count, const api:
 
 	present_effect_runtime(this, _graphics_queue);
 
-	cmd_list->barrier(_side_by_side_texture, api::resource_usage::present, api::resource_usage::copy_source);
+	transition(api::resource_usage::present, api::resource_usage::copy_source, api::resource_usage::copy_source, api::resource_usage::copy_dest);
 
 	for (uint32_t i = 0; i < view_count; ++i)
 	{
-		cmd_list->barrier(view_textures[i], api::resource_usage::copy_source, api::resource_usage::copy_dest);
-
 		const api::subresource_box dest_box = get_view_subresource_box(i, view_count);
 		cmd_list->copy_texture_region(_side_by_side_texture, 0, &dest_box, view_textures[i], view_layers[i], &view_boxes[i], api::filter_mode::min_mag_mip_point);
-
-		cmd_list->barrier(view_textures[i], api::resource_usage::copy_dest, before_state);
 	}
 
-	cmd_list->barrier(_side_by_side_texture, api::resource_usage::copy_source, api::resource_usage::general);
+	transition(api::resource_usage::copy_source, api::resource_usage::general, api::resource_usage::copy_dest, before_state);
 
 	_graphics_queue->flush_immediate_command_list();
 }
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pixel_conversion.hpp"
+#include <cstring> // std::memcpy
+#include <intrin.h>
+#include <immintrin.h>
+
+// SSE2 is always available on the supported platforms, SSSE3 and AVX2 are detected at runtime
+enum class simd_level
+{
+	sse2,
+	ssse3,
+	avx2
+};
+
+static simd_level detect_simd_level()
+{
+	int info[4] = {};
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+	if (max_leaf < 1)
+		return simd_level::sse2;
+
+	__cpuidex(info, 1, 0);
+	const bool has_ssse3 = (info[2] & (1 << 9)) != 0;
+	// AVX requires the operating system to save the YMM registers on context switches, which is reported via OSXSAVE and XCR0
+	const bool has_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+	if (has_avx && max_leaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		if ((info[1] & (1 << 5)) != 0)
+			return simd_level::avx2;
+	}
+
+	return has_ssse3 ? simd_level::ssse3 : simd_level::sse2;
+}
+
+static const simd_level s_simd_level = detect_simd_level();
+
+void reshade::utils::swap_red_blue_rgba8(uint8_t *pixels, size_t count, bool force_opaque)
+{
+	const uint32_t alpha = force_opaque ? 0xFF000000 : 0;
+	size_t i = 0;
+
+	if (s_simd_level >= simd_level::avx2)
+	{
+		const __m256i mask_ga = _mm256_set1_epi32(static_cast<int>(0xFF00FF00));
+		const __m256i mask_rb = _mm256_set1_epi32(0x00FF00FF);
+		const __m256i alpha_bits = _mm256_set1_epi32(static_cast<int>(alpha));
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i * 4));
+			const __m256i rb = _mm256_and_si256(v, mask_rb);
+			const __m256i result = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(v, mask_ga), alpha_bits), _mm256_or_si256(_mm256_slli_epi32(rb, 16), _mm256_srli_epi32(rb, 16)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i * 4), result);
+		}
+	}
+
+	{
+		const __m128i mask_ga = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+		const __m128i mask_rb = _mm_set1_epi32(0x00FF00FF);
+		const __m128i alpha_bits = _mm_set1_epi32(static_cast<int>(alpha));
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4));
+			const __m128i rb = _mm_and_si128(v, mask_rb);
+			const __m128i result = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, mask_ga), alpha_bits), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i * 4), result);
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		uint32_t v;
+		std::memcpy(&v, pixels + i * 4, 4);
+		v = (v & 0xFF00FF00) | ((v & 0x000000FF) << 16) | ((v & 0x00FF0000) >> 16) | alpha;
+		std::memcpy(pixels + i * 4, &v, 4);
+	}
+}
+
+void reshade::utils::force_opaque_rgba8(uint8_t *pixels, size_t count)
+{
+	size_t i = 0;
+
+	if (s_simd_level >= simd_level::avx2)
+	{
+		const __m256i alpha_bits = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i * 4));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i * 4), _mm256_or_si256(v, alpha_bits));
+		}
+	}
+
+	{
+		const __m128i alpha_bits = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i * 4), _mm_or_si128(v, alpha_bits));
+		}
+	}
+
+	for (; i < count; ++i)
+		pixels[i * 4 + 3] = 0xFF;
+}
+
+void reshade::utils::strip_alpha_rgba8(uint8_t *pixels, size_t count)
+{
+	size_t i = 0;
+
+	// Each iteration stores a full vector at the output position, of which the last quarter is overwritten again by the next iteration
+	// This never reaches input data that was not read yet, since the output position advances slower than the input position
+	if (s_simd_level >= simd_level::avx2)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		// Move the 12 bytes of the upper lane right after the 12 bytes of the lower lane
+		const __m256i permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i * 4));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i * 3), _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), permute));
+		}
+	}
+
+	if (s_simd_level >= simd_level::ssse3)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i * 3), _mm_shuffle_epi8(v, shuffle));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		pixels[i * 3 + 0] = pixels[i * 4 + 0];
+		pixels[i * 3 + 1] = pixels[i * 4 + 1];
+		pixels[i * 3 + 2] = pixels[i * 4 + 2];
+	}
+}
+
+void reshade::utils::expand_r8_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+
+	{
+		const __m128i zero = _mm_setzero_si128();
+		// Second 16-bit half of every pixel, which is blue = 0 and alpha = 0xFF
+		const __m128i blue_alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+			const __m128i lo = _mm_unpacklo_epi8(v, zero);
+			const __m128i hi = _mm_unpackhi_epi8(v, zero);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 0), _mm_unpacklo_epi16(lo, blue_alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 16), _mm_unpackhi_epi16(lo, blue_alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 32), _mm_unpacklo_epi16(hi, blue_alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 48), _mm_unpackhi_epi16(hi, blue_alpha));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		dst[i * 4 + 0] = src[i];
+		dst[i * 4 + 1] = 0;
+		dst[i * 4 + 2] = 0;
+		dst[i * 4 + 3] = 0xFF;
+	}
+}
+void reshade::utils::expand_rg8_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+
+	{
+		const __m128i blue_alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 0), _mm_unpacklo_epi16(v, blue_alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4 + 16), _mm_unpackhi_epi16(v, blue_alpha));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		dst[i * 4 + 0] = src[i * 2 + 0];
+		dst[i * 4 + 1] = src[i * 2 + 1];
+		dst[i * 4 + 2] = 0;
+		dst[i * 4 + 3] = 0xFF;
+	}
+}
+
+void reshade::utils::convert_rgb10a2_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count, bool swap_red_blue)
+{
+	size_t i = 0;
+
+	// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255), which is the same as keeping the upper 8 bits of every component
+	// Alpha is multiplied by 85 to get 2-bit range (0-3) into 8-bit range
+	if (s_simd_level >= simd_level::avx2)
+	{
+		const __m256i mask_r = _mm256_set1_epi32(0x000000FF);
+		const __m256i mask_g = _mm256_set1_epi32(0x0000FF00);
+		const __m256i mask_b = _mm256_set1_epi32(0x00FF0000);
+		const __m256i alpha_scale = _mm256_set1_epi32(85);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+			const __m256i r = swap_red_blue ? _mm256_and_si256(_mm256_srli_epi32(v, 22), mask_r) : _mm256_and_si256(_mm256_srli_epi32(v, 2), mask_r);
+			const __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_g);
+			const __m256i b = swap_red_blue ? _mm256_and_si256(_mm256_slli_epi32(v, 14), mask_b) : _mm256_and_si256(_mm256_srli_epi32(v, 6), mask_b);
+			const __m256i a = _mm256_slli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(v, 30), alpha_scale), 24);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a)));
+		}
+	}
+
+	{
+		const __m128i mask_r = _mm_set1_epi32(0x000000FF);
+		const __m128i mask_g = _mm_set1_epi32(0x0000FF00);
+		const __m128i mask_b = _mm_set1_epi32(0x00FF0000);
+		// The 2-bit alpha value only occupies the lower 16-bit half of each 32-bit lane, so a 16-bit multiplication is sufficient (SSE2 has no 32-bit one)
+		const __m128i alpha_scale = _mm_set1_epi32(85);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+			const __m128i r = swap_red_blue ? _mm_and_si128(_mm_srli_epi32(v, 22), mask_r) : _mm_and_si128(_mm_srli_epi32(v, 2), mask_r);
+			const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 4), mask_g);
+			const __m128i b = swap_red_blue ? _mm_and_si128(_mm_slli_epi32(v, 14), mask_b) : _mm_and_si128(_mm_srli_epi32(v, 6), mask_b);
+			const __m128i a = _mm_slli_epi32(_mm_mullo_epi16(_mm_srli_epi32(v, 30), alpha_scale), 24);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a)));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		uint32_t rgba;
+		std::memcpy(&rgba, src + i * 4, 4);
+		dst[i * 4 + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
+		dst[i * 4 + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
+		dst[i * 4 + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
+		dst[i * 4 + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
+		if (swap_red_blue)
+		{
+			const uint8_t r = dst[i * 4 + 0];
+			dst[i * 4 + 0] = dst[i * 4 + 2];
+			dst[i * 4 + 2] = r;
+		}
+	}
+}
+
+void reshade::utils::pack_channels_rgba8(uint8_t *pixels, size_t count, unsigned int channels)
+{
+	size_t i = 0;
+
+	// Output position advances slower than the input position, so working in place is safe as long as every iteration reads its whole input before storing
+	if (channels == 1)
+	{
+		const __m128i mask_r = _mm_set1_epi32(0x000000FF);
+
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i v0 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4 + 0)), mask_r);
+			const __m128i v1 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4 + 16)), mask_r);
+			const __m128i v2 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4 + 32)), mask_r);
+			const __m128i v3 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4 + 48)), mask_r);
+			// Values are in 0-255 range, so the saturating packs do not modify them
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+		}
+
+		for (; i < count; ++i)
+			pixels[i] = pixels[i * 4];
+	}
+	else if (channels == 2)
+	{
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4));
+			// Gather the red and green 16-bit halves of all pixels into the lower 64 bits
+			v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+			v = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(pixels + i * 2), v);
+		}
+
+		for (; i < count; ++i)
+		{
+			pixels[i * 2 + 0] = pixels[i * 4 + 0];
+			pixels[i * 2 + 1] = pixels[i * 4 + 1];
+		}
+	}
+}
+void reshade::utils::pack_channels_rgba32f(float *pixels, size_t count, unsigned int channels)
+{
+	size_t i = 0;
+
+	if (channels == 1)
+	{
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 v0 = _mm_loadu_ps(pixels + i * 4 + 0);
+			const __m128 v1 = _mm_loadu_ps(pixels + i * 4 + 4);
+			const __m128 v2 = _mm_loadu_ps(pixels + i * 4 + 8);
+			const __m128 v3 = _mm_loadu_ps(pixels + i * 4 + 12);
+			_mm_storeu_ps(pixels + i, _mm_movelh_ps(_mm_unpacklo_ps(v0, v1), _mm_unpacklo_ps(v2, v3)));
+		}
+
+		for (; i < count; ++i)
+			pixels[i] = pixels[i * 4];
+	}
+	else if (channels == 2)
+	{
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m128 v0 = _mm_loadu_ps(pixels + i * 4 + 0);
+			const __m128 v1 = _mm_loadu_ps(pixels + i * 4 + 4);
+			_mm_storeu_ps(pixels + i * 2, _mm_movelh_ps(v0, v1));
+		}
+
+		for (; i < count; ++i)
+		{
+			pixels[i * 2 + 0] = pixels[i * 4 + 0];
+			pixels[i * 2 + 1] = pixels[i * 4 + 1];
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade::utils
+{
+	/// <summary>
+	/// Swaps the red and blue channels of 8-bit RGBA pixels in place, which converts between RGBA and BGRA.
+	/// </summary>
+	/// <param name="pixels">Pixel data with four bytes per pixel.</param>
+	/// <param name="count">Number of pixels.</param>
+	/// <param name="force_opaque">Set to <see langword="true"/> to also set the alpha channel to 0xFF (e.g. for BGRX data).</param>
+	void swap_red_blue_rgba8(uint8_t *pixels, size_t count, bool force_opaque = false);
+	/// <summary>
+	/// Sets the alpha channel of 8-bit RGBA pixels to 0xFF in place.
+	/// </summary>
+	/// <param name="pixels">Pixel data with four bytes per pixel.</param>
+	/// <param name="count">Number of pixels.</param>
+	void force_opaque_rgba8(uint8_t *pixels, size_t count);
+	/// <summary>
+	/// Removes the alpha channel of 8-bit RGBA pixels in place, so that the first three quarters of the buffer afterwards contain tightly packed RGB pixels.
+	/// </summary>
+	/// <param name="pixels">Pixel data with four bytes per pixel.</param>
+	/// <param name="count">Number of pixels.</param>
+	void strip_alpha_rgba8(uint8_t *pixels, size_t count);
+
+	/// <summary>
+	/// Expands 8-bit single-channel pixels to 8-bit RGBA pixels, with green and blue set to zero and alpha set to 0xFF.
+	/// </summary>
+	void expand_r8_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count);
+	/// <summary>
+	/// Expands 8-bit two-channel pixels to 8-bit RGBA pixels, with blue set to zero and alpha set to 0xFF.
+	/// </summary>
+	void expand_rg8_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count);
+	/// <summary>
+	/// Quantizes 10-bit RGB and 2-bit alpha pixels to 8-bit RGBA pixels.
+	/// </summary>
+	/// <param name="swap_red_blue">Set to <see langword="true"/> if the source data is in BGRA order.</param>
+	void convert_rgb10a2_to_rgba8(const uint8_t *src, uint8_t *dst, size_t count, bool swap_red_blue);
+
+	/// <summary>
+	/// Collapses 8-bit RGBA pixels in place to only keep the first <paramref name="channels"/> components of each pixel.
+	/// </summary>
+	/// <param name="channels">Number of components to keep, either one or two.</param>
+	void pack_channels_rgba8(uint8_t *pixels, size_t count, unsigned int channels);
+	/// <summary>
+	/// Collapses 32-bit floating-point RGBA pixels in place to only keep the first <paramref name="channels"/> components of each pixel.
+	/// </summary>
+	/// <param name="channels">Number of components to keep, either one or two.</param>
+	void pack_channels_rgba32f(float *pixels, size_t count, unsigned int channels);
+}
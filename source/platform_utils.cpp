@@ -131,3 +131,17 @@ void reshade::utils::set_window_transparency(void *window, bool enabled)
 	blur_behind.fEnable = enabled;
 	DwmEnableBlurBehindWindow(GetAncestor(static_cast<HWND>(window), GA_ROOT), &blur_behind);
 }
+
+bool reshade::utils::is_memory_writable(const void *address, size_t size)
+{
+	MEMORY_BASIC_INFORMATION info = {};
+	if (VirtualQuery(address, &info, sizeof(info)) != sizeof(info))
+		return false;
+
+	if (info.State != MEM_COMMIT || (info.Protect & PAGE_GUARD) != 0 ||
+		(info.Protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) == 0)
+		return false;
+
+	// Only accept values that lie completely within the queried region, rather than checking the next region too
+	return static_cast<const char *>(address) + size <= static_cast<const char *>(info.BaseAddress) + info.RegionSize;
+}
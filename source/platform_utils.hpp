@@ -29,4 +29,9 @@ namespace reshade::utils
 	/// Alpha values in the swap chain are only respected when the window is transparent.
 	/// </summary>
 	void set_window_transparency(void *window, bool enabled);
+
+	/// <summary>
+	/// Checks whether the specified range of memory in the current process is committed and can be written to.
+	/// </summary>
+	bool is_memory_writable(const void *address, size_t size);
 }
@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "png_encoder.hpp"
+#include "thread_pool.hpp"
+#include <fpng.h>
+#include <cstring> // std::memcmp
+#include <algorithm> // std::fill, std::fill_n, std::find, std::min
+
+// Strips are only worth it when every one of them still has enough rows for fpng to find matches in
+static constexpr unsigned int min_strip_height = 64;
+static constexpr size_t min_parallel_pixel_count = 512 * 512;
+
+static uint32_t read_uint32_be(const uint8_t *data)
+{
+	return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+static void write_uint32_be(std::vector<uint8_t> &out_data, uint32_t value)
+{
+	out_data.push_back(static_cast<uint8_t>(value >> 24));
+	out_data.push_back(static_cast<uint8_t>(value >> 16));
+	out_data.push_back(static_cast<uint8_t>(value >> 8));
+	out_data.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+	static const struct crc32_table
+	{
+		crc32_table()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : (c >> 1);
+				values[i] = c;
+			}
+		}
+
+		uint32_t values[256];
+	} table;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+/// <summary>
+/// Computes the Adler-32 checksum of two concatenated blocks of data from the checksums of the individual blocks (same as 'adler32_combine' in zlib).
+/// </summary>
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, uint64_t size2)
+{
+	constexpr uint32_t base = 65521;
+
+	const uint32_t rem = static_cast<uint32_t>(size2 % base);
+	uint32_t sum1 = adler1 & 0xFFFF;
+	uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % base);
+	sum1 += (adler2 & 0xFFFF) + base - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+	if (sum1 >= base)
+		sum1 -= base;
+	if (sum1 >= base)
+		sum1 -= base;
+	if (sum2 >= (base << 1))
+		sum2 -= (base << 1);
+	if (sum2 >= base)
+		sum2 -= base;
+	return sum1 | (sum2 << 16);
+}
+
+namespace
+{
+	class bit_reader
+	{
+	public:
+		bit_reader(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+		size_t position() const { return _position; }
+		bool overrun() const { return _position > _size * 8; }
+
+		uint32_t peek(unsigned int count) const
+		{
+			uint32_t value = 0;
+			const size_t offset = _position / 8;
+			for (size_t i = 0; i < 4 && offset + i < _size; ++i)
+				value |= static_cast<uint32_t>(_data[offset + i]) << (8 * i);
+			return (value >> (_position % 8)) & ((1u << count) - 1);
+		}
+		uint32_t read(unsigned int count)
+		{
+			const uint32_t value = peek(count);
+			_position += count;
+			return value;
+		}
+		void skip(size_t count) { _position += count; }
+		void align() { _position = (_position + 7) & ~static_cast<size_t>(7); }
+
+	private:
+		const uint8_t *_data;
+		size_t _size;
+		size_t _position = 0;
+	};
+
+	/// <summary>
+	/// Lookup table for a canonical Huffman code, indexed by the next 15 bits of the stream, with each entry holding the symbol and the length of its code (or zero for invalid codes).
+	/// </summary>
+	class huffman_table
+	{
+	public:
+		huffman_table() : _entries(1 << 15) {}
+
+		bool build(const uint8_t *lengths, unsigned int count)
+		{
+			unsigned int length_count[16] = {};
+			for (unsigned int i = 0; i < count; ++i)
+				length_count[lengths[i]]++;
+			length_count[0] = 0;
+
+			unsigned int next_code[16] = {};
+			for (unsigned int bits = 1, code = 0; bits < 16; ++bits)
+				next_code[bits] = code = (code + length_count[bits - 1]) << 1;
+
+			std::fill(_entries.begin(), _entries.end(), static_cast<uint16_t>(0));
+
+			for (unsigned int symbol = 0; symbol < count; ++symbol)
+			{
+				const unsigned int length = lengths[symbol];
+				if (length == 0)
+					continue;
+
+				const unsigned int code = next_code[length]++;
+				if (code >= (1u << length))
+					return false; // Code is oversubscribed
+
+				// Deflate stores Huffman codes starting with the most significant bit, so reverse them to match the order in which they are read
+				unsigned int reversed_code = 0;
+				for (unsigned int i = 0; i < length; ++i)
+					reversed_code |= ((code >> i) & 1) << (length - 1 - i);
+
+				for (unsigned int i = reversed_code; i < (1u << 15); i += (1u << length))
+					_entries[i] = static_cast<uint16_t>((symbol << 4) | length);
+			}
+
+			return true;
+		}
+
+		bool decode(bit_reader &reader, unsigned int &symbol) const
+		{
+			const uint16_t entry = _entries[reader.peek(15)];
+			if (entry == 0)
+				return false;
+			reader.skip(entry & 0xF);
+			symbol = entry >> 4;
+			return true;
+		}
+
+	private:
+		std::vector<uint16_t> _entries;
+	};
+}
+
+/// <summary>
+/// Walks the blocks of a raw deflate stream without decompressing it, to find the exact bit position at which the stream ends, since that is not recorded anywhere in the stream itself.
+/// </summary>
+static bool find_deflate_stream_end(const uint8_t *data, size_t size, size_t &final_block_bit, size_t &end_bit)
+{
+	static constexpr uint8_t length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint8_t distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static constexpr uint8_t code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	bit_reader reader(data, size);
+	huffman_table literal_table, distance_table;
+
+	for (bool final_block = false; !final_block;)
+	{
+		final_block_bit = reader.position();
+		final_block = reader.read(1) != 0;
+
+		switch (reader.read(2))
+		{
+		case 0: // Stored block
+		{
+			reader.align();
+			const uint32_t length = reader.read(16);
+			if ((length ^ reader.read(16)) != 0xFFFF)
+				return false;
+			reader.skip(static_cast<size_t>(length) * 8);
+			if (reader.overrun())
+				return false;
+			continue;
+		}
+		case 1: // Block compressed with fixed Huffman codes
+		{
+			uint8_t lengths[288 + 32];
+			std::fill_n(lengths, 144, static_cast<uint8_t>(8));
+			std::fill_n(lengths + 144, 112, static_cast<uint8_t>(9));
+			std::fill_n(lengths + 256, 24, static_cast<uint8_t>(7));
+			std::fill_n(lengths + 280, 8, static_cast<uint8_t>(8));
+			std::fill_n(lengths + 288, 32, static_cast<uint8_t>(5));
+			if (!literal_table.build(lengths, 288) || !distance_table.build(lengths + 288, 32))
+				return false;
+			break;
+		}
+		case 2: // Block compressed with dynamic Huffman codes
+		{
+			const unsigned int literal_count = reader.read(5) + 257;
+			const unsigned int distance_count = reader.read(5) + 1;
+			const unsigned int code_length_count = reader.read(4) + 4;
+
+			uint8_t code_lengths[19] = {};
+			for (unsigned int i = 0; i < code_length_count; ++i)
+				code_lengths[code_length_order[i]] = static_cast<uint8_t>(reader.read(3));
+
+			huffman_table code_length_table;
+			if (!code_length_table.build(code_lengths, 19))
+				return false;
+
+			uint8_t lengths[288 + 32] = {};
+			for (unsigned int i = 0; i < literal_count + distance_count;)
+			{
+				unsigned int symbol = 0;
+				if (!code_length_table.decode(reader, symbol))
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[i++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				uint8_t value = 0;
+				unsigned int repeat = 0;
+				if (symbol == 16)
+				{
+					if (i == 0)
+						return false;
+					value = lengths[i - 1];
+					repeat = 3 + reader.read(2);
+				}
+				else if (symbol == 17)
+				{
+					repeat = 3 + reader.read(3);
+				}
+				else
+				{
+					repeat = 11 + reader.read(7);
+				}
+
+				if (i + repeat > literal_count + distance_count)
+					return false;
+				std::fill_n(lengths + i, repeat, value);
+				i += repeat;
+			}
+
+			if (!literal_table.build(lengths, literal_count) || !distance_table.build(lengths + literal_count, distance_count))
+				return false;
+			break;
+		}
+		default:
+			return false;
+		}
+
+		for (unsigned int symbol = 0; symbol != 256;)
+		{
+			if (!literal_table.decode(reader, symbol) || symbol > 285)
+				return false;
+			if (symbol < 256)
+				continue;
+			if (symbol > 256)
+			{
+				reader.skip(length_extra_bits[symbol - 257]);
+
+				unsigned int distance_symbol = 0;
+				if (!distance_table.decode(reader, distance_symbol) || distance_symbol > 29)
+					return false;
+				reader.skip(distance_extra_bits[distance_symbol]);
+			}
+
+			if (reader.overrun())
+				return false;
+		}
+	}
+
+	end_bit = reader.position();
+	return !reader.overrun();
+}
+
+namespace
+{
+	struct png_strip
+	{
+		std::vector<uint8_t> file_data;
+		std::vector<uint8_t> header;
+		std::vector<uint8_t> deflate_data;
+		uint32_t adler = 0;
+		size_t final_block_bit = 0;
+		size_t end_bit = 0;
+	};
+}
+
+/// <summary>
+/// Extracts the header and the raw deflate stream from a PNG file written by fpng.
+/// </summary>
+static bool parse_png_strip(png_strip &strip)
+{
+	static constexpr uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	const std::vector<uint8_t> &data = strip.file_data;
+	if (data.size() < sizeof(signature) || std::memcmp(data.data(), signature, sizeof(signature)) != 0)
+		return false;
+
+	std::vector<uint8_t> zlib_data;
+
+	for (size_t offset = sizeof(signature); offset + 12 <= data.size();)
+	{
+		const uint32_t chunk_size = read_uint32_be(data.data() + offset);
+		if (offset + 12 + chunk_size > data.size())
+			return false;
+
+		const uint8_t *const chunk_type = data.data() + offset + 4;
+		const uint8_t *const chunk_data = chunk_type + 4;
+
+		if (std::memcmp(chunk_type, "IHDR", 4) == 0)
+			strip.header.assign(chunk_data, chunk_data + chunk_size);
+		else if (std::memcmp(chunk_type, "IDAT", 4) == 0)
+			zlib_data.insert(zlib_data.end(), chunk_data, chunk_data + chunk_size);
+
+		offset += 12 + chunk_size;
+	}
+
+	// Zlib stream consists of a two byte header, the raw deflate stream and a four byte Adler-32 checksum of the uncompressed data
+	if (strip.header.size() != 13 || zlib_data.size() < 6 || (zlib_data[0] & 0xF) != 8)
+		return false;
+
+	strip.adler = read_uint32_be(zlib_data.data() + zlib_data.size() - 4);
+	strip.deflate_data.assign(zlib_data.begin() + 2, zlib_data.end() - 4);
+
+	return find_deflate_stream_end(strip.deflate_data.data(), strip.deflate_data.size(), strip.final_block_bit, strip.end_bit);
+}
+
+static void write_png_chunk(std::vector<uint8_t> &out_data, const char type[4], const uint8_t *data, size_t size)
+{
+	write_uint32_be(out_data, static_cast<uint32_t>(size));
+	const size_t type_offset = out_data.size();
+	out_data.insert(out_data.end(), type, type + 4);
+	out_data.insert(out_data.end(), data, data + size);
+	write_uint32_be(out_data, crc32(out_data.data() + type_offset, 4 + size));
+}
+
+bool reshade::utils::encode_png(thread_pool &pool, const void *pixels, unsigned int width, unsigned int height, unsigned int channels, std::vector<uint8_t> &out_data)
+{
+	size_t strip_count = height / min_strip_height;
+	if (strip_count > pool.size() + 1) // The calling thread takes part in the work too
+		strip_count = pool.size() + 1;
+
+	if (strip_count < 2 || static_cast<size_t>(width) * height < min_parallel_pixel_count)
+		return fpng::fpng_encode_image_to_memory(pixels, width, height, channels, out_data);
+
+	const unsigned int strip_height = static_cast<unsigned int>((height + strip_count - 1) / strip_count);
+	strip_count = (height + strip_height - 1) / strip_height;
+
+	const size_t row_pitch = static_cast<size_t>(width) * channels;
+
+	// Each strip is encoded as its own image, which works because fpng never filters the first row of an image against a previous one
+	std::vector<png_strip> strips(strip_count);
+	std::vector<uint8_t> strip_succeeded(strip_count, false);
+	pool.parallel_for(thread_pool::priority::low, strip_count, [&](size_t i) {
+		const unsigned int y = static_cast<unsigned int>(i) * strip_height;
+		const unsigned int rows = std::min(strip_height, height - y);
+
+		strip_succeeded[i] =
+			fpng::fpng_encode_image_to_memory(static_cast<const uint8_t *>(pixels) + y * row_pitch, width, rows, channels, strips[i].file_data) &&
+			parse_png_strip(strips[i]);
+
+		strips[i].file_data.clear();
+		strips[i].file_data.shrink_to_fit();
+	});
+
+	if (std::find(strip_succeeded.begin(), strip_succeeded.end(), static_cast<uint8_t>(false)) != strip_succeeded.end())
+		return fpng::fpng_encode_image_to_memory(pixels, width, height, channels, out_data);
+
+	// Stitch the raw deflate streams of all strips together into a single zlib stream
+	std::vector<uint8_t> zlib_data;
+	size_t zlib_size = 2 + 4;
+	for (const png_strip &strip : strips)
+		zlib_size += strip.deflate_data.size() + 5;
+	zlib_data.reserve(zlib_size);
+
+	zlib_data.push_back(0x78);
+	zlib_data.push_back(0x01);
+
+	uint32_t adler = 1;
+
+	for (size_t i = 0; i < strip_count; ++i)
+	{
+		png_strip &strip = strips[i];
+		const bool last_strip = (i == strip_count - 1);
+
+		// Clear the final block flag of every strip but the last, so that decoding continues with the next strip
+		if (!last_strip)
+			strip.deflate_data[strip.final_block_bit / 8] &= ~(1u << (strip.final_block_bit % 8));
+
+		const size_t offset = zlib_data.size();
+		zlib_data.insert(zlib_data.end(), strip.deflate_data.begin(), strip.deflate_data.begin() + (strip.end_bit + 7) / 8);
+		// Clear any padding after the end of the stream, so that it can be reused for the header of the block below
+		if (const size_t used_bits = strip.end_bit % 8; used_bits != 0)
+			zlib_data[offset + strip.end_bit / 8] &= static_cast<uint8_t>((1u << used_bits) - 1);
+
+		if (!last_strip)
+		{
+			// Append an empty stored block (like a sync flush in zlib), which pads the stream to a byte boundary, so that the next strip can be appended as is
+			// The three header bits of that block are all zero, which fit into the padding of the last byte if there is enough of it left
+			if (const size_t used_bits = strip.end_bit % 8; used_bits == 0 || used_bits > 5)
+				zlib_data.push_back(0);
+			zlib_data.push_back(0x00);
+			zlib_data.push_back(0x00);
+			zlib_data.push_back(0xFF);
+			zlib_data.push_back(0xFF);
+		}
+
+		// Every row of filtered image data is prefixed with a byte specifying the filter type
+		const unsigned int rows = std::min(strip_height, height - static_cast<unsigned int>(i) * strip_height);
+		adler = adler32_combine(adler, strip.adler, static_cast<uint64_t>(rows) * (1 + row_pitch));
+
+		strip.deflate_data.clear();
+		strip.deflate_data.shrink_to_fit();
+	}
+
+	write_uint32_be(zlib_data, adler);
+
+	std::vector<uint8_t> &header = strips[0].header;
+	header[4] = static_cast<uint8_t>(height >> 24);
+	header[5] = static_cast<uint8_t>(height >> 16);
+	header[6] = static_cast<uint8_t>(height >> 8);
+	header[7] = static_cast<uint8_t>(height);
+
+	static constexpr uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	out_data.clear();
+	out_data.reserve(sizeof(signature) + 25 + zlib_data.size() + 12 + 12);
+	out_data.insert(out_data.end(), signature, signature + sizeof(signature));
+	write_png_chunk(out_data, "IHDR", header.data(), header.size());
+	write_png_chunk(out_data, "IDAT", zlib_data.data(), zlib_data.size());
+	write_png_chunk(out_data, "IEND", nullptr, 0);
+
+	return true;
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace reshade
+{
+	class thread_pool;
+}
+
+namespace reshade::utils
+{
+	/// <summary>
+	/// Encodes an 8-bit image to a PNG file in memory using fpng.
+	/// Large images are split into horizontal strips that are compressed in parallel on the specified thread pool, and then stitched back together into a single deflate stream.
+	/// </summary>
+	/// <param name="pool">Thread pool to compress the strips on. This may be called from a task running in this pool.</param>
+	/// <param name="pixels">Tightly packed pixel data.</param>
+	/// <param name="width">Width of the image in pixels.</param>
+	/// <param name="height">Height of the image in pixels.</param>
+	/// <param name="channels">Number of components per pixel, either three or four.</param>
+	/// <param name="out_data">Vector that is filled with the encoded PNG file.</param>
+	bool encode_png(thread_pool &pool, const void *pixels, unsigned int width, unsigned int height, unsigned int channels, std::vector<uint8_t> &out_data);
+}
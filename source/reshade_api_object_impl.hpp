@@ -6,11 +6,18 @@
 #pragma once
 
 #include "reshade_api_device.hpp"
+#include <atomic>
 #include <cassert>
+#include <cstring> // std::memcmp, std::memcpy
+#include <algorithm> // std::all_of
 #include <unordered_map>
 
 namespace reshade::api
 {
+	// GUIDs registered via 'ReShadeRegisterPrivateDataSlot', whose private data is stored in the slot with the same index instead of the map
+	extern std::atomic<uint32_t> g_num_private_data_slots;
+	extern uint8_t g_private_data_slot_guids[api_object::max_private_data_slots][16];
+
 	template <typename T, typename... api_object_base>
 	class api_object_impl : public api_object_base...
 	{
@@ -56,6 +63,12 @@ namespace reshade::api
 		{
 			assert(data != nullptr);
 
+			if (const uint32_t slot = find_private_data_slot(guid); slot < max_private_data_slots)
+			{
+				*data = _private_data_slots[slot];
+				return;
+			}
+
 			if (const auto it = _private_data.find(*reinterpret_cast<const guid_t *>(guid));
 				it != _private_data.end())
 				*data = it->second;
@@ -64,6 +77,12 @@ namespace reshade::api
 		}
 		void set_private_data(const uint8_t guid[16], const uint64_t data)  final
 		{
+			if (const uint32_t slot = find_private_data_slot(guid); slot < max_private_data_slots)
+			{
+				_private_data_slots[slot] = data;
+				return;
+			}
+
 			if (data != 0)
 				_private_data[*reinterpret_cast<const guid_t *>(guid)] = data;
 			else
@@ -81,9 +100,34 @@ namespace reshade::api
 		{
 			// All user data should ideally have been removed before destruction, to avoid leaks
 			assert(_private_data.empty());
+			assert(std::all_of(std::begin(_private_data_slots), std::end(_private_data_slots), [](uint64_t data) { return data == 0; }));
 		}
 
 	private:
+		/// <summary>
+		/// Gets the index of the private data slot identified by the specified key, which is either a reserved slot key (see <see cref="api_object::get_private_data_slot"/>) or a GUID registered for a slot.
+		/// </summary>
+		/// <returns>Index of the slot, or <see cref="api_object::max_private_data_slots"/> if the key does not identify one.</returns>
+		static uint32_t find_private_data_slot(const uint8_t guid[16])
+		{
+			uint32_t key[4];
+			std::memcpy(key, guid, sizeof(key));
+
+			if (key[0] == private_data_slot_key[0] && key[1] == private_data_slot_key[1] && key[2] == private_data_slot_key[2])
+			{
+				assert(key[3] < max_private_data_slots);
+				return key[3] < max_private_data_slots ? key[3] : max_private_data_slots;
+			}
+
+			const uint32_t num_slots = g_num_private_data_slots.load(std::memory_order_acquire);
+			for (uint32_t slot = 0; slot < num_slots; ++slot)
+				if (std::memcmp(g_private_data_slot_guids[slot], guid, 16) == 0)
+					return slot;
+
+			return max_private_data_slots;
+		}
+
+		uint64_t _private_data_slots[max_private_data_slots] = {};
 		std::unordered_map<guid_t, uint64_t, typename guid_t::hash, typename guid_t::equal> _private_data;
 	};
 }
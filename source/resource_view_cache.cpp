@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "resource_view_cache.hpp"
+#include <cassert>
+
+reshade::resource_view_cache::~resource_view_cache()
+{
+	// All views should have been released by their users at this point, but do not leak them if that is not the case
+	assert(_views.empty());
+
+	for (const auto &view_data : _views)
+		_device->destroy_resource_view(view_data.second.view);
+}
+
+bool reshade::resource_view_cache::create_resource_view(api::resource resource, api::resource_usage usage_type, const api::resource_view_desc &desc, api::resource_view *out_view)
+{
+	const view_key key = { resource, usage_type, desc };
+
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	if (const auto it = _views.find(key); it != _views.end())
+	{
+		it->second.ref_count++;
+		*out_view = it->second.view;
+		return true;
+	}
+
+	if (!_device->create_resource_view(resource, usage_type, desc, out_view))
+	{
+		*out_view = { 0 };
+		return false;
+	}
+
+	_views.emplace(key, view_entry { *out_view, 1 });
+	_view_keys.emplace(out_view->handle, key);
+	return true;
+}
+void reshade::resource_view_cache::destroy_resource_view(api::resource_view view)
+{
+	if (view == 0)
+		return;
+
+	const std::unique_lock<std::mutex> lock(_mutex);
+
+	const auto key_it = _view_keys.find(view.handle);
+	if (key_it == _view_keys.end())
+	{
+		assert(false); // View was not created through this cache
+		return;
+	}
+
+	const auto it = _views.find(key_it->second);
+	assert(it != _views.end() && it->second.ref_count != 0);
+
+	if (--it->second.ref_count != 0)
+		return;
+
+	_device->destroy_resource_view(view);
+
+	_views.erase(it);
+	_view_keys.erase(key_it);
+}
+
+bool reshade::resource_view_cache::view_key::operator==(const view_key &other) const
+{
+	if (resource != other.resource || usage_type != other.usage_type || desc.type != other.desc.type || desc.format != other.desc.format)
+		return false;
+
+	if (desc.type == api::resource_view_type::buffer || desc.type == api::resource_view_type::acceleration_structure)
+		return desc.buffer.offset == other.desc.buffer.offset && desc.buffer.size == other.desc.buffer.size;
+	else
+		return desc.texture.first_level == other.desc.texture.first_level && desc.texture.level_count == other.desc.texture.level_count && desc.texture.first_layer == other.desc.texture.first_layer && desc.texture.layer_count == other.desc.texture.layer_count;
+}
+
+size_t reshade::resource_view_cache::view_key_hash::operator()(const view_key &key) const
+{
+	// Texture and buffer description occupy the same bytes, so hashing the buffer members covers both
+	size_t hash = std::hash<uint64_t>()(key.resource.handle);
+	hash ^= std::hash<uint64_t>()((static_cast<uint64_t>(key.usage_type) << 48) ^ (static_cast<uint64_t>(key.desc.type) << 32) ^ static_cast<uint64_t>(key.desc.format)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<uint64_t>()(key.desc.buffer.offset) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<uint64_t>()(key.desc.buffer.size) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
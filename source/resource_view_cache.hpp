@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "reshade_api_device.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// Reference counted cache of resource views, so that identical views of the same resource (e.g. the linear and sRGB views of a texture whose format has no sRGB variant) are only created once per device.
+	/// Views are addressed by the resource, usage and view description they were created with, and are only destroyed once every reference to them was released again.
+	/// </summary>
+	class resource_view_cache
+	{
+	public:
+		explicit resource_view_cache(api::device *device) : _device(device) {}
+		~resource_view_cache();
+
+		resource_view_cache(const resource_view_cache &) = delete;
+		resource_view_cache &operator=(const resource_view_cache &) = delete;
+
+		/// <summary>
+		/// Returns an existing view of the <paramref name="resource"/> matching the specified <paramref name="usage_type"/> and <paramref name="desc"/>, or creates a new one.
+		/// Every successful call has to be paired with a call to <see cref="destroy_resource_view"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if a view was found or created successfully, <see langword="false"/> otherwise (in which case <paramref name="out_view"/> is set to zero).</returns>
+		bool create_resource_view(api::resource resource, api::resource_usage usage_type, const api::resource_view_desc &desc, api::resource_view *out_view);
+		/// <summary>
+		/// Releases a reference to a view returned by <see cref="create_resource_view"/>, destroying it once no references are left.
+		/// </summary>
+		void destroy_resource_view(api::resource_view view);
+
+	private:
+		struct view_key
+		{
+			api::resource resource;
+			api::resource_usage usage_type;
+			api::resource_view_desc desc;
+
+			bool operator==(const view_key &other) const;
+		};
+		struct view_key_hash
+		{
+			size_t operator()(const view_key &key) const;
+		};
+		struct view_entry
+		{
+			api::resource_view view;
+			uint32_t ref_count;
+		};
+
+		api::device *const _device;
+		std::mutex _mutex;
+		std::unordered_map<view_key, view_entry, view_key_hash> _views;
+		std::unordered_map<uint64_t, view_key> _view_keys;
+	};
+}
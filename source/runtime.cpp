@@ -8,6 +8,7 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_serialization.hpp"
 #include "version.h"
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
@@ -17,17 +18,28 @@
 #include "input_gamepad.hpp"
 #include "com_ptr.hpp"
 #include "platform_utils.hpp"
+#include "pixel_conversion.hpp"
+#include "block_compression.hpp"
+#include "png_encoder.hpp"
 #include "reshade_api_object_impl.hpp"
+#include "thread_pool.hpp"
+#include "file_watcher.hpp"
+#include "effect_cache.hpp"
+#include "resource_view_cache.hpp"
+#include "telemetry.hpp"
+#include "startup_trace.hpp"
 #include <set>
+#include <unordered_set>
 #include <thread>
-#include <cmath> // std::abs, std::fmod
+#include <condition_variable>
+#include <cmath> // std::abs, std::fmod, std::sqrt
 #include <cctype> // std::toupper
 #include <cwctype> // std::towlower
 #include <cstdio> // std::snprintf
-#include <cstdlib> // std::malloc, std::rand, std::strtod, std::strtol
-#include <cstring> // std::memcpy, std::memset, std::strlen
+#include <cstdlib> // std::malloc, std::rand, std::strtod, std::strtol, std::strtoul
+#include <cstring> // std::memcpy, std::memset, std::strchr, std::strlen
 #include <charconv> // std::to_chars
-#include <algorithm> // std::all_of, std::copy_n, std::equal, std::fill_n, std::find, std::find_if, std::for_each, std::max, std::min, std::replace, std::remove, std::remove_if, std::reverse, std::search, std::set_symmetric_difference, std::sort, std::stable_sort, std::swap, std::transform
+#include <algorithm> // std::all_of, std::any_of, std::clamp, std::copy_n, std::equal, std::fill_n, std::find, std::find_if, std::for_each, std::max, std::min, std::replace, std::remove, std::remove_if, std::reverse, std::search, std::set_symmetric_difference, std::sort, std::stable_sort, std::swap, std::transform
 #include <fpng.h>
 #include <stb_image.h>
 #include <stb_image_dds.h>
@@ -36,6 +48,12 @@
 #include <d3dcompiler.h>
 #include <sk_hdr_png.hpp>
 
+#ifdef RESHADE_TEST_APPLICATION
+// Options of the regression harness (see 'runtime_regression.cpp'), which are set from the command line of the test application
+extern std::filesystem::path g_regression_path;
+extern std::filesystem::path g_regression_preset_path;
+#endif
+
 bool resolve_path(std::filesystem::path &path, std::error_code &ec)
 {
 	// First convert path to an absolute path
@@ -123,7 +141,76 @@ static bool find_file(const std::vector<std::filesystem::path> &search_paths, st
 
 	return false;
 }
-static std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions)
+struct directory_listing
+{
+	std::filesystem::file_time_type modified_at;
+	std::vector<std::filesystem::path> file_names;
+	std::vector<std::filesystem::path> directory_names;
+};
+
+static void load_directory_manifest(const std::filesystem::path &manifest_path, std::unordered_map<std::wstring, directory_listing> &manifest)
+{
+	FILE *const file = _wfsopen(manifest_path.c_str(), L"rb", SH_DENYWR);
+	if (file == nullptr)
+		return;
+
+	std::string data;
+	std::fseek(file, 0, SEEK_END);
+	if (const long file_size = std::ftell(file); file_size > 0)
+		data.resize(static_cast<size_t>(file_size));
+	std::fseek(file, 0, SEEK_SET);
+	data.resize(std::fread(data.data(), 1, data.size(), file));
+	std::fclose(file);
+
+	// Each line describes one directory as "<path>\t<modification time>\t<F|D><name>\t...", which works since tabs are not allowed in file names on Windows
+	for (size_t line_offset = 0, line_end; line_offset < data.size(); line_offset = line_end + 1)
+	{
+		if ((line_end = data.find('\n', line_offset)) == std::string::npos)
+			line_end = data.size();
+
+		const std::string_view line(data.data() + line_offset, line_end - line_offset);
+		const size_t path_end = line.find('\t');
+		const size_t modified_at_end = line.find('\t', path_end + 1);
+		if (path_end == std::string_view::npos || modified_at_end == std::string_view::npos)
+			continue;
+
+		directory_listing &listing = manifest[std::filesystem::u8path(line.substr(0, path_end)).native()];
+		listing.modified_at = std::filesystem::file_time_type(std::filesystem::file_time_type::duration(std::strtoll(std::string(line.substr(path_end + 1, modified_at_end - path_end - 1)).c_str(), nullptr, 10)));
+
+		for (size_t name_offset = modified_at_end + 1, name_end; name_offset < line.size(); name_offset = name_end + 1)
+		{
+			if ((name_end = line.find('\t', name_offset)) == std::string_view::npos)
+				name_end = line.size();
+			if (name_end - name_offset < 2)
+				continue;
+
+			(line[name_offset] == 'D' ? listing.directory_names : listing.file_names).push_back(std::filesystem::u8path(line.substr(name_offset + 1, name_end - name_offset - 1)));
+		}
+	}
+}
+static void save_directory_manifest(const std::filesystem::path &manifest_path, const std::unordered_map<std::wstring, directory_listing> &manifest)
+{
+	std::string data;
+	for (const std::pair<const std::wstring, directory_listing> &entry : manifest)
+	{
+		data += std::filesystem::path(entry.first).u8string();
+		data += '\t';
+		data += std::to_string(entry.second.modified_at.time_since_epoch().count());
+		for (const std::filesystem::path &name : entry.second.file_names)
+			data += "\tF" + name.u8string();
+		for (const std::filesystem::path &name : entry.second.directory_names)
+			data += "\tD" + name.u8string();
+		data += '\n';
+	}
+
+	FILE *const file = _wfsopen(manifest_path.c_str(), L"wb", SH_DENYWR);
+	if (file == nullptr)
+		return;
+	std::fwrite(data.data(), 1, data.size(), file);
+	std::fclose(file);
+}
+
+static std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions, const std::filesystem::path &manifest_path = {})
 {
 	std::error_code ec;
 	std::vector<std::filesystem::path> files;
@@ -153,26 +240,257 @@ static std::vector<std::filesystem::path> find_files(const std::vector<std::file
 		}
 	}
 
-	// Then iterate through all files in those search paths and add those with a matching extension
-	const auto check_and_add_file = [&extensions, &ec, &files](const std::filesystem::directory_entry &entry) {
-		if (!entry.is_directory(ec) &&
-			std::find(extensions.begin(), extensions.end(), entry.path().extension()) != extensions.end())
-			files.emplace_back(entry); // Construct path from directory entry in-place
+	// Listings from a previous run can be reused for all directories that were not modified since, which avoids enumerating unchanged trees again
+	// The modification time of a directory changes whenever an entry is added to, removed from or renamed in it, but not when one of its subdirectories changes, so every directory is still checked individually
+	std::unordered_map<std::wstring, directory_listing> manifest, new_manifest;
+	if (!manifest_path.empty())
+		load_directory_manifest(manifest_path, manifest);
+	bool manifest_modified = false;
+
+	// Then iterate through all directories in those search paths in parallel and add files with a matching extension
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::pair<std::filesystem::path, bool>> pending_directories = resolved_search_paths;
+	size_t num_busy_threads = 0;
+
+	const auto worker = [&]() {
+		std::error_code worker_ec;
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			condition.wait(lock, [&]() { return !pending_directories.empty() || num_busy_threads == 0; });
+			if (pending_directories.empty())
+				break;
+
+			const std::pair<std::filesystem::path, bool> directory = std::move(pending_directories.back());
+			pending_directories.pop_back();
+			num_busy_threads++;
+
+			lock.unlock();
+
+			directory_listing listing;
+			listing.modified_at = std::filesystem::last_write_time(directory.first, worker_ec);
+
+			bool cached = false;
+			// The old manifest is not modified while workers are running, so can be read without a lock
+			if (const auto it = manifest.find(directory.first.native());
+				!worker_ec && it != manifest.end() && it->second.modified_at == listing.modified_at)
+			{
+				listing = it->second;
+				cached = true;
+			}
+			else
+			{
+				for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory.first, std::filesystem::directory_options::skip_permission_denied, worker_ec))
+				{
+					// Do not follow symbolic links to directories, same as 'std::filesystem::recursive_directory_iterator'
+					if (entry.is_directory(worker_ec))
+					{
+						if (!entry.is_symlink(worker_ec))
+							listing.directory_names.push_back(entry.path().filename());
+					}
+					else if (std::find(extensions.begin(), extensions.end(), entry.path().extension()) != extensions.end())
+					{
+						listing.file_names.push_back(entry.path().filename());
+					}
+				}
+			}
+
+			lock.lock();
+
+			for (const std::filesystem::path &file_name : listing.file_names)
+				files.push_back(directory.first / file_name);
+			if (directory.second)
+				for (const std::filesystem::path &directory_name : listing.directory_names)
+					pending_directories.emplace_back(directory.first / directory_name, true);
+
+			manifest_modified |= !cached;
+			new_manifest[directory.first.native()] = std::move(listing);
+
+			num_busy_threads--;
+			condition.notify_all();
+		}
 	};
 
-	for (const std::pair<std::filesystem::path, bool> &resolved_search_path : resolved_search_paths)
+	std::vector<std::thread> threads(std::clamp(std::thread::hardware_concurrency(), 1u, 8u) - 1);
+	for (std::thread &thread : threads)
+		thread = std::thread(worker);
+	worker();
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Directories that no longer exist or are no longer searched are dropped from the manifest as well
+	if (!manifest_path.empty() && (manifest_modified || new_manifest.size() != manifest.size()))
+		save_directory_manifest(manifest_path, new_manifest);
+
+	// Sort files, since the order in which the threads found them is not deterministic
+	std::sort(files.begin(), files.end());
+
+	return files;
+}
+
+/// <summary>
+/// Adds the CPU time elapsed during its lifetime to the referenced duration (in nanoseconds).
+/// </summary>
+static size_t compute_dependency_hash(const std::filesystem::path &source_file, const std::vector<std::filesystem::path> &included_files)
+{
+	std::error_code ec;
+	std::string timestamps = std::to_string(std::filesystem::last_write_time(source_file, ec).time_since_epoch().count());
+	for (const std::filesystem::path &included_file : included_files)
 	{
-		if (resolved_search_path.second)
-			for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(resolved_search_path.first, std::filesystem::directory_options::skip_permission_denied, ec))
-				check_and_add_file(entry);
-		else
-			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(resolved_search_path.first, std::filesystem::directory_options::skip_permission_denied, ec))
-				check_and_add_file(entry);
+		timestamps += ';';
+		timestamps += std::to_string(std::filesystem::last_write_time(included_file, ec).time_since_epoch().count());
 	}
 
-	return files;
+	return std::hash<std::string>()(timestamps);
+}
+
+static void build_specialization_constants(const reshadefx::effect_module &module, std::vector<uint32_t> &spec_constants, std::vector<uint32_t> &spec_data)
+{
+	spec_constants.clear();
+	spec_data.clear();
+
+	for (const reshadefx::uniform &spec_constant : module.spec_constants)
+	{
+		uint32_t id = static_cast<uint32_t>(spec_constants.size());
+		spec_data.push_back(spec_constant.initializer_value.as_uint[0]);
+		spec_constants.push_back(id);
+	}
+}
+
+static std::string serialize_shared_effect_module(const reshade::shared_effect_module &shared_module)
+{
+	std::string data;
+	reshadefx::binary_writer writer(data);
+
+	reshadefx::write_module(writer, shared_module.module);
+	writer.write_string(shared_module.generated_code);
+	writer.write(static_cast<uint32_t>(shared_module.entry_point_code.size()));
+	for (const std::pair<const std::string, std::string> &entry_point_code : shared_module.entry_point_code)
+	{
+		writer.write_string(entry_point_code.first);
+		writer.write_string(entry_point_code.second);
+	}
+	writer.write_string(shared_module.code_preamble);
+	writer.write(shared_module.skip_optimization);
+	writer.write_string(shared_module.errors);
+	writer.write(static_cast<uint32_t>(shared_module.included_files.size()));
+	for (const std::filesystem::path &included_file : shared_module.included_files)
+		writer.write_string(included_file.u8string());
+	writer.write(static_cast<uint32_t>(shared_module.definitions.size()));
+	for (const std::pair<std::string, std::string> &definition : shared_module.definitions)
+	{
+		writer.write_string(definition.first);
+		writer.write_string(definition.second);
+	}
+
+	return data;
+}
+static bool deserialize_shared_effect_module(std::string_view data, reshade::shared_effect_module &shared_module)
+{
+	reshadefx::binary_reader reader(data);
+
+	uint32_t count = 0;
+	if (!reshadefx::read_module(reader, shared_module.module) ||
+		!reader.read_string(shared_module.generated_code) ||
+		!reader.read_count(count))
+		return false;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		std::string entry_point_name;
+		if (!reader.read_string(entry_point_name) || !reader.read_string(shared_module.entry_point_code[entry_point_name]))
+			return false;
+	}
+	if (!reader.read_string(shared_module.code_preamble) ||
+		!reader.read(shared_module.skip_optimization) ||
+		!reader.read_string(shared_module.errors) ||
+		!reader.read_count(count))
+		return false;
+	shared_module.included_files.resize(count);
+	for (std::filesystem::path &included_file : shared_module.included_files)
+	{
+		std::string included_file_string;
+		if (!reader.read_string(included_file_string))
+			return false;
+		included_file = std::filesystem::u8path(included_file_string);
+	}
+	if (!reader.read_count(count))
+		return false;
+	shared_module.definitions.resize(count);
+	for (std::pair<std::string, std::string> &definition : shared_module.definitions)
+		if (!reader.read_string(definition.first) || !reader.read_string(definition.second))
+			return false;
+
+	// Every entry point needs its code, since the module is used in place of a code generator
+	for (const std::pair<std::string, reshadefx::shader_type> &entry_point : shared_module.module.entry_points)
+		if (shared_module.entry_point_code.find(entry_point.first) == shared_module.entry_point_code.end())
+			return false;
+
+	return reader.at_end();
+}
+
+static reshade::special_uniform_binding create_special_uniform_binding(const reshade::uniform &variable, size_t uniform_index)
+{
+	reshade::special_uniform_binding binding;
+	binding.type = variable.special;
+	binding.uniform_index = uniform_index;
+
+	switch (variable.special)
+	{
+	case reshade::special_uniform::random:
+		binding.min_int = variable.annotation_as_int("min", 0, 0);
+		binding.max_int = variable.annotation_as_int("max", 0, RAND_MAX);
+		break;
+	case reshade::special_uniform::ping_pong:
+		binding.min = variable.annotation_as_float("min", 0, 0.0f);
+		binding.max = variable.annotation_as_float("max", 0, 1.0f);
+		binding.step[0] = variable.annotation_as_float("step", 0);
+		binding.step[1] = variable.annotation_as_float("step", 1);
+		binding.smoothing = variable.annotation_as_float("smoothing");
+		break;
+	case reshade::special_uniform::key:
+	case reshade::special_uniform::mouse_button:
+		binding.keycode = variable.annotation_as_int("keycode");
+		if (const std::string_view mode = variable.annotation_as_string("mode");
+			mode == "toggle" || variable.annotation_as_int("toggle"))
+			binding.mode = reshade::special_uniform_binding::input_mode::toggle;
+		else if (mode == "press")
+			binding.mode = reshade::special_uniform_binding::input_mode::press;
+		// Keep key codes outside the supported range disabled
+		if (variable.special == reshade::special_uniform::key ? (binding.keycode <= 7 || binding.keycode >= 256) : (binding.keycode < 0 || binding.keycode >= 5))
+			binding.type = reshade::special_uniform::none;
+		break;
+	case reshade::special_uniform::mouse_wheel:
+		binding.min = variable.annotation_as_float("min");
+		binding.max = variable.annotation_as_float("max");
+		binding.step[0] = variable.annotation_as_float("step");
+		if (binding.step[0] == 0.0f)
+			binding.step[0] = 1.0f;
+		break;
+	}
+
+	return binding;
 }
 
+struct scoped_present_stage_timer
+{
+	explicit scoped_present_stage_timer(uint64_t &duration) :
+		duration(duration), start(std::chrono::high_resolution_clock::now()) {}
+	~scoped_present_stage_timer()
+	{
+		duration += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	uint64_t &duration;
+	const std::chrono::high_resolution_clock::time_point start;
+};
+
+static std::mutex s_shared_effect_module_caches_mutex;
+static std::unordered_map<reshade::api::device *, std::weak_ptr<reshade::shared_effect_module_cache>> s_shared_effect_module_caches;
+static std::mutex s_resource_view_caches_mutex;
+static std::unordered_map<reshade::api::device *, std::weak_ptr<reshade::resource_view_cache>> s_resource_view_caches;
+
 reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphics_queue, const std::filesystem::path &config_path, bool is_vr) :
 	_swapchain(swapchain),
 	_device(swapchain->get_device()),
@@ -234,15 +552,53 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 	std::error_code ec;
 	resolve_path(_config_path, ec);
 
+	_effect_cache = std::make_unique<effect_cache>();
+
+	// Share the results of preprocessing and parsing effects with all other runtimes on the same device (e.g. the desktop mirror and the eyes in VR, or additional swap chains)
+	{ const std::unique_lock<std::mutex> lock(s_shared_effect_module_caches_mutex);
+		std::weak_ptr<shared_effect_module_cache> &shared_cache = s_shared_effect_module_caches[_device];
+		_shared_effect_modules = shared_cache.lock();
+		if (_shared_effect_modules == nullptr)
+			shared_cache = _shared_effect_modules = std::make_shared<shared_effect_module_cache>();
+	}
+
+	// Share identical resource views with all other runtimes on the same device as well
+	{ const std::unique_lock<std::mutex> lock(s_resource_view_caches_mutex);
+		std::weak_ptr<resource_view_cache> &shared_cache = s_resource_view_caches[_device];
+		_resource_views = shared_cache.lock();
+		if (_resource_views == nullptr)
+			shared_cache = _resource_views = std::make_shared<resource_view_cache>(_device);
+	}
+
 	load_config();
 
+	// Worker count is only read once, since the pool is kept alive for the lifetime of the runtime
+	_worker_pool = std::make_unique<thread_pool>(_worker_thread_count);
+
 	fpng::fpng_init();
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	// Wait for any remaining screenshot or cache writes before destroying the pool
+	_worker_pool.reset();
 	assert(!_is_initialized && _techniques.empty() && _technique_sorting.empty());
 
+	if (_frame_limit_timer != nullptr)
+		CloseHandle(static_cast<HANDLE>(_frame_limit_timer));
+
+	{ const std::unique_lock<std::mutex> lock(s_shared_effect_module_caches_mutex);
+		_shared_effect_modules.reset();
+		if (const auto it = s_shared_effect_module_caches.find(_device);
+			it != s_shared_effect_module_caches.end() && it->second.expired())
+			s_shared_effect_module_caches.erase(it);
+	}
+	{ const std::unique_lock<std::mutex> lock(s_resource_view_caches_mutex);
+		_resource_views.reset();
+		if (const auto it = s_resource_view_caches.find(_device);
+			it != s_resource_view_caches.end() && it->second.expired())
+			s_resource_view_caches.erase(it);
+	}
+
 #if RESHADE_GUI
 	// Save configuration before shutting down to ensure the current window state is written to disk
 	save_config();
@@ -256,6 +612,8 @@ bool reshade::runtime::on_init()
 {
 	assert(!_is_initialized);
 
+	const startup_trace::scoped_span trace_span("runtime::on_init");
+
 	const api::resource_desc back_buffer_desc = _device->get_resource_desc(get_back_buffer(0));
 
 	// Avoid initializing on very small swap chains (e.g. implicit swap chain in The Sims 4, which is not used to present in windowed mode)
@@ -299,12 +657,12 @@ bool reshade::runtime::on_init()
 		if (!_device->create_resource(
 				api::resource_desc(_width, _height, 1, 1, api::format_to_typeless(_back_buffer_format), 1, api::memory_heap::gpu_only, usage),
 				nullptr, back_buffer_desc.texture.samples == 1 ? api::resource_usage::copy_dest : api::resource_usage::resolve_dest, &_back_buffer_resolved) ||
-			!_device->create_resource_view(
+			!_resource_views->create_resource_view(
 				_back_buffer_resolved,
 				api::resource_usage::render_target,
 				api::resource_view_desc(api::format_to_default_typed(_back_buffer_format, 0)),
 				&_back_buffer_targets.emplace_back()) ||
-			!_device->create_resource_view(
+			!_resource_views->create_resource_view(
 				_back_buffer_resolved,
 				api::resource_usage::render_target,
 				api::resource_view_desc(api::format_to_default_typed(_back_buffer_format, 1)),
@@ -401,19 +759,23 @@ bool reshade::runtime::on_init()
 	if (add_effect_permutation(_width, _height, _back_buffer_format, stencil_format, _back_buffer_color_space) != 0)
 		goto exit_failure;
 
+	// Recreate the permutations add-ons used in previous sessions, so that effects are compiled for them in the background during loading already
+	load_effect_permutations(stencil_format);
+
 	// Create render targets for the back buffer resources
 	for (uint32_t i = 0, count = get_back_buffer_count(); i < count; ++i)
 	{
 		const api::resource back_buffer_resource = get_back_buffer(i);
 
-		if (!_device->create_resource_view(
+		// The linear and sRGB views are identical for formats without sRGB variant, in which case the view cache only creates a single one
+		if (!_resource_views->create_resource_view(
 				back_buffer_resource,
 				api::resource_usage::render_target,
 				api::resource_view_desc(
 					back_buffer_desc.texture.samples > 1 ? api::resource_view_type::texture_2d_multisample : api::resource_view_type::texture_2d,
 					api::format_to_default_typed(back_buffer_desc.texture.format, 0), 0, 1, 0, 1),
 				&_back_buffer_targets.emplace_back()) ||
-			!_device->create_resource_view(
+			!_resource_views->create_resource_view(
 				back_buffer_resource,
 				api::resource_usage::render_target,
 				api::resource_view_desc(
@@ -429,8 +791,11 @@ bool reshade::runtime::on_init()
 	create_state_block(_device, &_app_state);
 
 #if RESHADE_GUI
-	if (!init_imgui_resources())
-		goto exit_failure;
+	// Adjust default font size based on the vertical resolution
+	if (_font_size == 0)
+		_editor_font_size = _font_size = _height >= 2160 ? 26 : _height >= 1440 ? 20 : 13;
+
+	// ImGui resources are only created once the first GUI element is drawn (see 'draw_gui'), so that nothing is spent on them while no overlay or OSD is ever shown
 
 	if (_is_vr && !init_gui_vr())
 		goto exit_failure;
@@ -449,6 +814,9 @@ bool reshade::runtime::on_init()
 	// Reset frame count to zero so effects are loaded in 'update_effects'
 	_frame_count = 0;
 
+	if (global_config().get("APP", "SharedMemoryTelemetry") && !_is_vr)
+		_telemetry.open();
+
 	_is_initialized = true;
 	_last_reload_time = std::chrono::high_resolution_clock::now(); // Intentionally set to current time, so that duration to last reload is valid even when there is no reload on init
 
@@ -472,8 +840,8 @@ exit_failure:
 	for (const effect_permutation &permutation : _effect_permutations)
 	{
 		_device->destroy_resource(permutation.color_tex);
-		_device->destroy_resource_view(permutation.color_srv[0]);
-		_device->destroy_resource_view(permutation.color_srv[1]);
+		_resource_views->destroy_resource_view(permutation.color_srv[0]);
+		_resource_views->destroy_resource_view(permutation.color_srv[1]);
 
 		_device->destroy_resource(permutation.stencil_tex);
 		_device->destroy_resource_view(permutation.stencil_dsv);
@@ -493,7 +861,7 @@ exit_failure:
 	_back_buffer_resolved_srv = {};
 
 	for (const api::resource_view view : _back_buffer_targets)
-		_device->destroy_resource_view(view);
+		_resource_views->destroy_resource_view(view);
 	_back_buffer_targets.clear();
 
 	destroy_state_block(_device, _app_state);
@@ -516,8 +884,18 @@ void reshade::runtime::on_reset()
 	else
 		return; // Nothing to do if the runtime was already destroyed or not successfully initialized in the first place
 
+	// Finish any screenshots that are still waiting on the GPU, before the resources they read from are destroyed
+	update_screenshots(true);
+
 	// Already performs a wait for idle, so no need to do it again before destroying resources below
-	destroy_effects();
+	// Keep the compiled effects, so that a device reset (e.g. when switching out of fullscreen) only has to recreate their resources instead of recompiling everything
+	destroy_effects(!_no_effect_reuse_on_reset);
+
+#ifdef RESHADE_TEST_APPLICATION
+	destroy_regression_resources();
+#endif
+
+	_telemetry.close();
 
 	_device->destroy_resource(_empty_tex);
 	_empty_tex = {};
@@ -527,8 +905,8 @@ void reshade::runtime::on_reset()
 	for (const effect_permutation &permutation : _effect_permutations)
 	{
 		_device->destroy_resource(permutation.color_tex);
-		_device->destroy_resource_view(permutation.color_srv[0]);
-		_device->destroy_resource_view(permutation.color_srv[1]);
+		_resource_views->destroy_resource_view(permutation.color_srv[0]);
+		_resource_views->destroy_resource_view(permutation.color_srv[1]);
 
 		_device->destroy_resource(permutation.stencil_tex);
 		_device->destroy_resource_view(permutation.stencil_dsv);
@@ -548,7 +926,7 @@ void reshade::runtime::on_reset()
 	_back_buffer_resolved_srv = {};
 
 	for (const api::resource_view view : _back_buffer_targets)
-		_device->destroy_resource_view(view);
+		_resource_views->destroy_resource_view(view);
 	_back_buffer_targets.clear();
 
 	destroy_state_block(_device, _app_state);
@@ -557,6 +935,19 @@ void reshade::runtime::on_reset()
 	_device->destroy_fence(_queue_sync_fence);
 	_queue_sync_fence = {};
 
+	for (const api::resource readback_resource : _readback_resources)
+		_device->destroy_resource(readback_resource);
+	_readback_resources.clear();
+	_device->destroy_fence(_screenshot_fence);
+	_screenshot_fence = {};
+	_screenshot_fence_value = 0;
+
+	// Release pooled screenshot buffers, since they are sized to the back buffer (encoders still running may return theirs later, which are released on the next screenshot if the size changed)
+	{
+		const std::unique_lock<std::mutex> lock(_screenshot_buffer_mutex);
+		_screenshot_buffers.clear();
+	}
+
 	_width = _height = 0;
 	_back_buffer_format = api::format::unknown;
 	_back_buffer_samples = 1;
@@ -575,6 +966,85 @@ void reshade::runtime::on_reset()
 
 	log::message(log::level::info, "Destroyed runtime environment on runtime %p ('%s').", this, _config_path.u8string().c_str());
 }
+void reshade::runtime::on_mid_frame_render(api::resource_view rtv, api::resource_view rtv_srgb)
+{
+	if (!_is_initialized || _effects_rendered_this_frame)
+		return;
+
+	const auto stage_duration = [this](api::present_stage stage) -> uint64_t & { return _mid_frame_stage_durations[static_cast<size_t>(stage)]; };
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::capture_state));
+
+		capture_state(cmd_list, _app_state);
+	}
+
+	// Capture input received since the last frame, right before it is first read
+	if (_input != nullptr)
+		_input->next_frame();
+
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::update_effects));
+
+		update_effects();
+	}
+
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::render_effects));
+
+#if RESHADE_ADDON
+		// The application state was already captured above, so prevent 'render_effects' from capturing it a second time
+		_is_in_present_call = true;
+#endif
+		runtime::render_effects(cmd_list, rtv, rtv_srgb);
+#if RESHADE_ADDON
+		_is_in_present_call = false;
+#endif
+	}
+
+	// The frontend was not drawn yet, so this is the image without the HUD, while present saves the one with it from the same frame
+	if (_should_save_screenshot && _screenshot_nfs_hud_variants)
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::screenshot));
+
+		save_screenshot("NoHUD", _device->get_resource_from_view(rtv));
+		_screenshot_nfs_hud_variant_saved = true;
+	}
+
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::apply_state));
+
+		apply_state(cmd_list, _app_state);
+	}
+
+	// Only mark effects as done if they actually rendered (they do not while loading)
+	_effects_rendered_mid_frame = _effects_rendered_this_frame;
+}
+void reshade::runtime::on_nfs_render_stage(nfs_render_stage stage, api::resource_view rtv, api::resource_view rtv_srgb)
+{
+	assert(stage != nfs_render_stage::present);
+
+	// Nothing to do unless a technique was assigned to a render stage other than present
+	if (!_is_initialized || !_has_nfs_render_stages)
+		return;
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+#if !RESHADE_ADDON
+	capture_state(cmd_list, _app_state);
+#endif
+
+	// This is not called from within present, so 'render_effects' captures and applies the application state itself and uses an effect permutation matching the render target
+	_current_render_stage = stage;
+	runtime::render_effects(cmd_list, rtv, rtv_srgb);
+	_current_render_stage = nfs_render_stage::present;
+
+#if !RESHADE_ADDON
+	apply_state(cmd_list, _app_state);
+#endif
+}
 void reshade::runtime::on_present(api::command_queue *present_queue)
 {
 	assert(present_queue != nullptr);
@@ -605,16 +1075,38 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 	_is_in_present_call = true;
 #endif
 
+	// CPU time spent in each stage of this present, which is appended to the history at the end
+	uint64_t stage_durations[static_cast<size_t>(api::present_stage::count)] = {};
+	std::copy_n(_mid_frame_stage_durations, std::size(_mid_frame_stage_durations), stage_durations);
+	std::fill_n(_mid_frame_stage_durations, std::size(_mid_frame_stage_durations), 0);
+
+	// Effects were already rendered at the mid-frame hook, so only the overlay is left to do here
+	const bool skip_effects = _effects_rendered_mid_frame;
+	_effects_rendered_mid_frame = false;
+
+	const auto stage_duration = [&stage_durations](api::present_stage stage) -> uint64_t & { return stage_durations[static_cast<size_t>(stage)]; };
+
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 
-	capture_state(cmd_list, _app_state);
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::capture_state));
+
+		capture_state(cmd_list, _app_state);
+	}
 
 	uint32_t back_buffer_index = (_back_buffer_resolved != 0 ? 2 : 0) + get_current_back_buffer_index() * 2;
 	const api::resource back_buffer_resource = _device->get_resource_from_view(_back_buffer_targets[back_buffer_index]);
 
+#ifdef RESHADE_TEST_APPLICATION
+	if (!g_regression_path.empty() && !skip_effects)
+		begin_regression_frame(cmd_list, back_buffer_resource);
+#endif
+
 	// Resolve MSAA back buffer if MSAA is active or copy when format conversion is required
-	if (_back_buffer_resolved != 0)
+	if (_back_buffer_resolved != 0 && !skip_effects)
 	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::resolve));
+
 		if (_back_buffer_samples == 1)
 		{
 			cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::copy_source);
@@ -629,53 +1121,96 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 		}
 	}
 
-	// Lock input so it cannot be modified by other threads while we are reading it here
-	std::unique_lock<std::recursive_mutex> input_lock;
-	if (_input != nullptr)
-		input_lock = _input->lock();
+	// Capture input received since the last frame, right before it is first read (unless that already happened at the mid-frame hook)
+	if (_input != nullptr && !skip_effects)
+		_input->next_frame();
 
-	update_effects();
+	if (!skip_effects)
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::update_effects));
 
-	if (_should_save_screenshot && _screenshot_save_before && _effects_enabled && !_effects_rendered_this_frame)
-		save_screenshot("Before");
+		update_effects();
+	}
 
-	if (_back_buffer_resolved != 0)
+	if (_should_save_screenshot && _screenshot_save_before && _effects_enabled && !_effects_rendered_this_frame)
 	{
-		runtime::render_effects(cmd_list, _back_buffer_targets[0], _back_buffer_targets[1]);
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::screenshot));
+
+		save_screenshot("Before");
 	}
-	else
+
+	if (!skip_effects)
 	{
-		cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::render_target);
-		runtime::render_effects(cmd_list, _back_buffer_targets[back_buffer_index], _back_buffer_targets[back_buffer_index + 1]);
-		cmd_list->barrier(back_buffer_resource, api::resource_usage::render_target, api::resource_usage::present);
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::render_effects));
+
+		if (_back_buffer_resolved != 0)
+		{
+			runtime::render_effects(cmd_list, _back_buffer_targets[0], _back_buffer_targets[1]);
+		}
+		else
+		{
+			cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::render_target);
+			runtime::render_effects(cmd_list, _back_buffer_targets[back_buffer_index], _back_buffer_targets[back_buffer_index + 1]);
+			cmd_list->barrier(back_buffer_resource, api::resource_usage::render_target, api::resource_usage::present);
+		}
 	}
 
+#ifdef RESHADE_TEST_APPLICATION
+	if (!g_regression_path.empty() && !skip_effects)
+		end_regression_frame();
+#endif
+
 	if (_should_save_screenshot)
-		save_screenshot(_screenshot_save_before ? "After" : std::string_view());
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::screenshot));
+
+		save_screenshot(_screenshot_nfs_hud_variant_saved ? "HUD" : _screenshot_save_before ? "After" : std::string_view());
+	}
+	_screenshot_nfs_hud_variant_saved = false;
 
 	bool *drawHUDAddr = (bool*)DRAW_FENG_BOOL_ADDR;
 	*drawHUDAddr = drawFrontEnd;
 
 	_frame_count++;
+#if RESHADE_ADDON
+	// Heavy add-on initialization is deferred until the application presented its first frame, so that it does not delay start-up
+	if (_frame_count == 1)
+		initialize_deferred_addons(*_worker_pool);
+#endif
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time; _last_present_time = current_time;
 
+	// Pick up streaming calls of the frame that was just finished, before its statistics are recorded
+	update_nfs_stream_events();
+	update_nfs_load_profile();
+
 #if RESHADE_GUI
 	// Draw overlay
-	if (_is_vr)
-		draw_gui_vr();
-	else
-		draw_gui();
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::draw_gui));
+
+		if (_is_vr)
+			draw_gui_vr();
+		else
+			draw_gui();
+	}
 
 	if (_should_save_screenshot && _screenshot_save_gui && (_show_overlay || (_preview_texture != 0 && _effects_enabled)))
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::screenshot));
+
 		save_screenshot("Overlay");
+	}
 #endif
 
 	// All screenshots were created at this point, so reset request
 	_should_save_screenshot = false;
 
-	// Handle keyboard shortcuts
-	if (!_ignore_shortcuts && _input != nullptr)
+	// Write out screenshots from previous frames whose data has finished copying
+	update_screenshots();
+
+	// Handle keyboard shortcuts (which can only trigger in frames where a key was pressed down, so skip checking all of them otherwise)
+	if (!_ignore_shortcuts && _input != nullptr && (_input->key_press_count() != 0 || _input->is_any_mouse_button_pressed()))
 	{
 		if (_input->is_key_pressed(_effects_key_data, _force_shortcut_modifiers))
 		{
@@ -687,12 +1222,40 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 
 		if (_input->is_key_pressed(_screenshot_key_data, _force_shortcut_modifiers))
 		{
-			*drawHUDAddr = _screenshot_nfs_hud;
+			*drawHUDAddr = _screenshot_nfs_hud || _screenshot_nfs_hud_variants;
 
 			_screenshot_count++;
 			_should_save_screenshot = true; // Remember that we want to save a screenshot next frame
 		}
 
+		// Every frame is already saved during the offline capture, so a burst cannot be started then
+		if (_input->is_key_pressed(_screenshot_burst_key_data, _force_shortcut_modifiers) && !_nfs_capture_active)
+		{
+			if (_screenshot_burst_active)
+			{
+				// Pressing the shortcut again ends the burst early
+				_screenshot_burst_end_time = current_time;
+			}
+			else
+			{
+				_screenshot_burst_active = true;
+				_screenshot_burst_frame = 0;
+				_screenshot_burst_captured = 0;
+				_screenshot_burst_dropped = 0;
+				_screenshot_burst_end_time = current_time + std::chrono::milliseconds(_screenshot_burst_duration);
+
+				log::message(log::level::info, "Starting screenshot burst for %u ms, capturing every %u frame(s).", _screenshot_burst_duration, std::max(_screenshot_burst_interval, 1u));
+			}
+		}
+
+		if (_input->is_key_pressed(_nfs_capture_key_data, _force_shortcut_modifiers))
+		{
+			if (_nfs_capture_active)
+				stop_nfs_offline_capture();
+			else
+				start_nfs_offline_capture();
+		}
+
 		if (_input->is_key_pressed(_toggle_fe_key_data, _force_shortcut_modifiers))
 		{
 			// Toggle drawFrontEnd value
@@ -801,19 +1364,47 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 					}
 				}
 			}
-
-			// Continuously update preset values while a transition is in progress
-			if (_is_in_preset_transition)
-				load_current_preset();
 		}
 	}
 
-	// Stretch main render target back into MSAA back buffer if MSAA is active or copy when format conversion is required
-	if (_back_buffer_resolved != 0)
+	// Continuously update preset values while a transition is in progress
+	if (_is_in_preset_transition && !is_loading())
+		update_preset_transition();
+
+	if (_screenshot_burst_active)
 	{
-		const api::resource resources[2] = { back_buffer_resource, _back_buffer_resolved };
-		const api::resource_usage state_old[2] = { api::resource_usage::copy_source | api::resource_usage::resolve_source, api::resource_usage::render_target };
-		const api::resource_usage state_final[2] = { api::resource_usage::present, api::resource_usage::resolve_dest };
+		if (current_time >= _screenshot_burst_end_time)
+		{
+			_screenshot_burst_active = false;
+
+			log::message(log::level::info, "Finished screenshot burst with %u frame(s) captured and %u frame(s) dropped.", _screenshot_burst_captured, _screenshot_burst_dropped);
+		}
+		else if (_screenshot_burst_frame++ % std::max(_screenshot_burst_interval, 1u) == 0)
+		{
+			*drawHUDAddr = _screenshot_nfs_hud || _screenshot_nfs_hud_variants;
+
+			_screenshot_count++;
+			_should_save_screenshot = true;
+		}
+	}
+
+	// Save every single frame during the offline capture
+	if (_nfs_capture_active)
+	{
+		*drawHUDAddr = _screenshot_nfs_hud || _screenshot_nfs_hud_variants;
+
+		_screenshot_count++;
+		_should_save_screenshot = true;
+	}
+
+	// Stretch main render target back into MSAA back buffer if MSAA is active or copy when format conversion is required
+	if (_back_buffer_resolved != 0)
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::resolve));
+
+		const api::resource resources[2] = { back_buffer_resource, _back_buffer_resolved };
+		const api::resource_usage state_old[2] = { api::resource_usage::copy_source | api::resource_usage::resolve_source, api::resource_usage::render_target };
+		const api::resource_usage state_final[2] = { api::resource_usage::present, api::resource_usage::resolve_dest };
 
 		if (_device->get_api() == api::device_api::d3d10 ||
 			_device->get_api() == api::device_api::d3d11 ||
@@ -858,7 +1449,24 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 	_effects_rendered_this_frame = false;
 
 	// Apply previous state from application
-	apply_state(cmd_list, _app_state);
+	{
+		const scoped_present_stage_timer timer(stage_duration(api::present_stage::apply_state));
+
+		apply_state(cmd_list, _app_state);
+	}
+
+	for (size_t stage = 0; stage < static_cast<size_t>(api::present_stage::count); ++stage)
+		_present_stage_durations[stage][_present_stage_history_index] = stage_durations[stage];
+	_present_stage_history_index = (_present_stage_history_index + 1) % PRESENT_STAGE_HISTORY_SIZE;
+	_present_stage_history_count = std::min(_present_stage_history_count + 1, PRESENT_STAGE_HISTORY_SIZE);
+
+	if (_telemetry.is_open())
+		update_telemetry();
+
+#if RESHADE_GUI
+	// Advance the NFS benchmark after the timings of this frame were recorded
+	on_nfs_present();
+#endif
 
 	if (present_queue != _graphics_queue)
 	{
@@ -868,9 +1476,14 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 			present_queue->wait(_queue_sync_fence, _queue_sync_value);
 	}
 
+	// Wait as late as possible, so that the frame is presented right at the targeted time
+	// The offline capture replaces the frame limiter, since it decouples the simulation from real time anyway
+	if (_nfs_capture_active)
+		update_nfs_offline_capture();
+	else
+		limit_frame_rate();
+
 	// Update input status
-	if (_input != nullptr)
-		_input->next_frame();
 	if (_input_gamepad != nullptr)
 		_input_gamepad->next_frame();
 
@@ -897,14 +1510,19 @@ void reshade::runtime::on_present(api::command_queue *present_queue)
 		if (addon_enabled != was_enabled)
 		{
 			if (was_enabled)
-				_backup_texture_semantic_bindings = _texture_semantic_bindings;
+			{
+				_backup_texture_semantic_bindings.resize(_texture_semantic_bindings.size());
+				for (size_t semantic_id = 0; semantic_id < _texture_semantic_bindings.size(); ++semantic_id)
+					_backup_texture_semantic_bindings[semantic_id] = { _texture_semantic_bindings[semantic_id].srv, _texture_semantic_bindings[semantic_id].srv_srgb };
+			}
 
-			for (const auto &info : _backup_texture_semantic_bindings)
+			for (size_t semantic_id = 0; semantic_id < _backup_texture_semantic_bindings.size(); ++semantic_id)
 			{
-				if (info.second.first == _effect_permutations[0].color_srv[0] && info.second.second == _effect_permutations[0].color_srv[1])
+				const auto &[srv, srv_srgb] = _backup_texture_semantic_bindings[semantic_id];
+				if (srv == 0 || (srv == _effect_permutations[0].color_srv[0] && srv_srgb == _effect_permutations[0].color_srv[1]))
 					continue;
 
-				update_texture_bindings(info.first.c_str(), addon_enabled ? info.second.first : api::resource_view { 0 }, addon_enabled ? info.second.second : api::resource_view { 0 });
+				update_texture_bindings(_texture_semantic_bindings[semantic_id].semantic.c_str(), addon_enabled ? srv : api::resource_view { 0 }, addon_enabled ? srv_srgb : api::resource_view { 0 });
 			}
 		}
 	}
@@ -923,6 +1541,13 @@ void reshade::runtime::load_config()
 	else
 		_input_gamepad.reset();
 
+	if (unsigned int gamepad_poll_rate = 250;
+		_input_gamepad != nullptr)
+	{
+		config.get("INPUT", "GamepadPollRate", gamepad_poll_rate);
+		_input_gamepad->set_poll_rate(gamepad_poll_rate);
+	}
+
 	const auto config_get = [&config](const std::string &section, const std::string &key, auto &values) {
 		if (config.get(section, key, values))
 			return true;
@@ -932,6 +1557,8 @@ void reshade::runtime::load_config()
 
 	config_get("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
 	config_get("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config_get("INPUT", "KeyScreenshotBurst", _screenshot_burst_key_data);
+	config_get("INPUT", "KeyNfsCapture", _nfs_capture_key_data);
 	config_get("INPUT", "KeyEffects", _effects_key_data);
 	config_get("INPUT", "KeyNextPreset", _next_preset_key_data);
 	config_get("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
@@ -940,14 +1567,25 @@ void reshade::runtime::load_config()
 
 	config_get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config_get("GENERAL", "NoEffectCache", _no_effect_cache);
+	config_get("GENERAL", "DiscardGeneratedCode", _discard_generated_code);
+	config_get("GENERAL", "CompressSourceTextures", _compress_source_textures);
+	config_get("GENERAL", "TexturePrecisionPolicy", _texture_precision_policy);
+	config_get("GENERAL", "TexturePrecisionEffects", _texture_precision_effects);
 	config_get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config_get("GENERAL", "NoEffectReuseOnReset", _no_effect_reuse_on_reset);
+	config_get("GENERAL", "WorkerThreadCount", _worker_thread_count);
 
 	config_get("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config_get("GENERAL", "PerformanceMode", _performance_mode);
+	config_get("GENERAL", "AdaptivePerformanceMode", _adaptive_performance_mode);
+	config_get("GENERAL", "AdaptivePerformanceModeDelay", _adaptive_performance_mode_delay);
 	config_get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
 	config_get("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
+	config_get("GENERAL", "AutoReloadOnFileChange", _auto_reload_on_file_change);
+	config_get("GENERAL", "MemoryBudget", _memory_budget);
 	config_get("GENERAL", "TextureSearchPaths", _texture_search_paths);
 	config_get("GENERAL", "IntermediateCachePath", _effect_cache_path);
+	config_get("GENERAL", "IntermediateCacheSize", _effect_cache_size);
 
 	config_get("GENERAL", "StartupPresetPath", _startup_preset_path);
 	config_get("GENERAL", "PresetPath", _current_preset_path);
@@ -963,6 +1601,19 @@ void reshade::runtime::load_config()
 			log::message(log::level::error, "Failed to create effect cache directory '%s' with error code %d!", _effect_cache_path.u8string().c_str(), ec.value());
 	}
 
+	// Only reopen the cache archive when its location changed, since closing it has to write back the table of contents
+	if (_no_effect_cache)
+		_effect_cache->close();
+	else if (const std::filesystem::path cache_archive_path = g_reshade_base_path / _effect_cache_path / L"reshade-cache.bin";
+		_effect_cache->path() != cache_archive_path)
+		_effect_cache->open(cache_archive_path, static_cast<uint64_t>(_effect_cache_size) * 1024 * 1024);
+
+#ifdef RESHADE_TEST_APPLICATION
+	// Regression runs always use the specified preset
+	if (!g_regression_preset_path.empty())
+		_current_preset_path = g_reshade_base_path / g_regression_preset_path;
+	else
+#endif
 	// Use startup preset instead of last selection
 	if (!_startup_preset_path.empty() && resolve_preset_path(_startup_preset_path, ec))
 		_current_preset_path = _startup_preset_path;
@@ -997,14 +1648,23 @@ void reshade::runtime::load_config()
 	config_get("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
 #endif
 	config_get("SCREENSHOT", "PostSaveCommand", _screenshot_post_save_command);
+	config_get("SCREENSHOT", "BurstDuration", _screenshot_burst_duration);
+	config_get("SCREENSHOT", "BurstInterval", _screenshot_burst_interval);
+	config_get("SCREENSHOT", "BurstQueueSize", _screenshot_burst_queue_size);
+	config_get("SCREENSHOT", "NfsCaptureFPS", _nfs_capture_fps);
 	config_get("SCREENSHOT", "PostSaveCommandArguments", _screenshot_post_save_command_arguments);
 	config_get("SCREENSHOT", "PostSaveCommandWorkingDirectory", _screenshot_post_save_command_working_directory);
 	config_get("SCREENSHOT", "PostSaveCommandHideWindow", _screenshot_post_save_command_hide_window);
 	config_get("SCREENSHOT", "ShowNfsFe", _screenshot_nfs_hud);
+	config_get("SCREENSHOT", "SaveNfsFeVariants", _screenshot_nfs_hud_variants);
 
 #ifdef GAME_UC
 	config.get("NFS", "MotionBlur", bMotionBlur);
 #endif
+	config.get("NFS", "FrameLimit", _frame_limit_enabled);
+	config.get("NFS", "FrameLimitFPS", _frame_limit_fps);
+	config.get("NFS", "FrameLimitSpinTime", _frame_limit_spin_time);
+	config.get("NFS", "FrameLimitGameSpeedCompensation", _frame_limit_game_speed_compensation);
 
 #if RESHADE_GUI
 	load_config_gui(config);
@@ -1016,6 +1676,8 @@ void reshade::runtime::save_config() const
 
 	config.set("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
 	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.set("INPUT", "KeyScreenshotBurst", _screenshot_burst_key_data);
+	config.set("INPUT", "KeyNfsCapture", _nfs_capture_key_data);
 	config.set("INPUT", "KeyEffects", _effects_key_data);
 	config.set("INPUT", "KeyNextPreset", _next_preset_key_data);
 	config.set("INPUT", "KeyPerformanceMode", _performance_mode_key_data);
@@ -1024,14 +1686,25 @@ void reshade::runtime::save_config() const
 
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
+	config.set("GENERAL", "DiscardGeneratedCode", _discard_generated_code);
+	config.set("GENERAL", "CompressSourceTextures", _compress_source_textures);
+	config.set("GENERAL", "TexturePrecisionPolicy", _texture_precision_policy);
+	config.set("GENERAL", "TexturePrecisionEffects", _texture_precision_effects);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "NoEffectReuseOnReset", _no_effect_reuse_on_reset);
+	config.set("GENERAL", "WorkerThreadCount", _worker_thread_count);
 
 	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.set("GENERAL", "PerformanceMode", _performance_mode);
+	config.set("GENERAL", "AdaptivePerformanceMode", _adaptive_performance_mode);
+	config.set("GENERAL", "AdaptivePerformanceModeDelay", _adaptive_performance_mode_delay);
 	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
 	config.set("GENERAL", "SkipLoadingDisabledEffects", _effect_load_skipping);
+	config.set("GENERAL", "AutoReloadOnFileChange", _auto_reload_on_file_change);
+	config.set("GENERAL", "MemoryBudget", _memory_budget);
 	config.set("GENERAL", "TextureSearchPaths", _texture_search_paths);
 	config.set("GENERAL", "IntermediateCachePath", _effect_cache_path);
+	config.set("GENERAL", "IntermediateCacheSize", _effect_cache_size);
 
 	config.set("GENERAL", "StartupPresetPath", make_relative_path(_startup_preset_path));
 	config.set("GENERAL", "PresetPath", make_relative_path(_current_preset_path));
@@ -1067,10 +1740,20 @@ void reshade::runtime::save_config() const
 	config.set("SCREENSHOT", "SaveOverlayShot", _screenshot_save_gui);
 #endif
 	config.set("SCREENSHOT", "PostSaveCommand", _screenshot_post_save_command);
+	config.set("SCREENSHOT", "BurstDuration", _screenshot_burst_duration);
+	config.set("SCREENSHOT", "BurstInterval", _screenshot_burst_interval);
+	config.set("SCREENSHOT", "BurstQueueSize", _screenshot_burst_queue_size);
+	config.set("SCREENSHOT", "NfsCaptureFPS", _nfs_capture_fps);
 	config.set("SCREENSHOT", "PostSaveCommandArguments", _screenshot_post_save_command_arguments);
 	config.set("SCREENSHOT", "PostSaveCommandWorkingDirectory", _screenshot_post_save_command_working_directory);
 	config.set("SCREENSHOT", "PostSaveCommandHideWindow", _screenshot_post_save_command_hide_window);
 	config.set("SCREENSHOT", "ShowNfsFe", _screenshot_nfs_hud);
+	config.set("SCREENSHOT", "SaveNfsFeVariants", _screenshot_nfs_hud_variants);
+
+	config.set("NFS", "FrameLimit", _frame_limit_enabled);
+	config.set("NFS", "FrameLimitFPS", _frame_limit_fps);
+	config.set("NFS", "FrameLimitSpinTime", _frame_limit_spin_time);
+	config.set("NFS", "FrameLimitGameSpeedCompensation", _frame_limit_game_speed_compensation);
 
 #if RESHADE_GUI
 	save_config_gui(config);
@@ -1088,6 +1771,11 @@ void reshade::runtime::load_current_preset()
 	std::vector<std::string> sorted_technique_list;
 	preset.get({}, "TechniqueSorting", sorted_technique_list);
 
+	_gameflow_rule.clear();
+	preset.get({}, "GameFlowStates", _gameflow_rule);
+	_has_gameflow_rules = false;
+	_has_nfs_render_stages = false;
+
 	std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> preset_preprocessor_definitions;
 	preset.get({}, "PreprocessorDefinitions", preset_preprocessor_definitions[{}]);
 	for (const effect &effect : _effects)
@@ -1096,9 +1784,16 @@ void reshade::runtime::load_current_preset()
 	// Recompile effects if preprocessor definitions have changed or running in performance mode (in which case all preset values are compile-time constants)
 	if (_reload_remaining_effects != 0 && (!_is_in_preset_transition || _last_preset_switching_time == _last_present_time)) // ... unless this is the 'load_current_preset' call in 'update_effects' or the call every frame during preset transition
 	{
-		if (_performance_mode || preset_preprocessor_definitions != _preset_preprocessor_definitions)
+		if (_performance_mode || !_baked_effects.empty() || preset_preprocessor_definitions != _preset_preprocessor_definitions)
 		{
 			_preset_preprocessor_definitions = std::move(preset_preprocessor_definitions);
+
+			// Effects with baked values have to go back to the generic version to apply the values from the new preset
+			{
+				const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+				_baked_effects.clear();
+			}
+
 			reload_effects();
 			return; // Preset values are loaded in 'update_effects' during effect loading
 		}
@@ -1125,23 +1820,32 @@ void reshade::runtime::load_current_preset()
 	if (sorted_technique_list.empty())
 		sorted_technique_list = technique_list;
 
+	// Look up the position of every technique in the sorted list once up front, instead of searching the list in every comparison
+	std::unordered_map<std::string_view, size_t> sorted_technique_positions;
+	sorted_technique_positions.reserve(sorted_technique_list.size());
+	for (size_t i = 0; i < sorted_technique_list.size(); ++i)
+		sorted_technique_positions.emplace(sorted_technique_list[i], i); // Keeps the first occurrence, same as a search would find
+
+	std::vector<size_t> technique_positions(_techniques.size());
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+
+		auto it = sorted_technique_positions.find(tech.name + '@' + _effects[tech.effect_index].source_file.filename().u8string());
+		if (it == sorted_technique_positions.end())
+			it = sorted_technique_positions.find(tech.name);
+		technique_positions[technique_index] = it != sorted_technique_positions.end() ? it->second : sorted_technique_list.size();
+	}
+
 	// Reorder techniques
 	std::stable_sort(_technique_sorting.begin(), _technique_sorting.end(),
-		[this, &sorted_technique_list](size_t lhs_technique_index, size_t rhs_technique_index) {
+		[this, &technique_positions](size_t lhs_technique_index, size_t rhs_technique_index) {
 			const technique &lhs = _techniques[lhs_technique_index];
 			const technique &rhs = _techniques[rhs_technique_index];
 
-			const std::string lhs_unique = lhs.name + '@' + _effects[lhs.effect_index].source_file.filename().u8string();
-			auto lhs_it = std::find(sorted_technique_list.cbegin(), sorted_technique_list.cend(), lhs_unique);
-			lhs_it = (lhs_it == sorted_technique_list.cend()) ? std::find(sorted_technique_list.cbegin(), sorted_technique_list.cend(), lhs.name) : lhs_it;
-
-			const std::string rhs_unique = rhs.name + '@' + _effects[rhs.effect_index].source_file.filename().u8string();
-			auto rhs_it = std::find(sorted_technique_list.cbegin(), sorted_technique_list.cend(), rhs_unique);
-			rhs_it = (rhs_it == sorted_technique_list.cend()) ? std::find(sorted_technique_list.cbegin(), sorted_technique_list.cend(), rhs.name) : rhs_it;
-
-			if (lhs_it < rhs_it)
+			if (technique_positions[lhs_technique_index] < technique_positions[rhs_technique_index])
 				return true;
-			if (lhs_it > rhs_it)
+			if (technique_positions[lhs_technique_index] > technique_positions[rhs_technique_index])
 				return false;
 
 			// Keep the declaration order within an effect file
@@ -1171,11 +1875,12 @@ void reshade::runtime::load_current_preset()
 	// Compute times since the transition has started and how much is left till it should end
 	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
 	auto transition_ms_left = _preset_transition_duration - transition_time / 1000;
-	auto transition_ms_left_from_last_frame = transition_ms_left + std::chrono::duration_cast<std::chrono::microseconds>(_last_frame_duration).count() / 1000;
 
 	if (_is_in_preset_transition && transition_ms_left <= 0)
 		_is_in_preset_transition = false;
 
+	_preset_transition_values.clear();
+
 	for (effect &effect : _effects)
 	{
 		const std::string effect_name = effect.source_file.filename().u8string();
@@ -1217,12 +1922,13 @@ void reshade::runtime::load_current_preset()
 				preset.get(effect_name, variable.name, values.as_float);
 				if (_is_in_preset_transition)
 				{
-					// Perform smooth transition on floating point values
-					for (unsigned int i = 0; i < variable.type.components(); i++)
-					{
-						const float value_left = (values.as_float[i] - values_old.as_float[i]);
-						values.as_float[i] -= (value_left / transition_ms_left_from_last_frame) * transition_ms_left;
-					}
+					// Perform smooth transition on floating point values, starting from the current ones (see 'update_preset_transition')
+					preset_transition_value &transition = _preset_transition_values.emplace_back();
+					transition.variable = &variable;
+					transition.count = variable.type.components();
+					std::memcpy(transition.start, values_old.as_float, transition.count * sizeof(float));
+					std::memcpy(transition.end, values.as_float, transition.count * sizeof(float));
+					break;
 				}
 				set_uniform_value(variable, values.as_float, variable.type.components());
 				break;
@@ -1230,14 +1936,16 @@ void reshade::runtime::load_current_preset()
 		}
 	}
 
+	const std::unordered_set<std::string_view> enabled_technique_names(technique_list.cbegin(), technique_list.cend());
+
 	for (technique &tech : _techniques)
 	{
 		const std::string unique_name = tech.name + '@' + _effects[tech.effect_index].source_file.filename().u8string();
 
 		// Ignore preset if "enabled" annotation is set
 		if (tech.annotation_as_int("enabled") ||
-			std::find(technique_list.cbegin(), technique_list.cend(), unique_name) != technique_list.cend() ||
-			std::find(technique_list.cbegin(), technique_list.cend(), tech.name) != technique_list.cend())
+			enabled_technique_names.find(unique_name) != enabled_technique_names.end() ||
+			enabled_technique_names.find(tech.name) != enabled_technique_names.end())
 			enable_technique(tech);
 		else
 			disable_technique(tech);
@@ -1245,10 +1953,61 @@ void reshade::runtime::load_current_preset()
 		if (!preset.get({}, "Key" + unique_name, tech.toggle_key_data) &&
 			!preset.get({}, "Key" + tech.name, tech.toggle_key_data))
 			std::memset(tech.toggle_key_data, 0, sizeof(tech.toggle_key_data));
+
+		tech.gameflow_rule.clear();
+		preset.get({}, "GameFlowStates" + unique_name, tech.gameflow_rule);
+		tech.gameflow_excluded = false;
+		update_gameflow_state_mask(tech);
+
+		tech.render_stage_name.clear();
+		preset.get({}, "RenderStage" + unique_name, tech.render_stage_name);
+		update_render_stage(tech);
+
+		if (!preset.get({}, "ReplacesVisualTreatment" + unique_name, tech.replaces_visual_treatment))
+			tech.replaces_visual_treatment = tech.annotation_as_int("replaces_visual_treatment") != 0;
+
+		tech.update_interval = 0;
+		if (!preset.get({}, "UpdateInterval" + unique_name, tech.update_interval) || tech.update_interval == 0)
+			tech.update_interval = std::max(tech.annotation_as_int("update_interval", 0, 1), 1);
 	}
 
+	for (effect &effect : _effects)
+		effect.rendering_gameflow_excluded = 0;
+
 	// Reverse queue so that effects are enabled in the order they are defined in the preset (since the queue is worked from back to front)
 	std::reverse(_reload_create_queue.begin(), _reload_create_queue.end());
+
+	_preset_transition_generation = _effects_generation;
+}
+void reshade::runtime::update_preset_transition()
+{
+	assert(_is_in_preset_transition);
+
+	// Parse the preset again if this is the first frame of the transition or effects were reloaded in the meantime, since that invalidates the captured variables
+	if (_preset_transition_generation != _effects_generation || _last_preset_switching_time == _last_present_time)
+	{
+		load_current_preset();
+		return;
+	}
+
+	const auto transition_time = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _last_preset_switching_time).count();
+	if (transition_time >= static_cast<long long>(_preset_transition_duration))
+	{
+		// Apply the exact preset values at the end of the transition
+		load_current_preset();
+		return;
+	}
+
+	const float factor = static_cast<float>(transition_time) / static_cast<float>(_preset_transition_duration);
+
+	for (const preset_transition_value &transition : _preset_transition_values)
+	{
+		float values[16];
+		for (uint32_t i = 0; i < transition.count; ++i)
+			values[i] = transition.start[i] + (transition.end[i] - transition.start[i]) * factor;
+
+		set_uniform_value(*transition.variable, values, transition.count);
+	}
 }
 void reshade::runtime::save_current_preset(ini_file &preset) const
 {
@@ -1282,8 +2041,33 @@ void reshade::runtime::save_current_preset(ini_file &preset) const
 			preset.set({}, "Key" + unique_name, tech.toggle_key_data);
 		else
 			preset.remove_key({}, "Key" + unique_name);
+
+		if (!tech.gameflow_rule.empty())
+			preset.set({}, "GameFlowStates" + unique_name, tech.gameflow_rule);
+		else
+			preset.remove_key({}, "GameFlowStates" + unique_name);
+
+		if (!tech.render_stage_name.empty())
+			preset.set({}, "RenderStage" + unique_name, tech.render_stage_name);
+		else
+			preset.remove_key({}, "RenderStage" + unique_name);
+
+		if (tech.replaces_visual_treatment != (tech.annotation_as_int("replaces_visual_treatment") != 0))
+			preset.set({}, "ReplacesVisualTreatment" + unique_name, tech.replaces_visual_treatment);
+		else
+			preset.remove_key({}, "ReplacesVisualTreatment" + unique_name);
+
+		if (tech.update_interval != static_cast<uint32_t>(std::max(tech.annotation_as_int("update_interval", 0, 1), 1)))
+			preset.set({}, "UpdateInterval" + unique_name, tech.update_interval);
+		else
+			preset.remove_key({}, "UpdateInterval" + unique_name);
 	}
 
+	if (!_gameflow_rule.empty())
+		preset.set({}, "GameFlowStates", _gameflow_rule);
+	else
+		preset.remove_key({}, "GameFlowStates");
+
 	if (preset.has({}, "TechniqueSorting") || !std::equal(technique_list.cbegin(), technique_list.cend(), sorted_technique_list.cbegin()))
 		preset.set({}, "TechniqueSorting", std::move(sorted_technique_list));
 
@@ -1349,6 +2133,364 @@ void reshade::runtime::save_current_preset(ini_file &preset) const
 	}
 }
 
+static const char *const gameflow_state_names[] = {
+	"NONE",
+	"LOADING_FRONTEND",
+	"UNLOADING_FRONTEND",
+	"IN_FRONTEND",
+	"LOADING_REGION",
+	"LOADING_TRACK",
+	"RACING",
+	"UNLOADING_TRACK",
+	"UNLOADING_REGION",
+	"EXIT_DEMO_DISC",
+};
+
+/// <summary>
+/// Converts a list of game flow state names (e.g. "RACING" or "!LOADING_*, !IN_FRONTEND") into a bit mask of the states in which to render.
+/// Names may end in a wildcard to match all states starting with that prefix. Names prefixed with an exclamation mark are removed from the mask, which otherwise starts out with all states if there are only excluded names.
+/// </summary>
+static uint32_t parse_gameflow_rule(const std::string_view rule)
+{
+	uint32_t included = 0;
+	uint32_t excluded = 0;
+
+	for (size_t offset = 0; offset < rule.size();)
+	{
+		const size_t end = std::min(rule.find_first_of(", |\t", offset), rule.size());
+		std::string_view name = rule.substr(offset, end - offset);
+		offset = end + 1;
+
+		if (name.empty())
+			continue;
+
+		const bool exclude = name.front() == '!';
+		if (exclude)
+			name.remove_prefix(1);
+		const bool wildcard = !name.empty() && name.back() == '*';
+		if (wildcard)
+			name.remove_suffix(1);
+
+		uint32_t mask = 0;
+		for (uint32_t state = 0; state < static_cast<uint32_t>(std::size(gameflow_state_names)); ++state)
+		{
+			const std::string_view state_name = gameflow_state_names[state];
+			if (wildcard ? state_name.rfind(name, 0) == 0 : state_name == name)
+				mask |= 1u << state;
+		}
+
+		if (mask == 0)
+			log::message(log::level::warning, "Ignoring unknown game flow state '%.*s' in rule '%.*s'.", static_cast<int>(name.size()), name.data(), static_cast<int>(rule.size()), rule.data());
+
+		(exclude ? excluded : included) |= mask;
+	}
+
+	if (included == 0)
+		included = 0xFFFFFFFF;
+
+	return included & ~excluded;
+}
+
+void reshade::runtime::update_gameflow_state_mask(technique &tech)
+{
+	// A rule set for the technique in the preset takes precedence over the one in the effect, which takes precedence over the global one in the preset
+	std::string_view rule = tech.gameflow_rule;
+	if (rule.empty())
+		rule = tech.annotation_as_string("gameflow_states");
+	if (rule.empty())
+		rule = _gameflow_rule;
+
+	tech.gameflow_state_mask = parse_gameflow_rule(rule);
+
+	if (tech.gameflow_state_mask != 0xFFFFFFFF)
+		_has_gameflow_rules = true;
+}
+void reshade::runtime::update_gameflow_exclusion()
+{
+	if (!_has_gameflow_rules)
+		return;
+
+	const int gameflow_state = _nfs_game_state.gameflow_state;
+	const uint32_t gameflow_state_bit = gameflow_state >= 0 && gameflow_state < 32 ? 1u << gameflow_state : 0xFFFFFFFF;
+
+	for (effect &effect : _effects)
+		effect.rendering_gameflow_excluded = 0;
+
+	for (technique &tech : _techniques)
+	{
+		tech.gameflow_excluded = tech.enabled && (tech.gameflow_state_mask & gameflow_state_bit) == 0;
+
+		// Keep track of excluded techniques per effect, so that uniform updates can be skipped for effects that have no technique left to render
+		if (tech.gameflow_excluded)
+			_effects[tech.effect_index].rendering_gameflow_excluded++;
+	}
+}
+void reshade::runtime::update_render_stage(technique &tech)
+{
+	// A render stage set for the technique in the preset takes precedence over the one in the effect
+	std::string_view name = tech.render_stage_name;
+	if (name.empty())
+		name = tech.annotation_as_string("render_stage");
+
+	tech.render_stage = static_cast<uint32_t>(nfs_render_stage::present);
+
+	if (name.empty())
+		return;
+
+	const auto it = std::find(std::begin(nfs_render_stage_names), std::end(nfs_render_stage_names), name);
+	if (it == std::end(nfs_render_stage_names))
+	{
+		log::message(log::level::warning, "Ignoring unknown render stage '%.*s' of technique '%s'.", static_cast<int>(name.size()), name.data(), tech.name.c_str());
+		return;
+	}
+
+	tech.render_stage = static_cast<uint32_t>(it - std::begin(nfs_render_stage_names));
+
+#ifndef NFSUC_MOTIONBLUR_HOOK_ADDR
+	// There is no motion blur hook in this game, so render these at present instead of not at all
+	if (tech.render_stage == static_cast<uint32_t>(nfs_render_stage::motion_blur))
+		tech.render_stage = static_cast<uint32_t>(nfs_render_stage::present);
+#endif
+
+	if (tech.render_stage != static_cast<uint32_t>(nfs_render_stage::present))
+		_has_nfs_render_stages = true;
+}
+lockfree_snapshot<reshade::runtime::nfs_game_state> reshade::runtime::s_nfs_game_snapshot;
+
+void reshade::runtime::update_nfs_game_state()
+{
+#ifndef NFS_MULTITHREAD
+	// The game updates the world on the same thread it presents on, so there is no simulation tick to publish from
+	publish_nfs_game_state();
+#endif
+
+	_nfs_game_state = s_nfs_game_snapshot.read();
+}
+void reshade::runtime::publish_nfs_game_state()
+{
+	nfs_game_state state = {};
+	state.gameflow_state = *(int*)GAMEFLOWMGR_STATUS_ADDR;
+#ifdef GAMESPEED_ADDR
+	state.game_speed = *(float*)GAMESPEED_ADDR;
+#else
+	state.game_speed = 1.0f;
+#endif
+#ifdef PRECIPITATION_PERCENT_ADDR
+	state.precipitation = *(float*)PRECIPITATION_PERCENT_ADDR;
+#endif
+#ifdef BASEWEATHER_FOG_ADDR
+	state.fog[0] = *(float*)BASEWEATHER_FOG_ADDR;
+	state.fog[1] = *(float*)BASEWEATHER_FOG_START_ADDR;
+	state.fog_color[0] = *(int*)BASEWEATHER_FOG_COLOUR_R_ADDR / 255.0f;
+	state.fog_color[1] = *(int*)BASEWEATHER_FOG_COLOUR_G_ADDR / 255.0f;
+	state.fog_color[2] = *(int*)BASEWEATHER_FOG_COLOUR_B_ADDR / 255.0f;
+#endif
+#ifdef VISUALTREATMENT_INSTANCE_ADDR
+	// The first member of the visual treatment instance is the current look (e.g. the cop cam look)
+	const int visual_treatment_instance = *(int*)VISUALTREATMENT_INSTANCE_ADDR;
+	state.visual_treatment = visual_treatment_instance != 0 ? *(int*)visual_treatment_instance : 0;
+#endif
+
+	// Remember which processor the scheduler prefers for the publishing thread (the game thread in the multithreaded games), so that background work can be kept off it
+	PROCESSOR_NUMBER processor = {};
+	GetThreadIdealProcessorEx(GetCurrentThread(), &processor);
+	state.thread_processor = processor.Group == 0 ? processor.Number : UINT32_MAX;
+#ifdef VEHICLE_LISTABLESET_SIZE_OFFSET
+	// Only ever called from the thread the game simulates on, so the state of the previous tick can be kept here
+	static uintptr_t previous_vehicle_ids[NFS_MAX_VEHICLES] = {};
+	static api::nfs_vehicle previous_vehicles[NFS_MAX_VEHICLES] = {};
+	static uint32_t previous_vehicle_count = 0;
+	static std::chrono::high_resolution_clock::time_point previous_time;
+
+	uintptr_t vehicle_ids[NFS_MAX_VEHICLES];
+	state.vehicle_count = GetNFSVehicles(state.vehicles, vehicle_ids, NFS_MAX_VEHICLES);
+
+	const auto current_time = std::chrono::high_resolution_clock::now();
+	const float interval = std::chrono::duration_cast<std::chrono::duration<float>>(current_time - previous_time).count();
+
+	// Vehicles are matched up with the previous tick by their address, since the table is reordered when vehicles are added or removed
+	for (uint32_t i = 0; i < std::min(state.vehicle_count, NFS_MAX_VEHICLES); ++i)
+	{
+		const uintptr_t *const previous_id = std::find(previous_vehicle_ids, previous_vehicle_ids + previous_vehicle_count, vehicle_ids[i]);
+		if (previous_id == previous_vehicle_ids + previous_vehicle_count || interval <= 0.0f)
+			continue;
+
+		const api::nfs_vehicle &previous = previous_vehicles[previous_id - previous_vehicle_ids];
+		const float dx = state.vehicles[i].position[0] - previous.position[0];
+		const float dy = state.vehicles[i].position[1] - previous.position[1];
+		const float dz = state.vehicles[i].position[2] - previous.position[2];
+		state.vehicles[i].speed = std::sqrt(dx * dx + dy * dy + dz * dz) / interval;
+	}
+
+	previous_vehicle_count = std::min(state.vehicle_count, NFS_MAX_VEHICLES);
+	std::copy_n(vehicle_ids, previous_vehicle_count, previous_vehicle_ids);
+	std::copy_n(state.vehicles, previous_vehicle_count, previous_vehicles);
+	previous_time = current_time;
+#endif
+
+	s_nfs_game_snapshot.publish(state);
+}
+
+#ifdef GAME_PS
+// ProStreet applies the game speed through 'GameSpeedCave' instead of reading it from a fixed address
+extern float GameSpeed;
+#endif
+#ifdef VEHICLE_LISTABLESET_SIZE_OFFSET
+// Walks the vehicle table of the game (see 'runtime_gui.cpp'), which is where the other code calling into the game lives
+extern uint32_t GetNFSVehicles(reshade::api::nfs_vehicle *vehicles, uintptr_t *ids, uint32_t max_count);
+#endif
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+static float *get_game_speed()
+{
+#if defined(GAME_PS)
+	return &GameSpeed;
+#elif defined(GAMESPEED_ADDR)
+	return reinterpret_cast<float *>(GAMESPEED_ADDR);
+#else
+	return nullptr;
+#endif
+}
+
+void reshade::runtime::limit_frame_rate()
+{
+	float *const game_speed = get_game_speed();
+
+	const bool compensate = _frame_limit_enabled && _frame_limit_fps != 0 && _frame_limit_game_speed_compensation && game_speed != nullptr;
+	if (compensate != _frame_limit_compensating)
+	{
+		// Remember the speed set by the user when compensation starts, and restore it when it stops again
+		if (compensate)
+			_frame_limit_base_game_speed = *game_speed;
+		else
+			*game_speed = _frame_limit_base_game_speed;
+
+		_frame_limit_compensating = compensate;
+		_frame_limit_game_speed_factor = 1.0f;
+	}
+
+	if (!_frame_limit_enabled || _frame_limit_fps == 0)
+	{
+		_frame_limit_last_time = {};
+		_frame_limit_jitter_count = 0;
+		return;
+	}
+
+	if (_frame_limit_timer == nullptr)
+	{
+		// High resolution timers are only available since Windows 10 version 1803, so fall back to a regular one before that
+		_frame_limit_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (_frame_limit_timer == nullptr)
+			_frame_limit_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+	}
+
+	const auto frame_time = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::nanoseconds(1000000000 / _frame_limit_fps));
+
+	auto now = std::chrono::high_resolution_clock::now();
+	const bool first_frame = _frame_limit_last_time == std::chrono::high_resolution_clock::time_point();
+
+	if (first_frame || now > _frame_limit_next_time + frame_time)
+	{
+		// Start over when the frame is late by more than a whole frame, instead of trying to catch up with a burst of short frames
+		_frame_limit_next_time = now;
+	}
+	else
+	{
+		// Sleep until shortly before the targeted time, since waking up from the timer is only accurate to a fraction of a millisecond
+		const auto spin_time = std::chrono::microseconds(_frame_limit_spin_time);
+		if (const auto remaining = _frame_limit_next_time - now;
+			remaining > spin_time && _frame_limit_timer != nullptr)
+		{
+			LARGE_INTEGER due_time;
+			// Negative values are relative to the current time, in 100 nanosecond intervals
+			due_time.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - spin_time).count() / 100);
+
+			if (SetWaitableTimerEx(static_cast<HANDLE>(_frame_limit_timer), &due_time, 0, nullptr, nullptr, nullptr, 0))
+				WaitForSingleObject(static_cast<HANDLE>(_frame_limit_timer), INFINITE);
+		}
+
+		// Then spin for the rest of the time
+		while ((now = std::chrono::high_resolution_clock::now()) < _frame_limit_next_time)
+			YieldProcessor();
+	}
+
+	if (!first_frame)
+	{
+		const auto interval = now - _frame_limit_last_time;
+
+		_frame_limit_jitter[_frame_limit_jitter_index] = std::chrono::duration_cast<std::chrono::duration<float, std::micro>>(interval - frame_time).count();
+		_frame_limit_jitter_index = (_frame_limit_jitter_index + 1) % FRAME_LIMIT_HISTORY_SIZE;
+		_frame_limit_jitter_count = std::min(_frame_limit_jitter_count + 1, FRAME_LIMIT_HISTORY_SIZE);
+
+		if (_frame_limit_compensating)
+		{
+			// Scale the simulation by how much longer frames take than targeted, so that it keeps up with real time when the cap cannot be held
+			// This is smoothed over a couple of frames to not feed single spikes into the physics
+			const float ratio = std::clamp(static_cast<float>(interval.count()) / static_cast<float>(frame_time.count()), 0.5f, 2.0f);
+			_frame_limit_game_speed_factor += (ratio - _frame_limit_game_speed_factor) * 0.125f;
+
+			*game_speed = _frame_limit_base_game_speed * _frame_limit_game_speed_factor;
+		}
+	}
+
+	_frame_limit_last_time = now;
+	_frame_limit_next_time += frame_time;
+}
+
+void reshade::runtime::start_nfs_offline_capture()
+{
+	float *const game_speed = get_game_speed();
+	if (_nfs_capture_active || _screenshot_burst_active || game_speed == nullptr || _nfs_capture_fps == 0)
+		return;
+
+	// Quality is traded for frame rate by the dynamic resolution, the precipitation budget and the world detail governor, which all stand down during the capture
+
+	// The frame limiter is paused during the capture, so take over the speed it compensates rather than its current output
+	_nfs_capture_base_game_speed = _frame_limit_compensating ? _frame_limit_base_game_speed : *game_speed;
+	_nfs_capture_active = true;
+	_nfs_capture_frame_count = 0;
+	_nfs_capture_last_time = {};
+
+	log::message(log::level::info, "Starting offline capture at %u frames per second.", _nfs_capture_fps);
+}
+void reshade::runtime::stop_nfs_offline_capture()
+{
+	if (!_nfs_capture_active)
+		return;
+
+	*get_game_speed() = _nfs_capture_base_game_speed;
+	_nfs_capture_active = false;
+
+	// Have the frame limiter start over instead of trying to catch up with the time spent capturing
+	_frame_limit_last_time = {};
+
+	log::message(log::level::info, "Finished offline capture with %u frame(s).", _nfs_capture_frame_count);
+}
+void reshade::runtime::update_nfs_offline_capture()
+{
+	assert(_nfs_capture_active);
+
+	// Hand the frames read back so far to the encoders, and wait for them instead of dropping frames when they cannot keep up
+	update_screenshots(true);
+	while (_screenshot_encodes_in_flight >= std::max(_screenshot_burst_queue_size, 1u))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	const auto now = std::chrono::high_resolution_clock::now();
+	if (_nfs_capture_last_time != std::chrono::high_resolution_clock::time_point())
+	{
+		// The next frame most likely takes about as long as this one (including the wait above), so scale the simulation to advance by one output frame over that time
+		const float interval = std::chrono::duration_cast<std::chrono::duration<float>>(now - _nfs_capture_last_time).count();
+		const float factor = std::clamp(1.0f / (static_cast<float>(_nfs_capture_fps) * interval), 0.01f, 4.0f);
+
+		*get_game_speed() = _nfs_capture_base_game_speed * factor;
+	}
+
+	_nfs_capture_last_time = now;
+	_nfs_capture_frame_count++;
+}
+
 bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path, bool reversed)
 {
 	std::error_code ec; // This is here to ignore file system errors below
@@ -1375,54 +2517,77 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 		}
 	}
 
+	// Only scan the directory again when files were added, removed or renamed in it since the last time
+	if (const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(filter_path, ec);
+		ec || filter_path != _preset_cycle_directory || modified_at != _preset_cycle_modified_at)
+	{
+		_preset_cycle_directory = filter_path;
+		_preset_cycle_modified_at = modified_at;
+		_preset_cycle_paths.clear();
+
+		for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+		{
+			// Skip anything that is not a valid preset file
+			if (resolve_preset_path(preset_path, ec))
+				_preset_cycle_paths.push_back(std::move(preset_path));
+		}
+	}
+
+	// Compare paths directly first and only fall back to the more costly check in case the current preset path is spelled differently (e.g. with different casing)
+	auto current_preset_it = std::find(_preset_cycle_paths.cbegin(), _preset_cycle_paths.cend(), _current_preset_path);
+	if (current_preset_it == _preset_cycle_paths.cend())
+		current_preset_it = std::find_if(_preset_cycle_paths.cbegin(), _preset_cycle_paths.cend(),
+			[this, &ec](const std::filesystem::path &preset_path) { return std::filesystem::equivalent(preset_path, _current_preset_path, ec); });
+
 	size_t current_preset_index = std::numeric_limits<size_t>::max();
-	std::vector<std::filesystem::path> preset_paths;
+	std::vector<const std::filesystem::path *> preset_paths;
+	preset_paths.reserve(_preset_cycle_paths.size());
 
-	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	for (auto it = _preset_cycle_paths.cbegin(); it != _preset_cycle_paths.cend(); ++it)
 	{
-		// Skip anything that is not a valid preset file
-		if (!resolve_preset_path(preset_path, ec))
-			continue;
-
 		// Keep track of the index of the current preset in the list of found preset files that is being build
-		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec))
+		if (it == current_preset_it)
 		{
 			current_preset_index = preset_paths.size();
-			preset_paths.push_back(std::move(preset_path));
+			preset_paths.push_back(&*it);
 			continue;
 		}
 
-		const std::wstring preset_name = preset_path.stem();
+		const std::wstring preset_name = it->stem();
 		// Only add those files that are matching the filter text
 		if (filter_text.empty() ||
 			std::search(preset_name.cbegin(), preset_name.cend(), filter_text.native().begin(), filter_text.native().end(),
 				[](auto c1, auto c2) { return std::towlower(c1) == std::towlower(c2); }) != preset_name.cend())
-			preset_paths.push_back(std::move(preset_path));
+			preset_paths.push_back(&*it);
 	}
 
 	if (preset_paths.empty())
 		return false; // No valid preset files were found, so nothing more to do
 
+	size_t next_preset_index;
 	if (current_preset_index == std::numeric_limits<size_t>::max())
-	{
 		// Current preset was not in the filter path, so just use the first or last file
-		if (reversed)
-			_current_preset_path = preset_paths.back();
-		else
-			_current_preset_path = preset_paths.front();
-	}
+		next_preset_index = reversed ? preset_paths.size() - 1 : 0;
 	else
-	{
 		// Current preset was found in the filter path, so use the file before or after it
-		if (auto it = std::next(preset_paths.begin(), current_preset_index); reversed)
-			_current_preset_path = (it == preset_paths.begin()) ? preset_paths.back() : *(--it);
-		else
-			_current_preset_path = (it == std::prev(preset_paths.end())) ? preset_paths.front() : *(++it);
-	}
+		next_preset_index = (current_preset_index + (reversed ? preset_paths.size() - 1 : 1)) % preset_paths.size();
+
+	_current_preset_path = *preset_paths[next_preset_index];
 
 	_last_preset_switching_time = _last_present_time;
 	_is_in_preset_transition = true;
 
+	// Parse the presets adjacent to the new one in the background, so that they are ready in the cache when switching to them next
+	if (preset_paths.size() > 2)
+	{
+		for (const size_t adjacent_preset_index : { (next_preset_index + 1) % preset_paths.size(), (next_preset_index + preset_paths.size() - 1) % preset_paths.size() })
+		{
+			_worker_pool->submit(thread_pool::priority::low, [preset_path = *preset_paths[adjacent_preset_index]]() {
+				ini_file::load_cache(preset_path);
+			});
+		}
+	}
+
 	return true;
 }
 
@@ -1438,14 +2603,24 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	attributes += "color_space=" + std::to_string(static_cast<uint32_t>(_effect_permutations[permutation_index].color_space)) + ';';
 	attributes += "color_format=" + std::to_string(static_cast<uint32_t>(_effect_permutations[permutation_index].color_format)) + ';';
 	attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
-	attributes += "performance_mode=" + std::string(_performance_mode ? "1" : "0") + ';';
-	attributes += "vendor=" + std::to_string(_vendor_id) + ';';
-	attributes += "device=" + std::to_string(_device_id) + ';';
-
 	const std::string effect_name = source_file.filename().u8string();
 
-	std::vector<std::pair<std::string, std::string>> preprocessor_definitions = _global_preprocessor_definitions;
-	// Insert preset preprocessor definitions before global ones, so that if there are duplicates, the preset ones are used (since 'add_macro_definition' succeeds only for the first occurance)
+	const startup_trace::scoped_span trace_span("runtime::load_effect", effect_name);
+
+	// Individual effects may be compiled with their uniform values baked in as well (see 'update_adaptive_performance_mode')
+	bool performance_mode = _performance_mode;
+	if (!performance_mode)
+	{
+		const std::shared_lock<std::shared_mutex> lock(_reload_mutex);
+		performance_mode = std::find(_baked_effects.begin(), _baked_effects.end(), effect_name) != _baked_effects.end();
+	}
+
+	attributes += "performance_mode=" + std::string(performance_mode ? "1" : "0") + ';';
+	attributes += "vendor=" + std::to_string(_vendor_id) + ';';
+	attributes += "device=" + std::to_string(_device_id) + ';';
+
+	std::vector<std::pair<std::string, std::string>> preprocessor_definitions = _global_preprocessor_definitions;
+	// Insert preset preprocessor definitions before global ones, so that if there are duplicates, the preset ones are used (since 'add_macro_definition' succeeds only for the first occurance)
 	if (const auto preset_it = _preset_preprocessor_definitions.find({});
 		preset_it != _preset_preprocessor_definitions.end())
 		preprocessor_definitions.insert(preprocessor_definitions.begin(), preset_it->second.cbegin(), preset_it->second.cend());
@@ -1501,17 +2676,45 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	attributes += std::to_string(std::filesystem::last_write_time(source_file, ec).time_since_epoch().count());
 	attributes += ';';
 
-	// The actual included files are not known at this point, so detect changes to any ".fxh" files in the search paths
-	for (const std::filesystem::path &include_path : include_paths)
+	// Look up the files this effect included the last time it was preprocessed, so that only changes to those invalidate it
+	const std::string dependency_cache_id = source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(std::hash<std::wstring>()(source_file.native()));
+	std::vector<std::filesystem::path> dependencies;
+	if (std::string dependency_list; load_effect_cache(dependency_cache_id, "d", dependency_list))
+	{
+		for (size_t offset = 0, next; offset < dependency_list.size(); offset = next + 1)
+		{
+			next = dependency_list.find('\n', offset);
+			if (next == std::string::npos)
+				next = dependency_list.size();
+			if (next != offset)
+				dependencies.push_back(std::filesystem::u8path(dependency_list.substr(offset, next - offset)));
+		}
+	}
+
+	if (!dependencies.empty())
+	{
+		for (const std::filesystem::path &dependency : dependencies)
+		{
+			attributes += dependency.u8string();
+			attributes += '?';
+			attributes += std::to_string(std::filesystem::last_write_time(dependency, ec).time_since_epoch().count());
+			attributes += ';';
+		}
+	}
+	else
 	{
-		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
+		// The actual included files are not known at this point, so detect changes to any ".fxh" files in the search paths
+		for (const std::filesystem::path &include_path : include_paths)
 		{
-			if (entry.path().extension() == L".fxh")
+			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
 			{
-				attributes += entry.path().filename().u8string();
-				attributes += '?';
-				attributes += std::to_string(entry.last_write_time(ec).time_since_epoch().count());
-				attributes += ';';
+				if (entry.path().extension() == L".fxh")
+				{
+					attributes += entry.path().filename().u8string();
+					attributes += '?';
+					attributes += std::to_string(entry.last_write_time(ec).time_since_epoch().count());
+					attributes += ';';
+				}
 			}
 		}
 	}
@@ -1528,24 +2731,46 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		effect.addon = source_file.extension() == L".addonfx";
 	}
 
-	if (_effect_load_skipping && !force_load)
+	// Check whether any technique enabled in the current preset could be declared in this effect
+	bool used_by_preset = true;
+	if (!force_load)
 	{
 		if (std::vector<std::string> techniques;
 			preset.get({}, "Techniques", techniques) && !techniques.empty())
 		{
-			effect.skipped = std::find_if(techniques.cbegin(), techniques.cend(),
+			used_by_preset = std::find_if(techniques.cbegin(), techniques.cend(),
 				[&effect_name](const std::string &technique) {
 					const size_t at_pos = technique.find('@') + 1;
 					return at_pos == 0 || technique.find(effect_name, at_pos) == at_pos;
-				}) == techniques.cend();
+				}) != techniques.cend();
+		}
+	}
 
-			if (effect.skipped)
-			{
-				if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
-					_reload_remaining_effects--;
-				return false;
-			}
+	if (_effect_load_skipping && !force_load)
+	{
+		effect.skipped = !used_by_preset;
+
+		if (effect.skipped)
+		{
+			if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
+				_reload_remaining_effects--;
+			return false;
+		}
+	}
+
+	// Effects that are not used by the current preset are only parsed for their techniques, uniforms and textures to list them in the overlay, without compiling any shaders
+	// The shaders are compiled once one of its techniques is enabled (see 'enable_technique')
+	const bool metadata_only = !used_by_preset && permutation_index == 0;
+	if (permutation_index == 0)
+	{
+		// No code generator is kept around after parsing, so an effect that was only parsed before has to be processed from the start again to compile its shaders
+		if (effect.metadata_only && !metadata_only)
+		{
+			effect.compiled = false;
+			effect.preprocessed = false;
 		}
+
+		effect.metadata_only = metadata_only;
 	}
 
 	if (permutation_index >= effect.permutations.size())
@@ -1560,11 +2785,62 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	std::string source;
 	std::string errors;
 
-	if (!preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "i", source)) == false))
+	// The attributes do not include the full paths that affect which files are included, so add those to tell identical effects of different runtimes apart
+	std::string shared_module_attributes = attributes;
+	shared_module_attributes += source_file.u8string();
+	shared_module_attributes += '?';
+	for (const std::filesystem::path &include_path : include_paths)
+		shared_module_attributes += include_path.u8string() + ';';
+	shared_module_attributes += "debug_info=" + std::string(_no_debug_info ? "0" : "1") + ';';
+	const size_t shared_module_key = std::hash<std::string>()(shared_module_attributes);
+	const std::string shared_module_cache_id = source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(shared_module_key);
+
+	// Another runtime on the same device may have loaded this effect with identical inputs already, in which case its results are reused instead of preprocessing and parsing it again
+	std::shared_ptr<const shared_effect_module> shared_module;
+	if (!compiled && !preprocess_required)
+	{
+		shared_module = _shared_effect_modules->find(shared_module_key);
+
+		// Otherwise try the module that was serialized to the effect cache the last time this effect was parsed with identical inputs
+		if (std::string data; shared_module == nullptr && load_effect_cache(shared_module_cache_id, "m", data))
+		{
+			const auto cached_module = std::make_shared<shared_effect_module>();
+			{ const startup_trace::scoped_span deserialize_trace_span("Deserialize", effect_name);
+				if (!deserialize_shared_effect_module(data, *cached_module))
+				{
+					log::message(log::level::warning, "Ignoring invalid cached effect module for '%s'.", effect_name.c_str());
+				}
+				else
+				{
+					cached_module->dependency_hash = compute_dependency_hash(source_file, cached_module->included_files);
+
+					_shared_effect_modules->add(shared_module_key, cached_module);
+
+					shared_module = cached_module;
+				}
+			}
+		}
+	}
+
+	if (shared_module != nullptr)
+	{
+		preprocessed = true;
+		skip_optimization = shared_module->skip_optimization;
+		code_preamble = shared_module->code_preamble;
+		errors += shared_module->errors;
+
+		if (permutation_index == 0)
+		{
+			effect.definitions = shared_module->definitions;
+			effect.included_files = shared_module->included_files;
+			effect.dependency_hash = shared_module->dependency_hash;
+		}
+	}
+	else if (!preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "i", source)) == false))
 	{
 		reshadefx::preprocessor pp;
 		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-		pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0");
+		pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", performance_mode ? "1" : "0");
 		pp.add_macro_definition("__VENDOR__", std::to_string(_vendor_id));
 		pp.add_macro_definition("__DEVICE__", std::to_string(_device_id));
 		pp.add_macro_definition("__RENDERER__", std::to_string(_renderer_id));
@@ -1602,7 +2878,9 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			"#define tex2Dgather3 tex2DgatherA\n");
 
 		// Load and preprocess the source file
-		preprocessed = pp.append_file(source_file);
+		{ const startup_trace::scoped_span preprocess_trace_span("Preprocess", effect_name);
+			preprocessed = pp.append_file(source_file);
+		}
 
 		// Append preprocessor errors to the error list
 		errors += pp.errors();
@@ -1656,12 +2934,31 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			// Keep track of included files
 			effect.included_files = pp.included_files();
 			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+
+			// Update the dependency list for the next load if the set of included files changed
+			if (preprocessed && effect.included_files != dependencies)
+			{
+				std::string dependency_list;
+				for (const std::filesystem::path &included_file : effect.included_files)
+					dependency_list += included_file.u8string() + '\n';
+
+				save_effect_cache(dependency_cache_id, "d", dependency_list);
+			}
+
+			effect.dependency_hash = compute_dependency_hash(source_file, effect.included_files);
 		}
 	}
 	else
 	{
 		if (permutation_index == 0 && !source.empty())
 		{
+			// Source was loaded from the cache, so the included files are those from the dependency list it was looked up with
+			if (!preprocessed)
+			{
+				effect.included_files = dependencies;
+				effect.dependency_hash = compute_dependency_hash(source_file, effect.included_files);
+			}
+
 			effect.definitions.clear();
 
 			// Read used preprocessor definitions and pragmas from the cached source
@@ -1690,45 +2987,89 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	}
 
 	std::unique_ptr<reshadefx::codegen> codegen;
-	if (!compiled && !source.empty())
-	{
-		unsigned shader_model;
-		if (_renderer_id == 0x9000)
-			shader_model = 30; // D3D9
-		else if (_renderer_id < 0xa100)
-			shader_model = 40; // D3D10 (including feature level 9)
-		else if (_renderer_id < 0xb000)
-			shader_model = 41; // D3D10.1
-		else if (_renderer_id < 0xc000)
-			shader_model = 50; // D3D11
+	if (!compiled && (shared_module != nullptr || !source.empty()))
+	{
+		if (shared_module != nullptr)
+		{
+			compiled = true;
+
+			permutation.module = shared_module->module;
+			// The shared module already holds a copy of the generated code, so only duplicate it if a discard is not requested anyway
+			if (!_discard_generated_code)
+				permutation.generated_code = shared_module->generated_code;
+			permutation.shared_module = shared_module;
+		}
 		else
-			shader_model = 51; // D3D12
+		{
+			unsigned shader_model;
+			if (_renderer_id == 0x9000)
+				shader_model = 30; // D3D9
+			else if (_renderer_id < 0xa100)
+				shader_model = 40; // D3D10 (including feature level 9)
+			else if (_renderer_id < 0xb000)
+				shader_model = 41; // D3D10.1
+			else if (_renderer_id < 0xc000)
+				shader_model = 50; // D3D11
+			else
+				shader_model = 51; // D3D12
+
+			if ((_renderer_id & 0xF0000) == 0)
+				codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, performance_mode));
+			else if (_renderer_id < 0x20000)
+				codegen.reset(reshadefx::create_codegen_glsl(false, !_no_debug_info, performance_mode, false, true));
+			else // Vulkan uses SPIR-V input
+				codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, performance_mode, false, false));
 
-		if ((_renderer_id & 0xF0000) == 0)
-			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
-		else if (_renderer_id < 0x20000)
-			codegen.reset(reshadefx::create_codegen_glsl(false, !_no_debug_info, _performance_mode, false, true));
-		else // Vulkan uses SPIR-V input
-			codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, false));
+			reshadefx::parser parser;
 
-		reshadefx::parser parser;
+			// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
+			{ const startup_trace::scoped_span parse_trace_span("Parse", effect_name);
+				compiled = parser.parse(std::move(source), codegen.get());
+			}
 
-		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		compiled = parser.parse(std::move(source), codegen.get());
+			// Append parser errors to the error list
+			errors += parser.errors();
 
-		// Append parser errors to the error list
-		errors += parser.errors();
+			// Write result to effect module
+			permutation.module = codegen->module();
+			if (_device->get_api() != api::device_api::vulkan)
+				permutation.generated_code = codegen->finalize_code();
 
-		// Write result to effect module
-		permutation.module = codegen->module();
-		if (_device->get_api() != api::device_api::vulkan)
-			permutation.generated_code = codegen->finalize_code();
+			// Only share complete results, which effects that are only parsed for their metadata do not need
+			if (compiled && (preprocessed || source_cached) && !metadata_only)
+			{
+				const auto new_shared_module = std::make_shared<shared_effect_module>();
+				new_shared_module->module = permutation.module;
+				new_shared_module->generated_code = permutation.generated_code;
+				for (const std::pair<std::string, reshadefx::shader_type> &entry_point : permutation.module.entry_points)
+					new_shared_module->entry_point_code[entry_point.first] = codegen->finalize_code_for_entry_point(entry_point.first);
+				new_shared_module->code_preamble = code_preamble;
+				new_shared_module->skip_optimization = skip_optimization;
+				new_shared_module->errors = errors;
+				new_shared_module->included_files = effect.included_files;
+				new_shared_module->dependency_hash = effect.dependency_hash;
+				new_shared_module->definitions = effect.definitions;
+
+				_shared_effect_modules->add(shared_module_key, new_shared_module);
+
+				// Do not cache if any special pragma directives were used, to ensure they are read again next time (same as for the preprocessed source)
+				if (!skip_optimization)
+					_worker_pool->submit(thread_pool::priority::low, [this, shared_module_cache_id, new_shared_module]() { save_effect_cache(shared_module_cache_id, "m", serialize_shared_effect_module(*new_shared_module)); });
+
+				shared_module = new_shared_module;
+				permutation.shared_module = shared_module;
+
+				if (_discard_generated_code)
+					std::string().swap(permutation.generated_code);
+			}
+		}
 
 		if (compiled)
 		{
 			if (permutation_index == 0)
 			{
 				effect.uniforms.clear();
+				effect.special_uniforms.clear();
 
 				// Create space for all variables (aligned to 16 bytes)
 				effect.uniform_data_storage.resize((permutation.module.total_uniform_size + 15) & ~15);
@@ -1770,12 +3111,33 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 						variable.special = special_uniform::overlay_hovered;
 					else if (special == "screenshot")
 						variable.special = special_uniform::screenshot;
+					else if (special == "dynamic_resolution")
+						variable.special = special_uniform::dynamic_resolution;
+					else if (special == "nfs_gameflow")
+						variable.special = special_uniform::nfs_gameflow;
+					else if (special == "nfs_gamespeed")
+						variable.special = special_uniform::nfs_game_speed;
+					else if (special == "nfs_precipitation")
+						variable.special = special_uniform::nfs_precipitation;
+					else if (special == "nfs_fog")
+						variable.special = special_uniform::nfs_fog;
+					else if (special == "nfs_fogcolor")
+						variable.special = special_uniform::nfs_fog_color;
+					else if (special == "nfs_visualtreatment")
+						variable.special = special_uniform::nfs_visual_treatment;
+					else if (special == "nfs_vehicles")
+						variable.special = special_uniform::nfs_vehicles;
+					else if (special == "nfs_vehiclecount")
+						variable.special = special_uniform::nfs_vehicle_count;
 					else
 						variable.special = special_uniform::unknown;
 
 					// Copy initial data into uniform storage area
 					reset_uniform_value(variable);
 
+					if (variable.special != special_uniform::none && variable.special != special_uniform::unknown)
+						effect.special_uniforms.push_back(create_special_uniform_binding(variable, effect.uniforms.size()));
+
 					effect.uniforms.push_back(std::move(variable));
 				}
 			}
@@ -1874,7 +3236,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			}
 
 			// Fill all specialization constants with values from the current preset
-			if (_performance_mode)
+			if (performance_mode)
 			{
 				for (reshadefx::uniform &spec_constant : permutation.module.spec_constants)
 				{
@@ -1892,9 +3254,9 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 						break;
 					}
 
-					// Check if this is a split specialization constant and move data accordingly
-					if (spec_constant.type.is_scalar() && spec_constant.offset != 0)
-						spec_constant.initializer_value.as_uint[0] = spec_constant.initializer_value.as_uint[spec_constant.offset];
+					// Check if this is a split specialization constant and move data accordingly (offset is the index of the component it refers to)
+					if (_renderer_id >= 0x20000 && spec_constant.offset != 0)
+						spec_constant.initializer_value.as_uint[0] = spec_constant.initializer_value.as_uint[std::min(spec_constant.offset, 15u)];
 
 					if (_renderer_id >= 0x20000)
 						continue;
@@ -1934,6 +3296,53 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 					code_preamble += '\n';
 				}
+
+				// Keep values baked into just this effect editable, so that changing them can fall back to the generic version (see 'update_adaptive_performance_mode')
+				if (!_performance_mode && permutation_index == 0)
+				{
+					effect.baked_uniform_data.clear();
+
+					const size_t first_baked_uniform = effect.uniforms.size();
+
+					for (const reshadefx::uniform &spec_constant : permutation.module.spec_constants)
+					{
+						// Vulkan splits specialization constants into scalars, so combine those back into a single variable of the original type
+						if (_renderer_id >= 0x20000 && spec_constant.offset != 0 && effect.uniforms.size() > first_baked_uniform && effect.uniforms.back().name == spec_constant.name)
+						{
+							uniform &variable = effect.uniforms.back();
+							const uint32_t components = variable.type.components();
+							if (variable.type.is_array() && spec_constant.offset / components < variable.initializer_value.array_data.size())
+								variable.initializer_value.array_data[spec_constant.offset / components].as_uint[spec_constant.offset % components] = spec_constant.initializer_value.as_uint[0];
+							else if (spec_constant.offset < 16)
+								variable.initializer_value.as_uint[spec_constant.offset] = spec_constant.initializer_value.as_uint[0];
+							continue;
+						}
+
+						uniform variable = spec_constant;
+						variable.effect_index = effect_index;
+						variable.baked = true;
+
+						// Use the same layout as in the constant buffer, since that is what the value accessors expect
+						const uint32_t array_length = variable.type.is_array() ? variable.type.array_length : 1u;
+						variable.size = (variable.type.is_matrix() ? variable.type.rows * 16 : variable.type.is_array() ? 16 : variable.type.components() * 4) * array_length;
+						variable.offset = static_cast<uint32_t>(effect.baked_uniform_data.size());
+						effect.baked_uniform_data.resize(effect.baked_uniform_data.size() + ((variable.size + 15) & ~15));
+
+						if (_renderer_id >= 0x20000 && variable.type.is_array())
+						{
+							reshadefx::constant element = {};
+							element.as_uint[0] = variable.initializer_value.as_uint[0];
+							variable.initializer_value = {};
+							variable.initializer_value.array_data.resize(variable.type.array_length);
+							variable.initializer_value.array_data[0] = std::move(element);
+						}
+
+						effect.uniforms.push_back(std::move(variable));
+					}
+
+					for (size_t i = first_baked_uniform; i < effect.uniforms.size(); ++i)
+						reset_uniform_value(effect.uniforms[i]);
+				}
 			}
 		}
 		else if (!preprocessed)
@@ -1946,8 +3355,25 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 	if (compiled && (preprocessed || source_cached))
 	{
-		if (permutation.assembly.empty())
+		if (permutation.assembly.empty() && !metadata_only)
 		{
+			struct d3d_compile_job
+			{
+				std::string entry_point_name;
+				std::string hlsl;
+				std::string profile;
+				UINT compile_flags;
+				std::string cache_id;
+				bool succeeded = false;
+				std::string errors;
+			};
+
+			std::vector<d3d_compile_job> d3d_compile_jobs;
+
+			const auto finalize_code_for_entry_point = [&shared_module, &codegen](const std::string &entry_point_name) {
+				return shared_module != nullptr ? shared_module->entry_point_code.at(entry_point_name) : codegen->finalize_code_for_entry_point(entry_point_name);
+			};
+
 			// Compile shader modules
 			for (const std::pair<std::string, reshadefx::shader_type> &entry_point : permutation.module.entry_points)
 			{
@@ -1989,7 +3415,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 					}
 
 					hlsl += "#line 1\n"; // Reset line number, so it matches what is shown when viewing the generated code
-					hlsl += codegen->finalize_code_for_entry_point(entry_point.first);
+					hlsl += finalize_code_for_entry_point(entry_point.first);
 
 					std::string profile;
 					switch (entry_point.second)
@@ -2032,7 +3458,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 					UINT compile_flags = 0;
 					if (skip_optimization)
 						compile_flags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-					else if (_performance_mode)
+					else if (performance_mode)
 						compile_flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 					if (_renderer_id >= D3D_FEATURE_LEVEL_10_0)
 						compile_flags |= D3DCOMPILE_ENABLE_STRICTNESS;
@@ -2049,18 +3475,46 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 						effect.source_file.stem().u8string() + '-' + entry_point.first + '-' + std::to_string(_renderer_id) + '-' +
 						std::to_string(std::hash<std::string_view>()(hlsl_attributes) ^ std::hash<std::string_view>()(hlsl));
 
-					if (!load_effect_cache(cache_id, "cso", cso))
+					d3d_compile_jobs.push_back({ entry_point.first, std::move(hlsl), std::move(profile), compile_flags, cache_id });
+				}
+				else
+				{
+					cso = finalize_code_for_entry_point(entry_point.first);
+
+					if (_renderer_id < 0x20000)
+					{
+						cso.insert(std::size("#version 430\n") - 1, code_preamble);
+
+						// GLSL is its own text representation, so can simply use the code again when it is needed (see 'get_assembly_text')
+						if (!_discard_generated_code)
+							cso_text = cso;
+					}
+				}
+			}
+
+			// The entry points are independent of each other, so compile them all at once instead of one after another
+			if (compiled)
+			{
+				_worker_pool->parallel_for(thread_pool::priority::high, d3d_compile_jobs.size(), [this, &permutation, &d3d_compile_jobs](size_t job_index) {
+					d3d_compile_job &job = d3d_compile_jobs[job_index];
+
+					std::string &cso = permutation.assembly.at(job.entry_point_name);
+					std::string &cso_text = permutation.assembly_text.at(job.entry_point_name);
+
+					if (!load_effect_cache(job.cache_id, "cso", cso))
 					{
+						const startup_trace::scoped_span compile_trace_span("D3DCompile", job.entry_point_name);
+
 						const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler_module), "D3DCompile"));
 						assert(D3DCompile != nullptr);
 
 						com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
 						const HRESULT hr = D3DCompile(
-							hlsl.data(), hlsl.size(),
+							job.hlsl.data(), job.hlsl.size(),
 							nullptr, nullptr, nullptr,
-							entry_point.first.c_str(),
-							profile.c_str(),
-							compile_flags, 0,
+							job.entry_point_name.c_str(),
+							job.profile.c_str(),
+							job.compile_flags, 0,
 							&d3d_compiled, &d3d_errors);
 
 						std::string d3d_errors_string;
@@ -2096,25 +3550,26 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 						{
 							// Add a prefix with the offending entry point name for generic error messages like an out of memory notification
 							if (d3d_errors_string.find("error") == std::string::npos)
-								errors += "error: " + entry_point.first + ": ";
+								job.errors += "error: " + job.entry_point_name + ": ";
 
-							errors += d3d_errors_string;
-							compiled = false;
-							break;
+							job.errors += d3d_errors_string;
+							return;
 						}
 						else
 						{
 							// Append warnings
-							errors += d3d_errors_string;
+							job.errors += d3d_errors_string;
 						}
 
 						cso.resize(d3d_compiled->GetBufferSize());
 						std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
 
-						save_effect_cache(cache_id, "cso", cso);
+						// Writing the cache is not needed to finish loading, so defer it behind all pending compilation work
+						_worker_pool->submit(thread_pool::priority::low, [this, cache_id = job.cache_id, cso]() { save_effect_cache(cache_id, "cso", cso); });
 					}
 
-					if (!load_effect_cache(cache_id, "asm", cso_text))
+					// Disassembly is only needed for the code editor, so skip it if it would be discarded anyway and rather disassemble on demand (see 'get_assembly_text')
+					if (!_discard_generated_code && !load_effect_cache(job.cache_id, "asm", cso_text))
 					{
 						const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler_module), "D3DDisassemble"));
 						assert(D3DDisassemble != nullptr);
@@ -2123,19 +3578,18 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 						if (SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
 							cso_text.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
 
-						save_effect_cache(cache_id, "asm", cso_text);
+						_worker_pool->submit(thread_pool::priority::low, [this, cache_id = job.cache_id, cso_text]() { save_effect_cache(cache_id, "asm", cso_text); });
 					}
-				}
-				else
-				{
-					cso = codegen->finalize_code_for_entry_point(entry_point.first);
 
-					if (_renderer_id < 0x20000)
-					{
-						cso.insert(std::size("#version 430\n") - 1, code_preamble);
+					job.succeeded = true;
+				});
 
-						cso_text = cso;
-					}
+				// Report errors in entry point order, so that the output does not depend on which compilation finished first
+				for (const d3d_compile_job &job : d3d_compile_jobs)
+				{
+					errors += job.errors;
+					if (!job.succeeded)
+						compiled = false;
 				}
 			}
 		}
@@ -2154,11 +3608,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			}
 
 			// Try to share textures with the same name across effects
-			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-					[&new_texture](const texture &item) {
-						return item.unique_name == new_texture.unique_name;
-					});
-				existing_texture != _textures.end())
+			if (texture *const existing_texture = find_texture(new_texture.unique_name);
+				existing_texture != nullptr)
 			{
 				// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
 				if (new_texture.semantic != existing_texture->semantic)
@@ -2256,6 +3707,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			// This is the first effect using this texture
 			new_texture.shared.push_back(effect_index);
 
+			_texture_name_index.emplace(new_texture.unique_name, _textures.size());
 			_textures.push_back(std::move(new_texture));
 		}
 
@@ -2263,6 +3715,18 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		{
 			new_technique.effect_index = effect_index;
 
+			for (technique::pass &pass : new_technique.permutations[0].passes)
+			{
+				if (pass.skip_uniform_name.empty())
+					continue;
+
+				// Uniforms that were turned into specialization constants are not in the list, but those are compiled into the shader anyway
+				if (const auto it = std::find_if(effect.uniforms.cbegin(), effect.uniforms.cend(),
+						[&pass](const uniform &variable) { return variable.name == pass.skip_uniform_name && variable.type.is_boolean() && variable.type.is_scalar(); });
+					it != effect.uniforms.cend())
+					pass.skip_uniform_index = std::distance(effect.uniforms.cbegin(), it);
+			}
+
 			if (const auto existing_technique = std::find_if(_techniques.begin(), _techniques.end(),
 					[&new_technique](const technique &item) {
 						return item.effect_index == new_technique.effect_index && item.name == new_technique.name;
@@ -2281,6 +3745,14 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 			new_technique.hidden = new_technique.annotation_as_int("hidden") != 0;
 			new_technique.enabled_in_screenshot = new_technique.annotation_as_int("enabled_in_screenshot", 0, true) != 0;
+			update_gameflow_state_mask(new_technique);
+			update_render_stage(new_technique);
+
+			new_technique.update_interval = std::max(new_technique.annotation_as_int("update_interval", 0, 1), 1);
+			new_technique.dynamic_resolution = new_technique.annotation_as_int("dynamic_resolution") != 0;
+			if (new_technique.dynamic_resolution)
+				effect.min_resolution_scale = std::min(effect.min_resolution_scale, std::clamp(new_technique.annotation_as_float("dynamic_resolution_min", 0, 0.5f), 0.25f, 1.0f));
+			new_technique.foveated = new_technique.annotation_as_int("foveated") != 0;
 
 			if (new_technique.annotation_as_int("enabled"))
 				enable_technique(new_technique);
@@ -2291,12 +3763,15 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	}
 
 	effect.compiled = compiled;
+	effect.last_uniform_change_time = std::chrono::high_resolution_clock::now();
 	effect.preprocessed = preprocessed;
 
 	if (!errors.empty())
 		effect.errors = std::move(errors);
 
 	const std::chrono::high_resolution_clock::time_point time_load_finished = std::chrono::high_resolution_clock::now();
+	if (permutation_index == 0)
+		effect.load_duration = std::chrono::duration<float, std::milli>(time_load_finished - time_load_started).count();
 
 	if (_reload_remaining_effects != 0 && _reload_remaining_effects != std::numeric_limits<size_t>::max())
 		_reload_remaining_effects--;
@@ -2322,12 +3797,70 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		return false;
 	}
 }
+/// <summary>
+/// Finds the only technique that references the specified texture, provided that it overwrites the texture before reading from it, which means its contents do not have to survive between techniques.
+/// </summary>
+static const reshadefx::technique *find_exclusive_technique(const reshadefx::effect_module &module, const std::string &texture_name)
+{
+	const reshadefx::technique *exclusive_technique = nullptr;
+
+	for (const reshadefx::technique &tech : module.techniques)
+	{
+		bool referenced = false;
+
+		for (const reshadefx::pass &pass : tech.passes)
+		{
+			// Storage writes may only touch parts of the texture, so cannot tell whether it is overwritten
+			for (const reshadefx::storage_binding &binding : pass.storage_bindings)
+				if (module.storages[binding.index].texture_name == texture_name)
+					return nullptr;
+
+			bool read = false;
+			for (const reshadefx::texture_binding &binding : pass.texture_bindings)
+				if (module.samplers[binding.index].texture_name == texture_name)
+					read = true;
+
+			bool written = false;
+			bool overwritten = true;
+			for (int i = 0; i < 8 && !pass.render_target_names[i].empty(); ++i)
+			{
+				if (pass.render_target_names[i] != texture_name)
+					continue;
+
+				written = true;
+				// Blending and partial write masks preserve previous contents, unless the render target is cleared first
+				if (!pass.clear_render_targets && (pass.blend_enable[i] || pass.render_target_write_mask[i] != 0xF))
+					overwritten = false;
+			}
+
+			if (!read && !written)
+				continue;
+
+			// The first pass to reference the texture has to overwrite it without reading from it
+			if (!referenced && (read || !overwritten))
+				return nullptr;
+			referenced = true;
+		}
+
+		if (!referenced)
+			continue;
+		if (exclusive_technique != nullptr)
+			return nullptr;
+		exclusive_technique = &tech;
+	}
+
+	return exclusive_technique;
+}
+
 bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_index)
 {
 	effect &effect = _effects[effect_index];
 
 	if (!effect.compiled)
 		return false;
+	assert(!effect.metadata_only || permutation_index != 0);
+
+	const startup_trace::scoped_span trace_span("runtime::create_effect", effect.source_file.filename().u8string());
 
 	effect::permutation &permutation = effect.permutations[permutation_index];
 
@@ -2337,6 +3870,31 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		if (tex.resource != 0 || std::find(tex.shared.cbegin(), tex.shared.cend(), effect_index) == tex.shared.cend())
 			continue;
 
+		// Intermediate render targets that only a single technique uses can share their resource with those of other techniques (unless opted out of with a "transient = false" annotation)
+		if (tex.render_target && !tex.storage_access && tex.semantic.empty() && tex.shared.size() == 1 &&
+			!tex.annotation_as_int("pooled") && tex.annotation_as_int("transient", 0, 1) != 0 && tex.annotation_as_string("source").empty())
+		{
+			if (const reshadefx::technique *const exclusive_technique = find_exclusive_technique(permutation.module, tex.unique_name);
+				exclusive_technique != nullptr)
+			{
+				const auto tech = std::find_if(_techniques.begin(), _techniques.end(),
+					[effect_index, exclusive_technique](const technique &item) { return item.effect_index == effect_index && item.name == exclusive_technique->name; });
+
+				// Techniques that are only updated every few frames rely on their intermediate results surviving until the next update
+				if (tech != _techniques.end() && tech->update_interval <= 1)
+				{
+					if (!create_transient_texture(tex, tech->name))
+					{
+						effect.errors += "Failed to create texture " + tex.unique_name + '.';
+						return false;
+					}
+
+					tech->uses_transient_textures = true;
+					continue;
+				}
+			}
+		}
+
 		if (!create_texture(tex))
 		{
 			effect.errors += "Failed to create texture " + tex.unique_name + '.';
@@ -2344,19 +3902,24 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		}
 	}
 
+	// Intern texture semantics, so that they do not have to be looked up by name while rendering
+	permutation.texture_semantic_ids.clear();
+	for (const reshadefx::texture &tex : permutation.module.textures)
+		if (!tex.semantic.empty() && tex.semantic != "COLOR")
+			permutation.texture_semantic_ids.push_back(intern_texture_semantic(tex.semantic));
+
 	// Build specialization constants
 	std::vector<uint32_t> spec_data;
 	std::vector<uint32_t> spec_constants;
-	for (const reshadefx::uniform &spec_constant : permutation.module.spec_constants)
-	{
-		uint32_t id = static_cast<uint32_t>(spec_constants.size());
-		spec_data.push_back(spec_constant.initializer_value.as_uint[0]);
-		spec_constants.push_back(id);
-	}
+	build_specialization_constants(permutation.module, spec_constants, spec_data);
 
 	// Create optional query heap for time measurements
+	size_t query_count = 0;
+	for (const reshadefx::technique &tech : permutation.module.techniques)
+		query_count += (2 + tech.passes.size()) * technique::QUERY_RING_SIZE;
+
 	if (permutation_index == 0 &&
-		!_device->create_query_heap(api::query_type::timestamp, static_cast<uint32_t>(permutation.module.techniques.size() * 2 * 4), &effect.query_heap))
+		!_device->create_query_heap(api::query_type::timestamp, static_cast<uint32_t>(query_count), &effect.query_heap))
 	{
 		log::message(log::level::error, "Failed to create query heap for effect file '%s'!", effect.source_file.u8string().c_str());
 	}
@@ -2431,37 +3994,10 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 	sampler_descriptors.resize(std::max(sampler_range.count, srv_range.count) * total_pass_count);
 
 	// Create pipeline layout for this effect
+	if (!create_effect_pipeline_layout(cb_range, sampler_range, srv_range, uav_range, permutation.layout))
 	{
-		api::pipeline_layout_param layout_params[4];
-		layout_params[0].type = api::pipeline_layout_param_type::descriptor_table;
-		layout_params[0].descriptor_table.count = 1;
-		layout_params[0].descriptor_table.ranges = &cb_range;
-
-		layout_params[1].type = api::pipeline_layout_param_type::descriptor_table;
-		layout_params[1].descriptor_table.count = 1;
-		layout_params[1].descriptor_table.ranges = &sampler_range;
-
-		layout_params[2].type = api::pipeline_layout_param_type::descriptor_table;
-		layout_params[2].descriptor_table.count = 1;
-
-		layout_params[3].type = api::pipeline_layout_param_type::descriptor_table;
-		layout_params[3].descriptor_table.count = 1;
-
-		if (sampler_with_resource_view)
-		{
-			layout_params[2].descriptor_table.ranges = &uav_range;
-		}
-		else
-		{
-			layout_params[2].descriptor_table.ranges = &srv_range;
-			layout_params[3].descriptor_table.ranges = &uav_range;
-		}
-
-		if (!_device->create_pipeline_layout(sampler_with_resource_view ? 3 : 4, layout_params, &permutation.layout))
-		{
-			log::message(log::level::error, "Failed to create pipeline layout for effect file '%s'!", effect.source_file.u8string().c_str());
-			return false;
-		}
+		log::message(log::level::error, "Failed to create pipeline layout for effect file '%s'!", effect.source_file.u8string().c_str());
+		return false;
 	}
 
 	// Create global constant buffer (except in D3D9, which does not have constant buffers)
@@ -2479,6 +4015,9 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 			}
 
 			_device->set_resource_name(effect.cb, "ReShade constant buffer");
+
+			// The new constant buffer has undefined contents, so has to be filled completely
+			effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 		}
 		else
 		{
@@ -2529,7 +4068,8 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 	}
 
 	// Initialize techniques and passes
-	for (size_t tech_index = 0, pass_index_in_effect = 0, tech_index_in_effect = 0; tech_index < _techniques.size(); ++tech_index)
+	uint32_t query_index_in_effect = 0;
+	for (size_t tech_index = 0, pass_index_in_effect = 0; tech_index < _techniques.size(); ++tech_index)
 	{
 		technique &tech = _techniques[tech_index];
 
@@ -2538,10 +4078,14 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 		assert(permutation_index < tech.permutations.size() && !tech.permutations[permutation_index].created);
 
-		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
+		// Offset index so that queries exist for each slot in the ring of frames in flight, with two subsequent ones used for before/after stamps and one more for each pass
 		if (permutation_index == 0)
-			tech.query_base_index = static_cast<uint32_t>(tech_index_in_effect * 2 * 4);
-		++tech_index_in_effect;
+		{
+			tech.query_base_index = query_index_in_effect;
+			tech.query_stride = static_cast<uint32_t>(2 + tech.permutations[permutation_index].passes.size());
+			tech.average_pass_gpu_durations.assign(tech.permutations[permutation_index].passes.size(), {});
+			query_index_in_effect += tech.query_stride * technique::QUERY_RING_SIZE;
+		}
 
 		for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index, ++pass_index_in_effect)
 		{
@@ -2549,302 +4093,98 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 			pass.texture_table = shader_resource_view_tables[pass_index_in_effect];
 			pass.storage_table = unordered_access_view_tables[pass_index_in_effect];
 
-			std::vector<api::pipeline_subobject> subobjects;
+			if (!create_effect_pipeline(effect_index, permutation_index, tech, pass_index, spec_constants, spec_data, pass.pipeline))
+				return false;
 
-			if (!pass.cs_entry_point.empty())
+			for (const reshadefx::sampler_binding &info : pass.sampler_bindings)
 			{
-				api::shader_desc cs_desc = {};
-				const std::string &cs = permutation.assembly.at(pass.cs_entry_point);
-				cs_desc.code = cs.data();
-				cs_desc.code_size = cs.size();
-				if (_renderer_id & 0x20000)
-				{
-					cs_desc.entry_point = pass.cs_entry_point.c_str();
-					cs_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
-					cs_desc.spec_constant_ids = spec_constants.data();
-					cs_desc.spec_constant_values = spec_data.data();
-				}
+				api::sampler &sampler_handle = sampler_descriptors[pass_index_in_effect * sampler_range.count + info.entry_point_binding].sampler;
 
-				subobjects.push_back({ api::pipeline_subobject_type::compute_shader, 1, &cs_desc });
+				assert(info.entry_point_binding < 16 || sampler_with_resource_view);
 
-				if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pass.pipeline))
+				// Only initialize sampler if it has not been created before
+				if (sampler_with_resource_view || 0 == (sampler_list & (1 << info.entry_point_binding)))
 				{
-					effect.errors += "error: internal compiler error";
+					if (!sampler_with_resource_view)
+						sampler_list |= (1 << info.entry_point_binding); // Maximum sampler slot count is 16, so a 16-bit integer is enough to hold all bindings
 
-					log::message(log::level::error, "Failed to create compute pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
-					return false;
-				}
-			}
-			else
-			{
-				api::shader_desc vs_desc = {};
-				if (!pass.vs_entry_point.empty())
-				{
-					const std::string &vs = permutation.assembly.at(pass.vs_entry_point);
-					vs_desc.code = vs.data();
-					vs_desc.code_size = vs.size();
-					if (_renderer_id & 0x20000)
+					if (!create_effect_sampler_state(permutation.module.samplers[info.index], sampler_handle))
 					{
-						vs_desc.entry_point = pass.vs_entry_point.c_str();
-						vs_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
-						vs_desc.spec_constant_ids = spec_constants.data();
-						vs_desc.spec_constant_values = spec_data.data();
+						log::message(log::level::error, "Failed to create sampler object in '%s'!", effect.source_file.u8string().c_str());
+						return false;
 					}
 
-					subobjects.push_back({ api::pipeline_subobject_type::vertex_shader, 1, &vs_desc });
+					api::descriptor_table_update &write = descriptor_writes.emplace_back();
+					write.table = sampler_with_resource_view ? pass.texture_table : permutation.sampler_table;
+					write.count = 1;
+					write.binding = info.entry_point_binding;
+					write.type = sampler_with_resource_view ? api::descriptor_type::sampler_with_resource_view : api::descriptor_type::sampler;
+					write.descriptors = &sampler_handle;
 				}
+			}
 
-				api::shader_desc ps_desc = {};
-				if (!pass.ps_entry_point.empty())
-				{
-					const std::string &ps = permutation.assembly.at(pass.ps_entry_point);
-					ps_desc.code = ps.data();
-					ps_desc.code_size = ps.size();
-					if (_renderer_id & 0x20000)
-					{
-						ps_desc.entry_point = pass.ps_entry_point.c_str();
-						ps_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
-						ps_desc.spec_constant_ids = spec_constants.data();
-						ps_desc.spec_constant_values = spec_data.data();
-					}
-
-					subobjects.push_back({ api::pipeline_subobject_type::pixel_shader, 1, &ps_desc });
-				}
+			for (const reshadefx::texture_binding &info : pass.texture_bindings)
+			{
+				const texture *const sampler_texture = find_texture(permutation.module.samplers[info.index].texture_name);
+				assert(sampler_texture != nullptr && (sampler_texture->resource != 0 || !sampler_texture->semantic.empty()));
 
-				api::format render_target_formats[8] = {};
+				api::resource_view &srv = sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].view;
 
-				if (pass.render_target_names[0].empty())
+				if (sampler_with_resource_view)
 				{
-					pass.viewport_width = _effect_permutations[permutation_index].width;
-					pass.viewport_height = _effect_permutations[permutation_index].height;
-
-					render_target_formats[0] = api::format_to_default_typed(_effect_permutations[permutation_index].color_format, pass.srgb_write_enable);
-
-					subobjects.push_back({ api::pipeline_subobject_type::render_target_formats, 1, &render_target_formats[0] });
+					// The sampler and descriptor table update for this 'sampler_with_resource_view' descriptor were already initialized above
+					assert(
+						srv_range.count == sampler_range.count &&
+						sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].sampler != 0);
 				}
 				else
 				{
-					int render_target_count = 0;
-					for (; render_target_count < 8 && !pass.render_target_names[render_target_count].empty(); ++render_target_count)
+					api::descriptor_table_update &write = descriptor_writes.emplace_back();
+					write.table = pass.texture_table;
+					write.binding = info.entry_point_binding;
+					write.type = api::descriptor_type::shader_resource_view;
+					write.count = 1;
+					write.descriptors = &srv;
+				}
+
+				if (!sampler_texture->semantic.empty())
+				{
+					if (sampler_texture->semantic == "COLOR")
 					{
-						const auto render_target_texture = std::find_if(_textures.cbegin(), _textures.cend(),
-							[&unique_name = pass.render_target_names[render_target_count]](const texture &item) {
-								return item.unique_name == unique_name && (item.resource != 0 || !item.semantic.empty());
-							});
-						assert(render_target_texture != _textures.cend());
-						assert(render_target_texture->semantic.empty() && render_target_texture->rtv[pass.srgb_write_enable] != 0);
-
-						if (std::find(pass.modified_resources.cbegin(), pass.modified_resources.cend(), render_target_texture->resource) == pass.modified_resources.cend())
-						{
-							pass.modified_resources.push_back(render_target_texture->resource);
+						srv = _effect_permutations[permutation_index].color_srv[info.srgb];
 
-							if (pass.generate_mipmaps && render_target_texture->levels > 1)
-								pass.generate_mipmap_views.push_back(render_target_texture->srv[0]);
-						}
-
-						const api::resource_desc res_desc = _device->get_resource_desc(render_target_texture->resource);
-
-						render_target_formats[render_target_count] = api::format_to_default_typed(res_desc.texture.format, pass.srgb_write_enable);
-
-						pass.render_target_views[render_target_count] = render_target_texture->rtv[pass.srgb_write_enable];
-					}
-
-					subobjects.push_back({ api::pipeline_subobject_type::render_target_formats, static_cast<uint32_t>(render_target_count), render_target_formats });
-				}
-
-				// Only need to attach stencil if stencil is actually used in this pass
-				if (pass.stencil_enable &&
-					pass.viewport_width == _effect_permutations[permutation_index].width &&
-					pass.viewport_height == _effect_permutations[permutation_index].height)
-				{
-					subobjects.push_back({ api::pipeline_subobject_type::depth_stencil_format, 1, &_effect_permutations[permutation_index].stencil_format });
-				}
-
-				subobjects.push_back({ api::pipeline_subobject_type::max_vertex_count, 1, &pass.num_vertices });
-
-				api::primitive_topology topology = static_cast<api::primitive_topology>(pass.topology);
-				subobjects.push_back({ api::pipeline_subobject_type::primitive_topology, 1, &topology });
-
-				const auto convert_blend_op = [](reshadefx::blend_op value) {
-					switch (value)
-					{
-					default:
-					case reshadefx::blend_op::add: return api::blend_op::add;
-					case reshadefx::blend_op::subtract: return api::blend_op::subtract;
-					case reshadefx::blend_op::reverse_subtract: return api::blend_op::reverse_subtract;
-					case reshadefx::blend_op::min: return api::blend_op::min;
-					case reshadefx::blend_op::max: return api::blend_op::max;
-					}
-				};
-				const auto convert_blend_factor = [](reshadefx::blend_factor value) {
-					switch (value) {
-					case reshadefx::blend_factor::zero: return api::blend_factor::zero;
-					default:
-					case reshadefx::blend_factor::one: return api::blend_factor::one;
-					case reshadefx::blend_factor::source_color: return api::blend_factor::source_color;
-					case reshadefx::blend_factor::one_minus_source_color: return api::blend_factor::one_minus_source_color;
-					case reshadefx::blend_factor::dest_color: return api::blend_factor::dest_color;
-					case reshadefx::blend_factor::one_minus_dest_color: return api::blend_factor::one_minus_dest_color;
-					case reshadefx::blend_factor::source_alpha: return api::blend_factor::source_alpha;
-					case reshadefx::blend_factor::one_minus_source_alpha: return api::blend_factor::one_minus_source_alpha;
-					case reshadefx::blend_factor::dest_alpha: return api::blend_factor::dest_alpha;
-					case reshadefx::blend_factor::one_minus_dest_alpha: return api::blend_factor::one_minus_dest_alpha;
-					}
-				};
-
-				// Technically should check for 'api::device_caps::independent_blend' support, but render target write masks are supported in D3D9, when rest is not, so just always set ...
-				api::blend_desc blend_state = {};
-				for (int i = 0; i < 8; ++i)
-				{
-					blend_state.blend_enable[i] = pass.blend_enable[i];
-					blend_state.source_color_blend_factor[i] = convert_blend_factor(pass.source_color_blend_factor[i]);
-					blend_state.dest_color_blend_factor[i] = convert_blend_factor(pass.dest_color_blend_factor[i]);
-					blend_state.color_blend_op[i] = convert_blend_op(pass.color_blend_op[i]);
-					blend_state.source_alpha_blend_factor[i] = convert_blend_factor(pass.source_alpha_blend_factor[i]);
-					blend_state.dest_alpha_blend_factor[i] = convert_blend_factor(pass.dest_alpha_blend_factor[i]);
-					blend_state.alpha_blend_op[i] = convert_blend_op(pass.alpha_blend_op[i]);
-					blend_state.render_target_write_mask[i] = pass.render_target_write_mask[i];
-				}
-
-				subobjects.push_back({ api::pipeline_subobject_type::blend_state, 1, &blend_state });
-
-				api::rasterizer_desc rasterizer_state = {};
-				rasterizer_state.cull_mode = api::cull_mode::none;
-
-				subobjects.push_back({ api::pipeline_subobject_type::rasterizer_state, 1, &rasterizer_state });
-
-				const auto convert_stencil_op = [](reshadefx::stencil_op value) {
-					switch (value) {
-					case reshadefx::stencil_op::zero: return api::stencil_op::zero;
-					default:
-					case reshadefx::stencil_op::keep: return api::stencil_op::keep;
-					case reshadefx::stencil_op::replace: return api::stencil_op::replace;
-					case reshadefx::stencil_op::increment_saturate: return api::stencil_op::increment_saturate;
-					case reshadefx::stencil_op::decrement_saturate: return api::stencil_op::decrement_saturate;
-					case reshadefx::stencil_op::invert: return api::stencil_op::invert;
-					case reshadefx::stencil_op::increment: return api::stencil_op::increment;
-					case reshadefx::stencil_op::decrement: return api::stencil_op::decrement;
-					}
-				};
-				const auto convert_stencil_func = [](reshadefx::stencil_func value) {
-					switch (value)
-					{
-					case reshadefx::stencil_func::never: return api::compare_op::never;
-					case reshadefx::stencil_func::less: return api::compare_op::less;
-					case reshadefx::stencil_func::equal: return api::compare_op::equal;
-					case reshadefx::stencil_func::less_equal: return api::compare_op::less_equal;
-					case reshadefx::stencil_func::greater: return api::compare_op::greater;
-					case reshadefx::stencil_func::not_equal: return api::compare_op::not_equal;
-					case reshadefx::stencil_func::greater_equal: return api::compare_op::greater_equal;
-					default:
-					case reshadefx::stencil_func::always: return api::compare_op::always;
+						pass.samples_back_buffer = true;
 					}
-				};
-
-				api::depth_stencil_desc depth_stencil_state = {};
-				depth_stencil_state.depth_enable = false;
-				depth_stencil_state.depth_write_mask = false;
-				depth_stencil_state.depth_func = api::compare_op::always;
-				depth_stencil_state.stencil_enable = pass.stencil_enable;
-				depth_stencil_state.front_stencil_read_mask = pass.stencil_read_mask;
-				depth_stencil_state.front_stencil_write_mask = pass.stencil_write_mask;
-				depth_stencil_state.front_stencil_func = convert_stencil_func(pass.stencil_comparison_func);
-				depth_stencil_state.front_stencil_fail_op = convert_stencil_op(pass.stencil_fail_op);
-				depth_stencil_state.front_stencil_depth_fail_op = convert_stencil_op(pass.stencil_depth_fail_op);
-				depth_stencil_state.front_stencil_pass_op = convert_stencil_op(pass.stencil_pass_op);
-				depth_stencil_state.back_stencil_read_mask = depth_stencil_state.front_stencil_read_mask;
-				depth_stencil_state.back_stencil_write_mask = depth_stencil_state.front_stencil_write_mask;
-				depth_stencil_state.back_stencil_func = depth_stencil_state.front_stencil_func;
-				depth_stencil_state.back_stencil_fail_op = depth_stencil_state.front_stencil_fail_op;
-				depth_stencil_state.back_stencil_depth_fail_op = depth_stencil_state.front_stencil_depth_fail_op;
-				depth_stencil_state.back_stencil_pass_op = depth_stencil_state.front_stencil_pass_op;
-
-				subobjects.push_back({ api::pipeline_subobject_type::depth_stencil_state, 1, &depth_stencil_state });
-
-				if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pass.pipeline))
-				{
-					effect.errors += "error: internal compiler error";
-
-					log::message(log::level::error, "Failed to create graphics pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
-					return false;
-				}
-			}
-
-			for (const reshadefx::sampler_binding &info : pass.sampler_bindings)
-			{
-				api::sampler &sampler_handle = sampler_descriptors[pass_index_in_effect * sampler_range.count + info.entry_point_binding].sampler;
-
-				assert(info.entry_point_binding < 16 || sampler_with_resource_view);
-
-				// Only initialize sampler if it has not been created before
-				if (sampler_with_resource_view || 0 == (sampler_list & (1 << info.entry_point_binding)))
-				{
-					if (!sampler_with_resource_view)
-						sampler_list |= (1 << info.entry_point_binding); // Maximum sampler slot count is 16, so a 16-bit integer is enough to hold all bindings
-
-					if (!create_effect_sampler_state(permutation.module.samplers[info.index], sampler_handle))
+					else
 					{
-						log::message(log::level::error, "Failed to create sampler object in '%s'!", effect.source_file.u8string().c_str());
-						return false;
+						texture_semantic_binding &binding = _texture_semantic_bindings[intern_texture_semantic(sampler_texture->semantic)];
+
+						srv = info.srgb ? binding.srv_srgb : binding.srv;
+						if (srv == 0)
+							srv = _empty_srv;
+
+						// Keep track of the texture descriptor to simplify updating it
+						binding.descriptors.push_back({
+							effect_index,
+							permutation_index,
+							pass.texture_table,
+							info.entry_point_binding,
+							sampler_with_resource_view ? sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].sampler : api::sampler { 0 },
+							info.srgb
+						});
 					}
-
-					api::descriptor_table_update &write = descriptor_writes.emplace_back();
-					write.table = sampler_with_resource_view ? pass.texture_table : permutation.sampler_table;
-					write.count = 1;
-					write.binding = info.entry_point_binding;
-					write.type = sampler_with_resource_view ? api::descriptor_type::sampler_with_resource_view : api::descriptor_type::sampler;
-					write.descriptors = &sampler_handle;
-				}
-			}
-
-			for (const reshadefx::texture_binding &info : pass.texture_bindings)
-			{
-				const auto sampler_texture = std::find_if(_textures.cbegin(), _textures.cend(),
-					[&unique_name = permutation.module.samplers[info.index].texture_name](const texture &item) {
-						return item.unique_name == unique_name && (item.resource != 0 || !item.semantic.empty());
-					});
-				assert(sampler_texture != _textures.cend());
-
-				api::resource_view &srv = sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].view;
-
-				if (sampler_with_resource_view)
-				{
-					// The sampler and descriptor table update for this 'sampler_with_resource_view' descriptor were already initialized above
-					assert(
-						srv_range.count == sampler_range.count &&
-						sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].sampler != 0);
-				}
-				else
-				{
-					api::descriptor_table_update &write = descriptor_writes.emplace_back();
-					write.table = pass.texture_table;
-					write.binding = info.entry_point_binding;
-					write.type = api::descriptor_type::shader_resource_view;
-					write.count = 1;
-					write.descriptors = &srv;
-				}
-
-				if (!sampler_texture->semantic.empty())
-				{
-					if (sampler_texture->semantic == "COLOR")
-						srv = _effect_permutations[permutation_index].color_srv[info.srgb];
-					else if (const auto it = _texture_semantic_bindings.find(sampler_texture->semantic); it != _texture_semantic_bindings.end())
-						srv = info.srgb ? it->second.second : it->second.first;
-					else
-						srv = _empty_srv;
-
-					// Keep track of the texture descriptor to simplify updating it
-					permutation.texture_semantic_to_binding.push_back({
-						sampler_texture->semantic,
-						pass.texture_table,
-						info.entry_point_binding,
-						sampler_with_resource_view ? sampler_descriptors[pass_index_in_effect * srv_range.count + info.entry_point_binding].sampler : api::sampler { 0 },
-						info.srgb
-					});
 				}
 				else
 				{
 					srv = sampler_texture->srv[info.srgb];
+
+					if (std::find(pass.sampled_resources.cbegin(), pass.sampled_resources.cend(), sampler_texture->resource) == pass.sampled_resources.cend())
+						pass.sampled_resources.push_back(sampler_texture->resource);
+
+					// Any sample may select a lower mipmap level based on derivatives or an explicit level of detail, so cannot tell statically whether only the base level is read
+					if (sampler_texture->levels > 1 &&
+						std::find(pass.mipmap_dependent_views.cbegin(), pass.mipmap_dependent_views.cend(), sampler_texture->srv[0]) == pass.mipmap_dependent_views.cend())
+						pass.mipmap_dependent_views.push_back(sampler_texture->srv[0]);
 				}
 
 				assert(srv != 0);
@@ -2852,11 +4192,8 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 			for (const reshadefx::storage_binding &info : pass.storage_bindings)
 			{
-				const auto storage_texture = std::find_if(_textures.cbegin(), _textures.cend(),
-					[&unique_name = permutation.module.storages[info.index].texture_name](const texture &item) {
-						return item.unique_name == unique_name && (item.resource != 0 || !item.semantic.empty());
-					});
-				assert(storage_texture != _textures.cend());
+				const texture *const storage_texture = find_texture(permutation.module.storages[info.index].texture_name);
+				assert(storage_texture != nullptr);
 				assert(storage_texture->semantic.empty() && storage_texture->uav[permutation.module.storages[info.index].level] != 0);
 
 				if (std::find(pass.modified_resources.cbegin(), pass.modified_resources.cend(), storage_texture->resource) == pass.modified_resources.cend())
@@ -2867,6 +4204,11 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 						pass.generate_mipmap_views.push_back(storage_texture->srv[0]);
 				}
 
+				// Writing a lower mipmap level has to happen after any pending mipmap generation, which would otherwise overwrite it later
+				if (permutation.module.storages[info.index].level != 0 &&
+					std::find(pass.mipmap_dependent_views.cbegin(), pass.mipmap_dependent_views.cend(), storage_texture->srv[0]) == pass.mipmap_dependent_views.cend())
+					pass.mipmap_dependent_views.push_back(storage_texture->srv[0]);
+
 				api::descriptor_table_update &write = descriptor_writes.emplace_back();
 				write.table = pass.storage_table;
 				write.binding = info.entry_point_binding;
@@ -2891,6 +4233,306 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 	return true;
 }
+uint32_t reshade::runtime::intern_texture_semantic(const std::string_view semantic)
+{
+	if (const uint32_t semantic_id = find_texture_semantic(semantic);
+		semantic_id != std::numeric_limits<uint32_t>::max())
+		return semantic_id;
+
+	texture_semantic_binding &binding = _texture_semantic_bindings.emplace_back();
+	binding.semantic = semantic;
+
+	return static_cast<uint32_t>(_texture_semantic_bindings.size() - 1);
+}
+uint32_t reshade::runtime::find_texture_semantic(const std::string_view semantic) const
+{
+	// There are only ever a handful of different semantics, so a linear search is fastest
+	for (size_t semantic_id = 0; semantic_id < _texture_semantic_bindings.size(); ++semantic_id)
+		if (_texture_semantic_bindings[semantic_id].semantic == semantic)
+			return static_cast<uint32_t>(semantic_id);
+
+	return std::numeric_limits<uint32_t>::max();
+}
+bool reshade::runtime::create_effect_pipeline(size_t effect_index, size_t permutation_index, technique &tech, size_t pass_index, const std::vector<uint32_t> &spec_constants, const std::vector<uint32_t> &spec_data, api::pipeline &pipeline)
+{
+	effect &effect = _effects[effect_index];
+	const effect::permutation &permutation = effect.permutations[permutation_index];
+	technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+
+	std::vector<api::pipeline_subobject> subobjects;
+
+	if (!pass.cs_entry_point.empty())
+	{
+		api::shader_desc cs_desc = {};
+		const std::string &cs = permutation.assembly.at(pass.cs_entry_point);
+		cs_desc.code = cs.data();
+		cs_desc.code_size = cs.size();
+		if (_renderer_id & 0x20000)
+		{
+			cs_desc.entry_point = pass.cs_entry_point.c_str();
+			cs_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
+			cs_desc.spec_constant_ids = spec_constants.data();
+			cs_desc.spec_constant_values = spec_data.data();
+		}
+
+		subobjects.push_back({ api::pipeline_subobject_type::compute_shader, 1, &cs_desc });
+
+		if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pipeline))
+		{
+			effect.errors += "error: internal compiler error";
+
+			log::message(log::level::error, "Failed to create compute pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
+			return false;
+		}
+	}
+	else
+	{
+		api::shader_desc vs_desc = {};
+		if (!pass.vs_entry_point.empty())
+		{
+			const std::string &vs = permutation.assembly.at(pass.vs_entry_point);
+			vs_desc.code = vs.data();
+			vs_desc.code_size = vs.size();
+			if (_renderer_id & 0x20000)
+			{
+				vs_desc.entry_point = pass.vs_entry_point.c_str();
+				vs_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
+				vs_desc.spec_constant_ids = spec_constants.data();
+				vs_desc.spec_constant_values = spec_data.data();
+			}
+
+			subobjects.push_back({ api::pipeline_subobject_type::vertex_shader, 1, &vs_desc });
+		}
+
+		api::shader_desc ps_desc = {};
+		if (!pass.ps_entry_point.empty())
+		{
+			const std::string &ps = permutation.assembly.at(pass.ps_entry_point);
+			ps_desc.code = ps.data();
+			ps_desc.code_size = ps.size();
+			if (_renderer_id & 0x20000)
+			{
+				ps_desc.entry_point = pass.ps_entry_point.c_str();
+				ps_desc.spec_constants = static_cast<uint32_t>(permutation.module.spec_constants.size());
+				ps_desc.spec_constant_ids = spec_constants.data();
+				ps_desc.spec_constant_values = spec_data.data();
+			}
+
+			subobjects.push_back({ api::pipeline_subobject_type::pixel_shader, 1, &ps_desc });
+		}
+
+		api::format render_target_formats[8] = {};
+
+		if (pass.render_target_names[0].empty())
+		{
+			pass.viewport_width = _effect_permutations[permutation_index].width;
+			pass.viewport_height = _effect_permutations[permutation_index].height;
+
+			render_target_formats[0] = api::format_to_default_typed(_effect_permutations[permutation_index].color_format, pass.srgb_write_enable);
+
+			subobjects.push_back({ api::pipeline_subobject_type::render_target_formats, 1, &render_target_formats[0] });
+		}
+		else
+		{
+			int render_target_count = 0;
+			for (; render_target_count < 8 && !pass.render_target_names[render_target_count].empty(); ++render_target_count)
+			{
+				const texture *const render_target_texture = find_texture(pass.render_target_names[render_target_count]);
+				assert(render_target_texture != nullptr);
+				assert(render_target_texture->semantic.empty() && render_target_texture->rtv[pass.srgb_write_enable] != 0);
+
+				if (std::find(pass.modified_resources.cbegin(), pass.modified_resources.cend(), render_target_texture->resource) == pass.modified_resources.cend())
+				{
+					pass.modified_resources.push_back(render_target_texture->resource);
+
+					if (pass.generate_mipmaps && render_target_texture->levels > 1)
+						pass.generate_mipmap_views.push_back(render_target_texture->srv[0]);
+				}
+
+				const api::resource_desc res_desc = _device->get_resource_desc(render_target_texture->resource);
+
+				render_target_formats[render_target_count] = api::format_to_default_typed(res_desc.texture.format, pass.srgb_write_enable);
+
+				pass.render_target_views[render_target_count] = render_target_texture->rtv[pass.srgb_write_enable];
+			}
+
+			subobjects.push_back({ api::pipeline_subobject_type::render_target_formats, static_cast<uint32_t>(render_target_count), render_target_formats });
+		}
+
+		// Only need to attach stencil if stencil is actually used in this pass
+		if (pass.stencil_enable &&
+			pass.viewport_width == _effect_permutations[permutation_index].width &&
+			pass.viewport_height == _effect_permutations[permutation_index].height)
+		{
+			subobjects.push_back({ api::pipeline_subobject_type::depth_stencil_format, 1, &_effect_permutations[permutation_index].stencil_format });
+		}
+
+		subobjects.push_back({ api::pipeline_subobject_type::max_vertex_count, 1, &pass.num_vertices });
+
+		api::primitive_topology topology = static_cast<api::primitive_topology>(pass.topology);
+		subobjects.push_back({ api::pipeline_subobject_type::primitive_topology, 1, &topology });
+
+		const auto convert_blend_op = [](reshadefx::blend_op value) {
+			switch (value)
+			{
+			default:
+			case reshadefx::blend_op::add: return api::blend_op::add;
+			case reshadefx::blend_op::subtract: return api::blend_op::subtract;
+			case reshadefx::blend_op::reverse_subtract: return api::blend_op::reverse_subtract;
+			case reshadefx::blend_op::min: return api::blend_op::min;
+			case reshadefx::blend_op::max: return api::blend_op::max;
+			}
+		};
+		const auto convert_blend_factor = [](reshadefx::blend_factor value) {
+			switch (value) {
+			case reshadefx::blend_factor::zero: return api::blend_factor::zero;
+			default:
+			case reshadefx::blend_factor::one: return api::blend_factor::one;
+			case reshadefx::blend_factor::source_color: return api::blend_factor::source_color;
+			case reshadefx::blend_factor::one_minus_source_color: return api::blend_factor::one_minus_source_color;
+			case reshadefx::blend_factor::dest_color: return api::blend_factor::dest_color;
+			case reshadefx::blend_factor::one_minus_dest_color: return api::blend_factor::one_minus_dest_color;
+			case reshadefx::blend_factor::source_alpha: return api::blend_factor::source_alpha;
+			case reshadefx::blend_factor::one_minus_source_alpha: return api::blend_factor::one_minus_source_alpha;
+			case reshadefx::blend_factor::dest_alpha: return api::blend_factor::dest_alpha;
+			case reshadefx::blend_factor::one_minus_dest_alpha: return api::blend_factor::one_minus_dest_alpha;
+			}
+		};
+
+		// Technically should check for 'api::device_caps::independent_blend' support, but render target write masks are supported in D3D9, when rest is not, so just always set ...
+		api::blend_desc blend_state = {};
+		for (int i = 0; i < 8; ++i)
+		{
+			blend_state.blend_enable[i] = pass.blend_enable[i];
+			blend_state.source_color_blend_factor[i] = convert_blend_factor(pass.source_color_blend_factor[i]);
+			blend_state.dest_color_blend_factor[i] = convert_blend_factor(pass.dest_color_blend_factor[i]);
+			blend_state.color_blend_op[i] = convert_blend_op(pass.color_blend_op[i]);
+			blend_state.source_alpha_blend_factor[i] = convert_blend_factor(pass.source_alpha_blend_factor[i]);
+			blend_state.dest_alpha_blend_factor[i] = convert_blend_factor(pass.dest_alpha_blend_factor[i]);
+			blend_state.alpha_blend_op[i] = convert_blend_op(pass.alpha_blend_op[i]);
+			blend_state.render_target_write_mask[i] = pass.render_target_write_mask[i];
+		}
+
+		subobjects.push_back({ api::pipeline_subobject_type::blend_state, 1, &blend_state });
+
+		api::rasterizer_desc rasterizer_state = {};
+		rasterizer_state.cull_mode = api::cull_mode::none;
+
+		subobjects.push_back({ api::pipeline_subobject_type::rasterizer_state, 1, &rasterizer_state });
+
+		const auto convert_stencil_op = [](reshadefx::stencil_op value) {
+			switch (value) {
+			case reshadefx::stencil_op::zero: return api::stencil_op::zero;
+			default:
+			case reshadefx::stencil_op::keep: return api::stencil_op::keep;
+			case reshadefx::stencil_op::replace: return api::stencil_op::replace;
+			case reshadefx::stencil_op::increment_saturate: return api::stencil_op::increment_saturate;
+			case reshadefx::stencil_op::decrement_saturate: return api::stencil_op::decrement_saturate;
+			case reshadefx::stencil_op::invert: return api::stencil_op::invert;
+			case reshadefx::stencil_op::increment: return api::stencil_op::increment;
+			case reshadefx::stencil_op::decrement: return api::stencil_op::decrement;
+			}
+		};
+		const auto convert_stencil_func = [](reshadefx::stencil_func value) {
+			switch (value)
+			{
+			case reshadefx::stencil_func::never: return api::compare_op::never;
+			case reshadefx::stencil_func::less: return api::compare_op::less;
+			case reshadefx::stencil_func::equal: return api::compare_op::equal;
+			case reshadefx::stencil_func::less_equal: return api::compare_op::less_equal;
+			case reshadefx::stencil_func::greater: return api::compare_op::greater;
+			case reshadefx::stencil_func::not_equal: return api::compare_op::not_equal;
+			case reshadefx::stencil_func::greater_equal: return api::compare_op::greater_equal;
+			default:
+			case reshadefx::stencil_func::always: return api::compare_op::always;
+			}
+		};
+
+		api::depth_stencil_desc depth_stencil_state = {};
+		depth_stencil_state.depth_enable = false;
+		depth_stencil_state.depth_write_mask = false;
+		depth_stencil_state.depth_func = api::compare_op::always;
+		depth_stencil_state.stencil_enable = pass.stencil_enable;
+		depth_stencil_state.front_stencil_read_mask = pass.stencil_read_mask;
+		depth_stencil_state.front_stencil_write_mask = pass.stencil_write_mask;
+		depth_stencil_state.front_stencil_func = convert_stencil_func(pass.stencil_comparison_func);
+		depth_stencil_state.front_stencil_fail_op = convert_stencil_op(pass.stencil_fail_op);
+		depth_stencil_state.front_stencil_depth_fail_op = convert_stencil_op(pass.stencil_depth_fail_op);
+		depth_stencil_state.front_stencil_pass_op = convert_stencil_op(pass.stencil_pass_op);
+		depth_stencil_state.back_stencil_read_mask = depth_stencil_state.front_stencil_read_mask;
+		depth_stencil_state.back_stencil_write_mask = depth_stencil_state.front_stencil_write_mask;
+		depth_stencil_state.back_stencil_func = depth_stencil_state.front_stencil_func;
+		depth_stencil_state.back_stencil_fail_op = depth_stencil_state.front_stencil_fail_op;
+		depth_stencil_state.back_stencil_depth_fail_op = depth_stencil_state.front_stencil_depth_fail_op;
+		depth_stencil_state.back_stencil_pass_op = depth_stencil_state.front_stencil_pass_op;
+
+		subobjects.push_back({ api::pipeline_subobject_type::depth_stencil_state, 1, &depth_stencil_state });
+
+		if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pipeline))
+		{
+			effect.errors += "error: internal compiler error";
+
+			log::message(log::level::error, "Failed to create graphics pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+bool reshade::runtime::update_effect_specialization_constants(size_t effect_index)
+{
+	effect &effect = _effects[effect_index];
+	effect.baked_uniforms_changed = false;
+
+	// Read the current values of the baked variables back into the specialization constants they were split into
+	for (effect::permutation &permutation : effect.permutations)
+	{
+		for (reshadefx::uniform &spec_constant : permutation.module.spec_constants)
+		{
+			const auto variable = std::find_if(effect.uniforms.cbegin(), effect.uniforms.cend(),
+				[&spec_constant](const uniform &item) { return item.baked && item.name == spec_constant.name; });
+			if (variable == effect.uniforms.cend())
+				continue;
+
+			uint32_t values[16] = {};
+			get_uniform_value_data(*variable, reinterpret_cast<uint8_t *>(values), sizeof(values), 0);
+			spec_constant.initializer_value.as_uint[0] = values[std::min(spec_constant.offset, 15u)];
+		}
+	}
+
+	// Make sure the pipelines that are replaced below are no longer in use
+	_graphics_queue->wait_idle();
+
+	std::vector<uint32_t> spec_data;
+	std::vector<uint32_t> spec_constants;
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.effect_index != effect_index)
+			continue;
+
+		for (size_t permutation_index = 0; permutation_index < tech.permutations.size(); ++permutation_index)
+		{
+			if (!tech.permutations[permutation_index].created)
+				continue;
+
+			build_specialization_constants(effect.permutations[permutation_index].module, spec_constants, spec_data);
+
+			for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index)
+			{
+				api::pipeline pipeline = {};
+				if (!create_effect_pipeline(effect_index, permutation_index, tech, pass_index, spec_constants, spec_data, pipeline))
+					return false;
+
+				technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+				_device->destroy_pipeline(pass.pipeline);
+				pass.pipeline = pipeline;
+			}
+		}
+	}
+
+	return true;
+}
 bool reshade::runtime::create_effect_sampler_state(const reshadefx::sampler_desc &info, api::sampler &sampler)
 {
 	api::sampler_desc desc;
@@ -2920,103 +4562,706 @@ bool reshade::runtime::create_effect_sampler_state(const reshadefx::sampler_desc
 		return true;
 	}
 
-	if (_device->create_sampler(desc, &sampler))
-	{
-		_effect_sampler_states.emplace(desc_hash, sampler);
-		return true;
-	}
-	else
+	if (_device->create_sampler(desc, &sampler))
+	{
+		_effect_sampler_states.emplace(desc_hash, sampler);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+bool reshade::runtime::create_effect_pipeline_layout(const api::descriptor_range &cb_range, const api::descriptor_range &sampler_range, const api::descriptor_range &srv_range, const api::descriptor_range &uav_range, api::pipeline_layout &layout)
+{
+	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
+
+	api::descriptor_range layout_ranges[4] = { cb_range, sampler_range, srv_range, uav_range };
+
+	// Pad descriptor counts up to a few canonical sizes in D3D12 and Vulkan, so that most effects end up with the same layout and switching between them does not change the root signature
+	// Descriptors beyond those an effect actually uses are never written or accessed, they only take up some space in the descriptor heap
+	// Counts are not padded beyond the limits of the lowest resource binding tier, to not make a layout that would otherwise be supported fail to create
+	if (const api::device_api api = _device->get_api(); api == api::device_api::d3d12 || api == api::device_api::vulkan)
+	{
+		const auto canonical_count = [](uint32_t count, uint32_t limit) {
+			if (count == 0 || count > limit)
+				return count;
+			uint32_t canonical = 4;
+			while (canonical < count)
+				canonical *= 2;
+			return std::min(canonical, limit);
+		};
+
+		layout_ranges[1].count = canonical_count(sampler_range.count, sampler_with_resource_view ? 128 : 16);
+		layout_ranges[2].count = canonical_count(srv_range.count, 128);
+		layout_ranges[3].count = canonical_count(uav_range.count, 8);
+	}
+
+	const uint64_t layout_key =
+		static_cast<uint64_t>(layout_ranges[0].count) |
+		(static_cast<uint64_t>(layout_ranges[1].count) << 8) |
+		(static_cast<uint64_t>(layout_ranges[2].count) << 24) |
+		(static_cast<uint64_t>(layout_ranges[3].count) << 40);
+
+	if (const auto it = _effect_pipeline_layouts.find(layout_key);
+		it != _effect_pipeline_layouts.end())
+	{
+		layout = it->second;
+		return true;
+	}
+
+	api::pipeline_layout_param layout_params[4];
+	layout_params[0].type = api::pipeline_layout_param_type::descriptor_table;
+	layout_params[0].descriptor_table.count = 1;
+	layout_params[0].descriptor_table.ranges = &layout_ranges[0];
+
+	layout_params[1].type = api::pipeline_layout_param_type::descriptor_table;
+	layout_params[1].descriptor_table.count = 1;
+	layout_params[1].descriptor_table.ranges = &layout_ranges[1];
+
+	layout_params[2].type = api::pipeline_layout_param_type::descriptor_table;
+	layout_params[2].descriptor_table.count = 1;
+
+	layout_params[3].type = api::pipeline_layout_param_type::descriptor_table;
+	layout_params[3].descriptor_table.count = 1;
+
+	if (sampler_with_resource_view)
+	{
+		layout_params[2].descriptor_table.ranges = &layout_ranges[3];
+	}
+	else
+	{
+		layout_params[2].descriptor_table.ranges = &layout_ranges[2];
+		layout_params[3].descriptor_table.ranges = &layout_ranges[3];
+	}
+
+	if (_device->create_pipeline_layout(sampler_with_resource_view ? 3 : 4, layout_params, &layout))
+	{
+		_effect_pipeline_layouts.emplace(layout_key, layout);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+void reshade::runtime::destroy_effect(size_t effect_index)
+{
+	assert(effect_index < _effects.size());
+
+	_effects_generation++;
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.effect_index != effect_index)
+			continue;
+
+		for (technique::permutation &permutation : tech.permutations)
+		{
+			for (const technique::pass &pass : permutation.passes)
+			{
+				_device->destroy_pipeline(pass.pipeline);
+
+				_device->free_descriptor_table(pass.texture_table);
+				_device->free_descriptor_table(pass.storage_table);
+			}
+		}
+
+		tech.permutations.clear();
+	}
+
+	effect &effect = _effects[effect_index];
+	{
+		_device->destroy_resource(effect.cb);
+		effect.cb = {};
+
+		_device->destroy_query_heap(effect.query_heap);
+		effect.query_heap = {};
+
+		for (effect::permutation &permutation : effect.permutations)
+		{
+			_device->free_descriptor_table(permutation.cb_table);
+			permutation.cb_table = {};
+			_device->free_descriptor_table(permutation.sampler_table);
+			permutation.sampler_table = {};
+
+			// Pipeline layout is shared with other effects and destroyed in 'destroy_effects'
+			permutation.layout = {};
+
+			permutation.texture_semantic_ids.clear();
+		}
+	}
+
+	// Remove references to descriptor tables of this effect, which were freed above
+	for (texture_semantic_binding &binding : _texture_semantic_bindings)
+		binding.descriptors.erase(std::remove_if(binding.descriptors.begin(), binding.descriptors.end(),
+			[effect_index](const texture_semantic_binding::descriptor &descriptor) { return descriptor.effect_index == effect_index; }), binding.descriptors.end());
+
+	// Lock here to be safe in case another effect is still loading
+	const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+
+	// No techniques from this effect are rendering anymore
+	effect.rendering = 0;
+
+	// Destroy textures belonging to this effect
+	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
+		[this, effect_index](texture &tex) {
+			tex.shared.erase(std::remove(tex.shared.begin(), tex.shared.end(), effect_index), tex.shared.end());
+			if (tex.shared.empty())
+			{
+				destroy_texture(tex);
+				return true;
+			}
+			// If this texture is still used by another effect, move ownership to that other effect
+			if (effect_index == tex.effect_index)
+				tex.effect_index = tex.shared.front();
+			return false;
+		}), _textures.end());
+	// Positions of the remaining textures may have changed
+	rebuild_texture_name_index();
+	// Clean up techniques belonging to this effect
+	for (auto it = _techniques.begin(); it != _techniques.end();)
+	{
+		if (it->effect_index == effect_index)
+		{
+			const size_t technique_index = std::distance(_techniques.begin(), it);
+			it = _techniques.erase(it);
+
+			_technique_sorting.erase(std::remove(_technique_sorting.begin(), _technique_sorting.end(), technique_index), _technique_sorting.end());
+			std::for_each(_technique_sorting.begin(), _technique_sorting.end(),
+				[technique_index](size_t &current_technique_index) {
+					if (current_technique_index > technique_index)
+						current_technique_index--;
+				});
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// Do not clear effect here, since it is common to be reused immediately
+}
+
+uint64_t reshade::runtime::get_effect_cpu_memory_usage(size_t effect_index) const
+{
+	const effect &effect = _effects[effect_index];
+
+	uint64_t size = effect.uniform_data_storage.size() + effect.errors.size();
+
+	for (const effect::permutation &permutation : effect.permutations)
+	{
+		size += permutation.generated_code.size();
+		for (const auto &[entry_point_name, assembly] : permutation.assembly)
+			size += entry_point_name.size() + assembly.size();
+		for (const auto &[entry_point_name, assembly_text] : permutation.assembly_text)
+			size += entry_point_name.size() + assembly_text.size();
+	}
+
+	return size;
+}
+std::string reshade::runtime::get_assembly_text(size_t effect_index, size_t permutation_index, const std::string &entry_point_name) const
+{
+	const effect::permutation &permutation = _effects[effect_index].permutations[permutation_index];
+
+	if (const auto it = permutation.assembly_text.find(entry_point_name);
+		it != permutation.assembly_text.end() && !it->second.empty())
+		return it->second;
+
+	const auto it = permutation.assembly.find(entry_point_name);
+	if (it == permutation.assembly.end())
+		return std::string();
+
+	if ((_renderer_id & 0xF0000) == 0)
+	{
+		if (_d3d_compiler_module == nullptr)
+			return std::string();
+
+		const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(static_cast<HMODULE>(_d3d_compiler_module), "D3DDisassemble"));
+		assert(D3DDisassemble != nullptr);
+
+		com_ptr<ID3DBlob> d3d_disassembled;
+		if (FAILED(D3DDisassemble(it->second.data(), it->second.size(), 0, nullptr, &d3d_disassembled)))
+			return std::string();
+
+		return std::string(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+	}
+	else if (_renderer_id < 0x20000)
+	{
+		return it->second;
+	}
+	else
+	{
+		return std::string(); // There is no text representation of SPIR-V
+	}
+}
+uint64_t reshade::runtime::get_effect_gpu_memory_usage(size_t effect_index, bool include_pending) const
+{
+	const effect &effect = _effects[effect_index];
+
+	uint64_t size = (effect.cb != 0 || include_pending) ? effect.uniform_data_storage.size() : 0;
+
+	// Textures shared between effects are only attributed to the effect that owns them
+	for (const texture &tex : _textures)
+	{
+		if (tex.effect_index != effect_index || !tex.semantic.empty() || (tex.resource == 0 && !include_pending))
+			continue;
+
+		// Resources shared between techniques are only attributed to the first texture using them
+		if (!tex.transient_technique.empty())
+		{
+			if (const auto it = std::find_if(_transient_textures.cbegin(), _transient_textures.cend(),
+					[&tex](const transient_texture &item) { return item.resource == tex.resource; });
+				it != _transient_textures.cend() && it->users.front() != std::make_pair(tex.effect_index, tex.transient_technique))
+				continue;
+		}
+
+		size += tex.memory_size();
+	}
+
+	return size;
+}
+
+lockfree_mpsc_queue<reshade::telemetry_block::stream_event, 64> reshade::runtime::s_nfs_stream_events;
+
+void reshade::runtime::record_nfs_stream_event(const telemetry_block::stream_event &event)
+{
+	if (!s_nfs_stream_events.push(event))
+		log::message(log::level::warning, "Dropping world streaming event, since the queue is full.");
+}
+void reshade::runtime::update_nfs_stream_events()
+{
+	_nfs_stream_time = 0.0f;
+
+	telemetry_block::stream_event event;
+	while (s_nfs_stream_events.pop(event))
+	{
+		event.frame_count = _frame_count;
+		_nfs_stream_time += event.duration;
+
+		_nfs_stream_events[_nfs_stream_event_count++ % telemetry_block::MAX_STREAM_EVENTS] = event;
+	}
+}
+
+void reshade::runtime::update_nfs_load_profile()
+{
+	const int gameflow_state = _nfs_game_state.gameflow_state;
+
+	if (gameflow_state != _nfs_load_current.state)
+	{
+		if (_nfs_load_current.state >= 0)
+		{
+			_nfs_load_current.duration = std::chrono::duration<float, std::milli>(_last_present_time - _nfs_load_current.start_time).count();
+
+			log::message(log::level::info, "Game flow state %s took %.1f ms over %u frame(s) (ReShade was loading effects for %.1f ms and textures for %.1f ms, world streaming took %.1f ms).",
+				_nfs_load_current.state_name, _nfs_load_current.duration, _nfs_load_current.frame_count, _nfs_load_current.effect_load_time, _nfs_load_current.texture_load_time, _nfs_load_current.stream_time);
+
+			_nfs_load_history[_nfs_load_history_index] = _nfs_load_current;
+			_nfs_load_history_index = (_nfs_load_history_index + 1) % NFS_LOAD_HISTORY_SIZE;
+			_nfs_load_history_count = std::min(_nfs_load_history_count + 1, NFS_LOAD_HISTORY_SIZE);
+		}
+
+		_nfs_load_current = {};
+		_nfs_load_current.state = gameflow_state;
+		_nfs_load_current.state_name = gameflow_state >= 0 && gameflow_state < static_cast<int>(std::size(gameflow_state_names)) ? gameflow_state_names[gameflow_state] : "UNKNOWN";
+		_nfs_load_current.start_time = _last_present_time;
+	}
+
+	// Attribute the whole frame to the state it ended in, since the game flow state is only sampled once per frame
+	const float frame_time = std::chrono::duration<float, std::milli>(_last_frame_duration).count();
+
+	_nfs_load_current.frame_count++;
+	if (is_loading())
+		_nfs_load_current.effect_load_time += frame_time;
+	if (!_texture_uploads.empty())
+		_nfs_load_current.texture_load_time += frame_time;
+	_nfs_load_current.stream_time += _nfs_stream_time;
+}
+
+void reshade::runtime::update_telemetry()
+{
+	telemetry_block &block = *_telemetry.begin_update();
+
+	block.frame_count = _frame_count;
+	block.frame_time = _last_frame_duration.count() * 1e-6f;
+
+	// Stage durations of the frame that was just presented
+	const size_t history_index = (_present_stage_history_index + PRESENT_STAGE_HISTORY_SIZE - 1) % PRESENT_STAGE_HISTORY_SIZE;
+	block.stage_count = std::min(static_cast<uint32_t>(api::present_stage::count), telemetry_block::MAX_STAGES);
+	for (uint32_t stage = 0; stage < block.stage_count; ++stage)
+		block.stage_cpu_times[stage] = _present_stage_durations[stage][history_index] * 1e-6f;
+
+	block.gameflow_state = _nfs_game_state.gameflow_state;
+	block.world_detail_level = static_cast<uint32_t>(_nfs_world_detail_level);
+	block.world_detail_step_count = _nfs_world_detail_step_count;
+
+	block.stream_event_count = _nfs_stream_event_count;
+	std::copy_n(_nfs_stream_events, telemetry_block::MAX_STREAM_EVENTS, block.stream_events);
+
+	// Summing up the memory usage goes through all effects, so only refresh it periodically, since it only changes on reload anyway
+	if (!is_loading() && _frame_count % 60 == 0)
+		block.memory_usage = get_total_memory_usage();
+
+	block.technique_count = 0;
+	block.pass_count = 0;
+#if RESHADE_GUI
+	if (!is_loading())
+	{
+		for (const size_t technique_index : _technique_sorting)
+		{
+			const technique &tech = _techniques[technique_index];
+
+			if (!tech.enabled)
+				continue;
+			if (block.technique_count == telemetry_block::MAX_TECHNIQUES)
+				break;
+
+			telemetry_block::technique &entry = block.techniques[block.technique_count++];
+			entry.name[tech.name.copy(entry.name, sizeof(entry.name) - 1)] = '\0';
+			// Publish the latest samples rather than the moving averages, so that readers see individual spikes
+			entry.cpu_time = tech.average_cpu_duration.last() * 1e-6f;
+			entry.gpu_time = tech.average_gpu_duration.last() * 1e-6f;
+
+			if (_gather_pass_gpu_statistics)
+			{
+				for (size_t pass_index = 0; pass_index < tech.average_pass_gpu_durations.size() && block.pass_count < telemetry_block::MAX_PASSES; ++pass_index)
+				{
+					telemetry_block::pass &pass_entry = block.passes[block.pass_count++];
+					pass_entry.technique_index = static_cast<uint16_t>(block.technique_count - 1);
+					pass_entry.pass_index = static_cast<uint16_t>(pass_index);
+					pass_entry.gpu_time = tech.average_pass_gpu_durations[pass_index].last() * 1e-6f;
+				}
+			}
+		}
+	}
+
+	// GPU timestamps are otherwise only gathered while the statistics are visible in the overlay
+	_gather_gpu_statistics = true;
+#endif
+
+	_telemetry.end_update();
+}
+uint64_t reshade::runtime::get_total_memory_usage() const
+{
+	uint64_t size = 0;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		size += get_effect_cpu_memory_usage(effect_index) + get_effect_gpu_memory_usage(effect_index);
+
+	for (const effect_permutation &permutation : _effect_permutations)
+	{
+		if (permutation.color_tex != 0)
+			size += api::format_slice_pitch(permutation.color_format, api::format_row_pitch(permutation.color_format, permutation.width), permutation.height);
+		if (permutation.stencil_tex != 0)
+			size += api::format_slice_pitch(permutation.stencil_format, api::format_row_pitch(permutation.stencil_format, permutation.width), permutation.height);
+	}
+
+	return size;
+}
+bool reshade::runtime::evict_cold_effect_permutations()
+{
+	// Number of frames a permutation has to go without being rendered to before it is considered cold
+	constexpr uint64_t cold_frame_count = 600;
+
+	std::vector<size_t> cold_permutations;
+	// The default permutation is used every frame, so is never evicted
+	for (size_t permutation_index = 1; permutation_index < _effect_permutations.size(); ++permutation_index)
+	{
+		if (_frame_count < _effect_permutations[permutation_index].last_used_frame + cold_frame_count)
+			continue;
+
+		if (std::any_of(_effects.cbegin(), _effects.cend(),
+				[permutation_index](const effect &effect) {
+					return permutation_index < effect.permutations.size() && !effect.permutations[permutation_index].get_generated_code().empty();
+				}))
+			cold_permutations.push_back(permutation_index);
+	}
+
+	if (cold_permutations.empty())
+		return false;
+
+	// Make sure the GPU is no longer using any of the pipelines that are destroyed below
+	_graphics_queue->wait_idle();
+
+	for (const size_t permutation_index : cold_permutations)
+	{
+		for (technique &tech : _techniques)
+		{
+			if (permutation_index >= tech.permutations.size())
+				continue;
+
+			technique::permutation &permutation = tech.permutations[permutation_index];
+
+			if (permutation.created)
+			{
+				for (const technique::pass &pass : permutation.passes)
+				{
+					_device->destroy_pipeline(pass.pipeline);
+
+					_device->free_descriptor_table(pass.texture_table);
+					_device->free_descriptor_table(pass.storage_table);
+				}
+			}
+
+			// Pass information is filled in again when the permutation is recompiled
+			permutation = technique::permutation();
+		}
+
+		for (effect &effect : _effects)
+		{
+			if (permutation_index >= effect.permutations.size())
+				continue;
+
+			effect::permutation &permutation = effect.permutations[permutation_index];
+
+			_device->free_descriptor_table(permutation.cb_table);
+			_device->free_descriptor_table(permutation.sampler_table);
+
+			// Keep the permutation in the list, so that the indices of the remaining permutations stay the same
+			permutation = effect::permutation();
+		}
+
+		for (texture_semantic_binding &binding : _texture_semantic_bindings)
+			binding.descriptors.erase(std::remove_if(binding.descriptors.begin(), binding.descriptors.end(),
+				[permutation_index](const texture_semantic_binding::descriptor &descriptor) { return descriptor.permutation_index == permutation_index; }), binding.descriptors.end());
+
+		log::message(log::level::info, "Evicted effect permutation %zu (%ux%u) to stay within the memory budget.", permutation_index, _effect_permutations[permutation_index].width, _effect_permutations[permutation_index].height);
+	}
+
+	return true;
+}
+
+static bool decode_texture_upload(reshade::texture_upload &upload)
+{
+	void *pixels = nullptr;
+	int width = 0, height = 1, depth = 1, channels = 0;
+	const bool is_floating_point_format = (upload.format == reshadefx::texture_format::r32f || upload.format == reshadefx::texture_format::rg32f || upload.format == reshadefx::texture_format::rgba32f);
+
+	if (FILE *const file = _wfsopen(upload.source_path.c_str(), L"rb", SH_DENYNO))
+	{
+		fseek(file, 0, SEEK_END);
+		const size_t file_size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		if (upload.source_path.extension() == L".cube")
+		{
+			if (!is_floating_point_format)
+			{
+				reshade::log::message(reshade::log::level::error, "Source '%s' for texture '%s' is a Cube LUT file, which can only be loaded into textures with a floating-point format!", upload.source_path.u8string().c_str(), upload.texture_name.c_str());
+				fclose(file);
+				return false;
+			}
+
+			float domain_min[3] = { 0.0f, 0.0f, 0.0f };
+			float domain_max[3] = { 1.0f, 1.0f, 1.0f };
+
+			// Read header information
+			char line_data[1024];
+			while (fgets(line_data, sizeof(line_data), file))
+			{
+				const std::string_view line = trim(line_data, "\r\n");
+
+				if (line.empty() || line[0] == '#')
+					continue; // Skip lines with comments
+
+				char *p = line_data;
+
+				if (line.rfind("TITLE", 0) == 0)
+					continue; // Skip optional line with title
+
+				if (line.rfind("DOMAIN_MIN", 0) == 0)
+				{
+					p += 10;
+					domain_min[0] = static_cast<float>(std::strtod(p, &p));
+					domain_min[1] = static_cast<float>(std::strtod(p, &p));
+					domain_min[2] = static_cast<float>(std::strtod(p, &p));
+					continue;
+				}
+				if (line.rfind("DOMAIN_MAX", 0) == 0)
+				{
+					p += 10;
+					domain_max[0] = static_cast<float>(std::strtod(p, &p));
+					domain_max[1] = static_cast<float>(std::strtod(p, &p));
+					domain_max[2] = static_cast<float>(std::strtod(p, &p));
+					continue;
+				}
+
+				if (line.rfind("LUT_1D_SIZE", 0) == 0)
+				{
+					if (pixels != nullptr)
+						break;
+					width = std::strtol(p + 11, nullptr, 10);
+					pixels = std::malloc(static_cast<size_t>(width) * 4 * sizeof(float));
+					continue;
+				}
+				if (line.rfind("LUT_3D_SIZE", 0) == 0)
+				{
+					if (pixels != nullptr)
+						break;
+					width = height = depth = std::strtol(p + 11, nullptr, 10);
+					pixels = std::malloc(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float));
+					continue;
+				}
+
+				// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
+				fseek(file, -static_cast<long>(std::strlen(line_data)), SEEK_CUR);
+				break;
+			}
+
+			// Read table data
+			if (pixels != nullptr)
+			{
+				size_t index = 0;
+
+				while (fgets(line_data, sizeof(line_data), file) && (index + 4) <= (static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4))
+				{
+					const std::string_view line = trim(line_data, "\r\n");
+
+					if (line.empty() || line[0] == '#')
+						continue; // Skip lines with comments
+
+					char *p = line_data;
+
+					static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[0] - domain_min[0]) + domain_min[0];
+					static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[1] - domain_min[1]) + domain_min[1];
+					static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[2] - domain_min[2]) + domain_min[2];
+					static_cast<float *>(pixels)[index++] = 1.0f;
+				}
+			}
+
+			fclose(file);
+		}
+		else
+		{
+			// Read texture data into memory in one go since that is faster than reading chunk by chunk
+			std::vector<stbi_uc> file_data(file_size);
+			const size_t file_size_read = fread(file_data.data(), 1, file_size, file);
+			fclose(file);
+
+			if (file_size_read == file_size)
+			{
+				if (is_floating_point_format)
+					pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+				else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
+					pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
+				else
+					pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+			}
+		}
+	}
+
+	if (pixels == nullptr)
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to load '%s' for texture '%s'!", upload.source_path.u8string().c_str(), upload.texture_name.c_str());
+		return false;
+	}
+
+	// Collapse data to the correct number of components per pixel based on the texture format
+	switch (upload.format)
+	{
+	case reshadefx::texture_format::r8:
+		reshade::utils::pack_channels_rgba8(static_cast<stbi_uc *>(pixels), static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth), 1);
+		break;
+	case reshadefx::texture_format::r32f:
+		reshade::utils::pack_channels_rgba32f(static_cast<float *>(pixels), static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth), 1);
+		break;
+	case reshadefx::texture_format::rg8:
+		reshade::utils::pack_channels_rgba8(static_cast<stbi_uc *>(pixels), static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth), 2);
+		break;
+	case reshadefx::texture_format::rg32f:
+		reshade::utils::pack_channels_rgba32f(static_cast<float *>(pixels), static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth), 2);
+		break;
+	case reshadefx::texture_format::rgba8:
+	case reshadefx::texture_format::rgba32f:
+		break;
+	default:
+		reshade::log::message(reshade::log::level::error, "Texture upload is not supported for format %d of texture '%s'!", static_cast<int>(upload.format), upload.texture_name.c_str());
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	uint32_t pixel_size;
+	stbir_datatype data_type;
+	stbir_pixel_layout pixel_layout;
+	switch (upload.format)
+	{
+	case reshadefx::texture_format::r8:
+		pixel_size = 1 * 1;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_1CHANNEL;
+		break;
+	case reshadefx::texture_format::r32f:
+		pixel_size = 4 * 1;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_1CHANNEL;
+		break;
+	case reshadefx::texture_format::rg8:
+		pixel_size = 1 * 2;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_2CHANNEL;
+		break;
+	case reshadefx::texture_format::rg32f:
+		pixel_size = 4 * 2;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_2CHANNEL;
+		break;
+	case reshadefx::texture_format::rgba8:
+		pixel_size = 1 * 4;
+		data_type = STBIR_TYPE_UINT8;
+		pixel_layout = STBIR_RGBA;
+		break;
+	default:
+		pixel_size = 4 * 4;
+		data_type = STBIR_TYPE_FLOAT;
+		pixel_layout = STBIR_RGBA;
+		break;
+	}
+
+	if (static_cast<uint32_t>(depth) != upload.depth || (upload.depth != 1 && (static_cast<uint32_t>(width) != upload.width || static_cast<uint32_t>(height) != upload.height)))
 	{
+		reshade::log::message(reshade::log::level::error, "Resizing image data is not supported for 3D textures like '%s'.", upload.texture_name.c_str());
+		stbi_image_free(pixels);
 		return false;
 	}
-}
-void reshade::runtime::destroy_effect(size_t effect_index)
-{
-	assert(effect_index < _effects.size());
-
-	for (technique &tech : _techniques)
-	{
-		if (tech.effect_index != effect_index)
-			continue;
 
-		for (technique::permutation &permutation : tech.permutations)
-		{
-			for (const technique::pass &pass : permutation.passes)
-			{
-				_device->destroy_pipeline(pass.pipeline);
+	upload.row_pitch = upload.width * pixel_size;
+	upload.slice_pitch = upload.row_pitch * upload.height;
+	upload.data.resize(static_cast<size_t>(upload.slice_pitch) * static_cast<size_t>(upload.depth));
 
-				_device->free_descriptor_table(pass.texture_table);
-				_device->free_descriptor_table(pass.storage_table);
-			}
-		}
+	// Need to potentially resize image data to the texture dimensions, which is done here already so that the render thread only has to copy the result
+	if (static_cast<uint32_t>(width) != upload.width || static_cast<uint32_t>(height) != upload.height)
+	{
+		reshade::log::message(reshade::log::level::info, "Resizing image data for texture '%s' from %ux%u to %ux%u.", upload.texture_name.c_str(), static_cast<uint32_t>(width), static_cast<uint32_t>(height), upload.width, upload.height);
 
-		tech.permutations.clear();
+		stbir_resize(pixels, width, height, 0, upload.data.data(), upload.width, upload.height, 0, pixel_layout, data_type, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT);
 	}
-
-	effect &effect = _effects[effect_index];
+	else
 	{
-		_device->destroy_resource(effect.cb);
-		effect.cb = {};
-
-		_device->destroy_query_heap(effect.query_heap);
-		effect.query_heap = {};
-
-		for (effect::permutation &permutation : effect.permutations)
-		{
-			_device->free_descriptor_table(permutation.cb_table);
-			permutation.cb_table = {};
-			_device->free_descriptor_table(permutation.sampler_table);
-			permutation.sampler_table = {};
-
-			_device->destroy_pipeline_layout(permutation.layout);
-			permutation.layout = {};
-
-			permutation.texture_semantic_to_binding.clear();
-		}
+		std::memcpy(upload.data.data(), pixels, upload.data.size());
 	}
 
-	// Lock here to be safe in case another effect is still loading
-	const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+	stbi_image_free(pixels);
 
-	// No techniques from this effect are rendering anymore
-	effect.rendering = 0;
+	return true;
+}
 
-	// Destroy textures belonging to this effect
-	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
-		[this, effect_index](texture &tex) {
-			tex.shared.erase(std::remove(tex.shared.begin(), tex.shared.end(), effect_index), tex.shared.end());
-			if (tex.shared.empty())
-			{
-				destroy_texture(tex);
-				return true;
-			}
-			// If this texture is still used by another effect, move ownership to that other effect
-			if (effect_index == tex.effect_index)
-				tex.effect_index = tex.shared.front();
-			return false;
-		}), _textures.end());
-	// Clean up techniques belonging to this effect
-	for (auto it = _techniques.begin(); it != _techniques.end();)
+reshade::texture *reshade::runtime::find_texture(const std::string &unique_name)
+{
+	if (const auto it = _texture_name_index.find(unique_name);
+		it != _texture_name_index.end())
 	{
-		if (it->effect_index == effect_index)
-		{
-			const size_t technique_index = std::distance(_techniques.begin(), it);
-			it = _techniques.erase(it);
-
-			_technique_sorting.erase(std::remove(_technique_sorting.begin(), _technique_sorting.end(), technique_index), _technique_sorting.end());
-			std::for_each(_technique_sorting.begin(), _technique_sorting.end(),
-				[technique_index](size_t &current_technique_index) {
-					if (current_technique_index > technique_index)
-						current_technique_index--;
-				});
-		}
-		else
-		{
-			++it;
-		}
+		assert(it->second < _textures.size() && _textures[it->second].unique_name == unique_name);
+		return &_textures[it->second];
 	}
 
-	// Do not clear effect here, since it is common to be reused immediately
+	return nullptr;
+}
+void reshade::runtime::rebuild_texture_name_index()
+{
+	_texture_name_index.clear();
+	_texture_name_index.reserve(_textures.size());
+	for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+		_texture_name_index.emplace(_textures[texture_index].unique_name, texture_index);
 }
 
 void reshade::runtime::load_textures(size_t effect_index)
@@ -3028,178 +5273,201 @@ void reshade::runtime::load_textures(size_t effect_index)
 		if (std::find(tex.shared.begin(), tex.shared.end(), effect_index) == tex.shared.end())
 			continue; // Ignore textures not being used with this effect
 
-		std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
-		// Ignore textures that have no image file attached to them (e.g. plain render targets)
-		if (source_path.empty())
+		// Ignore textures that are still being loaded for another effect sharing them
+		if (std::find_if(_texture_uploads.begin(), _texture_uploads.end(),
+				[&tex](const std::shared_ptr<texture_upload> &upload) { return upload->resource == tex.resource; }) != _texture_uploads.end())
+			continue;
+
+		load_texture(tex);
+	}
+}
+bool reshade::runtime::load_texture(texture &tex)
+{
+	std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
+	// Ignore textures that have no image file attached to them (e.g. plain render targets)
+	if (source_path.empty())
+		return false;
+
+	// Search for image file using the provided search paths unless the path provided is already absolute
+	if (!find_file(_texture_search_paths, source_path))
+	{
+		log::message(log::level::error, "Source '%s' for texture '%s' was not found in any of the texture search paths!", source_path.u8string().c_str(), tex.unique_name.c_str());
+		_last_reload_successful = false;
+		return false;
+	}
+
+	const auto upload = std::make_shared<texture_upload>();
+	upload->source_path = std::move(source_path);
+	upload->texture_name = tex.unique_name;
+	upload->resource = tex.resource;
+	upload->format = tex.format;
+	upload->width = tex.width;
+	upload->height = tex.height;
+	upload->depth = tex.depth;
+	upload->levels = tex.levels;
+	upload->compressed_format = tex.compressed_format;
+
+	// Decode image files on the worker pool, the result is then uploaded in 'update_texture_uploads' over the next frames
+	_texture_uploads.push_back(upload);
+	_worker_pool->submit(thread_pool::priority::normal, [this, upload]() {
+			upload->succeeded = upload->compressed_format != api::format::unknown ? load_compressed_texture_upload(*upload) : decode_texture_upload(*upload);
+			upload->finished.store(true, std::memory_order_release);
+		});
+
+	return true;
+}
+void reshade::runtime::update_texture_uploads()
+{
+	// Limit the amount of data uploaded per frame, so that large textures do not stall presentation
+	constexpr size_t upload_budget = 8 * 1024 * 1024;
+
+	size_t uploaded_size = 0;
+
+	for (auto it = _texture_uploads.begin(); it != _texture_uploads.end() && uploaded_size < upload_budget;)
+	{
+		texture_upload &upload = **it;
+
+		if (!upload.finished.load(std::memory_order_acquire))
+		{
+			++it;
 			continue;
+		}
 
-		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
+		// The texture may have been destroyed, or even recreated with a different resource, while its image was being decoded
+		texture *const tex = find_texture(upload.texture_name);
+		if (!upload.succeeded || tex == nullptr || tex->resource != upload.resource)
 		{
-			log::message(log::level::error, "Source '%s' for texture '%s' was not found in any of the texture search paths!", source_path.u8string().c_str(), tex.unique_name.c_str());
-			_last_reload_successful = false;
+			if (!upload.succeeded)
+				_last_reload_successful = false;
+
+			it = _texture_uploads.erase(it);
 			continue;
 		}
 
-		void *pixels = nullptr;
-		int width = 0, height = 1, depth = 1, channels = 0;
-		const bool is_floating_point_format = (tex.format == reshadefx::texture_format::r32f || tex.format == reshadefx::texture_format::rg32f || tex.format == reshadefx::texture_format::rgba32f);
+		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 
-		if (FILE *const file = _wfsopen(source_path.c_str(), L"rb", SH_DENYNO))
+		// Block compressed textures are small enough to upload all mipmap levels at once, since those cannot be generated on the GPU
+		if (upload.compressed_format != api::format::unknown)
 		{
-			fseek(file, 0, SEEK_END);
-			const size_t file_size = ftell(file);
-			fseek(file, 0, SEEK_SET);
+			cmd_list->barrier(upload.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
 
-			if (source_path.extension() == L".cube")
+			size_t offset = 0;
+			for (uint32_t level = 0, level_width = upload.width, level_height = upload.height; level < upload.levels; ++level)
 			{
-				if (!is_floating_point_format)
-				{
-					log::message(log::level::error, "Source '%s' for texture '%s' is a Cube LUT file, which can only be loaded into textures with a floating-point format!", source_path.u8string().c_str(), tex.unique_name.c_str());
-					_last_reload_successful = false;
-					continue;
-				}
+				const uint32_t row_pitch = api::format_row_pitch(upload.compressed_format, level_width);
+				const uint32_t slice_pitch = api::format_slice_pitch(upload.compressed_format, row_pitch, level_height);
+				_device->update_texture_region({ upload.data.data() + offset, row_pitch, slice_pitch }, upload.resource, level);
+				offset += slice_pitch;
 
-				float domain_min[3] = { 0.0f, 0.0f, 0.0f };
-				float domain_max[3] = { 1.0f, 1.0f, 1.0f };
+				level_width = level_width > 1 ? level_width / 2 : 1;
+				level_height = level_height > 1 ? level_height / 2 : 1;
+			}
 
-				// Read header information
-				char line_data[1024];
-				while (fgets(line_data, sizeof(line_data), file))
-				{
-					const std::string_view line = trim(line_data, "\r\n");
+			cmd_list->barrier(upload.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
 
-					if (line.empty() || line[0] == '#')
-						continue; // Skip lines with comments
+			uploaded_size += upload.data.size();
+			tex->loaded = true;
 
-					char *p = line_data;
+			it = _texture_uploads.erase(it);
+			continue;
+		}
 
-					if (line.rfind("TITLE", 0) == 0)
-						continue; // Skip optional line with title
+		// Upload entire rows for 2D textures and entire slices for 3D textures
+		const uint32_t row_count = upload.depth != 1 ? upload.depth : upload.height;
+		const uint32_t row_size = upload.depth != 1 ? upload.slice_pitch : upload.row_pitch;
 
-					if (line.rfind("DOMAIN_MIN", 0) == 0)
-					{
-						p += 10;
-						domain_min[0] = static_cast<float>(std::strtod(p, &p));
-						domain_min[1] = static_cast<float>(std::strtod(p, &p));
-						domain_min[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
-					if (line.rfind("DOMAIN_MAX", 0) == 0)
-					{
-						p += 10;
-						domain_max[0] = static_cast<float>(std::strtod(p, &p));
-						domain_max[1] = static_cast<float>(std::strtod(p, &p));
-						domain_max[2] = static_cast<float>(std::strtod(p, &p));
-						continue;
-					}
+		uint32_t rows = static_cast<uint32_t>((upload_budget - uploaded_size) / row_size);
+		if (rows == 0)
+			rows = 1;
+		if (rows > row_count - upload.next_row)
+			rows = row_count - upload.next_row;
 
-					if (line.rfind("LUT_1D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * 4 * sizeof(float));
-						continue;
-					}
-					if (line.rfind("LUT_3D_SIZE", 0) == 0)
-					{
-						if (pixels != nullptr)
-							break;
-						width = height = depth = std::strtol(p + 11, nullptr, 10);
-						pixels = std::malloc(static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4 * sizeof(float));
-						continue;
-					}
+		api::subresource_box box = { 0, 0, 0, upload.width, upload.height, upload.depth };
+		if (upload.depth != 1)
+			box.front = upload.next_row, box.back = upload.next_row + rows;
+		else
+			box.top = upload.next_row, box.bottom = upload.next_row + rows;
 
-					// Line has no known keyword, so assume this is where the table data starts and roll back a line to continue reading that below
-					fseek(file, -static_cast<long>(std::strlen(line_data)), SEEK_CUR);
-					break;
-				}
+		cmd_list->barrier(upload.resource, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+		_device->update_texture_region({ upload.data.data() + static_cast<size_t>(upload.next_row) * row_size, upload.row_pitch, upload.slice_pitch }, upload.resource, 0, &box);
+		cmd_list->barrier(upload.resource, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
 
-				// Read table data
-				if (pixels != nullptr)
-				{
-					size_t index = 0;
+		uploaded_size += static_cast<size_t>(rows) * row_size;
+		upload.next_row += rows;
 
-					while (fgets(line_data, sizeof(line_data), file) && (index + 4) <= (static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4))
-					{
-						const std::string_view line = trim(line_data, "\r\n");
+		if (upload.next_row < row_count)
+		{
+			++it;
+			continue;
+		}
 
-						if (line.empty() || line[0] == '#')
-							continue; // Skip lines with comments
+		if (tex->levels > 1)
+			cmd_list->generate_mipmaps(tex->srv[0]);
 
-						char *p = line_data;
+		tex->loaded = true;
 
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[0] - domain_min[0]) + domain_min[0];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[1] - domain_min[1]) + domain_min[1];
-						static_cast<float *>(pixels)[index++] = static_cast<float>(std::strtod(p, &p)) * (domain_max[2] - domain_min[2]) + domain_min[2];
-						static_cast<float *>(pixels)[index++] = 1.0f;
-					}
-				}
-			}
-			else
-			{
-				// Read texture data into memory in one go since that is faster than reading chunk by chunk
-				std::vector<stbi_uc> file_data(file_size);
-				const size_t file_size_read = fread(file_data.data(), 1, file_size, file);
-				fclose(file);
+		it = _texture_uploads.erase(it);
+	}
+}
+bool reshade::runtime::load_compressed_texture_upload(texture_upload &upload) const
+{
+	std::error_code ec;
+	const std::string attributes =
+		upload.source_path.u8string() + ';' +
+		std::to_string(std::filesystem::last_write_time(upload.source_path, ec).time_since_epoch().count()) + ';' +
+		std::to_string(std::filesystem::file_size(upload.source_path, ec)) + ';' +
+		std::to_string(upload.width) + 'x' + std::to_string(upload.height) + ';' +
+		std::to_string(upload.levels) + ';' +
+		std::to_string(static_cast<uint32_t>(upload.compressed_format));
+	const std::string cache_id = "texture-" + upload.source_path.stem().u8string() + '-' + std::to_string(std::hash<std::string>()(attributes));
+
+	size_t total_size = 0;
+	for (uint32_t level = 0, level_width = upload.width, level_height = upload.height; level < upload.levels; ++level)
+	{
+		total_size += api::format_slice_pitch(upload.compressed_format, api::format_row_pitch(upload.compressed_format, level_width), level_height);
 
-				if (file_size_read == file_size)
-				{
-					if (is_floating_point_format)
-						pixels = stbi_loadf_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-					else if (stbi_dds_test_memory(file_data.data(), static_cast<int>(file_data.size())))
-						pixels = stbi_dds_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &depth, &channels, STBI_rgb_alpha);
-					else
-						pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
-				}
-			}
-		}
+		level_width = level_width > 1 ? level_width / 2 : 1;
+		level_height = level_height > 1 ? level_height / 2 : 1;
+	}
 
-		if (pixels == nullptr)
-		{
-			log::message(log::level::error, "Failed to load '%s' for texture '%s'!", source_path.u8string().c_str(), tex.unique_name.c_str());
-			_last_reload_successful = false;
-			continue;
-		}
+	if (std::string cached_data; load_effect_cache(cache_id, "bc", cached_data) && cached_data.size() == total_size)
+	{
+		upload.data.assign(cached_data.begin(), cached_data.end());
+		return true;
+	}
 
-		// Collapse data to the correct number of components per pixel based on the texture format
-		switch (tex.format)
+	if (!decode_texture_upload(upload))
+		return false;
+
+	const unsigned int channels = upload.format == reshadefx::texture_format::r8 ? 1 : upload.format == reshadefx::texture_format::rg8 ? 2 : 4;
+
+	std::vector<uint8_t> pixels = std::move(upload.data);
+	std::vector<uint8_t> next_level_pixels;
+
+	std::string compressed_data(total_size, '\0');
+	size_t offset = 0;
+	for (uint32_t level = 0, level_width = upload.width, level_height = upload.height; level < upload.levels; ++level)
+	{
+		utils::compress_blocks(pixels.data(), level_width, level_height, channels, reinterpret_cast<uint8_t *>(compressed_data.data() + offset));
+		offset += api::format_slice_pitch(upload.compressed_format, api::format_row_pitch(upload.compressed_format, level_width), level_height);
+
+		// Generate the mipmap chain on the CPU, since the GPU cannot render into block compressed textures
+		if (level + 1 < upload.levels)
 		{
-		case reshadefx::texture_format::r8:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<stbi_uc *>(pixels)[k] = static_cast<stbi_uc *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::r32f:
-			for (size_t i = 4, k = 1; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 1)
-				static_cast<float *>(pixels)[k] = static_cast<float *>(pixels)[i];
-			break;
-		case reshadefx::texture_format::rg8:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<stbi_uc *>(pixels)[k + 0] = static_cast<stbi_uc *>(pixels)[i + 0],
-				static_cast<stbi_uc *>(pixels)[k + 1] = static_cast<stbi_uc *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rg32f:
-			for (size_t i = 4, k = 2; i < static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * 4; i += 4, k += 2)
-				static_cast<float *>(pixels)[k + 0] = static_cast<float *>(pixels)[i + 0],
-				static_cast<float *>(pixels)[k + 1] = static_cast<float *>(pixels)[i + 1];
-			break;
-		case reshadefx::texture_format::rgba8:
-		case reshadefx::texture_format::rgba32f:
-			break;
-		default:
-			log::message(log::level::error, "Texture upload is not supported for format %d of texture '%s'!", static_cast<int>(tex.format), tex.unique_name.c_str());
-			_last_reload_successful = false;
-			stbi_image_free(pixels);
-			continue;
+			next_level_pixels.resize(static_cast<size_t>(level_width > 1 ? level_width / 2 : 1) * static_cast<size_t>(level_height > 1 ? level_height / 2 : 1) * channels);
+			utils::downsample_box(pixels.data(), level_width, level_height, channels, next_level_pixels.data());
+			pixels.swap(next_level_pixels);
 		}
 
-		update_texture(tex, width, height, depth, pixels);
+		level_width = level_width > 1 ? level_width / 2 : 1;
+		level_height = level_height > 1 ? level_height / 2 : 1;
+	}
 
-		stbi_image_free(pixels);
+	upload.data.assign(compressed_data.begin(), compressed_data.end());
 
-		tex.loaded = true;
-	}
+	_worker_pool->submit(thread_pool::priority::low, [this, cache_id, compressed_data = std::move(compressed_data)]() { save_effect_cache(cache_id, "bc", compressed_data); });
+
+	return true;
 }
 bool reshade::runtime::create_texture(texture &tex)
 {
@@ -3299,8 +5567,44 @@ bool reshade::runtime::create_texture(texture &tex)
 	if (tex.storage_access && _renderer_id >= 0xb000)
 		usage |= api::resource_usage::unordered_access;
 
+	// Textures that are only ever filled from an image file can be stored block compressed instead (see 'load_compressed_texture_upload')
+	tex.compressed_format = api::format::unknown;
+	if (_compress_source_textures && tex.type == reshadefx::texture_type::texture_2d && !tex.render_target && !tex.storage_access && (tex.width % 4) == 0 && (tex.height % 4) == 0 && !tex.annotation_as_string("source").empty())
+	{
+		switch (tex.format)
+		{
+		case reshadefx::texture_format::r8:
+			tex.compressed_format = api::format::bc4_unorm;
+			break;
+		case reshadefx::texture_format::rg8:
+			tex.compressed_format = api::format::bc5_unorm;
+			break;
+		case reshadefx::texture_format::rgba8:
+			tex.compressed_format = api::format::bc3_unorm;
+			break;
+		}
+
+		if (tex.compressed_format != api::format::unknown && !_device->check_format_support(tex.compressed_format, usage))
+			tex.compressed_format = api::format::unknown;
+
+		if (tex.compressed_format == api::format::bc3_unorm)
+		{
+			format = api::format::bc3_typeless;
+			view_format = api::format::bc3_unorm;
+			view_format_srgb = api::format::bc3_unorm_srgb;
+		}
+		else if (tex.compressed_format != api::format::unknown)
+		{
+			view_format_srgb = view_format = format = tex.compressed_format;
+		}
+	}
+
+	tex.reduced_format = get_reduced_texture_format(tex);
+	if (tex.reduced_format != api::format::unknown)
+		view_format_srgb = view_format = format = tex.reduced_format;
+
 	api::resource_flags flags = api::resource_flags::none;
-	if (tex.levels > 1)
+	if (tex.levels > 1 && tex.compressed_format == api::format::unknown)
 		flags |= api::resource_flags::generate_mipmaps;
 
 	// Clear texture to zero since by default its contents are undefined
@@ -3386,7 +5690,83 @@ bool reshade::runtime::create_texture(texture &tex)
 		}
 	}
 
-	return true;
+	return true;
+}
+bool reshade::runtime::create_transient_texture(texture &tex, const std::string &technique_name)
+{
+	std::pair<size_t, std::string> user(tex.effect_index, technique_name);
+
+	const api::format reduced_format = get_reduced_texture_format(tex);
+
+	if (const auto it = std::find_if(_transient_textures.begin(), _transient_textures.end(),
+			[&tex, &user, reduced_format](const transient_texture &item) {
+				return tex.matches_description(item.desc) && item.desc.depth == tex.depth && item.reduced_format == reduced_format && std::find(item.users.begin(), item.users.end(), user) == item.users.end();
+			});
+		it != _transient_textures.end())
+	{
+		tex.resource = it->resource;
+		tex.srv[0] = it->srv[0];
+		tex.srv[1] = it->srv[1];
+		tex.rtv[0] = it->rtv[0];
+		tex.rtv[1] = it->rtv[1];
+		tex.reduced_format = it->reduced_format;
+
+		it->users.push_back(std::move(user));
+	}
+	else
+	{
+		if (!create_texture(tex))
+			return false;
+
+		transient_texture &new_transient = _transient_textures.emplace_back();
+		new_transient.desc = tex;
+		new_transient.reduced_format = reduced_format;
+		new_transient.resource = tex.resource;
+		new_transient.srv[0] = tex.srv[0];
+		new_transient.srv[1] = tex.srv[1];
+		new_transient.rtv[0] = tex.rtv[0];
+		new_transient.rtv[1] = tex.rtv[1];
+		new_transient.users.push_back(std::move(user));
+	}
+
+	tex.transient_technique = technique_name;
+
+	return true;
+}
+auto reshade::runtime::get_reduced_texture_format(const texture &tex) const -> api::format
+{
+	// Only textures that are exclusively written by the GPU qualify, since data uploaded to or read back from others is in the declared format
+	// Storage textures are excluded too, since GLSL and SPIR-V declare their format in the shader code
+	if (_texture_precision_policy == 0 || !tex.render_target || tex.storage_access || !tex.semantic.empty() || !tex.annotation_as_string("source").empty())
+		return api::format::unknown;
+
+	if (!_texture_precision_effects.empty() && (tex.effect_index >= _effects.size() ||
+			std::find(_texture_precision_effects.cbegin(), _texture_precision_effects.cend(), _effects[tex.effect_index].source_file.filename().u8string()) == _texture_precision_effects.cend()))
+		return api::format::unknown;
+
+	api::format reduced_format = api::format::unknown;
+	switch (tex.format)
+	{
+	case reshadefx::texture_format::r32f:
+		reduced_format = api::format::r16_float;
+		break;
+	case reshadefx::texture_format::rg32f:
+		reduced_format = api::format::r16g16_float;
+		break;
+	case reshadefx::texture_format::rgba16f:
+	case reshadefx::texture_format::rgba32f:
+		// R11G11B10F has neither an alpha channel nor a sign bit, so effects have to opt in per texture
+		if (_texture_precision_policy >= 2 && tex.annotation_as_int("alpha_unused") != 0)
+			reduced_format = api::format::r11g11b10_float;
+		else if (tex.format == reshadefx::texture_format::rgba32f)
+			reduced_format = api::format::r16g16b16a16_float;
+		break;
+	}
+
+	if (reduced_format != api::format::unknown && !_device->check_format_support(reduced_format, api::resource_usage::shader_resource | api::resource_usage::render_target))
+		return api::format::unknown;
+
+	return reduced_format;
 }
 void reshade::runtime::destroy_texture(texture &tex)
 {
@@ -3395,6 +5775,38 @@ void reshade::runtime::destroy_texture(texture &tex)
 		_preview_texture.handle = 0;
 #endif
 
+	// Cancel any pending upload of image data to this texture (a worker may still be decoding it, but it only writes to the upload object it holds)
+	_texture_uploads.erase(std::remove_if(_texture_uploads.begin(), _texture_uploads.end(),
+		[&tex](const std::shared_ptr<texture_upload> &upload) { return upload->resource == tex.resource; }), _texture_uploads.end());
+
+	if (!tex.transient_technique.empty())
+	{
+		if (const auto it = std::find_if(_transient_textures.begin(), _transient_textures.end(),
+				[&tex](const transient_texture &item) { return item.resource == tex.resource; });
+			it != _transient_textures.end())
+		{
+			it->users.erase(std::remove(it->users.begin(), it->users.end(), std::make_pair(tex.effect_index, tex.transient_technique)), it->users.end());
+
+			// Only destroy the resource and its views once no other texture is using them anymore
+			if (!it->users.empty())
+			{
+				tex.resource = {};
+				tex.srv[0] = {};
+				tex.srv[1] = {};
+				tex.rtv[0] = {};
+				tex.rtv[1] = {};
+				tex.transient_technique.clear();
+				return;
+			}
+
+			_transient_textures.erase(it);
+		}
+
+		tex.transient_technique.clear();
+	}
+
+	_pending_mipmap_views.erase(std::remove(_pending_mipmap_views.begin(), _pending_mipmap_views.end(), tex.srv[0]), _pending_mipmap_views.end());
+
 	_device->destroy_resource(tex.resource);
 	tex.resource = {};
 
@@ -3438,7 +5850,13 @@ void reshade::runtime::enable_technique(technique &tech)
 	tech.time_left = tech.annotation_as_int("timeout");
 
 	// Queue effect file for initialization if it was not fully loaded yet
-	if (!tech.permutations[0].created &&
+	if (_effects[tech.effect_index].metadata_only)
+	{
+		// Effects that were only parsed for their metadata have to be reloaded to compile their shaders first, after which the reload initializes them (see 'update_effects')
+		if (std::find(_reload_required_effects.cbegin(), _reload_required_effects.cend(), std::make_pair(tech.effect_index, static_cast<size_t>(0))) == _reload_required_effects.cend())
+			_reload_required_effects.emplace_back(tech.effect_index, 0);
+	}
+	else if (!tech.permutations[0].created &&
 		// Avoid adding the same effect multiple times to the queue if it contains multiple techniques that were enabled simultaneously
 		std::find(_reload_create_queue.cbegin(), _reload_create_queue.cend(), std::make_pair(tech.effect_index, 0u)) == _reload_create_queue.cend())
 		_reload_create_queue.emplace_back(tech.effect_index, 0u);
@@ -3466,6 +5884,12 @@ void reshade::runtime::disable_technique(technique &tech)
 	tech.time_left = 0;
 	tech.average_cpu_duration.clear();
 	tech.average_gpu_duration.clear();
+	std::fill_n(tech.gpu_duration_histogram, technique::GPU_DURATION_HISTOGRAM_SIZE, 0u);
+	for (moving_average<uint64_t, 60> &average_pass_gpu_duration : tech.average_pass_gpu_durations)
+		average_pass_gpu_duration.clear();
+	// Results of queries that are still in flight are simply dropped, the slots are reissued once the technique is enabled again
+	tech.query_ring_head = 0;
+	tech.query_ring_count = 0;
 
 	if (status_changed) // Decrease rendering reference count
 		_effects[tech.effect_index].rendering--;
@@ -3512,7 +5936,7 @@ void reshade::runtime::load_effects(bool force_load_all)
 {
 	// Build a list of effect files by walking through the effect search paths
 	const std::vector<std::filesystem::path> effect_files =
-		find_files(_effect_search_paths, { L".fx", L".addonfx" });
+		find_files(_effect_search_paths, { L".fx", L".addonfx" }, _no_effect_cache ? std::filesystem::path() : g_reshade_base_path / _effect_cache_path / L"reshade-effect-files.txt");
 
 	if (effect_files.empty())
 		return; // No effect files found, so nothing more to do
@@ -3544,22 +5968,58 @@ void reshade::runtime::load_effects(bool force_load_all)
 	_effects.resize(offset + effect_files.size());
 	_reload_remaining_effects = effect_files.size();
 
-	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	size_t num_splits = std::min(effect_files.size(), static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 2u) - 1));
-#ifndef _WIN64
-	// Limit number of threads in 32-bit due to the limited about of address space being available there and compilation being memory hungry
-	num_splits = std::min(num_splits, static_cast<size_t>(4));
-#endif
+	// Put effects that were kept across a device reset back in place, so that 'load_effect' can skip compiling those whose source hash did not change
+	// A different back buffer size or format, different preprocessor definitions or modified source files change that hash, which causes the effect to be loaded from scratch again
+	if (!_effects_kept_across_reset.empty())
+	{
+		for (size_t i = 0; i < effect_files.size(); ++i)
+		{
+			if (const auto it = std::find_if(_effects_kept_across_reset.begin(), _effects_kept_across_reset.end(),
+					[&effect_file = effect_files[i]](const effect &effect) { return effect.source_file == effect_file; });
+				it != _effects_kept_across_reset.end())
+				_effects[offset + i] = std::move(*it);
+		}
 
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		_worker_threads.emplace_back([this, effect_files, offset, num_splits, n, &preset, force_load_all]() {
-			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
-			for (size_t i = 0; i < effect_files.size() && _is_initialized; ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], preset, offset + i, 0, force_load_all || effect_files[i].extension() == L".addonfx");
-		});
+		_effects_kept_across_reset.clear();
+	}
+
+	// Collect the effect files that techniques enabled in the current preset are declared in
+	// Techniques without an effect file name (from old presets) could be in any of them, in which case all effects are treated the same
+	std::set<std::string> preset_effect_names;
+	if (std::vector<std::string> techniques;
+		preset.get({}, "Techniques", techniques))
+	{
+		for (const std::string &technique : techniques)
+		{
+			const size_t at_pos = technique.find('@');
+			if (at_pos == std::string::npos)
+			{
+				preset_effect_names.clear();
+				break;
+			}
+
+			preset_effect_names.insert(technique.substr(at_pos + 1));
+		}
+	}
+
+	// Now that we have a list of files, load them in parallel on the worker pool (which limits the number of threads in flight)
+	// The default permutation is the one that is visible, so load it with the highest priority
+	// Effects used by the current preset are picked up before all others, so that the compiler time they need is not shared with unused effects, and submitted first within the same priority as well
+	for (const bool used_by_preset : { true, false })
+	{
+		for (size_t i = 0; i < effect_files.size(); ++i)
+		{
+			const bool is_used = preset_effect_names.empty() || effect_files[i].extension() == L".addonfx" || preset_effect_names.find(effect_files[i].filename().u8string()) != preset_effect_names.end();
+			if (is_used != used_by_preset)
+				continue;
+
+			_worker_pool->submit(is_used ? thread_pool::priority::high : thread_pool::priority::normal, [this, effect_file = effect_files[i], effect_index = offset + i, &preset, force_load_all]() {
+				// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
+				if (_is_initialized)
+					load_effect(effect_file, preset, effect_index, 0, force_load_all || effect_file.extension() == L".addonfx");
+			});
+		}
+	}
 }
 bool reshade::runtime::reload_effect(size_t effect_index)
 {
@@ -3585,8 +6045,114 @@ bool reshade::runtime::reload_effect(size_t effect_index)
 
 	return load_effect(source_file, ini_file::load_cache(_current_preset_path), effect_index, 0, true, true);
 }
+bool reshade::runtime::reload_dependent_effects(const std::filesystem::path &modified_file)
+{
+	bool any_reload_required = false;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+
+		if (effect.source_file != modified_file && !std::binary_search(effect.included_files.begin(), effect.included_files.end(), modified_file))
+			continue;
+
+		// Skip effects whose inputs have not actually changed since they were last loaded
+		if (effect.dependency_hash != 0 && effect.dependency_hash == compute_dependency_hash(effect.source_file, effect.included_files))
+			continue;
+
+		if (std::find(_reload_required_effects.begin(), _reload_required_effects.end(), std::make_pair(effect_index, static_cast<size_t>(0))) == _reload_required_effects.end())
+			_reload_required_effects.emplace_back(effect_index, 0);
+
+		any_reload_required = true;
+	}
+
+	return any_reload_required;
+}
+bool reshade::runtime::reload_dependent_textures(const std::filesystem::path &modified_file)
+{
+	bool any_reload_required = false;
+
+	for (texture &tex : _textures)
+	{
+		if (tex.resource == 0 || !tex.semantic.empty())
+			continue;
+
+		std::filesystem::path source_path = std::filesystem::u8path(tex.annotation_as_string("source"));
+		// Compare file names first, to avoid searching the texture search paths for every texture
+		if (source_path.empty() || source_path.filename() != modified_file.filename() ||
+			!find_file(_texture_search_paths, source_path) || source_path != modified_file)
+			continue;
+
+		// An upload that is still in progress would read the old contents, so discard it in favor of a new one
+		_texture_uploads.erase(std::remove_if(_texture_uploads.begin(), _texture_uploads.end(),
+			[&tex](const std::shared_ptr<texture_upload> &upload) { return upload->resource == tex.resource; }), _texture_uploads.end());
+
+		log::message(log::level::info, "Reloading texture '%s', since its image file was modified.", tex.unique_name.c_str());
+
+		any_reload_required |= load_texture(tex);
+	}
+
+	return any_reload_required;
+}
+void reshade::runtime::update_file_watcher()
+{
+	if (!_auto_reload_on_file_change)
+	{
+		_file_watcher.reset();
+		return;
+	}
+
+	if (_file_watcher == nullptr || _file_watcher_effect_search_paths != _effect_search_paths || _file_watcher_texture_search_paths != _texture_search_paths)
+	{
+		_file_watcher_effect_search_paths = _effect_search_paths;
+		_file_watcher_texture_search_paths = _texture_search_paths;
+
+		std::vector<std::pair<std::filesystem::path, bool>> directories;
+		for (const std::vector<std::filesystem::path> *search_paths : { &_effect_search_paths, &_texture_search_paths })
+		{
+			for (std::filesystem::path search_path : *search_paths)
+			{
+				const bool recursive = search_path.filename() == L"**";
+				if (recursive)
+					search_path.remove_filename();
+
+				std::error_code ec;
+				if (!resolve_path(search_path, ec))
+					continue;
+
+				// Effect and texture search paths commonly overlap, so only watch every directory once
+				if (const auto it = std::find_if(directories.begin(), directories.end(),
+						[&search_path](const std::pair<std::filesystem::path, bool> &directory) { return directory.first == search_path; });
+					it != directories.end())
+					it->second |= recursive;
+				else
+					directories.emplace_back(std::move(search_path), recursive);
+			}
+		}
+
+		_file_watcher = std::make_unique<file_watcher>(std::move(directories));
+	}
+
+	// Effects and textures are modified while loading, so leave any changes for when that finished
+	if (is_loading())
+		return;
+
+	std::vector<std::filesystem::path> modified_files;
+	if (!_file_watcher->poll(modified_files, std::chrono::milliseconds(250)))
+		return;
+
+	for (const std::filesystem::path &modified_file : modified_files)
+	{
+		if (reload_dependent_effects(modified_file))
+			log::message(log::level::info, "Reloading effects that depend on '%s', since it was modified.", modified_file.u8string().c_str());
+
+		reload_dependent_textures(modified_file);
+	}
+}
 void reshade::runtime::reload_effects(bool force_load_all)
 {
+	const startup_trace::scoped_span trace_span("runtime::reload_effects");
+
 	// Clear out any previous effects
 	destroy_effects();
 
@@ -3601,21 +6167,21 @@ void reshade::runtime::reload_effects(bool force_load_all)
 	_reload_count++;
 #endif
 	_last_reload_successful = true;
+	_memory_budget_exceeded = false;
 
 	load_effects(force_load_all);
 }
-void reshade::runtime::destroy_effects()
+void reshade::runtime::destroy_effects(bool keep_compiled_effects)
 {
 	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		if (thread.joinable())
-			thread.join();
-	_worker_threads.clear();
+	_worker_pool->wait_idle();
 
 #if RESHADE_GUI
 	_effect_filter[0] = '\0';
 #endif
 
+	_effects_generation++;
+
 	// Reset the effect creation queue
 	_reload_create_queue.clear();
 	_reload_required_effects.clear();
@@ -3627,6 +6193,19 @@ void reshade::runtime::destroy_effects()
 	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 		destroy_effect(effect_index);
 
+	if (keep_compiled_effects)
+	{
+		// 'destroy_effect' only releases the resources of an effect, but keeps its compiled module and shader assembly around
+		for (effect &effect : _effects)
+		{
+			// Other permutations are only recompiled on demand if missing (see 'update_effects'), but their techniques are not recreated, so drop them
+			if (effect.permutations.size() > 1)
+				effect.permutations.resize(1);
+		}
+
+		_effects_kept_across_reset = std::move(_effects);
+	}
+
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
 
@@ -3635,6 +6214,11 @@ void reshade::runtime::destroy_effects()
 		_device->destroy_sampler(sampler);
 	_effect_sampler_states.clear();
 
+	// Clean up pipeline layouts, which are shared between effects
+	for (const auto &[key, layout] : _effect_pipeline_layouts)
+		_device->destroy_pipeline_layout(layout);
+	_effect_pipeline_layouts.clear();
+
 	// Unload HLSL compiler which was previously loaded in 'load_effects' above
 	if (_d3d_compiler_module)
 	{
@@ -3652,58 +6236,18 @@ bool reshade::runtime::load_effect_cache(const std::string &id, const std::strin
 	if (_no_effect_cache)
 		return false;
 
-	std::filesystem::path path = g_reshade_base_path / _effect_cache_path;
-	path /= std::filesystem::u8path("reshade-" + id + '.' + type);
-
-	FILE *const file = _wfsopen(path.c_str(), L"rb", SH_DENYNO);
-	if (file == nullptr)
-		return false;
-
-	fseek(file, 0, SEEK_END);
-	const size_t file_size = ftell(file);
-	fseek(file, 0, SEEK_SET);
-
-	data.resize(file_size, '\0');
-	const size_t file_size_read = fread(data.data(), 1, data.size(), file);
-	fclose(file);
-	return file_size_read == data.size();
+	return _effect_cache->load(id + '.' + type, data);
 }
 bool reshade::runtime::save_effect_cache(const std::string &id, const std::string &type, const std::string &data) const
 {
 	if (_no_effect_cache)
 		return false;
 
-	std::filesystem::path path = g_reshade_base_path / _effect_cache_path;
-	path /= std::filesystem::u8path("reshade-" + id + '.' + type);
-
-	FILE *const file = _wfsopen(path.c_str(), L"wb", SH_DENYNO);
-	if (file == nullptr)
-		return false;
-
-	const size_t file_size_written = fwrite(data.data(), 1, data.size(), file);
-	fclose(file);
-	return file_size_written == data.size();
+	return _effect_cache->save(id + '.' + type, data);
 }
 void reshade::runtime::clear_effect_cache()
 {
-	std::error_code ec;
-
-	// Find all cached effect files and delete them
-	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(g_reshade_base_path / _effect_cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
-	{
-		if (entry.is_directory(ec))
-			continue;
-
-		const std::filesystem::path filename = entry.path().filename();
-		const std::filesystem::path extension = entry.path().extension();
-		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm"))
-			continue;
-
-		std::filesystem::remove(entry, ec);
-	}
-
-	if (ec)
-		log::message(log::level::error, "Failed to clear effect cache directory with error code %d!", ec.value());
+	_effect_cache->clear();
 }
 
 auto reshade::runtime::add_effect_permutation(uint32_t width, uint32_t height, api::format color_format, api::format stencil_format, api::color_space color_space) -> size_t
@@ -3737,11 +6281,11 @@ auto reshade::runtime::add_effect_permutation(uint32_t width, uint32_t height, a
 
 	_device->set_resource_name(permutation.color_tex, "ReShade back buffer");
 
-	if (!_device->create_resource_view(permutation.color_tex, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(color_format, 0)), &permutation.color_srv[0]) ||
-		!_device->create_resource_view(permutation.color_tex, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(color_format, 1)), &permutation.color_srv[1]))
+	if (!_resource_views->create_resource_view(permutation.color_tex, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(color_format, 0)), &permutation.color_srv[0]) ||
+		!_resource_views->create_resource_view(permutation.color_tex, api::resource_usage::shader_resource, api::resource_view_desc(api::format_to_default_typed(color_format, 1)), &permutation.color_srv[1]))
 	{
-		_device->destroy_resource_view(permutation.color_srv[1]);
-		_device->destroy_resource_view(permutation.color_srv[0]);
+		_resource_views->destroy_resource_view(permutation.color_srv[1]);
+		_resource_views->destroy_resource_view(permutation.color_srv[0]);
 		_device->destroy_resource(permutation.color_tex);
 
 		log::message(log::level::error, "Failed to create effect color resource view (format = %u)!", static_cast<uint32_t>(color_format));
@@ -3760,8 +6304,8 @@ auto reshade::runtime::add_effect_permutation(uint32_t width, uint32_t height, a
 
 		if (!_device->create_resource_view(permutation.stencil_tex, api::resource_usage::depth_stencil, api::resource_view_desc(stencil_format), &permutation.stencil_dsv))
 		{
-			_device->destroy_resource_view(permutation.color_srv[1]);
-			_device->destroy_resource_view(permutation.color_srv[0]);
+			_resource_views->destroy_resource_view(permutation.color_srv[1]);
+			_resource_views->destroy_resource_view(permutation.color_srv[0]);
 			_device->destroy_resource(permutation.color_tex);
 			_device->destroy_resource(permutation.stencil_tex);
 
@@ -3778,14 +6322,131 @@ auto reshade::runtime::add_effect_permutation(uint32_t width, uint32_t height, a
 	}
 
 	_effect_permutations.push_back(permutation);
+
+	// Remember permutations requested by add-ons after initialization for the next session
+	if (_is_initialized)
+		save_effect_permutations();
+
 	return _effect_permutations.size() - 1;
 }
+void reshade::runtime::load_effect_permutations(api::format stencil_format)
+{
+	std::string data;
+	if (!load_effect_cache("reshade-effect-permutations", "txt", data))
+		return;
+
+	for (const char *line = data.c_str(); *line != '\0';)
+	{
+		char *end = nullptr;
+		const auto width = static_cast<uint32_t>(std::strtoul(line, &end, 10));
+		const auto height = static_cast<uint32_t>(std::strtoul(end, &end, 10));
+		const auto color_format = static_cast<api::format>(std::strtoul(end, &end, 10));
+		const auto color_space = static_cast<api::color_space>(std::strtoul(end, &end, 10));
+
+		if (width != 0 && height != 0 && color_format != api::format::unknown)
+			add_effect_permutation(width, height, color_format, stencil_format, color_space);
+
+		line = std::strchr(end, '\n');
+		if (line == nullptr)
+			break;
+		line++;
+	}
+}
+void reshade::runtime::save_effect_permutations() const
+{
+	// Only keep the most recently added permutations, to avoid accumulating resources for sizes that are no longer used
+	constexpr size_t max_saved_permutations = 8;
+
+	std::string data;
+	for (size_t permutation_index = _effect_permutations.size() > max_saved_permutations + 1 ? _effect_permutations.size() - max_saved_permutations : 1; permutation_index < _effect_permutations.size(); ++permutation_index)
+	{
+		const effect_permutation &permutation = _effect_permutations[permutation_index];
+
+		data += std::to_string(permutation.width) + ' ' + std::to_string(permutation.height) + ' ' + std::to_string(static_cast<uint32_t>(permutation.color_format)) + ' ' + std::to_string(static_cast<uint32_t>(permutation.color_space)) + '\n';
+	}
+
+	save_effect_cache("reshade-effect-permutations", "txt", data);
+}
+
+void reshade::runtime::update_adaptive_performance_mode()
+{
+	if (_performance_mode || is_loading() || _is_in_preset_transition)
+		return;
+#if RESHADE_GUI
+	// Baked values are read back from the preset file, so it has to be up to date with the current values
+	if (!_auto_save_preset && _preset_is_modified)
+		return;
+#endif
+
+	const auto current_time = std::chrono::high_resolution_clock::now();
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+
+		if (!effect.compiled || effect.addon)
+			continue;
+
+		const std::string effect_name = effect.source_file.filename().u8string();
+		const auto baked_it = std::find(_baked_effects.begin(), _baked_effects.end(), effect_name);
+		const bool is_baked = baked_it != _baked_effects.end();
+
+		if (is_baked)
+		{
+			// Fall back to the generic version as soon as a baked value changes, so that the change becomes visible
+			if (_adaptive_performance_mode && !effect.baked_uniforms_changed)
+				continue;
+
+			// Baked values are specialization constants in Vulkan, so changes to them only require new pipelines, rather than a recompile
+			if (_adaptive_performance_mode && _renderer_id >= 0x20000 && update_effect_specialization_constants(effect_index))
+				continue;
+
+			const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+			_baked_effects.erase(baked_it);
+		}
+		else
+		{
+			if (!_adaptive_performance_mode || effect.rendering == 0 || (current_time - effect.last_uniform_change_time) < std::chrono::seconds(_adaptive_performance_mode_delay))
+				continue;
+
+			// Only worth recompiling if there are any values that can be baked
+			if (std::none_of(effect.uniforms.begin(), effect.uniforms.end(),
+					[](const uniform &variable) { return variable.special == special_uniform::none && variable.has_initializer_value; }))
+				continue;
+
+			const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+			_baked_effects.push_back(effect_name);
+		}
+
+		log::message(log::level::info, "Recompiling '%s' with its uniform values %s.", effect_name.c_str(), is_baked ? "no longer baked in" : "baked in");
+
+		// Only recompile a single effect at a time, which makes 'is_loading' true until it finished
+		reload_effect(effect_index);
+		break;
+	}
+}
 
 void reshade::runtime::update_effects()
 {
+	// Take the game state for this frame, which everything on the render thread reads instead of game memory
+	update_nfs_game_state();
+
 	// Delay first load to the first render call to avoid loading while the application is still initializing
 	if (_frame_count == 0 && !_no_reload_on_init)
 		reload_effects();
+	// The first frame in which all effects were loaded and created ends the startup trace
+	else if (_reload_remaining_effects == std::numeric_limits<size_t>::max() && _reload_create_queue.empty() && startup_trace::is_recording())
+		startup_trace::finish();
+
+	update_texture_uploads();
+
+	// Periodically release permutations that are no longer rendered to while over the memory budget
+	if (_memory_budget != 0 && !is_loading() && (_frame_count % 60) == 0 && get_total_memory_usage() > static_cast<uint64_t>(_memory_budget) * 1024 * 1024)
+		evict_cold_effect_permutations();
+
+	update_adaptive_performance_mode();
+
+	update_file_watcher();
 
 	if (!is_loading() && !_is_in_preset_transition && !_reload_required_effects.empty())
 	{
@@ -3813,7 +6474,7 @@ void reshade::runtime::update_effects()
 			{
 				_reload_remaining_effects += 1;
 
-				_worker_threads.emplace_back([this, effect_index, permutation_index]() {
+				_worker_pool->submit(thread_pool::priority::normal, [this, effect_index, permutation_index]() {
 						load_effect(_effects[effect_index].source_file, ini_file::load_cache(_current_preset_path), effect_index, permutation_index, true);
 					});
 			}
@@ -3829,15 +6490,27 @@ void reshade::runtime::update_effects()
 
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			if (thread.joinable())
-				thread.join(); // Threads have exited, but still need to join them prior to destruction
-		_worker_threads.clear();
+		// Write back the cache table of contents once all pending cache writes have been done, so that it survives a crash of the application
+		_worker_pool->submit(thread_pool::priority::low, [this]() { _effect_cache->flush(); });
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
 
+		// Compile enabled effects for all other permutations in the background as well, so that the first switch to one of them does not have to wait for compilation
+		for (size_t permutation_index = 1; permutation_index < _effect_permutations.size(); ++permutation_index)
+		{
+			for (const technique &tech : _techniques)
+			{
+				const effect &effect = _effects[tech.effect_index];
+
+				if (!tech.enabled || !effect.compiled || effect.metadata_only || permutation_index < effect.permutations.size())
+					continue;
+
+				if (std::find(_reload_required_effects.begin(), _reload_required_effects.end(), std::make_pair(tech.effect_index, permutation_index)) == _reload_required_effects.end())
+					_reload_required_effects.emplace_back(tech.effect_index, permutation_index);
+			}
+		}
+
 #if RESHADE_ADDON
 		invoke_addon_event<addon_event::reshade_set_current_preset_path>(this, _current_preset_path.u8string().c_str());
 #endif
@@ -3877,6 +6550,27 @@ void reshade::runtime::update_effects()
 	_reload_create_queue.pop_back();
 	effect &effect = _effects[effect_index];
 
+	// Check that initializing the effect does not exceed the memory budget, before any of its resources are created
+	if (_memory_budget != 0 && permutation_index == 0)
+	{
+		const uint64_t budget = static_cast<uint64_t>(_memory_budget) * 1024 * 1024;
+		const uint64_t additional_size = get_effect_gpu_memory_usage(effect_index, true) - get_effect_gpu_memory_usage(effect_index);
+
+		if (additional_size != 0 && get_total_memory_usage() + additional_size > budget &&
+			// Try to make room by evicting permutations that are not in use before giving up
+			(!evict_cold_effect_permutations() || get_total_memory_usage() + additional_size > budget))
+		{
+			log::message(log::level::warning, "Disabling techniques in '%s', because initializing it would exceed the memory budget of %u MiB.", effect.source_file.u8string().c_str(), _memory_budget);
+
+			for (technique &tech : _techniques)
+				if (tech.effect_index == effect_index)
+					disable_technique(tech);
+
+			_memory_budget_exceeded = true;
+			return;
+		}
+	}
+
 	if (!create_effect(effect_index, permutation_index))
 	{
 		_graphics_queue->wait_idle();
@@ -3910,17 +6604,30 @@ void reshade::runtime::update_effects()
 	}
 #endif
 
+	if (!_reload_create_queue.empty())
+		return;
+
+	// Effect loading finished, so any previously looked up handles are stale now
+	_effects_generation++;
+
+#if RESHADE_GUI
+	// Make sure the font atlas contains all glyphs the effects display in the overlay
+	request_effect_font_glyphs();
+#endif
+
 #if RESHADE_ADDON
-	if (_reload_create_queue.empty())
-		invoke_addon_event<addon_event::reshade_reloaded_effects>(this);
+	invoke_addon_event<addon_event::reshade_reloaded_effects>(this);
 #endif
 }
 void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource_view rtv, api::resource_view rtv_srgb)
 {
-	// Do not render effects twice in a frame
-	if (_effects_rendered_this_frame)
-		return;
-	_effects_rendered_this_frame = true;
+	// Do not render effects twice in a frame (other render stages only render their own techniques and may happen in addition)
+	if (_current_render_stage == nfs_render_stage::present)
+	{
+		if (_effects_rendered_this_frame)
+			return;
+		_effects_rendered_this_frame = true;
+	}
 
 	// Nothing to do here if effects are still loading or disabled globally
 	if (is_loading() || _techniques.empty())
@@ -3928,24 +6635,21 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 	if (!_effects_enabled && std::all_of(_effects.cbegin(), _effects.cend(), [](const effect &effect) { return !effect.addon; }))
 		return;
 
-	// Lock input so it cannot be modified by other threads while we are reading it here
-	std::unique_lock<std::recursive_mutex> input_lock;
-	if (_input != nullptr
-#if RESHADE_ADDON
-		&& !_is_in_present_call
-#endif
-		)
-		input_lock = _input->lock();
+	// Evaluate game flow rules once per frame, before any uniform updates or rendering happens
+	update_gameflow_exclusion();
 
 	// Update special uniform variables
 	for (effect &effect : _effects)
 	{
-		if (!effect.rendering || (!_effects_enabled && !effect.addon))
+		// Special uniforms are only updated once per frame at present, so that e.g. ping-pong values do not advance twice when rendering at additional render stages
+		if (effect.rendering == effect.rendering_gameflow_excluded || (!_effects_enabled && !effect.addon) || _current_render_stage != nfs_render_stage::present)
 			continue;
 
-		for (uniform &variable : effect.uniforms)
+		for (const special_uniform_binding &binding : effect.special_uniforms)
 		{
-			switch (variable.special)
+			uniform &variable = effect.uniforms[binding.uniform_index];
+
+			switch (binding.type)
 			{
 				case special_uniform::frame_time:
 				{
@@ -3962,19 +6666,17 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min", 0, 0);
-					const int max = variable.annotation_as_int("max", 0, RAND_MAX);
-					set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
+					set_uniform_value(variable, binding.min_int + (std::rand() % (std::abs(binding.max_int - binding.min_int) + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min", 0, 0.0f);
-					const float max = variable.annotation_as_float("max", 0, 1.0f);
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
+					const float min = binding.min;
+					const float max = binding.max;
+					const float step_min = binding.step[0];
+					const float step_max = binding.step[1];
 					float increment = step_max == 0 ? step_min : (step_min + std::fmod(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float smoothing = binding.smoothing;
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
@@ -4022,22 +6724,17 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					if (binding.mode == special_uniform_binding::input_mode::toggle)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
-						{
-							bool current_value = false;
-							get_uniform_value(variable, &current_value);
-							if (_input->is_key_pressed(keycode))
-								set_uniform_value(variable, !current_value);
-						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+						bool current_value = false;
+						get_uniform_value(variable, &current_value);
+						if (_input->is_key_pressed(binding.keycode))
+							set_uniform_value(variable, !current_value);
 					}
+					else if (binding.mode == special_uniform_binding::input_mode::press)
+						set_uniform_value(variable, _input->is_key_pressed(binding.keycode));
+					else
+						set_uniform_value(variable, _input->is_key_down(binding.keycode));
 					break;
 				}
 				case special_uniform::mouse_point:
@@ -4061,22 +6758,17 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					if (binding.mode == special_uniform_binding::input_mode::toggle)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
-						{
-							bool current_value = false;
-							get_uniform_value(variable, &current_value);
-							if (_input->is_mouse_button_pressed(keycode))
-								set_uniform_value(variable, !current_value);
-						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+						bool current_value = false;
+						get_uniform_value(variable, &current_value);
+						if (_input->is_mouse_button_pressed(binding.keycode))
+							set_uniform_value(variable, !current_value);
 					}
+					else if (binding.mode == special_uniform_binding::input_mode::press)
+						set_uniform_value(variable, _input->is_mouse_button_pressed(binding.keycode));
+					else
+						set_uniform_value(variable, _input->is_mouse_button_down(binding.keycode));
 					break;
 				}
 				case special_uniform::mouse_wheel:
@@ -4084,20 +6776,14 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					float step = variable.annotation_as_float("step");
-					if (step == 0.0f)
-						step  = 1.0f;
-
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
 					value[1] = _input->mouse_wheel_delta();
-					value[0] = value[0] + value[1] * step;
-					if (min != max)
+					value[0] = value[0] + value[1] * binding.step[0];
+					if (binding.min != binding.max)
 					{
-						value[0] = std::max(value[0], min);
-						value[0] = std::min(value[0], max);
+						value[0] = std::max(value[0], binding.min);
+						value[0] = std::min(value[0], binding.max);
 					}
 					set_uniform_value(variable, value, 2);
 					break;
@@ -4116,10 +6802,67 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 						set_uniform_value(variable, 0);
 					break;
 				}
-#endif
-				case special_uniform::screenshot:
+#endif
+				case special_uniform::screenshot:
+				{
+					set_uniform_value(variable, _should_save_screenshot);
+					break;
+				}
+				case special_uniform::dynamic_resolution:
+				{
+					set_uniform_value(variable, effect.resolution_scale);
+					break;
+				}
+				case special_uniform::nfs_gameflow:
+				{
+					set_uniform_value(variable, _nfs_game_state.gameflow_state);
+					break;
+				}
+				case special_uniform::nfs_game_speed:
+				{
+					set_uniform_value(variable, _nfs_game_state.game_speed);
+					break;
+				}
+				case special_uniform::nfs_precipitation:
+				{
+					set_uniform_value(variable, _nfs_game_state.precipitation);
+					break;
+				}
+				case special_uniform::nfs_fog:
+				{
+					set_uniform_value(variable, _nfs_game_state.fog, 2);
+					break;
+				}
+				case special_uniform::nfs_fog_color:
+				{
+					set_uniform_value(variable, _nfs_game_state.fog_color, 3);
+					break;
+				}
+				case special_uniform::nfs_visual_treatment:
+				{
+					set_uniform_value(variable, _nfs_game_state.visual_treatment);
+					break;
+				}
+				case special_uniform::nfs_vehicles:
+				{
+					// Every vehicle takes up a 'float4x4', with its orientation in the first three rows and its position and speed in the last one
+					float values[NFS_MAX_VEHICLES * 16] = {};
+					for (uint32_t i = 0; i < std::min(_nfs_game_state.vehicle_count, NFS_MAX_VEHICLES); ++i)
+					{
+						const api::nfs_vehicle &vehicle = _nfs_game_state.vehicles[i];
+						float *const row = values + i * 16;
+						for (int k = 0; k < 3; ++k)
+							std::copy_n(vehicle.orientation[k], 3, row + k * 4);
+						std::copy_n(vehicle.position, 3, row + 12);
+						row[15] = vehicle.speed;
+					}
+
+					set_uniform_value(variable, values, std::min(variable.size / 4, static_cast<uint32_t>(std::size(values))));
+					break;
+				}
+				case special_uniform::nfs_vehicle_count:
 				{
-					set_uniform_value(variable, _should_save_screenshot);
+					set_uniform_value(variable, std::min(_nfs_game_state.vehicle_count, NFS_MAX_VEHICLES));
 					break;
 				}
 			}
@@ -4154,6 +6897,8 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 			return;
 	}
 
+	_effect_permutations[permutation_index].last_used_frame = _frame_count;
+
 	if (!_is_in_present_call)
 		capture_state(cmd_list, _app_state);
 
@@ -4164,6 +6909,14 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 	cmd_list->begin_debug_event("ReShade effects");
 #endif
 
+	// Number of techniques with an update interval encountered so far, which offsets the frames they update in, so that they do not all land on the same frame
+	uint32_t amortized_technique_count = 0;
+
+	// The application may have changed shader constants since effects were last rendered
+	_uniform_push_effect_index = std::numeric_limits<size_t>::max();
+	// The same goes for the back buffer
+	_effect_permutations[permutation_index].color_tex_outdated = true;
+
 	// Render all enabled techniques
 	for (size_t technique_index : _technique_sorting)
 	{
@@ -4171,7 +6924,7 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 
 		const size_t effect_index = tech.effect_index;
 
-		if (!tech.enabled || (_should_save_screenshot && !tech.enabled_in_screenshot) || (!_effects_enabled && !_effects[effect_index].addon))
+		if (!tech.enabled || tech.gameflow_excluded || tech.render_stage != static_cast<uint32_t>(_current_render_stage) || (_should_save_screenshot && !tech.enabled_in_screenshot) || (!_effects_enabled && !_effects[effect_index].addon))
 			continue;
 
 		if (permutation_index >= tech.permutations.size() ||
@@ -4182,7 +6935,18 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 			continue;
 		}
 
-		render_technique(tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index);
+		// Always update fully when rendering to a different permutation, or when the technique was not rendered last frame and the results it left behind are stale
+		// The offline capture renders every frame at full quality, since it is not constrained by real time
+		bool full_update = true;
+		if (tech.update_interval > 1 && permutation_index == 0 && !tech.uses_transient_textures && !_nfs_capture_active)
+		{
+			full_update = tech.last_render_frame + 1 != _frame_count || (_frame_count + amortized_technique_count) % tech.update_interval == 0;
+			amortized_technique_count++;
+		}
+		if (permutation_index == 0)
+			tech.last_render_frame = _frame_count;
+
+		render_technique(tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index, full_update);
 
 		if (tech.time_left > 0)
 		{
@@ -4203,20 +6967,76 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 		apply_state(cmd_list, _app_state);
 #endif
 }
-void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index)
+void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index, bool full_update)
 {
-	const effect &effect = _effects[tech.effect_index];
+	effect &effect = _effects[tech.effect_index];
 	const effect::permutation &permutation = effect.permutations[permutation_index];
 
 #if RESHADE_GUI
+	tech.query_ring_active = std::numeric_limits<uint32_t>::max();
+
 	if (_gather_gpu_statistics && _timestamp_frequency != 0 && effect.query_heap != 0 && permutation_index == 0)
 	{
-		// Evaluate queries from oldest frame in queue
-		if (uint64_t timestamps[2];
-			_device->get_query_heap_results(effect.query_heap, tech.query_base_index + (_frame_count % 4) * 2, 2, timestamps, sizeof(uint64_t)))
-			tech.average_gpu_duration.append((timestamps[1] - timestamps[0]) * 1000000000ull / _timestamp_frequency);
+		// Evaluate queries from the oldest frames in the ring, but stop at the first one that is not ready yet instead of waiting for it
+		while (tech.query_ring_count != 0)
+		{
+			const uint32_t query_index = tech.query_base_index + tech.query_ring_head * tech.query_stride;
+
+			uint64_t timestamps[2];
+			if (!_device->get_query_heap_results(effect.query_heap, query_index, 2, timestamps, sizeof(uint64_t)))
+			{
+				// Allow more frames in flight if results take longer than the current ring depth to become available
+				if (tech.query_ring_count >= tech.query_ring_depth && tech.query_ring_depth < technique::QUERY_RING_SIZE)
+					tech.query_ring_depth++;
+				break;
+			}
+
+			const uint64_t duration = (timestamps[1] - timestamps[0]) * 1000000000ull / _timestamp_frequency;
+			tech.average_gpu_duration.append(duration);
+
+			uint32_t histogram_bucket = 0;
+			for (uint64_t duration_us = duration / 1000; duration_us != 0 && histogram_bucket < technique::GPU_DURATION_HISTOGRAM_SIZE - 1; duration_us >>= 1)
+				histogram_bucket++;
+			tech.gpu_duration_histogram[histogram_bucket]++;
+
+			if (tech.query_ring_pass_timings[tech.query_ring_head])
+			{
+				// The timestamps after each pass were resolved together with the ones of the technique, so are available as well
+				std::vector<uint64_t> &pass_timestamps = _technique_pass_timestamps;
+				assert(pass_timestamps.empty());
+				pass_timestamps.resize(tech.query_stride - 2);
+
+				if (!pass_timestamps.empty() && _device->get_query_heap_results(effect.query_heap, query_index + 2, static_cast<uint32_t>(pass_timestamps.size()), pass_timestamps.data(), sizeof(uint64_t)))
+				{
+					for (size_t pass_index = 0; pass_index < pass_timestamps.size() && pass_index < tech.average_pass_gpu_durations.size(); ++pass_index)
+					{
+						const uint64_t pass_start = pass_index == 0 ? timestamps[0] : pass_timestamps[pass_index - 1];
+						tech.average_pass_gpu_durations[pass_index].append((pass_timestamps[pass_index] - pass_start) * 1000000000ull / _timestamp_frequency);
+					}
+				}
+
+				pass_timestamps.clear();
+			}
+
+			// Shrink the ring again if results arrive with less latency than it allows for
+			const uint64_t latency = _frame_count - tech.query_ring_frames[tech.query_ring_head];
+			if (latency + 1 < tech.query_ring_depth && tech.query_ring_depth > 2)
+				tech.query_ring_depth--;
+
+			tech.query_ring_head = (tech.query_ring_head + 1) % technique::QUERY_RING_SIZE;
+			tech.query_ring_count--;
+		}
+
+		// Skip measuring this frame if all slots are still in flight, rather than overwriting a query whose result was not read yet
+		if (tech.query_ring_count < tech.query_ring_depth)
+		{
+			tech.query_ring_active = (tech.query_ring_head + tech.query_ring_count) % technique::QUERY_RING_SIZE;
+			tech.query_ring_frames[tech.query_ring_active] = _frame_count;
+			tech.query_ring_pass_timings[tech.query_ring_active] = _gather_pass_gpu_statistics;
+			tech.query_ring_count++;
 
-		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_frame_count % 4) * 2);
+			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + tech.query_ring_active * tech.query_stride);
+		}
 	}
 
 	const std::chrono::high_resolution_clock::time_point time_technique_started = std::chrono::high_resolution_clock::now();
@@ -4226,26 +7046,143 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 	cmd_list->begin_debug_event(tech.name.c_str());
 #endif
 
-	// Update shader constants
-	if (void *mapped_uniform_data;
-		effect.cb != 0 && _device->map_buffer_region(effect.cb, 0, std::numeric_limits<uint64_t>::max(), api::map_access::write_discard, &mapped_uniform_data))
+	// Update shader constants, but only if any uniform value changed since they were last uploaded
+	if (effect.cb != 0)
 	{
-		std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
-		_device->unmap_buffer_region(effect.cb);
+		// Mapping with discard does not preserve the previous contents, so always have to rewrite the entire buffer
+		if (void *mapped_uniform_data;
+			effect.is_uniform_data_dirty() && _device->map_buffer_region(effect.cb, 0, std::numeric_limits<uint64_t>::max(), api::map_access::write_discard, &mapped_uniform_data))
+		{
+			std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+			_device->unmap_buffer_region(effect.cb);
+
+			effect.uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+			effect.uniform_data_dirty_end = 0;
+		}
 	}
 	else if (_renderer_id == 0x9000)
 	{
-		cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+		// Shader constants are global device state in D3D9 that other effects overwrite, so only the changed registers can be pushed if this effect was the last one to push
+		if (_uniform_push_effect_index != tech.effect_index)
+		{
+			cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+			_uniform_push_effect_index = tech.effect_index;
+		}
+		else if (effect.is_uniform_data_dirty())
+		{
+			// Round out to whole registers
+			const size_t dirty_begin = effect.uniform_data_dirty_begin & ~size_t(15);
+			const size_t dirty_end = std::min((effect.uniform_data_dirty_end + 15) & ~size_t(15), effect.uniform_data_storage.size());
+			cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, static_cast<uint32_t>(dirty_begin / 4), static_cast<uint32_t>((dirty_end - dirty_begin) / 4), effect.uniform_data_storage.data() + dirty_begin);
+		}
+
+		effect.uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+		effect.uniform_data_dirty_end = 0;
 	}
 
 	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
+	// Shadow of the state bound by previous passes of this technique on the command list, so that binds which would not change anything can be skipped
+	// This is not kept across techniques, since add-ons may bind arbitrary state in between
+	struct
+	{
+		api::pipeline pipeline[2];
+		api::descriptor_table tables[2][4];
+		uint32_t viewport_width, viewport_height;
+	} shadow = {};
+	bool pixel_size_constants_set = false;
+
+	const auto bind_descriptor_table_if_changed = [cmd_list, &shadow, &permutation](api::shader_stage stages, uint32_t param_index, api::descriptor_table table) {
+		api::descriptor_table &current_table = shadow.tables[stages == api::shader_stage::all_compute ? 1 : 0][param_index];
+		if (current_table == table)
+			return;
+		current_table = table;
+		cmd_list->bind_descriptor_table(stages, permutation.layout, param_index, table);
+	};
+
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_back_buffer_copy = true; // First pass always needs the back buffer updated
+	// Copy of the back buffer is shared by all techniques rendered to it, so it is only updated when a pass needs it and it changed since, rather than before every technique
+	bool &needs_implicit_back_buffer_copy = _effect_permutations[permutation_index].color_tex_outdated;
+
+	// Resources written by passes of this technique that are not in shader resource state, which stay in their state until a later pass needs them in a different one
+	// This way passes that write the same resources one after another, like chains of compute passes, do not transition them back and forth
+	std::vector<std::pair<api::resource, api::resource_usage>> &resource_states = _technique_resource_states;
+	assert(resource_states.empty());
+
+	// Transitions are collected and then issued with a single barrier call right before the next draw or dispatch
+	std::vector<api::resource> &barrier_resources = _technique_barrier_resources;
+	std::vector<api::resource_usage> &barrier_states_old = _technique_barrier_states_old;
+	std::vector<api::resource_usage> &barrier_states_new = _technique_barrier_states_new;
+	assert(barrier_resources.empty());
+
+	const auto transition_resource = [&](api::resource resource, api::resource_usage usage) {
+		const auto it = std::find_if(resource_states.begin(), resource_states.end(),
+			[resource](const std::pair<api::resource, api::resource_usage> &state) { return state.first == resource; });
+		const api::resource_usage current_usage = it != resource_states.end() ? it->second : api::resource_usage::shader_resource;
+
+		// Unordered access after unordered access still needs a barrier, to order the writes of the previous dispatch before those of the next one
+		if (current_usage == usage && usage != api::resource_usage::unordered_access)
+			return;
+
+		barrier_resources.push_back(resource);
+		barrier_states_old.push_back(current_usage);
+		barrier_states_new.push_back(usage);
+
+		if (it == resource_states.end())
+			resource_states.push_back({ resource, usage });
+		else if (usage != api::resource_usage::shader_resource)
+			it->second = usage;
+		else
+			resource_states.erase(it);
+	};
+	const auto flush_barriers = [&]() {
+		if (barrier_resources.empty())
+			return;
+
+		cmd_list->barrier(static_cast<uint32_t>(barrier_resources.size()), barrier_resources.data(), barrier_states_old.data(), barrier_states_new.data());
+
+		// Transitioning resources away from shader resource or unordered access usage unbinds them in some APIs (see 'device_context_impl::barrier' in D3D11), so cannot rely on resource bindings surviving those
+		if (_renderer_id != 0x9000 && barrier_states_old != barrier_states_new)
+		{
+			const uint32_t texture_param_index = sampler_with_resource_view ? 1 : 2;
+			shadow.tables[0][texture_param_index] = shadow.tables[1][texture_param_index] = {};
+			shadow.tables[0][texture_param_index + 1] = shadow.tables[1][texture_param_index + 1] = {};
+		}
+
+		barrier_resources.clear();
+		barrier_states_old.clear();
+		barrier_states_new.clear();
+	};
+
+#if RESHADE_GUI
+	const bool write_pass_timestamps = tech.query_ring_active != std::numeric_limits<uint32_t>::max() && tech.query_ring_pass_timings[tech.query_ring_active];
+	const uint32_t pass_query_index = tech.query_base_index + tech.query_ring_active * tech.query_stride + 2;
+#endif
 
 	for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index)
 	{
-		if (needs_implicit_back_buffer_copy)
+		const technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+
+#if RESHADE_GUI
+		// Stamp the end of the previous pass here, so that passes which are skipped below still get a (close to zero) duration
+		if (write_pass_timestamps && pass_index != 0)
+			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, pass_query_index + static_cast<uint32_t>(pass_index) - 1);
+#endif
+
+		// Between full updates only composite the results of the last one, which are still in the render targets of the other passes
+		if (!full_update && (!pass.cs_entry_point.empty() || !pass.render_target_names[0].empty()))
+			continue;
+
+		// Passes that are known to leave their render targets unchanged for the current value of a boolean uniform are skipped, along with the back buffer copy they would need
+		if (pass.skip_uniform_index < effect.uniforms.size())
+		{
+			bool value = false;
+			get_uniform_value(effect.uniforms[pass.skip_uniform_index], &value);
+			if (value == pass.skip_uniform_value)
+				continue;
+		}
+
+		if (needs_implicit_back_buffer_copy && pass.samples_back_buffer)
 		{
 			// Save back buffer of previous pass
 			const api::resource resources[2] = { back_buffer_resource, _effect_permutations[permutation_index].color_tex};
@@ -4255,52 +7192,81 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			cmd_list->barrier(2, resources, state_old, state_new);
 			cmd_list->copy_texture_region(back_buffer_resource, 0, nullptr, _effect_permutations[permutation_index].color_tex, 0, nullptr);
 			cmd_list->barrier(2, resources, state_new, state_old);
-		}
 
-		const technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+			needs_implicit_back_buffer_copy = false;
+		}
 
 #ifndef NDEBUG
 		cmd_list->begin_debug_event((pass.name.empty() ? "Pass " + std::to_string(pass_index) : pass.name).c_str());
 #endif
 
-		const uint32_t num_barriers = static_cast<uint32_t>(pass.modified_resources.size());
+		// Resources a previous pass left in another state have to be transitioned back before this pass can sample them
+		for (const api::resource resource : pass.sampled_resources)
+			transition_resource(resource, api::resource_usage::shader_resource);
 
-		if (!pass.cs_entry_point.empty())
+		// Generate mipmaps of textures this pass depends on that were modified since, instead of after every pass modifying them, so that this is skipped when nothing that is rendered reads them
+		const auto is_mipmap_pending = [this](api::resource_view view) {
+			return std::find(_pending_mipmap_views.cbegin(), _pending_mipmap_views.cend(), view) != _pending_mipmap_views.cend();
+		};
+		if (std::any_of(pass.mipmap_dependent_views.cbegin(), pass.mipmap_dependent_views.cend(), is_mipmap_pending))
 		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_back_buffer_copy = false;
+			// Mipmap generation expects textures in shader resource state
+			for (const api::resource_view view : pass.mipmap_dependent_views)
+				if (is_mipmap_pending(view))
+					transition_resource(_device->get_resource_from_view(view), api::resource_usage::shader_resource);
+			flush_barriers();
+
+			for (const api::resource_view view : pass.mipmap_dependent_views)
+			{
+				if (const auto it = std::find(_pending_mipmap_views.cbegin(), _pending_mipmap_views.cend(), view);
+					it != _pending_mipmap_views.cend())
+				{
+					cmd_list->generate_mipmaps(view);
+					_pending_mipmap_views.erase(it);
+				}
+			}
 
-			cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass.pipeline);
+			// Mipmap generation may be implemented with a separate pipeline and bindings, so forget about any previous state
+			shadow = {};
+		}
+
+		if (!pass.cs_entry_point.empty())
+		{
+			if (shadow.pipeline[1] != pass.pipeline)
+			{
+				shadow.pipeline[1] = pass.pipeline;
+				cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass.pipeline);
+			}
 
-			temp_mem<api::resource_usage> state_old, state_new;
-			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
-			std::fill_n(state_new.p, num_barriers, api::resource_usage::unordered_access);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
+			for (const api::resource resource : pass.modified_resources)
+				transition_resource(resource, api::resource_usage::unordered_access);
+			flush_barriers();
 
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
+			// Bindings are reset after a call to 'generate_mipmaps' below (which invalidates them), otherwise only changed ones are bound
 			if (effect.cb != 0)
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 0, permutation.cb_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_compute, 0, permutation.cb_table);
 			if (permutation.sampler_table != 0)
 				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, 1, permutation.sampler_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_compute, 1, permutation.sampler_table);
 			if (!pass.texture_bindings.empty())
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, sampler_with_resource_view ? 1 : 2, pass.texture_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_compute, sampler_with_resource_view ? 1 : 2, pass.texture_table);
 			if (!pass.storage_bindings.empty())
-				cmd_list->bind_descriptor_table(api::shader_stage::all_compute, permutation.layout, sampler_with_resource_view ? 2 : 3, pass.storage_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_compute, sampler_with_resource_view ? 2 : 3, pass.storage_table);
 
 			cmd_list->dispatch(pass.viewport_width, pass.viewport_height, pass.viewport_dispatch_z);
-
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_new.p, state_old.p);
 		}
 		else
 		{
-			cmd_list->bind_pipeline(api::pipeline_stage::all_graphics, pass.pipeline);
+			if (shadow.pipeline[0] != pass.pipeline)
+			{
+				shadow.pipeline[0] = pass.pipeline;
+				cmd_list->bind_pipeline(api::pipeline_stage::all_graphics, pass.pipeline);
+			}
 
 			// Transition resource state for render targets
-			temp_mem<api::resource_usage> state_old, state_new;
-			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
-			std::fill_n(state_new.p, num_barriers, api::resource_usage::render_target);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
+			for (const api::resource resource : pass.modified_resources)
+				transition_resource(resource, api::resource_usage::render_target);
+			flush_barriers();
 
 			// Setup render targets
 			uint32_t render_target_count = 0;
@@ -4316,8 +7282,6 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			}
 			else
 			{
-				needs_implicit_back_buffer_copy = false;
-
 				for (int i = 0; i < 8 && pass.render_target_views[i] != 0; ++i, ++render_target_count)
 					render_target[i].view = pass.render_target_views[i];
 			}
@@ -4328,6 +7292,15 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 					render_target[i].load_op = api::render_pass_load_op::clear;
 			}
 
+			// Passes of techniques that opted into dynamic resolution only render to the top-left part of their render targets, which the effect then upsamples from in the pass writing to the back buffer
+			uint32_t viewport_width = pass.viewport_width;
+			uint32_t viewport_height = pass.viewport_height;
+			if (tech.dynamic_resolution && !pass.render_target_names[0].empty() && effect.resolution_scale < 1.0f)
+			{
+				viewport_width = std::max(1u, static_cast<uint32_t>(viewport_width * effect.resolution_scale + 0.5f));
+				viewport_height = std::max(1u, static_cast<uint32_t>(viewport_height * effect.resolution_scale + 0.5f));
+			}
+
 			if (pass.stencil_enable &&
 				pass.viewport_width == _effect_permutations[permutation_index].width &&
 				pass.viewport_height == _effect_permutations[permutation_index].height)
@@ -4341,82 +7314,128 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 
 			cmd_list->begin_render_pass(render_target_count, render_target, depth_stencil.view != 0 ? &depth_stencil : nullptr);
 
-			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
+			// Bindings are reset after a call to 'generate_mipmaps' below (which invalidates them), otherwise only changed ones are bound
 			if (effect.cb != 0)
-				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 0, permutation.cb_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_graphics, 0, permutation.cb_table);
 			if (permutation.sampler_table != 0)
 				assert(!sampler_with_resource_view),
-				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, 1, permutation.sampler_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_graphics, 1, permutation.sampler_table);
 			// Setup shader resources after binding render targets, to ensure any OM bindings by the application are unset at this point (e.g. a depth buffer that was bound to the OM and is now bound as shader resource)
 			if (!pass.texture_bindings.empty())
-				cmd_list->bind_descriptor_table(api::shader_stage::all_graphics, permutation.layout, sampler_with_resource_view ? 1 : 2, pass.texture_table);
+				bind_descriptor_table_if_changed(api::shader_stage::all_graphics, sampler_with_resource_view ? 1 : 2, pass.texture_table);
 
+			// Viewport and scissor rectangle are always set, since binding render targets resets them in D3D9
 			const api::viewport viewport = {
 				0.0f, 0.0f,
-				static_cast<float>(pass.viewport_width),
-				static_cast<float>(pass.viewport_height),
+				static_cast<float>(viewport_width),
+				static_cast<float>(viewport_height),
 				0.0f, 1.0f
 			};
 			cmd_list->bind_viewports(0, 1, &viewport);
 
-			const api::rect scissor_rect = {
-				0, 0,
-				static_cast<int32_t>(pass.viewport_width),
-				static_cast<int32_t>(pass.viewport_height)
+			api::rect scissor_rects[2] = {
+				{ 0, 0, static_cast<int32_t>(viewport_width), static_cast<int32_t>(viewport_height) }
 			};
-			cmd_list->bind_scissor_rects(0, 1, &scissor_rect);
+			uint32_t scissor_rect_count = 1;
+
+			// Passes of techniques that opted into foveation only render the centre region of each eye, which are side-by-side in the back buffer of VR runtimes
+			// The periphery keeps the image without this technique applied when writing to the back buffer, so only full resolution passes are restricted, since those are the expensive ones and smaller render targets cannot be assumed to map to the eyes
+			if (_is_vr && _nfs_foveation && tech.foveated && _nfs_foveation_region < 1.0f &&
+				(pass.render_target_names[0].empty() || (
+				pass.viewport_width == _effect_permutations[permutation_index].width &&
+				pass.viewport_height == _effect_permutations[permutation_index].height)))
+			{
+				const float region = pass.render_target_names[0].empty() ? _nfs_foveation_region : std::min(_nfs_foveation_region + 2 * FOVEATION_MARGIN, 1.0f);
+				const float eye_width = viewport_width * 0.5f;
+				const int32_t half_width = static_cast<int32_t>(eye_width * region * 0.5f + 0.5f);
+				const int32_t half_height = static_cast<int32_t>(viewport_height * region * 0.5f + 0.5f);
+
+				for (uint32_t eye = 0; eye < 2; ++eye)
+				{
+					const int32_t center_x = static_cast<int32_t>(eye_width * (eye + 0.5f));
+					const int32_t center_y = static_cast<int32_t>(viewport_height / 2);
+
+					scissor_rects[eye] = {
+						std::max(center_x - half_width, static_cast<int32_t>(eye_width * eye)),
+						std::max(center_y - half_height, 0),
+						std::min(center_x + half_width, static_cast<int32_t>(eye_width * (eye + 1))),
+						std::min(center_y + half_height, static_cast<int32_t>(viewport_height))
+					};
+				}
+				scissor_rect_count = 2;
+			}
 
 			if (_renderer_id == 0x9000)
 			{
 				// Set __TEXEL_SIZE__ constant (see effect_codegen_hlsl.cpp)
-				const float texel_size[4] = {
-					-1.0f / pass.viewport_width,
-					 1.0f / pass.viewport_height
-				};
-				cmd_list->push_constants(api::shader_stage::vertex, permutation.layout, 0, 255 * 4, 4, texel_size);
-
-				// Set SEMANTIC_PIXEL_SIZE constants (see 'load_effect' above)
-				uint32_t semantic_index = 0;
-				for (const reshadefx::texture &tex : permutation.module.textures)
+				if (shadow.viewport_width != viewport_width || shadow.viewport_height != viewport_height)
 				{
-					if (tex.semantic.empty() || tex.semantic == "COLOR")
-						continue;
+					shadow.viewport_width = viewport_width;
+					shadow.viewport_height = viewport_height;
 
-					semantic_index++;
+					const float texel_size[4] = {
+						-1.0f / viewport_width,
+						 1.0f / viewport_height
+					};
+					cmd_list->push_constants(api::shader_stage::vertex, permutation.layout, 0, 255 * 4, 4, texel_size);
+				}
 
-					if (const auto it = _texture_semantic_bindings.find(tex.semantic);
-						it != _texture_semantic_bindings.end())
+				// Set SEMANTIC_PIXEL_SIZE constants (see 'load_effect' above), which are the same for all passes
+				if (!pixel_size_constants_set)
+				{
+					uint32_t semantic_index = 0;
+					for (const uint32_t semantic_id : permutation.texture_semantic_ids)
 					{
-						const api::resource_desc desc = _device->get_resource_desc(_device->get_resource_from_view(it->second.first));
+						semantic_index++;
 
-						const float pixel_size[4] = {
-							1.0f / desc.texture.width,
-							1.0f / desc.texture.height
-						};
+						if (const texture_semantic_binding &binding = _texture_semantic_bindings[semantic_id];
+							binding.srv != 0)
+						{
+							const api::resource_desc desc = _device->get_resource_desc(_device->get_resource_from_view(binding.srv));
+
+							const float pixel_size[4] = {
+								1.0f / desc.texture.width,
+								1.0f / desc.texture.height
+							};
 
-						cmd_list->push_constants(api::shader_stage::vertex | api::shader_stage::pixel, permutation.layout, 0, (244 - semantic_index) * 4, 4, pixel_size);
+							cmd_list->push_constants(api::shader_stage::vertex | api::shader_stage::pixel, permutation.layout, 0, (244 - semantic_index) * 4, 4, pixel_size);
+						}
 					}
+
+					pixel_size_constants_set = true;
 				}
 			}
 
-			// Draw primitives
-			cmd_list->draw(pass.num_vertices, 1, 0, 0);
+			// Draw primitives, once for each scissor rectangle, since only a single viewport is bound
+			for (uint32_t i = 0; i < scissor_rect_count; ++i)
+			{
+				cmd_list->bind_scissor_rects(0, 1, &scissor_rects[i]);
+				cmd_list->draw(pass.num_vertices, 1, 0, 0);
+			}
 
 			cmd_list->end_render_pass();
-
-			// Transition resource state back to shader access
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_new.p, state_old.p);
 		}
 
-		// Generate mipmaps for modified resources
+		// Only remember that mipmaps of modified textures are out of date, they are generated before the next pass that depends on them (which may be in a later technique or frame)
 		for (const api::resource_view modified_texture : pass.generate_mipmap_views)
-			cmd_list->generate_mipmaps(modified_texture);
+			if (std::find(_pending_mipmap_views.cbegin(), _pending_mipmap_views.cend(), modified_texture) == _pending_mipmap_views.cend())
+				_pending_mipmap_views.push_back(modified_texture);
 
 #ifndef NDEBUG
 		cmd_list->end_debug_event();
 #endif
 	}
 
+#if RESHADE_GUI
+	if (write_pass_timestamps && !tech.permutations[permutation_index].passes.empty())
+		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, pass_query_index + static_cast<uint32_t>(tech.permutations[permutation_index].passes.size()) - 1);
+#endif
+
+	// Later techniques and effects expect all resources in shader resource state again
+	while (!resource_states.empty())
+		transition_resource(resource_states.back().first, api::resource_usage::shader_resource);
+	flush_barriers();
+
 #ifndef NDEBUG
 	cmd_list->end_debug_event();
 #endif
@@ -4426,8 +7445,8 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 
 	tech.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
 
-	if (_gather_gpu_statistics && _timestamp_frequency != 0 && effect.query_heap != 0 && permutation_index == 0)
-		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + (_frame_count % 4) * 2 + 1);
+	if (tech.query_ring_active != std::numeric_limits<uint32_t>::max())
+		cmd_list->end_query(effect.query_heap, api::query_type::timestamp, tech.query_base_index + tech.query_ring_active * tech.query_stride + 1);
 #endif
 
 #if RESHADE_ADDON
@@ -4437,6 +7456,10 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 	_is_in_api_call = true;
 	invoke_addon_event<addon_event::reshade_render_technique>(const_cast<runtime *>(this), api::effect_technique { reinterpret_cast<uintptr_t>(&tech) }, cmd_list, back_buffer_rtv, back_buffer_rtv_srgb);
 	_is_in_api_call = false;
+
+	// Add-ons may have drawn to the back buffer
+	if (has_addon_event<addon_event::reshade_render_technique>())
+		needs_implicit_back_buffer_copy = true;
 #endif
 }
 
@@ -4458,7 +7481,7 @@ void reshade::runtime::save_texture(const texture &tex)
 	if (std::vector<uint8_t> pixels(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * 4);
 		get_texture_data(tex.resource, api::resource_usage::shader_resource, pixels.data()))
 	{
-		_worker_threads.emplace_back([this, screenshot_path, pixels = std::move(pixels), width = tex.width, height = tex.height]() mutable {
+		_worker_pool->submit(thread_pool::priority::low, [this, screenshot_path, pixels = std::move(pixels), width = tex.width, height = tex.height]() mutable {
 			// Default to a save failure unless it is reported to succeed below
 			bool save_success = false;
 
@@ -4476,7 +7499,7 @@ void reshade::runtime::save_texture(const texture &tex)
 				case 1:
 #if 1
 					if (std::vector<uint8_t> encoded_data;
-						fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 4, encoded_data))
+						utils::encode_png(*_worker_pool, pixels.data(), width, height, 4, encoded_data))
 						save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
 #else
 					save_success = stbi_write_png_to_func(write_callback, file, width, height, 4, pixels.data(), 0) != 0;
@@ -4504,6 +7527,16 @@ void reshade::runtime::save_texture(const texture &tex)
 }
 void reshade::runtime::update_texture(texture &tex, uint32_t width, uint32_t height, uint32_t depth, const void *pixels)
 {
+	if (tex.compressed_format != api::format::unknown)
+	{
+		log::message(log::level::error, "Texture '%s' is block compressed and can therefore only be loaded from its source image.", tex.unique_name.c_str());
+		return;
+	}
+	if (tex.reduced_format != api::format::unknown)
+	{
+		log::message(log::level::error, "Texture '%s' was created with reduced precision and can therefore not be updated with data in its declared format.", tex.unique_name.c_str());
+		return;
+	}
 	if (tex.depth != depth || (tex.depth != 1 && (tex.width != width || tex.height != height)))
 	{
 		log::message(log::level::error, "Resizing image data is not supported for 3D textures like '%s'.", tex.unique_name.c_str());
@@ -4597,6 +7630,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	if (variable.special != reshade::special_uniform::none)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		_effects[variable.effect_index].mark_uniform_data_dirty(variable.offset, variable.size);
 		return;
 	}
 
@@ -4637,7 +7671,7 @@ void reshade::runtime::get_uniform_value_data(const uniform &variable, uint8_t *
 	size = std::min(size, static_cast<size_t>(variable.size));
 	assert(data != nullptr && (size % 4) == 0);
 
-	const std::vector<uint8_t> &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	const std::vector<uint8_t> &data_storage = variable.baked ? _effects[variable.effect_index].baked_uniform_data : _effects[variable.effect_index].uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1u);
@@ -4735,15 +7769,43 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 	}
 #endif
 
+	if (store_uniform_value_data(variable, data, size, base_index))
+		_effects[variable.effect_index].last_uniform_change_time = std::chrono::high_resolution_clock::now();
+}
+bool reshade::runtime::store_uniform_value_data(uniform &variable, const uint8_t *data, size_t size, size_t base_index)
+{
 	size = std::min(size, static_cast<size_t>(variable.size));
 	assert(data != nullptr && (size % 4) == 0);
 
-	std::vector<uint8_t> &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	effect &effect = _effects[variable.effect_index];
+	std::vector<uint8_t> &data_storage = variable.baked ? effect.baked_uniform_data : effect.uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1u);
 	if (assert(base_index < array_length); base_index >= array_length)
-		return;
+		return false;
+
+	// Only mark bytes that actually change as dirty, since most uniforms are set to the same value again every frame
+	// Values applied while loading do not count as changes for the adaptive performance mode, since they come from the preset the effect was compiled with
+	// The caller updates the change time, so that it is only queried once for a batch of updates
+	bool changed = false;
+	const bool is_user_change = variable.special == special_uniform::none && !is_loading();
+	const auto write_data = [&effect, &data_storage, &variable, is_user_change, &changed](size_t offset, const uint8_t *source, size_t source_size) {
+		uint8_t *const dest = data_storage.data() + offset;
+		if (std::memcmp(dest, source, source_size) == 0)
+			return;
+		std::memcpy(dest, source, source_size);
+
+		if (is_user_change)
+		{
+			changed = true;
+			effect.baked_uniforms_changed |= variable.baked;
+		}
+
+		// Baked values are not part of the constant buffer
+		if (!variable.baked)
+			effect.mark_uniform_data_dirty(offset, source_size);
+	};
 
 	if (variable.type.is_matrix())
 	{
@@ -4751,8 +7813,8 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 			// Each row of a matrix is 16-byte aligned, so needs special handling
 			for (size_t row = 0; row < variable.type.rows; ++row)
 				for (size_t col = 0; i < (size / 4) && col < variable.type.cols; ++col, ++i)
-					std::memcpy(
-						data_storage.data() + variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
+					write_data(
+						variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
 						data + ((a - base_index) * variable.type.components() + (row * variable.type.cols + col)) * 4, 4);
 	}
 	else if (array_length > 1)
@@ -4760,14 +7822,16 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 		for (size_t a = base_index, i = 0; a < array_length; ++a)
 			// Each element in the array is 16-byte aligned, so needs special handling
 			for (size_t row = 0; i < (size / 4) && row < variable.type.rows; ++row, ++i)
-				std::memcpy(
-					data_storage.data() + variable.offset + (a * 4 + row) * 4,
+				write_data(
+					variable.offset + (a * 4 + row) * 4,
 					data + ((a - base_index) * variable.type.components() + row) * 4, 4);
 	}
 	else
 	{
-		std::memcpy(data_storage.data() + variable.offset, data, size);
+		write_data(variable.offset, data, size);
 	}
+
+	return changed;
 }
 
 template <> void reshade::runtime::set_uniform_value<bool>(uniform &variable, const bool *values, size_t count, size_t array_index)
@@ -4835,6 +7899,71 @@ template <> void reshade::runtime::set_uniform_value<uint32_t>(uniform &variable
 	}
 }
 
+void reshade::runtime::set_uniform_values(uint32_t count, const api::effect_uniform_value_update *updates)
+{
+	std::chrono::high_resolution_clock::time_point change_time;
+	bool has_change_time = false;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const api::effect_uniform_value_update &update = updates[i];
+
+		const auto variable = reinterpret_cast<uniform *>(update.variable.handle);
+		if (variable == nullptr || update.values == nullptr || update.count == 0)
+			continue;
+
+		// Convert the values to the type the variable is stored as, or write them as is if that already matches
+		const bool as_floating_point = variable->type.is_floating_point() || force_floating_point_value(variable->type, _renderer_id);
+		const uint32_t *const values = static_cast<const uint32_t *>(update.values);
+		const uint8_t *data = reinterpret_cast<const uint8_t *>(values);
+		temp_mem<uint32_t, 16> converted_data(update.count);
+
+		switch (update.type)
+		{
+		case api::format::r32_float:
+			if (!as_floating_point)
+			{
+				for (uint32_t k = 0; k < update.count; ++k)
+					converted_data[k] = static_cast<uint32_t>(static_cast<int32_t>(reinterpret_cast<const float *>(values)[k]));
+				data = reinterpret_cast<const uint8_t *>(converted_data.p);
+			}
+			break;
+		case api::format::r32_sint:
+		case api::format::r32_uint:
+			if (as_floating_point)
+			{
+				for (uint32_t k = 0; k < update.count; ++k)
+					reinterpret_cast<float *>(converted_data.p)[k] = update.type == api::format::r32_sint ? static_cast<float>(static_cast<int32_t>(values[k])) : static_cast<float>(values[k]);
+				data = reinterpret_cast<const uint8_t *>(converted_data.p);
+			}
+			break;
+		case api::format::r32_typeless:
+			for (uint32_t k = 0; k < update.count; ++k)
+			{
+				if (as_floating_point)
+					reinterpret_cast<float *>(converted_data.p)[k] = values[k] != 0 ? 1.0f : 0.0f;
+				else
+					converted_data[k] = values[k] != 0 ? 1 : 0;
+			}
+			data = reinterpret_cast<const uint8_t *>(converted_data.p);
+			break;
+		default:
+			continue;
+		}
+
+		if (store_uniform_value_data(*variable, data, update.count * sizeof(uint32_t), update.array_index))
+		{
+			if (!has_change_time)
+			{
+				change_time = std::chrono::high_resolution_clock::now();
+				has_change_time = true;
+			}
+
+			_effects[variable->effect_index].last_uniform_change_time = change_time;
+		}
+	}
+}
+
 static std::string expand_macro_string(const std::string &input, std::vector<std::pair<std::string, std::string>> macros)
 {
 	const auto now = std::chrono::system_clock::now();
@@ -4940,10 +8069,20 @@ static std::string expand_macro_string(const std::string &input, std::vector<std
 	return result;
 }
 
-void reshade::runtime::save_screenshot(const std::string_view postfix)
+void reshade::runtime::save_screenshot(const std::string_view postfix, api::resource source)
 {
+	// Drop burst frames while the encoder queue is full, rather than stalling the application until it drains
+	if (_screenshot_burst_active && _pending_screenshots.size() + _screenshot_encodes_in_flight >= std::max(_screenshot_burst_queue_size, 1u))
+	{
+		_screenshot_burst_dropped++;
+		return;
+	}
+
+	// Frames of a burst or the offline capture are saved quietly
+	const bool is_sequence = _screenshot_burst_active || _nfs_capture_active;
+
 	const unsigned int screenshot_count = _screenshot_count;
-	unsigned int screenshot_format = _screenshot_format;
+	unsigned int screenshot_format = is_sequence ? 1 : _screenshot_format; // Sequence frames always use PNG, since it is the fastest lossless format to encode
 
 	// Use PNG for HDR (no tonemapping is implemented, so this is the only way to capture a screenshot in HDR)
 	if (((_back_buffer_format == api::format::r10g10b10a2_unorm ||
@@ -4968,68 +8107,153 @@ void reshade::runtime::save_screenshot(const std::string_view postfix)
 
 	const std::filesystem::path screenshot_path = g_reshade_base_path / _screenshot_path / std::filesystem::u8path(screenshot_name).lexically_normal();
 
-	log::message(log::level::info, "Saving screenshot to '%s'.", screenshot_path.u8string().c_str());
+	if (!is_sequence)
+		log::message(log::level::info, "Saving screenshot to '%s'.", screenshot_path.u8string().c_str());
 
 	_last_screenshot_save_successful = true;
 
-	if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * (_back_buffer_format == api::format::r16g16b16a16_float ? 8 : 4));
-		capture_screenshot(pixels.data()))
+	api::resource_usage source_state = api::resource_usage::render_target;
+	if (source == 0 && _back_buffer_resolved != 0)
+		source = _back_buffer_resolved;
+	else if (source == 0)
+	{
+		source = _swapchain->get_current_back_buffer();
+		source_state = api::resource_usage::present;
+	}
+
+	api::resource intermediate;
+	if (!begin_texture_readback(source, source_state, intermediate))
+		return;
+
+	// Signal a fence after the copy and only read back the data once the GPU has reached it, instead of waiting for that here
+	if (_screenshot_fence == 0 && !_device->create_fence(0, api::fence_flags::none, &_screenshot_fence))
+		_screenshot_fence = {};
+
+	pending_screenshot &screenshot = _pending_screenshots.emplace_back();
+	screenshot.intermediate = intermediate;
+	if (_screenshot_fence != 0 && _graphics_queue->signal(_screenshot_fence, _screenshot_fence_value + 1))
+		screenshot.fence_value = ++_screenshot_fence_value;
+	else
+		_graphics_queue->flush_immediate_command_list();
+	screenshot.frame_count = _frame_count;
+	screenshot.width = _width;
+	screenshot.height = _height;
+	screenshot.format = _back_buffer_format;
+	screenshot.screenshot_count = screenshot_count;
+	screenshot.screenshot_format = screenshot_format;
+	screenshot.screenshot_path = screenshot_path;
+	screenshot.postfix = postfix;
+	screenshot.include_preset =
+		_screenshot_include_preset &&
+		postfix != "Before" && postfix != "Overlay" && postfix != "NoHUD" &&
+		ini_file::flush_cache(_current_preset_path);
+	screenshot.burst = is_sequence;
+
+	if (is_sequence)
+	{
+		if (_screenshot_burst_active)
+			_screenshot_burst_captured++;
+		return;
+	}
+
+	// Play screenshot sound
+	if (!_screenshot_sound_path.empty())
+		utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+}
+void reshade::runtime::update_screenshots(bool force)
+{
+	// Number of frames to wait before reading back screenshots when fences are not available, after which the copy should have finished
+	constexpr uint64_t max_frames_in_flight = 3;
+
+	for (auto it = _pending_screenshots.begin(); it != _pending_screenshots.end();)
 	{
-		const bool include_preset =
-			_screenshot_include_preset &&
-			postfix != "Before" && postfix != "Overlay" &&
-			ini_file::flush_cache(_current_preset_path);
+		if (!force && (it->fence_value != 0 ? _device->get_completed_fence_value(_screenshot_fence) < it->fence_value : _frame_count < it->frame_count + max_frames_in_flight))
+		{
+			++it;
+			continue;
+		}
+
+		pending_screenshot screenshot = std::move(*it);
+		it = _pending_screenshots.erase(it);
+
+		// Mapping does not wait for the GPU in all APIs, so make sure the copy has actually finished
+		if (screenshot.fence_value == 0 || !_device->wait(_screenshot_fence, screenshot.fence_value))
+			_graphics_queue->wait_idle();
+
+		// Reuse pixel buffers of previous screenshots, to avoid churning the address space with large allocations (which is especially scarce in 32-bit)
+		const size_t pixels_size = static_cast<size_t>(screenshot.width) * static_cast<size_t>(screenshot.height) * (screenshot.format == api::format::r16g16b16a16_float ? 8 : 4);
+
+		std::vector<uint8_t> pixels;
+		{
+			const std::unique_lock<std::mutex> lock(_screenshot_buffer_mutex);
+			while (!_screenshot_buffers.empty())
+			{
+				pixels = std::move(_screenshot_buffers.back());
+				_screenshot_buffers.pop_back();
+
+				// Buffers from before the back buffer was resized are released rather than grown, so that the pool does not hold on to differently sized allocations
+				if (pixels.size() == pixels_size)
+					break;
+				pixels.clear();
+				pixels.shrink_to_fit();
+			}
+		}
 
-		// Play screenshot sound
-		if (!_screenshot_sound_path.empty())
-			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+		pixels.resize(pixels_size);
+		if (!finish_texture_readback(screenshot.intermediate, pixels.data()))
+		{
+			const std::unique_lock<std::mutex> lock(_screenshot_buffer_mutex);
+			_screenshot_buffers.push_back(std::move(pixels));
+			continue;
+		}
 
-		_worker_threads.emplace_back([this, screenshot_count, screenshot_format, screenshot_path, postfix, pixels = std::move(pixels), include_preset]() mutable {
+		// Encode and write the image file on the worker pool
+		_screenshot_encodes_in_flight++;
+		_worker_pool->submit(thread_pool::priority::low, [this, screenshot = std::move(screenshot), pixels = std::move(pixels)]() mutable {
 			// Remove alpha channel
 			int comp = 4;
-			if (_screenshot_clear_alpha && screenshot_format != 3)
+			if (_screenshot_clear_alpha && screenshot.screenshot_format != 3)
 			{
 				comp = 3;
-				for (size_t i = 0; i < static_cast<size_t>(_width) * static_cast<size_t>(_height); ++i)
-					*reinterpret_cast<uint32_t *>(pixels.data() + 3 * i) = *reinterpret_cast<const uint32_t *>(pixels.data() + 4 * i);
+				utils::strip_alpha_rgba8(pixels.data(), static_cast<size_t>(screenshot.width) * static_cast<size_t>(screenshot.height));
 			}
 
 			// Create screenshot directory if it does not exist
 			std::error_code ec;
 			_screenshot_directory_creation_successful = true;
-			if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
-				if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
-					log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot_path.parent_path().u8string().c_str(), ec.value());
+			if (!std::filesystem::exists(screenshot.screenshot_path.parent_path(), ec))
+				if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot.screenshot_path.parent_path(), ec)))
+					log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot.screenshot_path.parent_path().u8string().c_str(), ec.value());
 
 			// Default to a save failure unless it is reported to succeed below
 			bool save_success = false;
 
-			if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
+			if (FILE *const file = _wfsopen(screenshot.screenshot_path.c_str(), L"wb", SH_DENYNO))
 			{
 				const auto write_callback = [](void *context, void *data, int size) {
 					fwrite(data, 1, size, static_cast<FILE *>(context));
 				};
 
-				switch (screenshot_format)
+				switch (screenshot.screenshot_format)
 				{
 				case 0:
-					save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, comp, pixels.data()) != 0;
+					save_success = stbi_write_bmp_to_func(write_callback, file, screenshot.width, screenshot.height, comp, pixels.data()) != 0;
 					break;
 				case 1:
 #if 1
 					if (std::vector<uint8_t> encoded_data;
-						fpng::fpng_encode_image_to_memory(pixels.data(), _width, _height, comp, encoded_data))
+						utils::encode_png(*_worker_pool, pixels.data(), screenshot.width, screenshot.height, comp, encoded_data))
 						save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
 #else
-					save_success = stbi_write_png_to_func(write_callback, file, _width, _height, comp, pixels.data(), 0) != 0;
+					save_success = stbi_write_png_to_func(write_callback, file, screenshot.width, screenshot.height, comp, pixels.data(), 0) != 0;
 #endif
 					break;
 				case 2:
-					save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
+					save_success = stbi_write_jpg_to_func(write_callback, file, screenshot.width, screenshot.height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
 					break;
 				// Implicit HDR PNG when running in HDR
 				case 3:
-					save_success = sk_hdr_png::write_image_to_disk(screenshot_path.c_str(), _width, _height, pixels.data(), _screenshot_hdr_bits, _back_buffer_format);
+					save_success = sk_hdr_png::write_image_to_disk(screenshot.screenshot_path.c_str(), screenshot.width, screenshot.height, pixels.data(), _screenshot_hdr_bits, screenshot.format);
 					break;
 				}
 
@@ -5041,11 +8265,12 @@ void reshade::runtime::save_screenshot(const std::string_view postfix)
 
 			if (save_success)
 			{
-				execute_screenshot_post_save_command(screenshot_path, screenshot_count, postfix);
+				if (!screenshot.burst)
+					execute_screenshot_post_save_command(screenshot.screenshot_path, screenshot.screenshot_count, screenshot.postfix);
 
-				if (include_preset)
+				if (screenshot.include_preset)
 				{
-					std::filesystem::path screenshot_preset_path = screenshot_path;
+					std::filesystem::path screenshot_preset_path = screenshot.screenshot_path;
 					screenshot_preset_path.replace_extension(L".ini");
 
 					// Preset was flushed to disk, so can just copy it over to the new location
@@ -5054,20 +8279,35 @@ void reshade::runtime::save_screenshot(const std::string_view postfix)
 				}
 
 #if RESHADE_ADDON
-				invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
+				invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot.screenshot_path.u8string().c_str());
 #endif
 			}
 			else
 			{
-				log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot_path.u8string().c_str());
+				log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot.screenshot_path.u8string().c_str());
 			}
 
 			if (_last_screenshot_save_successful)
 			{
 				_last_screenshot_time = std::chrono::high_resolution_clock::now();
-				_last_screenshot_file = screenshot_path;
+				_last_screenshot_file = screenshot.screenshot_path;
 				_last_screenshot_save_successful = save_success;
 			}
+
+			// Return pixel buffer to the pool, which is bounded by the burst queue size, since there cannot be more screenshots in flight than that
+			{
+#ifndef _WIN64
+				// Limit number of pooled buffers in 32-bit, since a single one already takes up to 66 MB at 4K
+				const size_t max_pooled_buffers = 2;
+#else
+				const size_t max_pooled_buffers = _screenshot_burst_queue_size;
+#endif
+				const std::unique_lock<std::mutex> lock(_screenshot_buffer_mutex);
+				if (_screenshot_buffers.size() < max_pooled_buffers)
+					_screenshot_buffers.push_back(std::move(pixels));
+			}
+
+			_screenshot_encodes_in_flight--;
 		});
 	}
 }
@@ -5118,6 +8358,19 @@ bool reshade::runtime::execute_screenshot_post_save_command(const std::filesyste
 }
 
 bool reshade::runtime::get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels)
+{
+	api::resource intermediate;
+	if (!begin_texture_readback(resource, state, intermediate))
+		return false;
+
+	api::fence copy_sync_fence = {};
+	if (!_device->create_fence(0, api::fence_flags::none, &copy_sync_fence) || !_graphics_queue->signal(copy_sync_fence, 1) || !_device->wait(copy_sync_fence, 1))
+		_graphics_queue->wait_idle();
+	_device->destroy_fence(copy_sync_fence);
+
+	return finish_texture_readback(intermediate, pixels);
+}
+bool reshade::runtime::begin_texture_readback(api::resource resource, api::resource_usage state, api::resource &intermediate)
 {
 	const api::resource_desc desc = _device->get_resource_desc(resource);
 
@@ -5136,88 +8389,77 @@ bool reshade::runtime::get_texture_data(api::resource resource, api::resource_us
 		return false;
 	}
 
-	// Copy back buffer data into system memory buffer
-	api::resource intermediate;
-	if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+	// Reuse a system memory texture from a previous readback if there is one with matching dimensions and format
+	if (const auto it = std::find_if(_readback_resources.begin(), _readback_resources.end(),
+			[this, &desc, view_format](api::resource readback_resource) {
+				const api::resource_desc readback_desc = _device->get_resource_desc(readback_resource);
+				return readback_desc.texture.width == desc.texture.width && readback_desc.texture.height == desc.texture.height && readback_desc.texture.format == view_format;
+			});
+		it != _readback_resources.end())
 	{
-		log::message(log::level::error, "Failed to create system memory texture for screenshot capture!");
-		return false;
+		intermediate = *it;
+		_readback_resources.erase(it);
 	}
+	else
+	{
+		if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+		{
+			log::message(log::level::error, "Failed to create system memory texture for screenshot capture!");
+			return false;
+		}
 
-	_device->set_resource_name(intermediate, "ReShade screenshot texture");
+		_device->set_resource_name(intermediate, "ReShade screenshot texture");
+	}
 
+	// Copy back buffer data into system memory buffer
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 	cmd_list->barrier(resource, state, api::resource_usage::copy_source);
 	cmd_list->copy_texture_region(resource, 0, nullptr, intermediate, 0, nullptr);
 	cmd_list->barrier(resource, api::resource_usage::copy_source, state);
 
-	api::fence copy_sync_fence = {};
-	if (!_device->create_fence(0, api::fence_flags::none, &copy_sync_fence) || !_graphics_queue->signal(copy_sync_fence, 1) || !_device->wait(copy_sync_fence, 1))
-		_graphics_queue->wait_idle();
-	_device->destroy_fence(copy_sync_fence);
+	return true;
+}
+bool reshade::runtime::finish_texture_readback(api::resource intermediate, uint8_t *pixels)
+{
+	const api::resource_desc desc = _device->get_resource_desc(intermediate);
+	const api::format view_format = desc.texture.format;
 
 	// Copy data from intermediate image into output buffer
 	api::subresource_data mapped_data = {};
 	if (_device->map_texture_region(intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
 	{
 		auto mapped_pixels = static_cast<const uint8_t *>(mapped_data.data);
-		const uint32_t pixels_row_pitch = api::format_row_pitch(view_format, desc.texture.width);
+		// Output is always RGBA with 8-bit components, except for FP16 data, which is kept as is
+		const uint32_t pixels_row_pitch = desc.texture.width * (view_format == api::format::r16g16b16a16_float ? 8 : 4);
 
 		for (size_t y = 0; y < desc.texture.height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_data.row_pitch)
 		{
 			switch (view_format)
 			{
 			case api::format::r8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x];
-					pixels[x * 4 + 1] = 0;
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
+				utils::expand_r8_to_rgba8(mapped_pixels, pixels, desc.texture.width);
 				break;
 			case api::format::r8g8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
-					pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
+				utils::expand_rg8_to_rgba8(mapped_pixels, pixels, desc.texture.width);
 				break;
 			case api::format::r8g8b8a8_unorm:
 			case api::format::r8g8b8x8_unorm:
 				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
 				if (view_format == api::format::r8g8b8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
+					utils::force_opaque_rgba8(pixels, desc.texture.width);
 				break;
 			case api::format::b8g8r8a8_unorm:
 			case api::format::b8g8r8x8_unorm:
 				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
 				// Format is BGRA, but output should be RGBA, so flip channels
-				for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					std::swap(pixels[x + 0], pixels[x + 2]);
-				if (view_format == api::format::b8g8r8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
+				utils::swap_red_blue_rgba8(pixels, desc.texture.width, view_format == api::format::b8g8r8x8_unorm);
 				break;
 			case api::format::r10g10b10a2_unorm:
 			case api::format::b10g10r10a2_unorm:
 				// SDR: Quantize the image down to 8-bpc for compatibility with standard screenshot formats
 				if (_back_buffer_color_space != api::color_space::hdr10_st2084)
 				{
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					{
-						const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-						// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-						pixels[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
-						pixels[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-						pixels[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-						pixels[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-						if (view_format == api::format::b10g10r10a2_unorm)
-							std::swap(pixels[x + 0], pixels[x + 2]);
-					}
+					utils::convert_rgb10a2_to_rgba8(mapped_pixels, pixels, desc.texture.width, view_format == api::format::b10g10r10a2_unorm);
 				}
 				// HDR10: Keep the original data, do not convert to 8-bpc
 				else
@@ -5236,7 +8478,11 @@ bool reshade::runtime::get_texture_data(api::resource resource, api::resource_us
 		_device->unmap_texture_region(intermediate, 0);
 	}
 
-	_device->destroy_resource(intermediate);
+	// Keep a few system memory textures around, so that taking multiple screenshots in a row does not have to create new ones every time
+	if (_readback_resources.size() < 3)
+		_readback_resources.push_back(intermediate);
+	else
+		_device->destroy_resource(intermediate);
 
 	return mapped_data.data != nullptr;
 }
@@ -8,11 +8,20 @@
 #include "reshade_api.hpp"
 #include "state_block.hpp"
 #include "imgui_code_editor.hpp"
+#include "search_index.hpp"
+#include "telemetry.hpp"
+#include "runtime_manager.hpp"
+#include "lockfree_queue.hpp"
+#include "lockfree_snapshot.hpp"
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <filesystem>
 #include <atomic>
+#include <mutex>
 #include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
 
 #ifdef GAME_MW
 #include "NFSMW_PreFEngHook.h"
@@ -48,7 +57,22 @@ namespace reshade
 	struct effect;
 	struct uniform;
 	struct texture;
+	struct texture_upload;
+	struct texture_semantic_binding;
 	struct technique;
+	class thread_pool;
+	class effect_cache;
+	class file_watcher;
+	struct shared_effect_module_cache;
+	class resource_view_cache;
+
+	/// <summary>
+	/// Names of the render stages as used in the "render_stage" technique annotation and in presets.
+	/// </summary>
+	inline const char *const nfs_render_stage_names[] = {
+		"present",
+		"motion_blur",
+	};
 
 	/// <summary>
 	/// The main ReShade post-processing effect runtime.
@@ -62,7 +86,27 @@ namespace reshade
 		bool on_init();
 		void on_reset();
 		void on_nfs_present();
+		/// <summary>
+		/// Renders effects in the middle of a frame (at the FEManager_Render hook, before the game draws its frontend), so that the following <see cref="on_present"/> only has to draw the overlay.
+		/// </summary>
+		/// <param name="rtv">Render target view of the surface the game renders the frame to.</param>
+		/// <param name="rtv_srgb">Render target view of the same surface with sRGB conversion enabled.</param>
+		void on_mid_frame_render(api::resource_view rtv, api::resource_view rtv_srgb);
+		/// <summary>
+		/// Renders only the techniques that are assigned to the specified render stage, which are in turn skipped at present.
+		/// </summary>
+		/// <param name="stage">Render stage the game is currently at.</param>
+		/// <param name="rtv">Render target view of the surface the game is currently rendering to.</param>
+		/// <param name="rtv_srgb">Render target view of the same surface with sRGB conversion enabled.</param>
+		void on_nfs_render_stage(nfs_render_stage stage, api::resource_view rtv, api::resource_view rtv_srgb);
 		void on_present(api::command_queue *present_queue);
+		/// <summary>
+		/// Records the statistics of a frame latency limiter in the API layer after the last present.
+		/// </summary>
+		/// <param name="queued_frames">Number of presented frames the GPU had not finished yet.</param>
+		/// <param name="max_queued_frames">Number of frames the limiter allows to be queued.</param>
+		/// <param name="wait_time">Time the limiter waited for before the next frame, in nanoseconds.</param>
+		void on_frame_latency(uint32_t queued_frames, uint32_t max_queued_frames, uint64_t wait_time) { _queued_frames = queued_frames; _max_queued_frames = max_queued_frames; _frame_latency_wait_time = wait_time; }
 
 		uint64_t get_native() const final { return _swapchain->get_native(); }
 
@@ -95,7 +139,9 @@ namespace reshade
 		/// <summary>
 		/// Captures a screenshot of the current back buffer resource and writes it to an image file on disk.
 		/// </summary>
-		void save_screenshot(const std::string_view postfix = std::string_view());
+		/// <param name="postfix">Text appended to the file name to tell multiple images of the same screenshot apart.</param>
+		/// <param name="source">Resource to capture instead of the back buffer, which has to be in the <see cref="api::resource_usage::render_target"/> state.</param>
+		void save_screenshot(const std::string_view postfix = std::string_view(), api::resource source = {});
 		bool capture_screenshot(void *pixels) final { return get_texture_data(_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(), _back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present, static_cast<uint8_t *>(pixels)); }
 
 		void get_screenshot_width_and_height(uint32_t *out_width, uint32_t *out_height) const final { *out_width = _width; *out_height = _height; }
@@ -140,6 +186,7 @@ namespace reshade
 		void set_uniform_value_float(api::effect_uniform_variable variable, const float *values, size_t count, size_t array_index) final;
 		void set_uniform_value_int(api::effect_uniform_variable variable, const int32_t *values, size_t count, size_t array_index) final;
 		void set_uniform_value_uint(api::effect_uniform_variable variable, const uint32_t *values, size_t count, size_t array_index) final;
+		void set_uniform_values(uint32_t count, const api::effect_uniform_value_update *updates) final;
 
 		void enumerate_texture_variables(const char *effect_name, void(*callback)(effect_runtime *runtime, api::effect_texture_variable variable, void *user_data), void *user_data) final;
 
@@ -198,6 +245,23 @@ namespace reshade
 
 		void reload_effect_next_frame(const char *effect_name) final;
 
+		bool get_present_stage_statistics(api::present_stage stage, api::present_stage_statistics *out_stats) const final;
+
+		uint64_t get_effect_generation() const final { return _effects_generation; }
+
+		uint32_t get_nfs_vehicles(uint32_t max_count, api::nfs_vehicle *out_vehicles) const final;
+
+		/// <summary>
+		/// Copies the game state read by the overlay, special uniforms and telemetry into a snapshot, so that these do not have to read game memory themselves.
+		/// In multithreaded games this is called once per simulation tick on the game thread, otherwise before each frame on the render thread.
+		/// </summary>
+		static void publish_nfs_game_state();
+		/// <summary>
+		/// Records a call to one of the world streaming functions of the game, which is picked up by the next present.
+		/// This may be called from any thread.
+		/// </summary>
+		static void record_nfs_stream_event(const telemetry_block::stream_event &event);
+
 #ifdef GAME_UC
 		bool bMotionBlur;
 #endif
@@ -211,15 +275,99 @@ namespace reshade
 		void load_current_preset();
 		void save_current_preset(ini_file &preset) const;
 
+		void update_gameflow_state_mask(technique &tech);
+		void update_gameflow_exclusion();
+		void update_render_stage(technique &tech);
+		void update_nfs_game_state();
+		void limit_frame_rate();
+		void start_nfs_offline_capture();
+		void stop_nfs_offline_capture();
+		void update_nfs_offline_capture();
+#ifdef RESHADE_TEST_APPLICATION
+		void begin_regression_frame(api::command_list *cmd_list, api::resource back_buffer_resource);
+		void end_regression_frame();
+		bool load_regression_frame();
+		void finish_regression_run();
+		bool save_regression_report() const;
+		void destroy_regression_resources();
+#endif
+
 		bool switch_to_next_preset(std::filesystem::path filter_path, bool reversed = false);
 
 		bool load_effect(const std::filesystem::path &source_file, const ini_file &preset, size_t effect_index, size_t permutation_index, bool force_load = false, bool preprocess_required = false);
 		bool create_effect(size_t effect_index, size_t permutation_index);
+		bool create_effect_pipeline(size_t effect_index, size_t permutation_index, technique &tech, size_t pass_index, const std::vector<uint32_t> &spec_constants, const std::vector<uint32_t> &spec_data, api::pipeline &pipeline);
+		/// <summary>
+		/// Applies the current values of the baked variables of an effect by re-creating its pipelines with new specialization constant values, without having to compile it again.
+		/// This is only possible in Vulkan, where baked values are specialization constants (other APIs bake them into the code via the code preamble).
+		/// </summary>
+		bool update_effect_specialization_constants(size_t effect_index);
 		bool create_effect_sampler_state(const reshadefx::sampler_desc &desc, api::sampler &sampler);
+		/// <summary>
+		/// Gets a pipeline layout with the specified descriptor ranges, which is shared with all other effects that need the same (or in D3D12 and Vulkan, a similar) layout.
+		/// </summary>
+		bool create_effect_pipeline_layout(const api::descriptor_range &cb_range, const api::descriptor_range &sampler_range, const api::descriptor_range &srv_range, const api::descriptor_range &uav_range, api::pipeline_layout &layout);
+		/// <summary>
+		/// Gets the ID of the specified texture semantic, adding a new one if it was not seen before.
+		/// </summary>
+		uint32_t intern_texture_semantic(const std::string_view semantic);
+		/// <summary>
+		/// Gets the ID of the specified texture semantic, or <c>UINT32_MAX</c> if it was not seen before.
+		/// </summary>
+		uint32_t find_texture_semantic(const std::string_view semantic) const;
 		void destroy_effect(size_t effect_index);
 
+		/// <summary>
+		/// Estimates the amount of system memory used by the generated code and data of the specified effect.
+		/// </summary>
+		uint64_t get_effect_cpu_memory_usage(size_t effect_index) const;
+		/// <summary>
+		/// Gets the human-readable assembly of the specified entry point, recreating it from the compiled shader if it was discarded after compilation (see <see cref="_discard_generated_code"/>).
+		/// </summary>
+		std::string get_assembly_text(size_t effect_index, size_t permutation_index, const std::string &entry_point_name) const;
+		/// <summary>
+		/// Estimates the amount of video memory used by the textures and constant buffer of the specified effect.
+		/// </summary>
+		/// <param name="include_pending">Set to <see langword="true"/> to also include resources that were not created yet, to estimate the usage after the effect was initialized.</param>
+		uint64_t get_effect_gpu_memory_usage(size_t effect_index, bool include_pending = false) const;
+		/// <summary>
+		/// Estimates the total amount of memory used by all effects and effect permutations, which is compared against the memory budget.
+		/// </summary>
+		uint64_t get_total_memory_usage() const;
+		/// <summary>
+		/// Destroys the code and pipelines of effect permutations that were not rendered to in a while, so that they are recompiled on next use.
+		/// </summary>
+		/// <returns><see langword="true"/> if any permutation was evicted, <see langword="false"/> otherwise.</returns>
+		bool evict_cold_effect_permutations();
+
+		/// <summary>
+		/// Finds the texture with the specified unique name through the hash index, which is kept in sync with <see cref="_textures"/>.
+		/// </summary>
+		/// <returns>Pointer to the texture, or <see langword="nullptr"/> if no effect declared one with that name.</returns>
+		texture *find_texture(const std::string &unique_name);
+		const texture *find_texture(const std::string &unique_name) const { return const_cast<runtime *>(this)->find_texture(unique_name); }
+		void rebuild_texture_name_index();
+
 		void load_textures(size_t effect_index);
+		/// <summary>
+		/// Starts loading the image file a texture was declared with in the background.
+		/// </summary>
+		/// <returns><see langword="true"/> if an upload was queued, <see langword="false"/> if the texture has no image file or it could not be found.</returns>
+		bool load_texture(texture &tex);
+		void update_texture_uploads();
+		/// <summary>
+		/// Fills a texture upload with the block compressed mipmap chain of its source image, either from the effect cache or by decoding and compressing the image and then storing the result in the cache.
+		/// </summary>
+		bool load_compressed_texture_upload(texture_upload &upload) const;
 		bool create_texture(texture &texture);
+		/// <summary>
+		/// Gets the lower precision format an intermediate texture should be created with according to the texture precision policy, or <see cref="api::format::unknown"/> to keep the declared format.
+		/// </summary>
+		api::format get_reduced_texture_format(const texture &texture) const;
+		/// <summary>
+		/// Assigns a texture whose contents are only used by the specified technique a resource that is shared with textures of other techniques, creating a new one if no compatible resource is available.
+		/// </summary>
+		bool create_transient_texture(texture &texture, const std::string &technique_name);
 		void destroy_texture(texture &texture);
 
 		void enable_technique(technique &technique);
@@ -229,17 +377,33 @@ namespace reshade
 
 		void load_effects(bool force_load_all = false);
 		bool reload_effect(size_t effect_index);
+		bool reload_dependent_effects(const std::filesystem::path &modified_file);
+		/// <summary>
+		/// Loads the image again for all textures whose source is the specified file.
+		/// </summary>
+		/// <returns><see langword="true"/> if any texture uses the file, <see langword="false"/> otherwise.</returns>
+		bool reload_dependent_textures(const std::filesystem::path &modified_file);
+		/// <summary>
+		/// Reloads the effects and textures that depend on files in the search paths that were modified since the last call.
+		/// </summary>
+		void update_file_watcher();
 		void reload_effects(bool force_load_all = false);
-		void destroy_effects();
+		void destroy_effects(bool keep_compiled_effects = false);
 
 		bool load_effect_cache(const std::string &id, const std::string &type, std::string &data) const;
 		bool save_effect_cache(const std::string &id, const std::string &type, const std::string &data) const;
 		void clear_effect_cache();
 
 		auto add_effect_permutation(uint32_t width, uint32_t height, api::format color_format, api::format stencil_format, api::color_space color_space) -> size_t;
+		void load_effect_permutations(api::format stencil_format);
+		void save_effect_permutations() const;
 
 		void update_effects();
-		void render_technique(technique &technique, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index);
+		/// <summary>
+		/// Recompiles an effect with its uniform values baked in once none of them changed for a while, or back to the generic version when a baked value changes.
+		/// </summary>
+		void update_adaptive_performance_mode();
+		void render_technique(technique &technique, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index, bool full_update);
 
 		void save_texture(const texture &texture);
 		void update_texture(texture &texture, uint32_t width, uint32_t height, uint32_t depth, const void *pixels);
@@ -252,6 +416,7 @@ namespace reshade
 		get_uniform_value(const uniform &variable, T *values, size_t count = 1, size_t array_index = 0) const;
 
 		void set_uniform_value_data(uniform &variable, const uint8_t *data, size_t size, size_t base_index);
+		bool store_uniform_value_data(uniform &variable, const uint8_t *data, size_t size, size_t base_index);
 		template <typename T>
 		std::enable_if_t<std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float>>
 		set_uniform_value(uniform &variable, const T *values, size_t count = 1, size_t array_index = 0);
@@ -266,6 +431,10 @@ namespace reshade
 		bool get_preprocessor_definition(const std::string &effect_name, const std::string &name, int scope_mask, std::vector<std::pair<std::string, std::string>> *&scope, std::vector<std::pair<std::string, std::string>>::iterator &value) const;
 
 		bool get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels);
+		bool begin_texture_readback(api::resource resource, api::resource_usage state, api::resource &intermediate);
+		bool finish_texture_readback(api::resource intermediate, uint8_t *pixels);
+
+		void update_screenshots(bool force = false);
 
 		bool execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix);
 
@@ -303,19 +472,174 @@ namespace reshade
 		bool _effects_rendered_this_frame = false;
 		unsigned int _effects_key_data[4] = {};
 
+		std::string _gameflow_rule;
+		bool _has_gameflow_rules = false;
+
+		bool _has_nfs_render_stages = false;
+		nfs_render_stage _current_render_stage = nfs_render_stage::present;
+
+		// Game state that is copied from the published snapshot once per frame and shared by the overlay, telemetry and all effects through the "nfs_*" special uniforms
+		static constexpr uint32_t NFS_MAX_VEHICLES = 32;
+
+		struct nfs_game_state
+		{
+			int gameflow_state;
+			float game_speed;
+			float precipitation; // Percent
+			float fog[2]; // Base weather fog and fog start
+			float fog_color[3]; // Normalized to the 0-1 range
+			int visual_treatment;
+			uint32_t vehicle_count; // Number of active vehicles, of which at most 'NFS_MAX_VEHICLES' are in the array below
+			api::nfs_vehicle vehicles[NFS_MAX_VEHICLES];
+			uint32_t thread_processor; // Ideal processor of the thread that published this state
+		} _nfs_game_state = {};
+		static lockfree_snapshot<nfs_game_state> s_nfs_game_snapshot;
+		int _last_gameflow_state = -1;
+
 		unsigned int _toggle_fe_key_data[4] = {};
 
 		std::chrono::high_resolution_clock::duration _last_frame_duration;
 		std::chrono::high_resolution_clock::time_point _start_time, _last_present_time;
 		uint64_t _frame_count = 0;
+		// Measured GPU queue depth, which is only available when a frame latency limiter is active (zero limit otherwise)
+		uint32_t _queued_frames = 0;
+		uint32_t _max_queued_frames = 0;
+		uint64_t _frame_latency_wait_time = 0;
+		#pragma endregion
+
+		#pragma region Present Timing
+		static constexpr size_t PRESENT_STAGE_HISTORY_SIZE = 256;
+
+		uint64_t _present_stage_durations[static_cast<size_t>(api::present_stage::count)][PRESENT_STAGE_HISTORY_SIZE] = {};
+		size_t _present_stage_history_index = 0;
+		size_t _present_stage_history_count = 0;
+		// Time spent in 'on_mid_frame_render', which is added to the stages of the following present
+		uint64_t _mid_frame_stage_durations[static_cast<size_t>(api::present_stage::count)] = {};
+		bool _effects_rendered_mid_frame = false;
+
+		// Statistics published in shared memory for external tools, see 'telemetry_block'
+		telemetry_writer _telemetry;
+		void update_telemetry();
+		#pragma endregion
+
+		#pragma region NFS Streaming
+		static lockfree_mpsc_queue<telemetry_block::stream_event, 64> s_nfs_stream_events;
+		void update_nfs_stream_events();
+
+		telemetry_block::stream_event _nfs_stream_events[telemetry_block::MAX_STREAM_EVENTS] = {};
+		uint32_t _nfs_stream_event_count = 0;
+		// Time spent in streaming calls since the previous present, in milliseconds
+		float _nfs_stream_time = 0.0f;
+		#pragma endregion
+
+		#pragma region NFS Load Profiler
+		struct nfs_load_record
+		{
+			int state = -1;
+			const char *state_name = nullptr;
+			std::chrono::high_resolution_clock::time_point start_time;
+			float duration = 0.0f; // Milliseconds
+			uint32_t frame_count = 0;
+			// Time during the state in which ReShade was busy itself, in milliseconds
+			float effect_load_time = 0.0f;
+			float texture_load_time = 0.0f;
+			float stream_time = 0.0f;
+		};
+
+		void update_nfs_load_profile();
+
+		// Game flow state that is currently being timed, which is finished and added to the history once the game transitions to another state
+		nfs_load_record _nfs_load_current;
+		static constexpr size_t NFS_LOAD_HISTORY_SIZE = 64;
+		nfs_load_record _nfs_load_history[NFS_LOAD_HISTORY_SIZE];
+		size_t _nfs_load_history_index = 0;
+		size_t _nfs_load_history_count = 0;
+		#pragma endregion
+
+		#pragma region Frame Limiter
+		static constexpr size_t FRAME_LIMIT_HISTORY_SIZE = 256;
+
+		bool _frame_limit_enabled = false;
+		unsigned int _frame_limit_fps = 60;
+		// Time before the targeted frame boundary at which to stop sleeping and start spinning, in microseconds
+		unsigned int _frame_limit_spin_time = 1000;
+		bool _frame_limit_game_speed_compensation = false;
+		bool _frame_limit_compensating = false;
+		// Game speed the compensation factor is applied to, which replaces editing the game speed directly while compensation is active
+		float _frame_limit_base_game_speed = 1.0f;
+		float _frame_limit_game_speed_factor = 1.0f;
+		void *_frame_limit_timer = nullptr;
+		std::chrono::high_resolution_clock::time_point _frame_limit_next_time, _frame_limit_last_time;
+		// Deviation of each frame interval from the targeted one, in microseconds
+		float _frame_limit_jitter[FRAME_LIMIT_HISTORY_SIZE] = {};
+		size_t _frame_limit_jitter_index = 0;
+		size_t _frame_limit_jitter_count = 0;
+		#pragma endregion
+
+		#pragma region NFS Offline Capture
+		// Offline capture drives the game speed so that the simulation advances by exactly one output frame per presented frame, and saves every frame without dropping any, no matter how long it takes to render
+		unsigned int _nfs_capture_key_data[4] = {};
+		unsigned int _nfs_capture_fps = 60;
+		bool _nfs_capture_active = false;
+		// Game speed set by the user when the capture started, which is restored when it stops
+		float _nfs_capture_base_game_speed = 1.0f;
+		unsigned int _nfs_capture_frame_count = 0;
+		std::chrono::high_resolution_clock::time_point _nfs_capture_last_time;
 		#pragma endregion
 
+#ifdef RESHADE_TEST_APPLICATION
+		#pragma region Regression Harness
+		// The regression harness replaces the back buffer with captured input frames, renders the preset over each of them and compares the output against golden images
+		struct regression_frame_result
+		{
+			uint64_t checksum = 0;
+			// Peak signal-to-noise ratio against the golden image in decibel, which is infinite for identical images and negative if there was nothing to compare against
+			double psnr = -1.0;
+			bool passed = false;
+		};
+
+		unsigned int _regression_frame_count = 0;
+		unsigned int _regression_frame = 0;
+		unsigned int _regression_present = 0;
+		bool _regression_input_copied = false;
+		bool _regression_finished = false;
+		api::resource _regression_color_tex = {};
+		api::resource _regression_depth_tex = {};
+		api::resource_view _regression_depth_srv = {};
+		std::vector<regression_frame_result> _regression_results;
+		// Sums of the CPU and GPU durations of each technique in nanoseconds over all presents of the run
+		std::vector<std::pair<uint64_t, uint64_t>> _regression_technique_durations;
+		unsigned int _regression_duration_samples = 0;
+		#pragma endregion
+#endif
+
 		#pragma region Effect Loading
 		bool _no_debug_info = true;
 		bool _no_effect_cache = false;
+		// Generated code and assembly text are only needed for the code editor, so do not keep them in memory after compilation in 32-bit processes by default, where address space is scarce
+#ifndef _WIN64
+		bool _discard_generated_code = true;
+#else
+		bool _discard_generated_code = false;
+#endif
 		bool _no_reload_on_init = false;
+		bool _no_effect_reuse_on_reset = false;
+		// Transcode 8-bit textures loaded from an image file to block compressed formats, which take a quarter (or less) of the video memory
+		bool _compress_source_textures = false;
+		// Create floating-point intermediate textures with less precision than declared to save bandwidth (0 = off, 1 = 32-bit to 16-bit floats, 2 = additionally R11G11B10F for textures annotated with "alpha_unused")
+		unsigned int _texture_precision_policy = 0;
+		// File names of the effects the texture precision policy applies to, or empty to apply it to all effects
+		std::vector<std::string> _texture_precision_effects;
 		bool _performance_mode = false;
+		// Compile individual effects with their uniform values baked in once those did not change for the specified number of seconds
+		bool _adaptive_performance_mode = false;
+		unsigned int _adaptive_performance_mode_delay = 5;
+		// File names of the effects that are currently compiled with their uniform values baked in (protected by '_reload_mutex', since it is read from loading threads)
+		std::vector<std::string> _baked_effects;
 		bool _effect_load_skipping = false;
+		// Upper limit in MiB for the estimated memory used by effects, or zero for no limit
+		unsigned int _memory_budget = 0;
+		bool _memory_budget_exceeded = false;
 		unsigned int _reload_key_data[4] = {};
 		unsigned int _performance_mode_key_data[4] = {};
 
@@ -324,9 +648,19 @@ namespace reshade
 		std::vector<std::pair<size_t, size_t>> _reload_required_effects;
 
 		std::filesystem::path _effect_cache_path;
+		unsigned int _effect_cache_size = 128;
+		std::unique_ptr<effect_cache> _effect_cache;
+		std::shared_ptr<shared_effect_module_cache> _shared_effect_modules;
+		std::shared_ptr<resource_view_cache> _resource_views;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
 
+		// Watches the search paths while automatic reloads are enabled, and is recreated whenever they change
+		bool _auto_reload_on_file_change = false;
+		std::unique_ptr<file_watcher> _file_watcher;
+		std::vector<std::filesystem::path> _file_watcher_effect_search_paths;
+		std::vector<std::filesystem::path> _file_watcher_texture_search_paths;
+
 		std::atomic<bool> _last_reload_successful = true;
 		std::shared_mutex _reload_mutex;
 		std::vector<std::pair<size_t, size_t>> _reload_create_queue;
@@ -334,11 +668,37 @@ namespace reshade
 		void *_d3d_compiler_module = nullptr;
 
 		std::vector<effect> _effects;
+		// Effects kept in compiled form across a device reset, which are reused on the next load if their source hash still matches (see 'load_effect')
+		std::vector<effect> _effects_kept_across_reset;
 		std::vector<texture> _textures;
+		// Index from unique name to position in '_textures', which holds only one texture per name since effects share textures with the same name
+		std::unordered_map<std::string, size_t> _texture_name_index;
+		std::vector<std::shared_ptr<texture_upload>> _texture_uploads;
 		std::vector<technique> _techniques;
 		std::vector<size_t> _technique_sorting;
 
-		std::vector<std::thread> _worker_threads;
+		// Incremented whenever handles to effect variables and techniques may have become invalid
+		uint64_t _effects_generation = 1;
+
+		struct variable_key_hash
+		{
+			size_t operator()(const std::pair<std::string_view, std::string_view> &key) const
+			{
+				const std::hash<std::string_view> hasher;
+				return hasher(key.first) ^ (hasher(key.second) * 31);
+			}
+		};
+
+		// Lookup tables from (effect file name, variable name) to variable handle, rebuilt on first use after effects changed
+		// An empty effect name is used as key for lookups across all effects
+		mutable std::vector<std::string> _variable_index_effect_names;
+		mutable std::unordered_map<std::pair<std::string_view, std::string_view>, uintptr_t, variable_key_hash> _uniform_variable_index;
+		mutable std::unordered_map<std::pair<std::string_view, std::string_view>, uintptr_t, variable_key_hash> _texture_variable_index;
+		mutable uint64_t _variable_index_generation = 0;
+		void update_variable_index() const;
+
+		unsigned int _worker_thread_count = 0;
+		std::unique_ptr<thread_pool> _worker_pool;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
 		#pragma endregion
 
@@ -354,6 +714,9 @@ namespace reshade
 			api::format stencil_format = api::format::unknown;
 			api::resource stencil_tex = {};
 			api::resource_view stencil_dsv = {};
+			uint64_t last_used_frame = 0;
+			// Set when the back buffer may have changed since it was last copied into 'color_tex', so that consecutive techniques only copy it again if a pass in between wrote to it
+			bool color_tex_outdated = true;
 		};
 		std::vector<effect_permutation> _effect_permutations;
 
@@ -361,9 +724,22 @@ namespace reshade
 		api::resource_view _empty_srv = {};
 
 		std::unordered_map<size_t, api::sampler> _effect_sampler_states;
-		std::unordered_map<std::string, std::pair<api::resource_view, api::resource_view>> _texture_semantic_bindings;
+		// Pipeline layouts are shared between effects and only destroyed together with all effects, like sampler states
+		std::unordered_map<uint64_t, api::pipeline_layout> _effect_pipeline_layouts;
+		// Effect whose uniform data was last pushed as shader constants in D3D9, which is reset whenever something else may have changed those constants since
+		size_t _uniform_push_effect_index = std::numeric_limits<size_t>::max();
+		std::vector<transient_texture> _transient_textures;
+		// Shader resource views of textures whose base level was modified by a pass since their mipmaps were last generated (see 'render_technique')
+		std::vector<api::resource_view> _pending_mipmap_views;
+		// Scratch lists of 'render_technique', which are empty in between calls and only kept here so that recording techniques does not allocate memory every frame
+		std::vector<std::pair<api::resource, api::resource_usage>> _technique_resource_states;
+		std::vector<api::resource> _technique_barrier_resources;
+		std::vector<api::resource_usage> _technique_barrier_states_old, _technique_barrier_states_new;
+		std::vector<uint64_t> _technique_pass_timestamps;
+		// Texture semantics are interned to the index of their entry in this list, which stays the same for the lifetime of the runtime
+		std::vector<texture_semantic_binding> _texture_semantic_bindings;
 #if RESHADE_ADDON == 1
-		std::unordered_map<std::string, std::pair<api::resource_view, api::resource_view>> _backup_texture_semantic_bindings;
+		std::vector<std::pair<api::resource_view, api::resource_view>> _backup_texture_semantic_bindings;
 #endif
 		api::pipeline _copy_pipeline = {};
 		api::pipeline_layout _copy_pipeline_layout = {};
@@ -399,6 +775,25 @@ namespace reshade
 		std::filesystem::path _screenshot_post_save_command_working_directory;
 		bool _screenshot_post_save_command_hide_window = false;
 		bool _screenshot_nfs_hud = false;
+		// Saves an image without the HUD at the FEManager_Render hook and one with the HUD at present, both from the same frame
+		bool _screenshot_nfs_hud_variants = false;
+		bool _screenshot_nfs_hud_variant_saved = false;
+
+		// Burst mode captures every Nth frame for a fixed duration, dropping frames instead of stalling when the encoders cannot keep up
+		unsigned int _screenshot_burst_key_data[4] = {};
+		unsigned int _screenshot_burst_duration = 5000;
+		unsigned int _screenshot_burst_interval = 1;
+		unsigned int _screenshot_burst_queue_size = 8;
+		bool _screenshot_burst_active = false;
+		uint64_t _screenshot_burst_frame = 0;
+		unsigned int _screenshot_burst_captured = 0;
+		unsigned int _screenshot_burst_dropped = 0;
+		std::chrono::high_resolution_clock::time_point _screenshot_burst_end_time;
+		std::atomic<unsigned int> _screenshot_encodes_in_flight = 0;
+
+		// Pixel buffers sized to the back buffer that are recycled after encoding a screenshot finished
+		std::mutex _screenshot_buffer_mutex;
+		std::vector<std::vector<uint8_t>> _screenshot_buffers;
 
 		// bool _screenshot_save_ui = false;
 		bool _should_save_screenshot = false;
@@ -406,6 +801,28 @@ namespace reshade
 		bool _screenshot_directory_creation_successful = true;
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
+
+		// Screenshots that were copied to a system memory texture, but not yet read back, since the copy may still be in flight on the GPU
+		struct pending_screenshot
+		{
+			api::resource intermediate = {};
+			uint64_t fence_value = 0;
+			uint64_t frame_count = 0;
+			unsigned int width = 0;
+			unsigned int height = 0;
+			api::format format = api::format::unknown;
+			unsigned int screenshot_count = 0;
+			unsigned int screenshot_format = 0;
+			std::filesystem::path screenshot_path;
+			std::string postfix;
+			bool include_preset = false;
+			bool burst = false;
+		};
+		std::vector<pending_screenshot> _pending_screenshots;
+		api::fence _screenshot_fence = {};
+		uint64_t _screenshot_fence_value = 0;
+		// System memory textures that are no longer in use and can be reused for the next readback
+		std::vector<api::resource> _readback_resources;
 		#pragma endregion
 
 		#pragma region Preset Switching
@@ -418,6 +835,23 @@ namespace reshade
 		bool _is_in_preset_transition = false;
 		std::chrono::high_resolution_clock::time_point _last_preset_switching_time;
 
+		// Floating-point uniform values captured at the start of a transition, so that following frames only have to interpolate between them
+		struct preset_transition_value
+		{
+			uniform *variable;
+			uint32_t count;
+			float start[16];
+			float end[16];
+		};
+		std::vector<preset_transition_value> _preset_transition_values;
+		uint64_t _preset_transition_generation = 0;
+		void update_preset_transition();
+
+		// Valid preset files in the directory that was last cycled through, so that switching does not have to scan and parse all of them again
+		std::filesystem::path _preset_cycle_directory;
+		std::filesystem::file_time_type _preset_cycle_modified_at;
+		std::vector<std::filesystem::path> _preset_cycle_paths;
+
 		struct preset_shortcut
 		{
 			std::filesystem::path preset_path;
@@ -432,6 +866,8 @@ namespace reshade
 		void deinit_gui();
 		void deinit_gui_vr();
 		void build_font_atlas();
+		void request_font_glyphs(const std::string_view text);
+		void request_effect_font_glyphs();
 
 		void load_config_gui(const ini_file &config);
 		void save_config_gui(ini_file &config) const;
@@ -445,14 +881,80 @@ namespace reshade
 		void draw_gui_home();
 		void draw_gui_settings();
 		void draw_gui_statistics();
+		void draw_gui_statistics_history();
+		bool save_frame_history() const;
+		void draw_gui_statistics_load_times();
+		bool save_nfs_load_history() const;
 		void draw_gui_log();
 		void draw_gui_about();
 		void draw_gui_nfs();
+
+		/// <summary>
+		/// Starts a benchmark run with the configured SkipFE race setup, which has to be done from the front end.
+		/// </summary>
+		void start_nfs_benchmark();
+		/// <summary>
+		/// Stops the current benchmark run and restores the player control state.
+		/// </summary>
+		/// <param name="save_report">Set to <see langword="true"/> to write out the samples recorded so far.</param>
+		void stop_nfs_benchmark(bool save_report);
+		/// <summary>
+		/// Writes the recorded benchmark samples to a CSV file with one line per frame and a JSON file with a summary.
+		/// </summary>
+		bool save_nfs_benchmark_report() const;
+
+		/// <summary>
+		/// Starts measuring the cost of each world render toggle of the game by flipping it for a number of frames and comparing against the frames before.
+		/// </summary>
+		void start_nfs_render_sweep();
+		/// <summary>
+		/// Stops the render toggle sweep and restores the toggle that is currently being measured.
+		/// </summary>
+		/// <param name="save_report">Set to <see langword="true"/> to write out the results measured so far.</param>
+		void stop_nfs_render_sweep(bool save_report);
+		void update_nfs_render_sweep();
+		/// <summary>
+		/// Writes the render toggle sweep results to a CSV file, ranked by frame time cost.
+		/// </summary>
+		bool save_nfs_render_sweep_report() const;
+
+		/// <summary>
+		/// Lowers or raises the resolution scale of effects with techniques that opted into dynamic resolution, so that the GPU time of all enabled techniques stays within the configured budget.
+		/// </summary>
+		void update_nfs_dynamic_resolution();
+		void update_nfs_precipitation_budget();
+		void parse_nfs_world_detail_ladder();
+		void update_nfs_world_detail();
+		void reset_nfs_world_detail();
+		/// <summary>
+		/// Skips the visual treatment pass of the game while an enabled technique is flagged to replace it.
+		/// </summary>
+		void update_nfs_visual_treatment_bypass();
+		/// <summary>
+		/// Lowers the priority and concurrency of the worker pool while racing, so that background effect compilation does not take processor time from the game.
+		/// </summary>
+		void update_nfs_worker_throttle();
+
+		/// <summary>
+		/// Gets the sum of the average GPU durations of all enabled techniques in milliseconds.
+		/// </summary>
+		float get_enabled_techniques_gpu_time() const;
+
+		/// <summary>
+		/// Registers a game variable to sample in the memory watch panel.
+		/// </summary>
+		/// <param name="base">Address of the value, or of the first pointer if <paramref name="offsets"/> is not empty.</param>
+		/// <param name="offsets">Pointer chain, where each offset is added to the address the previous one points to.</param>
+		void add_nfs_watch(std::string name, int type, uintptr_t base, std::vector<int32_t> offsets, bool builtin = false);
+		void resolve_nfs_watches();
+		void update_nfs_watches();
 #if RESHADE_ADDON
 		void draw_gui_addons();
+		bool save_addon_callback_stats() const;
 #endif
 		void draw_variable_editor();
 		void draw_technique_editor();
+		void update_technique_search_index();
 
 		bool init_imgui_resources();
 		void render_imgui_draw_data(api::command_list *cmd_list, ImDrawData *draw_data, api::resource_view rtv);
@@ -483,6 +985,10 @@ namespace reshade
 
 		api::resource _font_atlas_tex = {};
 		api::resource_view _font_atlas_srv = {};
+		// Languages with large character sets only load the glyphs that are actually used, starting with the localized strings and extended on demand
+		bool _font_atlas_used_glyphs_only = false;
+		std::vector<uint32_t> _font_atlas_requested_glyphs;
+		std::vector<unsigned short> _font_atlas_glyph_ranges;
 
 		api::pipeline _imgui_pipeline = {};
 		api::pipeline_layout _imgui_pipeline_layout = {};
@@ -492,6 +998,24 @@ namespace reshade
 		api::resource _imgui_indices[4] = {};
 		int _imgui_num_vertices[4] = {};
 		api::resource _imgui_vertices[4] = {};
+		// Vertex and index buffers that were replaced by larger ones, but may still be in use by frames in flight
+		struct retired_imgui_buffer
+		{
+			api::resource buffer = {};
+			uint64_t fence_value = 0;
+			uint64_t frame_count = 0;
+		};
+		std::vector<retired_imgui_buffer> _imgui_retired_buffers;
+		api::fence _imgui_fence = {};
+		uint64_t _imgui_fence_value = 0;
+
+		// Frame rate shown in the OSD, which is only updated a few times per second
+		float _osd_framerate = 0.0f;
+		uint64_t _osd_frame_count = 0;
+		std::chrono::high_resolution_clock::time_point _osd_last_update_time;
+		// Contents of the OSD in the last frames, used to skip building new ImGui frames while nothing else is visible and it does not change
+		std::string _osd_cache_key;
+		bool _osd_cache_stable = false;
 
 		api::resource _vr_overlay_tex = {};
 		api::resource_view _vr_overlay_target = {};
@@ -507,6 +1031,9 @@ namespace reshade
 		bool _was_preprocessor_popup_edited = false;
 		size_t _focused_effect = std::numeric_limits<size_t>::max();
 		size_t _selected_technique = std::numeric_limits<size_t>::max();
+		std::vector<size_t> _visible_technique_indices;
+		utils::search_index _technique_search_index;
+		uint64_t _technique_search_index_generation = 0;
 		unsigned int _tutorial_index = 0;
 		unsigned int _effects_expanded_state = 2;
 		float _variable_editor_height = 200.0f;
@@ -535,16 +1062,204 @@ namespace reshade
 
 		#pragma region Overlay Statistics
 		bool _gather_gpu_statistics = false;
+		bool _gather_pass_gpu_statistics = false;
 		api::resource_view _preview_texture = {};
 		unsigned int _preview_size[3] = { 0, 0, 0xFFFFFFFF };
 		uint64_t _timestamp_frequency = 0;
+
+		struct frame_history_sample
+		{
+			float frame_time; // Milliseconds
+			float reshade_cpu_time;
+			float reshade_gpu_time;
+			float memory_size; // Mebibytes
+			float stream_time; // Milliseconds spent in world streaming calls of the game
+		};
+
+		// Unsmoothed per-frame samples, recorded while the statistics are visible, so that individual spikes can be seen
+		static constexpr size_t FRAME_HISTORY_SIZE = 1024;
+		frame_history_sample _frame_history[FRAME_HISTORY_SIZE] = {};
+		size_t _frame_history_index = 0;
+		size_t _frame_history_count = 0;
+		#pragma endregion
+
+		#pragma region Overlay NFS Benchmark
+		enum class nfs_benchmark_state
+		{
+			idle,
+			loading,
+			warmup,
+			recording
+		};
+
+		struct nfs_benchmark_sample
+		{
+			float frame_time; // Milliseconds
+			float reshade_cpu_time;
+			float reshade_gpu_time;
+		};
+
+		nfs_benchmark_state _nfs_benchmark_state = nfs_benchmark_state::idle;
+		unsigned int _nfs_benchmark_key_data[4] = {};
+		int _nfs_benchmark_track = DEFAULT_TRACK_NUM;
+		int _nfs_benchmark_num_ai_cars = 3;
+		float _nfs_benchmark_traffic_density = 0.0f;
+		int _nfs_benchmark_race_type = 0;
+		float _nfs_benchmark_precipitation = -1.0f; // Negative values keep the weather of the track
+		bool _nfs_benchmark_ai_control = true;
+		bool _nfs_benchmark_ai_control_toggled = false;
+		unsigned int _nfs_benchmark_warmup = 5; // Seconds
+		unsigned int _nfs_benchmark_duration = 60; // Seconds
+		std::filesystem::path _nfs_benchmark_path = L".\\";
+		std::chrono::high_resolution_clock::time_point _nfs_benchmark_phase_end_time;
+		std::vector<nfs_benchmark_sample> _nfs_benchmark_samples;
+		#pragma endregion
+
+		#pragma region Overlay NFS Render Toggle Sweep
+		enum class nfs_sweep_phase
+		{
+			settle_baseline,
+			measure_baseline,
+			settle_flipped,
+			measure_flipped
+		};
+
+		struct nfs_sweep_result
+		{
+			size_t toggle_index;
+			bool enabled_by_default;
+			float frame_time_baseline; // Milliseconds
+			float frame_time_flipped;
+			float gpu_time_baseline;
+			float gpu_time_flipped;
+		};
+
+		bool _nfs_sweep_active = false;
+		unsigned int _nfs_sweep_frames = 120;
+		unsigned int _nfs_sweep_settle_frames = 60; // At least the window of the GPU duration moving averages
+		size_t _nfs_sweep_toggle_index = 0;
+		int _nfs_sweep_original_value = 0;
+		nfs_sweep_phase _nfs_sweep_phase = nfs_sweep_phase::settle_baseline;
+		unsigned int _nfs_sweep_phase_frame = 0;
+		double _nfs_sweep_frame_time_sum = 0.0;
+		double _nfs_sweep_gpu_time_sum = 0.0;
+		std::vector<nfs_sweep_result> _nfs_sweep_results;
+		#pragma endregion
+
+		#pragma region Overlay NFS Dynamic Resolution
+		// Number of frames between adjustments, which is the window of the GPU duration moving averages, so that they fully reflect the previous adjustment
+		static constexpr unsigned int DYNAMIC_RESOLUTION_INTERVAL = 60;
+
+		bool _nfs_dynamic_resolution = false;
+		float _nfs_dynamic_resolution_budget = 4.0f; // Milliseconds
+		unsigned int _nfs_dynamic_resolution_frame = 0;
+		#pragma endregion
+
+		#pragma region Overlay NFS Foveation
+		// Fraction of the size of a render target that passes outside the back buffer are extended beyond the centre region, so that filters sampling neighbouring pixels still read up-to-date data at its edge
+		static constexpr float FOVEATION_MARGIN = 1.0f / 32;
+
+		bool _nfs_foveation = false;
+		float _nfs_foveation_region = 0.6f; // Fraction of the width and height of each eye that is rendered
+		#pragma endregion
+
+		#pragma region Overlay NFS Precipitation Budget
+		// Number of frames the frame time is averaged over between adjustments, which keeps the rain from flickering in density every frame
+		static constexpr unsigned int PRECIPITATION_BUDGET_INTERVAL = 30;
+		// Rain density, radius X, Y, Z and bound X, Y, Z
+		static constexpr size_t PRECIPITATION_BUDGET_VALUE_COUNT = 7;
+
+		bool _nfs_precipitation_budget = false;
+		float _nfs_precipitation_budget_frame_time = 16.7f; // Milliseconds
+		float _nfs_precipitation_budget_min_scale = 0.25f;
+		float _nfs_precipitation_budget_scale = 1.0f;
+		bool _nfs_precipitation_budget_applied = false;
+		unsigned int _nfs_precipitation_budget_frame = 0;
+		double _nfs_precipitation_budget_frame_time_sum = 0.0;
+		// Values the game set, which the scale is applied to, and the values that were last written, to notice when the game changes them (e.g. on a weather change)
+		float _nfs_precipitation_budget_base_values[PRECIPITATION_BUDGET_VALUE_COUNT] = {};
+		float _nfs_precipitation_budget_written_values[PRECIPITATION_BUDGET_VALUE_COUNT] = {};
+		#pragma endregion
+
+		#pragma region Overlay NFS World Detail Governor
+		// Number of frames the 95th percentile frame time is taken over, which also have to pass after every step before the next decision
+		static constexpr size_t WORLD_DETAIL_WINDOW_SIZE = 120;
+
+		struct nfs_world_detail_step
+		{
+			size_t toggle_index; // Index into the list of render toggles
+			int value;
+			int original_value; // Value the toggle had before this step was applied
+		};
+
+		bool _nfs_world_detail = false;
+		float _nfs_world_detail_budget = 16.7f; // Milliseconds
+		float _nfs_world_detail_hysteresis = 0.8f; // Fraction of the budget the frame time has to drop below before a step is reverted
+		// Quality ladder as "Toggle Name=value" entries, which are applied one after another while over budget
+		std::vector<std::string> _nfs_world_detail_ladder = { "Draw Car Shadows=0", "Preculler=1" };
+		std::vector<nfs_world_detail_step> _nfs_world_detail_steps;
+		size_t _nfs_world_detail_level = 0; // Number of steps currently applied
+		uint32_t _nfs_world_detail_step_count = 0; // Total number of steps taken in either direction
+		float _nfs_world_detail_frame_times[WORLD_DETAIL_WINDOW_SIZE] = {};
+		size_t _nfs_world_detail_frame_count = 0;
+		#pragma endregion
+
+		#pragma region Overlay NFS Worker Throttle
+		bool _nfs_worker_throttle = true;
+		unsigned int _nfs_worker_throttle_threads = 1; // Number of workers that keep picking up tasks while throttled
+		float _nfs_worker_throttle_budget = 0.0f; // Milliseconds, or zero to throttle during the whole race
+		bool _nfs_worker_throttle_avoid_game_threads = false;
+		bool _nfs_worker_throttled = false;
+		bool _nfs_worker_throttle_changed = false; // Set when the settings changed, to apply them again
+		// Time until which the frame time budget was last exceeded, to keep the throttle from flapping on and off with every frame
+		std::chrono::high_resolution_clock::time_point _nfs_worker_throttle_hold_time;
+		#pragma endregion
+
+		#pragma region Overlay NFS Visual Treatment Bypass
+		bool _nfs_visual_treatment_bypassed = false;
+		bool _nfs_visual_treatment_original = true; // Value of the visual look flag before it was cleared
+		#pragma endregion
+
+		#pragma region Overlay NFS Memory Watch
+		enum nfs_watch_type : int
+		{
+			nfs_watch_int32,
+			nfs_watch_uint32,
+			nfs_watch_float32,
+			nfs_watch_uint8,
+		};
+
+		struct nfs_watch
+		{
+			std::string name;
+			int type = nfs_watch_int32;
+			uintptr_t base = 0;
+			std::vector<int32_t> offsets;
+			bool builtin = false;
+			const void *resolved = nullptr; // Cached address of the value, or null if the pointer chain could not be resolved
+			std::vector<float> history; // Ring buffer of 'NFS_WATCH_HISTORY_SIZE' samples
+		};
+
+		static constexpr size_t NFS_WATCH_HISTORY_SIZE = 512;
+
+		bool _nfs_watch_enabled = false;
+		unsigned int _nfs_watch_sample_rate = 30; // Samples per second, zero samples every frame
+		std::vector<nfs_watch> _nfs_watches;
+		float _nfs_watch_frame_times[NFS_WATCH_HISTORY_SIZE] = {}; // Average frame time between samples, in milliseconds
+		size_t _nfs_watch_history_index = 0;
+		size_t _nfs_watch_history_count = 0;
+		int _nfs_watch_gameflow_state = -1;
+		double _nfs_watch_frame_time_sum = 0.0;
+		unsigned int _nfs_watch_frame_count = 0;
+		std::chrono::high_resolution_clock::time_point _nfs_watch_next_sample_time;
 		#pragma endregion
 
 		#pragma region Overlay Log
 		char _log_filter[32] = {};
 		bool _log_wordwrap = false;
 		uintmax_t _last_log_size;
-		std::vector<std::string> _log_lines;
+		long _last_log_offset = 0;
+		std::deque<std::string> _log_lines;
 		#pragma endregion
 
 		#pragma region Overlay Code Editor
@@ -8,7 +8,7 @@
 #include "ini_file.hpp"
 #include "addon_manager.hpp"
 #include "input.hpp"
-#include <algorithm> // std::all_of, std::find, std::find_if, std::for_each, std::remove_if
+#include <algorithm> // std::all_of, std::copy_n, std::find, std::find_if, std::for_each, std::min, std::min_element, std::nth_element, std::remove_if
 
 extern bool resolve_path(std::filesystem::path &path, std::error_code &ec);
 extern bool resolve_preset_path(std::filesystem::path &path, std::error_code &ec);
@@ -84,29 +84,57 @@ void reshade::runtime::enumerate_uniform_variables(const char *effect_name_in, v
 	}
 }
 
-reshade::api::effect_uniform_variable reshade::runtime::find_uniform_variable(const char *effect_name_in, const char *variable_name_in) const
+void reshade::runtime::update_variable_index() const
 {
-	if (is_loading() || variable_name_in == nullptr)
-		return { 0 };
+	_uniform_variable_index.clear();
+	_texture_variable_index.clear();
 
-	const std::filesystem::path effect_name = effect_name_in != nullptr ? std::filesystem::u8path(effect_name_in) : std::filesystem::path();
-	const std::string_view variable_name(variable_name_in);
+	// Size the name list up front, so that views into it stay valid while inserting keys
+	_variable_index_effect_names.resize(_effects.size());
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+		_variable_index_effect_names[effect_index] = _effects[effect_index].source_file.filename().u8string();
 
-	for (const effect &effect : _effects)
+	// Use 'emplace' so that the first declaration wins, which matches the order variables were searched in before
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
 	{
-		if (effect_name_in != nullptr && effect.source_file.filename() != effect_name)
-			continue;
+		const std::string_view effect_name = _variable_index_effect_names[effect_index];
 
-		for (const uniform &variable : effect.uniforms)
+		for (const uniform &variable : _effects[effect_index].uniforms)
 		{
-			if (variable.name == variable_name)
-				return { reinterpret_cast<uintptr_t>(&variable) };
+			_uniform_variable_index.emplace(std::make_pair(effect_name, std::string_view(variable.name)), reinterpret_cast<uintptr_t>(&variable));
+			_uniform_variable_index.emplace(std::make_pair(std::string_view(), std::string_view(variable.name)), reinterpret_cast<uintptr_t>(&variable));
 		}
+	}
 
-		if (effect_name_in != nullptr)
-			break;
+	for (const texture &variable : _textures)
+	{
+		for (const std::string_view variable_name : { std::string_view(variable.name), std::string_view(variable.unique_name) })
+		{
+			for (const size_t effect_index : variable.shared)
+				_texture_variable_index.emplace(std::make_pair(std::string_view(_variable_index_effect_names[effect_index]), variable_name), reinterpret_cast<uintptr_t>(&variable));
+			_texture_variable_index.emplace(std::make_pair(std::string_view(), variable_name), reinterpret_cast<uintptr_t>(&variable));
+		}
 	}
 
+	_variable_index_generation = _effects_generation;
+}
+
+reshade::api::effect_uniform_variable reshade::runtime::find_uniform_variable(const char *effect_name_in, const char *variable_name_in) const
+{
+	if (is_loading() || variable_name_in == nullptr)
+		return { 0 };
+
+	if (_variable_index_generation != _effects_generation)
+		update_variable_index();
+
+	const std::string_view effect_name = effect_name_in != nullptr ? std::string_view(effect_name_in) : std::string_view();
+	if (effect_name_in != nullptr && effect_name.empty())
+		return { 0 };
+
+	if (const auto it = _uniform_variable_index.find(std::make_pair(effect_name, std::string_view(variable_name_in)));
+		it != _uniform_variable_index.end())
+		return { it->second };
+
 	return { 0 };
 }
 
@@ -487,23 +515,16 @@ reshade::api::effect_texture_variable reshade::runtime::find_texture_variable(co
 	if (is_loading() || variable_name_in == nullptr)
 		return { 0 };
 
-	const std::filesystem::path effect_name = effect_name_in != nullptr ? std::filesystem::u8path(effect_name_in) : std::filesystem::path();
-	const std::string_view variable_name(variable_name_in);
-
-	for (const texture &variable : _textures)
-	{
-		if (effect_name_in != nullptr &&
-			std::find_if(variable.shared.cbegin(), variable.shared.cend(),
-				[&](size_t effect_index) {
-					return _effects[effect_index].source_file.filename() == effect_name;
-				}) == variable.shared.cend())
-			continue;
+	if (_variable_index_generation != _effects_generation)
+		update_variable_index();
 
-		if (variable.name != variable_name && variable.unique_name != variable_name)
-			continue;
+	const std::string_view effect_name = effect_name_in != nullptr ? std::string_view(effect_name_in) : std::string_view();
+	if (effect_name_in != nullptr && effect_name.empty())
+		return { 0 };
 
-		return { reinterpret_cast<uintptr_t>(&variable) };
-	}
+	if (const auto it = _texture_variable_index.find(std::make_pair(effect_name, std::string_view(variable_name_in)));
+		it != _texture_variable_index.end())
+		return { it->second };
 
 	return { 0 };
 }
@@ -695,13 +716,13 @@ void reshade::runtime::get_texture_binding(api::effect_texture_variable handle,
 			if (out_srv_srgb != nullptr)
 				*out_srv_srgb = variable->srv[1];
 		}
-		else if (const auto it = _texture_semantic_bindings.find(variable->semantic);
-			it != _texture_semantic_bindings.end())
+		else if (const uint32_t semantic_id = find_texture_semantic(variable->semantic);
+			semantic_id != std::numeric_limits<uint32_t>::max())
 		{
 			if (out_srv != nullptr)
-				*out_srv = it->second.first;
+				*out_srv = _texture_semantic_bindings[semantic_id].srv;
 			if (out_srv_srgb != nullptr)
-				*out_srv_srgb = it->second.second;
+				*out_srv_srgb = _texture_semantic_bindings[semantic_id].srv_srgb;
 		}
 		return;
 	}
@@ -717,70 +738,44 @@ void reshade::runtime::update_texture_bindings(const char *semantic, api::resour
 	if (srv_srgb == 0)
 		srv_srgb = srv;
 
-	if (srv != 0)
-	{
-		_texture_semantic_bindings[semantic] = { srv, srv_srgb };
-	}
-	else
-	{
-		_texture_semantic_bindings.erase(semantic);
+	texture_semantic_binding &binding = _texture_semantic_bindings[intern_texture_semantic(semantic)];
+	binding.srv = srv;
+	binding.srv_srgb = srv_srgb;
 
+	if (srv == 0)
+	{
 		// Overwrite with empty texture, since it is not valid to bind a zero handle
 		srv = srv_srgb = _empty_srv;
 	}
 
-	// Update texture bindings
-	size_t num_bindings = 0;
-	for (const effect &effect_data : _effects)
-	{
-		if (!effect_data.compiled)
-			continue;
-
-		num_bindings += effect_data.permutations[0].texture_semantic_to_binding.size();
-	}
-
-	num_bindings *= _effect_permutations.size();
-
+	// Update only the texture descriptors that reference this semantic
 	std::vector<api::descriptor_table_update> descriptor_writes;
-	descriptor_writes.reserve(num_bindings);
-	std::vector<api::sampler_with_resource_view> sampler_descriptors(num_bindings);
+	descriptor_writes.reserve(binding.descriptors.size());
+	std::vector<api::sampler_with_resource_view> sampler_descriptors(binding.descriptors.size());
 
-	for (const effect &effect_data : _effects)
+	for (size_t i = 0; i < binding.descriptors.size(); ++i)
 	{
-		if (!effect_data.compiled)
-			continue;
+		const texture_semantic_binding::descriptor &descriptor = binding.descriptors[i];
 
-		for (size_t permutation_index = 0; permutation_index < _effect_permutations.size(); ++permutation_index)
-		{
-			if (permutation_index >= effect_data.permutations.size())
-				break;
-
-			for (const effect::binding &binding : effect_data.permutations[permutation_index].texture_semantic_to_binding)
-			{
-				if (binding.semantic != semantic)
-					continue;
-
-				api::descriptor_table_update &write = descriptor_writes.emplace_back();
-				write.table = binding.table;
-				write.binding = binding.index;
-				write.count = 1;
-
-				if (binding.sampler != 0)
-				{
-					write.type = api::descriptor_type::sampler_with_resource_view;
-					write.descriptors = &sampler_descriptors[--num_bindings];
+		api::descriptor_table_update &write = descriptor_writes.emplace_back();
+		write.table = descriptor.table;
+		write.binding = descriptor.index;
+		write.count = 1;
 
-					sampler_descriptors[num_bindings].sampler = binding.sampler;
-				}
-				else
-				{
-					write.type = api::descriptor_type::shader_resource_view;
-					write.descriptors = &sampler_descriptors[--num_bindings].view;
-				}
+		if (descriptor.sampler != 0)
+		{
+			write.type = api::descriptor_type::sampler_with_resource_view;
+			write.descriptors = &sampler_descriptors[i];
 
-				sampler_descriptors[num_bindings].view = binding.srgb ? srv_srgb : srv;
-			}
+			sampler_descriptors[i].sampler = descriptor.sampler;
+		}
+		else
+		{
+			write.type = api::descriptor_type::shader_resource_view;
+			write.descriptors = &sampler_descriptors[i].view;
 		}
+
+		sampler_descriptors[i].view = descriptor.srgb ? srv_srgb : srv;
 	}
 
 	if (descriptor_writes.empty())
@@ -1386,7 +1381,10 @@ void reshade::runtime::render_technique(api::effect_technique handle, api::comma
 	_is_in_api_call = true;
 #endif
 
-	render_technique(*tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index);
+	_uniform_push_effect_index = std::numeric_limits<size_t>::max();
+	_effect_permutations[permutation_index].color_tex_outdated = true;
+
+	render_technique(*tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index, true);
 
 #if RESHADE_ADDON
 	_is_in_api_call = was_is_in_api_call;
@@ -1559,3 +1557,36 @@ void reshade::runtime::reload_effect_next_frame(const char *effect_name)
 			_reload_required_effects.emplace_back(effect_index, 0u);
 	}
 }
+
+uint32_t reshade::runtime::get_nfs_vehicles(uint32_t max_count, api::nfs_vehicle *out_vehicles) const
+{
+	if (out_vehicles != nullptr)
+		std::copy_n(_nfs_game_state.vehicles, std::min({ max_count, _nfs_game_state.vehicle_count, NFS_MAX_VEHICLES }), out_vehicles);
+
+	return _nfs_game_state.vehicle_count;
+}
+
+bool reshade::runtime::get_present_stage_statistics(api::present_stage stage, api::present_stage_statistics *out_stats) const
+{
+	if (stage >= api::present_stage::count || out_stats == nullptr || _present_stage_history_count == 0)
+		return false;
+
+	const uint64_t *const history = _present_stage_durations[static_cast<size_t>(stage)];
+
+	uint64_t sorted[PRESENT_STAGE_HISTORY_SIZE];
+	uint64_t sum = 0;
+	for (size_t i = 0; i < _present_stage_history_count; ++i)
+		sum += (sorted[i] = history[i]);
+
+	// Only need partial ordering to find the minimum and 99th percentile
+	const size_t p99_index = (_present_stage_history_count * 99) / 100;
+	std::nth_element(sorted, sorted + p99_index, sorted + _present_stage_history_count);
+
+	out_stats->last = history[(_present_stage_history_index + PRESENT_STAGE_HISTORY_SIZE - 1) % PRESENT_STAGE_HISTORY_SIZE];
+	out_stats->min = *std::min_element(sorted, sorted + p99_index + 1);
+	out_stats->average = sum / _present_stage_history_count;
+	out_stats->p99 = sorted[p99_index];
+	out_stats->num_frames = static_cast<uint32_t>(_present_stage_history_count);
+
+	return true;
+}
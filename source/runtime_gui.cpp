@@ -17,13 +17,20 @@
 #include "imgui_widgets.hpp"
 #include "localization.hpp"
 #include "platform_utils.hpp"
+#include "lockfree_queue.hpp"
+#include "memory_patch.hpp"
+#include "hook_manager.hpp"
+#include "startup_trace.hpp"
+#include "thread_pool.hpp"
 #include "fonts/forkawesome.inl"
 #include "fonts/glyph_ranges.hpp"
-#include <cmath> // std::abs, std::ceil, std::floor
+#include <cmath> // std::abs, std::ceil, std::floor, std::sqrt
 #include <cctype> // std::tolower
-#include <cstdlib> // std::lldiv, std::strtol
-#include <cstring> // std::memcmp, std::memcpy
-#include <algorithm> // std::any_of, std::count_if, std::find, std::find_if, std::max, std::min, std::replace, std::rotate, std::search, std::swap, std::transform
+#include <cstdio> // std::fclose, std::fprintf, std::fputs, std::snprintf
+#include <cstdlib> // std::atoi, std::lldiv, std::strtol, std::strtoul
+#include <cstring> // std::memcmp, std::memcpy, std::strcmp, std::strlen
+#include <algorithm> // std::any_of, std::count_if, std::find, std::find_if, std::lower_bound, std::max, std::min, std::nth_element, std::replace, std::rotate, std::search, std::sort, std::swap, std::transform
+#include <utf8/unchecked.h>
 #ifdef GAME_MW
 #include "NFSMW_PreFEngHook.h"
 #endif
@@ -45,6 +52,9 @@
 
 extern bool resolve_path(std::filesystem::path &path, std::error_code &ec);
 
+// Checks the addresses of all NFS tweaks once, see definition below
+void ValidateNFSTweaks();
+
 static bool string_contains(const std::string_view text, const std::string_view filter)
 {
 	return filter.empty() ||
@@ -139,6 +149,8 @@ void reshade::runtime::init_gui()
 	imgui_style.WindowRounding = 0.0f;
 	imgui_style.WindowBorderSize = 0.0f;
 
+	ValidateNFSTweaks();
+
 	// Restore previous context in case this was called from a new runtime being created from an add-on event triggered by an existing runtime
 	ImGui::SetCurrentContext(backup_context);
 }
@@ -160,6 +172,10 @@ void reshade::runtime::build_font_atlas()
 	// Remove any existing fonts from atlas first
 	atlas->Clear();
 
+	// Draw data of the cached OSD references the old atlas
+	_osd_cache_stable = false;
+	_osd_cache_key.clear();
+
 	std::error_code ec;
 	const ImWchar *glyph_ranges = nullptr;
 	std::filesystem::path resolved_font_path;
@@ -209,6 +225,31 @@ void reshade::runtime::build_font_atlas()
 		_default_font_path.clear();
 	}
 
+#if RESHADE_LOCALIZATION
+	// Rasterizing all of the Japanese, Korean or Chinese ranges takes long and results in a huge atlas, so only add the glyphs the UI actually uses
+	_font_atlas_used_glyphs_only = language.find("ja") == 0 || language.find("ko") == 0 || language.find("zh") == 0;
+	if (_font_atlas_used_glyphs_only)
+	{
+		ImFontGlyphRangesBuilder builder;
+		builder.AddRanges(atlas->GetGlyphRangesDefault());
+		// CJK punctuation, Hiragana, Katakana and full-width forms are small enough to always include
+		static constexpr ImWchar base_ranges[] = { 0x3000, 0x30FF, 0xFF00, 0xFFEF, 0 };
+		builder.AddRanges(base_ranges);
+
+		const std::string localized_strings = resources::load_all_strings();
+		builder.AddText(localized_strings.c_str(), localized_strings.c_str() + localized_strings.size());
+
+		for (const uint32_t c : _font_atlas_requested_glyphs)
+			builder.AddChar(static_cast<ImWchar>(c));
+
+		ImVector<ImWchar> ranges;
+		builder.BuildRanges(&ranges);
+		_font_atlas_glyph_ranges.assign(ranges.begin(), ranges.end());
+
+		glyph_ranges = _font_atlas_glyph_ranges.data();
+	}
+#endif
+
 	const auto add_font_from_file = [atlas](std::filesystem::path &font_path, ImFontConfig cfg, const ImWchar *glyph_ranges, std::error_code &ec) -> bool {
 		if (font_path.empty())
 			return true;
@@ -367,6 +408,55 @@ void reshade::runtime::build_font_atlas()
 	_device->set_resource_name(_font_atlas_tex, "ImGui font atlas");
 }
 
+void reshade::runtime::request_font_glyphs(const std::string_view text)
+{
+	ImFontAtlas *const atlas = _imgui_context->IO.Fonts;
+
+	if (!_font_atlas_used_glyphs_only || atlas->Fonts.empty())
+		return;
+
+	bool missing_glyphs = false;
+
+	for (auto it = text.begin(); it != text.end();)
+	{
+		const uint32_t c = utf8::unchecked::next(it);
+		// Glyphs outside the basic multilingual plane cannot be represented with 16-bit 'ImWchar'
+		if (c < 0x80 || c > 0xFFFF || atlas->Fonts[0]->FindGlyphNoFallback(static_cast<ImWchar>(c)) != nullptr)
+			continue;
+
+		if (const auto insert_pos = std::lower_bound(_font_atlas_requested_glyphs.begin(), _font_atlas_requested_glyphs.end(), c);
+			insert_pos == _font_atlas_requested_glyphs.end() || *insert_pos != c)
+		{
+			_font_atlas_requested_glyphs.insert(insert_pos, c);
+			missing_glyphs = true;
+		}
+	}
+
+	// Rebuild font atlas with the additional glyphs on the next frame
+	if (missing_glyphs)
+		atlas->TexReady = false;
+}
+void reshade::runtime::request_effect_font_glyphs()
+{
+	if (!_font_atlas_used_glyphs_only)
+		return;
+
+	for (const technique &tech : _techniques)
+	{
+		request_font_glyphs(tech.annotation_as_string("ui_label"));
+		request_font_glyphs(tech.annotation_as_string("ui_tooltip"));
+	}
+
+	for (const effect &effect : _effects)
+	{
+		for (const uniform &variable : effect.uniforms)
+		{
+			for (const char *const name : { "ui_label", "ui_tooltip", "ui_category", "ui_items", "ui_text", "ui_units" })
+				request_font_glyphs(variable.annotation_as_string(name));
+		}
+	}
+}
+
 void reshade::runtime::load_config_gui(const ini_file &config)
 {
 	if (_input_gamepad != nullptr)
@@ -386,6 +476,80 @@ void reshade::runtime::load_config_gui(const ini_file &config)
 	config_get("INPUT", "KeyFrameTime", _frametime_key_data);
 	config_get("INPUT", "InputProcessing", _input_processing_mode);
 	config.get("INPUT", "NFSToggleFrontend", _toggle_fe_key_data);
+	config.get("INPUT", "NFSBenchmark", _nfs_benchmark_key_data);
+
+	config.get("NFS", "BenchmarkTrack", _nfs_benchmark_track);
+	config.get("NFS", "BenchmarkNumAICars", _nfs_benchmark_num_ai_cars);
+	config.get("NFS", "BenchmarkTrafficDensity", _nfs_benchmark_traffic_density);
+	config.get("NFS", "BenchmarkRaceType", _nfs_benchmark_race_type);
+	config.get("NFS", "BenchmarkPrecipitation", _nfs_benchmark_precipitation);
+	config.get("NFS", "BenchmarkAIControl", _nfs_benchmark_ai_control);
+	config.get("NFS", "BenchmarkWarmup", _nfs_benchmark_warmup);
+	config.get("NFS", "BenchmarkDuration", _nfs_benchmark_duration);
+	config.get("NFS", "BenchmarkPath", _nfs_benchmark_path);
+
+	config.get("NFS", "DynamicResolution", _nfs_dynamic_resolution);
+	config.get("NFS", "DynamicResolutionBudget", _nfs_dynamic_resolution_budget);
+
+	config.get("NFS", "Foveation", _nfs_foveation);
+	config.get("NFS", "FoveationRegion", _nfs_foveation_region);
+
+	config.get("NFS", "PrecipitationBudget", _nfs_precipitation_budget);
+	config.get("NFS", "PrecipitationBudgetFrameTime", _nfs_precipitation_budget_frame_time);
+	config.get("NFS", "PrecipitationBudgetMinScale", _nfs_precipitation_budget_min_scale);
+
+	config.get("NFS", "WorldDetail", _nfs_world_detail);
+	config.get("NFS", "WorldDetailBudget", _nfs_world_detail_budget);
+	config.get("NFS", "WorldDetailHysteresis", _nfs_world_detail_hysteresis);
+	config.get("NFS", "WorldDetailLadder", _nfs_world_detail_ladder);
+	parse_nfs_world_detail_ladder();
+
+	config.get("NFS", "WorkerThrottle", _nfs_worker_throttle);
+	config.get("NFS", "WorkerThrottleThreads", _nfs_worker_throttle_threads);
+	config.get("NFS", "WorkerThrottleBudget", _nfs_worker_throttle_budget);
+	config.get("NFS", "WorkerThrottleAvoidGameThreads", _nfs_worker_throttle_avoid_game_threads);
+
+	config.get("NFS", "WatchEnabled", _nfs_watch_enabled);
+	config.get("NFS", "WatchSampleRate", _nfs_watch_sample_rate);
+
+	_nfs_watches.clear();
+	add_nfs_watch("GameFlow State", nfs_watch_int32, GAMEFLOWMGR_STATUS_ADDR, {}, true);
+#ifdef GAMESPEED_ADDR
+	add_nfs_watch("Game Speed", nfs_watch_float32, GAMESPEED_ADDR, {}, true);
+#endif
+#ifdef PRECIPITATION_PERCENT_ADDR
+	add_nfs_watch("Precipitation Percent", nfs_watch_float32, PRECIPITATION_PERCENT_ADDR, {}, true);
+#endif
+#if defined(GAME_MW)
+	add_nfs_watch("Player Cash", nfs_watch_int32, FEDATABASE_ADDR, { 0x10, 0xB4 }, true);
+#elif defined(GAME_CARBON)
+	add_nfs_watch("Player Cash", nfs_watch_int32, FEMANAGER_INSTANCE_ADDR, { 0xD4, 0, 0x24330 }, true);
+#endif
+
+	// User watches are stored as "name|type|base|offset:offset:..."
+	std::vector<std::string> watches;
+	config.get("NFS", "Watches", watches);
+	for (const std::string &watch : watches)
+	{
+		const size_t type_pos = watch.find('|');
+		const size_t base_pos = watch.find('|', type_pos + 1);
+		if (type_pos == std::string::npos || base_pos == std::string::npos)
+			continue;
+		const size_t offsets_pos = watch.find('|', base_pos + 1);
+
+		std::vector<int32_t> offsets;
+		for (const char *p = offsets_pos != std::string::npos ? watch.c_str() + offsets_pos + 1 : ""; *p != '\0';)
+		{
+			char *end = nullptr;
+			const long offset = std::strtol(p, &end, 0);
+			if (end == p)
+				break;
+			offsets.push_back(static_cast<int32_t>(offset));
+			p = end + (*end == ':');
+		}
+
+		add_nfs_watch(watch.substr(0, type_pos), std::atoi(watch.c_str() + type_pos + 1), std::strtoul(watch.c_str() + base_pos + 1, nullptr, 0), std::move(offsets));
+	}
 
 #if RESHADE_LOCALIZATION
 	config_get("OVERLAY", "Language", _selected_language);
@@ -393,6 +557,7 @@ void reshade::runtime::load_config_gui(const ini_file &config)
 
 	config.get("OVERLAY", "ClockFormat", _clock_format);
 	config.get("OVERLAY", "FPSPosition", _fps_pos);
+	config.get("OVERLAY", "GatherPassStatistics", _gather_pass_gpu_statistics);
 	config.get("OVERLAY", "NoFontScaling", _no_font_scaling);
 	config.get("OVERLAY", "ShowClock", _show_clock);
 	config.get("OVERLAY", "ShowForceLoadEffectsButton", _show_force_load_effects_button);
@@ -488,6 +653,56 @@ void reshade::runtime::save_config_gui(ini_file &config) const
 	config.set("INPUT", "KeyFrametime", _frametime_key_data);
 	config.set("INPUT", "InputProcessing", _input_processing_mode);
 	config.set("INPUT", "NFSToggleFrontend", _toggle_fe_key_data);
+	config.set("INPUT", "NFSBenchmark", _nfs_benchmark_key_data);
+
+	config.set("NFS", "BenchmarkTrack", _nfs_benchmark_track);
+	config.set("NFS", "BenchmarkNumAICars", _nfs_benchmark_num_ai_cars);
+	config.set("NFS", "BenchmarkTrafficDensity", _nfs_benchmark_traffic_density);
+	config.set("NFS", "BenchmarkRaceType", _nfs_benchmark_race_type);
+	config.set("NFS", "BenchmarkPrecipitation", _nfs_benchmark_precipitation);
+	config.set("NFS", "BenchmarkAIControl", _nfs_benchmark_ai_control);
+	config.set("NFS", "BenchmarkWarmup", _nfs_benchmark_warmup);
+	config.set("NFS", "BenchmarkDuration", _nfs_benchmark_duration);
+	config.set("NFS", "BenchmarkPath", _nfs_benchmark_path);
+
+	config.set("NFS", "DynamicResolution", _nfs_dynamic_resolution);
+	config.set("NFS", "DynamicResolutionBudget", _nfs_dynamic_resolution_budget);
+
+	config.set("NFS", "Foveation", _nfs_foveation);
+	config.set("NFS", "FoveationRegion", _nfs_foveation_region);
+
+	config.set("NFS", "PrecipitationBudget", _nfs_precipitation_budget);
+	config.set("NFS", "PrecipitationBudgetFrameTime", _nfs_precipitation_budget_frame_time);
+	config.set("NFS", "PrecipitationBudgetMinScale", _nfs_precipitation_budget_min_scale);
+
+	config.set("NFS", "WorldDetail", _nfs_world_detail);
+	config.set("NFS", "WorldDetailBudget", _nfs_world_detail_budget);
+	config.set("NFS", "WorldDetailHysteresis", _nfs_world_detail_hysteresis);
+	config.set("NFS", "WorldDetailLadder", _nfs_world_detail_ladder);
+
+	config.set("NFS", "WorkerThrottle", _nfs_worker_throttle);
+	config.set("NFS", "WorkerThrottleThreads", _nfs_worker_throttle_threads);
+	config.set("NFS", "WorkerThrottleBudget", _nfs_worker_throttle_budget);
+	config.set("NFS", "WorkerThrottleAvoidGameThreads", _nfs_worker_throttle_avoid_game_threads);
+
+	config.set("NFS", "WatchEnabled", _nfs_watch_enabled);
+	config.set("NFS", "WatchSampleRate", _nfs_watch_sample_rate);
+
+	std::vector<std::string> watches;
+	for (const nfs_watch &watch : _nfs_watches)
+	{
+		if (watch.builtin)
+			continue;
+
+		char base[16];
+		std::snprintf(base, std::size(base), "0x%.8zX", static_cast<size_t>(watch.base));
+
+		std::string value = watch.name + '|' + std::to_string(watch.type) + '|' + base + '|';
+		for (size_t i = 0; i < watch.offsets.size(); ++i)
+			value += (i != 0 ? ":" : "") + std::to_string(watch.offsets[i]);
+		watches.push_back(std::move(value));
+	}
+	config.set("NFS", "Watches", watches);
 
 #if RESHADE_LOCALIZATION
 	config.set("OVERLAY", "Language", _selected_language);
@@ -495,6 +710,7 @@ void reshade::runtime::save_config_gui(ini_file &config) const
 
 	config.set("OVERLAY", "ClockFormat", _clock_format);
 	config.set("OVERLAY", "FPSPosition", _fps_pos);
+	config.set("OVERLAY", "GatherPassStatistics", _gather_pass_gpu_statistics);
 	config.set("OVERLAY", "ShowClock", _show_clock);
 	config.set("OVERLAY", "ShowForceLoadEffectsButton", _show_force_load_effects_button);
 	config.set("OVERLAY", "ShowFPS", _show_fps);
@@ -900,6 +1116,7 @@ void reshade::runtime::draw_gui()
 	const bool show_frametime = _show_frametime == 1 || (_show_overlay && _show_frametime > 1);
 	const bool show_preset_name = _show_preset_name == 1 || (_show_overlay && _show_preset_name > 1);
 	bool show_statistics_window = show_clock || show_fps || show_frametime || show_preset_name;
+	bool has_addon_osd_widgets = false;
 #if RESHADE_ADDON
 	for (const addon_info &info : addon_loaded_info)
 	{
@@ -908,12 +1125,23 @@ void reshade::runtime::draw_gui()
 			if (widget.title == "OSD")
 			{
 				show_statistics_window = true;
+				has_addon_osd_widgets = true;
 				break;
 			}
 		}
 	}
 #endif
 
+	// Update the displayed frame rate at a fixed interval only, so that the OSD text does not change every frame
+	_osd_frame_count++;
+	if (const auto osd_elapsed = _last_present_time - _osd_last_update_time;
+		osd_elapsed >= std::chrono::milliseconds(250))
+	{
+		_osd_framerate = static_cast<float>(_osd_frame_count / std::chrono::duration<double>(osd_elapsed).count());
+		_osd_frame_count = 0;
+		_osd_last_update_time = _last_present_time;
+	}
+
 	_ignore_shortcuts = false;
 	_block_input_next_frame = false;
 	_gather_gpu_statistics = false;
@@ -934,6 +1162,10 @@ void reshade::runtime::draw_gui()
 		return; // Early-out to avoid costly ImGui calls when no GUI elements are on the screen
 	}
 
+	// Create pipeline and sampler on first use, rather than during initialization
+	if (_imgui_pipeline == 0 && !init_imgui_resources())
+		return;
+
 	build_font_atlas();
 	if (_font_atlas_srv == 0)
 		return; // Cannot render GUI without font atlas
@@ -942,6 +1174,101 @@ void reshade::runtime::draw_gui()
 	ImGui::SetCurrentContext(_imgui_context);
 
 	ImGuiIO &imgui_io = _imgui_context->IO;
+
+	const auto render_draw_data = [this](ImDrawData *draw_data) {
+		if (draw_data == nullptr || draw_data->CmdListsCount == 0 || draw_data->TotalVtxCount == 0)
+			return;
+
+		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+
+		if (_back_buffer_resolved != 0)
+		{
+			render_imgui_draw_data(cmd_list, draw_data, _back_buffer_targets[0]);
+		}
+		else
+		{
+			uint32_t back_buffer_index = get_current_back_buffer_index() * 2;
+			const api::resource back_buffer_resource = _device->get_resource_from_view(_back_buffer_targets[back_buffer_index]);
+
+			cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::render_target);
+			render_imgui_draw_data(cmd_list, draw_data, _back_buffer_targets[back_buffer_index]);
+			cmd_list->barrier(back_buffer_resource, api::resource_usage::render_target, api::resource_usage::present);
+		}
+	};
+
+	// Format the OSD text up front, so it can be compared against what was displayed last
+	char osd_clock[64] = "";
+	char osd_fps[32] = "";
+	char osd_frametime[32] = "";
+	const float osd_framerate = _osd_framerate != 0.0f ? _osd_framerate : imgui_io.Framerate;
+	if (show_clock)
+	{
+		const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		struct tm tm; localtime_s(&tm, &t);
+
+		switch (_clock_format)
+		{
+		default:
+		case 0:
+			ImFormatString(osd_clock, sizeof(osd_clock), "%02d:%02d", tm.tm_hour, tm.tm_min);
+			break;
+		case 1:
+			ImFormatString(osd_clock, sizeof(osd_clock), "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
+			break;
+		case 2:
+			ImFormatString(osd_clock, sizeof(osd_clock), "%.4d-%.2d-%.2d %02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+			break;
+		}
+	}
+	if (show_fps)
+		ImFormatString(osd_fps, sizeof(osd_fps), "%.0f fps", osd_framerate);
+	if (show_frametime)
+		ImFormatString(osd_frametime, sizeof(osd_frametime), "%5.2f ms", 1000.0f / osd_framerate);
+
+	// When nothing but the OSD is visible, its contents only change with the displayed values, so reuse the draw data of the last frame instead of building a new ImGui frame while those stay the same
+	if (show_statistics_window && !show_splash_window && !show_message_window && !_show_overlay && _preview_texture == 0 && !has_addon_osd_widgets
+#if RESHADE_ADDON
+		&& !has_addon_event<addon_event::reshade_overlay>()
+#endif
+		)
+	{
+		std::string osd_key;
+		osd_key.reserve(256);
+		osd_key += osd_clock; osd_key += '\n';
+		osd_key += osd_fps; osd_key += '\n';
+		osd_key += osd_frametime; osd_key += '\n';
+		if (show_preset_name)
+			osd_key += _current_preset_path.u8string();
+		osd_key += '\n';
+		osd_key.append(reinterpret_cast<const char *>(_fps_col), sizeof(_fps_col));
+		osd_key.append(reinterpret_cast<const char *>(&_fps_scale), sizeof(_fps_scale));
+		osd_key += std::to_string(_fps_pos) + ' ' + std::to_string(_width) + 'x' + std::to_string(_height) + ' ' + std::to_string(_font_atlas_srv.handle);
+
+		// Only skip once the same contents were built twice in a row, since the auto-resizing OSD window only settles on its size in the frame after its contents changed
+		if (_osd_cache_stable && osd_key == _osd_cache_key)
+		{
+			if (_input != nullptr)
+			{
+				_input->block_mouse_input(false);
+				_input->block_keyboard_input(false);
+				_input->block_mouse_cursor_warping(false);
+			}
+
+			render_draw_data(ImGui::GetDrawData());
+
+			ImGui::SetCurrentContext(backup_context);
+			return;
+		}
+
+		_osd_cache_stable = osd_key == _osd_cache_key;
+		_osd_cache_key = std::move(osd_key);
+	}
+	else
+	{
+		_osd_cache_stable = false;
+		_osd_cache_key.clear();
+	}
+
 	imgui_io.DeltaTime = _last_frame_duration.count() * 1e-9f;
 	imgui_io.DisplaySize.x = static_cast<float>(_width);
 	imgui_io.DisplaySize.y = static_cast<float>(_height);
@@ -1317,44 +1644,16 @@ void reshade::runtime::draw_gui()
 		ImGui::SetWindowFontScale(_fps_scale);
 
 		const float content_width = ImGui::GetContentRegionAvail().x;
-		char temp[512];
 
-		if (show_clock)
+		for (const char *const text : { osd_clock, osd_fps, osd_frametime })
 		{
-			const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-			struct tm tm; localtime_s(&tm, &t);
+			if (*text == '\0')
+				continue;
 
-			int temp_size;
-			switch (_clock_format)
-			{
-			default:
-			case 0:
-				temp_size = ImFormatString(temp, sizeof(temp), "%02d:%02d", tm.tm_hour, tm.tm_min);
-				break;
-			case 1:
-				temp_size = ImFormatString(temp, sizeof(temp), "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
-				break;
-			case 2:
-				temp_size = ImFormatString(temp, sizeof(temp), "%.4d-%.2d-%.2d %02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-				break;
-			}
+			const char *const text_end = text + std::strlen(text);
 			if (_fps_pos % 2) // Align text to the right of the window
-				ImGui::SetCursorPosX(content_width - ImGui::CalcTextSize(temp, temp + temp_size).x + _imgui_context->Style.ItemSpacing.x);
-			ImGui::TextUnformatted(temp, temp + temp_size);
-		}
-		if (show_fps)
-		{
-			const int temp_size = ImFormatString(temp, sizeof(temp), "%.0f fps", imgui_io.Framerate);
-			if (_fps_pos % 2)
-				ImGui::SetCursorPosX(content_width - ImGui::CalcTextSize(temp, temp + temp_size).x + _imgui_context->Style.ItemSpacing.x);
-			ImGui::TextUnformatted(temp, temp + temp_size);
-		}
-		if (show_frametime)
-		{
-			const int temp_size = ImFormatString(temp, sizeof(temp), "%5.2f ms", 1000.0f / imgui_io.Framerate);
-			if (_fps_pos % 2)
-				ImGui::SetCursorPosX(content_width - ImGui::CalcTextSize(temp, temp + temp_size).x + _imgui_context->Style.ItemSpacing.x);
-			ImGui::TextUnformatted(temp, temp + temp_size);
+				ImGui::SetCursorPosX(content_width - ImGui::CalcTextSize(text, text_end).x + _imgui_context->Style.ItemSpacing.x);
+			ImGui::TextUnformatted(text, text_end);
 		}
 		if (show_preset_name)
 		{
@@ -1585,25 +1884,7 @@ void reshade::runtime::draw_gui()
 		_input->block_mouse_cursor_warping(_show_overlay || _block_input_next_frame || block_mouse_input);
 	}
 
-	if (ImDrawData *const draw_data = ImGui::GetDrawData();
-		draw_data != nullptr && draw_data->CmdListsCount != 0 && draw_data->TotalVtxCount != 0)
-	{
-		api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
-
-		if (_back_buffer_resolved != 0)
-		{
-			render_imgui_draw_data(cmd_list, draw_data, _back_buffer_targets[0]);
-		}
-		else
-		{
-			uint32_t back_buffer_index = get_current_back_buffer_index() * 2;
-			const api::resource back_buffer_resource = _device->get_resource_from_view(_back_buffer_targets[back_buffer_index]);
-
-			cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::render_target);
-			render_imgui_draw_data(cmd_list, draw_data, _back_buffer_targets[back_buffer_index]);
-			cmd_list->barrier(back_buffer_resource, api::resource_usage::render_target, api::resource_usage::present);
-		}
-	}
+	render_draw_data(ImGui::GetDrawData());
 
 	ImGui::SetCurrentContext(backup_context);
 }
@@ -1900,13 +2181,22 @@ void reshade::runtime::draw_gui_home()
 		{
 			_effects_expanded_state = 3;
 
-			for (technique &tech : _techniques)
+			if (_technique_search_index_generation != _effects_generation || _technique_search_index.size() != _techniques.size())
+				update_technique_search_index();
+
+			std::vector<size_t> matches;
+			_technique_search_index.find(_effect_filter, matches);
+
+			for (size_t technique_index = 0, match = 0; technique_index < _techniques.size(); ++technique_index)
 			{
-				std::string_view label = tech.annotation_as_string("ui_label");
-				if (label.empty())
-					label = tech.name;
+				technique &tech = _techniques[technique_index];
 
-				tech.hidden = tech.annotation_as_int("hidden") != 0 || !(string_contains(label, _effect_filter) || string_contains(_effects[tech.effect_index].source_file.filename().u8string(), _effect_filter));
+				// Matches are sorted, so can walk them alongside the techniques
+				const bool is_match = match < matches.size() && matches[match] == technique_index;
+				if (is_match)
+					match++;
+
+				tech.hidden = tech.annotation_as_int("hidden") != 0 || !is_match;
 			}
 		}
 
@@ -2153,6 +2443,7 @@ void reshade::runtime::draw_gui_settings()
 
 			modified |= imgui::key_input_box(_("Overlay key"), _overlay_key_data, *_input);
 			modified |= imgui::key_input_box("NFS HUD toggle key", _toggle_fe_key_data, *_input);
+			modified |= imgui::key_input_box("NFS benchmark key", _nfs_benchmark_key_data, *_input);
 
 			modified |= imgui::key_input_box(_("Effect toggle key"), _effects_key_data, *_input);
 			modified |= imgui::key_input_box(_("Effect reload key"), _reload_key_data, *_input);
@@ -2181,6 +2472,9 @@ void reshade::runtime::draw_gui_settings()
 		modified |= imgui::path_list(_("Texture search paths"), _texture_search_paths, _file_selection_path, g_reshade_base_path);
 		ImGui::SetItemTooltip(_("List of directory paths to be searched for image files used as source for textures.\nPaths that end in \"\\**\" are searched recursively."));
 
+		modified |= ImGui::Checkbox("Reload modified files automatically", &_auto_reload_on_file_change);
+		ImGui::SetItemTooltip("Watch the search paths and reload only the effects and textures that depend on a file after it was saved.");
+
 		if (ImGui::Checkbox(_("Load only enabled effects"), &_effect_load_skipping))
 		{
 			modified = true;
@@ -2189,6 +2483,17 @@ void reshade::runtime::draw_gui_settings()
 			reload_effects(!_effect_load_skipping);
 		}
 
+		modified |= ImGui::SliderInt(_("Memory budget"), reinterpret_cast<int *>(&_memory_budget), 0, 2048, _memory_budget == 0 ? _("Unlimited") : "%d MiB", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::SetItemTooltip(_("Upper limit for the estimated memory used by effects.\nEffects that would exceed it are not enabled and unused effect permutations are released."));
+
+		modified |= ImGui::Checkbox(_("Adaptive performance mode"), &_adaptive_performance_mode);
+		ImGui::SetItemTooltip(_("Recompile effects with their current values baked in as constants after they were not changed for a while.\nChanging a baked value switches the effect back to the editable version."));
+		if (_adaptive_performance_mode)
+		{
+			modified |= ImGui::SliderInt(_("Adaptive performance mode delay"), reinterpret_cast<int *>(&_adaptive_performance_mode_delay), 1, 60, "%d s", ImGuiSliderFlags_AlwaysClamp);
+			ImGui::SetItemTooltip(_("Time in seconds the values of an effect have to stay unchanged before it is recompiled."));
+		}
+
 		if (ImGui::Button(_("Clear effect cache"), ImVec2(ImGui::CalcItemWidth(), 0)))
 			clear_effect_cache();
 		ImGui::SetItemTooltip(_("Clear effect cache located in \"%s\"."), _effect_cache_path.u8string().c_str());
@@ -2199,6 +2504,10 @@ void reshade::runtime::draw_gui_settings()
 		if (_input != nullptr)
 		{
 			modified |= imgui::key_input_box(_("Screenshot key"), _screenshot_key_data, *_input);
+			modified |= imgui::key_input_box(_("Screenshot burst key"), _screenshot_burst_key_data, *_input);
+			ImGui::SetItemTooltip(_("Captures a sequence of screenshots for the configured duration. Press again to stop early."));
+			modified |= imgui::key_input_box(_("NFS offline capture key"), _nfs_capture_key_data, *_input);
+			ImGui::SetItemTooltip(_("Starts or stops saving every frame while the game speed is adjusted so that each frame advances the game by exactly one frame of the capture rate."));
 		}
 
 		modified |= imgui::directory_input_box(_("Screenshot path"), _screenshot_path, _file_selection_path);
@@ -2257,6 +2566,29 @@ void reshade::runtime::draw_gui_settings()
 		modified |= ImGui::Checkbox(_("Save before and after images"), &_screenshot_save_before);
 		modified |= ImGui::Checkbox(_("Save separate image with the overlay visible"), &_screenshot_save_gui);
 		modified |= ImGui::Checkbox(_("NFS HUD on screenshot"), &_screenshot_nfs_hud);
+		modified |= ImGui::Checkbox(_("Save images with and without the NFS HUD"), &_screenshot_nfs_hud_variants);
+		ImGui::SetItemTooltip(_("Captures the image without the HUD right before the game draws its frontend and the one with the HUD at present, so that both show the same frame.\nOnly works in games where effects are rendered before the frontend, otherwise a single image with the HUD is saved."));
+
+		modified |= ImGui::SliderInt(_("Burst duration"), reinterpret_cast<int *>(&_screenshot_burst_duration), 100, 60000, "%d ms", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderInt(_("Burst interval"), reinterpret_cast<int *>(&_screenshot_burst_interval), 1, 60, "Every %d frame(s)", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderInt(_("Burst queue size"), reinterpret_cast<int *>(&_screenshot_burst_queue_size), 1, 64, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::SetItemTooltip(_("Maximum number of burst frames waiting to be encoded. Frames captured while the queue is full are dropped instead of stalling the game."));
+
+		modified |= ImGui::SliderInt(_("NFS capture rate"), reinterpret_cast<int *>(&_nfs_capture_fps), 24, 240, "%d fps", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::SetItemTooltip(_("Frame rate of the footage saved by the offline capture. Rendering runs as fast as it can, with the simulation slowed down to match, and frames are never dropped."));
+		if (ImGui::Button(_nfs_capture_active ? _("Stop NFS offline capture") : _("Start NFS offline capture"), ImVec2(ImGui::CalcItemWidth(), 0)))
+		{
+			if (_nfs_capture_active)
+				stop_nfs_offline_capture();
+			else
+				start_nfs_offline_capture();
+		}
+		if (_nfs_capture_active)
+		{
+			ImGui::SameLine(0, ImGui::GetStyle().ItemInnerSpacing.x);
+			ImGui::Text("%u frame(s)", _nfs_capture_frame_count);
+		}
+
 		modified |= imgui::file_input_box(_("Screenshot sound"), "sound.wav", _screenshot_sound_path, _file_selection_path, { L".wav" });
 		ImGui::SetItemTooltip(_("Audio file that is played when taking a screenshot."));
 
@@ -2578,6 +2910,33 @@ void reshade::runtime::draw_gui_statistics()
 		}
 	}
 
+	// Record unsmoothed samples of the frame that was just presented
+	{
+		frame_history_sample &sample = _frame_history[_frame_history_index];
+		sample.frame_time = _last_frame_duration.count() * 1e-6f;
+
+		const size_t history_index = (_present_stage_history_index + PRESENT_STAGE_HISTORY_SIZE - 1) % PRESENT_STAGE_HISTORY_SIZE;
+		uint64_t reshade_cpu_time = 0;
+		for (size_t stage = 0; stage < static_cast<size_t>(api::present_stage::count); ++stage)
+			reshade_cpu_time += _present_stage_durations[stage][history_index];
+		sample.reshade_cpu_time = reshade_cpu_time * 1e-6f;
+
+		uint64_t reshade_gpu_time = 0;
+		if (!is_loading() && _effects_enabled)
+			for (const technique &tech : _techniques)
+				if (tech.enabled)
+					reshade_gpu_time += tech.average_gpu_duration.last();
+		sample.reshade_gpu_time = reshade_gpu_time * 1e-6f;
+
+		// Memory usage cannot be queried while effects are loading, so keep the previous value during that time
+		sample.memory_size = !is_loading() ? get_total_memory_usage() / (1024.0f * 1024.0f) :
+			_frame_history[(_frame_history_index + FRAME_HISTORY_SIZE - 1) % FRAME_HISTORY_SIZE].memory_size;
+		sample.stream_time = _nfs_stream_time;
+
+		_frame_history_index = (_frame_history_index + 1) % FRAME_HISTORY_SIZE;
+		_frame_history_count = std::min(_frame_history_count + 1, FRAME_HISTORY_SIZE);
+	}
+
 	if (ImGui::CollapsingHeader(_("General"), ImGuiTreeNodeFlags_DefaultOpen))
 	{
 		_gather_gpu_statistics = true;
@@ -2603,6 +2962,8 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::TextUnformatted(_("Resolution:"));
 		ImGui::Text(_("Frame %llu:"), _frame_count + 1);
 		ImGui::TextUnformatted(_("Post-Processing:"));
+		if (_max_queued_frames != 0)
+			ImGui::TextUnformatted(_("Queued frames:"));
 
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
@@ -2641,6 +3002,8 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("%ux%u", _effect_permutations[0].width, _effect_permutations[0].height);
 		ImGui::Text("%.2f fps", _imgui_context->IO.Framerate);
 		ImGui::Text("%*.3f ms CPU", cpu_digits + 4, post_processing_time_cpu * 1e-6f);
+		if (_max_queued_frames != 0)
+			ImGui::Text("%u of %u", _queued_frames, _max_queued_frames);
 
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
@@ -2657,10 +3020,88 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text("%*.3f ms", gpu_digits + 4, _last_frame_duration.count() * 1e-6f);
 		if (_gather_gpu_statistics && post_processing_time_gpu != 0)
 			ImGui::Text("%*.3f ms GPU", gpu_digits + 4, (post_processing_time_gpu * 1e-6f));
+		else if (_max_queued_frames != 0)
+			ImGui::NewLine();
+		if (_max_queued_frames != 0)
+			ImGui::Text("%*.3f ms waited", gpu_digits + 4, _frame_latency_wait_time * 1e-6f);
 
 		ImGui::EndGroup();
 	}
 
+	if (ImGui::CollapsingHeader("ReShade CPU Time", ImGuiTreeNodeFlags_None))
+	{
+		static const char *const stage_names[] = {
+			"Capture State",
+			"Resolve/Copy",
+			"Update Effects",
+			"Render Effects",
+			"Screenshot",
+			"Overlay",
+			"Apply State",
+		};
+		static_assert(std::size(stage_names) == static_cast<size_t>(api::present_stage::count));
+
+		if (ImGui::BeginTable("##present_stages", 5, ImGuiTableFlags_SizingStretchSame))
+		{
+			ImGui::TableSetupColumn("Stage");
+			ImGui::TableSetupColumn("Last");
+			ImGui::TableSetupColumn("Min");
+			ImGui::TableSetupColumn("Average");
+			ImGui::TableSetupColumn("99th");
+			ImGui::TableHeadersRow();
+
+			uint64_t total[4] = {};
+
+			for (size_t stage = 0; stage < static_cast<size_t>(api::present_stage::count); ++stage)
+			{
+				api::present_stage_statistics stats;
+				if (!get_present_stage_statistics(static_cast<api::present_stage>(stage), &stats))
+					continue;
+
+				total[0] += stats.last;
+				total[1] += stats.min;
+				total[2] += stats.average;
+				total[3] += stats.p99;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(stage_names[stage]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f ms", stats.last * 1e-6f);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f ms", stats.min * 1e-6f);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f ms", stats.average * 1e-6f);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f ms", stats.p99 * 1e-6f);
+			}
+
+			// Sum of the per-stage values (the sum of percentiles is an upper bound, not the percentile of the sum)
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("Total");
+			for (const uint64_t value : total)
+			{
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f ms", value * 1e-6f);
+			}
+
+			ImGui::EndTable();
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Frame History", ImGuiTreeNodeFlags_None))
+	{
+		_gather_gpu_statistics = true;
+
+		draw_gui_statistics_history();
+	}
+
+	if (ImGui::CollapsingHeader("Load Times", ImGuiTreeNodeFlags_None))
+	{
+		draw_gui_statistics_load_times();
+	}
+
 	if (ImGui::CollapsingHeader(_("Techniques"), ImGuiTreeNodeFlags_DefaultOpen) && !is_loading() && _effects_enabled)
 	{
 		// Only need to gather GPU statistics if the statistics are actually visible
@@ -2722,12 +3163,114 @@ void reshade::runtime::draw_gui_statistics()
 
 			// GPU timings are not available for all APIs
 			if (_gather_gpu_statistics && tech.average_gpu_duration != 0)
+			{
 				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, tech.average_gpu_duration * 1e-6f);
+
+				if (ImGui::BeginItemTooltip())
+				{
+					float histogram[reshade::technique::GPU_DURATION_HISTOGRAM_SIZE];
+					for (uint32_t i = 0; i < reshade::technique::GPU_DURATION_HISTOGRAM_SIZE; ++i)
+						histogram[i] = static_cast<float>(tech.gpu_duration_histogram[i]);
+
+					ImGui::TextUnformatted("GPU time distribution (1 us to 16 ms, logarithmic)");
+					ImGui::PlotHistogram("##gpu_duration_histogram", histogram, static_cast<int>(reshade::technique::GPU_DURATION_HISTOGRAM_SIZE), 0, nullptr, 0.0f, FLT_MAX, ImVec2(300.0f, 60.0f));
+					ImGui::Text("%u frames in flight", tech.query_ring_depth);
+					ImGui::EndTooltip();
+				}
+			}
 			else
+			{
 				ImGui::NewLine();
+			}
 		}
 
 		ImGui::EndGroup();
+
+		ImGui::Spacing();
+
+		if (ImGui::Checkbox(_("Measure GPU time of individual passes"), &_gather_pass_gpu_statistics))
+			save_config();
+		ImGui::SetItemTooltip(_("Adds a timestamp after every pass, which makes the timings more detailed, at the cost of some GPU time by itself."));
+
+		if (_gather_pass_gpu_statistics)
+		{
+			for (size_t technique_index : _technique_sorting)
+			{
+				const reshade::technique &tech = _techniques[technique_index];
+
+				if (!tech.enabled || tech.average_pass_gpu_durations.empty())
+					continue;
+
+				ImGui::PushID(static_cast<int>(technique_index));
+
+				if (ImGui::TreeNodeEx(tech.name.c_str(), ImGuiTreeNodeFlags_SpanAvailWidth))
+				{
+					for (size_t pass_index = 0; pass_index < tech.average_pass_gpu_durations.size(); ++pass_index)
+					{
+						const std::string &pass_name = tech.permutations[0].passes[pass_index].name;
+						if (pass_name.empty())
+							ImGui::Text("pass %zu", pass_index);
+						else
+							ImGui::TextUnformatted(pass_name.c_str(), pass_name.c_str() + pass_name.size());
+
+						ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+
+						if (tech.average_pass_gpu_durations[pass_index] != 0)
+							ImGui::Text("%*.3f ms GPU", gpu_digits + 4, tech.average_pass_gpu_durations[pass_index] * 1e-6f);
+						else
+							ImGui::TextUnformatted("-");
+					}
+
+					ImGui::TreePop();
+				}
+
+				ImGui::PopID();
+			}
+		}
+	}
+
+	if (ImGui::CollapsingHeader(_("Memory"), ImGuiTreeNodeFlags_DefaultOpen) && !is_loading())
+	{
+		const uint64_t total_memory_usage = get_total_memory_usage();
+		uint64_t effect_memory_usage = 0;
+
+		if (ImGui::BeginTable("##memory", 3, ImGuiTableFlags_BordersInnerH | ImGuiTableFlags_SizingStretchProp))
+		{
+			ImGui::TableSetupColumn(_("Effect"));
+			ImGui::TableSetupColumn(_("System memory"));
+			ImGui::TableSetupColumn(_("Video memory"));
+			ImGui::TableHeadersRow();
+
+			for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+			{
+				const uint64_t cpu_memory_usage = get_effect_cpu_memory_usage(effect_index);
+				const uint64_t gpu_memory_usage = get_effect_gpu_memory_usage(effect_index);
+				effect_memory_usage += cpu_memory_usage + gpu_memory_usage;
+
+				if (!_effects[effect_index].rendering && gpu_memory_usage == 0)
+					continue;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(_effects[effect_index].source_file.filename().u8string().c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f MiB", cpu_memory_usage / (1024.0 * 1024.0));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f MiB", gpu_memory_usage / (1024.0 * 1024.0));
+			}
+
+			ImGui::EndTable();
+		}
+
+		ImGui::Text(_("Effect permutations: %.3f MiB"), (total_memory_usage - effect_memory_usage) / (1024.0 * 1024.0));
+
+		if (_memory_budget != 0)
+			ImGui::Text(_("Total estimated usage: %.3f MiB of %u MiB budget"), total_memory_usage / (1024.0 * 1024.0), _memory_budget);
+		else
+			ImGui::Text(_("Total estimated usage: %.3f MiB"), total_memory_usage / (1024.0 * 1024.0));
+
+		if (_memory_budget_exceeded)
+			ImGui::TextColored(COLOR_YELLOW, _("Some techniques were not enabled, because they would have exceeded the memory budget."));
 	}
 
 	if (ImGui::CollapsingHeader(_("Render Targets & Textures"), ImGuiTreeNodeFlags_DefaultOpen) && !is_loading())
@@ -2736,10 +3279,6 @@ void reshade::runtime::draw_gui_statistics()
 			"unknown",
 			"R8", "R16", "R16F", "R32I", "R32U", "R32F", "RG8", "RG16", "RG16F", "RG32F", "RGBA8", "RGBA16", "RGBA16F", "RGBA32I", "RGBA32U", "RGBA32F", "RGB10A2"
 		};
-		static constexpr uint32_t pixel_sizes[] = {
-			0,
-			1 /*R8*/, 2 /*R16*/, 2 /*R16F*/, 4 /*R32I*/, 4 /*R32U*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32I*/, 16 /*RGBA32U*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
-		};
 
 		static_assert((std::size(texture_formats) - 1) == static_cast<size_t>(reshadefx::texture_format::rgb10a2));
 
@@ -2763,9 +3302,7 @@ void reshade::runtime::draw_gui_statistics()
 			ImGui::PushID(texture_index);
 			ImGui::BeginGroup();
 
-			int64_t memory_size = 0;
-			for (uint32_t level = 0, width = tex.width, height = tex.height, depth = tex.depth; level < tex.levels; ++level, width /= 2, height /= 2, depth /= 2)
-				memory_size += static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(depth) * pixel_sizes[static_cast<int>(tex.format)];
+			const int64_t memory_size = static_cast<int64_t>(tex.memory_size());
 
 			post_processing_memory_size += memory_size;
 
@@ -2864,7 +3401,7 @@ void reshade::runtime::draw_gui_statistics()
 			}
 
 			const bool supports_saving =
-				tex.type != reshadefx::texture_type::texture_3d && (
+				tex.type != reshadefx::texture_type::texture_3d && tex.compressed_format == api::format::unknown && (
 				tex.format == reshadefx::texture_format::r8 ||
 				tex.format == reshadefx::texture_format::rg8 ||
 				tex.format == reshadefx::texture_format::rgba8 ||
@@ -2986,17 +3523,296 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::Text(_("Total memory usage: %lld.%03lld %s"), memory_view.quot, memory_view.rem, memory_size_unit);
 	}
 }
-void reshade::runtime::draw_gui_log()
+void reshade::runtime::draw_gui_statistics_history()
 {
-	std::error_code ec;
-	std::filesystem::path log_path = global_config().path();
-	log_path.replace_extension(L".log");
+	if (_frame_history_count == 0)
+		return;
 
-	const bool filter_changed = imgui::search_input_box(_log_filter, sizeof(_log_filter), -(16.0f * _font_size + 2 * _imgui_context->Style.ItemSpacing.x));
+	const int count = static_cast<int>(_frame_history_count);
+	// Oldest sample is at the current write position once the ring buffer has wrapped around
+	const int offset = _frame_history_count == FRAME_HISTORY_SIZE ? static_cast<int>(_frame_history_index) : 0;
+
+	struct
+	{
+		const char *name;
+		const char *unit;
+		float frame_history_sample::*member;
+		float p50, p95, p99, max;
+	} series[] = {
+		{ "Frame time", "ms", &frame_history_sample::frame_time },
+		{ "ReShade CPU", "ms", &frame_history_sample::reshade_cpu_time },
+		{ "ReShade GPU", "ms", &frame_history_sample::reshade_gpu_time },
+		{ "Memory", "MiB", &frame_history_sample::memory_size },
+		{ "World streaming", "ms", &frame_history_sample::stream_time },
+	};
 
-	ImGui::SameLine();
+	std::vector<float> sorted(_frame_history_count);
+	for (auto &s : series)
+	{
+		for (size_t i = 0; i < _frame_history_count; ++i)
+			sorted[i] = _frame_history[i].*s.member;
+		std::sort(sorted.begin(), sorted.end());
 
-	imgui::toggle_button(_("Word Wrap"), _log_wordwrap, 8.0f * _font_size);
+		s.p50 = sorted[(_frame_history_count * 50) / 100];
+		s.p95 = sorted[(_frame_history_count * 95) / 100];
+		s.p99 = sorted[(_frame_history_count * 99) / 100];
+		s.max = sorted.back();
+	}
+
+	// Plot the frame time and mark every frame that took more than twice the median, since those are perceived as stutter
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::PlotLines("##frame_time_history",
+		&_frame_history[0].frame_time, count, offset, "Frame time (ms)", 0.0f, std::max(series[0].max, 2.0f * series[0].p50) * 1.1f, ImVec2(0, 80), sizeof(frame_history_sample));
+
+	const ImVec2 plot_min = ImGui::GetItemRectMin() + _imgui_context->Style.FramePadding;
+	const ImVec2 plot_max = ImGui::GetItemRectMax() - _imgui_context->Style.FramePadding;
+	const float spike_threshold = 2.0f * series[0].p50;
+	unsigned int spike_count = 0;
+	unsigned int stream_spike_count = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const frame_history_sample &sample = _frame_history[(offset + i) % FRAME_HISTORY_SIZE];
+		if (sample.frame_time <= spike_threshold)
+			continue;
+
+		// Spikes in frames during which the game was streaming the world are marked differently, since they are caused by the game (or storage) rather than rendering
+		const bool streaming = sample.stream_time > 0.0f;
+
+		const float x = plot_min.x + (plot_max.x - plot_min.x) * (count > 1 ? static_cast<float>(i) / (count - 1) : 0.0f);
+		ImGui::GetWindowDrawList()->AddLine(ImVec2(x, plot_min.y), ImVec2(x, plot_max.y), ImGui::GetColorU32(streaming ? COLOR_YELLOW : COLOR_RED), 1.0f);
+		spike_count++;
+		stream_spike_count += streaming ? 1 : 0;
+	}
+
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::PlotLines("##gpu_time_history",
+		&_frame_history[0].reshade_gpu_time, count, offset, "ReShade GPU (ms)", 0.0f, FLT_MAX, ImVec2(0, 50), sizeof(frame_history_sample));
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::PlotLines("##memory_history",
+		&_frame_history[0].memory_size, count, offset, "Memory (MiB)", FLT_MAX, FLT_MAX, ImVec2(0, 30), sizeof(frame_history_sample));
+
+	ImGui::Text("%d frames, %u spike(s) above %.3f ms, %u of them while streaming the world", count, spike_count, spike_threshold, stream_spike_count);
+
+	if (ImGui::BeginTable("##frame_history", 5, ImGuiTableFlags_SizingStretchSame))
+	{
+		ImGui::TableSetupColumn("Metric");
+		ImGui::TableSetupColumn("50th");
+		ImGui::TableSetupColumn("95th");
+		ImGui::TableSetupColumn("99th");
+		ImGui::TableSetupColumn("Max");
+		ImGui::TableHeadersRow();
+
+		for (const auto &s : series)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(s.name);
+			for (const float value : { s.p50, s.p95, s.p99, s.max })
+			{
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f %s", value, s.unit);
+			}
+		}
+
+		// Per-technique percentiles are taken from the window of the moving average, which is much shorter than the frame history
+		if (!is_loading() && _effects_enabled)
+		{
+			for (size_t technique_index : _technique_sorting)
+			{
+				const reshade::technique &tech = _techniques[technique_index];
+
+				if (!tech.enabled || tech.average_gpu_duration == 0)
+					continue;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(tech.name.c_str(), tech.name.c_str() + tech.name.size());
+				for (const unsigned int percent : { 50u, 95u, 99u, 100u })
+				{
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f ms", tech.average_gpu_duration.percentile(percent) * 1e-6f);
+				}
+			}
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button(_("Export as CSV"), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+		save_frame_history();
+}
+bool reshade::runtime::save_frame_history() const
+{
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path csv_path = g_reshade_base_path / std::filesystem::u8path(std::string("ReShade Frame History ") + timestamp + ".csv");
+
+	FILE *const csv_file = _wfsopen(csv_path.c_str(), L"w", SH_DENYWR);
+	if (csv_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write frame history to '%s'!", csv_path.u8string().c_str());
+		return false;
+	}
+
+	const size_t offset = _frame_history_count == FRAME_HISTORY_SIZE ? _frame_history_index : 0;
+
+	std::fputs("frame,frame_time_ms,reshade_cpu_ms,reshade_gpu_ms,memory_mib,stream_ms\n", csv_file);
+	for (size_t i = 0; i < _frame_history_count; ++i)
+	{
+		const frame_history_sample &sample = _frame_history[(offset + i) % FRAME_HISTORY_SIZE];
+		std::fprintf(csv_file, "%zu,%.4f,%.4f,%.4f,%.2f,%.4f\n", i, sample.frame_time, sample.reshade_cpu_time, sample.reshade_gpu_time, sample.memory_size, sample.stream_time);
+	}
+	std::fclose(csv_file);
+
+	log::message(log::level::info, "Saved frame history of %zu frame(s) to '%s'.", _frame_history_count, csv_path.u8string().c_str());
+
+	return true;
+}
+void reshade::runtime::draw_gui_statistics_load_times()
+{
+	ImGui::Text("Current state: %s for %.1f ms", _nfs_load_current.state_name != nullptr ? _nfs_load_current.state_name : "NONE",
+		_nfs_load_current.state >= 0 ? std::chrono::duration<float, std::milli>(_last_present_time - _nfs_load_current.start_time).count() : 0.0f);
+
+	if (_nfs_load_history_count == 0)
+	{
+		ImGui::TextUnformatted("No game flow transitions recorded yet.");
+		return;
+	}
+
+	const size_t offset = _nfs_load_history_count == NFS_LOAD_HISTORY_SIZE ? _nfs_load_history_index : 0;
+
+	// Summary per state, to compare how long each kind of load screen takes on average
+	if (ImGui::BeginTable("##load_time_summary", 6, ImGuiTableFlags_SizingStretchSame))
+	{
+		ImGui::TableSetupColumn("State");
+		ImGui::TableSetupColumn("Count");
+		ImGui::TableSetupColumn("Last");
+		ImGui::TableSetupColumn("Average");
+		ImGui::TableSetupColumn("Min");
+		ImGui::TableSetupColumn("Max");
+		ImGui::TableHeadersRow();
+
+		for (int state = 0; state < 32; ++state)
+		{
+			const char *state_name = nullptr;
+			uint32_t count = 0;
+			float last = 0.0f, total = 0.0f, min = FLT_MAX, max = 0.0f;
+
+			for (size_t i = 0; i < _nfs_load_history_count; ++i)
+			{
+				const nfs_load_record &record = _nfs_load_history[(offset + i) % NFS_LOAD_HISTORY_SIZE];
+				if (record.state != state)
+					continue;
+
+				state_name = record.state_name;
+				count++;
+				last = record.duration;
+				total += record.duration;
+				min = std::min(min, record.duration);
+				max = std::max(max, record.duration);
+			}
+
+			if (count == 0)
+				continue;
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(state_name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", count);
+			for (const float value : { last, total / count, min, max })
+			{
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f ms", value);
+			}
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::Spacing();
+
+	// Most recent transitions first
+	if (ImGui::BeginTable("##load_time_history", 6, ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_ScrollY, ImVec2(0, 10 * ImGui::GetTextLineHeightWithSpacing())))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("State");
+		ImGui::TableSetupColumn("Duration");
+		ImGui::TableSetupColumn("Frames");
+		ImGui::TableSetupColumn("Effect Loading");
+		ImGui::TableSetupColumn("Texture Loading");
+		ImGui::TableSetupColumn("World Streaming");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = _nfs_load_history_count; i-- > 0;)
+		{
+			const nfs_load_record &record = _nfs_load_history[(offset + i) % NFS_LOAD_HISTORY_SIZE];
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(record.state_name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f ms", record.duration);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", record.frame_count);
+			for (const float value : { record.effect_load_time, record.texture_load_time, record.stream_time })
+			{
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f ms", value);
+			}
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("Export load times as CSV", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+		save_nfs_load_history();
+}
+bool reshade::runtime::save_nfs_load_history() const
+{
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path csv_path = g_reshade_base_path / std::filesystem::u8path(std::string("ReShade Load Times ") + timestamp + ".csv");
+
+	FILE *const csv_file = _wfsopen(csv_path.c_str(), L"w", SH_DENYWR);
+	if (csv_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write load times to '%s'!", csv_path.u8string().c_str());
+		return false;
+	}
+
+	const size_t offset = _nfs_load_history_count == NFS_LOAD_HISTORY_SIZE ? _nfs_load_history_index : 0;
+
+	std::fputs("state,duration_ms,frames,effect_load_ms,texture_load_ms,stream_ms\n", csv_file);
+	for (size_t i = 0; i < _nfs_load_history_count; ++i)
+	{
+		const nfs_load_record &record = _nfs_load_history[(offset + i) % NFS_LOAD_HISTORY_SIZE];
+		std::fprintf(csv_file, "%s,%.2f,%u,%.2f,%.2f,%.2f\n", record.state_name, record.duration, record.frame_count, record.effect_load_time, record.texture_load_time, record.stream_time);
+	}
+	std::fclose(csv_file);
+
+	log::message(log::level::info, "Saved %zu game flow state transition(s) to '%s'.", _nfs_load_history_count, csv_path.u8string().c_str());
+
+	return true;
+}
+void reshade::runtime::draw_gui_log()
+{
+	std::error_code ec;
+	std::filesystem::path log_path = global_config().path();
+	log_path.replace_extension(L".log");
+
+	const bool filter_changed = imgui::search_input_box(_log_filter, sizeof(_log_filter), -(16.0f * _font_size + 2 * _imgui_context->Style.ItemSpacing.x));
+
+	ImGui::SameLine();
+
+	imgui::toggle_button(_("Word Wrap"), _log_wordwrap, 8.0f * _font_size);
 
 	ImGui::SameLine();
 
@@ -3008,17 +3824,37 @@ void reshade::runtime::draw_gui_log()
 
 	if (ImGui::BeginChild("##log", ImVec2(0, -(ImGui::GetFrameHeightWithSpacing() + _imgui_context->Style.ItemSpacing.y)), ImGuiChildFlags_Borders, _log_wordwrap ? 0 : ImGuiWindowFlags_AlwaysHorizontalScrollbar))
 	{
+		// Only keep the most recent lines, so that memory usage does not keep growing with the log file
+		constexpr size_t max_log_lines = 10000;
+
 		const uintmax_t file_size = std::filesystem::file_size(log_path, ec);
 		if (filter_changed || _last_log_size != file_size)
 		{
-			_log_lines.clear();
+			// Only read what was appended since the last time, unless the filter changed or the log file was cleared
+			const bool append = !filter_changed && file_size > _last_log_size;
+			if (!append)
+			{
+				_log_lines.clear();
+				_last_log_offset = 0;
+			}
 
 			if (FILE *const file = _wfsopen(log_path.c_str(), L"r", SH_DENYNO))
 			{
+				if (append)
+					fseek(file, _last_log_offset, SEEK_SET);
+
 				char line_data[2048];
 				while (fgets(line_data, sizeof(line_data), file))
+				{
 					if (string_contains(line_data, _log_filter))
+					{
+						if (_log_lines.size() == max_log_lines)
+							_log_lines.pop_front();
 						_log_lines.push_back(line_data);
+					}
+				}
+
+				_last_log_offset = ftell(file);
 
 				fclose(file);
 			}
@@ -3491,6 +4327,110 @@ void FlipCar()
 }
 #endif
 
+#ifdef VEHICLE_LISTABLESET_SIZE_OFFSET
+// Fills the position and orientation of up to 'max_count' active vehicles and returns the total number of them, with the address of each vehicle as its ID
+uint32_t GetNFSVehicles(reshade::api::nfs_vehicle* vehicles, uintptr_t* ids, uint32_t max_count)
+{
+	const int* VehicleTable = *(int**)VEHICLE_LISTABLESET_ADDR;
+	const uint32_t VehicleCapacity = *(uint32_t*)(VEHICLE_LISTABLESET_ADDR + VEHICLE_LISTABLESET_CAPACITY_OFFSET);
+	const uint32_t VehicleCount = *(uint32_t*)(VEHICLE_LISTABLESET_ADDR + VEHICLE_LISTABLESET_SIZE_OFFSET);
+
+	// The table is not set up before the game finished loading
+	if (VehicleTable == NULL || VehicleCount > VehicleCapacity)
+		return 0;
+
+	uint32_t Count = 0;
+	for (uint32_t i = 0; i < VehicleCount; ++i)
+	{
+		const int Vehicle = VehicleTable[i];
+		if (!Vehicle)
+			continue;
+
+		const int RigidBodyInstance = UTL_IList_Find(*(void**)(Vehicle + 4), (void*)IRIGIDBODY_HANDLE_ADDR);
+		if (!RigidBodyInstance)
+			continue;
+		// Only count the vehicles that do not fit anymore
+		if (Count >= max_count)
+		{
+			Count++;
+			continue;
+		}
+
+		bMatrix4 result = { 0 };
+		const int RigidBodyVtable = *(int*)(RigidBodyInstance);
+#ifdef GAME_UC
+		bMatrix4*(__thiscall * RigidBody_GetMatrix4)(void* dis);
+		RigidBody_GetMatrix4 = (bMatrix4*(__thiscall*)(void*)) * (int*)(RigidBodyVtable + RB_GETMATRIX4_OFFSET);
+		memcpy(&result, RigidBody_GetMatrix4((void*)RigidBodyInstance), 0x40);
+#else
+		int(__thiscall * RigidBody_GetMatrix4)(void* dis, bMatrix4* dest);
+		RigidBody_GetMatrix4 = (int(__thiscall*)(void*, bMatrix4*)) * (int*)(RigidBodyVtable + RB_GETMATRIX4_OFFSET);
+		RigidBody_GetMatrix4((void*)RigidBodyInstance, &result);
+#endif
+
+		reshade::api::nfs_vehicle& vehicle = vehicles[Count];
+		const bVector4* rows[3] = { &result.v0, &result.v1, &result.v2 };
+		for (int k = 0; k < 3; ++k)
+		{
+			vehicle.orientation[k][0] = rows[k]->x;
+			vehicle.orientation[k][1] = rows[k]->y;
+			vehicle.orientation[k][2] = rows[k]->z;
+		}
+		vehicle.position[0] = result.v3.x;
+		vehicle.position[1] = result.v3.y;
+		vehicle.position[2] = result.v3.z;
+		vehicle.speed = 0.0f;
+
+		ids[Count++] = Vehicle;
+	}
+
+	return Count;
+}
+#endif
+
+#ifdef SIM_SETSTREAM_ADDR
+// Both of these are hooked at their entry, so that calls from the game itself and from the teleport and prefetch tools are timed alike
+static void RecordStreamEvent(uint32_t function, const LARGE_INTEGER& start, bool blocking, const float position[3])
+{
+	LARGE_INTEGER end, frequency;
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+
+	reshade::telemetry_block::stream_event event = {};
+	event.timestamp = start.QuadPart;
+	event.duration = static_cast<float>(static_cast<double>(end.QuadPart - start.QuadPart) * 1000.0 / static_cast<double>(frequency.QuadPart));
+	event.function = function;
+	event.blocking = blocking ? 1 : 0;
+	if (position != NULL)
+		memcpy(event.position, position, sizeof(event.position));
+
+	reshade::runtime::record_nfs_stream_event(event);
+}
+
+void __cdecl Sim_SetStream_Hook(bVector3* location, bool blocking)
+{
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+
+	reshade::hooks::call(Sim_SetStream_Hook)(location, blocking);
+
+	RecordStreamEvent(reshade::telemetry_block::stream_event::SIM_SET_STREAM, start, blocking, reinterpret_cast<const float*>(location));
+}
+
+void __fastcall GameFlowManager_LoadRegion_Hook(void* dis, void* edx)
+{
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+
+	reshade::hooks::call(GameFlowManager_LoadRegion_Hook)(dis, edx);
+
+	// Region loads always block the game until they are done
+	reshade::api::nfs_vehicle Vehicle = {};
+	uintptr_t VehicleId = 0;
+	RecordStreamEvent(reshade::telemetry_block::stream_event::LOAD_REGION, start, true, GetNFSVehicles(&Vehicle, &VehicleId, 1) != 0 ? Vehicle.position : NULL);
+}
+#endif
+
 // overlay switch stuff that is only found in newer NFS games...
 #ifndef GAME_UC
 void(__thiscall* cFEng_QueuePackagePop)(void* dis, int num_to_pop) = (void(__thiscall*)(void*, int))FENG_QUEUEPACKAGEPOP_ADDR;
@@ -3621,9 +4561,95 @@ int FeCarPosition = 0;
 
 #endif
 
+void __stdcall JumpToNewPosPropagator(bVector3* pos);
+
+// Teleports are done in two phases: The target is first streamed in without blocking, and the player is only moved there once the world around it is resident
+// There is no known address for the state of the track streamer, so residency is detected through the world collision at the target, which is streamed in together with the track sections
+enum TeleportPrefetchState
+{
+	TELEPORT_PREFETCH_IDLE,
+	TELEPORT_PREFETCH_STREAMING,
+	TELEPORT_PREFETCH_RESIDENT, // Target was prefetched without moving the player
+};
+
+bool bTelePrefetch = true;
+float TelePrefetchTimeout = 10.0f; // Seconds after which the teleport falls back to a blocking stream
+
+// Written on the thread that updates the world (see 'ServiceTeleportPrefetch'), but also read by the overlay
+std::atomic<int> TelePrefetchState = TELEPORT_PREFETCH_IDLE;
+std::atomic<float> TelePrefetchElapsed = 0.0f;
+bVector3 TelePrefetchPos = { 0 };
+bool bTelePrefetchMovePlayer = false;
+bool bTelePrefetchFloorSnap = false;
+std::chrono::steady_clock::time_point TelePrefetchStartTime;
+
+bool IsWorldResidentAt(const bVector3* pos)
+{
+	bVector3 SimPos = { -(*pos).y, (*pos).z, (*pos).x }; // Simables have coordinates in this format...
+	float Height = (*pos).z;
+	char WCollisionMgrSpace[0x20] = { 0 };
+
+	return WCollisionMgr_GetWorldHeightAtPointRigorous(WCollisionMgrSpace, &SimPos, &Height, NULL);
+}
+
+void BeginTeleportPrefetch(const bVector3* pos, bool move_player, bool floor_snap)
+{
+	bVector3 SimPos = { -(*pos).y, (*pos).z, (*pos).x };
+
+	memcpy(&TelePrefetchPos, pos, sizeof(bVector3));
+	bTelePrefetchMovePlayer = move_player;
+	bTelePrefetchFloorSnap = floor_snap;
+	TelePrefetchStartTime = std::chrono::steady_clock::now();
+	TelePrefetchElapsed.store(0.0f, std::memory_order_relaxed);
+
+	Sim_SetStream(&SimPos, false);
+
+	TelePrefetchState.store(TELEPORT_PREFETCH_STREAMING, std::memory_order_release);
+}
+
+// Called once per world update, on the same thread as teleports are executed on
+void ServiceTeleportPrefetch()
+{
+	if (TelePrefetchState.load(std::memory_order_relaxed) != TELEPORT_PREFETCH_STREAMING)
+		return;
+
+	// Drop the request if the race was left in the meantime
+	if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_RACING || **(int**)PLAYER_LISTABLESET_ADDR == 0)
+	{
+		TelePrefetchState.store(TELEPORT_PREFETCH_IDLE, std::memory_order_relaxed);
+		return;
+	}
+
+	const float Elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - TelePrefetchStartTime).count();
+	TelePrefetchElapsed.store(Elapsed, std::memory_order_relaxed);
+
+	const bool bResident = IsWorldResidentAt(&TelePrefetchPos);
+	if (!bResident && Elapsed < TelePrefetchTimeout)
+	{
+		// Keep requesting the target, so that streaming around the current player position does not take over again
+		bVector3 SimPos = { -TelePrefetchPos.y, TelePrefetchPos.z, TelePrefetchPos.x };
+		Sim_SetStream(&SimPos, false);
+		return;
+	}
+
+	if (!bResident)
+		reshade::log::message(reshade::log::level::warning, "Teleport target was not streamed in after %.1f seconds, falling back to a blocking stream.", Elapsed);
+
+	if (bTelePrefetchMovePlayer)
+	{
+		// The blocking stream in the propagator returns immediately now that the target is resident
+		bTeleFloorSnap_OldState = bTeleFloorSnap;
+		bTeleFloorSnap |= bTelePrefetchFloorSnap;
+		JumpToNewPosPropagator(&TelePrefetchPos);
+		bTeleFloorSnap = bTeleFloorSnap_OldState;
+	}
+
+	TelePrefetchState.store(bTelePrefetchMovePlayer ? TELEPORT_PREFETCH_IDLE : TELEPORT_PREFETCH_RESIDENT, std::memory_order_release);
+}
+
 #if defined(GAME_MW) || defined(GAME_CARBON)
 
-void __stdcall JumpToNewPos(bVector3* pos)
+void __stdcall JumpToNewPosPropagator(bVector3* pos)
 {
 	int FirstLocalPlayer = **(int**)PLAYER_LISTABLESET_ADDR;
 	int LocalPlayerVtable;
@@ -3652,33 +4678,76 @@ void __stdcall JumpToNewPos(bVector3* pos)
 	}
 }
 
+void __stdcall JumpToNewPos(bVector3* pos)
+{
+	if (bTelePrefetch)
+		BeginTeleportPrefetch(pos, true, false);
+	else
+		JumpToNewPosPropagator(pos);
+}
+
+void __stdcall PrefetchNewPos(bVector3* pos)
+{
+	BeginTeleportPrefetch(pos, false, false);
+}
+
 #else
 // Undercover & ProStreet are special beings. They're actually multi threaded.
 // We have to do teleporting during EMainService / World::Service (or same at least in the same thread as World updates), otherwise we cause hanging bugs...
 
-bool bDoTeleport = false;
-bVector3 ServiceTeleportPos = { 0 };
-
-// Track loading stuff
-bool bDoTrackUnloading = false;
-bool bDoFEUnloading= false;
-bool bDoLoadRegion = false;
-
-bool bDoTriggerWatchCar = false;
-int CarTypeToWatch = CARLIST_TYPE_AIRACER;
-
-bool bDoFlipCar = false;
-
-bool bDoOverlaySwitch = false;
-bool bDoPlayMovie = false;
-
 #ifdef GAME_UC
-bool bDoAwardCash = false;
 float CashToAward = 0.0;
 void(__thiscall* GMW2Game_AwardCash)(void* dis, float cash, float unk) = (void(__thiscall*)(void*, float, float))GMW2GAME_AWARDCASH_ADDR;
 bool bDisableCops = false;
 #endif
 
+// Commands are queued from the render thread and executed in order on the game thread during MainService_Hook
+enum GameThreadCommandType
+{
+	GAMETHREAD_CMD_TELEPORT,
+	GAMETHREAD_CMD_PREFETCH,
+	GAMETHREAD_CMD_UNLOAD_TRACK,
+	GAMETHREAD_CMD_UNLOAD_FE,
+	GAMETHREAD_CMD_LOAD_REGION,
+	GAMETHREAD_CMD_WATCH_CAR,
+	GAMETHREAD_CMD_FLIP_CAR,
+#ifdef GAME_UC
+	GAMETHREAD_CMD_AWARD_CASH,
+#else
+	GAMETHREAD_CMD_SWITCH_OVERLAY,
+	GAMETHREAD_CMD_PLAY_MOVIE,
+#endif
+};
+
+struct GameThreadCommand
+{
+	GameThreadCommandType Type;
+	int IntArg; // Track number or car list type
+	float FloatArg; // Cash amount
+	bool bFloorSnap; // Teleport only
+	bVector3 Pos; // Teleport and prefetch only
+#ifndef GAME_UC
+	char StrArg[128]; // Overlay name
+#endif
+};
+
+lockfree_mpsc_queue<GameThreadCommand, 64> GameThreadCommandQueue;
+
+void QueueGameThreadCommand(GameThreadCommandType type, int int_arg = 0, float float_arg = 0.0f)
+{
+	GameThreadCommand cmd = {};
+	cmd.Type = type;
+	cmd.IntArg = int_arg;
+	cmd.FloatArg = float_arg;
+#ifndef GAME_UC
+	if (type == GAMETHREAD_CMD_SWITCH_OVERLAY)
+		strncpy_s(cmd.StrArg, CurrentOverlay, _TRUNCATE);
+#endif
+
+	if (!GameThreadCommandQueue.push(cmd))
+		reshade::log::message(reshade::log::level::warning, "Game thread command queue is full, dropping command %d.", static_cast<int>(type));
+}
+
 void __stdcall JumpToNewPosPropagator(bVector3* pos)
 {
 	int FirstLocalPlayer = **(int**)PLAYER_LISTABLESET_ADDR;
@@ -3709,78 +4778,91 @@ void __stdcall JumpToNewPosPropagator(bVector3* pos)
 
 void __stdcall JumpToNewPos(bVector3* pos)
 {
-	memcpy(&ServiceTeleportPos, pos, sizeof(bVector3));
-	bDoTeleport = true;
+	GameThreadCommand cmd = {};
+	cmd.Type = GAMETHREAD_CMD_TELEPORT;
+	memcpy(&cmd.Pos, pos, sizeof(bVector3));
+#ifdef GAME_PS
+	cmd.bFloorSnap = bCalledProStreetTele;
+#endif
+
+	if (!GameThreadCommandQueue.push(cmd))
+		reshade::log::message(reshade::log::level::warning, "Game thread command queue is full, dropping teleport request.");
+}
+
+void __stdcall PrefetchNewPos(bVector3* pos)
+{
+	GameThreadCommand cmd = {};
+	cmd.Type = GAMETHREAD_CMD_PREFETCH;
+	memcpy(&cmd.Pos, pos, sizeof(bVector3));
+
+	if (!GameThreadCommandQueue.push(cmd))
+		reshade::log::message(reshade::log::level::warning, "Game thread command queue is full, dropping prefetch request.");
 }
 
 void __stdcall MainService_Hook()
 {
-	if (bDoTeleport)
+	// Only a single atomic load when nothing was queued
+	GameThreadCommand cmd;
+	while (GameThreadCommandQueue.pop(cmd))
 	{
-#ifdef GAME_PS
-		if (bCalledProStreetTele)
+		switch (cmd.Type)
 		{
-			bTeleFloorSnap_OldState = bTeleFloorSnap;
-			bTeleFloorSnap = true;
-		}
-#endif
-		JumpToNewPosPropagator(&ServiceTeleportPos);
-		bDoTeleport = false;
-#ifdef GAME_PS
-		if (bCalledProStreetTele)
-			bTeleFloorSnap = bTeleFloorSnap_OldState;
-#endif
-	}
-	if (bDoTrackUnloading)
-	{
-		GameFlowManager_UnloadTrack((void*)GAMEFLOWMGR_ADDR);
-		bDoTrackUnloading = false;
-	}
-	if (bDoFEUnloading)
-	{
-		*(int*)SKIPFE_ADDR = 1;
-		*(int*)SKIPFETRACKNUM_ADDR = SkipFETrackNum;
-		GameFlowManager_UnloadFrontend((void*)GAMEFLOWMGR_ADDR);
-		bDoFEUnloading = false;
-	}
-	if (bDoLoadRegion)
-	{
-		*(int*)SKIPFE_ADDR = 1;
-		*(int*)SKIPFETRACKNUM_ADDR = SkipFETrackNum;
-		GameFlowManager_LoadRegion((void*)GAMEFLOWMGR_ADDR);
-		bDoLoadRegion = false;
-	}
-	if (bDoTriggerWatchCar)
-	{
-		TriggerWatchCar(CarTypeToWatch);
-		bDoTriggerWatchCar = false;
-	}
-
-	if (bDoFlipCar)
-	{
-		FlipCar();
-		bDoFlipCar = false;
-	}
-#ifdef GAME_UC
-	if (bDoAwardCash)
-	{
-		GMW2Game_AwardCash(*(void**)GMW2GAME_OBJ_ADDR, CashToAward, 0.0);
-		bDoAwardCash = false;
-	}
-#else
-	if (bDoOverlaySwitch)
-	{
-		SwitchOverlay(CurrentOverlay);
-		bDoOverlaySwitch = false;
+		case GAMETHREAD_CMD_TELEPORT:
+			if (bTelePrefetch)
+			{
+				BeginTeleportPrefetch(&cmd.Pos, true, cmd.bFloorSnap);
+				break;
+			}
+			if (cmd.bFloorSnap)
+			{
+				bTeleFloorSnap_OldState = bTeleFloorSnap;
+				bTeleFloorSnap = true;
+			}
+			JumpToNewPosPropagator(&cmd.Pos);
+			if (cmd.bFloorSnap)
+				bTeleFloorSnap = bTeleFloorSnap_OldState;
+			break;
+		case GAMETHREAD_CMD_PREFETCH:
+			BeginTeleportPrefetch(&cmd.Pos, false, false);
+			break;
+		case GAMETHREAD_CMD_UNLOAD_TRACK:
+			GameFlowManager_UnloadTrack((void*)GAMEFLOWMGR_ADDR);
+			break;
+		case GAMETHREAD_CMD_UNLOAD_FE:
+			*(int*)SKIPFE_ADDR = 1;
+			*(int*)SKIPFETRACKNUM_ADDR = cmd.IntArg;
+			GameFlowManager_UnloadFrontend((void*)GAMEFLOWMGR_ADDR);
+			break;
+		case GAMETHREAD_CMD_LOAD_REGION:
+			*(int*)SKIPFE_ADDR = 1;
+			*(int*)SKIPFETRACKNUM_ADDR = cmd.IntArg;
+			GameFlowManager_LoadRegion((void*)GAMEFLOWMGR_ADDR);
+			break;
+		case GAMETHREAD_CMD_WATCH_CAR:
+			TriggerWatchCar(cmd.IntArg);
+			break;
+		case GAMETHREAD_CMD_FLIP_CAR:
+			FlipCar();
+			break;
+#ifdef GAME_UC
+		case GAMETHREAD_CMD_AWARD_CASH:
+			GMW2Game_AwardCash(*(void**)GMW2GAME_OBJ_ADDR, cmd.FloatArg, 0.0);
+			break;
+#else
+		case GAMETHREAD_CMD_SWITCH_OVERLAY:
+			SwitchOverlay(cmd.StrArg);
+			break;
+		case GAMETHREAD_CMD_PLAY_MOVIE:
+			PlayMovie();
+			break;
+#endif
+		}
 	}
 
-	if (bDoPlayMovie)
-	{
-		PlayMovie();
-		bDoPlayMovie = false;
-	}
-#endif
+	ServiceTeleportPrefetch();
 
+	// Publish the state after the commands above were applied, so that the render thread sees their effect in the same tick
+	reshade::runtime::publish_nfs_game_state();
 }
 
 #endif
@@ -3968,27 +5050,43 @@ int __stdcall RetZero()
 	return 0;
 }
 
+reshade::memory_patch_set SpeedLimiterPatches;
+
 void ApplySpeedLimiterPatches()
 {
-	injector::WriteMemory<unsigned int>(0x0040BE15, 0, true);
-	injector::WriteMemory<unsigned int>(0x004887A3, 0, true);
-	injector::WriteMemory<unsigned int>(0x00488AA9, 0, true);
-	injector::WriteMemory<unsigned int>(0x00488AE3, 0, true);
-	injector::WriteMemory<unsigned int>(0x00718B3F, 0, true);
-	injector::WriteMemory<unsigned int>(0x0071E4E8, 0, true);
-	injector::MakeJMP(0x00402820, RetZero, true);
+	if (SpeedLimiterPatches.is_applied())
+		return;
+
+	SpeedLimiterPatches = reshade::memory_patch_set();
+	SpeedLimiterPatches.write<unsigned int>(0x0040BE15, 0);
+	SpeedLimiterPatches.write<unsigned int>(0x004887A3, 0);
+	SpeedLimiterPatches.write<unsigned int>(0x00488AA9, 0);
+	SpeedLimiterPatches.write<unsigned int>(0x00488AE3, 0);
+	SpeedLimiterPatches.write<unsigned int>(0x00718B3F, 0);
+	SpeedLimiterPatches.write<unsigned int>(0x0071E4E8, 0);
+	SpeedLimiterPatches.make_jmp(0x00402820, RetZero);
+	SpeedLimiterPatches.apply();
 }
 
 void UndoSpeedLimiterPatches()
 {
-	injector::WriteMemory<unsigned int>(0x0040BE15, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x004887A3, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x00488AA9, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x00488AE3, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x00718B3F, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x0071E4E8, 0x0A2D9ECB4, true);
-	injector::WriteMemory<unsigned int>(0x00402820, 0x66E9FF6A, true);
-	injector::WriteMemory<unsigned int>(0x00402822, 0x0DCA66E9, true);
+	// Restore the replaced bytes if the patches were applied here, otherwise they were applied externally, so write the known original code
+	if (SpeedLimiterPatches.is_applied())
+	{
+		SpeedLimiterPatches.revert();
+		return;
+	}
+
+	reshade::memory_patch_set original;
+	original.write<unsigned int>(0x0040BE15, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x004887A3, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x00488AA9, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x00488AE3, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x00718B3F, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x0071E4E8, 0x0A2D9ECB4);
+	original.write<unsigned int>(0x00402820, 0x66E9FF6A);
+	original.write<unsigned int>(0x00402822, 0x0DCA66E9);
+	original.apply();
 }
 
 #endif
@@ -4067,6 +5165,324 @@ void __declspec(naked) ToggleAIControlCave()
 bVector3 FogColourPicker = {0.43, 0.41, 0.29};
 #endif
 
+struct NFSRenderToggle
+{
+	const char* Name;
+	void* Address;
+	bool IsMode; // Integer mode (e.g. the preculler mode) instead of a boolean, which is toggled between off and on
+};
+
+// World render toggles that the render sweep measures the cost of
+const std::vector<NFSRenderToggle> NFSRenderToggles = {
+#ifdef GAME_PS
+	{ "Draw World", &bDrawWorld, false },
+#elif defined(DRAWWORLD_ADDR)
+	{ "Draw World", (void*)DRAWWORLD_ADDR, false },
+#endif
+#ifdef DRAWCARS_ADDR
+	{ "Draw Cars", (void*)DRAWCARS_ADDR, false },
+#endif
+#ifdef DRAWCARSHADOWS_ADDR
+	{ "Draw Car Shadows", (void*)DRAWCARSHADOWS_ADDR, false },
+#endif
+#ifdef DRAWCARSREFLECTIONS_ADDR
+	{ "Draw Car Reflections", (void*)DRAWCARSREFLECTIONS_ADDR, false },
+#endif
+#ifdef DRAWLIGHTFLARES_ADDR
+	{ "Draw Light Flares", (void*)DRAWLIGHTFLARES_ADDR, false },
+#endif
+#ifdef DRAWFANCYCARSHADOW_ADDR
+	{ "Draw Fancy Car Shadows", (void*)DRAWFANCYCARSHADOW_ADDR, false },
+#endif
+#ifdef PRECULLERMODE_ADDR
+	{ "Preculler", (void*)PRECULLERMODE_ADDR, true },
+#endif
+#ifdef PRECIPITATION_ENABLE_ADDR
+	{ "Precipitation", (void*)PRECIPITATION_ENABLE_ADDR, false },
+#endif
+#ifdef APPLYVISUALLOOK_ADDR
+	{ "Visual Look Filter", (void*)APPLYVISUALLOOK_ADDR, false },
+#endif
+};
+
+enum NFSTweakType
+{
+	NFS_TWEAK_BOOL,
+	NFS_TWEAK_INT,
+	NFS_TWEAK_FLOAT,
+	NFS_TWEAK_FLOAT_SLIDER,
+#ifdef HAS_FOG_CTRL
+	NFS_TWEAK_FOG_COLOUR, // Colour picker for the three base weather fog colour integers, the address is unused
+#endif
+};
+
+// Description of a value in game memory that is edited with a single widget in the overlay
+struct NFSTweak
+{
+	const char* Category; // Collapsing header the tweak is listed under, or nullptr to list it outside of any header
+	const char* Name;
+	NFSTweakType Type;
+	void* Address;
+	float Step = 0.1f; // Minimum for sliders
+	float StepFast = 1.0f; // Maximum for sliders
+	const char* Format = "%.3f";
+
+	// Filled in by 'ValidateNFSTweaks'
+	bool Valid = true;
+	size_t NextCategory = 0; // Index of the first tweak of the following category, so that collapsed categories can be skipped in one step
+};
+
+// Tweaks listed in the "Precipitation & Weather" header, which are only known for some of the games
+#if defined(GAME_UG2) || (defined(HAS_FOG_CTRL) && !defined(OLD_NFS))
+#define HAS_WEATHER_TWEAKS
+#endif
+
+std::vector<NFSTweak> NFSPrecipitationTweaks = {
+#ifdef HAS_WEATHER_TWEAKS
+	{ nullptr, "Precipitation Enable", NFS_TWEAK_BOOL, (void*)PRECIPITATION_ENABLE_ADDR },
+	{ nullptr, "Precipitation Render", NFS_TWEAK_BOOL, (void*)PRECIPITATION_RENDER_ADDR },
+	{ nullptr, "Precipitation Debug Enable", NFS_TWEAK_BOOL, (void*)PRECIPITATION_DEBUG_ADDR },
+#endif
+};
+
+std::vector<NFSTweak> NFSWeatherTweaks = {
+#ifdef HAS_WEATHER_TWEAKS
+	{ "General", "Precipitation Percentage", NFS_TWEAK_FLOAT, (void*)PRECIPITATION_PERCENT_ADDR },
+	{ "General", "Bound X", NFS_TWEAK_FLOAT, (void*)PRECIP_BOUNDX_ADDR },
+	{ "General", "Bound Y", NFS_TWEAK_FLOAT, (void*)PRECIP_BOUNDY_ADDR },
+	{ "General", "Bound Z", NFS_TWEAK_FLOAT, (void*)PRECIP_BOUNDZ_ADDR },
+	{ "General", "Ahead X", NFS_TWEAK_FLOAT, (void*)PRECIP_AHEADX_ADDR },
+	{ "General", "Ahead Y", NFS_TWEAK_FLOAT, (void*)PRECIP_AHEADY_ADDR },
+	{ "General", "Ahead Z", NFS_TWEAK_FLOAT, (void*)PRECIP_AHEADZ_ADDR },
+#ifdef GAME_UG2
+	{ "General", "Weather Change", NFS_TWEAK_FLOAT, (void*)PRECIP_WEATHERCHANGE_ADDR },
+#endif
+	{ "General", "Drive Factor", NFS_TWEAK_FLOAT, (void*)PRECIP_DRIVEFACTOR_ADDR },
+	{ "General", "Prevailing Multiplier", NFS_TWEAK_FLOAT, (void*)PRECIP_PREVAILINGMULT_ADDR },
+#ifdef GAME_UG2
+	{ "General", "Always Raining", NFS_TWEAK_BOOL, (void*)PRECIP_CHANCE100_ADDR },
+	{ "General", "Rain Type (restart world to see diff.)", NFS_TWEAK_INT, &GlobalRainType, 1.0f, 100.0f },
+#else
+	{ "General", "Camera Mod", NFS_TWEAK_FLOAT, (void*)PRECIP_CAMERAMOD_ADDR },
+#endif
+
+	{ "Wind", "Wind Angle", NFS_TWEAK_FLOAT, (void*)PRECIP_WINDANG_ADDR },
+	{ "Wind", "Max Sway", NFS_TWEAK_FLOAT, (void*)PRECIP_SWAYMAX_ADDR },
+	{ "Wind", "Max Wind Effect", NFS_TWEAK_FLOAT, (void*)PRECIP_MAXWINDEFF_ADDR },
+
+#ifdef GAME_CARBON
+	{ "Road Dampness", "Wet Dampness", NFS_TWEAK_FLOAT, (void*)PRECIP_WETDAMPNESS_ADDR },
+	{ "Road Dampness", "Dry Dampness", NFS_TWEAK_FLOAT, (void*)PRECIP_DRYDAMPNESS_ADDR },
+#else
+	{ "Road Dampness", "Base Dampness", NFS_TWEAK_FLOAT, (void*)PRECIP_BASEDAMPNESS_ADDR },
+#endif
+#ifdef GAME_UG2
+	{ "Road Dampness", "Uber Dampness", NFS_TWEAK_FLOAT, (void*)PRECIP_UBERDAMPNESS_ADDR },
+#endif
+
+#ifdef GAME_UG2
+	{ "On-screen FX", "OverRide Enable", NFS_TWEAK_BOOL, (void*)PRECIP_ONSCREEN_OVERRIDE_ADDR },
+	{ "On-screen FX", "Drip Speed", NFS_TWEAK_FLOAT, (void*)PRECIP_ONSCREEN_DRIPSPEED_ADDR },
+	{ "On-screen FX", "Speed Mod", NFS_TWEAK_FLOAT, (void*)PRECIP_ONSCREEN_SPEEDMOD_ADDR },
+#else
+	{ "On-screen FX", "Drip Speed", NFS_TWEAK_FLOAT, (void*)PRECIP_ONSCREEN_DRIPSPEED_ADDR },
+	{ "On-screen FX", "Speed Mod", NFS_TWEAK_FLOAT, (void*)PRECIP_ONSCREEN_SPEEDMOD_ADDR, 0.0001f, 0.001f, "%.6f" },
+	{ "On-screen FX", "Drop Shape Speed Change", NFS_TWEAK_FLOAT, (void*)PRECIP_ONSCREEN_DROPSHAPESPEEDCHANGE_ADDR },
+#endif
+
+	{ "Fog", "Fog Control OverRide", NFS_TWEAK_BOOL, (void*)FOG_CTRLOVERRIDE_ADDR },
+	{ "Fog", "Precip. Fog Percentage", NFS_TWEAK_FLOAT, (void*)PRECIP_FOGPERCENT_ADDR },
+	{ "Fog", "Base Fog Falloff", NFS_TWEAK_FLOAT, (void*)BASEFOG_FALLOFF_ADDR },
+	{ "Fog", "Base Fog Falloff X", NFS_TWEAK_FLOAT, (void*)BASEFOG_FALLOFFX_ADDR },
+	{ "Fog", "Base Fog Falloff Y", NFS_TWEAK_FLOAT, (void*)BASEFOG_FALLOFFY_ADDR },
+#ifdef GAME_CARBON
+	{ "Fog", "Base Fog End", NFS_TWEAK_FLOAT, (void*)BASEFOGEND_NONPS2_ADDR },
+	{ "Fog", "Base Fog Exponent", NFS_TWEAK_FLOAT, (void*)BASEFOGEXPONENT_NONPS2_ADDR },
+	{ "Fog", "Base Weather Fog", NFS_TWEAK_FLOAT, (void*)BASEWEATHERFOG_NONPS2_ADDR },
+	{ "Fog", "Base Weather Fog (PS2 value)", NFS_TWEAK_FLOAT, (void*)BASEWEATHER_FOG_ADDR },
+#else
+	{ "Fog", "Base Weather Fog", NFS_TWEAK_FLOAT, (void*)BASEWEATHER_FOG_ADDR },
+#endif
+	{ "Fog", "Base Weather Fog Start", NFS_TWEAK_FLOAT, (void*)BASEWEATHER_FOG_START_ADDR },
+	{ "Fog", "Base Weather Fog Colour", NFS_TWEAK_FOG_COLOUR, (void*)BASEWEATHER_FOG_COLOUR_R_ADDR },
+#ifdef GAME_CARBON
+	{ "Fog", "Base Sky Fog Falloff", NFS_TWEAK_FLOAT_SLIDER, (void*)BASESKYFOGFALLOFF_ADDR, -0.005f, 0.005f, "%.6f" },
+	{ "Fog", "Base Sky Fog Offset", NFS_TWEAK_FLOAT, (void*)BASESKYFOGOFFSET_ADDR },
+#endif
+
+#ifndef GAME_UG2
+	{ "Clouds", "Rate of change", NFS_TWEAK_FLOAT, (void*)PRECIP_CLOUDSRATEOFCHANGE_ADDR },
+#endif
+
+	{ "Rain", "Rain X", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINX_ADDR },
+	{ "Rain", "Rain Y", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINY_ADDR },
+	{ "Rain", "Rain Z", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINZ_ADDR },
+	{ "Rain", "Rain Z Constant", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINZCONSTANT_ADDR },
+	{ "Rain", "Rain Radius X", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINRADIUSX_ADDR },
+	{ "Rain", "Rain Radius Y", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINRADIUSY_ADDR },
+	{ "Rain", "Rain Radius Z", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINRADIUSZ_ADDR },
+	{ "Rain", "Rain Wind Effect", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINWINDEFF_ADDR },
+	{ "Rain", "Rain Percentage", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINPERCENT_ADDR },
+	{ "Rain", "Rain in the headlights", NFS_TWEAK_FLOAT, (void*)PRECIP_RAININTHEHEADLIGHTS_ADDR },
+#ifndef GAME_UG2
+	{ "Rain", "Rain Rate of change", NFS_TWEAK_FLOAT, (void*)PRECIP_RAINRATEOFCHANGE_ADDR },
+#endif
+
+#ifdef GAME_UG2
+	{ "Snow", "Snow X", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWX_ADDR },
+	{ "Snow", "Snow Y", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWY_ADDR },
+	{ "Snow", "Snow Z", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWZ_ADDR },
+	{ "Snow", "Snow Z Constant", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWZCONSTANT_ADDR },
+	{ "Snow", "Snow Radius X", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWRADIUSX_ADDR },
+	{ "Snow", "Snow Radius Y", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWRADIUSY_ADDR },
+	{ "Snow", "Snow Radius Z", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWRADIUSZ_ADDR },
+	{ "Snow", "Snow Wind Effect", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWWINDEFF_ADDR },
+	{ "Snow", "Snow Percentage", NFS_TWEAK_FLOAT, (void*)PRECIP_SNOWPERCENT_ADDR },
+
+	{ "Sleet", "Sleet X", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETX_ADDR },
+	{ "Sleet", "Sleet Y", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETY_ADDR },
+	{ "Sleet", "Sleet Z", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETZ_ADDR },
+	{ "Sleet", "Sleet Z Constant", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETZCONSTANT_ADDR },
+	{ "Sleet", "Sleet Radius X", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETRADIUSX_ADDR },
+	{ "Sleet", "Sleet Radius Y", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETRADIUSY_ADDR },
+	{ "Sleet", "Sleet Radius Z", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETRADIUSZ_ADDR },
+	{ "Sleet", "Sleet Wind Effect", NFS_TWEAK_FLOAT, (void*)PRECIP_SLEETWINDEFF_ADDR },
+
+	{ "Hail", "Hail X", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILX_ADDR },
+	{ "Hail", "Hail Y", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILY_ADDR },
+	{ "Hail", "Hail Z", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILZ_ADDR },
+	{ "Hail", "Hail Z Constant", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILZCONSTANT_ADDR },
+	{ "Hail", "Hail Radius X", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILRADIUSX_ADDR },
+	{ "Hail", "Hail Radius Y", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILRADIUSY_ADDR },
+	{ "Hail", "Hail Radius Z", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILRADIUSZ_ADDR },
+	{ "Hail", "Hail Wind Effect", NFS_TWEAK_FLOAT, (void*)PRECIP_HAILWINDEFF_ADDR },
+#endif
+#endif
+};
+
+// All tweak registries, so that they can be validated together
+std::vector<NFSTweak>* const NFSTweakRegistries[] = { &NFSPrecipitationTweaks, &NFSWeatherTweaks };
+
+void ValidateNFSTweaks()
+{
+	static std::once_flag Validated;
+	std::call_once(Validated, []() {
+		for (std::vector<NFSTweak>* const tweaks : NFSTweakRegistries)
+		{
+			for (size_t i = 0; i < tweaks->size(); ++i)
+			{
+				NFSTweak& tweak = (*tweaks)[i];
+
+				// Addresses that are not writable belong to a different version of the game executable, so hide these instead of crashing when they are edited
+				const size_t size = tweak.Type == NFS_TWEAK_BOOL ? sizeof(bool) : sizeof(int);
+				tweak.Valid = reshade::utils::is_memory_writable(tweak.Address, size);
+				if (!tweak.Valid)
+					reshade::log::message(reshade::log::level::warning, "Hiding tweak \"%s\" because its address %p is not writable.", tweak.Name, tweak.Address);
+
+				// Categories are compared by content, since identical string literals are not guaranteed to share an address
+				size_t next = i + 1;
+				while (next < tweaks->size() && tweak.Category != nullptr && (*tweaks)[next].Category != nullptr && std::strcmp(tweak.Category, (*tweaks)[next].Category) == 0)
+					++next;
+				tweak.NextCategory = next;
+			}
+		}
+	});
+}
+
+void DrawNFSTweaks(std::vector<NFSTweak>& tweaks)
+{
+	for (size_t i = 0; i < tweaks.size();)
+	{
+		// Skip all tweaks of a category at once when its header is collapsed, so that these do not cost anything
+		const NFSTweak& first = tweaks[i];
+		if (first.Category != nullptr && !ImGui::CollapsingHeader(first.Category, ImGuiTreeNodeFlags_None))
+		{
+			i = first.NextCategory;
+			continue;
+		}
+
+		for (const size_t end = first.Category != nullptr ? first.NextCategory : i + 1; i < end; ++i)
+		{
+			const NFSTweak& tweak = tweaks[i];
+			if (!tweak.Valid)
+				continue;
+
+			switch (tweak.Type)
+			{
+			case NFS_TWEAK_BOOL:
+				ImGui::Checkbox(tweak.Name, (bool*)tweak.Address);
+				break;
+			case NFS_TWEAK_INT:
+				ImGui::InputInt(tweak.Name, (int*)tweak.Address, (int)tweak.Step, (int)tweak.StepFast, ImGuiInputTextFlags_None);
+				break;
+			case NFS_TWEAK_FLOAT:
+				ImGui::InputFloat(tweak.Name, (float*)tweak.Address, tweak.Step, tweak.StepFast, tweak.Format, ImGuiInputTextFlags_CharsScientific);
+				break;
+			case NFS_TWEAK_FLOAT_SLIDER:
+				ImGui::SliderFloat(tweak.Name, (float*)tweak.Address, tweak.Step, tweak.StepFast, tweak.Format);
+				break;
+#ifdef HAS_FOG_CTRL
+			case NFS_TWEAK_FOG_COLOUR:
+				if (ImGui::CollapsingHeader(tweak.Name, ImGuiTreeNodeFlags_None))
+				{
+					if (ImGui::ColorPicker3("", (float*)&(FogColourPicker.x), ImGuiColorEditFlags_InputRGB | ImGuiColorEditFlags_PickerHueWheel))
+					{
+						*(int*)BASEWEATHER_FOG_COLOUR_R_ADDR = (int)(FogColourPicker.x * 255);
+						*(int*)BASEWEATHER_FOG_COLOUR_G_ADDR = (int)(FogColourPicker.y * 255);
+						*(int*)BASEWEATHER_FOG_COLOUR_B_ADDR = (int)(FogColourPicker.z * 255);
+					}
+				}
+				break;
+#endif
+			}
+		}
+	}
+}
+
+// Inputs for adding a new memory watch in the overlay
+char NewWatchName[64] = "";
+char NewWatchBase[32] = "";
+char NewWatchOffsets[128] = "";
+int NewWatchType = 0;
+const char* const WatchTypeNames[] = { "Int32", "UInt32", "Float", "UInt8" };
+
+int GetRenderToggle(const NFSRenderToggle& toggle)
+{
+	return toggle.IsMode ? *(int*)toggle.Address : *(bool*)toggle.Address;
+}
+void SetRenderToggle(const NFSRenderToggle& toggle, int value)
+{
+	if (toggle.IsMode)
+		*(int*)toggle.Address = value;
+	else
+		*(bool*)toggle.Address = value != 0;
+}
+
+#ifndef OLD_NFS
+void ToggleAIControl()
+{
+#ifdef NFS_MULTITHREAD
+	bToggleAiControl = !bToggleAiControl;
+#else
+	*(bool*)TOGGLEAICONTROL_ADDR = !*(bool*)TOGGLEAICONTROL_ADDR;
+#endif
+}
+#endif
+
+void StartSkipFERace(int track)
+{
+	*(int*)SKIPFETRACKNUM_ADDR2 = track;
+	*(int*)SKIPFE_ADDR = 1;
+#if defined(GAME_MW) || defined(OLD_NFS)
+	OnlineEnabled_OldState = *(bool*)ONLINENABLED_ADDR;
+	*(int*)ONLINENABLED_ADDR = 0;
+#endif
+	RaceStarter_StartSkipFERace();
+#if defined(GAME_MW) || defined(OLD_NFS)
+	*(int*)ONLINENABLED_ADDR = OnlineEnabled_OldState;
+#endif
+}
+
 void reshade::runtime::draw_gui_nfs()
 {
 	bool modified = false;
@@ -4136,7 +5552,7 @@ void reshade::runtime::draw_gui_nfs()
 				ImGui::InputFloat("Player Cash Adjust", &CashToAward, 1.0, 1000.0, "%.1f", ImGuiInputTextFlags_CharsScientific);
 				if (ImGui::Button("Adjust Cash", ImVec2(ImGui::CalcItemWidth(), 0)))
 				{
-					bDoAwardCash = true;
+					QueueGameThreadCommand(GAMETHREAD_CMD_AWARD_CASH, 0, CashToAward);
 				}
 			}
 #endif
@@ -4175,7 +5591,7 @@ void reshade::runtime::draw_gui_nfs()
 			if (ImGui::Button("Switch to the manual", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
 #ifdef NFS_MULTITHREAD
-				bDoOverlaySwitch = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_SWITCH_OVERLAY);
 #else
 				SwitchOverlay(CurrentOverlay);
 #endif
@@ -4192,7 +5608,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Main Menu", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("Main Menu", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("MainMenu.fng");
@@ -4209,7 +5625,7 @@ void reshade::runtime::draw_gui_nfs()
 
 			if (ImGui::CollapsingHeader("Gameplay", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_RACING)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING)
 					ImGui::TextUnformatted("WARNING: You're not in race mode. The game might crash if you use these.");
 				if (ImGui::Button("Pause Main", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("Pause_Main.fng");
@@ -4229,7 +5645,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Career", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("Safehouse Reputation Overview", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("SafehouseReputationOverview.fng");
@@ -4253,7 +5669,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Customization (Must be in Customized Car Screen)", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("My Cars Manager", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("MyCarsManager.fng");
@@ -4279,7 +5695,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Misc", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("Keyboard", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("Keyboard.fng");
@@ -4293,7 +5709,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Online (Must be in ONLINE connected)", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("News and Terms", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("OL_News_and_Terms.fng");
@@ -4349,7 +5765,7 @@ void reshade::runtime::draw_gui_nfs()
 			}
 			if (ImGui::CollapsingHeader("Memory Card", ImGuiTreeNodeFlags_None))
 			{
-				if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_IN_FRONTEND)
+				if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
 					ImGui::TextUnformatted("WARNING: You're not in Front End. The game might crash if you use these.");
 				if (ImGui::Button("Profile Manager", ImVec2(ImGui::CalcItemWidth(), 0)))
 					SwitchOverlay("MC_ProfileManager.fng");
@@ -4404,6 +5820,33 @@ void reshade::runtime::draw_gui_nfs()
 		{
 			JumpToNewPos(&TeleportPos);
 		}
+#ifndef OLD_NFS
+		if (ImGui::Button("Prefetch", ImVec2(ImGui::CalcItemWidth(), 0)))
+		{
+			PrefetchNewPos(&TeleportPos);
+		}
+		ImGui::SetItemTooltip("Streams the world around the target in the background, so that a following teleport there is instant.");
+
+		ImGui::Checkbox("Stream Before Teleport", &bTelePrefetch);
+		ImGui::SetItemTooltip("Streams the target in without blocking and only moves the player once it is resident, instead of freezing the game until streaming finished.");
+		if (bTelePrefetch)
+			ImGui::SliderFloat("Stream Timeout", &TelePrefetchTimeout, 1.0f, 60.0f, "%.0f s", ImGuiSliderFlags_AlwaysClamp);
+
+		switch (TelePrefetchState.load(std::memory_order_acquire))
+		{
+		case TELEPORT_PREFETCH_STREAMING:
+		{
+			const float Elapsed = TelePrefetchElapsed.load(std::memory_order_relaxed);
+			char Label[64];
+			std::snprintf(Label, sizeof(Label), "Streaming target... (%.1f s)", Elapsed);
+			ImGui::ProgressBar(std::min(Elapsed / TelePrefetchTimeout, 1.0f), ImVec2(ImGui::CalcItemWidth(), 0), Label);
+			break;
+		}
+		case TELEPORT_PREFETCH_RESIDENT:
+			ImGui::Text("Target resident after %.1f s.", TelePrefetchElapsed.load(std::memory_order_relaxed));
+			break;
+		}
+#endif
 		ImGui::Separator();
 
 #ifdef OLD_NFS
@@ -5585,19 +7028,16 @@ void reshade::runtime::draw_gui_nfs()
 #ifdef HAS_COPS
 			if (ImGui::Button("Watch Cop Car", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
-				CarTypeToWatch = CARLIST_TYPE_COP;
-				bDoTriggerWatchCar = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_WATCH_CAR, CARLIST_TYPE_COP);
 			}
 			if (ImGui::Button("Watch Traffic Car", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
-				CarTypeToWatch = CARLIST_TYPE_TRAFFIC;
-				bDoTriggerWatchCar = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_WATCH_CAR, CARLIST_TYPE_TRAFFIC);
 			}
 #endif
 			if (ImGui::Button("Watch Racer Car", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
-				CarTypeToWatch = CARLIST_TYPE_AIRACER;
-				bDoTriggerWatchCar = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_WATCH_CAR, CARLIST_TYPE_AIRACER);
 			}
 #else
 #ifdef HAS_COPS
@@ -5619,11 +7059,7 @@ void reshade::runtime::draw_gui_nfs()
 		}
 		if (ImGui::Button("Toggle AI Control", ImVec2(ImGui::CalcItemWidth(), 0)))
 		{
-#ifdef NFS_MULTITHREAD
-			bToggleAiControl = !bToggleAiControl;
-#else
-			* (bool*)TOGGLEAICONTROL_ADDR = !*(bool*)TOGGLEAICONTROL_ADDR;
-#endif
+			ToggleAIControl();
 		}
 #ifdef GAME_UC
 		ImGui::Checkbox("Be a traffic car (after toggle)", &bBeTrafficCar);
@@ -5667,7 +7103,7 @@ void reshade::runtime::draw_gui_nfs()
 #ifndef OLD_NFS
 		ImGui::PushTextWrapPos();
 		ImGui::TextUnformatted("WARNING: Car changing is unstable and may cause the game to crash!");
-		if (*(int*)GAMEFLOWMGR_STATUS_ADDR != GAMEFLOW_STATE_RACING)
+		if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING)
 			ImGui::TextUnformatted("WARNING: You're not in race mode. The game might crash if you use these.");
 		ImGui::PopTextWrapPos();
 		ImGui::Separator();
@@ -5678,7 +7114,7 @@ void reshade::runtime::draw_gui_nfs()
 		if (ImGui::Button("Flip Car", ImVec2(ImGui::CalcItemWidth(), 0)))
 		{
 #ifdef NFS_MULTITHREAD
-			bDoFlipCar = true;
+			QueueGameThreadCommand(GAMETHREAD_CMD_FLIP_CAR);
 #else
 			FlipCar();
 #endif
@@ -5714,7 +7150,7 @@ void reshade::runtime::draw_gui_nfs()
 				bAppliedSpeedLimiterPatches = true;
 			}
 		}
-		if (*(int*)GAMEFLOWMGR_STATUS_ADDR == GAMEFLOW_STATE_RACING)
+		if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING)
 		{
 			ImGui::PushTextWrapPos();
 			ImGui::TextUnformatted("NOTE: Top speed patches will take effect after reloading the track! (Go to FrontEnd and back)");
@@ -5739,25 +7175,25 @@ void reshade::runtime::draw_gui_nfs()
 		ImGui::InputInt("Track Number", &SkipFETrackNum, 1, 100, ImGuiInputTextFlags_None);
 		ImGui::Separator();
 
-		if (*(int*)GAMEFLOWMGR_STATUS_ADDR == GAMEFLOW_STATE_IN_FRONTEND)
+		if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_IN_FRONTEND)
 		{
 			if (ImGui::Button("Start Track", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
 
 #if defined GAME_PS || defined GAME_UC
-				bDoFEUnloading = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_UNLOAD_FE, SkipFETrackNum);
 #else
 				*(int*)SKIPFETRACKNUM_ADDR = SkipFETrackNum;
 				GameFlowManager_UnloadFrontend((void*)GAMEFLOWMGR_ADDR);
 #endif
 			}
 		}
-		if (*(int*)GAMEFLOWMGR_STATUS_ADDR == GAMEFLOW_STATE_RACING)
+		if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING)
 		{
 			if (ImGui::Button("Start Track (in game - it may not work, goto FE first)", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
 #ifdef NFS_MULTITHREAD
-				bDoLoadRegion = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_LOAD_REGION, SkipFETrackNum);
 #else
 				* (int*)SKIPFETRACKNUM_ADDR = SkipFETrackNum;
 				GameFlowManager_LoadRegion((void*)GAMEFLOWMGR_ADDR);
@@ -5767,7 +7203,7 @@ void reshade::runtime::draw_gui_nfs()
 			if (ImGui::Button("Unload Track (Go to FrontEnd)", ImVec2(ImGui::CalcItemWidth(), 0)))
 			{
 #ifdef NFS_MULTITHREAD
-				bDoTrackUnloading = true;
+				QueueGameThreadCommand(GAMETHREAD_CMD_UNLOAD_TRACK);
 #else
 #ifdef GAME_MW
 				BootFlowManager_Init(); // otherwise crashes without it in MW...
@@ -5975,262 +7411,408 @@ void reshade::runtime::draw_gui_nfs()
 		ImGui::Separator();
 		if (ImGui::Button("Start SkipFE Race", ImVec2(ImGui::CalcItemWidth(), 0)))
 		{
-			*(int*)SKIPFETRACKNUM_ADDR2 = SkipFETrackNum;
-			*(int*)SKIPFE_ADDR = 1;
-#if defined(GAME_MW) || defined(OLD_NFS)
-			OnlineEnabled_OldState = *(bool*)ONLINENABLED_ADDR;
-			*(int*)ONLINENABLED_ADDR = 0;
-#endif
-			RaceStarter_StartSkipFERace();
-#if defined(GAME_MW) || defined(OLD_NFS)
-			*(int*)ONLINENABLED_ADDR = OnlineEnabled_OldState;
-#endif
+			StartSkipFERace(SkipFETrackNum);
 		}
 	}
 	ImGui::Separator();
-	if (ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_None))
+	if (ImGui::CollapsingHeader("Effect GameFlow Rules", ImGuiTreeNodeFlags_None))
 	{
-#ifdef GAME_UC
-		if (ImGui::Checkbox("Motion Blur", &bMotionBlur))
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Skips techniques outside of the listed game flow states, e.g. to not run heavy effects over loading screens. The rule below applies to all techniques in the current preset that do not have their own (set through the right-click menu in the technique list or a \"gameflow_states\" annotation).");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		char gameflow_rule[128];
+		gameflow_rule[_gameflow_rule.copy(gameflow_rule, sizeof(gameflow_rule) - 1)] = '\0';
+		if (ImGui::InputTextWithHint("Preset GameFlow States", "e.g. !LOADING_*", gameflow_rule, sizeof(gameflow_rule)))
 		{
-			modified = true;
+			_gameflow_rule = gameflow_rule;
+			for (technique &tech : _techniques)
+				update_gameflow_state_mask(tech);
+
+			if (_auto_save_preset)
+				save_current_preset();
+			else
+				_preset_is_modified = true;
 		}
-		ImGui::SliderFloat("Bloom Scale", (float*)0x00D5E154, -10.0, 10.0, "%.3f", ImGuiSliderFlags_None);
-#endif
-#ifndef OLD_NFS
-#ifdef GAME_PS
-		ImGui::InputFloat("Game Speed", &GameSpeed, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+
+		ImGui::Text("Current GameFlow State: %d", _nfs_game_state.gameflow_state);
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Benchmark", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Starts a SkipFE race with a fixed setup from the front end and records frame times and ReShade CPU/GPU times after a warm-up period.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::InputInt("Benchmark Track Number", &_nfs_benchmark_track, 1, 100, ImGuiInputTextFlags_None);
+		modified |= ImGui::InputInt("Benchmark Num AI Cars", &_nfs_benchmark_num_ai_cars, 1, 100, ImGuiInputTextFlags_None);
+		modified |= ImGui::InputInt("Benchmark Race Type", &_nfs_benchmark_race_type, 1, 100, ImGuiInputTextFlags_None);
+#ifndef GAME_UC
+#ifdef OLD_NFS
+		modified |= ImGui::SliderFloat("Benchmark Traffic Density", &_nfs_benchmark_traffic_density, 0.0, 3.0, "%.0f", ImGuiSliderFlags_AlwaysClamp);
 #else
-		ImGui::InputFloat("Game Speed", (float*)GAMESPEED_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-		ImGui::Checkbox("Visual Look Filter", (bool*)APPLYVISUALLOOK_ADDR);
+		modified |= ImGui::SliderFloat("Benchmark Traffic Density", &_nfs_benchmark_traffic_density, 0.0, 100.0, "%.3f", ImGuiSliderFlags_AlwaysClamp);
 #endif
-		ImGui::InputInt(PrecullerModeNames[*(int*)PRECULLERMODE_ADDR], (int*)PRECULLERMODE_ADDR, 1, 100, ImGuiInputTextFlags_None);
-		*(int*)PRECULLERMODE_ADDR %= 4;
-		if (*(int*)PRECULLERMODE_ADDR < 0)
-			*(int*)PRECULLERMODE_ADDR = 3;
 #endif
-#ifdef GAME_UG2
-		ImGui::Checkbox("Draw Cars", (bool*)DRAWCARS_ADDR);
-		ImGui::Checkbox("Draw Car Reflections", (bool*)DRAWCARSREFLECTIONS_ADDR);
-		ImGui::Checkbox("Draw Light Flares", (bool*)DRAWLIGHTFLARES_ADDR);
-		ImGui::Checkbox("Draw Fancy Car Shadows", (bool*)DRAWFANCYCARSHADOW_ADDR);
-		ImGui::InputFloat("Fancy Car Shadow Edge Mult.", (float*)FANCYCARSHADOWEDGEMULT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-		ImGui::InputFloat("Wheel Pivot Translation Amount", (float*)WHEELPIVOTTRANSLATIONAMOUNT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-		ImGui::InputFloat("Wheel Standard Width", (float*)WHEELSTANDARDWIDTH_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+#ifdef PRECIPITATION_PERCENT_ADDR
+		modified |= ImGui::InputFloat("Benchmark Precipitation (negative keeps track weather)", &_nfs_benchmark_precipitation, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+#endif
+#ifndef OLD_NFS
+		modified |= ImGui::Checkbox("Benchmark with AI Control", &_nfs_benchmark_ai_control);
+#endif
+		modified |= ImGui::SliderInt("Benchmark Warm-up", reinterpret_cast<int *>(&_nfs_benchmark_warmup), 0, 60, "%d s", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderInt("Benchmark Duration", reinterpret_cast<int *>(&_nfs_benchmark_duration), 5, 600, "%d s", ImGuiSliderFlags_AlwaysClamp);
+		modified |= imgui::directory_input_box("Benchmark Report Path", _nfs_benchmark_path, _file_selection_path);
+		ImGui::Separator();
 
-		if (ImGui::CollapsingHeader("Precipitation & Weather", ImGuiTreeNodeFlags_None))
+		switch (_nfs_benchmark_state)
 		{
-			ImGui::Checkbox("Precipitation Enable", (bool*)PRECIPITATION_ENABLE_ADDR);
-			ImGui::Checkbox("Precipitation Render", (bool*)PRECIPITATION_RENDER_ADDR);
-			ImGui::Checkbox("Precipitation Debug Enable", (bool*)PRECIPITATION_DEBUG_ADDR);
-			ImGui::Separator();
-			ImGui::TextUnformatted("Values");
-			if (ImGui::CollapsingHeader("General", ImGuiTreeNodeFlags_None))
+		case nfs_benchmark_state::idle:
+			if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_IN_FRONTEND)
 			{
-				ImGui::InputFloat("Precipitation Percentage", (float*)PRECIPITATION_PERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound X", (float*)PRECIP_BOUNDX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound Y", (float*)PRECIP_BOUNDY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound Z", (float*)PRECIP_BOUNDZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead X", (float*)PRECIP_AHEADX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead Y", (float*)PRECIP_AHEADY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead Z", (float*)PRECIP_AHEADZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Weather Change", (float*)PRECIP_WEATHERCHANGE_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Drive Factor", (float*)PRECIP_DRIVEFACTOR_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Prevailing Multiplier", (float*)PRECIP_PREVAILINGMULT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::Checkbox("Always Raining", (bool*)PRECIP_CHANCE100_ADDR);
-				ImGui::InputInt("Rain Type (restart world to see diff.)", &GlobalRainType, 1, 100, ImGuiInputTextFlags_None);
+				if (ImGui::Button("Start Benchmark", ImVec2(ImGui::CalcItemWidth(), 0)))
+					start_nfs_benchmark();
 			}
-			if (ImGui::CollapsingHeader("Wind", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Wind Angle", (float*)PRECIP_WINDANG_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Max Sway", (float*)PRECIP_SWAYMAX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Max Wind Effect", (float*)PRECIP_MAXWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Road Dampness", ImGuiTreeNodeFlags_None))
+			else
 			{
-				ImGui::InputFloat("Base Dampness", (float*)PRECIP_BASEDAMPNESS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Uber Dampness", (float*)PRECIP_UBERDAMPNESS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				ImGui::TextUnformatted("Go to the front end to start a benchmark.");
 			}
-			if (ImGui::CollapsingHeader("On-screen FX", ImGuiTreeNodeFlags_None))
+			break;
+		case nfs_benchmark_state::loading:
+			ImGui::TextUnformatted("Benchmark: Loading track ...");
+			break;
+		case nfs_benchmark_state::warmup:
+			ImGui::TextUnformatted("Benchmark: Warming up ...");
+			break;
+		case nfs_benchmark_state::recording:
+			ImGui::Text("Benchmark: Recording (%zu frames) ...", _nfs_benchmark_samples.size());
+			break;
+		}
+
+		if (_nfs_benchmark_state != nfs_benchmark_state::idle && ImGui::Button("Cancel Benchmark", ImVec2(ImGui::CalcItemWidth(), 0)))
+			stop_nfs_benchmark(false);
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Render Toggle Sweep", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Flips each world render toggle for a number of frames while racing and compares frame time and ReShade GPU time against the frames right before, to rank the cost of each game feature.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::SliderInt("Sweep Measured Frames", reinterpret_cast<int *>(&_nfs_sweep_frames), 10, 1000, "%d", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderInt("Sweep Settle Frames", reinterpret_cast<int *>(&_nfs_sweep_settle_frames), 0, 300, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::SetItemTooltip("Frames to skip after each change before measuring. Should be at least 60 for the GPU times to settle.");
+
+		if (_nfs_sweep_active)
+		{
+			ImGui::Text("Sweep: Measuring \"%s\" (%zu of %zu) ...", NFSRenderToggles[_nfs_sweep_toggle_index].Name, _nfs_sweep_toggle_index + 1, NFSRenderToggles.size());
+			if (ImGui::Button("Cancel Sweep", ImVec2(ImGui::CalcItemWidth(), 0)))
+				stop_nfs_render_sweep(false);
+		}
+		else if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING && _nfs_benchmark_state == nfs_benchmark_state::idle)
+		{
+			if (ImGui::Button("Start Sweep", ImVec2(ImGui::CalcItemWidth(), 0)))
+				start_nfs_render_sweep();
+		}
+		else
+		{
+			ImGui::TextUnformatted("Start a race (without a benchmark running) to run a sweep.");
+		}
+
+		if (!_nfs_sweep_active && !_nfs_sweep_results.empty() &&
+			ImGui::BeginTable("##render_sweep", 4, ImGuiTableFlags_BordersInnerH | ImGuiTableFlags_SizingStretchProp))
+		{
+			ImGui::TableSetupColumn("Toggle");
+			ImGui::TableSetupColumn("Default");
+			ImGui::TableSetupColumn("Frame Time Cost");
+			ImGui::TableSetupColumn("ReShade GPU Cost");
+			ImGui::TableHeadersRow();
+
+			for (const nfs_sweep_result &result : _nfs_sweep_results)
 			{
-				ImGui::Checkbox("OverRide Enable", (bool*)PRECIP_ONSCREEN_OVERRIDE_ADDR);
-				ImGui::InputFloat("Drip Speed", (float*)PRECIP_ONSCREEN_DRIPSPEED_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Speed Mod", (float*)PRECIP_ONSCREEN_SPEEDMOD_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				const float sign = result.enabled_by_default ? 1.0f : -1.0f;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(NFSRenderToggles[result.toggle_index].Name);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(result.enabled_by_default ? "On" : "Off");
+				ImGui::TableNextColumn();
+				ImGui::Text("%+.3f ms", sign * (result.frame_time_baseline - result.frame_time_flipped));
+				ImGui::TableNextColumn();
+				ImGui::Text("%+.3f ms", sign * (result.gpu_time_baseline - result.gpu_time_flipped));
 			}
-			if (ImGui::CollapsingHeader("Fog", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::Checkbox("Fog Control OverRide", (bool*)FOG_CTRLOVERRIDE_ADDR);
-				ImGui::InputFloat("Precip. Fog Percentage", (float*)PRECIP_FOGPERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff", (float*)BASEFOG_FALLOFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff X", (float*)BASEFOG_FALLOFFX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff Y", (float*)BASEFOG_FALLOFFY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Weather Fog", (float*)BASEWEATHER_FOG_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Weather Fog Start", (float*)BASEWEATHER_FOG_START_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				if (ImGui::CollapsingHeader("Base Weather Fog Colour", ImGuiTreeNodeFlags_None))
-				{
-					if (ImGui::ColorPicker3("", (float*)&(FogColourPicker.x), ImGuiColorEditFlags_InputRGB | ImGuiColorEditFlags_PickerHueWheel))
-					{
-						*(int*)BASEWEATHER_FOG_COLOUR_R_ADDR = (int)(FogColourPicker.x * 255);
-						*(int*)BASEWEATHER_FOG_COLOUR_G_ADDR = (int)(FogColourPicker.y * 255);
-						*(int*)BASEWEATHER_FOG_COLOUR_B_ADDR = (int)(FogColourPicker.z * 255);
-					}
-				}
-			}
-			if (ImGui::CollapsingHeader("Rain", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Rain X", (float*)PRECIP_RAINX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Y", (float*)PRECIP_RAINY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Z", (float*)PRECIP_RAINZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Z Constant", (float*)PRECIP_RAINZCONSTANT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius X", (float*)PRECIP_RAINRADIUSX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius Y", (float*)PRECIP_RAINRADIUSY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius Z", (float*)PRECIP_RAINRADIUSZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Wind Effect", (float*)PRECIP_RAINWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Percentage", (float*)PRECIP_RAINPERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain in the headlights", (float*)PRECIP_RAININTHEHEADLIGHTS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Snow", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Snow X", (float*)PRECIP_SNOWX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Y", (float*)PRECIP_SNOWY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Z", (float*)PRECIP_SNOWZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Z Constant", (float*)PRECIP_SNOWZCONSTANT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Radius X", (float*)PRECIP_SNOWRADIUSX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Radius Y", (float*)PRECIP_SNOWRADIUSY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Radius Z", (float*)PRECIP_SNOWRADIUSZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Wind Effect", (float*)PRECIP_SNOWWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Snow Percentage", (float*)PRECIP_SNOWPERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Sleet", ImGuiTreeNodeFlags_None))
+
+			ImGui::EndTable();
+		}
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Memory Watch", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Samples game variables alongside the frame time into a history, to correlate game state with performance. Pointer chains are only walked again when the GameFlow state changes.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Enable Sampling", &_nfs_watch_enabled);
+		modified |= ImGui::SliderInt("Sample Rate", reinterpret_cast<int *>(&_nfs_watch_sample_rate), 0, 240, _nfs_watch_sample_rate == 0 ? "Every Frame" : "%d Hz", ImGuiSliderFlags_AlwaysClamp);
+
+		if (ImGui::Button("Resolve Pointers", ImVec2(10 * _font_size - _imgui_context->Style.ItemSpacing.x, 0)))
+			resolve_nfs_watches();
+		ImGui::SetItemTooltip("Walks all pointer chains again, e.g. after a profile was loaded without the GameFlow state changing.");
+		ImGui::SameLine();
+		if (ImGui::Button("Clear History", ImVec2(10 * _font_size - _imgui_context->Style.ItemSpacing.x, 0)))
+		{
+			_nfs_watch_history_index = 0;
+			_nfs_watch_history_count = 0;
+		}
+		ImGui::Separator();
+
+		const int history_count = static_cast<int>(_nfs_watch_history_count);
+		const int history_offset = _nfs_watch_history_count < NFS_WATCH_HISTORY_SIZE ? 0 : static_cast<int>(_nfs_watch_history_index);
+		const size_t last_index = (_nfs_watch_history_index + NFS_WATCH_HISTORY_SIZE - 1) % NFS_WATCH_HISTORY_SIZE;
+
+		char overlay[64] = "";
+		if (history_count != 0)
+			std::snprintf(overlay, std::size(overlay), "%.3f ms", _nfs_watch_frame_times[last_index]);
+		ImGui::PlotLines("Frame Time", _nfs_watch_frame_times, history_count, history_offset, overlay, 0.0f, FLT_MAX, ImVec2(0, 3 * _font_size));
+
+		for (size_t i = 0; i < _nfs_watches.size(); ++i)
+		{
+			const nfs_watch &watch = _nfs_watches[i];
+
+			if (watch.resolved == nullptr)
+				std::snprintf(overlay, std::size(overlay), "Unresolved");
+			else if (history_count == 0)
+				overlay[0] = '\0';
+			else
+				std::snprintf(overlay, std::size(overlay), watch.type == nfs_watch_float32 ? "%.3f" : "%.0f", watch.history[last_index]);
+
+			ImGui::PushID(static_cast<int>(i));
+			ImGui::PlotLines(watch.name.c_str(), watch.history.data(), history_count, history_offset, overlay, FLT_MAX, FLT_MAX, ImVec2(0, 3 * _font_size));
+
+			if (!watch.builtin && ImGui::BeginPopupContextItem("##watch_context"))
 			{
-				ImGui::InputFloat("Sleet X", (float*)PRECIP_SLEETX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Y", (float*)PRECIP_SLEETY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Z", (float*)PRECIP_SLEETZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Z Constant", (float*)PRECIP_SLEETZCONSTANT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Radius X", (float*)PRECIP_SLEETRADIUSX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Radius Y", (float*)PRECIP_SLEETRADIUSY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Radius Z", (float*)PRECIP_SLEETRADIUSZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Sleet Wind Effect", (float*)PRECIP_SLEETWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				if (ImGui::Button("Remove Watch", ImVec2(10 * _font_size, 0)))
+				{
+					_nfs_watches.erase(_nfs_watches.begin() + i);
+					modified = true;
+					ImGui::CloseCurrentPopup();
+				}
+				ImGui::EndPopup();
 			}
-			if (ImGui::CollapsingHeader("Hail", ImGuiTreeNodeFlags_None))
+			ImGui::PopID();
+		}
+		ImGui::Separator();
+
+		ImGui::InputText("Watch Name", NewWatchName, sizeof(NewWatchName));
+		ImGui::Combo("Watch Type", &NewWatchType, WatchTypeNames, static_cast<int>(std::size(WatchTypeNames)));
+		ImGui::InputTextWithHint("Watch Address", "e.g. 00A712AC", NewWatchBase, sizeof(NewWatchBase), ImGuiInputTextFlags_CharsHexadecimal);
+		ImGui::InputTextWithHint("Watch Offsets", "e.g. 0xD4 0x0 0x24330", NewWatchOffsets, sizeof(NewWatchOffsets));
+		ImGui::SetItemTooltip("Pointer chain, where each offset is added to the address the previous one points to. Leave empty to watch the address directly.");
+
+		if (ImGui::Button("Add Watch", ImVec2(ImGui::CalcItemWidth(), 0)) && NewWatchName[0] != '\0')
+		{
+			std::vector<int32_t> offsets;
+			for (const char *p = NewWatchOffsets; *p != '\0';)
 			{
-				ImGui::InputFloat("Hail X", (float*)PRECIP_HAILX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Y", (float*)PRECIP_HAILY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Z", (float*)PRECIP_HAILZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Z Constant", (float*)PRECIP_HAILZCONSTANT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Radius X", (float*)PRECIP_HAILRADIUSX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Radius Y", (float*)PRECIP_HAILRADIUSY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Radius Z", (float*)PRECIP_HAILRADIUSZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Hail Wind Effect", (float*)PRECIP_HAILWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				char *end = nullptr;
+				const long offset = std::strtol(p, &end, 0);
+				if (end == p)
+				{
+					p++; // Skip separators
+					continue;
+				}
+				offsets.push_back(static_cast<int32_t>(offset));
+				p = end;
 			}
 
+			// Separator characters of the configuration format are not allowed in names
+			std::string name = NewWatchName;
+			std::replace(name.begin(), name.end(), '|', ' ');
+
+			add_nfs_watch(std::move(name), NewWatchType, std::strtoul(NewWatchBase, nullptr, 16), std::move(offsets));
+			modified = true;
 		}
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Frame Limiter", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Caps the frame rate right before present, using a high resolution waitable timer followed by a short spin. Physics in these games depend on the frame rate, so stable frame times matter more than the highest possible frame rate.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Enable Frame Limiter", &_frame_limit_enabled);
+		modified |= ImGui::SliderInt("Target FPS", reinterpret_cast<int *>(&_frame_limit_fps), 20, 240, "%d", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderInt("Spin Time (us)", reinterpret_cast<int *>(&_frame_limit_spin_time), 0, 4000, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::SetItemTooltip("Time before the targeted frame boundary at which to stop sleeping and start spinning.\nHigher values are more precise, but use more CPU time.");
+#if defined(GAME_PS) || defined(GAMESPEED_ADDR)
+		modified |= ImGui::Checkbox("Compensate Game Speed", &_frame_limit_game_speed_compensation);
+		ImGui::SetItemTooltip("Scales the game speed by how much longer frames take than targeted, so that the simulation keeps up with real time when the frame rate cannot be held.");
+		if (_frame_limit_compensating)
+			ImGui::Text("Game Speed Factor: %.3f", _frame_limit_game_speed_factor);
 #endif
-#ifdef HAS_FOG_CTRL
-#ifndef OLD_NFS
-		if (ImGui::CollapsingHeader("Precipitation & Weather", ImGuiTreeNodeFlags_None))
+
+		if (_frame_limit_jitter_count != 0)
 		{
-			ImGui::Checkbox("Precipitation Enable", (bool*)PRECIPITATION_ENABLE_ADDR);
-			ImGui::Checkbox("Precipitation Render", (bool*)PRECIPITATION_RENDER_ADDR);
-			ImGui::Checkbox("Precipitation Debug Enable", (bool*)PRECIPITATION_DEBUG_ADDR);
-			ImGui::Separator();
-			ImGui::TextUnformatted("Values");
-			if (ImGui::CollapsingHeader("General", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Precipitation Percentage", (float*)PRECIPITATION_PERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound X", (float*)PRECIP_BOUNDX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound Y", (float*)PRECIP_BOUNDY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Bound Z", (float*)PRECIP_BOUNDZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead X", (float*)PRECIP_AHEADX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead Y", (float*)PRECIP_AHEADY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Ahead Z", (float*)PRECIP_AHEADZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Drive Factor", (float*)PRECIP_DRIVEFACTOR_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Prevailing Multiplier", (float*)PRECIP_PREVAILINGMULT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Camera Mod", (float*)PRECIP_CAMERAMOD_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Wind", ImGuiTreeNodeFlags_None))
+			float jitter_mean = 0.0f, jitter_max = 0.0f, jitter_variance = 0.0f;
+			for (size_t i = 0; i < _frame_limit_jitter_count; ++i)
 			{
-				ImGui::InputFloat("Wind Angle", (float*)PRECIP_WINDANG_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Max Sway", (float*)PRECIP_SWAYMAX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Max Wind Effect", (float*)PRECIP_MAXWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				jitter_mean += std::abs(_frame_limit_jitter[i]);
+				jitter_max = std::max(jitter_max, std::abs(_frame_limit_jitter[i]));
 			}
-			if (ImGui::CollapsingHeader("Road Dampness", ImGuiTreeNodeFlags_None))
-			{
-#ifdef GAME_MW
-				ImGui::InputFloat("Base Dampness", (float*)PRECIP_BASEDAMPNESS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-#endif
-#ifdef GAME_CARBON
-				ImGui::InputFloat("Wet Dampness", (float*)PRECIP_WETDAMPNESS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Dry Dampness", (float*)PRECIP_DRYDAMPNESS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+			jitter_mean /= _frame_limit_jitter_count;
+			for (size_t i = 0; i < _frame_limit_jitter_count; ++i)
+				jitter_variance += _frame_limit_jitter[i] * _frame_limit_jitter[i];
+			jitter_variance /= _frame_limit_jitter_count;
+
+			ImGui::Text("Jitter: %.1f us average, %.1f us RMS, %.1f us max", jitter_mean, std::sqrt(jitter_variance), jitter_max);
+
+			// Plot the history in chronological order, starting with the oldest sample
+			const size_t offset = _frame_limit_jitter_count < FRAME_LIMIT_HISTORY_SIZE ? 0 : _frame_limit_jitter_index;
+			ImGui::PlotLines("##frame_limit_jitter", _frame_limit_jitter, static_cast<int>(_frame_limit_jitter_count), static_cast<int>(offset), "Frame interval deviation (us)", -jitter_max, jitter_max, ImVec2(0, 60));
+		}
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Dynamic Resolution", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Lowers the internal resolution of effects with techniques that opt in through the \"dynamic_resolution\" annotation while the GPU time of all enabled techniques exceeds the budget, and raises it again once there is headroom. Effects read the current scale through a uniform with the \"dynamic_resolution\" source to upsample.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Enable Dynamic Resolution", &_nfs_dynamic_resolution);
+		modified |= ImGui::SliderFloat("GPU Budget (ms)", &_nfs_dynamic_resolution_budget, 0.5f, 16.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+
+		if (_nfs_dynamic_resolution)
+		{
+			ImGui::Text("GPU Time: %.3f ms", get_enabled_techniques_gpu_time());
+
+			for (const effect &effect : _effects)
+				if (effect.min_resolution_scale < 1.0f)
+					ImGui::Text("%s: %.0f%% (minimum %.0f%%)", effect.source_file.filename().u8string().c_str(), effect.resolution_scale * 100.0f, effect.min_resolution_scale * 100.0f);
+		}
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Foveation", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Restricts techniques that opt in through the \"foveated\" annotation to the centre region of each eye in VR, leaving the periphery without them. Only passes at full resolution are restricted, since those are the most expensive.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		ImGui::BeginDisabled(!_is_vr);
+		modified |= ImGui::Checkbox("Enable Foveation", &_nfs_foveation);
+		modified |= ImGui::SliderFloat("Centre Region", &_nfs_foveation_region, 0.25f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::EndDisabled();
+	}
+#ifdef HAS_PRECIP_BUDGET
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Precipitation Budget", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Scales down the rain density and the volume rain is spawned in while it is raining and the average frame time exceeds the target, and raises them again once there is headroom. The values the game set are restored when disabled.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Enable Precipitation Budget", &_nfs_precipitation_budget);
+		modified |= ImGui::SliderFloat("Target Frame Time (ms)", &_nfs_precipitation_budget_frame_time, 4.0f, 50.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderFloat("Minimum Rain Scale", &_nfs_precipitation_budget_min_scale, 0.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
 
+		if (_nfs_precipitation_budget_applied)
+			ImGui::Text("Rain Scale: %.0f%%", _nfs_precipitation_budget_scale * 100.0f);
+	}
 #endif
-			}
-			if (ImGui::CollapsingHeader("On-screen FX", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Drip Speed", (float*)PRECIP_ONSCREEN_DRIPSPEED_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Speed Mod", (float*)PRECIP_ONSCREEN_SPEEDMOD_ADDR, 0.0001, 0.001, "%.6f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Drop Shape Speed Change", (float*)PRECIP_ONSCREEN_DROPSHAPESPEEDCHANGE_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Fog", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::Checkbox("Fog Control OverRide", (bool*)FOG_CTRLOVERRIDE_ADDR);
-				ImGui::InputFloat("Precip. Fog Percentage", (float*)PRECIP_FOGPERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff", (float*)BASEFOG_FALLOFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff X", (float*)BASEFOG_FALLOFFX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Falloff Y", (float*)BASEFOG_FALLOFFY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-#ifdef GAME_CARBON
-				ImGui::InputFloat("Base Fog End", (float*)BASEFOGEND_NONPS2_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Fog Exponent", (float*)BASEFOGEXPONENT_NONPS2_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("World Detail Governor", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Applies the steps of the quality ladder one after another while racing and the 95th percentile frame time exceeds the budget, and reverts them again in reverse order once it drops below the budget times the hysteresis. The ladder is set through the \"WorldDetailLadder\" key in the NFS section of the configuration, as a comma-separated list of \"Toggle Name=value\" entries using the names of the render toggle sweep.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Enable World Detail Governor", &_nfs_world_detail);
+		modified |= ImGui::SliderFloat("Frame Time Budget (ms)", &_nfs_world_detail_budget, 4.0f, 50.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+		modified |= ImGui::SliderFloat("Hysteresis", &_nfs_world_detail_hysteresis, 0.5f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+
+		for (size_t i = 0; i < _nfs_world_detail_steps.size(); ++i)
+		{
+			const nfs_world_detail_step &step = _nfs_world_detail_steps[i];
+			ImGui::Text("%s %zu: %s = %d", i < _nfs_world_detail_level ? ">" : " ", i + 1, NFSRenderToggles[step.toggle_index].Name, step.value);
+		}
+		if (_nfs_world_detail_steps.empty())
+			ImGui::TextUnformatted("The quality ladder is empty.");
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Background Work", ImGuiTreeNodeFlags_None))
+	{
+		ImGui::PushTextWrapPos();
+		ImGui::TextUnformatted("Runs effect compilation, texture loading and cache writes at a lower priority and on fewer threads while racing, and at full speed on loading screens and in the front end. With a frame time budget set, the throttle only kicks in while racing and the frame time exceeds it.");
+		ImGui::PopTextWrapPos();
+		ImGui::Separator();
+
+		modified |= ImGui::Checkbox("Throttle Workers While Racing", &_nfs_worker_throttle);
+		int throttle_threads = static_cast<int>(_nfs_worker_throttle_threads);
+		if (ImGui::SliderInt("Threads While Throttled", &throttle_threads, 1, static_cast<int>(std::max<size_t>(_worker_pool->size(), 1)), "%d", ImGuiSliderFlags_AlwaysClamp))
+		{
+			_nfs_worker_throttle_threads = static_cast<unsigned int>(throttle_threads);
+			_nfs_worker_throttle_changed = true;
+			modified = true;
+		}
+		modified |= ImGui::SliderFloat("Frame Time Budget (ms)##worker_throttle", &_nfs_worker_throttle_budget, 0.0f, 50.0f, _nfs_worker_throttle_budget > 0.0f ? "%.1f" : "Off", ImGuiSliderFlags_AlwaysClamp);
+		if (ImGui::Checkbox("Keep Workers Off Game Threads", &_nfs_worker_throttle_avoid_game_threads))
+		{
+			_nfs_worker_throttle_changed = true;
+			modified = true;
+		}
+
+		ImGui::Text("Workers: %s", _nfs_worker_throttled ? "throttled" : "full speed");
+	}
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_None))
+	{
+#ifdef GAME_UC
+		if (ImGui::Checkbox("Motion Blur", &bMotionBlur))
+		{
+			modified = true;
+		}
+		ImGui::SliderFloat("Bloom Scale", (float*)0x00D5E154, -10.0, 10.0, "%.3f", ImGuiSliderFlags_None);
 #endif
-#ifdef GAME_CARBON
-				ImGui::InputFloat("Base Weather Fog", (float*)BASEWEATHERFOG_NONPS2_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Base Weather Fog (PS2 value)", (float*)BASEWEATHER_FOG_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+#ifndef OLD_NFS
+#ifdef GAME_PS
+		// While the frame limiter compensates the game speed, edit the speed it applies its factor to instead
+		ImGui::InputFloat("Game Speed", _frame_limit_compensating ? &_frame_limit_base_game_speed : &GameSpeed, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
 #else
-				ImGui::InputFloat("Base Weather Fog)", (float*)BASEWEATHER_FOG_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+		ImGui::InputFloat("Game Speed", _frame_limit_compensating ? &_frame_limit_base_game_speed : (float*)GAMESPEED_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+		ImGui::Checkbox("Visual Look Filter", (bool*)APPLYVISUALLOOK_ADDR);
 #endif
-				ImGui::InputFloat("Base Weather Fog Start", (float*)BASEWEATHER_FOG_START_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				if (ImGui::CollapsingHeader("Base Weather Fog Colour", ImGuiTreeNodeFlags_None))
-				{
-					//ImGui::InputInt("R", (int*)BASEWEATHER_FOG_COLOUR_R_ADDR, 1, 100, ImGuiInputTextFlags_None);
-					//ImGui::InputInt("G", (int*)BASEWEATHER_FOG_COLOUR_G_ADDR, 1, 100, ImGuiInputTextFlags_None);
-					//ImGui::InputInt("B", (int*)BASEWEATHER_FOG_COLOUR_B_ADDR, 1, 100, ImGuiInputTextFlags_None);
-					if (ImGui::ColorPicker3("", (float*)&(FogColourPicker.x), ImGuiColorEditFlags_InputRGB | ImGuiColorEditFlags_PickerHueWheel))
-					{
-						*(int*)BASEWEATHER_FOG_COLOUR_R_ADDR = (int)(FogColourPicker.x * 255);
-						*(int*)BASEWEATHER_FOG_COLOUR_G_ADDR = (int)(FogColourPicker.y * 255);
-						*(int*)BASEWEATHER_FOG_COLOUR_B_ADDR = (int)(FogColourPicker.z * 255);
-					}
-#ifdef GAME_CARBON
-					ImGui::Separator();
+		ImGui::InputInt(PrecullerModeNames[*(int*)PRECULLERMODE_ADDR], (int*)PRECULLERMODE_ADDR, 1, 100, ImGuiInputTextFlags_None);
+		*(int*)PRECULLERMODE_ADDR %= 4;
+		if (*(int*)PRECULLERMODE_ADDR < 0)
+			*(int*)PRECULLERMODE_ADDR = 3;
 #endif
-				}
-#ifdef GAME_CARBON
-				//ImGui::InputFloat("Base Sky Fog Falloff", (float*)BASESKYFOGFALLOFF_ADDR, 0.001, 0.01, "%.6f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::SliderFloat("Base Sky Fog Falloff", (float*)BASESKYFOGFALLOFF_ADDR, -0.005, 0.005, "%.6f");
-				ImGui::InputFloat("Base Sky Fog Offset", (float*)BASESKYFOGOFFSET_ADDR, 0.1, 1.00, "%.3f", ImGuiInputTextFlags_CharsScientific);
+#ifdef GAME_UG2
+		ImGui::Checkbox("Draw Cars", (bool*)DRAWCARS_ADDR);
+		ImGui::Checkbox("Draw Car Reflections", (bool*)DRAWCARSREFLECTIONS_ADDR);
+		ImGui::Checkbox("Draw Light Flares", (bool*)DRAWLIGHTFLARES_ADDR);
+		ImGui::Checkbox("Draw Fancy Car Shadows", (bool*)DRAWFANCYCARSHADOW_ADDR);
+		ImGui::InputFloat("Fancy Car Shadow Edge Mult.", (float*)FANCYCARSHADOWEDGEMULT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+		ImGui::InputFloat("Wheel Pivot Translation Amount", (float*)WHEELPIVOTTRANSLATIONAMOUNT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+		ImGui::InputFloat("Wheel Standard Width", (float*)WHEELSTANDARDWIDTH_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
 #endif
-			}
-			if (ImGui::CollapsingHeader("Clouds", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Rate of change", (float*)PRECIP_CLOUDSRATEOFCHANGE_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
-			if (ImGui::CollapsingHeader("Rain", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Rain X", (float*)PRECIP_RAINX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Y", (float*)PRECIP_RAINY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Z", (float*)PRECIP_RAINZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Z Constant", (float*)PRECIP_RAINZCONSTANT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius X", (float*)PRECIP_RAINRADIUSX_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius Y", (float*)PRECIP_RAINRADIUSY_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Radius Z", (float*)PRECIP_RAINRADIUSZ_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Wind Effect", (float*)PRECIP_RAINWINDEFF_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Percentage", (float*)PRECIP_RAINPERCENT_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain in the headlights", (float*)PRECIP_RAININTHEHEADLIGHTS_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Rain Rate of change", (float*)PRECIP_RAINRATEOFCHANGE_ADDR, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-			}
+#ifdef HAS_WEATHER_TWEAKS
+		if (ImGui::CollapsingHeader("Precipitation & Weather", ImGuiTreeNodeFlags_None))
+		{
+			DrawNFSTweaks(NFSPrecipitationTweaks);
+			ImGui::Separator();
+			ImGui::TextUnformatted("Values");
+			DrawNFSTweaks(NFSWeatherTweaks);
 		}
 #endif
-#endif
 #ifdef GAME_MW
 		if (ImGui::CollapsingHeader("Visual Filter Control", ImGuiTreeNodeFlags_None))
 		{
@@ -6292,7 +7874,7 @@ void reshade::runtime::draw_gui_nfs()
 	{
 #ifdef GAME_MW
 		char* moviefilename_pointer = (char*)MOVIEFILENAME_ADDR;
-		if (*(int*)GAMEFLOWMGR_STATUS_ADDR == GAMEFLOW_STATE_RACING)
+		if (_nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING)
 			moviefilename_pointer = (char*)INGAMEMOVIEFILENAME_ADDR;
 		ImGui::InputText("Movie Filename", moviefilename_pointer, 0x40);
 #else
@@ -6301,7 +7883,7 @@ void reshade::runtime::draw_gui_nfs()
 		if (ImGui::Button("Play Movie", ImVec2(ImGui::CalcItemWidth(), 0)))
 		{
 #ifdef NFS_MULTITHREAD
-			bDoPlayMovie = true;
+			QueueGameThreadCommand(GAMETHREAD_CMD_PLAY_MOVIE);
 #else
 			PlayMovie();
 #endif
@@ -6532,93 +8114,943 @@ void reshade::runtime::draw_gui_nfs()
 #ifndef OLD_NFS
 	if (ImGui::CollapsingHeader("Rub Test", ImGuiTreeNodeFlags_None))
 	{
-#ifndef GAME_MW
-#ifdef GAME_PS
-		ImGui::Checkbox("Draw World", &bDrawWorld);
-#else
-		ImGui::Checkbox("Draw World", (bool*)DRAWWORLD_ADDR); // TODO - find / make the toggle for MW
-#endif
-#endif
-		ImGui::Checkbox("Draw Cars", (bool*)DRAWCARS_ADDR);
+#ifndef GAME_MW
+#ifdef GAME_PS
+		ImGui::Checkbox("Draw World", &bDrawWorld);
+#else
+		ImGui::Checkbox("Draw World", (bool*)DRAWWORLD_ADDR); // TODO - find / make the toggle for MW
+#endif
+#endif
+		ImGui::Checkbox("Draw Cars", (bool*)DRAWCARS_ADDR);
+	}
+	ImGui::Separator();
+#endif
+	if (ImGui::CollapsingHeader("Game", ImGuiTreeNodeFlags_None))
+	{
+#if defined(GAME_MW) || defined(GAME_UG2)
+		if (ImGui::CollapsingHeader("Build Version", ImGuiTreeNodeFlags_None))
+		{
+#ifdef GAME_UG2
+			ImGui::Text("Perforce Changelist Number: %d\nPerforce Changelist Name: %s\nBuild Machine: %s", *(int*)BUILDVERSIONCLNUMBER_ADDR, *(char**)BUILDVERSIONCLNAME_ADDR, *(char**)BUILDVERSIONMACHINE_ADDR); // TODO: make these flexible addresses...
+#else
+			ImGui::Text("Platform: %s\nBuild Type:%s%s\nPerforce Changelist Number: %d\nPerforce Changelist Name: %s\nBuild Date: %s\nBuild Machine: %s", (char*)BUILDVERSIONPLAT_ADDR, (char*)BUILDVERSIONNAME_ADDR, (char*)BUILDVERSIONOPTNAME_ADDR, *(int*)BUILDVERSIONCLNUMBER_ADDR, *(char**)BUILDVERSIONCLNAME_ADDR, *(char**)BUILDVERSIONDATE_ADDR, *(char**)BUILDVERSIONMACHINE_ADDR); // TODO: make these flexible addresses...
+#endif
+			ImGui::Separator();
+		}
+#endif
+#ifdef HAS_DAL
+		if (ImGui::CollapsingHeader("DAL Options", ImGuiTreeNodeFlags_None))
+		{
+			if (ImGui::CollapsingHeader("FrontEnd", ImGuiTreeNodeFlags_None))
+			{
+				ImGui::InputFloat("FE Scale", (float*)FESCALE_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				ImGui::Checkbox("Widescreen mode", (bool*)WIDESCREEN_POINTER);
+#ifdef GAME_CARBON
+				ImGui::Separator();
+				ImGui::Checkbox("Lap Info", (bool*)FELAPINFO_POINTER);
+				ImGui::Checkbox("Score", (bool*)FESCORE_POINTER);
+				ImGui::Checkbox("Leaderboard", (bool*)FELEADERBOARD_POINTER);
+				ImGui::Checkbox("Crew Info", (bool*)FECREWINFO_POINTER);
+				ImGui::Checkbox("Transmission Prompt", (bool*)FETRANSMISSIONPROMPT_POINTER);
+				ImGui::Checkbox("Rearview Mirror", (bool*)FERVM_POINTER);
+				ImGui::Checkbox("Picture In Picture", (bool*)FEPIP_POINTER);
+				ImGui::Checkbox("Metric Speedo Units", (bool*)SPEEDOUNIT_POINTER);
+#endif
+			}
+#ifdef GAME_CARBON
+			if (ImGui::CollapsingHeader("Input", ImGuiTreeNodeFlags_None))
+			{
+				ImGui::Checkbox("Rumble", (bool*)RUMBLEON_POINTER);
+				ImGui::InputInt("PC Pad Index", (int*)PCPADIDX_POINTER, 1, 100);
+				ImGui::InputInt("PC Device Type", (int*)PCDEVTYPE_POINTER, 1, 100);
+			}
+#endif
+			if (ImGui::CollapsingHeader("Gameplay", ImGuiTreeNodeFlags_None))
+			{
+				ImGui::InputFloat("Highlight Cam", (float*)HIGHLIGHTCAM_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+				ImGui::InputFloat("Time Of Day", (float*)TIMEOFDAY_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
+#ifdef GAME_CARBON
+				ImGui::Checkbox("Jump Cam", (bool*)JUMPCAM_POINTER);
+				ImGui::Checkbox("Car Damage", (bool*)DAMAGEON_POINTER);
+				ImGui::Checkbox("Autosave", (bool*)AUTOSAVEON_POINTER);
+#endif
+			}
+			if (ImGui::CollapsingHeader("Audio Levels", ImGuiTreeNodeFlags_None))
+			{
+				ImGui::SliderFloat("Master", (float*)MASTERVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Speech", (float*)SPEECHVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("FE Music", (float*)FEMUSICVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("IG Music", (float*)IGMUSICVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Sound Effects", (float*)SOUNDEFFECTSVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Engine", (float*)ENGINEVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Car", (float*)CARVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Ambient", (float*)AMBIENTVOL_POINTER, 0.0, 1.0);
+				ImGui::SliderFloat("Speed", (float*)SPEEDVOL_POINTER, 0.0, 1.0);
+			}
+
+		}
+		ImGui::Separator();
+#endif
+		if (ImGui::Button("Exit Game", ImVec2(ImGui::CalcItemWidth(), 0)))
+		{
+			*(int*)EXITGAMEFLAG_ADDR = 1;
+		}
+	}
+	ImGui::Separator();
+	ImGui::Text("GameFlow State: %s", GameFlowStateNames[_nfs_game_state.gameflow_state]);
+	ImGui::Separator();
+	if (modified)
+		save_config();
+}
+
+void reshade::runtime::on_nfs_present()
+{
+	if (_is_vr)
+		return;
+
+#if defined(GAME_MW) || defined(GAME_CARBON)
+	// These games update the world on the same thread they present on, so can advance pending teleports here
+	ServiceTeleportPrefetch();
+#endif
+
+	if (!_ignore_shortcuts && _input != nullptr && _input->is_key_pressed(_nfs_benchmark_key_data, _force_shortcut_modifiers))
+	{
+		if (_nfs_benchmark_state == nfs_benchmark_state::idle)
+			start_nfs_benchmark();
+		else
+			stop_nfs_benchmark(false);
+	}
+
+	update_nfs_watches();
+
+	if (_nfs_sweep_active)
+		update_nfs_render_sweep();
+
+	update_nfs_dynamic_resolution();
+	update_nfs_precipitation_budget();
+	update_nfs_world_detail();
+	update_nfs_visual_treatment_bypass();
+	update_nfs_worker_throttle();
+
+	if (_nfs_benchmark_state == nfs_benchmark_state::idle)
+		return;
+
+	const auto current_time = std::chrono::high_resolution_clock::now();
+	const bool is_racing = _nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING;
+
+	// Keep GPU timings up to date even when the statistics are not open in the overlay
+	_gather_gpu_statistics = true;
+
+	switch (_nfs_benchmark_state)
+	{
+	case nfs_benchmark_state::loading:
+		if (!is_racing)
+		{
+			if (current_time >= _nfs_benchmark_phase_end_time)
+			{
+				log::message(log::level::error, "Benchmark timed out waiting for the track to load.");
+				stop_nfs_benchmark(false);
+			}
+			break;
+		}
+
+#ifndef OLD_NFS
+		if (_nfs_benchmark_ai_control)
+		{
+			ToggleAIControl();
+			_nfs_benchmark_ai_control_toggled = true;
+		}
+#endif
+
+		_nfs_benchmark_state = nfs_benchmark_state::warmup;
+		_nfs_benchmark_phase_end_time = current_time + std::chrono::seconds(_nfs_benchmark_warmup);
+		break;
+	case nfs_benchmark_state::warmup:
+		if (!is_racing)
+		{
+			log::message(log::level::warning, "Benchmark was canceled because the race ended during warm-up.");
+			stop_nfs_benchmark(false);
+			break;
+		}
+
+		if (current_time >= _nfs_benchmark_phase_end_time)
+		{
+			_nfs_benchmark_state = nfs_benchmark_state::recording;
+			_nfs_benchmark_phase_end_time = current_time + std::chrono::seconds(_nfs_benchmark_duration);
+
+			_nfs_benchmark_samples.clear();
+			_nfs_benchmark_samples.reserve(static_cast<size_t>(_nfs_benchmark_duration) * 240);
+
+			log::message(log::level::info, "Recording benchmark for %u seconds.", _nfs_benchmark_duration);
+		}
+		break;
+	case nfs_benchmark_state::recording:
+		if (!is_racing)
+		{
+			log::message(log::level::warning, "Race ended before the benchmark duration elapsed, saving the %zu frame(s) recorded so far.", _nfs_benchmark_samples.size());
+			stop_nfs_benchmark(true);
+			break;
+		}
+
+		{
+			nfs_benchmark_sample &sample = _nfs_benchmark_samples.emplace_back();
+			sample.frame_time = _last_frame_duration.count() * 1e-6f;
+
+			// Sum up all stages of the frame that was just presented
+			const size_t history_index = (_present_stage_history_index + PRESENT_STAGE_HISTORY_SIZE - 1) % PRESENT_STAGE_HISTORY_SIZE;
+			uint64_t reshade_cpu_time = 0;
+			for (size_t stage = 0; stage < static_cast<size_t>(api::present_stage::count); ++stage)
+				reshade_cpu_time += _present_stage_durations[stage][history_index];
+			sample.reshade_cpu_time = reshade_cpu_time * 1e-6f;
+
+			sample.reshade_gpu_time = get_enabled_techniques_gpu_time();
+		}
+
+		if (current_time >= _nfs_benchmark_phase_end_time)
+			stop_nfs_benchmark(true);
+		break;
+	}
+}
+
+void reshade::runtime::start_nfs_benchmark()
+{
+	if (_nfs_benchmark_state != nfs_benchmark_state::idle || _nfs_sweep_active)
+		return;
+
+	if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_IN_FRONTEND)
+	{
+		log::message(log::level::error, "Failed to start benchmark because the game is not in the front end.");
+		return;
+	}
+
+	// Apply the fixed race setup, so that every run is comparable
+	*(int*)SKIPFE_NUMAICARS_ADDR = _nfs_benchmark_num_ai_cars;
+	*(int*)SKIPFE_RACETYPE_ADDR = _nfs_benchmark_race_type;
+#ifndef GAME_UC
+#ifdef OLD_NFS
+	*(int*)SKIPFE_TRAFFICDENSITY_ADDR = static_cast<int>(_nfs_benchmark_traffic_density);
+#else
+	*(float*)SKIPFE_TRAFFICDENSITY_ADDR = _nfs_benchmark_traffic_density;
+#endif
+#endif
+#ifdef PRECIPITATION_PERCENT_ADDR
+	if (_nfs_benchmark_precipitation >= 0.0f)
+	{
+		*(bool*)PRECIPITATION_ENABLE_ADDR = _nfs_benchmark_precipitation > 0.0f;
+		*(float*)PRECIPITATION_PERCENT_ADDR = _nfs_benchmark_precipitation;
+	}
+#endif
+
+	log::message(log::level::info, "Starting benchmark on track %d with %d AI car(s).", _nfs_benchmark_track, _nfs_benchmark_num_ai_cars);
+
+	StartSkipFERace(_nfs_benchmark_track);
+
+	_nfs_benchmark_state = nfs_benchmark_state::loading;
+	_nfs_benchmark_phase_end_time = std::chrono::high_resolution_clock::now() + std::chrono::minutes(5);
+	_nfs_benchmark_samples.clear();
+}
+
+void reshade::runtime::stop_nfs_benchmark(bool save_report)
+{
+	if (_nfs_benchmark_state == nfs_benchmark_state::idle)
+		return;
+
+#ifndef OLD_NFS
+	// Give control back to the player if the race is still running
+	if (_nfs_benchmark_ai_control_toggled && _nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING)
+		ToggleAIControl();
+#endif
+	_nfs_benchmark_ai_control_toggled = false;
+
+	if (save_report && !_nfs_benchmark_samples.empty())
+		save_nfs_benchmark_report();
+	else if (!save_report)
+		log::message(log::level::info, "Benchmark was canceled.");
+
+	_nfs_benchmark_state = nfs_benchmark_state::idle;
+	_nfs_benchmark_samples.clear();
+	_nfs_benchmark_samples.shrink_to_fit();
+}
+
+bool reshade::runtime::save_nfs_benchmark_report() const
+{
+	const size_t count = _nfs_benchmark_samples.size();
+	if (count == 0)
+		return false;
+
+	std::vector<float> frame_times(count);
+	double total_frame_time = 0.0, total_cpu_time = 0.0, total_gpu_time = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		frame_times[i] = _nfs_benchmark_samples[i].frame_time;
+		total_frame_time += _nfs_benchmark_samples[i].frame_time;
+		total_cpu_time += _nfs_benchmark_samples[i].reshade_cpu_time;
+		total_gpu_time += _nfs_benchmark_samples[i].reshade_gpu_time;
+	}
+
+	std::sort(frame_times.begin(), frame_times.end());
+
+	const auto percentile = [&frame_times, count](double p) {
+		return frame_times[std::min(static_cast<size_t>(p * count), count - 1)];
+	};
+
+	// The "1% low" is the average frame rate of the slowest 1% of frames
+	const size_t low_count = std::max<size_t>(count / 100, 1);
+	double low_frame_time = 0.0;
+	for (size_t i = count - low_count; i < count; ++i)
+		low_frame_time += frame_times[i];
+	low_frame_time /= low_count;
+
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path report_path = g_reshade_base_path / _nfs_benchmark_path / std::filesystem::u8path(std::string("NFSBenchmark ") + timestamp);
+
+	std::error_code ec;
+	std::filesystem::create_directories(report_path.parent_path(), ec);
+
+	std::filesystem::path csv_path = report_path;
+	csv_path += L".csv";
+	FILE *const csv_file = _wfsopen(csv_path.c_str(), L"w", SH_DENYWR);
+	if (csv_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write benchmark report to '%s'!", csv_path.u8string().c_str());
+		return false;
+	}
+
+	std::fputs("frame,frame_time_ms,reshade_cpu_ms,reshade_gpu_ms\n", csv_file);
+	for (size_t i = 0; i < count; ++i)
+		std::fprintf(csv_file, "%zu,%.4f,%.4f,%.4f\n", i, _nfs_benchmark_samples[i].frame_time, _nfs_benchmark_samples[i].reshade_cpu_time, _nfs_benchmark_samples[i].reshade_gpu_time);
+	std::fclose(csv_file);
+
+	std::filesystem::path json_path = report_path;
+	json_path += L".json";
+	FILE *const json_file = _wfsopen(json_path.c_str(), L"w", SH_DENYWR);
+	if (json_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write benchmark report to '%s'!", json_path.u8string().c_str());
+		return false;
+	}
+
+	std::fprintf(json_file,
+		"{\n"
+		"\t\"track\": %d,\n"
+		"\t\"num_ai_cars\": %d,\n"
+		"\t\"traffic_density\": %.3f,\n"
+		"\t\"race_type\": %d,\n"
+		"\t\"precipitation\": %.3f,\n"
+		"\t\"ai_control\": %s,\n"
+		"\t\"preset\": \"%s\",\n"
+		"\t\"frames\": %zu,\n"
+		"\t\"duration_s\": %.3f,\n"
+		"\t\"average_fps\": %.3f,\n"
+		"\t\"low_1_percent_fps\": %.3f,\n"
+		"\t\"frame_time_ms\": { \"min\": %.4f, \"average\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n"
+		"\t\"reshade_cpu_ms\": { \"average\": %.4f },\n"
+		"\t\"reshade_gpu_ms\": { \"average\": %.4f }\n"
+		"}\n",
+		_nfs_benchmark_track,
+		_nfs_benchmark_num_ai_cars,
+		_nfs_benchmark_traffic_density,
+		_nfs_benchmark_race_type,
+		_nfs_benchmark_precipitation,
+		_nfs_benchmark_ai_control ? "true" : "false",
+		_current_preset_path.filename().u8string().c_str(),
+		count,
+		total_frame_time * 1e-3,
+		total_frame_time != 0.0 ? count * 1000.0 / total_frame_time : 0.0,
+		low_frame_time != 0.0 ? 1000.0 / low_frame_time : 0.0,
+		frame_times.front(), total_frame_time / count, percentile(0.5), percentile(0.99), frame_times.back(),
+		total_cpu_time / count,
+		total_gpu_time / count);
+	std::fclose(json_file);
+
+	log::message(log::level::info, "Saved benchmark report with %zu frame(s) to '%s'.", count, report_path.u8string().c_str());
+	return true;
+}
+
+void reshade::runtime::start_nfs_render_sweep()
+{
+	if (_nfs_sweep_active || _nfs_benchmark_state != nfs_benchmark_state::idle || NFSRenderToggles.empty())
+		return;
+
+	if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING)
+	{
+		log::message(log::level::error, "Failed to start render toggle sweep because the game is not racing.");
+		return;
+	}
+
+	// Measure against full world detail, rather than whatever the governor lowered it to
+	reset_nfs_world_detail();
+
+	log::message(log::level::info, "Starting render toggle sweep over %zu toggle(s) with %u frame(s) each.", NFSRenderToggles.size(), _nfs_sweep_frames);
+
+	_nfs_sweep_active = true;
+	_nfs_sweep_toggle_index = 0;
+	_nfs_sweep_original_value = GetRenderToggle(NFSRenderToggles[0]);
+	_nfs_sweep_phase = nfs_sweep_phase::settle_baseline;
+	_nfs_sweep_phase_frame = 0;
+	_nfs_sweep_results.clear();
+}
+
+void reshade::runtime::stop_nfs_render_sweep(bool save_report)
+{
+	if (!_nfs_sweep_active)
+		return;
+
+	_nfs_sweep_active = false;
+
+	if (_nfs_sweep_toggle_index < NFSRenderToggles.size())
+	{
+		SetRenderToggle(NFSRenderToggles[_nfs_sweep_toggle_index], _nfs_sweep_original_value);
+
+		// Drop the result of the toggle that was not fully measured yet
+		if (_nfs_sweep_phase == nfs_sweep_phase::settle_flipped || _nfs_sweep_phase == nfs_sweep_phase::measure_flipped)
+			_nfs_sweep_results.pop_back();
+	}
+
+	if (!save_report)
+	{
+		log::message(log::level::info, "Render toggle sweep was canceled.");
+		_nfs_sweep_results.clear();
+		return;
+	}
+
+	// Rank by how much frame time the enabled state of each toggle costs
+	std::sort(_nfs_sweep_results.begin(), _nfs_sweep_results.end(),
+		[](const nfs_sweep_result &lhs, const nfs_sweep_result &rhs) {
+			const float lhs_cost = (lhs.enabled_by_default ? 1.0f : -1.0f) * (lhs.frame_time_baseline - lhs.frame_time_flipped);
+			const float rhs_cost = (rhs.enabled_by_default ? 1.0f : -1.0f) * (rhs.frame_time_baseline - rhs.frame_time_flipped);
+			return lhs_cost > rhs_cost;
+		});
+
+	save_nfs_render_sweep_report();
+}
+
+void reshade::runtime::update_nfs_render_sweep()
+{
+	if (_nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING)
+	{
+		log::message(log::level::warning, "Race ended before the render toggle sweep finished, saving the %zu result(s) measured so far.", _nfs_sweep_results.size());
+		stop_nfs_render_sweep(true);
+		return;
+	}
+
+	// Keep GPU timings up to date even when the statistics are not open in the overlay
+	_gather_gpu_statistics = true;
+
+	const NFSRenderToggle &toggle = NFSRenderToggles[_nfs_sweep_toggle_index];
+
+	switch (_nfs_sweep_phase)
+	{
+	case nfs_sweep_phase::settle_baseline:
+	case nfs_sweep_phase::settle_flipped:
+		if (++_nfs_sweep_phase_frame >= _nfs_sweep_settle_frames)
+		{
+			_nfs_sweep_phase = _nfs_sweep_phase == nfs_sweep_phase::settle_baseline ? nfs_sweep_phase::measure_baseline : nfs_sweep_phase::measure_flipped;
+			_nfs_sweep_phase_frame = 0;
+			_nfs_sweep_frame_time_sum = 0.0;
+			_nfs_sweep_gpu_time_sum = 0.0;
+		}
+		break;
+	case nfs_sweep_phase::measure_baseline:
+	case nfs_sweep_phase::measure_flipped:
+		_nfs_sweep_frame_time_sum += _last_frame_duration.count() * 1e-6;
+		_nfs_sweep_gpu_time_sum += get_enabled_techniques_gpu_time();
+
+		if (++_nfs_sweep_phase_frame < _nfs_sweep_frames)
+			break;
+
+		if (_nfs_sweep_phase == nfs_sweep_phase::measure_baseline)
+		{
+			nfs_sweep_result &result = _nfs_sweep_results.emplace_back();
+			result.toggle_index = _nfs_sweep_toggle_index;
+			result.enabled_by_default = _nfs_sweep_original_value != 0;
+			result.frame_time_baseline = static_cast<float>(_nfs_sweep_frame_time_sum / _nfs_sweep_frames);
+			result.gpu_time_baseline = static_cast<float>(_nfs_sweep_gpu_time_sum / _nfs_sweep_frames);
+			result.frame_time_flipped = 0.0f;
+			result.gpu_time_flipped = 0.0f;
+
+			SetRenderToggle(toggle, _nfs_sweep_original_value != 0 ? 0 : 1);
+
+			_nfs_sweep_phase = nfs_sweep_phase::settle_flipped;
+			_nfs_sweep_phase_frame = 0;
+			break;
+		}
+
+		{
+			nfs_sweep_result &result = _nfs_sweep_results.back();
+			result.frame_time_flipped = static_cast<float>(_nfs_sweep_frame_time_sum / _nfs_sweep_frames);
+			result.gpu_time_flipped = static_cast<float>(_nfs_sweep_gpu_time_sum / _nfs_sweep_frames);
+		}
+
+		SetRenderToggle(toggle, _nfs_sweep_original_value);
+
+		if (++_nfs_sweep_toggle_index >= NFSRenderToggles.size())
+		{
+			stop_nfs_render_sweep(true);
+			break;
+		}
+
+		_nfs_sweep_original_value = GetRenderToggle(NFSRenderToggles[_nfs_sweep_toggle_index]);
+		_nfs_sweep_phase = nfs_sweep_phase::settle_baseline;
+		_nfs_sweep_phase_frame = 0;
+		break;
+	}
+}
+
+bool reshade::runtime::save_nfs_render_sweep_report() const
+{
+	if (_nfs_sweep_results.empty())
+		return false;
+
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path report_path = g_reshade_base_path / _nfs_benchmark_path / std::filesystem::u8path(std::string("NFSRenderSweep ") + timestamp + ".csv");
+
+	std::error_code ec;
+	std::filesystem::create_directories(report_path.parent_path(), ec);
+
+	FILE *const file = _wfsopen(report_path.c_str(), L"w", SH_DENYWR);
+	if (file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write render toggle sweep report to '%s'!", report_path.u8string().c_str());
+		return false;
+	}
+
+	// Costs are the difference between the toggle being on and off, regardless of which state it was in by default
+	std::fputs("rank,toggle,default,frame_time_cost_ms,reshade_gpu_cost_ms,frame_time_baseline_ms,frame_time_flipped_ms,reshade_gpu_baseline_ms,reshade_gpu_flipped_ms\n", file);
+	for (size_t i = 0; i < _nfs_sweep_results.size(); ++i)
+	{
+		const nfs_sweep_result &result = _nfs_sweep_results[i];
+		const float sign = result.enabled_by_default ? 1.0f : -1.0f;
+
+		std::fprintf(file, "%zu,%s,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+			i + 1,
+			NFSRenderToggles[result.toggle_index].Name,
+			result.enabled_by_default ? "on" : "off",
+			sign * (result.frame_time_baseline - result.frame_time_flipped),
+			sign * (result.gpu_time_baseline - result.gpu_time_flipped),
+			result.frame_time_baseline,
+			result.frame_time_flipped,
+			result.gpu_time_baseline,
+			result.gpu_time_flipped);
+	}
+	std::fclose(file);
+
+	log::message(log::level::info, "Saved render toggle sweep report with %zu result(s) to '%s'.", _nfs_sweep_results.size(), report_path.u8string().c_str());
+	return true;
+}
+
+void reshade::runtime::add_nfs_watch(std::string name, int type, uintptr_t base, std::vector<int32_t> offsets, bool builtin)
+{
+	nfs_watch &watch = _nfs_watches.emplace_back();
+	watch.name = std::move(name);
+	watch.type = type;
+	watch.base = base;
+	watch.offsets = std::move(offsets);
+	watch.builtin = builtin;
+	watch.history.resize(NFS_WATCH_HISTORY_SIZE);
+
+	// Force pointer chains to be resolved on the next sample
+	_nfs_watch_gameflow_state = -1;
+}
+
+void reshade::runtime::resolve_nfs_watches()
+{
+	for (nfs_watch &watch : _nfs_watches)
+	{
+		uintptr_t address = watch.base;
+		for (const int32_t offset : watch.offsets)
+		{
+			// The first 64 KiB are never mapped, which also catches null pointers with an offset applied
+			if (address < 0x10000)
+				break;
+			const uintptr_t pointer = *reinterpret_cast<const uintptr_t *>(address);
+			address = pointer != 0 ? pointer + offset : 0;
+		}
+
+		watch.resolved = address >= 0x10000 ? reinterpret_cast<const void *>(address) : nullptr;
+	}
+}
+
+void reshade::runtime::update_nfs_watches()
+{
+	if (!_nfs_watch_enabled || _nfs_watches.empty())
+		return;
+
+	// Pointer chains only change when the game loads or unloads something, so only walk them again when the game flow state changes
+	if (const int gameflow_state = _nfs_game_state.gameflow_state;
+		gameflow_state != _nfs_watch_gameflow_state)
+	{
+		_nfs_watch_gameflow_state = gameflow_state;
+		resolve_nfs_watches();
+	}
+
+	_nfs_watch_frame_time_sum += _last_frame_duration.count() * 1e-6;
+	_nfs_watch_frame_count++;
+
+	if (_nfs_watch_sample_rate != 0)
+	{
+		const auto current_time = std::chrono::high_resolution_clock::now();
+		if (current_time < _nfs_watch_next_sample_time)
+			return;
+		_nfs_watch_next_sample_time = current_time + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(1.0 / _nfs_watch_sample_rate));
+	}
+
+	_nfs_watch_frame_times[_nfs_watch_history_index] = static_cast<float>(_nfs_watch_frame_time_sum / _nfs_watch_frame_count);
+	_nfs_watch_frame_time_sum = 0.0;
+	_nfs_watch_frame_count = 0;
+
+	for (nfs_watch &watch : _nfs_watches)
+	{
+		float value = 0.0f;
+		if (watch.resolved != nullptr)
+		{
+			switch (watch.type)
+			{
+			case nfs_watch_int32:
+				value = static_cast<float>(*static_cast<const int32_t *>(watch.resolved));
+				break;
+			case nfs_watch_uint32:
+				value = static_cast<float>(*static_cast<const uint32_t *>(watch.resolved));
+				break;
+			case nfs_watch_float32:
+				value = *static_cast<const float *>(watch.resolved);
+				break;
+			case nfs_watch_uint8:
+				value = static_cast<float>(*static_cast<const uint8_t *>(watch.resolved));
+				break;
+			}
+		}
+
+		watch.history[_nfs_watch_history_index] = value;
+	}
+
+	_nfs_watch_history_index = (_nfs_watch_history_index + 1) % NFS_WATCH_HISTORY_SIZE;
+	_nfs_watch_history_count = std::min(_nfs_watch_history_count + 1, NFS_WATCH_HISTORY_SIZE);
+}
+
+void reshade::runtime::update_nfs_dynamic_resolution()
+{
+	if (!_nfs_dynamic_resolution || _nfs_capture_active)
+	{
+		for (effect &effect : _effects)
+			effect.resolution_scale = 1.0f;
+		_nfs_dynamic_resolution_frame = 0;
+		return;
+	}
+
+	// Keep GPU timings up to date even when the statistics are not open in the overlay
+	_gather_gpu_statistics = true;
+
+	if (++_nfs_dynamic_resolution_frame < DYNAMIC_RESOLUTION_INTERVAL)
+		return;
+	_nfs_dynamic_resolution_frame = 0;
+
+	const float gpu_time = get_enabled_techniques_gpu_time();
+	if (gpu_time == 0.0f)
+		return; // No timings were read back yet
+
+	// Sum up the GPU time of the techniques in each effect that are affected by its resolution scale
+	std::vector<float> effect_gpu_times(_effects.size());
+	for (const technique &tech : _techniques)
+		if (tech.enabled && tech.dynamic_resolution)
+			effect_gpu_times[tech.effect_index] += tech.average_gpu_duration * 1e-6f;
+
+	if (gpu_time > _nfs_dynamic_resolution_budget)
+	{
+		// Lower the resolution of the most expensive effect that can still go lower first
+		size_t effect_index = std::numeric_limits<size_t>::max();
+		for (size_t i = 0; i < _effects.size(); ++i)
+			if (effect_gpu_times[i] != 0.0f && _effects[i].resolution_scale > _effects[i].min_resolution_scale &&
+				(effect_index >= _effects.size() || effect_gpu_times[i] > effect_gpu_times[effect_index]))
+				effect_index = i;
+		if (effect_index >= _effects.size())
+			return;
+
+		// Pixel shader cost is roughly proportional to the area, so scale by the square root of the time that should be saved
+		effect &effect = _effects[effect_index];
+		const float target_gpu_time = std::max(effect_gpu_times[effect_index] - (gpu_time - _nfs_dynamic_resolution_budget), 0.0f);
+		const float scale = effect.resolution_scale * std::sqrt(target_gpu_time / effect_gpu_times[effect_index]);
+		effect.resolution_scale = std::max(std::min(scale, effect.resolution_scale - 0.05f), effect.min_resolution_scale);
+	}
+	else if (gpu_time < _nfs_dynamic_resolution_budget * 0.8f)
+	{
+		// Raise the resolution of the effect that was lowered the most again in small steps, leaving some headroom, so that it does not oscillate around the budget
+		size_t effect_index = std::numeric_limits<size_t>::max();
+		for (size_t i = 0; i < _effects.size(); ++i)
+			if (_effects[i].resolution_scale < 1.0f &&
+				(effect_index >= _effects.size() || _effects[i].resolution_scale < _effects[effect_index].resolution_scale))
+				effect_index = i;
+		if (effect_index >= _effects.size())
+			return;
+
+		_effects[effect_index].resolution_scale = std::min(_effects[effect_index].resolution_scale + 0.05f, 1.0f);
+	}
+}
+
+void reshade::runtime::update_nfs_precipitation_budget()
+{
+#ifdef HAS_PRECIP_BUDGET
+	float *const values[PRECIPITATION_BUDGET_VALUE_COUNT] = {
+		(float*)PRECIP_RAINPERCENT_ADDR,
+		(float*)PRECIP_RAINRADIUSX_ADDR,
+		(float*)PRECIP_RAINRADIUSY_ADDR,
+		(float*)PRECIP_RAINRADIUSZ_ADDR,
+		(float*)PRECIP_BOUNDX_ADDR,
+		(float*)PRECIP_BOUNDY_ADDR,
+		(float*)PRECIP_BOUNDZ_ADDR,
+	};
+
+	// Values that were changed since they were last written (by the game or in the overlay) become the new base to scale
+	if (_nfs_precipitation_budget_applied)
+		for (size_t i = 0; i < PRECIPITATION_BUDGET_VALUE_COUNT; ++i)
+			if (*values[i] != _nfs_precipitation_budget_written_values[i])
+				_nfs_precipitation_budget_base_values[i] = _nfs_precipitation_budget_written_values[i] = *values[i];
+
+	if (!_nfs_precipitation_budget || _nfs_capture_active || _nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING || _nfs_game_state.precipitation <= 0.0f)
+	{
+		if (_nfs_precipitation_budget_applied)
+		{
+			for (size_t i = 0; i < PRECIPITATION_BUDGET_VALUE_COUNT; ++i)
+				if (*values[i] != _nfs_precipitation_budget_base_values[i])
+					*values[i] = _nfs_precipitation_budget_base_values[i];
+			_nfs_precipitation_budget_applied = false;
+		}
+
+		_nfs_precipitation_budget_scale = 1.0f;
+		_nfs_precipitation_budget_frame = 0;
+		_nfs_precipitation_budget_frame_time_sum = 0.0;
+		return;
+	}
+
+	if (!_nfs_precipitation_budget_applied)
+	{
+		for (size_t i = 0; i < PRECIPITATION_BUDGET_VALUE_COUNT; ++i)
+			_nfs_precipitation_budget_base_values[i] = _nfs_precipitation_budget_written_values[i] = *values[i];
+		_nfs_precipitation_budget_applied = true;
+	}
+
+	_nfs_precipitation_budget_frame_time_sum += _last_frame_duration.count() * 1e-6;
+	if (++_nfs_precipitation_budget_frame < PRECIPITATION_BUDGET_INTERVAL)
+		return;
+
+	const float frame_time = static_cast<float>(_nfs_precipitation_budget_frame_time_sum / _nfs_precipitation_budget_frame);
+	_nfs_precipitation_budget_frame = 0;
+	_nfs_precipitation_budget_frame_time_sum = 0.0;
+
+	const float previous_scale = _nfs_precipitation_budget_scale;
+	if (frame_time > _nfs_precipitation_budget_frame_time)
+		// Lower in proportion to how far over the target the frame time is, but at most by a fifth per step, so that single spikes do not clear the sky
+		_nfs_precipitation_budget_scale = std::max(_nfs_precipitation_budget_scale * std::max(_nfs_precipitation_budget_frame_time / frame_time, 0.8f), _nfs_precipitation_budget_min_scale);
+	else if (frame_time < _nfs_precipitation_budget_frame_time * 0.9f)
+		// Raise again in small steps, leaving some headroom, so that it does not oscillate around the target
+		_nfs_precipitation_budget_scale = std::min(_nfs_precipitation_budget_scale + 0.05f, 1.0f);
+
+	if (_nfs_precipitation_budget_scale == previous_scale)
+		return;
+
+	// Density is scaled directly, while the extents of the volume rain is spawned in shrink with the square root, so that the rain right in front of the camera thins out last
+	const float extent_scale = std::sqrt(_nfs_precipitation_budget_scale);
+	for (size_t i = 0; i < PRECIPITATION_BUDGET_VALUE_COUNT; ++i)
+	{
+		const float value = _nfs_precipitation_budget_base_values[i] * (i == 0 ? _nfs_precipitation_budget_scale : extent_scale);
+		if (*values[i] != value)
+			*values[i] = value;
+		_nfs_precipitation_budget_written_values[i] = value;
 	}
-	ImGui::Separator();
 #endif
-	if (ImGui::CollapsingHeader("Game", ImGuiTreeNodeFlags_None))
+}
+
+void reshade::runtime::parse_nfs_world_detail_ladder()
+{
+	// Steps may refer to other toggles now, so undo the ones that are applied first
+	reset_nfs_world_detail();
+
+	_nfs_world_detail_steps.clear();
+	for (const std::string &entry : _nfs_world_detail_ladder)
 	{
-#if defined(GAME_MW) || defined(GAME_UG2)
-		if (ImGui::CollapsingHeader("Build Version", ImGuiTreeNodeFlags_None))
+		const size_t value_pos = entry.rfind('=');
+		const std::string_view name = std::string_view(entry).substr(0, value_pos);
+
+		const auto it = std::find_if(NFSRenderToggles.begin(), NFSRenderToggles.end(),
+			[name](const NFSRenderToggle &toggle) { return name == toggle.Name; });
+		if (value_pos == std::string::npos || it == NFSRenderToggles.end())
 		{
-#ifdef GAME_UG2
-			ImGui::Text("Perforce Changelist Number: %d\nPerforce Changelist Name: %s\nBuild Machine: %s", *(int*)BUILDVERSIONCLNUMBER_ADDR, *(char**)BUILDVERSIONCLNAME_ADDR, *(char**)BUILDVERSIONMACHINE_ADDR); // TODO: make these flexible addresses...
-#else
-			ImGui::Text("Platform: %s\nBuild Type:%s%s\nPerforce Changelist Number: %d\nPerforce Changelist Name: %s\nBuild Date: %s\nBuild Machine: %s", (char*)BUILDVERSIONPLAT_ADDR, (char*)BUILDVERSIONNAME_ADDR, (char*)BUILDVERSIONOPTNAME_ADDR, *(int*)BUILDVERSIONCLNUMBER_ADDR, *(char**)BUILDVERSIONCLNAME_ADDR, *(char**)BUILDVERSIONDATE_ADDR, *(char**)BUILDVERSIONMACHINE_ADDR); // TODO: make these flexible addresses...
-#endif
-			ImGui::Separator();
+			log::message(log::level::warning, "Ignoring unknown world detail ladder step '%s'.", entry.c_str());
+			continue;
 		}
-#endif
-#ifdef HAS_DAL
-		if (ImGui::CollapsingHeader("DAL Options", ImGuiTreeNodeFlags_None))
+
+		nfs_world_detail_step &step = _nfs_world_detail_steps.emplace_back();
+		step.toggle_index = it - NFSRenderToggles.begin();
+		step.value = std::atoi(entry.c_str() + value_pos + 1);
+	}
+}
+
+void reshade::runtime::update_nfs_world_detail()
+{
+	// The render toggle sweep changes the same toggles, so leave them alone while it runs
+	if (!_nfs_world_detail || _nfs_sweep_active || _nfs_capture_active || _nfs_game_state.gameflow_state != GAMEFLOW_STATE_RACING)
+	{
+		reset_nfs_world_detail();
+		return;
+	}
+
+	_nfs_world_detail_frame_times[_nfs_world_detail_frame_count++] = _last_frame_duration.count() * 1e-6f;
+	if (_nfs_world_detail_frame_count < WORLD_DETAIL_WINDOW_SIZE)
+		return;
+	// Start over with a new window after every decision, so that the next one only sees frames rendered with the current settings
+	_nfs_world_detail_frame_count = 0;
+
+	float *const p95 = _nfs_world_detail_frame_times + (WORLD_DETAIL_WINDOW_SIZE * 95) / 100;
+	std::nth_element(_nfs_world_detail_frame_times, p95, _nfs_world_detail_frame_times + WORLD_DETAIL_WINDOW_SIZE);
+	const float frame_time = *p95;
+
+	if (frame_time > _nfs_world_detail_budget && _nfs_world_detail_level < _nfs_world_detail_steps.size())
+	{
+		nfs_world_detail_step &step = _nfs_world_detail_steps[_nfs_world_detail_level++];
+		const NFSRenderToggle &toggle = NFSRenderToggles[step.toggle_index];
+
+		step.original_value = GetRenderToggle(toggle);
+		SetRenderToggle(toggle, step.value);
+		_nfs_world_detail_step_count++;
+
+		log::message(log::level::info, "Lowered world detail to level %zu by setting \"%s\" to %d, since the 95th percentile frame time of %.2f ms exceeds the budget of %.2f ms.", _nfs_world_detail_level, toggle.Name, step.value, frame_time, _nfs_world_detail_budget);
+	}
+	else if (frame_time < _nfs_world_detail_budget * _nfs_world_detail_hysteresis && _nfs_world_detail_level > 0)
+	{
+		const nfs_world_detail_step &step = _nfs_world_detail_steps[--_nfs_world_detail_level];
+		const NFSRenderToggle &toggle = NFSRenderToggles[step.toggle_index];
+
+		SetRenderToggle(toggle, step.original_value);
+		_nfs_world_detail_step_count++;
+
+		log::message(log::level::info, "Raised world detail to level %zu by restoring \"%s\" to %d, since the 95th percentile frame time of %.2f ms has headroom.", _nfs_world_detail_level, toggle.Name, step.original_value, frame_time);
+	}
+}
+
+void reshade::runtime::reset_nfs_world_detail()
+{
+	_nfs_world_detail_frame_count = 0;
+
+	if (_nfs_world_detail_level == 0)
+		return;
+
+	// Revert in reverse order, so that steps changing the same toggle twice end up at the original value
+	while (_nfs_world_detail_level > 0)
+	{
+		const nfs_world_detail_step &step = _nfs_world_detail_steps[--_nfs_world_detail_level];
+		SetRenderToggle(NFSRenderToggles[step.toggle_index], step.original_value);
+	}
+	_nfs_world_detail_step_count++;
+
+	log::message(log::level::info, "Restored full world detail.");
+}
+
+void reshade::runtime::update_nfs_visual_treatment_bypass()
+{
+#ifdef APPLYVISUALLOOK_ADDR
+	const bool bypass = std::any_of(_techniques.cbegin(), _techniques.cend(),
+		[](const technique &tech) { return tech.replaces_visual_treatment && tech.enabled && !tech.gameflow_excluded; });
+
+	// The flag lives in an object that is only allocated once the game finished starting up in some games
+	bool *const apply_visual_look = (bool *)APPLYVISUALLOOK_ADDR;
+	if (!reshade::utils::is_memory_writable(apply_visual_look, sizeof(*apply_visual_look)))
+	{
+		_nfs_visual_treatment_bypassed = false;
+		return;
+	}
+
+	if (bypass)
+	{
+		// Pick up changes made through the "Visual Look Filter" option or by the game in the meantime as the new value to restore
+		if (*apply_visual_look)
 		{
-			if (ImGui::CollapsingHeader("FrontEnd", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("FE Scale", (float*)FESCALE_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::Checkbox("Widescreen mode", (bool*)WIDESCREEN_POINTER);
-#ifdef GAME_CARBON
-				ImGui::Separator();
-				ImGui::Checkbox("Lap Info", (bool*)FELAPINFO_POINTER);
-				ImGui::Checkbox("Score", (bool*)FESCORE_POINTER);
-				ImGui::Checkbox("Leaderboard", (bool*)FELEADERBOARD_POINTER);
-				ImGui::Checkbox("Crew Info", (bool*)FECREWINFO_POINTER);
-				ImGui::Checkbox("Transmission Prompt", (bool*)FETRANSMISSIONPROMPT_POINTER);
-				ImGui::Checkbox("Rearview Mirror", (bool*)FERVM_POINTER);
-				ImGui::Checkbox("Picture In Picture", (bool*)FEPIP_POINTER);
-				ImGui::Checkbox("Metric Speedo Units", (bool*)SPEEDOUNIT_POINTER);
-#endif
-			}
-#ifdef GAME_CARBON
-			if (ImGui::CollapsingHeader("Input", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::Checkbox("Rumble", (bool*)RUMBLEON_POINTER);
-				ImGui::InputInt("PC Pad Index", (int*)PCPADIDX_POINTER, 1, 100);
-				ImGui::InputInt("PC Device Type", (int*)PCDEVTYPE_POINTER, 1, 100);
-			}
-#endif
-			if (ImGui::CollapsingHeader("Gameplay", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::InputFloat("Highlight Cam", (float*)HIGHLIGHTCAM_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-				ImGui::InputFloat("Time Of Day", (float*)TIMEOFDAY_POINTER, 0.1, 1.0, "%.3f", ImGuiInputTextFlags_CharsScientific);
-#ifdef GAME_CARBON
-				ImGui::Checkbox("Jump Cam", (bool*)JUMPCAM_POINTER);
-				ImGui::Checkbox("Car Damage", (bool*)DAMAGEON_POINTER);
-				ImGui::Checkbox("Autosave", (bool*)AUTOSAVEON_POINTER);
-#endif
-			}
-			if (ImGui::CollapsingHeader("Audio Levels", ImGuiTreeNodeFlags_None))
-			{
-				ImGui::SliderFloat("Master", (float*)MASTERVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Speech", (float*)SPEECHVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("FE Music", (float*)FEMUSICVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("IG Music", (float*)IGMUSICVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Sound Effects", (float*)SOUNDEFFECTSVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Engine", (float*)ENGINEVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Car", (float*)CARVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Ambient", (float*)AMBIENTVOL_POINTER, 0.0, 1.0);
-				ImGui::SliderFloat("Speed", (float*)SPEEDVOL_POINTER, 0.0, 1.0);
-			}
+			if (!_nfs_visual_treatment_bypassed)
+				log::message(log::level::info, "Skipping the visual treatment pass of the game, since an enabled technique replaces it.");
 
+			_nfs_visual_treatment_original = true;
+			*apply_visual_look = false;
 		}
-		ImGui::Separator();
-#endif
-		if (ImGui::Button("Exit Game", ImVec2(ImGui::CalcItemWidth(), 0)))
+		else if (!_nfs_visual_treatment_bypassed)
 		{
-			*(int*)EXITGAMEFLAG_ADDR = 1;
+			_nfs_visual_treatment_original = false;
 		}
+
+		_nfs_visual_treatment_bypassed = true;
 	}
-	ImGui::Separator();
-	ImGui::Text("GameFlow State: %s", GameFlowStateNames[*(int*)GAMEFLOWMGR_STATUS_ADDR]);
-	ImGui::Separator();
-	if (modified)
-		save_config();
+	else if (_nfs_visual_treatment_bypassed)
+	{
+		*apply_visual_look = _nfs_visual_treatment_original;
+		_nfs_visual_treatment_bypassed = false;
+	}
+#endif
+}
+
+void reshade::runtime::update_nfs_worker_throttle()
+{
+	const auto current_time = std::chrono::high_resolution_clock::now();
+
+	// Offline capture waits on the workers to encode the frames, so they get to run at full speed there
+	bool throttle = _nfs_worker_throttle && !_nfs_capture_active && _nfs_game_state.gameflow_state == GAMEFLOW_STATE_RACING;
+	if (throttle && _nfs_worker_throttle_budget > 0.0f)
+	{
+		if (_last_frame_duration.count() * 1e-6f > _nfs_worker_throttle_budget)
+			_nfs_worker_throttle_hold_time = current_time + std::chrono::seconds(1);
+
+		throttle = current_time < _nfs_worker_throttle_hold_time;
+	}
+
+	if (throttle == _nfs_worker_throttled && !_nfs_worker_throttle_changed)
+		return;
+
+	_nfs_worker_throttled = throttle;
+	_nfs_worker_throttle_changed = false;
+
+	if (!throttle)
+	{
+		_worker_pool->set_throttle(SIZE_MAX, THREAD_PRIORITY_NORMAL, 0);
+		log::message(log::level::debug, "Running worker threads at full speed.");
+		return;
+	}
+
+	uintptr_t affinity_mask = 0;
+	if (_nfs_worker_throttle_avoid_game_threads)
+	{
+		DWORD_PTR system_affinity_mask = 0;
+		DWORD_PTR process_affinity_mask = 0;
+		GetProcessAffinityMask(GetCurrentProcess(), &process_affinity_mask, &system_affinity_mask);
+
+		// Exclude the processors the scheduler prefers for the render thread and the thread the game state is published from (which is the game thread in the multithreaded games)
+		PROCESSOR_NUMBER processor = {};
+		GetThreadIdealProcessorEx(GetCurrentThread(), &processor);
+		if (processor.Group == 0)
+			process_affinity_mask &= ~(static_cast<DWORD_PTR>(1) << processor.Number);
+		if (_nfs_game_state.thread_processor < sizeof(DWORD_PTR) * 8)
+			process_affinity_mask &= ~(static_cast<DWORD_PTR>(1) << _nfs_game_state.thread_processor);
+
+		// Do not restrict the workers at all if that would leave them without any processor
+		affinity_mask = process_affinity_mask;
+	}
+
+	_worker_pool->set_throttle(_nfs_worker_throttle_threads, THREAD_PRIORITY_LOWEST, affinity_mask);
+	log::message(log::level::debug, "Throttling worker threads to %u thread(s) at low priority while racing.", _nfs_worker_throttle_threads);
+}
+
+float reshade::runtime::get_enabled_techniques_gpu_time() const
+{
+	// GPU timestamps are only read back with some latency, so use the moving averages of the enabled techniques
+	uint64_t duration = 0;
+	for (const technique &tech : _techniques)
+		if (tech.enabled)
+			duration += tech.average_gpu_duration;
+	return duration * 1e-6f;
 }
 // NFS CODE END
 
@@ -6654,6 +9086,36 @@ void reshade::runtime::draw_gui_addons()
 
 	ImGui::Spacing();
 
+	bool profiling = addon_profiling_enabled.load(std::memory_order_relaxed);
+	if (ImGui::Checkbox(_("Measure event callback cost"), &profiling))
+		set_addon_profiling(profiling);
+	ImGui::SetItemTooltip(_("Times one in %u add-on event invocations, to find add-ons that slow down the game.
+Enabling this discards previous measurements."), ADDON_PROFILING_SAMPLE_INTERVAL);
+
+	std::vector<addon_callback_stats> callback_stats;
+	double ticks_per_second = 0.0, elapsed_seconds = 0.0;
+	if (profiling)
+	{
+		get_addon_callback_stats(callback_stats, ticks_per_second, elapsed_seconds);
+
+		ImGui::SameLine();
+		if (ImGui::Button(_("Export as CSV"), ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+			save_addon_callback_stats();
+	}
+
+	// Converts sampled ticks to the estimated number of milliseconds spent per second in total
+	const auto ticks_to_milliseconds_per_second = [&](uint64_t ticks) {
+		return ticks_per_second != 0.0 ? static_cast<float>(ticks * ADDON_PROFILING_SAMPLE_INTERVAL / ticks_per_second * 1000.0 / elapsed_seconds) : 0.0f;
+	};
+	const auto find_callback_stats = [&callback_stats](const std::pair<uint32_t, void *> &event_callback) {
+		return std::find_if(callback_stats.cbegin(), callback_stats.cend(),
+			[&event_callback](const addon_callback_stats &stats) {
+				return static_cast<uint32_t>(stats.ev) == event_callback.first && stats.callback == event_callback.second;
+			});
+	};
+
+	ImGui::Spacing();
+
 	if (!addon_all_loaded)
 	{
 		ImGui::PushTextWrapPos();
@@ -6742,6 +9204,21 @@ void reshade::runtime::draw_gui_addons()
 				ImGui::TextUnformatted(enabled ? _("(will be enabled on next application restart)") : _("(will be disabled on next application restart)"));
 			}
 
+			uint64_t addon_total_ticks = 0;
+			if (!callback_stats.empty())
+			{
+				for (const std::pair<uint32_t, void *> &event_callback : info.event_callbacks)
+					if (const auto stats_it = find_callback_stats(event_callback); stats_it != callback_stats.cend())
+						addon_total_ticks += stats_it->total_ticks;
+
+				if (addon_total_ticks != 0)
+				{
+					ImGui::SameLine(ImGui::GetWindowWidth() * 0.75f);
+					ImGui::Text("%8.3f ms/s", ticks_to_milliseconds_per_second(addon_total_ticks));
+					ImGui::SetItemTooltip(_("Estimated time spent in the event callbacks of this add-on per second."));
+				}
+			}
+
 			if (open)
 			{
 				ImGui::Spacing();
@@ -6791,6 +9268,35 @@ void reshade::runtime::draw_gui_addons()
 
 					info.settings_overlay_callback(this);
 				}
+
+				if (addon_total_ticks != 0 && ImGui::BeginTable("##callback_stats", 4, ImGuiTableFlags_BordersInnerH | ImGuiTableFlags_SizingStretchProp))
+				{
+					ImGui::TableSetupColumn(_("Event"));
+					ImGui::TableSetupColumn(_("Samples"));
+					ImGui::TableSetupColumn(_("Average"));
+					ImGui::TableSetupColumn(_("Total"));
+					ImGui::TableHeadersRow();
+
+					for (const std::pair<uint32_t, void *> &event_callback : info.event_callbacks)
+					{
+						const auto stats_it = find_callback_stats(event_callback);
+						if (stats_it == callback_stats.cend())
+							continue;
+
+						ImGui::TableNextRow();
+						ImGui::TableNextColumn();
+						ImGui::TextUnformatted(stats_it->event_name);
+						ImGui::TableNextColumn();
+						ImGui::Text("%llu", stats_it->sample_count);
+						ImGui::TableNextColumn();
+						ImGui::Text("%.3f us", stats_it->total_ticks / ticks_per_second * 1000000.0 / stats_it->sample_count);
+						ImGui::SetItemTooltip(_("Longest sampled call took %.3f us."), stats_it->max_ticks / ticks_per_second * 1000000.0);
+						ImGui::TableNextColumn();
+						ImGui::Text("%.3f ms/s", ticks_to_milliseconds_per_second(stats_it->total_ticks));
+					}
+
+					ImGui::EndTable();
+				}
 			}
 
 			ImGui::EndChild();
@@ -6803,6 +9309,53 @@ void reshade::runtime::draw_gui_addons()
 	ImGui::SetCursorPosX((ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(_("Open developer documentation")).x) / 2);
 	ImGui::TextLinkOpenURL(_("Open developer documentation"), "https://reshade.me/docs");
 }
+bool reshade::runtime::save_addon_callback_stats() const
+{
+	std::vector<addon_callback_stats> callback_stats;
+	double ticks_per_second = 0.0, elapsed_seconds = 0.0;
+	get_addon_callback_stats(callback_stats, ticks_per_second, elapsed_seconds);
+	if (ticks_per_second == 0.0)
+		return false;
+
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path csv_path = g_reshade_base_path / std::filesystem::u8path(std::string("ReShade Add-on Costs ") + timestamp + ".csv");
+
+	FILE *const csv_file = _wfsopen(csv_path.c_str(), L"w", SH_DENYWR);
+	if (csv_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write add-on callback costs to '%s'!", csv_path.u8string().c_str());
+		return false;
+	}
+
+	std::fputs("addon,file,event,callback,samples,average_us,max_us,total_ms_per_second\n", csv_file);
+	for (const addon_callback_stats &stats : callback_stats)
+	{
+		// Callbacks of add-ons that were unloaded in the meantime no longer have an owner
+		const auto info_it = std::find_if(addon_loaded_info.cbegin(), addon_loaded_info.cend(),
+			[&stats](const addon_info &info) {
+				return std::find(info.event_callbacks.cbegin(), info.event_callbacks.cend(), std::make_pair(static_cast<uint32_t>(stats.ev), stats.callback)) != info.event_callbacks.cend();
+			});
+
+		std::fprintf(csv_file, "\"%s\",\"%s\",%s,%p,%llu,%.4f,%.4f,%.4f\n",
+			info_it != addon_loaded_info.cend() ? info_it->name.c_str() : "",
+			info_it != addon_loaded_info.cend() ? info_it->file.c_str() : "",
+			stats.event_name,
+			stats.callback,
+			stats.sample_count,
+			stats.total_ticks / ticks_per_second * 1000000.0 / stats.sample_count,
+			stats.max_ticks / ticks_per_second * 1000000.0,
+			stats.total_ticks * ADDON_PROFILING_SAMPLE_INTERVAL / ticks_per_second * 1000.0 / elapsed_seconds);
+	}
+	std::fclose(csv_file);
+
+	log::message(log::level::info, "Saved costs of %zu add-on event callback(s) over %.1f seconds to '%s'.", callback_stats.size(), elapsed_seconds, csv_path.u8string().c_str());
+
+	return true;
+}
 #endif
 
 void reshade::runtime::draw_variable_editor()
@@ -7469,6 +10022,22 @@ void reshade::runtime::draw_variable_editor()
 		ImGui::EndTabBar();
 	ImGui::EndChild();
 }
+void reshade::runtime::update_technique_search_index()
+{
+	_technique_search_index.clear();
+
+	// Index the same strings the filter used to compare against, so that results do not change
+	for (const technique &tech : _techniques)
+	{
+		std::string_view label = tech.annotation_as_string("ui_label");
+		if (label.empty())
+			label = tech.name;
+
+		_technique_search_index.add({ label, _effects[tech.effect_index].source_file.filename().u8string() });
+	}
+
+	_technique_search_index_generation = _effects_generation;
+}
 void reshade::runtime::draw_technique_editor()
 {
 	if (_reload_count != 0 && _effects.empty())
@@ -7609,7 +10178,7 @@ void reshade::runtime::draw_technique_editor()
 					if (effect.permutations.size() > 1)
 						label += " (" + std::to_string(permutation_index) + ")";
 
-					if (!effect.permutations[permutation_index].generated_code.empty() &&
+					if (!effect.permutations[permutation_index].get_generated_code().empty() &&
 						imgui::popup_button(label.c_str(), 18.0f * _font_size))
 					{
 						const bool open_generated_code = ImGui::MenuItem(_("Generated code"));
@@ -7634,17 +10203,36 @@ void reshade::runtime::draw_technique_editor()
 	size_t force_reload_effect = std::numeric_limits<size_t>::max();
 	size_t hovered_technique_index = std::numeric_limits<size_t>::max();
 
+	// Build list of techniques that pass the search filter, so that only the rows which are actually on screen have to be submitted below
+	_visible_technique_indices.clear();
+	int selected_row = -1;
 	for (size_t index = 0; index < _technique_sorting.size(); ++index)
 	{
-		const size_t technique_index = _technique_sorting[index];
+		const technique &tech = _techniques[_technique_sorting[index]];
+
+		// Skip hidden techniques
+		if (tech.hidden || !_effects[tech.effect_index].compiled)
+			continue;
+
+		if (_selected_technique == index)
+			selected_row = static_cast<int>(_visible_technique_indices.size());
+		_visible_technique_indices.push_back(index);
+	}
+
+	ImGuiListClipper clipper;
+	clipper.Begin(static_cast<int>(_visible_technique_indices.size()));
+	// Always submit the selected technique, so that it stays active while it is dragged out of view
+	if (selected_row >= 0)
+		clipper.IncludeItemByIndex(selected_row);
+
+	while (clipper.Step())
+	{
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
 		{
-			technique &tech = _techniques[technique_index];
+			const size_t index = _visible_technique_indices[row];
+			technique &tech = _techniques[_technique_sorting[index]];
 			const effect &effect = _effects[tech.effect_index];
 
-			// Skip hidden techniques
-			if (tech.hidden || !effect.compiled)
-				continue;
-
 			bool modified = false;
 
 			ImGui::PushID(static_cast<int>(index));
@@ -7726,6 +10314,59 @@ void reshade::runtime::draw_technique_editor()
 						_preset_is_modified = true;
 				}
 
+				char gameflow_rule[128];
+				gameflow_rule[tech.gameflow_rule.copy(gameflow_rule, sizeof(gameflow_rule) - 1)] = '\0';
+				ImGui::SetNextItemWidth(18.0f * _font_size);
+				if (ImGui::InputTextWithHint("##gameflow_states", tech.annotation_as_string("gameflow_states", _gameflow_rule.empty() ? "Game flow states (e.g. RACING)" : std::string_view(_gameflow_rule)).data(), gameflow_rule, sizeof(gameflow_rule)))
+				{
+					tech.gameflow_rule = gameflow_rule;
+					update_gameflow_state_mask(tech);
+
+					if (_auto_save_preset)
+						save_current_preset();
+					else
+						_preset_is_modified = true;
+				}
+				ImGui::SetItemTooltip("Game flow states in which this technique is rendered, e.g. \"RACING\" or \"!LOADING_*, !IN_FRONTEND\".\nLeave empty to use the rule of the effect or preset.");
+
+#ifdef NFSUC_MOTIONBLUR_HOOK_ADDR
+				ImGui::SetNextItemWidth(18.0f * _font_size);
+				if (int render_stage = static_cast<int>(tech.render_stage);
+					ImGui::Combo("##render_stage", &render_stage, nfs_render_stage_names, static_cast<int>(std::size(nfs_render_stage_names))))
+				{
+					tech.render_stage_name = nfs_render_stage_names[render_stage];
+					_has_nfs_render_stages = false;
+					for (technique &other_tech : _techniques)
+						update_render_stage(other_tech);
+
+					if (_auto_save_preset)
+						save_current_preset();
+					else
+						_preset_is_modified = true;
+				}
+				ImGui::SetItemTooltip("Point in the frame at which this technique is rendered.\n\"motion_blur\" renders it before the motion blur pass, while the scene depth is still bound and before the HUD is drawn.");
+#endif
+#ifdef APPLYVISUALLOOK_ADDR
+				if (ImGui::Checkbox("Replaces visual treatment", &tech.replaces_visual_treatment))
+				{
+					if (_auto_save_preset)
+						save_current_preset();
+					else
+						_preset_is_modified = true;
+				}
+				ImGui::SetItemTooltip("Skips the color grading and bloom pass of the game while this technique is enabled, for techniques that do their own.");
+#endif
+
+				ImGui::SetNextItemWidth(18.0f * _font_size);
+				if (ImGui::SliderInt("##update_interval", reinterpret_cast<int *>(&tech.update_interval), 1, 8, "Update every %d frame(s)", ImGuiSliderFlags_AlwaysClamp))
+				{
+					if (_auto_save_preset)
+						save_current_preset();
+					else
+						_preset_is_modified = true;
+				}
+				ImGui::SetItemTooltip("Only fully updates this technique every Nth frame, staggered with other techniques that do this.\nIn between only the passes writing to the back buffer are executed, reusing the results of the other passes from the last update.\nTakes effect after reloading if the technique shares its intermediate textures with other techniques.");
+
 				const bool is_not_top = index > 0;
 				const bool is_not_bottom = index < _technique_sorting.size() - 1;
 
@@ -7806,7 +10447,7 @@ void reshade::runtime::draw_technique_editor()
 					if (effect.permutations.size() > 1)
 						label += " (" + std::to_string(permutation_index) + ")";
 
-					if (!effect.permutations[permutation_index].generated_code.empty() &&
+					if (!effect.permutations[permutation_index].get_generated_code().empty() &&
 						imgui::popup_button(label.c_str(), 18.0f * _font_size))
 					{
 						const bool open_generated_code = ImGui::MenuItem(_("Generated code"));
@@ -7958,6 +10599,8 @@ void reshade::runtime::open_code_editor(size_t effect_index, const std::filesyst
 	{
 		editor_instance instance { effect_index, std::numeric_limits<size_t>::max(), path, std::string(), true, false };
 		open_code_editor(instance);
+		// Source files may contain comments or strings with characters that are not part of the font atlas yet
+		request_font_glyphs(instance.editor.get_text());
 		_editors.push_back(std::move(instance));
 	}
 }
@@ -7970,9 +10613,9 @@ void reshade::runtime::open_code_editor(editor_instance &instance) const
 		const effect::permutation &permutation = effect.permutations[instance.permutation_index];
 
 		if (instance.entry_point_name.empty())
-			instance.editor.set_text(permutation.generated_code);
+			instance.editor.set_text(permutation.get_generated_code());
 		else
-			instance.editor.set_text(permutation.assembly_text.at(instance.entry_point_name));
+			instance.editor.set_text(get_assembly_text(instance.effect_index, instance.permutation_index, instance.entry_point_name));
 		instance.editor.set_readonly(true);
 		return; // Errors only apply to the effect source, not generated code
 	}
@@ -8026,7 +10669,9 @@ void reshade::runtime::draw_code_editor(editor_instance &instance)
 			// Clear modified flag, so that errors are updated next frame (see 'update_and_render_effects')
 			instance.editor.clear_modified();
 
-			reload_effect(instance.effect_index);
+			// Reload every effect that includes the saved file (which may be a shared header), rather than just the one the editor was opened from
+			if (!reload_dependent_effects(instance.file_path))
+				reload_effect(instance.effect_index);
 
 			// Reloading an effect file invalidates all textures, but the statistics window may already have drawn references to those, so need to reset it
 			if (ImGuiWindow *const statistics_window = ImGui::FindWindowByName("###statistics"))
@@ -8049,9 +10694,7 @@ void reshade::runtime::draw_code_editor(editor_instance &instance)
 
 bool reshade::runtime::init_imgui_resources()
 {
-	// Adjust default font size based on the vertical resolution
-	if (_font_size == 0)
-		_editor_font_size = _font_size = _height >= 2160 ? 26 : _height >= 1440 ? 20 : 13;
+	const startup_trace::scoped_span trace_span("runtime::init_imgui_resources");
 
 	const bool has_combined_sampler_and_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
@@ -8165,17 +10808,41 @@ void reshade::runtime::render_imgui_draw_data(api::command_list *cmd_list, ImDra
 	// Need to multi-buffer vertex data so not to modify data below when the previous frame is still in flight
 	const size_t buffer_index = _frame_count % std::size(_imgui_vertices);
 
-	// Create and grow vertex/index buffers if needed
+	// Destroy buffers that were replaced by larger ones once the GPU is done with them
+	for (auto it = _imgui_retired_buffers.begin(); it != _imgui_retired_buffers.end();)
+	{
+		if (it->fence_value != 0 ? _device->get_completed_fence_value(_imgui_fence) < it->fence_value : _frame_count < it->frame_count + std::size(_imgui_vertices))
+		{
+			++it;
+			continue;
+		}
+
+		_device->destroy_resource(it->buffer);
+		it = _imgui_retired_buffers.erase(it);
+	}
+
+	// Retire a buffer instead of waiting for the GPU to become idle, since its last use may still be in flight
+	const auto retire_buffer = [this](api::resource buffer) {
+		if (_imgui_fence == 0 && !_device->create_fence(0, api::fence_flags::none, &_imgui_fence))
+			_imgui_fence = {};
+
+		retired_imgui_buffer &retired = _imgui_retired_buffers.emplace_back();
+		retired.buffer = buffer;
+		if (_imgui_fence != 0 && _graphics_queue->signal(_imgui_fence, _imgui_fence_value + 1))
+			retired.fence_value = ++_imgui_fence_value;
+		retired.frame_count = _frame_count;
+	};
+
+	// Create and grow vertex/index buffers if needed (geometrically, so that opening larger windows does not recreate them every frame)
 	if (_imgui_num_indices[buffer_index] < draw_data->TotalIdxCount)
 	{
 		if (_imgui_indices[buffer_index] != 0)
-		{
-			_graphics_queue->wait_idle(); // Be safe and ensure nothing still uses this buffer
+			retire_buffer(_imgui_indices[buffer_index]);
+		_imgui_indices[buffer_index] = {};
 
-			_device->destroy_resource(_imgui_indices[buffer_index]);
-		}
+		const int new_size = std::max(draw_data->TotalIdxCount + 10000, _imgui_num_indices[buffer_index] * 2);
+		_imgui_num_indices[buffer_index] = 0;
 
-		const int new_size = draw_data->TotalIdxCount + 10000;
 		if (!_device->create_resource(api::resource_desc(new_size * sizeof(ImDrawIdx), api::memory_heap::cpu_to_gpu, api::resource_usage::index_buffer), nullptr, api::resource_usage::cpu_access, &_imgui_indices[buffer_index]))
 		{
 			log::message(log::level::error, "Failed to create ImGui index buffer!");
@@ -8189,13 +10856,12 @@ void reshade::runtime::render_imgui_draw_data(api::command_list *cmd_list, ImDra
 	if (_imgui_num_vertices[buffer_index] < draw_data->TotalVtxCount)
 	{
 		if (_imgui_vertices[buffer_index] != 0)
-		{
-			_graphics_queue->wait_idle();
+			retire_buffer(_imgui_vertices[buffer_index]);
+		_imgui_vertices[buffer_index] = {};
 
-			_device->destroy_resource(_imgui_vertices[buffer_index]);
-		}
+		const int new_size = std::max(draw_data->TotalVtxCount + 5000, _imgui_num_vertices[buffer_index] * 2);
+		_imgui_num_vertices[buffer_index] = 0;
 
-		const int new_size = draw_data->TotalVtxCount + 5000;
 		if (!_device->create_resource(api::resource_desc(new_size * sizeof(ImDrawVert), api::memory_heap::cpu_to_gpu, api::resource_usage::vertex_buffer), nullptr, api::resource_usage::cpu_access, &_imgui_vertices[buffer_index]))
 		{
 			log::message(log::level::error, "Failed to create ImGui vertex buffer!");
@@ -8333,6 +10999,9 @@ void reshade::runtime::destroy_imgui_resources()
 {
 	_imgui_context->IO.Fonts->Clear();
 
+	_osd_cache_stable = false;
+	_osd_cache_key.clear();
+
 	_device->destroy_resource(_font_atlas_tex);
 	_font_atlas_tex = {};
 	_device->destroy_resource_view(_font_atlas_srv);
@@ -8348,6 +11017,13 @@ void reshade::runtime::destroy_imgui_resources()
 		_imgui_num_vertices[i] = 0;
 	}
 
+	for (const retired_imgui_buffer &retired : _imgui_retired_buffers)
+		_device->destroy_resource(retired.buffer);
+	_imgui_retired_buffers.clear();
+	_device->destroy_fence(_imgui_fence);
+	_imgui_fence = {};
+	_imgui_fence_value = 0;
+
 	_device->destroy_sampler(_imgui_sampler_state);
 	_imgui_sampler_state = {};
 	_device->destroy_pipeline(_imgui_pipeline);
@@ -105,6 +105,9 @@ void reshade::runtime::draw_gui_vr()
 	if (s_main_handle == vr::k_ulOverlayHandleInvalid || !s_vr_overlay->IsOverlayVisible(s_main_handle))
 		return;
 
+	if (_imgui_pipeline == 0 && !init_imgui_resources())
+		return;
+
 	build_font_atlas();
 	if (_font_atlas_srv == 0)
 		return; // Cannot render GUI without font atlas
@@ -7,6 +7,8 @@
 
 #include "effect_module.hpp"
 #include "moving_average.hpp"
+#include <mutex>
+#include <memory>
 
 namespace reshade
 {
@@ -28,6 +30,15 @@ namespace reshade
 		overlay_active,
 		overlay_hovered,
 		screenshot,
+		dynamic_resolution,
+		nfs_gameflow,
+		nfs_game_speed,
+		nfs_precipitation,
+		nfs_fog,
+		nfs_fog_color,
+		nfs_visual_treatment,
+		nfs_vehicles,
+		nfs_vehicle_count,
 		unknown
 	};
 
@@ -68,10 +79,44 @@ namespace reshade
 			return type == desc.type && width == desc.width && height == desc.height && levels == desc.levels && format == desc.format;
 		}
 
+		/// <summary>
+		/// Estimates the amount of video memory used by this texture, including all its mipmap levels.
+		/// </summary>
+		uint64_t memory_size() const
+		{
+			static constexpr uint32_t pixel_sizes[] = {
+				0,
+				1 /*R8*/, 2 /*R16*/, 2 /*R16F*/, 4 /*R32I*/, 4 /*R32U*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32I*/, 16 /*RGBA32U*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
+			};
+
+			uint64_t size = 0;
+			for (uint32_t level = 0, level_width = width, level_height = height, level_depth = depth; level < levels; ++level)
+			{
+				if (compressed_format != api::format::unknown)
+					size += static_cast<uint64_t>(api::format_slice_pitch(compressed_format, api::format_row_pitch(compressed_format, level_width), level_height)) * level_depth;
+				else if (reduced_format != api::format::unknown)
+					size += static_cast<uint64_t>(api::format_row_pitch(reduced_format, level_width)) * level_height * level_depth;
+				else
+					size += static_cast<uint64_t>(level_width) * level_height * level_depth * pixel_sizes[static_cast<uint32_t>(format)];
+
+				level_width = level_width > 1 ? level_width / 2 : 1;
+				level_height = level_height > 1 ? level_height / 2 : 1;
+				level_depth = level_depth > 1 ? level_depth / 2 : 1;
+			}
+			return size;
+		}
+
 		size_t effect_index = std::numeric_limits<size_t>::max();
 
 		std::vector<size_t> shared;
 		bool loaded = false;
+		// Block compressed format the resource was created with instead of the texture format (see 'CompressSourceTextures' option), in which case the data can only be loaded from the source image
+		api::format compressed_format = api::format::unknown;
+		// Lower precision format the resource was created with instead of the texture format (see 'TexturePrecisionPolicy' option)
+		api::format reduced_format = api::format::unknown;
+
+		// Name of the technique that exclusively uses this texture, if it shares its resource with textures of other techniques (see 'transient_texture')
+		std::string transient_technique;
 
 		api::resource resource = {};
 		api::resource_view srv[2] = {};
@@ -79,6 +124,74 @@ namespace reshade
 		std::vector<api::resource_view> uav;
 	};
 
+	/// <summary>
+	/// Render target resource shared by intermediate textures of different techniques.
+	/// The contents of those textures are only used within the technique that overwrites them first, so they are never alive at the same time, since techniques are rendered one after another.
+	/// </summary>
+	struct transient_texture
+	{
+		reshadefx::texture desc;
+		// Lower precision format requested for the resource, which has to match as well for textures to share it
+		api::format reduced_format = api::format::unknown;
+
+		api::resource resource = {};
+		api::resource_view srv[2] = {};
+		api::resource_view rtv[2] = {};
+
+		// Effect index and technique name of each texture using this resource, with at most one texture per technique
+		std::vector<std::pair<size_t, std::string>> users;
+	};
+
+	/// <summary>
+	/// Image data for a texture that is decoded on the worker pool and then uploaded in chunks of rows (or slices for 3D textures) over multiple frames.
+	/// </summary>
+	struct texture_upload
+	{
+		std::filesystem::path source_path;
+		std::string texture_name;
+		api::resource resource = {};
+		reshadefx::texture_format format = reshadefx::texture_format::unknown;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		uint16_t levels = 1;
+		// Block compressed format to transcode the image to, in which case 'data' contains the blocks of all mipmap levels one after another
+		api::format compressed_format = api::format::unknown;
+
+		// Tightly packed pixel data in the texture format and dimensions, valid once 'finished' is set and 'succeeded' is true
+		std::vector<uint8_t> data;
+		uint32_t row_pitch = 0;
+		uint32_t slice_pitch = 0;
+		bool succeeded = false;
+		std::atomic<bool> finished = false;
+
+		// Index of the next row (or slice) to upload
+		uint32_t next_row = 0;
+	};
+
+	/// <summary>
+	/// Resource views currently bound to a texture semantic (e.g. "DEPTH"), along with all the effect descriptors that reference that semantic.
+	/// </summary>
+	struct texture_semantic_binding
+	{
+		std::string semantic;
+		api::resource_view srv = {};
+		api::resource_view srv_srgb = {};
+
+		struct descriptor
+		{
+			size_t effect_index;
+			size_t permutation_index;
+			api::descriptor_table table;
+			uint32_t index;
+			api::sampler sampler;
+			bool srgb;
+		};
+
+		// Only these have to be updated when the binding changes, rather than the descriptors of all effects
+		std::vector<descriptor> descriptors;
+	};
+
 	struct uniform : reshadefx::uniform
 	{
 		uniform(const reshadefx::uniform &init) : reshadefx::uniform(init) {}
@@ -126,6 +239,37 @@ namespace reshade
 		unsigned int toggle_key_data[4] = {};
 
 		special_uniform special = special_uniform::none;
+
+		// Set when the value of this variable was baked into the code of its effect as a constant, in which case it is stored in 'effect::baked_uniform_data' rather than the constant buffer
+		bool baked = false;
+	};
+
+	/// <summary>
+	/// A uniform variable with a special source, with all annotations that are needed to update it every frame already parsed.
+	/// </summary>
+	struct special_uniform_binding
+	{
+		enum class input_mode : uint8_t
+		{
+			down,
+			press,
+			toggle
+		};
+
+		special_uniform type = special_uniform::none;
+		size_t uniform_index = 0;
+
+		// Parameters of "random", "key" and "mousebutton" sources
+		int keycode = 0;
+		input_mode mode = input_mode::down;
+		int min_int = 0;
+		int max_int = 0;
+
+		// Parameters of "pingpong" and "mousewheel" sources
+		float min = 0.0f;
+		float max = 0.0f;
+		float step[2] = {};
+		float smoothing = 0.0f;
 	};
 
 	struct technique
@@ -179,6 +323,35 @@ namespace reshade
 		bool enabled_in_screenshot = true;
 		int64_t time_left = 0;
 
+		// Rule from the preset that overrides the "gameflow_states" annotation (see 'parse_gameflow_rule')
+		std::string gameflow_rule;
+		// Bit mask of the game flow states this technique is rendered in, with bit N set for 'GameFlowState' N
+		uint32_t gameflow_state_mask = 0xFFFFFFFF;
+		// Set when the technique is enabled, but excluded by its rule in the current game flow state
+		bool gameflow_excluded = false;
+
+		// Render stage name from the preset that overrides the "render_stage" annotation
+		std::string render_stage_name;
+		// Render stage this technique is rendered at, as an index into 'nfs_render_stage_names'
+		uint32_t render_stage = 0;
+
+		// Set from the preset or the "replaces_visual_treatment" annotation when this technique does its own color grading and bloom, in which case the visual treatment pass of the game is skipped while it is enabled
+		bool replaces_visual_treatment = false;
+
+		// Number of frames between full updates, from the preset or the "update_interval" annotation
+		// On the frames in between only passes writing to the back buffer are executed, which composite the results left in the render targets of the other passes by the last update
+		uint32_t update_interval = 1;
+		// Frame this technique was last rendered in, so that it is fully updated again after it was not rendered for a while
+		uint64_t last_render_frame = std::numeric_limits<uint64_t>::max();
+
+		// Set when textures of this technique share their resource with those of other techniques, which means their contents do not survive until the next frame
+		bool uses_transient_textures = false;
+
+		// Set through the "dynamic_resolution" annotation, in which case passes that do not write to the back buffer render at the resolution scale of the effect
+		bool dynamic_resolution = false;
+		// Set through the "foveated" annotation, in which case full resolution passes skip the periphery of each eye in VR while foveation is enabled
+		bool foveated = false;
+
 		struct pass : reshadefx::pass
 		{
 			pass(const reshadefx::pass &init) : reshadefx::pass(init) {}
@@ -188,7 +361,16 @@ namespace reshade
 			api::descriptor_table texture_table = {};
 			api::descriptor_table storage_table = {};
 			std::vector<api::resource> modified_resources;
+			// Resources created by the effect that this pass samples from (excluding those bound via a semantic)
+			std::vector<api::resource> sampled_resources;
+			// Textures with mipmaps this pass modifies, whose mipmaps are regenerated lazily before the next pass that depends on them
 			std::vector<api::resource_view> generate_mipmap_views;
+			// Textures with mipmaps this pass samples from or writes individual mipmap levels of, which therefore need up-to-date mipmaps before it executes
+			std::vector<api::resource_view> mipmap_dependent_views;
+			// Index of the uniform variable named by 'skip_uniform_name' in the list of uniforms of the effect
+			size_t skip_uniform_index = std::numeric_limits<size_t>::max();
+			// Set when this pass samples the back buffer (through a texture with the "COLOR" semantic), which then has to be copied first if it changed
+			bool samples_back_buffer = false;
 		};
 
 		struct permutation
@@ -199,9 +381,77 @@ namespace reshade
 
 		std::vector<permutation> permutations;
 
+		// Maximum number of frames timestamp queries may be in flight for before results are read back
+		static constexpr uint32_t QUERY_RING_SIZE = 8;
+		// Number of buckets in the GPU duration histogram, where bucket N counts durations in the range [2^(N-1), 2^N) microseconds
+		static constexpr uint32_t GPU_DURATION_HISTOGRAM_SIZE = 16;
+
+		// Each slot in the ring holds the timestamps before and after the technique, followed by one after each pass
 		uint32_t query_base_index = 0;
+		uint32_t query_stride = 2;
+		uint32_t query_ring_head = 0;
+		uint32_t query_ring_count = 0;
+		uint32_t query_ring_depth = 2;
+		uint32_t query_ring_active = std::numeric_limits<uint32_t>::max();
+		uint64_t query_ring_frames[QUERY_RING_SIZE] = {};
+		// Whether the timestamps after each pass were written for a slot, which only happens while per-pass statistics are gathered
+		bool query_ring_pass_timings[QUERY_RING_SIZE] = {};
 		moving_average<uint64_t, 60> average_cpu_duration;
 		moving_average<uint64_t, 60> average_gpu_duration;
+		uint32_t gpu_duration_histogram[GPU_DURATION_HISTOGRAM_SIZE] = {};
+		// Durations of the passes of the default permutation, including the barriers issued before each of them
+		std::vector<moving_average<uint64_t, 60>> average_pass_gpu_durations;
+	};
+
+	/// <summary>
+	/// Results of preprocessing and parsing an effect (before any runtime-specific modifications), which can be reused by other runtimes on the same device.
+	/// </summary>
+	struct shared_effect_module
+	{
+		reshadefx::effect_module module;
+		std::string generated_code;
+		std::unordered_map<std::string, std::string> entry_point_code;
+
+		// Pragma directives to prepend to the code of every entry point
+		std::string code_preamble;
+		bool skip_optimization = false;
+		std::string errors;
+
+		std::vector<std::filesystem::path> included_files;
+		size_t dependency_hash = 0;
+		std::vector<std::pair<std::string, std::string>> definitions;
+	};
+
+	/// <summary>
+	/// Cache of effect modules shared by all runtimes on the same device, which only keeps modules alive for as long as any runtime is still using them.
+	/// </summary>
+	struct shared_effect_module_cache
+	{
+		std::shared_ptr<const shared_effect_module> find(size_t key)
+		{
+			const std::unique_lock<std::mutex> lock(mutex);
+
+			const auto it = modules.find(key);
+			return it != modules.end() ? it->second.lock() : nullptr;
+		}
+		void add(size_t key, std::shared_ptr<const shared_effect_module> module)
+		{
+			const std::unique_lock<std::mutex> lock(mutex);
+
+			// Forget about modules of effects that were unloaded or changed since
+			for (auto it = modules.begin(); it != modules.end();)
+			{
+				if (it->second.expired())
+					it = modules.erase(it);
+				else
+					++it;
+			}
+
+			modules[key] = std::move(module);
+		}
+
+		std::mutex mutex;
+		std::unordered_map<size_t, std::weak_ptr<const shared_effect_module>> modules;
 	};
 
 	struct effect
@@ -211,26 +461,44 @@ namespace reshade
 		bool addon = false;
 
 		unsigned int rendering = 0;
+		unsigned int rendering_gameflow_excluded = 0;
 		bool skipped = false;
 		bool compiled = false;
+		// Time it took to load and compile the default permutation in milliseconds
+		float load_duration = 0.0f;
+		// Set when only techniques, uniforms and textures were parsed, but no shaders were compiled yet
+		bool metadata_only = false;
 		bool preprocessed = false;
 		std::string errors;
 
 		std::vector<std::filesystem::path> included_files;
+		size_t dependency_hash = 0;
 		std::vector<std::pair<std::string, std::string>> definitions;
 
 		std::vector<uniform> uniforms;
+		std::vector<special_uniform_binding> special_uniforms;
 		std::vector<uint8_t> uniform_data_storage;
+		// Byte range of the uniform data that changed since it was last uploaded, which is empty when nothing changed
+		size_t uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+		size_t uniform_data_dirty_end = 0;
 		api::resource cb = {};
 
-		struct binding
+		// Values of uniform variables that were baked into the code as constants, only kept so that they can still be edited and saved
+		std::vector<uint8_t> baked_uniform_data;
+		// Set when a baked value changed since the effect was compiled, which means it has to fall back to the generic version
+		bool baked_uniforms_changed = false;
+		// Time a user-facing uniform value last changed, used to decide when to bake them
+		std::chrono::high_resolution_clock::time_point last_uniform_change_time;
+
+		void mark_uniform_data_dirty(size_t offset, size_t size)
 		{
-			std::string semantic;
-			api::descriptor_table table;
-			uint32_t index;
-			api::sampler sampler;
-			bool srgb;
-		};
+			uniform_data_dirty_begin = std::min(uniform_data_dirty_begin, offset);
+			uniform_data_dirty_end = std::max(uniform_data_dirty_end, offset + size);
+		}
+		bool is_uniform_data_dirty() const
+		{
+			return uniform_data_dirty_begin < uniform_data_dirty_end;
+		}
 
 		struct permutation
 		{
@@ -239,15 +507,32 @@ namespace reshade
 			std::unordered_map<std::string, std::string> assembly;
 			std::unordered_map<std::string, std::string> assembly_text;
 
+			// Keeps the parse results alive for other runtimes on the same device to reuse while this one has the effect loaded
+			std::shared_ptr<const shared_effect_module> shared_module;
+
+			/// <summary>
+			/// Gets the generated code, which is only kept by the shared module if it was discarded from the permutation after compilation.
+			/// </summary>
+			const std::string &get_generated_code() const
+			{
+				return generated_code.empty() && shared_module != nullptr ? shared_module->generated_code : generated_code;
+			}
+
 			api::pipeline_layout layout = {};
 			api::descriptor_table cb_table = {};
 			api::descriptor_table sampler_table = {};
 
-			std::vector<binding> texture_semantic_to_binding;
+			// Interned IDs of the semantics of all textures in the module that have one (other than "COLOR"), in declaration order
+			std::vector<uint32_t> texture_semantic_ids;
 		};
 
 		std::vector<permutation> permutations;
 
 		api::query_heap query_heap = {};
+
+		// Scale applied to the viewport of passes of techniques that opted into dynamic resolution, which is lowered to stay within the GPU budget (see 'update_nfs_dynamic_resolution')
+		float resolution_scale = 1.0f;
+		// Lowest scale the techniques of this effect allow through their "dynamic_resolution_min" annotation, or one if none opted in
+		float min_resolution_scale = 1.0f;
 	};
 }
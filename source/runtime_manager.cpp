@@ -75,3 +75,18 @@ void reshade::present_effect_runtime(api::swapchain *swapchain, reshade::api::co
 	if (const auto runtime = swapchain->get_private_data<reshade::runtime>())
 		runtime->on_present(present_queue);
 }
+void reshade::render_effect_runtime_mid_frame(api::swapchain *swapchain, api::resource_view rtv, api::resource_view rtv_srgb)
+{
+	if (const auto runtime = swapchain->get_private_data<reshade::runtime>())
+		runtime->on_mid_frame_render(rtv, rtv_srgb);
+}
+void reshade::render_effect_runtime_stage(api::swapchain *swapchain, nfs_render_stage stage, api::resource_view rtv, api::resource_view rtv_srgb)
+{
+	if (const auto runtime = swapchain->get_private_data<reshade::runtime>())
+		runtime->on_nfs_render_stage(stage, rtv, rtv_srgb);
+}
+void reshade::report_effect_runtime_frame_latency(api::swapchain *swapchain, uint32_t queued_frames, uint32_t max_queued_frames, uint64_t wait_time)
+{
+	if (const auto runtime = swapchain->get_private_data<reshade::runtime>())
+		runtime->on_frame_latency(queued_frames, max_queued_frames, wait_time);
+}
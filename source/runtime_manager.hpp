@@ -9,10 +9,24 @@
 
 namespace reshade
 {
+	/// <summary>
+	/// Points in the frame of the game at which techniques can be rendered instead of at present.
+	/// </summary>
+	enum class nfs_render_stage : uint32_t
+	{
+		present,
+		// Right before the Undercover motion blur pass, while the scene render target and depth-stencil are still bound
+		motion_blur,
+		count
+	};
+
 	void create_effect_runtime(api::swapchain *swapchain, api::command_queue *graphics_queue, bool is_vr = false);
 	void destroy_effect_runtime(api::swapchain *swapchain);
 
 	void init_effect_runtime(api::swapchain *swapchain);
 	void reset_effect_runtime(api::swapchain *swapchain);
 	void present_effect_runtime(api::swapchain *swapchain, api::command_queue *present_queue);
+	void render_effect_runtime_mid_frame(api::swapchain *swapchain, api::resource_view rtv, api::resource_view rtv_srgb);
+	void render_effect_runtime_stage(api::swapchain *swapchain, nfs_render_stage stage, api::resource_view rtv, api::resource_view rtv_srgb);
+	void report_effect_runtime_frame_latency(api::swapchain *swapchain, uint32_t queued_frames, uint32_t max_queued_frames, uint64_t wait_time);
 }
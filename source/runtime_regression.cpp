@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifdef RESHADE_TEST_APPLICATION
+
+#include "runtime.hpp"
+#include "runtime_internal.hpp"
+#include "dll_log.hpp"
+#include "pixel_conversion.hpp"
+#include "png_encoder.hpp"
+#include "thread_pool.hpp"
+#include <cmath> // std::isinf, std::log10
+#include <cstdio> // std::fclose, std::fprintf, std::fputs, std::fread, std::fseek, std::ftell, std::snprintf
+#include <limits>
+#include <Windows.h>
+#include <stb_image.h>
+
+extern std::filesystem::path g_reshade_base_path;
+
+// Options of the regression harness, which are set from the command line of the test application
+extern std::filesystem::path g_regression_path;
+extern bool g_regression_update_golden;
+extern double g_regression_min_psnr;
+extern unsigned int g_regression_presents_per_frame;
+
+static std::filesystem::path get_regression_file_path(const char *prefix, unsigned int frame)
+{
+	char filename[32];
+	std::snprintf(filename, std::size(filename), "%s_%.4u.png", prefix, frame);
+	return g_reshade_base_path / g_regression_path / filename;
+}
+
+static bool read_regression_file(const std::filesystem::path &path, std::vector<uint8_t> &data)
+{
+	FILE *const file = _wfsopen(path.c_str(), L"rb", SH_DENYWR);
+	if (file == nullptr)
+		return false;
+
+	data.clear();
+	std::fseek(file, 0, SEEK_END);
+	if (const long file_size = std::ftell(file); file_size > 0)
+		data.resize(static_cast<size_t>(file_size));
+	std::fseek(file, 0, SEEK_SET);
+	data.resize(std::fread(data.data(), 1, data.size(), file));
+	std::fclose(file);
+
+	return !data.empty();
+}
+
+void reshade::runtime::begin_regression_frame(api::command_list *cmd_list, api::resource back_buffer_resource)
+{
+	if (_regression_finished)
+		return;
+
+	// Wait for all effects and their textures to finish loading, so that every input frame is rendered with the complete preset
+	if (is_loading() || !_texture_uploads.empty())
+		return;
+
+	if (_regression_frame_count == 0)
+	{
+		std::error_code ec;
+		while (std::filesystem::exists(get_regression_file_path("color", _regression_frame_count), ec))
+			_regression_frame_count++;
+
+		if (_regression_frame_count == 0)
+		{
+			log::message(log::level::error, "No input frames found for regression run in '%s'! Expected files named 'color_0000.png', 'color_0001.png', ...", (g_reshade_base_path / g_regression_path).u8string().c_str());
+			finish_regression_run();
+			return;
+		}
+
+		const api::format format = api::format_to_default_typed(_back_buffer_format, 0);
+		if (_back_buffer_samples != 1 ||
+			(format != api::format::r8g8b8a8_unorm && format != api::format::r8g8b8x8_unorm && format != api::format::b8g8r8a8_unorm && format != api::format::b8g8r8x8_unorm))
+		{
+			log::message(log::level::error, "Regression runs are only supported with a single-sampled 8-bit RGBA back buffer!");
+			finish_regression_run();
+			return;
+		}
+
+		log::message(log::level::info, "Starting regression run with %u frame(s) from '%s'.", _regression_frame_count, (g_reshade_base_path / g_regression_path).u8string().c_str());
+
+		_regression_results.reserve(_regression_frame_count);
+		_regression_technique_durations.assign(_techniques.size(), {});
+	}
+
+	// The input texture is loaded again after a device reset destroyed it
+	if ((_regression_present == 0 || _regression_color_tex == 0) && !load_regression_frame())
+	{
+		finish_regression_run();
+		return;
+	}
+
+	// Replace whatever the application rendered with the input frame, on every present so that effects that accumulate over time (e.g. temporal filters) settle on it
+	cmd_list->barrier(back_buffer_resource, api::resource_usage::present, api::resource_usage::copy_dest);
+	cmd_list->copy_texture_region(_regression_color_tex, 0, nullptr, back_buffer_resource, 0, nullptr);
+	cmd_list->barrier(back_buffer_resource, api::resource_usage::copy_dest, api::resource_usage::present);
+
+	_regression_input_copied = true;
+
+#if RESHADE_GUI
+	_gather_gpu_statistics = true;
+#endif
+}
+void reshade::runtime::end_regression_frame()
+{
+	// Only frames that were rendered over an input frame count, not those where effects were still loading
+	if (!_regression_input_copied)
+		return;
+	_regression_input_copied = false;
+
+	// Durations are read back a few frames late, so the samples attributed to each input frame are shifted slightly, which does not matter for the averages over the whole run
+	for (size_t technique_index = 0; technique_index < _techniques.size() && technique_index < _regression_technique_durations.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+		if (!tech.enabled)
+			continue;
+
+		_regression_technique_durations[technique_index].first += tech.average_cpu_duration.last();
+		_regression_technique_durations[technique_index].second += tech.average_gpu_duration.last();
+	}
+	_regression_duration_samples++;
+
+	if (++_regression_present < g_regression_presents_per_frame)
+		return;
+	_regression_present = 0;
+
+	const unsigned int frame = _regression_frame++;
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * 4);
+	if (!capture_screenshot(pixels.data()))
+	{
+		log::message(log::level::error, "Failed to read back output of frame %u in regression run!", frame);
+		finish_regression_run();
+		return;
+	}
+
+	regression_frame_result &result = _regression_results.emplace_back();
+
+	// 64-bit FNV-1a hash of the output, to quickly tell which frames changed between runs
+	result.checksum = 14695981039346656037ull;
+	for (const uint8_t value : pixels)
+		result.checksum = (result.checksum ^ value) * 1099511628211ull;
+
+	const std::filesystem::path golden_path = get_regression_file_path("golden/output", frame);
+
+	std::vector<uint8_t> golden_data;
+	if (!g_regression_update_golden && read_regression_file(golden_path, golden_data))
+	{
+		int golden_width = 0, golden_height = 0, golden_channels = 0;
+		if (stbi_uc *const golden_pixels = stbi_load_from_memory(golden_data.data(), static_cast<int>(golden_data.size()), &golden_width, &golden_height, &golden_channels, STBI_rgb_alpha))
+		{
+			if (static_cast<unsigned int>(golden_width) == _width && static_cast<unsigned int>(golden_height) == _height)
+			{
+				// Compare color channels only, since alpha of the back buffer is not visible
+				uint64_t squared_error = 0;
+				for (size_t i = 0; i < pixels.size(); ++i)
+				{
+					if ((i % 4) == 3)
+						continue;
+					const int difference = static_cast<int>(pixels[i]) - static_cast<int>(golden_pixels[i]);
+					squared_error += static_cast<uint64_t>(difference * difference);
+				}
+
+				const double mean_squared_error = static_cast<double>(squared_error) / (static_cast<double>(_width) * _height * 3);
+				result.psnr = mean_squared_error != 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mean_squared_error) : std::numeric_limits<double>::infinity();
+				result.passed = result.psnr >= g_regression_min_psnr;
+
+				if (!result.passed)
+					log::message(log::level::error, "Output of frame %u differs from golden image '%s' with a PSNR of %.2f dB!", frame, golden_path.u8string().c_str(), result.psnr);
+			}
+			else
+			{
+				log::message(log::level::error, "Golden image '%s' has a size of %dx%d, which does not match the output size of %ux%u!", golden_path.u8string().c_str(), golden_width, golden_height, _width, _height);
+			}
+
+			stbi_image_free(golden_pixels);
+		}
+		else
+		{
+			log::message(log::level::error, "Failed to load golden image '%s'!", golden_path.u8string().c_str());
+		}
+	}
+	else
+	{
+		// Record the output as the new reference when there was none yet
+		if (!g_regression_update_golden)
+			log::message(log::level::warning, "No golden image found for frame %u, saving output as '%s'.", frame, golden_path.u8string().c_str());
+
+		std::error_code ec;
+		std::filesystem::create_directories(golden_path.parent_path(), ec);
+
+		bool save_success = false;
+		if (FILE *const file = _wfsopen(golden_path.c_str(), L"wb", SH_DENYNO))
+		{
+			if (std::vector<uint8_t> encoded_data;
+				utils::encode_png(*_worker_pool, pixels.data(), _width, _height, 4, encoded_data))
+				save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
+			fclose(file);
+		}
+
+		if (!save_success)
+			log::message(log::level::error, "Failed to save golden image '%s'!", golden_path.u8string().c_str());
+
+		result.passed = save_success;
+	}
+
+	if (_regression_results.size() == _regression_frame_count)
+		finish_regression_run();
+}
+
+bool reshade::runtime::load_regression_frame()
+{
+	const std::filesystem::path color_path = get_regression_file_path("color", _regression_frame);
+
+	std::vector<uint8_t> file_data;
+	if (!read_regression_file(color_path, file_data))
+	{
+		log::message(log::level::error, "Failed to read input frame '%s'!", color_path.u8string().c_str());
+		return false;
+	}
+
+	int width = 0, height = 0, channels = 0;
+	stbi_uc *const color_pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_rgb_alpha);
+	if (color_pixels == nullptr)
+	{
+		log::message(log::level::error, "Failed to load input frame '%s'!", color_path.u8string().c_str());
+		return false;
+	}
+
+	if (static_cast<unsigned int>(width) != _width || static_cast<unsigned int>(height) != _height)
+	{
+		log::message(log::level::error, "Input frame '%s' has a size of %dx%d, which does not match the back buffer size of %ux%u! Use the '-width' and '-height' options to change it.", color_path.u8string().c_str(), width, height, _width, _height);
+		stbi_image_free(color_pixels);
+		return false;
+	}
+
+	const api::format format = api::format_to_default_typed(_back_buffer_format, 0);
+	if (format == api::format::b8g8r8a8_unorm || format == api::format::b8g8r8x8_unorm)
+		utils::swap_red_blue_rgba8(color_pixels, static_cast<size_t>(width) * static_cast<size_t>(height));
+
+	if (_regression_color_tex == 0 &&
+		!_device->create_resource(api::resource_desc(_width, _height, 1, 1, _back_buffer_format, 1, api::memory_heap::gpu_only, api::resource_usage::copy_dest | api::resource_usage::copy_source), nullptr, api::resource_usage::copy_source, &_regression_color_tex))
+	{
+		log::message(log::level::error, "Failed to create regression input texture!");
+		stbi_image_free(color_pixels);
+		return false;
+	}
+
+	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
+	cmd_list->barrier(_regression_color_tex, api::resource_usage::copy_source, api::resource_usage::copy_dest);
+	_device->update_texture_region({ color_pixels, _width * 4, _width * _height * 4 }, _regression_color_tex, 0);
+	cmd_list->barrier(_regression_color_tex, api::resource_usage::copy_dest, api::resource_usage::copy_source);
+
+	stbi_image_free(color_pixels);
+
+	// Depth is optional and stored as a 16-bit grayscale image, which is converted to floating-point so that it matches what effects usually sample from the depth buffer
+	const std::filesystem::path depth_path = get_regression_file_path("depth", _regression_frame);
+	if (!read_regression_file(depth_path, file_data))
+		return true;
+
+	stbi_us *const depth_pixels = stbi_load_16_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height, &channels, STBI_grey);
+	if (depth_pixels == nullptr || static_cast<unsigned int>(width) != _width || static_cast<unsigned int>(height) != _height)
+	{
+		log::message(log::level::error, "Failed to load depth of input frame '%s', or its size does not match the back buffer size!", depth_path.u8string().c_str());
+		stbi_image_free(depth_pixels);
+		return false;
+	}
+
+	std::vector<float> depth_data(static_cast<size_t>(width) * static_cast<size_t>(height));
+	for (size_t i = 0; i < depth_data.size(); ++i)
+		depth_data[i] = depth_pixels[i] / 65535.0f;
+
+	stbi_image_free(depth_pixels);
+
+	if (_regression_depth_tex == 0)
+	{
+		if (!_device->create_resource(api::resource_desc(_width, _height, 1, 1, api::format::r32_float, 1, api::memory_heap::gpu_only, api::resource_usage::shader_resource | api::resource_usage::copy_dest), nullptr, api::resource_usage::shader_resource, &_regression_depth_tex) ||
+			!_device->create_resource_view(_regression_depth_tex, api::resource_usage::shader_resource, api::resource_view_desc(api::format::r32_float), &_regression_depth_srv))
+		{
+			log::message(log::level::error, "Failed to create regression depth texture!");
+			return false;
+		}
+
+		update_texture_bindings("DEPTH", _regression_depth_srv, _regression_depth_srv);
+	}
+
+	cmd_list->barrier(_regression_depth_tex, api::resource_usage::shader_resource, api::resource_usage::copy_dest);
+	_device->update_texture_region({ depth_data.data(), _width * 4, _width * _height * 4 }, _regression_depth_tex, 0);
+	cmd_list->barrier(_regression_depth_tex, api::resource_usage::copy_dest, api::resource_usage::shader_resource);
+
+	return true;
+}
+
+void reshade::runtime::finish_regression_run()
+{
+	_regression_finished = true;
+
+	size_t passed_count = 0;
+	for (const regression_frame_result &result : _regression_results)
+		passed_count += result.passed ? 1 : 0;
+
+	const bool passed = _regression_frame_count != 0 && passed_count == _regression_frame_count;
+
+	if (!_regression_results.empty())
+		save_regression_report();
+
+	log::message(passed ? log::level::info : log::level::error, "Finished regression run with %zu of %u frame(s) passing.", passed_count, _regression_frame_count);
+
+	// The test application returns the exit code of the quit message, so that scripts can check the result
+	PostQuitMessage(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+bool reshade::runtime::save_regression_report() const
+{
+	char timestamp[21];
+	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm tm; localtime_s(&tm, &t);
+	std::snprintf(timestamp, std::size(timestamp), "%.4d-%.2d-%.2d %.2d-%.2d-%.2d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+	const std::filesystem::path report_path = g_reshade_base_path / g_regression_path / std::filesystem::u8path(std::string("Regression Report ") + timestamp);
+
+	std::filesystem::path csv_path = report_path;
+	csv_path += L".csv";
+	FILE *const csv_file = _wfsopen(csv_path.c_str(), L"w", SH_DENYWR);
+	if (csv_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write regression report to '%s'!", csv_path.u8string().c_str());
+		return false;
+	}
+
+	std::fputs("frame,checksum,psnr_db,passed\n", csv_file);
+	for (size_t i = 0; i < _regression_results.size(); ++i)
+	{
+		const regression_frame_result &result = _regression_results[i];
+		std::fprintf(csv_file, "%zu,%016llx,%.4f,%d\n", i, result.checksum, result.psnr, result.passed ? 1 : 0);
+	}
+	std::fclose(csv_file);
+
+	std::filesystem::path json_path = report_path;
+	json_path += L".json";
+	FILE *const json_file = _wfsopen(json_path.c_str(), L"w", SH_DENYWR);
+	if (json_file == nullptr)
+	{
+		log::message(log::level::error, "Failed to write regression report to '%s'!", json_path.u8string().c_str());
+		return false;
+	}
+
+	size_t passed_count = 0;
+	for (const regression_frame_result &result : _regression_results)
+		passed_count += result.passed ? 1 : 0;
+
+	std::fprintf(json_file,
+		"{\n"
+		"\t\"preset\": \"%s\",\n"
+		"\t\"width\": %u,\n"
+		"\t\"height\": %u,\n"
+		"\t\"frames\": %zu,\n"
+		"\t\"passed\": %zu,\n"
+		"\t\"min_psnr_db\": %.2f,\n",
+		_current_preset_path.filename().u8string().c_str(),
+		_width,
+		_height,
+		_regression_results.size(),
+		passed_count,
+		g_regression_min_psnr);
+
+	// PSNR is infinite for identical images, which JSON cannot represent, so write null for those
+	std::fputs("\t\"results\": [\n", json_file);
+	for (size_t i = 0; i < _regression_results.size(); ++i)
+	{
+		const regression_frame_result &result = _regression_results[i];
+		if (std::isinf(result.psnr))
+			std::fprintf(json_file, "\t\t{ \"frame\": %zu, \"checksum\": \"%016llx\", \"psnr_db\": null, \"passed\": %s }%s\n", i, result.checksum, result.passed ? "true" : "false", i + 1 < _regression_results.size() ? "," : "");
+		else
+			std::fprintf(json_file, "\t\t{ \"frame\": %zu, \"checksum\": \"%016llx\", \"psnr_db\": %.4f, \"passed\": %s }%s\n", i, result.checksum, result.psnr, result.passed ? "true" : "false", i + 1 < _regression_results.size() ? "," : "");
+	}
+	std::fputs("\t],\n", json_file);
+
+	std::fputs("\t\"effects\": [\n", json_file);
+	for (size_t effect_index = 0, written = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+		if (!effect.compiled)
+			continue;
+
+		std::fprintf(json_file, "%s\t\t{ \"file\": \"%s\", \"load_ms\": %.3f }", written++ != 0 ? ",\n" : "", effect.source_file.filename().u8string().c_str(), effect.load_duration);
+	}
+	std::fputs("\n\t],\n", json_file);
+
+	std::fputs("\t\"techniques\": [\n", json_file);
+	for (size_t technique_index = 0, written = 0; technique_index < _techniques.size() && technique_index < _regression_technique_durations.size(); ++technique_index)
+	{
+		const technique &tech = _techniques[technique_index];
+		if (!tech.enabled)
+			continue;
+
+		const std::pair<uint64_t, uint64_t> &durations = _regression_technique_durations[technique_index];
+		std::fprintf(json_file, "%s\t\t{ \"effect\": \"%s\", \"name\": \"%s\", \"cpu_ms\": %.4f, \"gpu_ms\": %.4f }",
+			written++ != 0 ? ",\n" : "",
+			_effects[tech.effect_index].source_file.filename().u8string().c_str(),
+			tech.name.c_str(),
+			_regression_duration_samples != 0 ? durations.first * 1e-6 / _regression_duration_samples : 0.0,
+			_regression_duration_samples != 0 ? durations.second * 1e-6 / _regression_duration_samples : 0.0);
+	}
+	std::fputs("\n\t]\n", json_file);
+	std::fputs("}\n", json_file);
+	std::fclose(json_file);
+
+	log::message(log::level::info, "Saved regression report with %zu frame(s) to '%s'.", _regression_results.size(), report_path.u8string().c_str());
+	return true;
+}
+
+void reshade::runtime::destroy_regression_resources()
+{
+	if (_regression_depth_srv != 0)
+		update_texture_bindings("DEPTH", {}, {});
+
+	_device->destroy_resource(_regression_color_tex);
+	_regression_color_tex = {};
+	_device->destroy_resource_view(_regression_depth_srv);
+	_regression_depth_srv = {};
+	_device->destroy_resource(_regression_depth_tex);
+	_regression_depth_tex = {};
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "search_index.hpp"
+#include <iterator> // std::back_inserter
+#include <algorithm> // std::set_intersection, std::search, std::sort, std::transform
+
+static inline char to_lower(char c)
+{
+	return ('A' <= c && c <= 'Z') ? static_cast<char>(c + ' ') : c;
+}
+static inline uint32_t make_trigram(const char *text)
+{
+	return static_cast<uint8_t>(to_lower(text[0])) | (static_cast<uint8_t>(to_lower(text[1])) << 8) | (static_cast<uint8_t>(to_lower(text[2])) << 16);
+}
+
+void reshade::utils::search_index::clear()
+{
+	_entries.clear();
+	_trigrams.clear();
+}
+
+void reshade::utils::search_index::add(std::initializer_list<std::string_view> texts)
+{
+	const size_t entry = _entries.size();
+
+	std::string &entry_text = _entries.emplace_back();
+	for (const std::string_view text : texts)
+	{
+		if (!entry_text.empty())
+			entry_text += '\n';
+
+		const size_t offset = entry_text.size();
+		entry_text.resize(offset + text.size());
+		std::transform(text.begin(), text.end(), entry_text.begin() + offset, to_lower);
+
+		for (size_t i = 0; i + 3 <= text.size(); ++i)
+		{
+			// Entries are added in ascending order, so only need to check the last element to keep the list free of duplicates
+			std::vector<size_t> &list = _trigrams[make_trigram(text.data() + i)];
+			if (list.empty() || list.back() != entry)
+				list.push_back(entry);
+		}
+	}
+}
+
+void reshade::utils::search_index::find(std::string_view query, std::vector<size_t> &out_matches) const
+{
+	out_matches.clear();
+
+	if (query.size() < 3)
+	{
+		// Queries that are shorter than a trigram have to be compared against every entry
+		for (size_t entry = 0; entry < _entries.size(); ++entry)
+			if (matches(entry, query))
+				out_matches.push_back(entry);
+		return;
+	}
+
+	// Gather the candidate lists of all trigrams in the query, starting with the shortest one to keep the intersection small
+	std::vector<const std::vector<size_t> *> lists;
+	for (size_t i = 0; i + 3 <= query.size(); ++i)
+	{
+		const auto it = _trigrams.find(make_trigram(query.data() + i));
+		if (it == _trigrams.end())
+			return; // No entry contains this trigram, so there can be no match
+
+		lists.push_back(&it->second);
+	}
+
+	std::sort(lists.begin(), lists.end(),
+		[](const std::vector<size_t> *lhs, const std::vector<size_t> *rhs) { return lhs->size() < rhs->size(); });
+
+	std::vector<size_t> candidates = *lists[0], intersection;
+	for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+	{
+		intersection.clear();
+		std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+
+	// Containing all trigrams does not imply containing them in the right order, so verify every candidate
+	for (const size_t entry : candidates)
+		if (matches(entry, query))
+			out_matches.push_back(entry);
+}
+
+bool reshade::utils::search_index::matches(size_t entry, std::string_view query) const
+{
+	const std::string &text = _entries[entry];
+
+	return query.empty() ||
+		std::search(text.cbegin(), text.cend(), query.cbegin(), query.cend(),
+			[](const char c1, const char c2) { return c1 == to_lower(c2); }) != text.cend();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+namespace reshade::utils
+{
+	/// <summary>
+	/// Case-insensitive substring search over a set of strings.
+	/// Every entry is split into overlapping three character sequences (trigrams), so that a query only has to be compared against the entries that contain all of its trigrams.
+	/// </summary>
+	class search_index
+	{
+	public:
+		/// <summary>
+		/// Removes all entries from the index.
+		/// </summary>
+		void clear();
+
+		/// <summary>
+		/// Adds a new entry to the index, which is identified by the order in which entries were added.
+		/// </summary>
+		/// <param name="texts">Strings the entry can be found by (e.g. a name and its UI label).</param>
+		void add(std::initializer_list<std::string_view> texts);
+
+		/// <summary>
+		/// Number of entries in the index.
+		/// </summary>
+		size_t size() const { return _entries.size(); }
+
+		/// <summary>
+		/// Finds all entries which contain the specified query.
+		/// </summary>
+		/// <param name="query">String to search for. An empty query matches all entries.</param>
+		/// <param name="out_matches">Vector that is filled with the indices of the matching entries, in ascending order.</param>
+		void find(std::string_view query, std::vector<size_t> &out_matches) const;
+		/// <summary>
+		/// Checks whether the specified entry contains the query, without consulting the trigram index.
+		/// </summary>
+		bool matches(size_t entry, std::string_view query) const;
+
+	private:
+		// Lowercase copy of all strings of an entry, separated by new line characters so that no match can span two strings
+		std::vector<std::string> _entries;
+		// Sorted list of entries that contain each trigram
+		std::unordered_map<uint32_t, std::vector<size_t>> _trigrams;
+	};
+}
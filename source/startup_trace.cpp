@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "startup_trace.hpp"
+#include "dll_log.hpp"
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdio> // std::snprintf
+#include <Windows.h>
+
+struct trace_span
+{
+	std::string name;
+	DWORD thread_id;
+	int64_t begin_timestamp;
+	int64_t end_timestamp;
+};
+
+static std::atomic<bool> s_recording = false;
+static std::mutex s_mutex;
+static std::vector<trace_span> s_spans;
+static std::filesystem::path s_path;
+static int64_t s_start_timestamp = 0;
+
+int64_t reshade::startup_trace::timestamp()
+{
+	LARGE_INTEGER counter = {};
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+void reshade::startup_trace::start(const std::filesystem::path &path, int64_t start_timestamp)
+{
+	const std::unique_lock<std::mutex> lock(s_mutex);
+
+	s_path = path;
+	s_start_timestamp = start_timestamp;
+	s_spans.clear();
+	s_spans.reserve(256);
+
+	s_recording.store(true, std::memory_order_release);
+}
+void reshade::startup_trace::finish()
+{
+	if (!s_recording.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	std::vector<trace_span> spans;
+	std::filesystem::path path;
+	{ const std::unique_lock<std::mutex> lock(s_mutex);
+		spans.swap(s_spans);
+		path.swap(s_path);
+	}
+
+	LARGE_INTEGER frequency = {};
+	QueryPerformanceFrequency(&frequency);
+	const auto to_microseconds = [frequency = static_cast<double>(frequency.QuadPart)](int64_t ticks) {
+		return static_cast<double>(ticks) * 1000000.0 / frequency;
+	};
+
+	const DWORD process_id = GetCurrentProcessId();
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (size_t i = 0; i < spans.size(); ++i)
+	{
+		const trace_span &span = spans[i];
+
+		if (i != 0)
+			json += ',';
+		json += "{\"name\":\"";
+		for (const char c : span.name)
+		{
+			if (c == '\"' || c == '\\')
+				json += '\\';
+			if (static_cast<unsigned char>(c) >= 0x20)
+				json += c;
+		}
+
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+			to_microseconds(span.begin_timestamp - s_start_timestamp),
+			to_microseconds(span.end_timestamp - span.begin_timestamp),
+			process_id,
+			span.thread_id);
+		json += buffer;
+	}
+	json += "]}\n";
+
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		log::message(log::level::error, "Failed to write startup trace to '%s' with error code %lu.", path.u8string().c_str(), GetLastError());
+		return;
+	}
+
+	DWORD bytes_written = 0;
+	WriteFile(file, json.data(), static_cast<DWORD>(json.size()), &bytes_written, nullptr);
+	CloseHandle(file);
+
+	log::message(log::level::info, "Wrote startup trace with %zu span(s) covering %.1f ms to '%s'.", spans.size(), to_microseconds(timestamp() - s_start_timestamp) / 1000.0, path.u8string().c_str());
+}
+
+bool reshade::startup_trace::is_recording()
+{
+	return s_recording.load(std::memory_order_acquire);
+}
+
+void reshade::startup_trace::add_span(std::string name, int64_t begin_timestamp, int64_t end_timestamp)
+{
+	const std::unique_lock<std::mutex> lock(s_mutex);
+
+	// Spans that end after the trace was finished are dropped
+	if (!s_recording.load(std::memory_order_relaxed))
+		return;
+
+	s_spans.push_back({ std::move(name), GetCurrentThreadId(), begin_timestamp, end_timestamp });
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <filesystem>
+
+namespace reshade::startup_trace
+{
+	/// <summary>
+	/// Gets the current value of the performance counter used for span timestamps.
+	/// </summary>
+	int64_t timestamp();
+
+	/// <summary>
+	/// Starts recording spans, which are written as a Chrome trace (see "chrome://tracing" or https://ui.perfetto.dev) to the specified file once <see cref="finish"/> is called.
+	/// </summary>
+	/// <param name="path">Path to the trace file to write.</param>
+	/// <param name="start_timestamp">Timestamp the trace starts at, which may be before this call (e.g. when the module was attached).</param>
+	void start(const std::filesystem::path &path, int64_t start_timestamp);
+	/// <summary>
+	/// Stops recording spans and writes all recorded ones to the trace file. Only the first call after <see cref="start"/> has an effect.
+	/// </summary>
+	void finish();
+
+	/// <summary>
+	/// Checks whether spans are currently being recorded.
+	/// </summary>
+	bool is_recording();
+
+	/// <summary>
+	/// Records a span on the calling thread between the specified timestamps.
+	/// </summary>
+	void add_span(std::string name, int64_t begin_timestamp, int64_t end_timestamp);
+
+	/// <summary>
+	/// Records a span on the calling thread for the lifetime of this object, if spans were being recorded when it was constructed.
+	/// </summary>
+	class scoped_span
+	{
+	public:
+		explicit scoped_span(const char *name, const std::string &detail = std::string()) :
+			_begin_timestamp(is_recording() ? timestamp() : 0)
+		{
+			if (_begin_timestamp != 0)
+				_name = detail.empty() ? name : std::string(name) + ' ' + detail;
+		}
+		scoped_span(const scoped_span &) = delete;
+		scoped_span &operator=(const scoped_span &) = delete;
+		~scoped_span()
+		{
+			if (_begin_timestamp != 0)
+				add_span(std::move(_name), _begin_timestamp, timestamp());
+		}
+
+	private:
+		int64_t _begin_timestamp;
+		std::string _name;
+	};
+}
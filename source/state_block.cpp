@@ -4,9 +4,12 @@
  */
 
 #include "state_block.hpp"
+#include "ini_file.hpp"
+#include "d3d9/d3d9_impl_device.hpp"
 #include "d3d9/d3d9_impl_state_block.hpp"
 #include "d3d10/d3d10_impl_state_block.hpp"
-#include "d3d11/d3d11_impl_state_block.hpp"
+#include "d3d11/d3d11_impl_device.hpp"
+#include "d3d11/d3d11_impl_device_context.hpp"
 #include "opengl/opengl_impl_device.hpp"
 #include "opengl/opengl_impl_state_block.hpp"
 
@@ -15,14 +18,26 @@ void reshade::api::create_state_block(api::device *device, state_block *out_stat
 	switch (device->get_api())
 	{
 	case api::device_api::d3d9:
-		*out_state_block = { reinterpret_cast<uintptr_t>(new d3d9::state_block(reinterpret_cast<IDirect3DDevice9 *>(device->get_native()))) };
+	{
+		// Optionally only capture the states that are actually modified between capture and apply, instead of the entire device state
+		bool track_modified_states = false;
+		global_config().get("APP", "D3D9TrackModifiedStates", track_modified_states);
+
+		*out_state_block = { reinterpret_cast<uintptr_t>(new d3d9::state_block(reinterpret_cast<IDirect3DDevice9 *>(device->get_native()), track_modified_states ? static_cast<d3d9::device_impl *>(device) : nullptr)) };
 		break;
+	}
 	case api::device_api::d3d10:
 		*out_state_block = { reinterpret_cast<uintptr_t>(new d3d10::state_block(reinterpret_cast<ID3D10Device *>(device->get_native()))) };
 		break;
 	case api::device_api::d3d11:
-		*out_state_block = { reinterpret_cast<uintptr_t>(new d3d11::state_block(reinterpret_cast<ID3D11Device *>(device->get_native()))) };
+	{
+		// Optionally only capture and restore the states that are actually modified between capture and apply, taking those the application bound from the shadow maintained by the device context proxy
+		bool track_modified_states = false;
+		global_config().get("APP", "D3D11TrackModifiedStates", track_modified_states);
+
+		*out_state_block = { reinterpret_cast<uintptr_t>(new d3d11::state_block(reinterpret_cast<ID3D11Device *>(device->get_native()), track_modified_states)) };
 		break;
+	}
 	case api::device_api::opengl:
 		*out_state_block = { reinterpret_cast<uintptr_t>(new opengl::state_block()) };
 		break;
@@ -57,6 +72,7 @@ void reshade::api::apply_state(api::command_list *cmd_list, state_block state_bl
 	{
 	case api::device_api::d3d9:
 		reinterpret_cast<d3d9::state_block *>(state_block.handle)->apply_and_release();
+		static_cast<d3d9::device_impl *>(device)->end_state_shadowing();
 		break;
 	case api::device_api::d3d10:
 		reinterpret_cast<d3d10::state_block *>(state_block.handle)->apply_and_release();
@@ -77,12 +93,14 @@ void reshade::api::capture_state(api::command_list *cmd_list, state_block state_
 	{
 	case api::device_api::d3d9:
 		reinterpret_cast<d3d9::state_block *>(state_block.handle)->capture();
+		// The application cannot modify device state until the state is applied again, so it is safe to defer constant uploads in between
+		static_cast<d3d9::device_impl *>(device)->begin_state_shadowing();
 		break;
 	case api::device_api::d3d10:
 		reinterpret_cast<d3d10::state_block *>(state_block.handle)->capture();
 		break;
 	case api::device_api::d3d11:
-		reinterpret_cast<d3d11::state_block *>(state_block.handle)->capture(reinterpret_cast<ID3D11DeviceContext *>(cmd_list->get_native()));
+		reinterpret_cast<d3d11::state_block *>(state_block.handle)->capture(static_cast<d3d11::device_context_impl *>(cmd_list));
 		break;
 	case api::device_api::opengl:
 		reinterpret_cast<opengl::state_block *>(state_block.handle)->capture(static_cast<opengl::device_impl *>(device)->get_compatibility_context());
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "telemetry.hpp"
+#include "dll_log.hpp"
+#include <string>
+#include <Windows.h>
+
+bool reshade::telemetry_writer::open()
+{
+	close();
+
+	const std::string name = "Local\\ReShadeTelemetry-" + std::to_string(GetCurrentProcessId());
+
+	const HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(telemetry_block), name.c_str());
+	if (mapping == nullptr)
+	{
+		log::message(log::level::error, "Failed to create telemetry shared memory block with error code %lu.", GetLastError());
+		return false;
+	}
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		// Another runtime in this process already publishes its statistics
+		CloseHandle(mapping);
+		return false;
+	}
+
+	const auto block = static_cast<telemetry_block *>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(telemetry_block)));
+	if (block == nullptr)
+	{
+		log::message(log::level::error, "Failed to map telemetry shared memory block with error code %lu.", GetLastError());
+		CloseHandle(mapping);
+		return false;
+	}
+
+	// Page file backed mappings are zero-initialized, so only need to fill in the header
+	block->size = sizeof(telemetry_block);
+	block->version = telemetry_block::VERSION;
+	block->sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	block->magic = telemetry_block::MAGIC;
+
+	LARGE_INTEGER frequency = {};
+	QueryPerformanceFrequency(&frequency);
+	block->timestamp_frequency = frequency.QuadPart;
+
+	_mapping = mapping;
+	_block = block;
+
+	log::message(log::level::info, "Publishing statistics in shared memory block \"%s\".", name.c_str());
+
+	return true;
+}
+void reshade::telemetry_writer::close()
+{
+	if (_block != nullptr)
+		UnmapViewOfFile(_block);
+	_block = nullptr;
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	_mapping = nullptr;
+}
+
+reshade::telemetry_block *reshade::telemetry_writer::begin_update()
+{
+	// Only the runtime writes to the block, so a relaxed load of the own last value is sufficient
+	_block->sequence.store(_block->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	// Make the odd sequence number visible before any of the data is modified
+	std::atomic_thread_fence(std::memory_order_release);
+
+	LARGE_INTEGER timestamp = {};
+	QueryPerformanceCounter(&timestamp);
+	_block->timestamp = timestamp.QuadPart;
+
+	return _block;
+}
+void reshade::telemetry_writer::end_update()
+{
+	_block->sequence.store(_block->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace reshade
+{
+	/// <summary>
+	/// Layout of the shared memory block the runtime publishes its statistics in, so that external tools can read them without the overhead of the overlay, file logging or screen capture.
+	/// The block is named "Local\ReShadeTelemetry-[process id]" and is updated once per present.
+	/// </summary>
+	/// <remarks>
+	/// Readers have to follow the seqlock protocol: Read <see cref="sequence"/>, retry if it is odd, copy the block, then read <see cref="sequence"/> again and retry if it changed.
+	/// </remarks>
+	struct telemetry_block
+	{
+		static constexpr uint32_t MAGIC = 0x4D4C4554; // 'TELM'
+		static constexpr uint32_t VERSION = 4;
+		static constexpr uint32_t MAX_STAGES = 8;
+		static constexpr uint32_t MAX_TECHNIQUES = 64;
+		static constexpr uint32_t MAX_STREAM_EVENTS = 16;
+		static constexpr uint32_t MAX_PASSES = 256;
+
+		uint32_t magic;
+		uint32_t version;
+		/// <summary>
+		/// Size of this structure in bytes, so that readers can detect layout changes.
+		/// </summary>
+		uint32_t size;
+		/// <summary>
+		/// Incremented before and after every update, so that it is odd while the block is being written to.
+		/// </summary>
+		std::atomic<uint32_t> sequence;
+
+		uint64_t frame_count;
+		/// <summary>
+		/// Value of 'QueryPerformanceCounter' at the time of the update, with the frequency in <see cref="timestamp_frequency"/>.
+		/// </summary>
+		int64_t timestamp;
+		int64_t timestamp_frequency;
+
+		float frame_time; // Milliseconds
+		uint32_t stage_count;
+		/// <summary>
+		/// CPU time spent in each present stage (see 'reshade::api::present_stage') during the last frame, in milliseconds.
+		/// </summary>
+		float stage_cpu_times[MAX_STAGES];
+
+		int32_t gameflow_state;
+		/// <summary>
+		/// Number of steps of the world detail quality ladder that are currently applied, zero while running at full detail.
+		/// </summary>
+		uint32_t world_detail_level;
+		/// <summary>
+		/// Total memory used by effects in bytes, see <c>reshade::runtime::get_total_memory_usage</c>.
+		/// </summary>
+		uint64_t memory_usage;
+
+		uint32_t technique_count;
+		/// <summary>
+		/// Total number of steps the world detail governor took in either direction, so that readers notice steps that happened in between their reads.
+		/// </summary>
+		uint32_t world_detail_step_count;
+		struct technique
+		{
+			char name[56];
+			float cpu_time; // Milliseconds
+			float gpu_time;
+		} techniques[MAX_TECHNIQUES];
+
+		/// <summary>
+		/// Total number of world streaming calls of the game recorded so far.
+		/// The last <see cref="MAX_STREAM_EVENTS"/> of them are kept in <see cref="stream_events"/>, with event N at index N % MAX_STREAM_EVENTS.
+		/// </summary>
+		uint32_t stream_event_count;
+		uint32_t reserved;
+		struct stream_event
+		{
+			enum : uint32_t { SIM_SET_STREAM = 0, LOAD_REGION = 1 };
+
+			/// <summary>
+			/// Value of 'QueryPerformanceCounter' when the call started, with the frequency in <see cref="timestamp_frequency"/>.
+			/// </summary>
+			int64_t timestamp;
+			/// <summary>
+			/// Frame count of the first present after the call finished, to correlate the call with the frame it stalled.
+			/// </summary>
+			uint64_t frame_count;
+			float duration; // Milliseconds
+			uint32_t function; // One of the values above
+			uint32_t blocking; // Whether the game asked to wait for streaming to finish
+			float position[3]; // Position streamed around, or of the first vehicle for region loads, in the coordinate order of the simulation
+		} stream_events[MAX_STREAM_EVENTS];
+
+		/// <summary>
+		/// Number of entries in <see cref="passes"/>, which is zero unless measuring the GPU time of individual passes was enabled in the overlay.
+		/// </summary>
+		uint32_t pass_count;
+		struct pass
+		{
+			uint16_t technique_index; // Index into 'techniques'
+			uint16_t pass_index;
+			float gpu_time; // Milliseconds
+		} passes[MAX_PASSES];
+	};
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+	/// <summary>
+	/// Owner of the shared memory block the runtime writes its statistics to.
+	/// </summary>
+	class telemetry_writer
+	{
+	public:
+		telemetry_writer() = default;
+		telemetry_writer(const telemetry_writer &) = delete;
+		telemetry_writer &operator=(const telemetry_writer &) = delete;
+		~telemetry_writer() { close(); }
+
+		/// <summary>
+		/// Creates the shared memory block for the current process.
+		/// </summary>
+		bool open();
+		void close();
+
+		bool is_open() const { return _block != nullptr; }
+
+		/// <summary>
+		/// Marks the block as being written to and returns it, so that the contents can be updated.
+		/// Every call has to be followed by a call to <see cref="end_update"/>.
+		/// </summary>
+		telemetry_block *begin_update();
+		void end_update();
+
+	private:
+		void *_mapping = nullptr;
+		telemetry_block *_block = nullptr;
+	};
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "thread_pool.hpp"
+#include <atomic>
+#include <algorithm> // std::clamp, std::max, std::min
+#include <Windows.h>
+
+reshade::thread_pool::thread_pool(unsigned int num_threads)
+{
+	if (num_threads == 0)
+	{
+		// Leave one core for the application itself
+		num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+#ifndef _WIN64
+		// Limit number of threads in 32-bit due to the limited about of address space being available there and compilation being memory hungry
+		num_threads = std::min(num_threads, 4u);
+#endif
+	}
+
+	_queues.reserve(num_threads);
+	for (unsigned int i = 0; i < num_threads; ++i)
+		_queues.push_back(std::make_unique<worker_queue>());
+
+	_threads.reserve(num_threads);
+	for (unsigned int i = 0; i < num_threads; ++i)
+		_threads.emplace_back(&thread_pool::worker_main, this, static_cast<size_t>(i));
+}
+reshade::thread_pool::~thread_pool()
+{
+	{
+		const std::unique_lock<std::mutex> lock(_state_mutex);
+		_exit = true;
+	}
+
+	_wake_condition.notify_all();
+
+	// Workers only exit after all queued tasks were executed
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+void reshade::thread_pool::submit(priority prio, std::function<void()> &&task)
+{
+	size_t queue_index;
+	{
+		const std::unique_lock<std::mutex> lock(_state_mutex);
+		queue_index = _next_queue++ % _queues.size();
+		_num_pending++;
+	}
+
+	{
+		worker_queue &queue = *_queues[queue_index];
+		const std::unique_lock<std::mutex> lock(queue.mutex);
+		queue.tasks[static_cast<size_t>(prio)].push_back(std::move(task));
+	}
+
+	// Only make the task claimable after it was added to a queue, so that a claim always finds a task
+	bool throttled;
+	{
+		const std::unique_lock<std::mutex> lock(_state_mutex);
+		_num_unclaimed++;
+		throttled = _max_active_threads < _threads.size();
+	}
+
+	// A single notification could wake up a worker that is not allowed to pick up tasks, which would then go back to sleep without passing it on
+	if (throttled)
+		_wake_condition.notify_all();
+	else
+		_wake_condition.notify_one();
+}
+
+void reshade::thread_pool::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(_state_mutex);
+	_idle_condition.wait(lock, [this]() { return _num_pending == 0; });
+}
+
+void reshade::thread_pool::parallel_for(priority prio, size_t count, std::function<void(size_t)> func)
+{
+	if (count == 0)
+		return;
+
+	struct shared_state
+	{
+		std::function<void(size_t)> func;
+		size_t count;
+		std::atomic<size_t> next_index = 0;
+		size_t num_finished = 0;
+		std::mutex mutex;
+		std::condition_variable finished_condition;
+
+		void run()
+		{
+			// Indices are claimed one at a time, so whichever thread gets to the work first takes as much of it as it can
+			for (size_t index; (index = next_index++) < count;)
+			{
+				func(index);
+
+				const std::unique_lock<std::mutex> lock(mutex);
+				if (++num_finished == count)
+					finished_condition.notify_all();
+			}
+		}
+	};
+
+	const auto state = std::make_shared<shared_state>();
+	state->func = std::move(func);
+	state->count = count;
+
+	// Helpers that only start after all indices were claimed return right away, so it is fine if they are picked up late
+	const size_t num_helpers = std::min(count - 1, _threads.size());
+	for (size_t i = 0; i < num_helpers; ++i)
+		submit(prio, [state]() { state->run(); });
+
+	state->run();
+
+	// Only indices that were claimed by another thread and are currently executing are left, so waiting here cannot deadlock
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished_condition.wait(lock, [&state]() { return state->num_finished == state->count; });
+}
+
+void reshade::thread_pool::set_throttle(size_t max_active_threads, int thread_priority, uintptr_t affinity_mask)
+{
+	{
+		const std::unique_lock<std::mutex> lock(_state_mutex);
+		_max_active_threads = std::clamp<size_t>(max_active_threads, 1, _threads.size());
+	}
+
+	// Wake up workers that may have become active again
+	_wake_condition.notify_all();
+
+	if (affinity_mask == 0)
+	{
+		DWORD_PTR system_affinity_mask = 0;
+		DWORD_PTR process_affinity_mask = 0;
+		GetProcessAffinityMask(GetCurrentProcess(), &process_affinity_mask, &system_affinity_mask);
+		affinity_mask = process_affinity_mask;
+	}
+
+	for (std::thread &thread : _threads)
+	{
+		const HANDLE handle = static_cast<HANDLE>(thread.native_handle());
+		SetThreadPriority(handle, thread_priority);
+		if (affinity_mask != 0)
+			SetThreadAffinityMask(handle, affinity_mask);
+	}
+}
+
+void reshade::thread_pool::worker_main(size_t worker_index)
+{
+	std::function<void()> task;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_state_mutex);
+			_wake_condition.wait(lock, [this, worker_index]() { return _exit || (_num_unclaimed != 0 && worker_index < _max_active_threads); });
+
+			if (_num_unclaimed == 0)
+				return; // Exit was requested and there is no work left
+
+			// Claim one of the queued tasks, it is then guaranteed that there is a task left for this worker in one of the queues
+			_num_unclaimed--;
+		}
+
+		while (!pop_task(worker_index, task))
+			std::this_thread::yield();
+
+		task();
+		task = nullptr;
+
+		{
+			const std::unique_lock<std::mutex> lock(_state_mutex);
+			if (--_num_pending == 0)
+				_idle_condition.notify_all();
+		}
+	}
+}
+
+bool reshade::thread_pool::pop_task(size_t worker_index, std::function<void()> &task)
+{
+	// Go through the priorities in order, trying the own queue first and then stealing from the other workers
+	for (size_t prio = 0; prio < static_cast<size_t>(priority::count); ++prio)
+	{
+		for (size_t i = 0; i < _queues.size(); ++i)
+		{
+			worker_queue &queue = *_queues[(worker_index + i) % _queues.size()];
+			const std::unique_lock<std::mutex> lock(queue.mutex);
+
+			std::deque<std::function<void()>> &tasks = queue.tasks[prio];
+			if (tasks.empty())
+				continue;
+
+			// Own queue is processed in submission order, while stealing takes from the back to reduce contention with the owner
+			if (i == 0)
+			{
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			else
+			{
+				task = std::move(tasks.back());
+				tasks.pop_back();
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2014 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <deque>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A fixed-size pool of worker threads, which each own a task queue and steal from the queues of other workers when their own runs empty.
+	/// </summary>
+	class thread_pool
+	{
+	public:
+		enum class priority
+		{
+			high,
+			normal,
+			low,
+			count
+		};
+
+		/// <summary>
+		/// Spawns the specified number of worker threads.
+		/// </summary>
+		/// <param name="num_threads">Number of worker threads, or zero to pick one based on the number of available cores.</param>
+		explicit thread_pool(unsigned int num_threads = 0);
+		/// <summary>
+		/// Waits for all queued tasks to finish and joins the worker threads.
+		/// </summary>
+		~thread_pool();
+
+		/// <summary>
+		/// Gets the number of worker threads in this pool.
+		/// </summary>
+		size_t size() const { return _threads.size(); }
+
+		/// <summary>
+		/// Queues up a task to be executed on one of the worker threads.
+		/// Tasks with a higher priority are always picked up before tasks with a lower priority.
+		/// </summary>
+		/// <param name="prio">Priority of the task.</param>
+		/// <param name="task">Function to execute.</param>
+		void submit(priority prio, std::function<void()> &&task);
+
+		/// <summary>
+		/// Blocks until all tasks queued so far have finished executing.
+		/// This must not be called from a task running in this pool.
+		/// </summary>
+		void wait_idle();
+
+		/// <summary>
+		/// Calls the specified function for every index in the range [0, count) across the worker threads and blocks until all calls have finished.
+		/// The calling thread takes part in the work, so unlike <see cref="wait_idle"/> this may also be called from a task running in this pool.
+		/// </summary>
+		/// <param name="prio">Priority of the tasks that help with the work.</param>
+		/// <param name="count">Number of indices to process.</param>
+		/// <param name="func">Function to call with each index.</param>
+		void parallel_for(priority prio, size_t count, std::function<void(size_t)> func);
+
+		/// <summary>
+		/// Limits how many workers pick up new tasks and changes the scheduling priority and processor affinity of all worker threads.
+		/// Tasks that are already executing are not interrupted, and callers of <see cref="parallel_for"/> still take part in the work, so queued tasks keep making progress.
+		/// </summary>
+		/// <param name="max_active_threads">Number of workers that may pick up tasks, which is clamped to the range [1, size()].</param>
+		/// <param name="thread_priority">One of the 'THREAD_PRIORITY_*' values to run the workers at.</param>
+		/// <param name="affinity_mask">Mask of processors the workers may run on, or zero to allow all processors of the process.</param>
+		void set_throttle(size_t max_active_threads, int thread_priority, uintptr_t affinity_mask);
+
+	private:
+		struct worker_queue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks[static_cast<size_t>(priority::count)];
+		};
+
+		void worker_main(size_t worker_index);
+		bool pop_task(size_t worker_index, std::function<void()> &task);
+
+		std::vector<std::thread> _threads;
+		std::vector<std::unique_ptr<worker_queue>> _queues;
+		size_t _next_queue = 0;
+
+		std::mutex _state_mutex;
+		std::condition_variable _wake_condition;
+		std::condition_variable _idle_condition;
+		// Number of tasks in the queues that no worker has claimed yet
+		size_t _num_unclaimed = 0;
+		// Number of tasks that were submitted but did not finish executing yet
+		size_t _num_pending = 0;
+		// Workers with an index at or above this do not pick up new tasks (see 'set_throttle')
+		size_t _max_active_threads = SIZE_MAX;
+		bool _exit = false;
+	};
+}
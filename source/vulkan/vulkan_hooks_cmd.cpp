@@ -14,6 +14,9 @@
 #include <algorithm> // std::copy_n, std::max, std::min, std::swap
 
 extern lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
+#if RESHADE_ADDON
+extern lockfree_linear_map<VkCommandBuffer, reshade::vulkan::object_data<VK_OBJECT_TYPE_COMMAND_BUFFER> *, 16384> g_vulkan_command_buffers;
+#endif
 
 #define GET_DISPATCH_PTR_FROM(name, data) \
 	assert((data) != nullptr); \
@@ -21,6 +24,15 @@ extern lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_d
 	assert(trampoline != nullptr)
 
 #if RESHADE_ADDON
+static __forceinline reshade::vulkan::object_data<VK_OBJECT_TYPE_COMMAND_BUFFER> *get_command_buffer_data(const reshade::vulkan::device_impl *device_impl, VkCommandBuffer commandBuffer)
+{
+	// Command buffers are added to the table on allocation, so only need to fall back to the slower private data look up if it was full at that point
+	if (const auto cmd_impl = g_vulkan_command_buffers.at(commandBuffer))
+		return cmd_impl;
+
+	return device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+}
+
 static void invoke_begin_render_pass_event(const reshade::vulkan::device_impl *device_impl, reshade::vulkan::object_data<VK_OBJECT_TYPE_COMMAND_BUFFER> *cmd_impl, const VkRenderPassBeginInfo *begin_info)
 {
 	const auto render_pass_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_RENDER_PASS>(cmd_impl->current_render_pass);
@@ -232,7 +244,7 @@ VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer commandBuffer, const Vk
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	// Begin does perform an implicit reset if command pool was created with 'VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT'
 	reshade::invoke_addon_event<reshade::addon_event::reset_command_list>(cmd_impl);
@@ -280,7 +292,7 @@ VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer commandBuffer)
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (cmd_impl->current_render_pass != VK_NULL_HANDLE)
 	{
@@ -318,7 +330,7 @@ void VKAPI_CALL vkCmdBindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindP
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const auto pipeline_stages =
 		pipelineBindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? reshade::api::pipeline_stage::all_compute :
@@ -343,7 +355,7 @@ void VKAPI_CALL vkCmdSetViewport(VkCommandBuffer commandBuffer, uint32_t firstVi
 	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	temp_mem<reshade::api::viewport> viewport_data(viewportCount);
 	for (uint32_t i = 0; i < viewportCount; ++i)
@@ -369,7 +381,7 @@ void VKAPI_CALL vkCmdSetScissor(VkCommandBuffer commandBuffer, uint32_t firstSci
 	if (!reshade::has_addon_event<reshade::addon_event::bind_scissor_rects>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	temp_mem<reshade::api::rect> rect_data(scissorCount);
 	for (uint32_t i = 0; i < scissorCount; ++i)
@@ -395,7 +407,7 @@ void VKAPI_CALL vkCmdSetDepthBias(VkCommandBuffer commandBuffer, float depthBias
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const reshade::api::dynamic_state states[3] = { reshade::api::dynamic_state::depth_bias, reshade::api::dynamic_state::depth_bias_clamp, reshade::api::dynamic_state::depth_bias_slope_scaled };
 	const uint32_t values[3] = { *reinterpret_cast<const uint32_t *>(&depthBiasConstantFactor), *reinterpret_cast<const uint32_t *>(&depthBiasClamp), *reinterpret_cast<const uint32_t *>(&depthBiasSlopeFactor) };
@@ -416,7 +428,7 @@ void VKAPI_CALL vkCmdSetBlendConstants(VkCommandBuffer commandBuffer, const floa
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const reshade::api::dynamic_state states[1] = { reshade::api::dynamic_state::blend_constant };
 	const uint32_t values[1] = {
@@ -439,7 +451,7 @@ void VKAPI_CALL vkCmdSetStencilCompareMask(VkCommandBuffer commandBuffer, VkSten
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::front_stencil_read_mask, reshade::api::dynamic_state::back_stencil_read_mask };
 	const uint32_t values[2] = { compareMask, compareMask };
@@ -458,7 +470,7 @@ void VKAPI_CALL vkCmdSetStencilWriteMask(VkCommandBuffer commandBuffer, VkStenci
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::front_stencil_write_mask, reshade::api::dynamic_state::back_stencil_write_mask };
 	const uint32_t values[2] = { writeMask, writeMask };
@@ -477,7 +489,7 @@ void VKAPI_CALL vkCmdSetStencilReference(VkCommandBuffer commandBuffer, VkStenci
 	if (!reshade::has_addon_event<reshade::addon_event::bind_pipeline_states>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const reshade::api::dynamic_state states[2] = { reshade::api::dynamic_state::front_stencil_reference_value, reshade::api::dynamic_state::back_stencil_reference_value };
 	const uint32_t values[2] = { reference, reference };
@@ -497,7 +509,7 @@ void VKAPI_CALL vkCmdBindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelin
 	if (!reshade::has_addon_event<reshade::addon_event::bind_descriptor_tables>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	const auto shader_stages =
 		pipelineBindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? reshade::api::shader_stage::all_compute :
@@ -524,7 +536,7 @@ void VKAPI_CALL vkCmdBindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buf
 	if (!reshade::has_addon_event<reshade::addon_event::bind_index_buffer>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	reshade::invoke_addon_event<reshade::addon_event::bind_index_buffer>(
 		cmd_impl, reshade::api::resource { (uint64_t)buffer }, offset, indexType == VK_INDEX_TYPE_UINT8_EXT ? 1 : indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4);
@@ -541,7 +553,7 @@ void VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t f
 	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	reshade::invoke_addon_event<reshade::addon_event::bind_vertex_buffers>(
 		cmd_impl, firstBinding, bindingCount, reinterpret_cast<const reshade::api::resource *>(pBuffers), pOffsets, nullptr);
@@ -553,7 +565,7 @@ void VKAPI_CALL vkCmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, u
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw>(cmd_impl, vertexCount, instanceCount, firstVertex, firstInstance))
 		return;
@@ -567,7 +579,7 @@ void VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCo
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_indexed>(cmd_impl, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance))
 		return;
@@ -581,7 +593,7 @@ void VKAPI_CALL vkCmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::draw, reshade::api::resource { (uint64_t)buffer }, offset, drawCount, stride))
 		return;
@@ -595,7 +607,7 @@ void VKAPI_CALL vkCmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::draw_indexed, reshade::api::resource { (uint64_t)buffer }, offset, drawCount, stride))
 		return;
@@ -609,7 +621,7 @@ void VKAPI_CALL vkCmdDispatch(VkCommandBuffer commandBuffer, uint32_t groupCount
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::dispatch>(cmd_impl, groupCountX, groupCountY, groupCountZ))
 		return;
@@ -623,7 +635,7 @@ void VKAPI_CALL vkCmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer bu
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::dispatch, reshade::api::resource { (uint64_t)buffer }, offset, 1, 0))
 		return;
@@ -641,7 +653,7 @@ void VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffe
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -669,7 +681,7 @@ void VKAPI_CALL vkCmdCopyImage(VkCommandBuffer commandBuffer, VkImage srcImage,
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -715,7 +727,7 @@ void VKAPI_CALL vkCmdBlitImage(VkCommandBuffer commandBuffer, VkImage srcImage,
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -760,7 +772,7 @@ void VKAPI_CALL vkCmdCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer s
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_to_texture>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -796,7 +808,7 @@ void VKAPI_CALL vkCmdCopyImageToBuffer(VkCommandBuffer commandBuffer, VkImage sr
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_to_buffer>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -832,7 +844,7 @@ void VKAPI_CALL vkCmdClearColorImage(VkCommandBuffer commandBuffer, VkImage imag
 #if RESHADE_ADDON
 	if (reshade::has_addon_event<reshade::addon_event::clear_render_target_view>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		VkImageMemoryBarrier transition { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
 		transition.oldLayout = imageLayout;
@@ -879,7 +891,7 @@ void VKAPI_CALL vkCmdClearDepthStencilImage(VkCommandBuffer commandBuffer, VkIma
 #if RESHADE_ADDON
 	if (reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		VkImageMemoryBarrier transition { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
 		transition.oldLayout = imageLayout;
@@ -933,7 +945,7 @@ void VKAPI_CALL vkCmdClearAttachments(VkCommandBuffer commandBuffer, uint32_t at
 	if (reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>() ||
 		reshade::has_addon_event<reshade::addon_event::clear_render_target_view>())
 	{
-		const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		temp_mem<reshade::api::rect> rect_data(rectCount);
 		for (uint32_t i = 0; i < rectCount; ++i)
@@ -990,7 +1002,7 @@ void VKAPI_CALL vkCmdResolveImage(VkCommandBuffer commandBuffer, VkImage srcImag
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::resolve_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < regionCount; ++i)
 		{
@@ -1039,7 +1051,7 @@ void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineSt
 	if (num_barriers == 0 || !reshade::has_addon_event<reshade::addon_event::barrier>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	temp_mem<reshade::api::resource, 32> resources(num_barriers);
 	temp_mem<reshade::api::resource_usage, 32> old_state(num_barriers), new_state(num_barriers);
@@ -1081,7 +1093,7 @@ void VKAPI_CALL vkCmdBeginQuery(VkCommandBuffer commandBuffer, VkQueryPool query
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::begin_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		const auto pool_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::begin_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::vulkan::convert_query_type(pool_data->type), query))
@@ -1099,7 +1111,7 @@ void VKAPI_CALL vkCmdEndQuery(VkCommandBuffer commandBuffer, VkQueryPool queryPo
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::end_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		const auto pool_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::end_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::vulkan::convert_query_type(pool_data->type), query))
@@ -1117,7 +1129,7 @@ void VKAPI_CALL vkCmdWriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineSta
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::end_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		assert(device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool)->type == VK_QUERY_TYPE_TIMESTAMP);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::end_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::api::query_type::timestamp, query))
@@ -1136,7 +1148,7 @@ void VKAPI_CALL vkCmdCopyQueryPoolResults(VkCommandBuffer commandBuffer, VkQuery
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_query_heap_results>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		const auto pool_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool);
 
 		assert(stride <= std::numeric_limits<uint32_t>::max());
@@ -1169,7 +1181,7 @@ void VKAPI_CALL vkCmdPushConstants(VkCommandBuffer commandBuffer, VkPipelineLayo
 	if (!reshade::has_addon_event<reshade::addon_event::push_constants>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 	const auto layout_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_PIPELINE_LAYOUT>(layout);
 
 	reshade::invoke_addon_event<reshade::addon_event::push_constants>(
@@ -1188,7 +1200,7 @@ void VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRend
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass == VK_NULL_HANDLE);
 
@@ -1209,7 +1221,7 @@ void VKAPI_CALL vkCmdNextSubpass(VkCommandBuffer commandBuffer, VkSubpassContent
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass != VK_NULL_HANDLE);
 
@@ -1228,7 +1240,7 @@ void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer commandBuffer)
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass != VK_NULL_HANDLE);
 
@@ -1255,11 +1267,11 @@ void VKAPI_CALL vkCmdExecuteCommands(VkCommandBuffer commandBuffer, uint32_t com
 #if RESHADE_ADDON
 	if (reshade::has_addon_event<reshade::addon_event::execute_secondary_command_list>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < commandBufferCount; ++i)
 		{
-			reshade::vulkan::command_list_impl *const secondary_cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(pCommandBuffers[i]);
+			reshade::vulkan::command_list_impl *const secondary_cmd_impl = get_command_buffer_data(device_impl, pCommandBuffers[i]);
 
 			reshade::invoke_addon_event<reshade::addon_event::execute_secondary_command_list>(cmd_impl, secondary_cmd_impl);
 		}
@@ -1275,7 +1287,7 @@ void VKAPI_CALL vkCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer b
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::draw, reshade::api::resource { (uint64_t)buffer }, offset, maxDrawCount, stride))
 		return;
@@ -1289,7 +1301,7 @@ void VKAPI_CALL vkCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkB
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::draw_indexed, reshade::api::resource { (uint64_t)buffer }, offset, maxDrawCount, stride))
 		return;
@@ -1304,7 +1316,7 @@ void VKAPI_CALL vkCmdBeginRenderPass2(VkCommandBuffer commandBuffer, const VkRen
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass == VK_NULL_HANDLE);
 
@@ -1325,7 +1337,7 @@ void VKAPI_CALL vkCmdNextSubpass2(VkCommandBuffer commandBuffer, const VkSubpass
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass != VK_NULL_HANDLE);
 
@@ -1344,7 +1356,7 @@ void VKAPI_CALL vkCmdEndRenderPass2(VkCommandBuffer commandBuffer, const VkSubpa
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	assert(cmd_impl->current_render_pass != VK_NULL_HANDLE);
 
@@ -1379,7 +1391,7 @@ void VKAPI_CALL vkCmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDep
 	if (num_barriers == 0 || !reshade::has_addon_event<reshade::addon_event::barrier>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	temp_mem<reshade::api::resource, 32> resources(num_barriers);
 	temp_mem<reshade::api::resource_usage, 32> old_state(num_barriers), new_state(num_barriers);
@@ -1421,7 +1433,7 @@ void VKAPI_CALL vkCmdWriteTimestamp2(VkCommandBuffer commandBuffer, VkPipelineSt
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::end_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		assert(device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool)->type == VK_QUERY_TYPE_TIMESTAMP);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::end_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::api::query_type::timestamp, query))
@@ -1441,7 +1453,7 @@ void VKAPI_CALL vkCmdCopyBuffer2(VkCommandBuffer commandBuffer, const VkCopyBuff
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pCopyBufferInfo->regionCount; ++i)
 		{
@@ -1473,7 +1485,7 @@ void VKAPI_CALL vkCmdCopyImage2(VkCommandBuffer commandBuffer, const VkCopyImage
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pCopyImageInfo->regionCount; ++i)
 		{
@@ -1523,7 +1535,7 @@ void VKAPI_CALL vkCmdCopyBufferToImage2(VkCommandBuffer commandBuffer, const VkC
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_buffer_to_texture>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pCopyBufferToImageInfo->regionCount; ++i)
 		{
@@ -1563,7 +1575,7 @@ void VKAPI_CALL vkCmdCopyImageToBuffer2(VkCommandBuffer commandBuffer, const VkC
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_to_buffer>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pCopyImageToBufferInfo->regionCount; ++i)
 		{
@@ -1603,7 +1615,7 @@ void VKAPI_CALL vkCmdBlitImage2(VkCommandBuffer commandBuffer, const VkBlitImage
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pBlitImageInfo->regionCount; ++i)
 		{
@@ -1652,7 +1664,7 @@ void VKAPI_CALL vkCmdResolveImage2(VkCommandBuffer commandBuffer, const VkResolv
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::resolve_texture_region>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < pResolveImageInfo->regionCount; ++i)
 		{
@@ -1697,7 +1709,7 @@ void VKAPI_CALL vkCmdBeginRendering(VkCommandBuffer commandBuffer, const VkRende
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	invoke_begin_render_pass_event(cmd_impl, pRenderingInfo);
 
@@ -1712,7 +1724,7 @@ void VKAPI_CALL vkCmdEndRendering(VkCommandBuffer commandBuffer)
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	const auto cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	const auto cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	reshade::invoke_addon_event<reshade::addon_event::end_render_pass>(cmd_impl);
 
@@ -1737,7 +1749,7 @@ void VKAPI_CALL vkCmdBindVertexBuffers2(VkCommandBuffer commandBuffer, uint32_t
 	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	temp_mem<uint32_t> strides_32(bindingCount);
 	for (uint32_t i = 0; i < bindingCount; ++i)
@@ -1762,7 +1774,7 @@ void VKAPI_CALL vkCmdPushDescriptorSetKHR(VkCommandBuffer commandBuffer, VkPipel
 	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	uint32_t max_descriptors = 0;
 	for (uint32_t i = 0; i < descriptorWriteCount; ++i)
@@ -1847,7 +1859,7 @@ void VKAPI_CALL vkCmdBindTransformFeedbackBuffersEXT(VkCommandBuffer commandBuff
 	if (!reshade::has_addon_event<reshade::addon_event::bind_stream_output_buffers>())
 		return;
 
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	reshade::invoke_addon_event<reshade::addon_event::bind_stream_output_buffers>(
 		cmd_impl, firstBinding, bindingCount, reinterpret_cast<const reshade::api::resource *>(pBuffers), pOffsets, pSizes, nullptr, nullptr);
@@ -1861,7 +1873,7 @@ void VKAPI_CALL vkCmdBeginQueryIndexedEXT(VkCommandBuffer commandBuffer, VkQuery
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::begin_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		const auto pool_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::begin_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::vulkan::convert_query_type(pool_data->type, index), query))
@@ -1879,7 +1891,7 @@ void VKAPI_CALL vkCmdEndQueryIndexedEXT(VkCommandBuffer commandBuffer, VkQueryPo
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::end_query>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 		const auto pool_data = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_QUERY_POOL>(queryPool);
 
 		if (reshade::invoke_addon_event<reshade::addon_event::end_query>(cmd_impl, reshade::api::query_heap { (uint64_t)queryPool }, reshade::vulkan::convert_query_type(pool_data->type, index), query))
@@ -1901,7 +1913,7 @@ void VKAPI_CALL vkCmdBuildAccelerationStructuresKHR(VkCommandBuffer commandBuffe
 #if RESHADE_ADDON >= 2
 	if (reshade::has_addon_event<reshade::addon_event::build_acceleration_structure>())
 	{
-		reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+		reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 		for (uint32_t i = 0; i < infoCount; ++i)
 		{
@@ -1949,7 +1961,7 @@ void VKAPI_CALL vkCmdCopyAccelerationStructureKHR(VkCommandBuffer commandBuffer,
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON >= 2
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::copy_acceleration_structure>(
 			cmd_impl,
@@ -1967,7 +1979,7 @@ void VKAPI_CALL vkCmdWriteAccelerationStructuresPropertiesKHR(VkCommandBuffer co
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON >= 2
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::query_acceleration_structures>(
 			cmd_impl,
@@ -1990,7 +2002,7 @@ void VKAPI_CALL vkCmdTraceRaysKHR(VkCommandBuffer commandBuffer, const VkStrided
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::dispatch_rays>(
 			cmd_impl,
@@ -2028,7 +2040,7 @@ void VKAPI_CALL vkCmdTraceRaysIndirect2KHR(VkCommandBuffer commandBuffer, VkDevi
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::dispatch_rays, reshade::api::resource {}, indirectDeviceAddress, 1, 0))
 		return;
@@ -2043,7 +2055,7 @@ void VKAPI_CALL vkCmdDrawMeshTasksEXT(VkCommandBuffer commandBuffer, uint32_t gr
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::dispatch_mesh>(cmd_impl, groupCountX, groupCountY, groupCountZ))
 		return;
@@ -2057,7 +2069,7 @@ void VKAPI_CALL vkCmdDrawMeshTasksIndirectEXT(VkCommandBuffer commandBuffer, VkB
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::dispatch_mesh, reshade::api::resource { (uint64_t)buffer }, offset, drawCount, stride))
 		return;
@@ -2071,7 +2083,7 @@ void VKAPI_CALL vkCmdDrawMeshTasksIndirectCountEXT(VkCommandBuffer commandBuffer
 	reshade::vulkan::device_impl *const device_impl = g_vulkan_devices.at(dispatch_key_from_handle(commandBuffer));
 
 #if RESHADE_ADDON
-	reshade::vulkan::command_list_impl *const cmd_impl = device_impl->get_private_data_for_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(commandBuffer);
+	reshade::vulkan::command_list_impl *const cmd_impl = get_command_buffer_data(device_impl, commandBuffer);
 
 	if (reshade::invoke_addon_event<reshade::addon_event::draw_or_dispatch_indirect>(cmd_impl, reshade::api::indirect_command::dispatch_mesh, reshade::api::resource { (uint64_t)buffer }, offset, maxDrawCount, stride))
 		return;
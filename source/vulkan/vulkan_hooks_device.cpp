@@ -20,6 +20,9 @@
 extern thread_local bool g_in_dxgi_runtime;
 
 lockfree_linear_map<void *, reshade::vulkan::device_impl *, 8> g_vulkan_devices;
+#if RESHADE_ADDON
+lockfree_linear_map<VkCommandBuffer, reshade::vulkan::object_data<VK_OBJECT_TYPE_COMMAND_BUFFER> *, 16384> g_vulkan_command_buffers;
+#endif
 extern lockfree_linear_map<void *, instance_dispatch_table, 16> g_vulkan_instances;
 extern lockfree_linear_map<VkSurfaceKHR, HWND, 16> g_vulkan_surface_windows;
 
@@ -464,6 +467,9 @@ VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDevi
 	INIT_DISPATCH_PTR(CreateGraphicsPipelines);
 	INIT_DISPATCH_PTR(CreateComputePipelines);
 	INIT_DISPATCH_PTR(DestroyPipeline);
+	INIT_DISPATCH_PTR(CreatePipelineCache);
+	INIT_DISPATCH_PTR(DestroyPipelineCache);
+	INIT_DISPATCH_PTR(GetPipelineCacheData);
 	INIT_DISPATCH_PTR(CreatePipelineLayout);
 	INIT_DISPATCH_PTR(DestroyPipelineLayout);
 	INIT_DISPATCH_PTR(CreateSampler);
@@ -2488,6 +2494,9 @@ VkResult VKAPI_CALL vkCreatePipelineLayout(VkDevice device, const VkPipelineLayo
 #if RESHADE_ADDON >= 2
 	reshade::vulkan::object_data<VK_OBJECT_TYPE_PIPELINE_LAYOUT> &data = *device_impl->register_object<VK_OBJECT_TYPE_PIPELINE_LAYOUT>(*pPipelineLayout);
 	data.set_layouts.assign(pCreateInfo->pSetLayouts, pCreateInfo->pSetLayouts + pCreateInfo->setLayoutCount);
+	for (uint32_t i = 0; i < set_desc_count && i < 32; ++i)
+		if (params[i].type == reshade::api::pipeline_layout_param_type::push_descriptors || params[i].type == reshade::api::pipeline_layout_param_type::push_descriptors_with_ranges || params[i].type == reshade::api::pipeline_layout_param_type::push_descriptors_with_static_samplers)
+			data.push_descriptor_sets |= 1u << i;
 
 	reshade::invoke_addon_event<reshade::addon_event::init_pipeline_layout>(device_impl, param_count, param_data, reshade::api::pipeline_layout { (uint64_t)*pPipelineLayout });
 #endif
@@ -3065,6 +3074,10 @@ VkResult VKAPI_CALL vkAllocateCommandBuffers(VkDevice device, const VkCommandBuf
 
 		device_impl->register_object<VK_OBJECT_TYPE_COMMAND_BUFFER>(pCommandBuffers[i], cmd_impl);
 
+		// Also add to the command buffer table for fast look up in the command hooks (the handle may have been reused after its pool was destroyed without freeing it, so remove any stale entry first)
+		g_vulkan_command_buffers.erase(pCommandBuffers[i]);
+		g_vulkan_command_buffers.emplace(pCommandBuffers[i], cmd_impl);
+
 		reshade::invoke_addon_event<reshade::addon_event::init_command_list>(cmd_impl);
 	}
 #endif
@@ -3089,6 +3102,7 @@ void     VKAPI_CALL vkFreeCommandBuffers(VkDevice device, VkCommandPool commandP
 		reshade::invoke_addon_event<reshade::addon_event::destroy_command_list>(cmd_impl);
 
 		device_impl->unregister_object<VK_OBJECT_TYPE_COMMAND_BUFFER, false>(pCommandBuffers[i]);
+		g_vulkan_command_buffers.erase(pCommandBuffers[i]);
 
 		delete cmd_impl;
 	}
@@ -539,7 +539,10 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 		break;
 	}
 
-	if (_device_impl->_push_descriptor_ext)
+	const VkPipelineLayout pipeline_layout = (VkPipelineLayout)layout.handle;
+	const auto pipeline_layout_impl = _device_impl->get_private_data_for_object<VK_OBJECT_TYPE_PIPELINE_LAYOUT>(pipeline_layout);
+
+	if (layout_param < 32 && (pipeline_layout_impl->push_descriptor_sets & (1u << layout_param)) != 0)
 	{
 		if ((stages & api::shader_stage::all_compute) != 0)
 		{
@@ -567,8 +570,7 @@ void reshade::vulkan::command_list_impl::push_descriptors(api::shader_stage stag
 
 	assert(update.binding == 0 && update.array_offset == 0);
 
-	const VkPipelineLayout pipeline_layout = (VkPipelineLayout)layout.handle;
-	const VkDescriptorSetLayout set_layout = (VkDescriptorSetLayout)_device_impl->get_private_data_for_object<VK_OBJECT_TYPE_PIPELINE_LAYOUT>(pipeline_layout)->set_layouts[layout_param];
+	const VkDescriptorSetLayout set_layout = pipeline_layout_impl->set_layouts[layout_param];
 
 	VkDescriptorSetAllocateInfo alloc_info { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
 	alloc_info.descriptorPool = _device_impl->_transient_descriptor_pool[_device_impl->_transient_index % 4];
@@ -6,6 +6,8 @@
 #include "vulkan_impl_device.hpp"
 #include "vulkan_impl_command_list_immediate.hpp"
 #include "dll_log.hpp"
+#include "ini_file.hpp"
+#include <algorithm> // std::max, std::min
 
 #define vk _device_impl->_dispatch_table
 
@@ -15,6 +17,10 @@ reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device
 	command_list_impl(device, VK_NULL_HANDLE),
 	_parent_queue(queue)
 {
+	// Number of command buffers that can be in flight before recording has to wait for the oldest one to finish executing
+	global_config().get("APP", "VulkanImmediateCommandFrames", _num_command_frames);
+	_num_command_frames = std::min(std::max(_num_command_frames, 2u), MAX_COMMAND_FRAMES);
+
 	{	VkCommandPoolCreateInfo create_info { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 		create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		create_info.queueFamilyIndex = queue_family_index;
@@ -26,13 +32,25 @@ reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device
 	{   VkCommandBufferAllocateInfo alloc_info { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
 		alloc_info.commandPool = _cmd_pool;
 		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandBufferCount = NUM_COMMAND_FRAMES;
+		alloc_info.commandBufferCount = _num_command_frames;
 
 		if (vk.AllocateCommandBuffers(_device_impl->_orig, &alloc_info, _cmd_buffers) != VK_SUCCESS)
 			return;
 	}
 
-	for (uint32_t i = 0; i < NUM_COMMAND_FRAMES; ++i)
+	if (_device_impl->_timeline_semaphore_ext)
+	{
+		VkSemaphoreTypeCreateInfo type_create_info { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+		type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_create_info.initialValue = _timeline_value;
+
+		VkSemaphoreCreateInfo create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &type_create_info };
+
+		if (vk.CreateSemaphore(_device_impl->_orig, &create_info, nullptr, &_timeline_semaphore) != VK_SUCCESS)
+			_timeline_semaphore = VK_NULL_HANDLE; // Fall back to fences
+	}
+
+	for (uint32_t i = 0; i < _num_command_frames; ++i)
 	{
 		// The validation layers expect the loader to have set the dispatch pointer, but this does not happen when calling down the layer chain from here, so fix it
 		*reinterpret_cast<void **>(_cmd_buffers[i]) = *reinterpret_cast<void **>(device->_orig);
@@ -50,11 +68,14 @@ reshade::vulkan::command_list_immediate_impl::command_list_immediate_impl(device
 			vk.SetDebugUtilsObjectNameEXT(_device_impl->_orig, &name_info);
 		}
 
-		VkFenceCreateInfo create_info { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-		create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Create signaled so waiting on it when no commands where submitted succeeds
+		if (_timeline_semaphore == VK_NULL_HANDLE)
+		{
+			VkFenceCreateInfo create_info { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+			create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Create signaled so waiting on it when no commands where submitted succeeds
 
-		if (vk.CreateFence(_device_impl->_orig, &create_info, nullptr, &_cmd_fences[i]) != VK_SUCCESS)
-			return;
+			if (vk.CreateFence(_device_impl->_orig, &create_info, nullptr, &_cmd_fences[i]) != VK_SUCCESS)
+				return;
+		}
 
 		VkSemaphoreCreateInfo sem_create_info { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 
@@ -79,12 +100,21 @@ reshade::vulkan::command_list_immediate_impl::~command_list_immediate_impl()
 	if (this == s_last_immediate_command_list)
 		s_last_immediate_command_list = nullptr;
 
+	// Upload buffers may still be referenced by commands that are executing
+	for (uint32_t i = 0; i < _num_command_frames; ++i)
+	{
+		if (!_upload_buffers[i].empty())
+			wait_for_command_frame(i);
+		destroy_upload_buffers(i);
+	}
+
 	for (VkFence fence : _cmd_fences)
 		vk.DestroyFence(_device_impl->_orig, fence, nullptr);
 	for (VkSemaphore semaphore : _cmd_semaphores)
 		vk.DestroySemaphore(_device_impl->_orig, semaphore, nullptr);
+	vk.DestroySemaphore(_device_impl->_orig, _timeline_semaphore, nullptr);
 
-	vk.FreeCommandBuffers(_device_impl->_orig, _cmd_pool, NUM_COMMAND_FRAMES, _cmd_buffers);
+	vk.FreeCommandBuffers(_device_impl->_orig, _cmd_pool, _num_command_frames, _cmd_buffers);
 	vk.DestroyCommandPool(_device_impl->_orig, _cmd_pool, nullptr);
 
 	// Signal to 'command_list_impl' destructor that this is an immediate command list
@@ -124,10 +154,51 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkSubmitInfo &submit_in
 		submit_info.pSignalSemaphores = &_cmd_semaphores[_cmd_index];
 	}
 
-	// Only reset fence before an actual submit which can signal it again
-	vk.ResetFences(_device_impl->_orig, 1, &_cmd_fences[_cmd_index]);
+	VkSubmitInfo actual_submit_info = submit_info;
+	const VkFence submit_fence = _cmd_fences[_cmd_index];
+
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	temp_mem<VkSemaphore, 4> signal_semaphores(submit_info.signalSemaphoreCount + 1);
+	temp_mem<uint64_t, 4> signal_values(submit_info.signalSemaphoreCount + 1);
+	temp_mem<uint64_t, 4> wait_values(submit_info.waitSemaphoreCount);
+
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+	{
+		// Append the timeline semaphore to the signal semaphores of this submit, merging with the values of timeline semaphores the caller may have passed in already
+		const auto existing_timeline_submit_info = static_cast<const VkTimelineSemaphoreSubmitInfo *>(submit_info.pNext);
+		const bool has_existing_timeline_submit_info = existing_timeline_submit_info != nullptr && existing_timeline_submit_info->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		assert(submit_info.pNext == nullptr || has_existing_timeline_submit_info);
+
+		for (uint32_t i = 0; i < submit_info.signalSemaphoreCount; ++i)
+		{
+			signal_semaphores[i] = submit_info.pSignalSemaphores[i];
+			signal_values[i] = has_existing_timeline_submit_info && i < existing_timeline_submit_info->signalSemaphoreValueCount ? existing_timeline_submit_info->pSignalSemaphoreValues[i] : 0;
+		}
+		for (uint32_t i = 0; i < submit_info.waitSemaphoreCount; ++i)
+		{
+			wait_values[i] = has_existing_timeline_submit_info && i < existing_timeline_submit_info->waitSemaphoreValueCount ? existing_timeline_submit_info->pWaitSemaphoreValues[i] : 0;
+		}
+
+		signal_semaphores[submit_info.signalSemaphoreCount] = _timeline_semaphore;
+		signal_values[submit_info.signalSemaphoreCount] = _timeline_value + 1;
+
+		timeline_submit_info.pNext = has_existing_timeline_submit_info ? existing_timeline_submit_info->pNext : nullptr;
+		timeline_submit_info.waitSemaphoreValueCount = submit_info.waitSemaphoreCount;
+		timeline_submit_info.pWaitSemaphoreValues = wait_values.p;
+		timeline_submit_info.signalSemaphoreValueCount = submit_info.signalSemaphoreCount + 1;
+		timeline_submit_info.pSignalSemaphoreValues = signal_values.p;
+
+		actual_submit_info.pNext = &timeline_submit_info;
+		actual_submit_info.signalSemaphoreCount = submit_info.signalSemaphoreCount + 1;
+		actual_submit_info.pSignalSemaphores = signal_semaphores.p;
+	}
+	else
+	{
+		// Only reset fence before an actual submit which can signal it again
+		vk.ResetFences(_device_impl->_orig, 1, &submit_fence);
+	}
 
-	if (vk.QueueSubmit(_parent_queue, 1, &submit_info, _cmd_fences[_cmd_index]) != VK_SUCCESS)
+	if (vk.QueueSubmit(_parent_queue, 1, &actual_submit_info, submit_fence) != VK_SUCCESS)
 	{
 		log::message(log::level::error, "Failed to submit immediate command list!");
 
@@ -136,6 +207,9 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkSubmitInfo &submit_in
 		return false;
 	}
 
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+		_cmd_timeline_values[_cmd_index] = ++_timeline_value;
+
 	// This queue submit now waits on the requested wait semaphores
 	// The next queue submit should therefore wait on the semaphore that was signaled by this submit
 	submit_info.waitSemaphoreCount = submit_info.signalSemaphoreCount;
@@ -147,13 +221,13 @@ bool reshade::vulkan::command_list_immediate_impl::flush(VkSubmitInfo &submit_in
 	submit_info.pSignalSemaphores = nullptr;
 
 	// Continue with next command buffer now that the current one was submitted
-	_cmd_index = (_cmd_index + 1) % NUM_COMMAND_FRAMES;
+	_cmd_index = (_cmd_index + 1) % _num_command_frames;
 
 	// Make sure the next command buffer has finished executing before reusing it this frame
-	if (vk.GetFenceStatus(_device_impl->_orig, _cmd_fences[_cmd_index]) == VK_NOT_READY)
-	{
-		vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[_cmd_index], VK_TRUE, UINT64_MAX);
-	}
+	wait_for_command_frame(_cmd_index);
+
+	// Upload buffers used by the previous commands of this command buffer are no longer referenced now
+	destroy_upload_buffers(_cmd_index);
 
 	// Command buffer is now ready for a reset
 	if (vk.BeginCommandBuffer(_cmd_buffers[_cmd_index], &begin_info) != VK_SUCCESS)
@@ -175,6 +249,55 @@ bool reshade::vulkan::command_list_immediate_impl::flush_and_wait()
 	if (!flush(submit_info))
 		return false;
 
-	// Wait for the submitted work to finish and reset fence again for next use
-	return vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[cmd_index_to_wait_on], VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+	// Wait for the submitted work to finish
+	if (!wait_for_command_frame(cmd_index_to_wait_on))
+		return false;
+
+	destroy_upload_buffers(cmd_index_to_wait_on);
+	return true;
+}
+
+void reshade::vulkan::command_list_immediate_impl::destroy_after_execution(VkBuffer buffer, VmaAllocation allocation, VkDeviceSize size)
+{
+	_upload_buffers[_cmd_index].emplace_back(buffer, allocation);
+	_upload_buffer_size[_cmd_index] += size;
+
+	// Submit early when a lot of upload memory accumulated (e.g. while loading many textures during an effect reload), so that it can be reclaimed without waiting for the next present
+	if (_upload_buffer_size[_cmd_index] > 64 * 1024 * 1024)
+	{
+		VkSubmitInfo submit_info { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		flush(submit_info);
+	}
+}
+
+bool reshade::vulkan::command_list_immediate_impl::wait_for_command_frame(uint32_t index)
+{
+	if (_timeline_semaphore != VK_NULL_HANDLE)
+	{
+		uint64_t completed_value = 0;
+		if (vk.GetSemaphoreCounterValue(_device_impl->_orig, _timeline_semaphore, &completed_value) == VK_SUCCESS && completed_value >= _cmd_timeline_values[index])
+			return true;
+
+		VkSemaphoreWaitInfo wait_info { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &_timeline_semaphore;
+		wait_info.pValues = &_cmd_timeline_values[index];
+
+		return vk.WaitSemaphores(_device_impl->_orig, &wait_info, UINT64_MAX) == VK_SUCCESS;
+	}
+	else
+	{
+		if (vk.GetFenceStatus(_device_impl->_orig, _cmd_fences[index]) != VK_NOT_READY)
+			return true;
+
+		return vk.WaitForFences(_device_impl->_orig, 1, &_cmd_fences[index], VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+	}
+}
+
+void reshade::vulkan::command_list_immediate_impl::destroy_upload_buffers(uint32_t index)
+{
+	for (const std::pair<VkBuffer, VmaAllocation> &upload_buffer : _upload_buffers[index])
+		vmaDestroyBuffer(_device_impl->_alloc, upload_buffer.first, upload_buffer.second);
+	_upload_buffers[index].clear();
+	_upload_buffer_size[index] = 0;
 }
@@ -6,12 +6,13 @@
 #pragma once
 
 #include "vulkan_impl_command_list.hpp"
+#include <vector>
 
 namespace reshade::vulkan
 {
 	class command_list_immediate_impl : public command_list_impl
 	{
-		static constexpr uint32_t NUM_COMMAND_FRAMES = 4; // Use power of two so that modulo can be replaced with bitwise operation
+		static constexpr uint32_t MAX_COMMAND_FRAMES = 16;
 
 	public:
 		static thread_local command_list_immediate_impl *s_last_immediate_command_list;
@@ -22,12 +23,30 @@ namespace reshade::vulkan
 		bool flush(VkSubmitInfo &semaphore_info);
 		bool flush_and_wait();
 
+		/// <summary>
+		/// Keeps the specified upload buffer alive until the commands currently being recorded finished executing and destroys it afterwards, so that uploads do not need to wait for the GPU.
+		/// </summary>
+		void destroy_after_execution(VkBuffer buffer, VmaAllocation allocation, VkDeviceSize size);
+
 	private:
+		bool wait_for_command_frame(uint32_t index);
+		void destroy_upload_buffers(uint32_t index);
+
 		const VkQueue _parent_queue;
 		uint32_t _cmd_index = 0;
+		uint32_t _num_command_frames = 4;
 		VkCommandPool _cmd_pool = VK_NULL_HANDLE;
-		VkFence _cmd_fences[NUM_COMMAND_FRAMES] = {};
-		VkSemaphore _cmd_semaphores[NUM_COMMAND_FRAMES] = {};
-		VkCommandBuffer _cmd_buffers[NUM_COMMAND_FRAMES] = {};
+		VkFence _cmd_fences[MAX_COMMAND_FRAMES] = {};
+		VkSemaphore _cmd_semaphores[MAX_COMMAND_FRAMES] = {};
+		VkCommandBuffer _cmd_buffers[MAX_COMMAND_FRAMES] = {};
+
+		// Timeline semaphore that is signaled with increasing values by every submit, used instead of the fences when supported
+		VkSemaphore _timeline_semaphore = VK_NULL_HANDLE;
+		uint64_t _timeline_value = 0;
+		uint64_t _cmd_timeline_values[MAX_COMMAND_FRAMES] = {};
+
+		// Upload buffers referenced by the commands of each command buffer, which are destroyed once it finished executing
+		std::vector<std::pair<VkBuffer, VmaAllocation>> _upload_buffers[MAX_COMMAND_FRAMES];
+		VkDeviceSize _upload_buffer_size[MAX_COMMAND_FRAMES] = {};
 	};
 }
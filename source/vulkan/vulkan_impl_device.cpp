@@ -7,11 +7,16 @@
 #include "vulkan_impl_command_queue.hpp"
 #include "vulkan_impl_type_convert.hpp"
 #include "dll_log.hpp"
-#include <cstring> // std::memcpy
+#include "ini_file.hpp"
+#include <cstdio> // std::fclose, std::fread, std::fwrite, std::snprintf
+#include <cstring> // std::memcmp, std::memcpy
 #include <algorithm> // std::copy_n, std::max
 
 #define vk _dispatch_table
 
+extern std::filesystem::path g_reshade_base_path;
+extern bool resolve_path(std::filesystem::path &path, std::error_code &ec);
+
 reshade::vulkan::device_impl::device_impl(
 	VkDevice device,
 	VkPhysicalDevice physical_device,
@@ -105,7 +110,16 @@ reshade::vulkan::device_impl::device_impl(
 		}
 	}
 
-	if (!_push_descriptor_ext)
+	if (_push_descriptor_ext)
+	{
+		VkPhysicalDevicePushDescriptorPropertiesKHR push_descriptor_props { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR };
+		VkPhysicalDeviceProperties2 device_props { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &push_descriptor_props };
+		_instance_dispatch_table.GetPhysicalDeviceProperties2(_physical_device, &device_props);
+
+		_max_push_descriptors = push_descriptor_props.maxPushDescriptors;
+	}
+
+	// Transient descriptor pools are still needed with push descriptor support, for layouts that exceed the push descriptor limit (see 'create_pipeline_layout')
 	{
 		for (uint32_t i = 0; i < 4; ++i)
 		{
@@ -128,6 +142,8 @@ reshade::vulkan::device_impl::device_impl(
 			log::message(log::level::error, "Failed to create private data slot!");
 		}
 	}
+
+	load_pipeline_cache();
 }
 reshade::vulkan::device_impl::~device_impl()
 {
@@ -141,6 +157,9 @@ reshade::vulkan::device_impl::~device_impl()
 
 	vk.DestroyPrivateDataSlot(_orig, _private_data_slot, nullptr);
 
+	save_pipeline_cache();
+	vk.DestroyPipelineCache(_orig, _pipeline_cache, nullptr);
+
 	vk.DestroyDescriptorPool(_orig, _descriptor_pool, nullptr);
 	for (uint32_t i = 0; i < 4; ++i)
 		vk.DestroyDescriptorPool(_orig, _transient_descriptor_pool[i], nullptr);
@@ -148,6 +167,109 @@ reshade::vulkan::device_impl::~device_impl()
 	vmaDestroyAllocator(_alloc);
 }
 
+void reshade::vulkan::device_impl::load_pipeline_cache()
+{
+	VkPhysicalDeviceProperties device_props = {};
+	_instance_dispatch_table.GetPhysicalDeviceProperties(_physical_device, &device_props);
+
+	// Share the directory with the effect cache (see 'runtime::load_config'), but key the file by device and driver, since the data is only valid for the exact driver it was created with
+	bool no_effect_cache = false;
+	global_config().get("GENERAL", "NoEffectCache", no_effect_cache);
+
+	std::vector<uint8_t> cache_data;
+
+	if (!no_effect_cache)
+	{
+		std::error_code ec;
+		std::filesystem::path cache_path;
+		global_config().get("GENERAL", "IntermediateCachePath", cache_path);
+		if (cache_path.empty() || !resolve_path(cache_path, ec))
+			cache_path = std::filesystem::temp_directory_path(ec) / L"ReShade";
+
+		char file_name[64];
+		std::snprintf(file_name, std::size(file_name), "reshade-vk-pipelines-%04x-%04x-%08x.bin", device_props.vendorID, device_props.deviceID, device_props.driverVersion);
+		_pipeline_cache_path = g_reshade_base_path / cache_path / file_name;
+
+		if (FILE *const file = _wfsopen(_pipeline_cache_path.c_str(), L"rb", SH_DENYWR))
+		{
+			const uintmax_t file_size = std::filesystem::file_size(_pipeline_cache_path, ec);
+			if (!ec)
+			{
+				cache_data.resize(static_cast<size_t>(file_size));
+				cache_data.resize(std::fread(cache_data.data(), 1, cache_data.size(), file));
+			}
+			std::fclose(file);
+		}
+
+		// Validate the header, so that data from a different device or driver is never passed on to the driver (see 'VkPipelineCacheHeaderVersionOne')
+		if (!cache_data.empty())
+		{
+			VkPipelineCacheHeaderVersionOne header = {};
+			if (cache_data.size() >= sizeof(header))
+				std::memcpy(&header, cache_data.data(), sizeof(header));
+
+			if (cache_data.size() < sizeof(header) ||
+				header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+				header.vendorID != device_props.vendorID ||
+				header.deviceID != device_props.deviceID ||
+				std::memcmp(header.pipelineCacheUUID, device_props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+			{
+				log::message(log::level::info, "Discarding outdated pipeline cache \"%s\".", _pipeline_cache_path.u8string().c_str());
+				cache_data.clear();
+			}
+		}
+	}
+
+	// Pipeline caches are internally synchronized, so pipelines created from multiple worker threads at once all add to this single cache
+	VkPipelineCacheCreateInfo create_info { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	create_info.initialDataSize = cache_data.size();
+	create_info.pInitialData = cache_data.data();
+
+	if (vk.CreatePipelineCache(_orig, &create_info, nullptr, &_pipeline_cache) != VK_SUCCESS && !cache_data.empty())
+	{
+		// Retry with an empty cache in case the driver rejected the data
+		create_info.initialDataSize = 0;
+		create_info.pInitialData = nullptr;
+
+		if (vk.CreatePipelineCache(_orig, &create_info, nullptr, &_pipeline_cache) != VK_SUCCESS)
+			_pipeline_cache = VK_NULL_HANDLE;
+	}
+
+	if (_pipeline_cache == VK_NULL_HANDLE)
+		log::message(log::level::warning, "Failed to create pipeline cache!");
+	else if (!cache_data.empty())
+		log::message(log::level::info, "Loaded pipeline cache \"%s\" (%zu bytes).", _pipeline_cache_path.u8string().c_str(), cache_data.size());
+}
+void reshade::vulkan::device_impl::save_pipeline_cache()
+{
+	if (_pipeline_cache == VK_NULL_HANDLE || _pipeline_cache_path.empty())
+		return;
+
+	size_t cache_size = 0;
+	if (vk.GetPipelineCacheData(_orig, _pipeline_cache, &cache_size, nullptr) != VK_SUCCESS || cache_size == 0)
+		return;
+	std::vector<uint8_t> cache_data(cache_size);
+	if (vk.GetPipelineCacheData(_orig, _pipeline_cache, &cache_size, cache_data.data()) != VK_SUCCESS)
+		return;
+
+	// Write to a temporary file first and then replace the target with it, so that a crash during shutdown cannot leave a partially written cache behind
+	std::filesystem::path temp_path = _pipeline_cache_path;
+	temp_path += L".tmp";
+
+	FILE *const file = _wfsopen(temp_path.c_str(), L"wb", SH_DENYWR);
+	if (file == nullptr)
+		return;
+	const size_t cache_size_written = std::fwrite(cache_data.data(), 1, cache_size, file);
+	std::fclose(file);
+
+	if (cache_size_written != cache_size ||
+		!MoveFileExW(temp_path.c_str(), _pipeline_cache_path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		log::message(log::level::warning, "Failed to save pipeline cache \"%s\"!", _pipeline_cache_path.u8string().c_str());
+		DeleteFileW(temp_path.c_str());
+	}
+}
+
 bool reshade::vulkan::device_impl::get_property(api::device_properties property, void *data) const
 {
 	VkPhysicalDeviceRayTracingPipelinePropertiesKHR ray_tracing_props { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
@@ -983,9 +1105,8 @@ void reshade::vulkan::device_impl::update_buffer_region(const void *data, api::r
 	{
 		immediate_command_list->_has_commands = true;
 
+		// Data is copied into the command buffer during recording, so there is no need to wait for it to execute here and it is instead submitted with the next flush
 		vk.CmdUpdateBuffer(immediate_command_list->_orig, (VkBuffer)resource.handle, offset, size, data);
-
-		immediate_command_list->flush_and_wait();
 	}
 }
 void reshade::vulkan::device_impl::update_texture_region(const api::subresource_data &data, api::resource resource, uint32_t subresource, const api::subresource_box *box)
@@ -1056,8 +1177,9 @@ void reshade::vulkan::device_impl::update_texture_region(const api::subresource_
 		// Copy data from upload buffer into target texture using the first available immediate command list
 		immediate_command_list->copy_buffer_to_texture({ (uint64_t)intermediate }, 0, 0, 0, resource, subresource, box);
 
-		// Wait for command to finish executing before destroying the upload buffer
-		immediate_command_list->flush_and_wait();
+		// Submit the copy with the next flush and destroy the upload buffer only after it finished executing, instead of waiting for it here
+		immediate_command_list->destroy_after_execution(intermediate, intermediate_mem, total_image_size);
+		return;
 	}
 
 	vmaDestroyBuffer(_alloc, intermediate, intermediate_mem);
@@ -1441,7 +1563,7 @@ bool reshade::vulkan::device_impl::create_pipeline(api::pipeline_layout layout,
 		}
 
 		if (VkPipeline object = VK_NULL_HANDLE;
-			vk.CreateRayTracingPipelinesKHR(_orig, VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &create_info, nullptr, &object) == VK_SUCCESS)
+			vk.CreateRayTracingPipelinesKHR(_orig, VK_NULL_HANDLE, _pipeline_cache, 1, &create_info, nullptr, &object) == VK_SUCCESS)
 		{
 			for (const VkShaderModule shader : shaders)
 				vk.DestroyShaderModule(_orig, shader, nullptr);
@@ -1467,7 +1589,7 @@ bool reshade::vulkan::device_impl::create_pipeline(api::pipeline_layout layout,
 		}
 
 		if (VkPipeline object = VK_NULL_HANDLE;
-			vk.CreateComputePipelines(_orig, VK_NULL_HANDLE, 1, &create_info, nullptr, &object) == VK_SUCCESS)
+			vk.CreateComputePipelines(_orig, _pipeline_cache, 1, &create_info, nullptr, &object) == VK_SUCCESS)
 		{
 			vk.DestroyShaderModule(_orig, create_info.stage.module, nullptr);
 
@@ -1726,7 +1848,7 @@ bool reshade::vulkan::device_impl::create_pipeline(api::pipeline_layout layout,
 		}
 
 		if (VkPipeline object = VK_NULL_HANDLE;
-			vk.CreateGraphicsPipelines(_orig, VK_NULL_HANDLE, 1, &create_info, nullptr, &object) == VK_SUCCESS)
+			vk.CreateGraphicsPipelines(_orig, _pipeline_cache, 1, &create_info, nullptr, &object) == VK_SUCCESS)
 		{
 			if (render_pass != VK_NULL_HANDLE)
 				vk.DestroyRenderPass(_orig, render_pass, nullptr);
@@ -1763,6 +1885,7 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(uint32_t param_count,
 	push_constant_ranges.reserve(param_count);
 
 	uint32_t i = 0;
+	uint32_t push_descriptor_sets = 0;
 
 	// Push constant ranges have to be at the end of the layout description
 	for (; i < param_count && params[i].type != api::pipeline_layout_param_type::push_constants; ++i)
@@ -1782,7 +1905,10 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(uint32_t param_count,
 		internal_bindings.reserve(range_count);
 		internal_samplers.reserve(range_count);
 
-		for (uint32_t k = 0, offset = 0; k < range_count; ++k, range = (with_static_samplers ? range + 1 : reinterpret_cast<const api::descriptor_range_with_static_samplers *>(reinterpret_cast<const api::descriptor_range *>(range) + 1)))
+		uint32_t offset = 0;
+		bool unbounded = false;
+
+		for (uint32_t k = 0; k < range_count; ++k, range = (with_static_samplers ? range + 1 : reinterpret_cast<const api::descriptor_range_with_static_samplers *>(reinterpret_cast<const api::descriptor_range *>(range) + 1)))
 		{
 			data.ranges.push_back(*static_cast<const api::descriptor_range *>(range));
 
@@ -1826,7 +1952,10 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(uint32_t param_count,
 			}
 
 			if (range->count == UINT32_MAX)
+			{
+				unbounded = true;
 				continue; // Skip unbounded ranges
+			}
 
 			// Add additional bindings if the total descriptor count exceeds the array size of the binding
 			for (uint32_t j = 0; j < (range->count - range->array_size); ++j)
@@ -1847,8 +1976,15 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(uint32_t param_count,
 		create_info.bindingCount = static_cast<uint32_t>(internal_bindings.size());
 		create_info.pBindings = internal_bindings.data();
 
-		if (push_descriptors && _push_descriptor_ext)
+		// Sets that exceed the push descriptor limit of the device fall back to transient descriptor sets (see 'command_list_impl::push_descriptors')
+		data.num_descriptors = offset;
+		data.push_descriptors = push_descriptors && _push_descriptor_ext && !unbounded && offset <= _max_push_descriptors && i < 32;
+
+		if (data.push_descriptors)
+		{
 			create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+			push_descriptor_sets |= 1u << i;
+		}
 
 		if (vk.CreateDescriptorSetLayout(_orig, &create_info, nullptr, &set_layouts.emplace_back()) == VK_SUCCESS)
 		{
@@ -1884,6 +2020,7 @@ bool reshade::vulkan::device_impl::create_pipeline_layout(uint32_t param_count,
 			object_data<VK_OBJECT_TYPE_PIPELINE_LAYOUT> data;
 			data.set_layouts = std::move(set_layouts);
 			data.embedded_samplers = std::move(embedded_samplers);
+			data.push_descriptor_sets = push_descriptor_sets;
 
 			register_object<VK_OBJECT_TYPE_PIPELINE_LAYOUT>(object, std::move(data));
 
@@ -2369,9 +2506,6 @@ bool reshade::vulkan::device_impl::get_pipeline_shader_group_handles(api::pipeli
 
 void reshade::vulkan::device_impl::advance_transient_descriptor_pool()
 {
-	if (_push_descriptor_ext)
-		return;
-
 	// This assumes that no other thread is currently allocating from the transient descriptor pool
 	const VkDescriptorPool next_pool = _transient_descriptor_pool[++_transient_index % 4];
 	vk.ResetDescriptorPool(_orig, next_pool, 0);
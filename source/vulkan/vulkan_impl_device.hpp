@@ -12,6 +12,7 @@
 #include <vk_layer_dispatch_table.h>
 
 #include "reshade_api_object_impl.hpp"
+#include <filesystem>
 #include <shared_mutex>
 #include <unordered_map>
 
@@ -158,6 +159,7 @@ namespace reshade::vulkan
 		std::vector<command_queue_impl *> _queues;
 
 		const bool _push_descriptor_ext;
+		uint32_t _max_push_descriptors = 0;
 		const bool _dynamic_rendering_ext;
 		const bool _timeline_semaphore_ext;
 		const bool _custom_border_color_ext;
@@ -167,6 +169,12 @@ namespace reshade::vulkan
 		const VkPhysicalDeviceFeatures _enabled_features;
 
 	private:
+		/// <summary>
+		/// Creates the pipeline cache that all pipelines are created with, populated from the file saved by a previous run for the same device and driver.
+		/// </summary>
+		void load_pipeline_cache();
+		void save_pipeline_cache();
+
 		bool create_shader_module(VkShaderStageFlagBits stage, const api::shader_desc &desc, VkPipelineShaderStageCreateInfo &stage_info, VkSpecializationInfo &spec_info, std::vector<VkSpecializationMapEntry> &spec_map);
 
 		VmaAllocator _alloc = nullptr;
@@ -176,6 +184,9 @@ namespace reshade::vulkan
 
 		VkPrivateDataSlot _private_data_slot = VK_NULL_HANDLE;
 
+		VkPipelineCache _pipeline_cache = VK_NULL_HANDLE;
+		std::filesystem::path _pipeline_cache_path;
+
 		std::shared_mutex _mutex;
 		std::unordered_map<size_t, VkRenderPassBeginInfo> _render_pass_lookup;
 	};
@@ -112,6 +112,8 @@ namespace reshade::vulkan
 
 		std::vector<VkDescriptorSetLayout> set_layouts;
 		std::vector<VkSampler> embedded_samplers;
+		// Bit mask of the sets in this layout whose set layout was created with 'VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR'
+		uint32_t push_descriptor_sets = 0;
 	};
 
 	template <>
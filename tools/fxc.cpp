@@ -3,12 +3,20 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include "effect_lexer.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
 #include "version.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib> // std::abort, std::free, std::malloc
+#include <thread>
 #include <fstream>
 #include <iostream>
+#include <algorithm> // std::max, std::sort
+#include <Windows.h>
+#include <Psapi.h>
 
 static void print_usage(const char *path)
 {
@@ -36,15 +44,446 @@ Options:
   --vulkan-semantics        Generate GLSL/SPIR-V code under Vulkan semantics, instead of OpenGL semantics.
 
   -Zi                       Enable debug information.
+
+  --batch <path>            Compile all effect files in the given directory and its subdirectories in parallel for HLSL SM3, HLSL SM5, GLSL and SPIR-V.
+                            Writes a JSON report with per-phase timings, code sizes and errors to standard output and fails if any of them failed to compile.
+  --benchmark <path>        Measure throughput of every compiler stage over all effect files in the given directory and its subdirectories on a single thread.
+                            Writes a JSON report with the fastest and median time, throughput and allocation count of each stage to standard output.
+  --iterations <count>      Number of times every stage is run per effect in benchmark mode. Defaults to 10.
+  --report <file>           Write the batch or benchmark report to the given file instead of standard output.
+  -j <count>                Number of threads to compile with in batch mode. Defaults to the number of processor cores.
 	)", path);
 }
 
+// Count heap allocations, so that benchmark mode can report them for every stage
+static std::atomic<size_t> s_allocation_count = 0;
+
+void *operator new(size_t size)
+{
+	s_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void *const p = std::malloc(size != 0 ? size : 1))
+		return p;
+	std::abort();
+}
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
+// Targets every effect is compiled for in batch mode
+static const char *const batch_target_names[] = { "hlsl30", "hlsl50", "glsl", "spirv" };
+static constexpr size_t batch_target_count = std::size(batch_target_names);
+
+struct batch_result
+{
+	std::filesystem::path path;
+	bool preprocess_success = false;
+	double preprocess_time = 0.0; // Milliseconds
+	size_t preprocessed_size = 0;
+	std::string errors;
+
+	struct target
+	{
+		bool success = false;
+		// Code generation happens while parsing, so this includes it
+		double parse_time = 0.0;
+		double finalize_time = 0.0;
+		size_t code_size = 0;
+		std::string errors;
+	} targets[batch_target_count];
+};
+
+// Settings every effect is compiled with in batch and benchmark mode
+struct batch_options
+{
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::filesystem::path> include_paths;
+	bool debug_info = false;
+	bool invert_y_axis = false;
+	bool spec_constants = false;
+	bool vulkan_semantics = false;
+};
+
+static reshadefx::codegen *create_batch_codegen(size_t target, const batch_options &options)
+{
+	switch (target)
+	{
+	case 0:
+		return reshadefx::create_codegen_hlsl(30, options.debug_info, options.spec_constants);
+	case 1:
+		return reshadefx::create_codegen_hlsl(50, options.debug_info, options.spec_constants);
+	case 2:
+		return reshadefx::create_codegen_glsl(options.vulkan_semantics, options.debug_info, options.spec_constants, options.invert_y_axis);
+	default:
+		return reshadefx::create_codegen_spirv(options.vulkan_semantics, options.debug_info, options.spec_constants, options.invert_y_axis);
+	}
+}
+
+static bool preprocess_batch_effect(const std::filesystem::path &path, const batch_options &options, std::string &output, std::string &errors)
+{
+	reshadefx::preprocessor pp;
+	for (const std::pair<std::string, std::string> &macro : options.macros)
+		pp.add_macro_definition(macro.first, macro.second);
+	for (const std::filesystem::path &include_path : options.include_paths)
+		pp.add_include_path(include_path);
+	pp.add_include_path(path.parent_path());
+
+	const bool success = pp.append_file(path);
+	errors = pp.errors();
+	if (success)
+		output = pp.output();
+	return success;
+}
+
+static bool find_batch_effects(const char *directory, std::vector<std::filesystem::path> &paths)
+{
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(std::filesystem::u8path(directory), std::filesystem::directory_options::skip_permission_denied, ec))
+		if (entry.is_regular_file(ec) && entry.path().extension() == L".fx")
+			paths.push_back(entry.path());
+
+	if (ec)
+	{
+		std::cout << "error: Failed to enumerate effect files in \"" << directory << "\" with error code " << ec.value() << std::endl;
+		return false;
+	}
+
+	// Sort so that reports of different runs can be compared line by line
+	std::sort(paths.begin(), paths.end());
+	return true;
+}
+
+static double elapsed_milliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static void write_json_string(std::ostream &stream, const std::string &value)
+{
+	stream << '"';
+	for (const char c : value)
+	{
+		switch (c)
+		{
+		case '"':
+			stream << "\\\"";
+			break;
+		case '\\':
+			stream << "\\\\";
+			break;
+		case '\n':
+			stream << "\\n";
+			break;
+		case '\r':
+			stream << "\\r";
+			break;
+		case '\t':
+			stream << "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[7];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				stream << escaped;
+			}
+			else
+			{
+				stream << c;
+			}
+			break;
+		}
+	}
+	stream << '"';
+}
+
+static void compile_batch_effect(batch_result &result, const batch_options &options)
+{
+	std::string source;
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		result.preprocess_success = preprocess_batch_effect(result.path, options, source, result.errors);
+		result.preprocess_time = elapsed_milliseconds(start);
+
+		if (!result.preprocess_success)
+			return;
+
+		result.preprocessed_size = source.size();
+	}
+
+	for (size_t i = 0; i < batch_target_count; ++i)
+	{
+		batch_result::target &target = result.targets[i];
+
+		const std::unique_ptr<reshadefx::codegen> backend(create_batch_codegen(i, options));
+
+		reshadefx::parser parser;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		target.success = parser.parse(source, backend.get());
+		target.parse_time = elapsed_milliseconds(start);
+
+		target.errors = parser.errors();
+		if (!target.success)
+			continue;
+
+		start = std::chrono::high_resolution_clock::now();
+		target.code_size = backend->finalize_code().size();
+		target.finalize_time = elapsed_milliseconds(start);
+	}
+}
+
+static int compile_batch(const char *directory, const char *reportfile, unsigned int thread_count, const batch_options &options)
+{
+	std::vector<std::filesystem::path> paths;
+	if (!find_batch_effects(directory, paths))
+		return 1;
+
+	std::vector<batch_result> results(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
+		results[i].path = std::move(paths[i]);
+
+	if (thread_count == 0)
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	thread_count = std::min(thread_count, static_cast<unsigned int>(std::max<size_t>(results.size(), 1)));
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// Every thread picks the next effect that was not compiled yet, so that a few large effects do not hold up the rest
+	std::atomic<size_t> next_index = 0;
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count);
+	for (unsigned int i = 0; i < thread_count; ++i)
+		threads.emplace_back([&]() {
+			for (size_t index; (index = next_index.fetch_add(1)) < results.size();)
+				compile_batch_effect(results[index], options);
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+
+	const double total_time = elapsed_milliseconds(start);
+
+	// Memory is shared by all threads, so can only report the peak of the whole process
+	PROCESS_MEMORY_COUNTERS memory_counters = { sizeof(memory_counters) };
+	GetProcessMemoryInfo(GetCurrentProcess(), &memory_counters, sizeof(memory_counters));
+
+	size_t succeeded[batch_target_count] = {};
+	for (const batch_result &result : results)
+		for (size_t i = 0; i < batch_target_count; ++i)
+			succeeded[i] += result.targets[i].success;
+
+	std::ofstream reportfile_stream;
+	if (reportfile != nullptr)
+		reportfile_stream.open(reportfile);
+	std::ostream &report = reportfile != nullptr ? static_cast<std::ostream &>(reportfile_stream) : std::cout;
+
+	report << "{\n";
+	report << "  \"version\": "; write_json_string(report, VERSION_STRING_PRODUCT); report << ",\n";
+	report << "  \"threads\": " << thread_count << ",\n";
+	report << "  \"total_time_ms\": " << total_time << ",\n";
+	report << "  \"peak_memory_bytes\": " << memory_counters.PeakWorkingSetSize << ",\n";
+	report << "  \"effect_count\": " << results.size() << ",\n";
+	report << "  \"succeeded\": {";
+	for (size_t i = 0; i < batch_target_count; ++i)
+		report << (i != 0 ? ", " : " ") << '"' << batch_target_names[i] << "\": " << succeeded[i];
+	report << " },\n";
+	report << "  \"effects\": [";
+
+	bool all_succeeded = true;
+	for (size_t index = 0; index < results.size(); ++index)
+	{
+		const batch_result &result = results[index];
+
+		report << (index != 0 ? ",\n" : "\n") << "    {\n";
+		std::error_code ec;
+		report << "      \"file\": "; write_json_string(report, std::filesystem::relative(result.path, std::filesystem::u8path(directory), ec).u8string()); report << ",\n";
+		report << "      \"preprocess_success\": " << (result.preprocess_success ? "true" : "false") << ",\n";
+		report << "      \"preprocess_time_ms\": " << result.preprocess_time << ",\n";
+		report << "      \"preprocessed_size\": " << result.preprocessed_size << ",\n";
+		report << "      \"errors\": "; write_json_string(report, result.errors); report << ",\n";
+		report << "      \"targets\": {";
+
+		for (size_t i = 0; i < batch_target_count; ++i)
+		{
+			const batch_result::target &target = result.targets[i];
+			all_succeeded &= target.success;
+
+			report << (i != 0 ? ",\n" : "\n") << "        \"" << batch_target_names[i] << "\": { ";
+			report << "\"success\": " << (target.success ? "true" : "false") << ", ";
+			report << "\"parse_time_ms\": " << target.parse_time << ", ";
+			report << "\"finalize_time_ms\": " << target.finalize_time << ", ";
+			report << "\"code_size\": " << target.code_size << ", ";
+			report << "\"errors\": "; write_json_string(report, target.errors); report << " }";
+		}
+
+		report << "\n      }\n    }";
+	}
+
+	report << "\n  ]\n}\n";
+	report.flush();
+
+	return all_succeeded ? 0 : 1;
+}
+
+// Stages benchmark mode measures, with the parse stage being run separately for every batch target
+struct benchmark_stage
+{
+	std::string name;
+	// Amount of work done in one iteration over the whole corpus (bytes of source, tokens or functions)
+	const char *unit = nullptr;
+	double amount = 0.0;
+	// Sum of the fastest and median iteration of every effect in milliseconds
+	double min_time = 0.0;
+	double median_time = 0.0;
+	size_t allocations = 0;
+	size_t failures = 0;
+};
+
+template <typename F>
+static void measure_benchmark_stage(benchmark_stage &stage, unsigned int iterations, F &&function)
+{
+	std::vector<double> times(iterations);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		const size_t allocation_count = s_allocation_count.load(std::memory_order_relaxed);
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		times[i] = elapsed_milliseconds(start);
+
+		// Allocations do not differ between iterations, so only keep those of the last one
+		stage.allocations += (i + 1 == iterations) ? s_allocation_count.load(std::memory_order_relaxed) - allocation_count : 0;
+	}
+
+	std::sort(times.begin(), times.end());
+	stage.min_time += times.front();
+	stage.median_time += times[times.size() / 2];
+}
+
+static int run_benchmark(const char *directory, const char *reportfile, unsigned int iterations, const batch_options &options)
+{
+	std::vector<std::filesystem::path> paths;
+	if (!find_batch_effects(directory, paths))
+		return 1;
+
+	benchmark_stage preprocess_stage, lexer_stage, parse_stages[batch_target_count], finalize_stages[batch_target_count];
+	preprocess_stage.name = "preprocess";
+	preprocess_stage.unit = "bytes";
+	lexer_stage.name = "lex";
+	lexer_stage.unit = "tokens";
+	for (size_t i = 0; i < batch_target_count; ++i)
+	{
+		parse_stages[i].name = std::string("parse_") + batch_target_names[i];
+		parse_stages[i].unit = "functions";
+		finalize_stages[i].name = std::string("finalize_") + batch_target_names[i];
+		finalize_stages[i].unit = "bytes";
+	}
+
+	for (const std::filesystem::path &path : paths)
+	{
+		std::string source, errors;
+		if (!preprocess_batch_effect(path, options, source, errors))
+		{
+			preprocess_stage.failures++;
+			continue;
+		}
+
+		// Preprocessor shares a cache of included files between instances, so this measures the warm case after the first iteration
+		measure_benchmark_stage(preprocess_stage, iterations, [&]() {
+			std::string output;
+			preprocess_batch_effect(path, options, output, errors);
+		});
+		preprocess_stage.amount += static_cast<double>(source.size());
+
+		size_t token_count = 0;
+		measure_benchmark_stage(lexer_stage, iterations, [&]() {
+			token_count = 0;
+			reshadefx::lexer lexer(source);
+			while (lexer.lex().id != reshadefx::tokenid::end_of_file)
+				token_count++;
+		});
+		lexer_stage.amount += static_cast<double>(token_count);
+
+		for (size_t i = 0; i < batch_target_count; ++i)
+		{
+			std::unique_ptr<reshadefx::codegen> backend;
+			bool success = true;
+			measure_benchmark_stage(parse_stages[i], iterations, [&]() {
+				backend.reset(create_batch_codegen(i, options));
+				reshadefx::parser parser;
+				success = parser.parse(source, backend.get());
+			});
+
+			if (!success)
+			{
+				parse_stages[i].failures++;
+				continue;
+			}
+
+			parse_stages[i].amount += static_cast<double>(backend->function_count());
+
+			size_t code_size = 0;
+			measure_benchmark_stage(finalize_stages[i], iterations, [&]() {
+				code_size = backend->finalize_code().size();
+			});
+			finalize_stages[i].amount += static_cast<double>(code_size);
+		}
+	}
+
+	std::ofstream reportfile_stream;
+	if (reportfile != nullptr)
+		reportfile_stream.open(reportfile);
+	std::ostream &report = reportfile != nullptr ? static_cast<std::ostream &>(reportfile_stream) : std::cout;
+
+	report << "{\n";
+	report << "  \"version\": "; write_json_string(report, VERSION_STRING_PRODUCT); report << ",\n";
+	report << "  \"effect_count\": " << paths.size() << ",\n";
+	report << "  \"iterations\": " << iterations << ",\n";
+	report << "  \"stages\": [";
+
+	size_t failures = 0;
+	const auto write_stage = [&](const benchmark_stage &stage, bool first) {
+		failures += stage.failures;
+
+		report << (first ? "\n" : ",\n") << "    { ";
+		report << "\"name\": \"" << stage.name << "\", ";
+		report << "\"min_time_ms\": " << stage.min_time << ", ";
+		report << "\"median_time_ms\": " << stage.median_time << ", ";
+		report << "\"" << stage.unit << "\": " << static_cast<size_t>(stage.amount) << ", ";
+		// Throughput is based on the fastest iteration, since that is the least affected by noise from the rest of the system
+		report << "\"" << stage.unit << "_per_second\": " << (stage.min_time > 0.0 ? stage.amount * 1000.0 / stage.min_time : 0.0) << ", ";
+		report << "\"allocations\": " << stage.allocations << ", ";
+		report << "\"failures\": " << stage.failures << " }";
+	};
+
+	write_stage(preprocess_stage, true);
+	write_stage(lexer_stage, false);
+	for (size_t i = 0; i < batch_target_count; ++i)
+		write_stage(parse_stages[i], false);
+	for (size_t i = 0; i < batch_target_count; ++i)
+		write_stage(finalize_stages[i], false);
+
+	report << "\n  ]\n}\n";
+	report.flush();
+
+	return failures == 0 ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
 	const char *filename = nullptr;
 	const char *preprocess = nullptr;
 	const char *errorfile = nullptr;
 	const char *objectfile = nullptr;
+	const char *batch_directory = nullptr;
+	const char *benchmark_directory = nullptr;
+	const char *reportfile = nullptr;
+	unsigned int thread_count = 0;
+	unsigned int iterations = 10;
 	const char *buffer_width = "800";
 	const char *buffer_height = "600";
 	bool print_glsl = false;
@@ -55,9 +494,11 @@ int main(int argc, char *argv[])
 	bool vulkan_semantics = false;
 	unsigned int shader_model = 50;
 
-	reshadefx::preprocessor pp;
-	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+	// Keep track of macros and include paths, so that batch mode can set up a separate preprocessor for every effect
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::filesystem::path> include_paths;
+	macros.emplace_back("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	macros.emplace_back("__RESHADE_PERFORMANCE_MODE__", "0");
 
 	// Parse command-line arguments
 	for (int i = 1; i < argc; ++i)
@@ -80,13 +521,13 @@ int main(int argc, char *argv[])
 				char *macro = argv[++i];
 				char *value = std::strchr(macro, '=');
 				if (value) *value++ = '\0';
-				pp.add_macro_definition(macro, value ? value : "1");
+				macros.emplace_back(macro, value ? value : "1");
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-I"))
 			{
-				pp.add_include_path(argv[++i]);
+				include_paths.push_back(std::filesystem::u8path(argv[++i]));
 				continue;
 			}
 
@@ -117,6 +558,16 @@ int main(int argc, char *argv[])
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
+			else if (0 == std::strcmp(arg, "--batch"))
+				batch_directory = argv[++i];
+			else if (0 == std::strcmp(arg, "--benchmark"))
+				benchmark_directory = argv[++i];
+			else if (0 == std::strcmp(arg, "--iterations"))
+				iterations = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			else if (0 == std::strcmp(arg, "--report"))
+				reportfile = argv[++i];
+			else if (0 == std::strcmp(arg, "-j"))
+				thread_count = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
 		}
 		else
 		{
@@ -130,16 +581,51 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	macros.emplace_back("BUFFER_WIDTH", buffer_width);
+	macros.emplace_back("BUFFER_HEIGHT", buffer_height);
+	macros.emplace_back("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	macros.emplace_back("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+
+	batch_options options;
+	options.macros = macros;
+	options.include_paths = include_paths;
+	options.debug_info = debug_info;
+	options.invert_y_axis = invert_y_axis;
+	options.spec_constants = spec_constants;
+	options.vulkan_semantics = vulkan_semantics;
+
+	if (batch_directory != nullptr)
+	{
+		if (filename != nullptr)
+		{
+			std::cout << "error: Cannot specify an input file in batch mode" << std::endl;
+			return 1;
+		}
+
+		return compile_batch(batch_directory, reportfile, thread_count, options);
+	}
+	if (benchmark_directory != nullptr)
+	{
+		if (filename != nullptr)
+		{
+			std::cout << "error: Cannot specify an input file in benchmark mode" << std::endl;
+			return 1;
+		}
+
+		return run_benchmark(benchmark_directory, reportfile, std::max(iterations, 1u), options);
+	}
+
 	if (filename == nullptr)
 	{
 		print_usage(argv[0]);
 		return 1;
 	}
 
-	pp.add_macro_definition("BUFFER_WIDTH", buffer_width);
-	pp.add_macro_definition("BUFFER_HEIGHT", buffer_height);
-	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	reshadefx::preprocessor pp;
+	for (const std::pair<std::string, std::string> &macro : macros)
+		pp.add_macro_definition(macro.first, macro.second);
+	for (const std::filesystem::path &include_path : include_paths)
+		pp.add_include_path(include_path);
 
 	if (!pp.append_file(filename))
 	{